@@ -37,6 +37,7 @@ class AppleSpellChecker
 	void		parseConfigFile (const char * configFile);
 
 	bool		checkWord (const char * word, size_t len, NSString * lang);
+	void		checkWords (const char * const * words, const size_t * lens, size_t n, int * results, NSString * lang);
 	char **		suggestWord (const char * const word, size_t len, size_t * nsug, NSString * lang);
 
 	NSString *	requestDictionary (const char * const code);
@@ -184,6 +185,64 @@ bool AppleSpellChecker::checkWord (const char * word, size_t len, NSString * lan
 	return (result.length ? true : false);
 }
 
+/* Checks the words as one string, spaced apart, and marks the words the
+ * misspelled ranges NSSpellChecker finds in it fall on: one string to
+ * bridge and one scan, rather than a string and a scan for each word */
+void AppleSpellChecker::checkWords (const char * const * words, const size_t * lens, size_t n, int * results, NSString * lang)
+{
+	for (size_t i = 0; i < n; i++)
+		results[i] = 0;
+
+	if (!m_checker || !lang || !n)
+		return;
+
+	/* where each word starts in the string, counted in UTF-16 units as
+	 * NSString counts them */
+	NSUInteger * starts = g_new (NSUInteger, n + 1);
+	GString * text = g_string_sized_new (n * 8);
+	NSUInteger offset = 0;
+	for (size_t i = 0; i < n; i++)
+		{
+			starts[i] = offset;
+			g_string_append_len (text, words[i], lens[i]);
+			g_string_append_c (text, ' ');
+			for (const char * p = words[i]; p < words[i] + lens[i]; p = g_utf8_next_char (p))
+				offset += g_utf8_get_char (p) > 0xFFFF ? 2 : 1;
+			offset++;
+		}
+	starts[n] = offset;
+
+	NSString * str = [[NSString alloc] initWithBytes:text->str length:text->len encoding:NSUTF8StringEncoding];
+	g_string_free (text, TRUE);
+	if (!str)
+		{
+			g_free (starts);
+			for (size_t i = 0; i < n; i++)
+				results[i] = checkWord (words[i], lens[i], lang);
+			return;
+		}
+
+	size_t word = 0;
+	NSUInteger pos = 0;
+	while (pos < [str length])
+		{
+			NSRange range = [m_checker checkSpellingOfString:str startingAt:pos language:lang
+							    wrap:NO inSpellDocumentWithTag:0 wordCount:NULL];
+			if (range.location == NSNotFound || !range.length)
+				break;
+
+			while (word < n && starts[word + 1] <= range.location)
+				word++;
+			for (size_t i = word; i < n && starts[i] < range.location + range.length; i++)
+				results[i] = 1;
+
+			pos = range.location + range.length;
+		}
+
+	[str release];
+	g_free (starts);
+}
+
 char ** AppleSpellChecker::suggestWord (const char * const word, size_t len, size_t * nsug, NSString * lang)
 {
 	// NSLog (@"AppleSpellChecker::suggestWord: lang=\"%@\"", lang);
@@ -297,6 +356,23 @@ static int appleSpell_dict_check (EnchantDict * me, const char * const word, siz
 	}
 }
 
+static void appleSpell_dict_check_batch (EnchantDict * me, const char * const * words, const size_t * lens, size_t n, int * results)
+{
+	@autoreleasepool {
+		// NSLog (@"appleSpell_dict_check_batch");
+
+		if (AppleSpellDictionary * ASD = static_cast<AppleSpellDictionary *>(me->user_data))
+			{
+				ASD->AppleSpell->checkWords (words, lens, n, results, ASD->DictionaryName);
+			}
+		else
+			{
+				for (size_t i = 0; i < n; i++)
+					results[i] = 0;
+			}
+	}
+}
+
 static EnchantDict * appleSpell_provider_request_dict (EnchantProvider * me, const char * const tag)
 {
 	@autoreleasepool {
@@ -311,6 +387,7 @@ static EnchantDict * appleSpell_provider_request_dict (EnchantProvider * me, con
 
 		dict->check            = appleSpell_dict_check;
 		dict->suggest          = appleSpell_dict_suggest;
+		dict->check_batch      = appleSpell_dict_check_batch;
 
 		AppleSpellDictionary * ASD = g_new0 (AppleSpellDictionary, 1);
 		if (!ASD)
@@ -413,6 +490,11 @@ static const char * appleSpell_provider_describe (EnchantProvider * me)
 }
 
 extern "C" {
+	unsigned int enchant_provider_abi_version (void)
+	{
+		return ENCHANT_PROVIDER_ABI_VERSION;
+	}
+
 	EnchantProvider *init_enchant_provider (void)
 	{
 		@autoreleasepool {
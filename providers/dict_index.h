@@ -0,0 +1,167 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+#ifndef DICT_INDEX_H
+#define DICT_INDEX_H
+
+/* The index of the dictionary directories that the hunspell and nuspell
+ * providers share: both look for .dic files with an .aff file next to
+ * them.  Each provider gets its own copy of what is here. */
+
+#include <ctype.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "enchant-provider.h"
+
+// A dictionary directory as last looked at: the .dic files in it that
+// have an .aff file next to them, in the order it lists them
+struct DictDir
+{
+	std::string path;
+	gint64 stamp;	/* modification time, or -1 if it is not there */
+	std::vector<std::string> dics;	/* file names */
+};
+
+// What the dictionary directories hold, each looked at again only once
+// it changes; kept by a provider, which brings it up to date from one
+// thread at a time
+typedef std::vector<DictDir> DictIndex;
+
+static void
+s_scanDictDir(DictDir & dictDir)
+{
+	dictDir.dics.clear();
+	GDir *dir = g_dir_open (dictDir.path.c_str(), 0, nullptr);
+	if (!dir)
+		return;
+
+	const char *dir_entry;
+	while ((dir_entry = g_dir_read_name (dir)) != NULL) {
+		size_t len = strlen(dir_entry);
+		if (len < 4 || strcmp(dir_entry + len - 4, ".dic") != 0)
+			continue;
+		std::string aff = std::string(dir_entry, len - 3) + "aff";
+		char *path = g_build_filename (dictDir.path.c_str(), aff.c_str(), nullptr);
+		if (g_file_test(path, G_FILE_TEST_EXISTS))
+			dictDir.dics.push_back(dir_entry);
+		g_free(path);
+	}
+	g_dir_close (dir);
+}
+
+// Brings the index up to date with dirs, the directories searched now
+static DictIndex &
+s_updateIndex(DictIndex & index, const std::vector<std::string> & dirs)
+{
+	DictIndex current(dirs.size());
+	for (size_t i = 0; i < dirs.size(); i++) {
+		gint64 stamp = enchant_dir_stamp(dirs[i].c_str());
+		size_t j = 0;
+		while (j < index.size() && index[j].path != dirs[i])
+			j++;
+
+		if (j < index.size() && index[j].stamp == stamp) {
+			current[i] = index[j];
+		} else {
+			current[i].path = dirs[i];
+			current[i].stamp = stamp;
+			if (stamp != -1)
+				s_scanDictDir(current[i]);
+		}
+	}
+
+	index.swap(current);
+	return index;
+}
+
+static bool is_plausible_dict_for_tag(const char *dir_entry, const char *tag)
+{
+	const char *dic_suffix = ".dic";
+	size_t dic_suffix_len = strlen(dic_suffix);
+	size_t dir_entry_len = strlen(dir_entry);
+	size_t tag_len = strlen(tag);
+
+	if (dir_entry_len - dic_suffix_len < tag_len)
+		return false;
+	if (strcmp(dir_entry + dir_entry_len - dic_suffix_len, dic_suffix) != 0)
+		return false;
+	if (strncmp (dir_entry, tag, tag_len) != 0)
+		return false;
+	//e.g. requested dict for "fi",
+	//reject "fil_PH.dic"
+	//allow "fi-FOO.dic", "fi_FOO.dic", "fi.dic", etc.
+	if (!ispunct(dir_entry[tag_len]))
+		return false;
+	return true;
+}
+
+// The .dic file named after tag in the first directory that has one
+static std::string
+s_findExactDictionary(const DictIndex & index, const char * tag)
+{
+	std::string name = std::string(tag) + ".dic";
+	for (size_t i = 0; i < index.size(); i++)
+		for (size_t j = 0; j < index[i].dics.size(); j++)
+			if (index[i].dics[j] == name) {
+				char *dic = g_build_filename (index[i].path.c_str(), name.c_str(), nullptr);
+				std::string path(dic);
+				g_free(dic);
+				return path;
+			}
+
+	return std::string();
+}
+
+// The .dic file for tag: named after it, or else for a variant of it
+static std::string
+s_findDictionary(const DictIndex & index, const char * tag)
+{
+	std::string path = s_findExactDictionary(index, tag);
+	if (!path.empty())
+		return path;
+
+	for (size_t i = 0; i < index.size(); i++)
+		for (size_t j = 0; j < index[i].dics.size(); j++)
+			if (is_plausible_dict_for_tag(index[i].dics[j].c_str(), tag)) {
+				char *dic = g_build_filename (index[i].path.c_str(),
+							      index[i].dics[j].c_str(), nullptr);
+				path = dic;
+				g_free(dic);
+				return path;
+			}
+
+	return std::string();
+}
+
+#endif /* DICT_INDEX_H */
@@ -76,30 +76,34 @@ aspell_dict_suggest (EnchantDict * me, const char *const word,
 	const AspellWordList *word_list = aspell_speller_suggest (manager, normalizedWord, strlen(normalizedWord));
 	g_free(normalizedWord);
 
-	char **sugg_arr = NULL;
-	if (word_list)
-		{
-			AspellStringEnumeration *suggestions = aspell_word_list_elements (word_list);
-			if (suggestions)
-				{
-					size_t n_suggestions = aspell_word_list_size (word_list);
-					*out_n_suggs = n_suggestions;
-					
-					if (n_suggestions)
-						{
-							sugg_arr = g_new0 (char *, n_suggestions + 1);
-							
-							for (size_t i = 0; i < n_suggestions; i++)
-								{
-									const char *sugg = aspell_string_enumeration_next (suggestions);
-									if (sugg)
-										sugg_arr[i] = g_strdup (sugg);
-								}
-						}
-					delete_aspell_string_enumeration (suggestions);
-				}
-		}
-	
+	*out_n_suggs = 0;
+	if (!word_list)
+		return NULL;
+
+	size_t n_suggestions = aspell_word_list_size (word_list);
+	if (n_suggestions == 0)
+		return NULL;
+
+	AspellStringEnumeration *suggestions = aspell_word_list_elements (word_list);
+	if (!suggestions)
+		return NULL;
+
+	/* the words belong to the speller until its next call, so each is
+	 * copied once, straight into its place in the list */
+	char **sugg_arr = g_new (char *, n_suggestions + 1);
+	size_t n = 0;
+	const char *sugg;
+	while (n < n_suggestions && (sugg = aspell_string_enumeration_next (suggestions)) != NULL)
+		sugg_arr[n++] = g_strdup (sugg);
+	sugg_arr[n] = NULL;
+	delete_aspell_string_enumeration (suggestions);
+
+	if (n == 0) {
+		g_free (sugg_arr);
+		return NULL;
+	}
+
+	*out_n_suggs = n;
 	return sugg_arr;
 }
 
@@ -132,11 +136,10 @@ aspell_dict_store_replacement (EnchantDict * me,
 }
 
 static EnchantDict *
-aspell_provider_request_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, const char *const tag)
+aspell_provider_request_dict (EnchantProvider * me, const char *const tag)
 {
-	AspellConfig *spell_config = new_aspell_config ();
+	AspellConfig *spell_config = aspell_config_clone ((AspellConfig *) me->user_data);
 	aspell_config_replace (spell_config, "language-tag", tag);
-	aspell_config_replace (spell_config, "encoding", "utf-8");
 	
 	AspellCanHaveError *spell_error = new_aspell_speller (spell_config);
 	delete_aspell_config (spell_config);
@@ -170,44 +173,55 @@ aspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, Enchant
 }
 
 static char ** 
-aspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER, 
+aspell_provider_list_dicts (EnchantProvider * me, 
 			    size_t * out_n_dicts)
 {
-	AspellConfig * spell_config = new_aspell_config ();
-	AspellDictInfoList * dlist = get_aspell_dict_info_list (spell_config);
-
-	*out_n_dicts = 0;
-	AspellDictInfoEnumeration * dels = aspell_dict_info_list_elements (dlist);
+	AspellDictInfoList * dlist = get_aspell_dict_info_list ((AspellConfig *) me->user_data);
 
 	/* Note: aspell_dict_info_list_size() always returns zero: https://github.com/GNUAspell/aspell/issues/155 */
+	GPtrArray *codes = g_ptr_array_new ();
+	AspellDictInfoEnumeration * dels = aspell_dict_info_list_elements (dlist);
 	const AspellDictInfo * entry;
-	while ( (entry = aspell_dict_info_enumeration_next(dels)) != 0)
-		(*out_n_dicts)++;
+	while ( (entry = aspell_dict_info_enumeration_next (dels)) != 0)
+		/* FIXME: should this be entry->code or entry->name ? */
+		g_ptr_array_add (codes, g_strdup (entry->code));
 	delete_aspell_dict_info_enumeration (dels);
 
-	char ** out_list = NULL;
+	*out_n_dicts = codes->len;
+	if (codes->len == 0) {
+		g_ptr_array_free (codes, TRUE);
+		return NULL;
+	}
 
-	if (*out_n_dicts) {
-		out_list = g_new0 (char *, *out_n_dicts + 1);
-		dels = aspell_dict_info_list_elements (dlist);
-		
-		for (size_t i = 0; i < *out_n_dicts; i++) {
-			entry = aspell_dict_info_enumeration_next (dels);			
-			/* FIXME: should this be entry->code or entry->name ? */
-			out_list[i] = g_strdup (entry->code);
-		}
-		
-		delete_aspell_dict_info_enumeration (dels);
+	g_ptr_array_add (codes, NULL);
+	return (char **) g_ptr_array_free (codes, FALSE);
+}
+
+/* Where aspell looks for the dictionaries it lists; Enchant lists them
+ * again only once one of these changes */
+static char **
+aspell_provider_list_dict_dirs (EnchantProvider * me,
+				size_t * out_n_dirs)
+{
+	AspellConfig *config = (AspellConfig *) me->user_data;
+	static const char *const keys[] = { "dict-dir", "data-dir" };
+
+	char **dirs = g_new0 (char *, G_N_ELEMENTS (keys) + 1);
+	size_t n_dirs = 0;
+	for (size_t i = 0; i < G_N_ELEMENTS (keys); i++) {
+		const char *dir = aspell_config_retrieve (config, keys[i]);
+		if (dir && *dir && !(n_dirs > 0 && strcmp (dirs[n_dirs - 1], dir) == 0))
+			dirs[n_dirs++] = g_strdup (dir);
 	}
-	
-	delete_aspell_config (spell_config);
-	
-	return out_list;
+
+	*out_n_dirs = n_dirs;
+	return dirs;
 }
 
 static void
 aspell_provider_dispose (EnchantProvider * me)
 {
+	delete_aspell_config ((AspellConfig *) me->user_data);
 	g_free (me);
 }
 
@@ -223,16 +237,29 @@ aspell_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 	return "Aspell Provider";
 }
 
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider (void)
 {
+	/* Every speller and the dictionary listing start from this one
+	 * config, rather than each setting up its own */
+	AspellConfig *config = new_aspell_config ();
+	aspell_config_replace (config, "encoding", "utf-8");
+
 	EnchantProvider *provider = g_new0 (EnchantProvider, 1);
+	provider->user_data = (void *) config;
 	provider->dispose = aspell_provider_dispose;
 	provider->request_dict = aspell_provider_request_dict;
 	provider->dispose_dict = aspell_provider_dispose_dict;
 	provider->identify = aspell_provider_identify;
 	provider->describe = aspell_provider_describe;
 	provider->list_dicts = aspell_provider_list_dicts;
+	provider->list_dict_dirs = aspell_provider_list_dict_dirs;
 
 	return provider;
 }
@@ -45,48 +45,131 @@
 #include "enchant-provider.h"
 #include "unused-parameter.h"
 
+/* The characters of ISO-8859-8 from 0xA0 up, 0 where there is none;
+ * below 0xA0 it is the same as Unicode */
+static const gunichar iso8859_8_upper[96] = {
+	0x00A0, 0x0000, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00D7, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00F7, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2017,
+	0x05D0, 0x05D1, 0x05D2, 0x05D3, 0x05D4, 0x05D5, 0x05D6, 0x05D7,
+	0x05D8, 0x05D9, 0x05DA, 0x05DB, 0x05DC, 0x05DD, 0x05DE, 0x05DF,
+	0x05E0, 0x05E1, 0x05E2, 0x05E3, 0x05E4, 0x05E5, 0x05E6, 0x05E7,
+	0x05E8, 0x05E9, 0x05EA, 0x0000, 0x0000, 0x200E, 0x200F, 0x0000,
+};
+
+static gunichar
+iso8859_8_to_unicode (guchar c)
+{
+	return c < 0xA0 ? c : iso8859_8_upper[c - 0xA0];
+}
+
+/* returns 0 for characters ISO-8859-8 does not have */
+static guchar
+unicode_to_iso8859_8 (gunichar uc)
+{
+	if (uc < 0xA0)
+		return (guchar) uc;
+	if (uc >= 0x05D0 && uc <= 0x05EA)
+		return (guchar) (0xE0 + uc - 0x05D0);
+	for (size_t i = 0; i < G_N_ELEMENTS (iso8859_8_upper); i++)
+		if (iso8859_8_upper[i] == uc)
+			return (guchar) (0xA0 + i);
+	return 0;
+}
+
+/* Each UTF-8 character of the word becomes one byte, so iso_word needs
+ * len + 1 bytes at most */
+static gboolean
+hspell_convert_to_iso8859_8 (EnchantDict *me, const char *const word, size_t len, char *iso_word)
+{
+	const char *p = word, *end = word + len;
+	char *out = iso_word;
+	while (p < end)
+		{
+			gunichar uc = g_utf8_get_char_validated (p, end - p);
+			guchar c = uc < (gunichar) -2 && uc != 0 ? unicode_to_iso8859_8 (uc) : 0;
+			if (c == 0)
+				{
+					enchant_dict_set_error (me, "word not valid Hebrew (could not be converted to ISO-8859-8)");
+					return FALSE;
+				}
+			*out++ = (char) c;
+			p = g_utf8_next_char (p);
+		}
+	*out = '\0';
+	return TRUE;
+}
+
+/* returns NULL if the word has a byte ISO-8859-8 leaves unassigned */
+static char *
+hspell_convert_to_utf8 (const char *iso_word)
+{
+	size_t utf8_len = 0;
+	for (const guchar *p = (const guchar *) iso_word; *p; p++)
+		{
+			gunichar uc = iso8859_8_to_unicode (*p);
+			if (uc == 0)
+				return NULL;
+			utf8_len += g_unichar_to_utf8 (uc, NULL);
+		}
+
+	char *utf8_word = g_malloc (utf8_len + 1);
+	char *out = utf8_word;
+	for (const guchar *p = (const guchar *) iso_word; *p; p++)
+		out += g_unichar_to_utf8 (iso8859_8_to_unicode (*p), out);
+	*out = '\0';
+	return utf8_word;
+}
+
 /**
  * convert struct corlist to **char
  * the **char must be g_freed
  */
 static gchar **
-corlist2strv (struct corlist *cl, size_t nb_sugg)
+corlist2strv (struct corlist *cl, size_t *out_n_suggs)
 {
-	char **sugg_arr = NULL;
-	if (nb_sugg > 0)
+	size_t nb_sugg = corlist_n (cl);
+	*out_n_suggs = 0;
+	if (nb_sugg == 0)
+		return NULL;
+
+	char **sugg_arr = g_new0 (char *, nb_sugg + 1);
+	for (size_t i = 0; i < nb_sugg; i++)
 		{
-			sugg_arr = g_new0 (char *, nb_sugg + 1);
-			for (size_t i = 0; i < nb_sugg; i++)
-				{
-					gsize len;
-					const char *sugg = corlist_str (cl, i);
-					if (sugg)
-						sugg_arr[i] = g_convert (sugg,
-									 strlen (sugg),
-									 "utf-8", "iso8859-8", NULL, &len, NULL);
-				}
+			const char *sugg = corlist_str (cl, i);
+			char *utf8_sugg = sugg ? hspell_convert_to_utf8 (sugg) : NULL;
+			if (utf8_sugg)
+				sugg_arr[(*out_n_suggs)++] = utf8_sugg;
+		}
+
+	if (*out_n_suggs == 0)
+		{
+			g_free (sugg_arr);
+			return NULL;
 		}
-	
 	return sugg_arr;
 }
 
-static char *
-hspell_convert_to_iso8859_8 (EnchantDict *me, const char *const word, size_t len)
-{
-	/* convert to iso 8859-8 */
-	gsize length;
-	char *iso_word = g_convert (word, len, "iso8859-8", "utf-8", NULL, &length, NULL);
-	if (iso_word == NULL)
-		enchant_dict_set_error (me, "word not valid Hebrew (could not be converted to ISO-8859-8)");
-	return iso_word;
-}
+/* Words that fit are converted on the stack */
+#define HSPELL_STACK_WORD 256
 
 static int
 hspell_dict_check (EnchantDict * me, const char *const word, size_t len)
 {
 	struct dict_radix *hspell_dict = (struct dict_radix *)me->user_data;
-	char *iso_word = hspell_convert_to_iso8859_8 (me, word, len);
-	g_return_val_if_fail (iso_word, -1);
+	char stack_word[HSPELL_STACK_WORD];
+	char *iso_word = len < sizeof (stack_word) ? stack_word : g_malloc (len + 1);
+	if (!hspell_convert_to_iso8859_8 (me, word, len, iso_word))
+		{
+			if (iso_word != stack_word)
+				g_free (iso_word);
+			return -1;
+		}
 	
 	/* check */
 	int preflen;
@@ -96,7 +179,8 @@ hspell_dict_check (EnchantDict * me, const char *const word, size_t len)
 	if (res != 1)
 		res = hspell_is_canonic_gimatria (iso_word) != 0;
 	
-	g_free (iso_word);
+	if (iso_word != stack_word)
+		g_free (iso_word);
 	
 	return (res != 1);
 }
@@ -106,18 +190,24 @@ hspell_dict_suggest (EnchantDict * me, const char *const word,
 		     size_t len, size_t * out_n_suggs)
 {
 	struct dict_radix *hspell_dict = (struct dict_radix *)me->user_data;
-	char *iso_word = hspell_convert_to_iso8859_8 (me, word, len);
-	g_return_val_if_fail (iso_word, NULL);
+	char stack_word[HSPELL_STACK_WORD];
+	char *iso_word = len < sizeof (stack_word) ? stack_word : g_malloc (len + 1);
+	if (!hspell_convert_to_iso8859_8 (me, word, len, iso_word))
+		{
+			if (iso_word != stack_word)
+				g_free (iso_word);
+			return NULL;
+		}
 
 	/* get suggestions */
 	struct corlist cl;
 	corlist_init (&cl);
 	hspell_trycorrect (hspell_dict, iso_word, &cl);
 	
-	*out_n_suggs = corlist_n (&cl);
-	char **sugg_arr = corlist2strv (&cl, *out_n_suggs);
+	char **sugg_arr = corlist2strv (&cl, out_n_suggs);
 	corlist_free (&cl);
-	g_free (iso_word);
+	if (iso_word != stack_word)
+		g_free (iso_word);
 	
 	return sugg_arr;	
 }
@@ -200,6 +290,12 @@ hspell_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 
 EnchantProvider *init_enchant_provider (void);
 
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider (void)
 {
@@ -38,11 +38,14 @@
 #include <stdlib.h>
 #include <string.h> 
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "enchant-provider.h"
 #include "unused-parameter.h"
+#include "dict_index.h"
 
 #include <hunspell/hunspell.hxx>
 
@@ -53,9 +56,29 @@
 #endif
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 /***************************************************************************/
 
+// A loaded Hunspell, shared by the checkers of every broker in the process
+// that asks for the same files while neither has changed
+struct HunspellInstance
+{
+	Hunspell *hunspell;
+	std::vector<gunichar> tryChars;	/* from the TRY line of the .aff file */
+	GMutex lock;	/* hunspell is not called by two threads at once */
+	unsigned int refs;
+	std::string key;	/* in s_instances, or empty if not shared */
+};
+
+// How much of its search hunspell is let do, see hunspell_dict_set_suggest_profile
+enum SuggestProfile
+{
+	SUGGEST_FAST,		/* only the words one edit away */
+	SUGGEST_BALANCED,	/* hunspell's own search, but not for long words */
+	SUGGEST_THOROUGH	/* hunspell's own search and the words one edit away */
+};
+
 class HunspellChecker
 {
 public:
@@ -66,30 +89,228 @@ public:
 	char **suggestWord (const char* const word, size_t len, size_t *out_n_suggs);
 	const char *getWordchars ();
 
-	bool requestDictionary (const char * szLang);
+	char **suggestNearby (const char* const word, size_t len, size_t max_suggs,
+			      gint64 deadline, size_t *out_n_suggs);
+	char **suggestThorough (const char* const word, size_t len, size_t *out_n_suggs);
+
+	SuggestProfile m_profile;
+
+	bool requestDictionary (const std::string & dic);
+	bool cloneDictionary (const HunspellChecker & other);
 
 private:
+	bool loadDictionary (const std::string & aff, const std::string & dic, bool shared);
+	bool checkWordUtf8 (const char *word, size_t len);
+	char **suggestWordUtf8 (const char* const word, size_t len, size_t *out_n_suggs);
+	bool spell (const char *word);
+	int suggest (char ***slst, const char *word);
+
 	GIConv  m_translate_in; /* Selected translation from/to Unicode */
 	GIConv  m_translate_out;
-	Hunspell *hunspell;
+	bool m_utf8;	/* the dictionary is in UTF-8, so nothing is translated */
+	HunspellInstance *m_instance;
+	std::string m_aff;	/* the files hunspell was loaded from */
+	std::string m_dic;
 };
 
 /***************************************************************************/
 
+static GMutex s_instances_lock;	/* guards s_instances and the refs of what is in it */
+static std::map<std::string, HunspellInstance *> s_instances;
+
+// Tells the files apart by their paths, modification times and sizes, as
+// pwl.c does its word lists, so that one rewritten within the second it
+// was loaded in is not taken for the same; returns an empty key for
+// files that cannot be looked at
+static std::string
+s_instanceKey(const std::string & aff, const std::string & dic)
+{
+	GStatBuf affStat, dicStat;
+	if (g_stat(aff.c_str(), &affStat) != 0 || g_stat(dic.c_str(), &dicStat) != 0)
+		return std::string();
+
+	char *stamps = g_strdup_printf("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+				       enchant_dir_stamp(aff.c_str()), (gint64) affStat.st_size,
+				       enchant_dir_stamp(dic.c_str()), (gint64) dicStat.st_size);
+	std::string key = aff + '\n' + dic + '\n' + stamps;
+	g_free(stamps);
+	return key;
+}
+
+// The characters hunspell tries in place of others, as listed on the TRY
+// line of the .aff file; hunspell itself does not tell
+static std::vector<gunichar>
+s_readTryChars(const std::string & aff, const char *enc)
+{
+	std::vector<gunichar> chars;
+	FILE *file = g_fopen(aff.c_str(), "r");
+	if (!file)
+		return chars;
+
+	char line[1024];
+	while (fgets(line, sizeof(line), file)) {
+		if (strncmp(line, "TRY", 3) != 0 || !g_ascii_isspace(line[3]))
+			continue;
+
+		char *utf8 = g_convert(g_strstrip(line + 3), -1, "UTF-8", enc, nullptr, nullptr, nullptr);
+		glong n_chars;
+		gunichar *ucs4 = utf8 ? g_utf8_to_ucs4(utf8, -1, nullptr, &n_chars, nullptr) : nullptr;
+		if (ucs4)
+			chars.assign(ucs4, ucs4 + n_chars);
+		g_free(ucs4);
+		g_free(utf8);
+		break;
+	}
+	fclose(file);
+	return chars;
+}
+
+static HunspellInstance *
+s_newInstance(const std::string & aff, const std::string & dic)
+{
+	HunspellInstance *instance = new HunspellInstance();
+	instance->hunspell = new Hunspell(aff.c_str(), dic.c_str());
+	instance->tryChars = s_readTryChars(aff, instance->hunspell->get_dic_encoding());
+	g_mutex_init(&instance->lock);
+	instance->refs = 1;
+	return instance;
+}
+
+static void
+s_freeInstance(HunspellInstance *instance)
+{
+	delete instance->hunspell;
+	g_mutex_clear(&instance->lock);
+	delete instance;
+}
+
+// Returns the instance loaded from aff and dic already if there is one,
+// else loads them; one that is not to be shared is always loaded
+static HunspellInstance *
+s_acquireInstance(const std::string & aff, const std::string & dic, bool shared)
+{
+	std::string key = shared ? s_instanceKey(aff, dic) : std::string();
+	if (key.empty())
+		return s_newInstance(aff, dic);
+
+	g_mutex_lock(&s_instances_lock);
+	auto found = s_instances.find(key);
+	if (found != s_instances.end()) {
+		found->second->refs++;
+		g_mutex_unlock(&s_instances_lock);
+		return found->second;
+	}
+	g_mutex_unlock(&s_instances_lock);
+
+	// loaded without holding up the other brokers, one of which may load
+	// the same files meanwhile
+	HunspellInstance *instance = s_newInstance(aff, dic);
+
+	g_mutex_lock(&s_instances_lock);
+	found = s_instances.find(key);
+	if (found != s_instances.end()) {
+		found->second->refs++;
+		g_mutex_unlock(&s_instances_lock);
+		s_freeInstance(instance);
+		return found->second;
+	}
+	instance->key = key;
+	s_instances[key] = instance;
+	g_mutex_unlock(&s_instances_lock);
+	return instance;
+}
+
+static void
+s_releaseInstance(HunspellInstance *instance)
+{
+	if (instance->key.empty()) {
+		s_freeInstance(instance);
+		return;
+	}
+
+	g_mutex_lock(&s_instances_lock);
+	bool last = --instance->refs == 0;
+	if (last)
+		s_instances.erase(instance->key);
+	g_mutex_unlock(&s_instances_lock);
+
+	if (last)
+		s_freeInstance(instance);
+}
+
 static bool
 g_iconv_is_valid(GIConv i)
 {
 	return (i != nullptr);
 }
 
+static bool
+s_isAscii(const char *utf8Word, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		if (static_cast<unsigned char>(utf8Word[i]) & 0x80)
+			return false;
+	return true;
+}
+
+// Whether utf8Word is sure to be in NFC already, for the most part without
+// looking anything up: a word that is not, or might not be, is normalized
+static bool
+s_isNfc(const char *utf8Word, size_t len)
+{
+	gunichar prev = 0;
+	for (const char *p = utf8Word; p < utf8Word + len; p = g_utf8_next_char(p)) {
+		if (!(static_cast<unsigned char>(*p) & 0x80)) {
+			prev = static_cast<unsigned char>(*p);
+			continue;
+		}
+
+		gunichar uc = g_utf8_get_char(p);
+		gunichar a, b, composed;
+		if (g_unichar_combining_class(uc) != 0)
+			return false;
+		// singletons and composition exclusions decompose in NFC
+		if (g_unichar_decompose(uc, &a, &b) &&
+		    (b == 0 || !g_unichar_compose(a, b, &composed) || composed != uc))
+			return false;
+		// and a character may combine with the one before it
+		if (prev && g_unichar_compose(prev, uc, &composed))
+			return false;
+		prev = uc;
+	}
+	return true;
+}
+
+// Copies the len bytes of utf8Word into word, which has room for
+// MAXWORDLEN of them, in NFC and terminated
+static bool
+s_fillUtf8Word(char *word, const char *utf8Word, size_t len)
+{
+	if (s_isNfc(utf8Word, len)) {
+		memcpy(word, utf8Word, len);
+		word[len] = '\0';
+		return true;
+	}
+
+	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
+	size_t normalizedLen = normalizedWord ? strlen(normalizedWord) : 0;
+	bool fits = normalizedWord && normalizedLen <= MAXWORDLEN;
+	if (fits)
+		memcpy(word, normalizedWord, normalizedLen + 1);
+	g_free(normalizedWord);
+	return fits;
+}
+
 HunspellChecker::HunspellChecker()
-: m_translate_in(nullptr), m_translate_out(nullptr), hunspell(nullptr)
+: m_profile(SUGGEST_BALANCED), m_translate_in(nullptr), m_translate_out(nullptr), m_utf8(false),
+  m_instance(nullptr)
 {
 }
 
 HunspellChecker::~HunspellChecker()
 {
-	delete hunspell;
+	if (m_instance)
+		s_releaseInstance(m_instance);
 	if (g_iconv_is_valid (m_translate_in))
 		g_iconv_close(m_translate_in);
 	if (g_iconv_is_valid(m_translate_out))
@@ -99,41 +320,59 @@ HunspellChecker::~HunspellChecker()
 bool
 HunspellChecker::checkWord(const char *utf8Word, size_t len)
 {
+	if (m_utf8)
+		return checkWordUtf8(utf8Word, len);
+
 	if (len > MAXWORDLEN || !g_iconv_is_valid(m_translate_in))
 		return false;
 
-	// the 8bit encodings use precomposed forms
-	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
-	char *in = normalizedWord;
+	// the 8bit encodings use precomposed forms, which ASCII is already
+	char *normalizedWord = s_isAscii(utf8Word, len) ? nullptr : g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
+	char *in = normalizedWord ? normalizedWord : const_cast<char *>(utf8Word);
 	char word8[MAXWORDLEN + 1];
 	char *out = word8;
-	size_t len_in = strlen(in);
+	size_t len_in = normalizedWord ? strlen(in) : len;
 	size_t len_out = sizeof( word8 ) - 1;
 	size_t result = g_iconv(m_translate_in, &in, &len_in, &out, &len_out);
 	g_free(normalizedWord);
 	if (static_cast<size_t>(-1) == result)
 		return false;
 	*out = '\0';
-	if (hunspell->spell(word8))
+	if (spell(word8))
 		return true;
 	else
 		return false;
 }
 
+bool
+HunspellChecker::checkWordUtf8(const char *utf8Word, size_t len)
+{
+	if (len > MAXWORDLEN)
+		return false;
+
+	char word[MAXWORDLEN + 1];
+	if (!s_fillUtf8Word(word, utf8Word, len))
+		return false;
+	return spell(word);
+}
+
 char**
 HunspellChecker::suggestWord(const char* const utf8Word, size_t len, size_t *nsug)
 {
+	if (m_utf8)
+		return suggestWordUtf8(utf8Word, len, nsug);
+
 	if (len > MAXWORDLEN 
 		|| !g_iconv_is_valid(m_translate_in)
 		|| !g_iconv_is_valid(m_translate_out))
 		return nullptr;
 
-	// the 8bit encodings use precomposed forms
-	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
-	char *in = normalizedWord;
+	// the 8bit encodings use precomposed forms, which ASCII is already
+	char *normalizedWord = s_isAscii(utf8Word, len) ? nullptr : g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
+	char *in = normalizedWord ? normalizedWord : const_cast<char *>(utf8Word);
 	char word8[MAXWORDLEN + 1];
 	char *out = word8;
-	size_t len_in = strlen(in);
+	size_t len_in = normalizedWord ? strlen(in) : len;
 	size_t len_out = sizeof(word8) - 1;
 	size_t result = g_iconv(m_translate_in, &in, &len_in, &out, &len_out);
 	g_free(normalizedWord);
@@ -142,14 +381,15 @@ HunspellChecker::suggestWord(const char* const utf8Word, size_t len, size_t *nsu
 
 	*out = '\0';
 	char **sugMS;
-	*nsug = hunspell->suggest(&sugMS, word8);
+	*nsug = suggest(&sugMS, word8);
 	if (*nsug > 0) {
 		char **sug = g_new0 (char *, *nsug + 1);
+		// converted on the stack, so that each suggestion takes only its own length
+		char word[MAXWORDLEN + 1];
 		for (size_t i=0; i<*nsug; i++) {
 			in = sugMS[i];
 			len_in = strlen(in);
 			len_out = MAXWORDLEN;
-			char *word = g_new0(char, len_out + 1);
 			out = word;
 			if (static_cast<size_t>(-1) == g_iconv(m_translate_out, &in, &len_in, &out, &len_out)) {
 				for (size_t j = i; j < *nsug; j++)
@@ -159,8 +399,7 @@ HunspellChecker::suggestWord(const char* const utf8Word, size_t len, size_t *nsu
 				*nsug = i;
 				return sug;
 			}
-			*(out) = 0;
-			sug[i] = word;
+			sug[i] = g_strndup(word, out - word);
 			free(sugMS[i]);
 		}
 		free(sugMS);
@@ -170,10 +409,147 @@ HunspellChecker::suggestWord(const char* const utf8Word, size_t len, size_t *nsu
 		return nullptr;
 }
 
+// The suggestions hunspell makes for a UTF-8 dictionary are handed on as
+// they are, as g_malloc and malloc are one and the same
+char**
+HunspellChecker::suggestWordUtf8(const char* const utf8Word, size_t len, size_t *nsug)
+{
+	if (len > MAXWORDLEN)
+		return nullptr;
+
+	char word[MAXWORDLEN + 1];
+	if (!s_fillUtf8Word(word, utf8Word, len))
+		return nullptr;
+
+	char **sugMS;
+	int n = suggest(&sugMS, word);
+	if (n <= 0)
+		return nullptr;
+
+	char **sug = static_cast<char **>(realloc(sugMS, (n + 1) * sizeof(char *)));
+	if (!sug) {
+		m_instance->hunspell->free_list(&sugMS, n);
+		return nullptr;
+	}
+	sug[n] = nullptr;
+	*nsug = n;
+	return sug;
+}
+
+// Suggests the words one edit away, swapping, dropping, replacing or
+// inserting a character, as far as deadline (-1 for none) allows: the
+// cheapest of what hunspell itself would try
+char**
+HunspellChecker::suggestNearby(const char* const utf8Word, size_t len, size_t max_suggs,
+			       gint64 deadline, size_t *nsug)
+{
+	glong n;
+	gunichar *chars = g_utf8_to_ucs4_fast(utf8Word, len, &n);
+	const std::vector<gunichar> & tryChars = m_instance->tryChars;
+
+	std::vector<std::string> found;
+	std::set<std::string> tried;
+	tried.insert(std::string(utf8Word, len));
+	std::vector<gunichar> candidate;
+	auto tryCandidate = [&] () {
+		if (deadline >= 0 && g_get_monotonic_time() >= deadline)
+			return false;
+		glong bytes;
+		char *word = g_ucs4_to_utf8(candidate.data(), candidate.size(), nullptr, &bytes, nullptr);
+		if (word && bytes > 0 && tried.insert(word).second && checkWord(word, bytes))
+			found.push_back(word);
+		g_free(word);
+		return max_suggs == 0 || found.size() < max_suggs;
+	};
+
+	bool more = true;
+	for (glong i = 0; more && i + 1 < n; i++) {
+		candidate.assign(chars, chars + n);
+		std::swap(candidate[i], candidate[i + 1]);
+		more = tryCandidate();
+	}
+	for (glong i = 0; more && i < n && n > 1; i++) {
+		candidate.assign(chars, chars + n);
+		candidate.erase(candidate.begin() + i);
+		more = tryCandidate();
+	}
+	for (glong i = 0; more && i < n; i++) {
+		for (size_t j = 0; more && j < tryChars.size(); j++) {
+			if (tryChars[j] == chars[i])
+				continue;
+			candidate.assign(chars, chars + n);
+			candidate[i] = tryChars[j];
+			more = tryCandidate();
+		}
+	}
+	for (glong i = 0; more && i <= n; i++) {
+		for (size_t j = 0; more && j < tryChars.size(); j++) {
+			candidate.assign(chars, chars + n);
+			candidate.insert(candidate.begin() + i, tryChars[j]);
+			more = tryCandidate();
+		}
+	}
+	g_free(chars);
+
+	*nsug = found.size();
+	if (found.empty())
+		return nullptr;
+	char **sug = g_new0 (char *, found.size() + 1);
+	for (size_t i = 0; i < found.size(); i++)
+		sug[i] = g_strdup(found[i].c_str());
+	return sug;
+}
+
+// What hunspell suggests, followed by the words one edit away it left out:
+// its n-gram and phonetic suggestions can crowd those out of its list
+char**
+HunspellChecker::suggestThorough(const char* const utf8Word, size_t len, size_t *nsug)
+{
+	size_t n_suggs = 0, n_nearby = 0;
+	char **suggs = suggestWord(utf8Word, len, &n_suggs);
+	char **nearby = suggestNearby(utf8Word, len, 0, -1, &n_nearby);
+	if (!suggs) {
+		*nsug = n_nearby;
+		return nearby;
+	}
+
+	std::set<std::string> seen(suggs, suggs + n_suggs);
+	suggs = g_renew(char *, suggs, n_suggs + n_nearby + 1);
+	for (size_t i = 0; i < n_nearby; i++) {
+		if (seen.insert(nearby[i]).second)
+			suggs[n_suggs++] = nearby[i];
+		else
+			g_free(nearby[i]);
+	}
+	suggs[n_suggs] = nullptr;
+	g_free(nearby);
+
+	*nsug = n_suggs;
+	return suggs;
+}
+
 const char*
 HunspellChecker::getWordchars()
 {
-	return hunspell->get_wordchars();
+	return m_instance->hunspell->get_wordchars();
+}
+
+bool
+HunspellChecker::spell(const char *word)
+{
+	g_mutex_lock(&m_instance->lock);
+	bool correct = m_instance->hunspell->spell(word);
+	g_mutex_unlock(&m_instance->lock);
+	return correct;
+}
+
+int
+HunspellChecker::suggest(char ***slst, const char *word)
+{
+	g_mutex_lock(&m_instance->lock);
+	int n = m_instance->hunspell->suggest(slst, word);
+	g_mutex_unlock(&m_instance->lock);
+	return n;
 }
 
 static void
@@ -211,25 +587,6 @@ s_buildDictionaryDirs (std::vector<std::string> & dirs)
 #endif
 }
 
-static void
-s_buildHashNames (std::vector<std::string> & names, const char * dict)
-{
-	names.clear ();
-
-	std::vector<std::string> dirs;
-	s_buildDictionaryDirs (dirs);
-
-	char *dict_dic = g_strconcat(dict, ".dic", nullptr);
-	for (size_t i = 0; i < dirs.size(); i++)
-		{
-			char *tmp = g_build_filename (dirs[i].c_str(), dict_dic, nullptr);
-			names.push_back (tmp);
-			g_free (tmp);
-		}
-
-	g_free(dict_dic);
-}
-
 static const std::string
 s_correspondingAffFile(const std::string & dicFile)
 {
@@ -244,86 +601,47 @@ s_fileExists(const std::string & file)
 	return g_file_test(file.c_str(), G_FILE_TEST_EXISTS) != 0;
 }
 
-static bool is_plausible_dict_for_tag(const char *dir_entry, const char *tag)
-{
-    const char *dic_suffix = ".dic";
-    size_t dic_suffix_len = strlen(dic_suffix);
-    size_t dir_entry_len = strlen(dir_entry);
-    size_t tag_len = strlen(tag);
-
-    if (dir_entry_len - dic_suffix_len < tag_len)
-        return false;
-    if (strcmp(dir_entry+dir_entry_len-dic_suffix_len, dic_suffix) != 0)
-        return false;
-    if (strncmp (dir_entry, tag, tag_len) != 0)
-        return false;
-    //e.g. requested dict for "fi",
-    //reject "fil_PH.dic"
-    //allow "fi-FOO.dic", "fi_FOO.dic", "fi.dic", etc.
-    if (!ispunct(dir_entry[tag_len]))
-        return false;
-    return true;
-}
+/***************************************************************************/
 
-static char *
-hunspell_request_dictionary (const char * tag)
+// Brings the provider's index up to date with the directories searched now
+static DictIndex &
+s_currentIndex(EnchantProvider * me)
 {
-	std::vector<std::string> names;
-
-	s_buildHashNames (names, tag);
-
-	for (size_t i = 0; i < names.size (); i++) {
-		if (g_file_test(names[i].c_str(), G_FILE_TEST_EXISTS) &&
-		    s_fileExists(s_correspondingAffFile(names[i]))) {
-			return strdup (names[i].c_str());
-		}
-	}
-	
 	std::vector<std::string> dirs;
 	s_buildDictionaryDirs (dirs);
+	return s_updateIndex(*static_cast<DictIndex *>(me->user_data), dirs);
+}
 
-	for (size_t i = 0; i < dirs.size(); i++) {
-		GDir *dir = g_dir_open (dirs[i].c_str(), 0, nullptr);
-		if (dir) {
-			const char *dir_entry;
-			while ((dir_entry = g_dir_read_name (dir)) != NULL) {
-				if (is_plausible_dict_for_tag(dir_entry, tag)) {
-					char *dict = g_build_filename (dirs[i].c_str(), 
-								       dir_entry, nullptr);
-					if(s_fileExists(s_correspondingAffFile(dict))) {
-						g_dir_close (dir);
-						return dict;
-					}
-					g_free(dict);
-				}
-			}
-
-			g_dir_close (dir);
-		}
-	}
+bool
+HunspellChecker::requestDictionary(const std::string & dic)
+{
+	std::string aff(s_correspondingAffFile(dic));
+	if (!s_fileExists(aff))
+		return false;
 
-	return NULL;
+	return loadDictionary(aff, dic, true);
 }
 
+// Hunspell keeps no tables that two instances could share, so a clone
+// loads the files the original was loaded from, without looking for them,
+// into an instance of its own
 bool
-HunspellChecker::requestDictionary(const char *szLang)
+HunspellChecker::cloneDictionary(const HunspellChecker & other)
 {
-	char *dic = hunspell_request_dictionary (szLang);
-	if (!dic)
-		return false;
+	m_profile = other.m_profile;
+	return loadDictionary(other.m_aff, other.m_dic, false);
+}
 
-	std::string aff(s_correspondingAffFile(dic));
-	if (s_fileExists(aff))
-	{
-		if (hunspell)
-			delete hunspell;
-		hunspell = new Hunspell(aff.c_str(), dic);
-	}
-	free(dic);
-	if(hunspell == NULL){
-		return false;
-	}
-	const char *enc = hunspell->get_dic_encoding();
+bool
+HunspellChecker::loadDictionary(const std::string & aff, const std::string & dic, bool shared)
+{
+	if (m_instance)
+		s_releaseInstance(m_instance);
+	m_instance = s_acquireInstance(aff, dic, shared);
+	m_aff = aff;
+	m_dic = dic;
+	const char *enc = m_instance->hunspell->get_dic_encoding();
+	m_utf8 = g_ascii_strcasecmp(enc, "UTF-8") == 0 || g_ascii_strcasecmp(enc, "UTF8") == 0;
 
 	m_translate_in = g_iconv_open(enc, "UTF-8");
 	m_translate_out = g_iconv_open("UTF-8", enc);
@@ -340,7 +658,48 @@ hunspell_dict_suggest (EnchantDict * me, const char *const word,
 		     size_t len, size_t * out_n_suggs)
 {
 	HunspellChecker * checker = static_cast<HunspellChecker *>(me->user_data);
-	return checker->suggestWord (word, len, out_n_suggs);
+	switch (checker->m_profile) {
+	case SUGGEST_FAST:
+		return checker->suggestNearby (word, len, 0, -1, out_n_suggs);
+	case SUGGEST_THOROUGH:
+		return checker->suggestThorough (word, len, out_n_suggs);
+	default:
+		return checker->suggestWord (word, len, out_n_suggs);
+	}
+}
+
+// Longer words, compounds for the most part, can keep hunspell's full
+// search busy for seconds
+#define MAX_FULL_SUGGEST_CHARS 24
+
+static char **
+hunspell_dict_suggest_bounded (EnchantDict * me, const char *const word,
+			       size_t len, size_t max_suggs,
+			       int max_distance _GL_UNUSED_PARAMETER, int timeout_ms,
+			       size_t * out_n_suggs)
+{
+	HunspellChecker * checker = static_cast<HunspellChecker *>(me->user_data);
+	gint64 deadline = timeout_ms < 0 ? -1 :
+		g_get_monotonic_time() + timeout_ms * G_TIME_SPAN_MILLISECOND;
+
+	// what the fast profile asks for is not partial, unless time ran out
+	if (checker->m_profile == SUGGEST_FAST) {
+		char **suggs = checker->suggestNearby (word, len, max_suggs, deadline, out_n_suggs);
+		if (deadline >= 0 && g_get_monotonic_time() >= deadline)
+			enchant_dict_set_suggest_partial (me);
+		return suggs;
+	}
+
+	// hunspell cannot be made to give up on a word, and it may well take
+	// longer than a time budget allows, so within one, or for a long word
+	// unless the search is to be thorough, only the words one edit away
+	// are looked for
+	if (timeout_ms >= 0 ||
+	    (checker->m_profile != SUGGEST_THOROUGH && g_utf8_strlen(word, len) > MAX_FULL_SUGGEST_CHARS)) {
+		enchant_dict_set_suggest_partial (me);
+		return checker->suggestNearby (word, len, max_suggs, deadline, out_n_suggs);
+	}
+	return hunspell_dict_suggest (me, word, len, out_n_suggs);
 }
 
 static int
@@ -354,6 +713,32 @@ hunspell_dict_check (EnchantDict * me, const char *const word, size_t len)
 	return 1;
 }
 
+static void
+hunspell_dict_check_batch (EnchantDict * me, const char *const *words, const size_t *lens,
+			   size_t n, int *results)
+{
+	HunspellChecker * checker = static_cast<HunspellChecker *>(me->user_data);
+
+	for (size_t i = 0; i < n; i++)
+		results[i] = checker->checkWord(words[i], lens[i]) ? 0 : 1;
+}
+
+static int
+hunspell_dict_set_suggest_profile (EnchantDict * me, const char *const profile)
+{
+	HunspellChecker * checker = static_cast<HunspellChecker *>(me->user_data);
+
+	if (strcmp (profile, "fast") == 0)
+		checker->m_profile = SUGGEST_FAST;
+	else if (strcmp (profile, "balanced") == 0)
+		checker->m_profile = SUGGEST_BALANCED;
+	else if (strcmp (profile, "thorough") == 0)
+		checker->m_profile = SUGGEST_THOROUGH;
+	else
+		return -1;
+	return 0;
+}
+
 static const char*
 hunspell_dict_get_extra_word_characters (EnchantDict *me)
 {
@@ -369,55 +754,30 @@ hunspell_dict_is_word_character (EnchantDict *me, uint32_t uc, size_t n)
 	return g_unichar_isalpha(uc) || g_utf8_strchr(checker->getWordchars(), -1, uc);
 }
 
-static void
-hunspell_provider_enum_dicts (const char * const directory,
-			     std::vector<std::string> & out_dicts)
-{
-	GDir * dir = g_dir_open (directory, 0, nullptr);
-	if (dir) {
-		const char * entry;
-		while ((entry = g_dir_read_name (dir)) != NULL) {
-			char * utf8_entry = g_filename_to_utf8 (entry, -1, nullptr, nullptr, nullptr);
-			if (utf8_entry) {
-				std::string dir_entry (utf8_entry);
-				g_free (utf8_entry);
-
-				int hit = dir_entry.rfind (".dic");
-				if (hit != -1) {
-					/* don't include hyphenation dictionaries
-					   and require .aff file to be present*/
-					if(dir_entry.compare (0, 5, "hyph_") != 0)
-					{
-						char * dic = g_build_filename(directory, dir_entry.c_str(), nullptr);
-						if (s_fileExists(s_correspondingAffFile(dic)))
-						{
-							out_dicts.push_back (dir_entry.substr (0, hit));
-						}
-						g_free(dic);
-					}
-				}
-			}
-		}
-
-		g_dir_close (dir);
-	}
-}
-
 extern "C" {
 
 static char ** 
-hunspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER, 
+hunspell_provider_list_dicts (EnchantProvider * me, 
 			      size_t * out_n_dicts)
 {
-	std::vector<std::string> dict_dirs, dicts;
+	std::vector<std::string> dicts;
 	char ** dictionary_list = NULL;
 
-	s_buildDictionaryDirs (dict_dirs);
-
-	for (size_t i = 0; i < dict_dirs.size(); i++)
-		{
-			hunspell_provider_enum_dicts (dict_dirs[i].c_str(), dicts);
-		}
+	const DictIndex & index = s_currentIndex(me);
+	for (size_t i = 0; i < index.size(); i++)
+		for (size_t j = 0; j < index[i].dics.size(); j++)
+			{
+				const std::string & dir_entry = index[i].dics[j];
+				/* don't include hyphenation dictionaries */
+				if (dir_entry.compare (0, 5, "hyph_") == 0)
+					continue;
+
+				char * utf8_entry = g_filename_to_utf8 (dir_entry.c_str(), -1, nullptr, nullptr, nullptr);
+				if (utf8_entry) {
+					dicts.push_back (std::string (utf8_entry, strlen (utf8_entry) - 4));
+					g_free (utf8_entry);
+				}
+			}
 
 	if (dicts.size () > 0) {
 		dictionary_list = g_new0 (char *, dicts.size() + 1);
@@ -430,23 +790,31 @@ hunspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
 	return dictionary_list;
 }
 
+static char **
+hunspell_provider_list_dict_dirs (EnchantProvider * me _GL_UNUSED_PARAMETER,
+				  size_t * out_n_dirs)
+{
+	std::vector<std::string> dict_dirs;
+	s_buildDictionaryDirs (dict_dirs);
+
+	char ** dir_list = g_new0 (char *, dict_dirs.size() + 1);
+	for (size_t i = 0; i < dict_dirs.size(); i++)
+		dir_list[i] = g_strdup (dict_dirs[i].c_str());
+
+	*out_n_dirs = dict_dirs.size ();
+	return dir_list;
+}
+
 static EnchantDict *
-hunspell_provider_request_dict(EnchantProvider * me _GL_UNUSED_PARAMETER, const char *const tag)
+hunspell_dict_new (HunspellChecker * checker)
 {
-	HunspellChecker * checker = new HunspellChecker();
-	
-	if (!checker)
-		return NULL;
-	
-	if (!checker->requestDictionary(tag)) {
-		delete checker;
-		return NULL;
-	}
-	
 	EnchantDict *dict = g_new0(EnchantDict, 1);
 	dict->user_data = (void *) checker;
 	dict->check = hunspell_dict_check;
+	dict->check_batch = hunspell_dict_check_batch;
 	dict->suggest = hunspell_dict_suggest;
+	dict->suggest_bounded = hunspell_dict_suggest_bounded;
+	dict->set_suggest_profile = hunspell_dict_set_suggest_profile;
 	// don't implement personal, session
 	dict->get_extra_word_characters = hunspell_dict_get_extra_word_characters;
 	dict->is_word_character = hunspell_dict_is_word_character;
@@ -454,6 +822,40 @@ hunspell_provider_request_dict(EnchantProvider * me _GL_UNUSED_PARAMETER, const
 	return dict;
 }
 
+static EnchantDict *
+hunspell_provider_request_dict(EnchantProvider * me, const char *const tag)
+{
+	std::string dic = s_findDictionary(s_currentIndex(me), tag);
+	if (dic.empty())
+		return NULL;
+
+	HunspellChecker * checker = new HunspellChecker();
+	
+	if (!checker)
+		return NULL;
+	
+	if (!checker->requestDictionary(dic)) {
+		delete checker;
+		return NULL;
+	}
+	
+	return hunspell_dict_new(checker);
+}
+
+static EnchantDict *
+hunspell_provider_clone_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, EnchantDict * dict)
+{
+	const HunspellChecker * original = static_cast<const HunspellChecker *>(dict->user_data);
+	HunspellChecker * checker = new HunspellChecker();
+
+	if (!checker->cloneDictionary(*original)) {
+		delete checker;
+		return NULL;
+	}
+
+	return hunspell_dict_new(checker);
+}
+
 static void
 hunspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, EnchantDict * dict)
 {
@@ -464,25 +866,16 @@ hunspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, Encha
 }
 
 static int
-hunspell_provider_dictionary_exists (struct str_enchant_provider * me _GL_UNUSED_PARAMETER,
+hunspell_provider_dictionary_exists (struct str_enchant_provider * me,
 				     const char *const tag)
 {
-	std::vector <std::string> names;
-	s_buildHashNames (names, tag);
-	for (size_t i = 0; i < names.size(); i++) {
-		if (g_file_test (names[i].c_str(), G_FILE_TEST_EXISTS) &&
-		    s_fileExists(s_correspondingAffFile(names[i])))
-		{
-			return 1;
-		}
-	}
-
-	return 0;
+	return !s_findExactDictionary(s_currentIndex(me), tag).empty();
 }
 
 static void
 hunspell_provider_dispose (EnchantProvider * me)
 {
+	delete static_cast<DictIndex *>(me->user_data);
 	g_free (me);
 }
 
@@ -501,10 +894,20 @@ hunspell_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 ENCHANT_MODULE_EXPORT
 EnchantProvider *init_enchant_provider (void);
 
+ENCHANT_MODULE_EXPORT
+unsigned int enchant_provider_abi_version (void);
+
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider (void)
 {
 	EnchantProvider *provider = g_new0(EnchantProvider, 1);
+	provider->user_data = new DictIndex();
 	provider->dispose = hunspell_provider_dispose;
 	provider->request_dict = hunspell_provider_request_dict;
 	provider->dispose_dict = hunspell_provider_dispose_dict;
@@ -512,6 +915,8 @@ init_enchant_provider (void)
 	provider->identify = hunspell_provider_identify;
 	provider->describe = hunspell_provider_describe;
 	provider->list_dicts = hunspell_provider_list_dicts;
+	provider->list_dict_dirs = hunspell_provider_list_dict_dirs;
+	provider->clone_dict = hunspell_provider_clone_dict;
 
 	return provider;
 }
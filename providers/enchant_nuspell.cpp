@@ -44,11 +44,13 @@
 
 #include "enchant-provider.h"
 #include "unused-parameter.h"
+#include "dict_index.h"
 
 #include <nuspell/dictionary.hxx>
 #include <nuspell/finder.hxx>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 using namespace std;
 using namespace nuspell;
@@ -61,7 +63,7 @@ public:
 	bool checkWord (const char *word, size_t len);
 	char **suggestWord (const char* const word, size_t len, size_t *out_n_suggs);
 
-	bool requestDictionary (const char * szLang);
+	bool requestDictionary (const string & dic);
 
 private:
 	Dictionary nuspell;
@@ -69,33 +71,51 @@ private:
 
 /***************************************************************************/
 
+// Scratch space each thread keeps between calls, so that a word and its
+// suggestions cost no allocations of their own once it has grown
+static thread_local string s_word;
+static thread_local vector<string> s_suggestions;
+
+// Puts the word into s_word, in NFC, as the 8-bit encodings use
+// precomposed forms; ASCII is in NFC already
+static const string &
+s_normalizedWord(const char *utf8Word, size_t len)
+{
+	bool ascii = true;
+	for (size_t i = 0; i < len && ascii; i++)
+		ascii = !(static_cast<unsigned char>(utf8Word[i]) & 0x80);
+
+	if (ascii) {
+		s_word.assign(utf8Word, len);
+	} else {
+		char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
+		s_word.assign(normalizedWord ? normalizedWord : "");
+		g_free(normalizedWord);
+	}
+	return s_word;
+}
+
 bool
 NuspellChecker::checkWord(const char *utf8Word, size_t len)
 {
-	// the 8-bit encodings use precomposed forms
-	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
-
-	return nuspell.spell(string(normalizedWord));
+	return nuspell.spell(s_normalizedWord(utf8Word, len));
 }
 
 char**
 NuspellChecker::suggestWord(const char* const utf8Word, size_t len, size_t *nsug)
 {
-	// the 8-bit encodings use precomposed forms
-	char *normalizedWord = g_utf8_normalize (utf8Word, len, G_NORMALIZE_NFC);
-	auto suggestions = vector<string>();
-	nuspell.suggest(string(normalizedWord), suggestions);
-	if (suggestions.empty())
+	s_suggestions.clear();
+	nuspell.suggest(s_normalizedWord(utf8Word, len), s_suggestions);
+	if (s_suggestions.empty())
 		return nullptr;
-	*nsug = suggestions.size();
-	char **sug = g_new0 (char *, *nsug + 1);
-	size_t i = 0;
-	for (auto& suggest : suggestions) {
-		char *word = g_new0(char, suggest.size() + 1);
-		strcpy(word, suggest.c_str());
-		sug[i] = word;
-		i++;
-	}
+
+	// each suggestion is copied once, out of the per-thread vector that
+	// the next call reuses
+	*nsug = s_suggestions.size();
+	char **sug = g_new (char *, *nsug + 1);
+	for (size_t i = 0; i < *nsug; i++)
+		sug[i] = g_strndup(s_suggestions[i].data(), s_suggestions[i].size());
+	sug[*nsug] = nullptr;
 	return sug;
 }
 
@@ -148,24 +168,6 @@ s_buildDictionaryDirs (vector<string> & dirs)
 	 */
 }
 
-static void
-s_buildHashNames (vector<string> & names, const char * dict)
-{
-	names.clear ();
-
-	vector<string> dirs;
-	s_buildDictionaryDirs (dirs);
-
-	char *dict_dic = g_strconcat(dict, ".dic", nullptr);
-	for (size_t i = 0; i < dirs.size(); i++) {
-		char *tmp = g_build_filename (dirs[i].c_str(), dict_dic, nullptr);
-		names.push_back (tmp);
-		g_free (tmp);
-	}
-
-	g_free(dict_dic);
-}
-
 static const string
 s_correspondingAffFile(const string & dicFile)
 {
@@ -183,77 +185,28 @@ s_fileExists(const string & file)
 	return g_file_test(file.c_str(), G_FILE_TEST_EXISTS) != 0;
 }
 
-static bool is_plausible_dict_for_tag(const char *dir_entry, const char *tag)
-{
-	const char *dic_suffix = ".dic";
-	size_t dic_suffix_len = strlen(dic_suffix);
-	size_t dir_entry_len = strlen(dir_entry);
-	size_t tag_len = strlen(tag);
+/***************************************************************************/
 
-	if (dir_entry_len - dic_suffix_len < tag_len)
-		return false;
-	if (strcmp(dir_entry + dir_entry_len - dic_suffix_len, dic_suffix) != 0)
-		return false;
-	if (strncmp (dir_entry, tag, tag_len) != 0)
-		return false;
-	//e.g. requested dict for "fi",
-	//reject "fil_PH.dic"
-	//allow "fi-FOO.dic", "fi_FOO.dic", "fi.dic", etc.
-	if (!ispunct(dir_entry[tag_len]))
-		return false;
-	return true;
-}
+// the provider's index is used under this lock, as its calls may come
+// from several threads at once
+static GMutex s_index_lock;
 
-static char *
-nuspell_request_dictionary (const char * tag)
+// Brings the provider's index up to date with the directories searched now
+static DictIndex &
+s_currentIndex(EnchantProvider * me)
 {
-	vector<string> names;
-
-	s_buildHashNames (names, tag);
-
-	for (size_t i = 0; i < names.size (); i++) {
-		if (g_file_test(names[i].c_str(), G_FILE_TEST_EXISTS) &&
-		    s_fileExists(s_correspondingAffFile(names[i]))) {
-			return strdup (names[i].c_str());
-		}
-	}
-
 	vector<string> dirs;
 	s_buildDictionaryDirs (dirs);
-
-	for (size_t i = 0; i < dirs.size(); i++) {
-		GDir *dir = g_dir_open (dirs[i].c_str(), 0, nullptr);
-		if (dir) {
-			const char *dir_entry;
-			while ((dir_entry = g_dir_read_name (dir)) != NULL) {
-				if (is_plausible_dict_for_tag(dir_entry, tag)) {
-					char *dict = g_build_filename (dirs[i].c_str(),
-								       dir_entry, nullptr);
-					if(s_fileExists(s_correspondingAffFile(dict))) {
-						g_dir_close (dir);
-						return dict;
-					}
-					g_free(dict);
-				}
-			}
-
-			g_dir_close (dir);
-		}
-	}
-
-	return NULL;
+	return s_updateIndex(*static_cast<DictIndex *>(me->user_data), dirs);
 }
 
 bool
-NuspellChecker::requestDictionary(const char *szLang)
+NuspellChecker::requestDictionary(const string & dic)
 {
-	char *dic = nuspell_request_dictionary (szLang);
-	if (!dic)
-		return false;
 	string aff(s_correspondingAffFile(dic));
 	if (!s_fileExists(aff))
 		return false;
-	auto path = string(dic);
+	auto path = dic;
 	if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".dic") == 0)
 		path.erase(path.size() - 4);
 	else
@@ -294,52 +247,32 @@ nuspell_dict_is_word_character (EnchantDict * me _GL_UNUSED_PARAMETER,
 	return g_unichar_isalpha(uc);
 }
 
-static void
-nuspell_provider_enum_dicts (const char * const directory,
-			     vector<string> & out_dicts)
-{
-	GDir * dir = g_dir_open (directory, 0, nullptr);
-	if (dir) {
-		const char * entry;
-		while ((entry = g_dir_read_name (dir)) != NULL) {
-			char * utf8_entry = g_filename_to_utf8 (entry, -1, nullptr, nullptr, nullptr);
-			if (utf8_entry) {
-				string dir_entry (utf8_entry);
-				g_free (utf8_entry);
-
-				int hit = dir_entry.rfind (".dic");
-				// don't include hyphenation dictionaries
-				if (hit != -1) {
-					// require .aff file to be present
-					if(dir_entry.compare (0, 5, "hyph_") != 0) {
-						char * dic = g_build_filename(directory, dir_entry.c_str(), nullptr);
-						if (s_fileExists(s_correspondingAffFile(dic))) {
-							out_dicts.push_back (dir_entry.substr (0, hit));
-						}
-						g_free(dic);
-					}
-				}
-			}
-		}
-
-		g_dir_close (dir);
-	}
-}
-
 extern "C" {
 
 static char **
-nuspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
+nuspell_provider_list_dicts (EnchantProvider * me,
 			     size_t * out_n_dicts)
 {
-	vector<string> dict_dirs, dicts;
+	vector<string> dicts;
 	char ** dictionary_list = NULL;
 
-	s_buildDictionaryDirs (dict_dirs);
+	g_mutex_lock (&s_index_lock);
+	const DictIndex & index = s_currentIndex(me);
+	for (size_t i = 0; i < index.size(); i++) {
+		for (size_t j = 0; j < index[i].dics.size(); j++) {
+			const string & dir_entry = index[i].dics[j];
+			// don't include hyphenation dictionaries
+			if (dir_entry.compare (0, 5, "hyph_") == 0)
+				continue;
 
-	for (size_t i = 0; i < dict_dirs.size(); i++) {
-		nuspell_provider_enum_dicts (dict_dirs[i].c_str(), dicts);
+			char * utf8_entry = g_filename_to_utf8 (dir_entry.c_str(), -1, nullptr, nullptr, nullptr);
+			if (utf8_entry) {
+				dicts.push_back (string (utf8_entry, strlen (utf8_entry) - 4));
+				g_free (utf8_entry);
+			}
+		}
 	}
+	g_mutex_unlock (&s_index_lock);
 
 	if (dicts.size () > 0) {
 		dictionary_list = g_new0 (char *, dicts.size() + 1);
@@ -352,19 +285,24 @@ nuspell_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
 	return dictionary_list;
 }
 
-static EnchantDict *
-nuspell_provider_request_dict(EnchantProvider * me _GL_UNUSED_PARAMETER, const char *const tag)
+static char **
+nuspell_provider_list_dict_dirs (EnchantProvider * me _GL_UNUSED_PARAMETER,
+				 size_t * out_n_dirs)
 {
-	NuspellChecker * checker = new NuspellChecker();
+	vector<string> dict_dirs;
+	s_buildDictionaryDirs (dict_dirs);
 
-	if (!checker)
-		return NULL;
+	char ** dir_list = g_new0 (char *, dict_dirs.size() + 1);
+	for (size_t i = 0; i < dict_dirs.size(); i++)
+		dir_list[i] = g_strdup (dict_dirs[i].c_str());
 
-	if (!checker->requestDictionary(tag)) {
-		delete checker;
-		return NULL;
-	}
+	*out_n_dirs = dict_dirs.size ();
+	return dir_list;
+}
 
+static EnchantDict *
+nuspell_dict_new (NuspellChecker * checker)
+{
 	EnchantDict *dict = g_new0(EnchantDict, 1);
 	dict->user_data = (void *) checker;
 	dict->check = nuspell_dict_check;
@@ -375,6 +313,28 @@ nuspell_provider_request_dict(EnchantProvider * me _GL_UNUSED_PARAMETER, const c
 	return dict;
 }
 
+static EnchantDict *
+nuspell_provider_request_dict(EnchantProvider * me, const char *const tag)
+{
+	g_mutex_lock (&s_index_lock);
+	string dic = s_findDictionary(s_currentIndex(me), tag);
+	g_mutex_unlock (&s_index_lock);
+	if (dic.empty())
+		return NULL;
+
+	NuspellChecker * checker = new NuspellChecker();
+
+	if (!checker)
+		return NULL;
+
+	if (!checker->requestDictionary(dic)) {
+		delete checker;
+		return NULL;
+	}
+
+	return nuspell_dict_new(checker);
+}
+
 static void
 nuspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, EnchantDict * dict)
 {
@@ -385,24 +345,19 @@ nuspell_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, Enchan
 }
 
 static int
-nuspell_provider_dictionary_exists (struct str_enchant_provider * me _GL_UNUSED_PARAMETER,
+nuspell_provider_dictionary_exists (struct str_enchant_provider * me,
 				    const char *const tag)
 {
-	vector <string> names;
-	s_buildHashNames (names, tag);
-	for (size_t i = 0; i < names.size(); i++) {
-		if (g_file_test (names[i].c_str(), G_FILE_TEST_EXISTS) &&
-		    s_fileExists(s_correspondingAffFile(names[i]))) {
-			return 1;
-		}
-	}
-
-	return 0;
+	g_mutex_lock (&s_index_lock);
+	bool exists = !s_findExactDictionary(s_currentIndex(me), tag).empty();
+	g_mutex_unlock (&s_index_lock);
+	return exists;
 }
 
 static void
 nuspell_provider_dispose (EnchantProvider * me)
 {
+	delete static_cast<DictIndex *>(me->user_data);
 	g_free (me);
 }
 
@@ -420,10 +375,17 @@ nuspell_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 
 EnchantProvider *init_enchant_provider (void);
 
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider (void)
 {
 	EnchantProvider *provider = g_new0(EnchantProvider, 1);
+	provider->user_data = new DictIndex();
 	provider->dispose = nuspell_provider_dispose;
 	provider->request_dict = nuspell_provider_request_dict;
 	provider->dispose_dict = nuspell_provider_dispose_dict;
@@ -431,6 +393,10 @@ init_enchant_provider (void)
 	provider->identify = nuspell_provider_identify;
 	provider->describe = nuspell_provider_describe;
 	provider->list_dicts = nuspell_provider_list_dicts;
+	provider->list_dict_dirs = nuspell_provider_list_dict_dirs;
+	// Dictionary::spell and suggest are const, and the scratch space
+	// the checker uses is per thread
+	provider->flags = ENCHANT_PROVIDER_THREAD_SAFE;
 
 	return provider;
 }
@@ -0,0 +1,437 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <glib.h>
+#include "unused-parameter.h"
+
+#include "enchant-provider.h"
+
+/**
+ * The remote provider hands its work to an "enchant-2 --server" on the
+ * Unix socket named by ENCHANT_SERVER, with the server's batch protocol.
+ * The processes sharing a server share the dictionaries it keeps
+ * loaded, and a provider that crashes takes down the server instead of
+ * them; ordered before the local providers, it is used while the
+ * server is up and they are used when it is not.
+ */
+
+/* words in a frame of the batch protocol, at most */
+#define REMOTE_MAX_BATCH_WORDS 65536
+
+/* bytes stdio reads at a time */
+#define REMOTE_BUFFER_SIZE 65536
+
+/* a server gone while it is written to is not the program's end */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* A connection to the server, checking with one dictionary.  A
+ * dictionary busy with one thread is cloned for another, each clone with
+ * a connection of its own, so the server checks for them side by side. */
+typedef struct {
+	char *tag;
+	FILE *in;	/* NULL while not connected */
+} RemoteDict;
+
+/* Writes all of buf to the server */
+static gboolean
+remote_send (FILE * in, const char * buf, size_t len)
+{
+	int fd = fileno (in);
+
+	while (len) {
+		ssize_t n = send (fd, buf, len, MSG_NOSIGNAL);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		buf += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+/* Reads a line into str, without its line break; returns FALSE at the
+ * end of the input */
+static gboolean
+remote_read_line (FILE * in, GString * str)
+{
+	char buf[4096];
+
+	g_string_truncate (str, 0);
+	while (fgets (buf, sizeof (buf), in)) {
+		size_t len = strlen (buf);
+		if (len && buf[len - 1] == '\n') {
+			g_string_append_len (str, buf, len - 1);
+			return TRUE;
+		}
+		g_string_append_len (str, buf, len);
+	}
+
+	return FALSE;
+}
+
+/* Connects to the server and sends it first_line.  The server answers
+ * with a line, starting "! " if it cannot go on, which is what the
+ * error is then; returns FALSE in that case or without a server. */
+static gboolean
+remote_connect (const char * first_line, FILE ** out_in, char ** out_error)
+{
+	const char *path = g_getenv ("ENCHANT_SERVER");
+	struct sockaddr_un addr;
+
+	*out_error = NULL;
+	if (path == NULL || strlen (path) >= sizeof (addr.sun_path))
+		return FALSE;
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, path);
+
+	int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return FALSE;
+	if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1) {
+		close (fd);
+		return FALSE;
+	}
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+	setsockopt (fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof (on));
+#endif
+
+	FILE *in = fdopen (fd, "rb");
+	if (!in) {
+		close (fd);
+		return FALSE;
+	}
+	setvbuf (in, NULL, _IOFBF, REMOTE_BUFFER_SIZE);
+
+	char *line = g_strconcat (first_line, "\n", NULL);
+	GString *str = g_string_new (NULL);
+	gboolean ok = remote_send (in, line, strlen (line)) &&
+		remote_read_line (in, str) && !g_str_has_prefix (str->str, "!");
+	if (!ok) {
+		if (g_str_has_prefix (str->str, "! "))
+			*out_error = g_strdup (str->str + 2);
+		fclose (in);
+	} else
+		*out_in = in;
+	g_string_free (str, TRUE);
+	g_free (line);
+
+	return ok;
+}
+
+static void
+remote_dict_disconnect (RemoteDict * rdict)
+{
+	if (rdict->in) {
+		fclose (rdict->in);
+		rdict->in = NULL;
+	}
+}
+
+/* Connects again to a server that went away, which may have been
+ * restarted since */
+static gboolean
+remote_dict_ensure_connected (EnchantDict * me)
+{
+	RemoteDict *rdict = (RemoteDict *) me->user_data;
+	if (rdict->in)
+		return TRUE;
+
+	char *first_line = g_strconcat ("batch ", rdict->tag, NULL);
+	char *error;
+	gboolean connected = remote_connect (first_line, &rdict->in, &error);
+	g_free (first_line);
+	if (!connected)
+		enchant_dict_set_error (me, error ? error : "the Enchant server cannot be reached");
+	g_free (error);
+
+	return connected;
+}
+
+/* the protocol is a line per word */
+static gboolean
+remote_word_is_sendable (const char * const word, size_t len)
+{
+	return len != 0 && !memchr (word, '\n', len) && !memchr (word, '\r', len) &&
+		!memchr (word, '\0', len);
+}
+
+/* Sends a frame of the n sendable words among words, and reads the line
+ * answering each into lines; returns FALSE if the server went away */
+static gboolean
+remote_dict_send_frame (EnchantDict * me, const char * verb, const char * const * words,
+			const size_t * lens, size_t n, GPtrArray * lines)
+{
+	RemoteDict *rdict = (RemoteDict *) me->user_data;
+	size_t n_sent = 0;
+
+	for (size_t i = 0; i < n; i++)
+		if (remote_word_is_sendable (words[i], lens[i]))
+			n_sent++;
+
+	GString *str = g_string_new (NULL);
+	g_string_printf (str, "%s %" G_GSIZE_FORMAT "\n", verb, n_sent);
+	for (size_t i = 0; i < n; i++)
+		if (remote_word_is_sendable (words[i], lens[i])) {
+			g_string_append_len (str, words[i], lens[i]);
+			g_string_append_c (str, '\n');
+		}
+	gboolean ok = remote_send (rdict->in, str->str, str->len);
+
+	for (size_t i = 0; ok && i < n_sent; i++) {
+		ok = remote_read_line (rdict->in, str);
+		if (ok)
+			g_ptr_array_add (lines, g_strndup (str->str, str->len));
+	}
+	g_string_free (str, TRUE);
+
+	if (!ok) {
+		remote_dict_disconnect (rdict);
+		enchant_dict_set_error (me, "the Enchant server went away");
+	}
+	return ok;
+}
+
+/* "*" for a word spelled right, "!" and why for one the server could
+ * not check, and anything else for one that is not */
+static int
+remote_dict_read_verdict (EnchantDict * me, const char * line)
+{
+	if (strcmp (line, "*") == 0)
+		return 0;
+	if (line[0] == '!') {
+		enchant_dict_set_error (me, g_str_has_prefix (line, "! ") ? line + 2 :
+					"the Enchant server could not check the word");
+		return -1;
+	}
+	return 1;
+}
+
+static void
+remote_dict_check_batch (EnchantDict * me, const char *const *words, const size_t *lens,
+			 size_t n, int *results)
+{
+	size_t done = 0;
+
+	GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+	while (done < n && remote_dict_ensure_connected (me)) {
+		size_t n_frame = MIN (n - done, REMOTE_MAX_BATCH_WORDS);
+		g_ptr_array_set_size (lines, 0);
+		if (!remote_dict_send_frame (me, "check", words + done, lens + done, n_frame, lines))
+			break;
+
+		guint line = 0;
+		for (size_t i = done; i < done + n_frame; i++)
+			if (!remote_word_is_sendable (words[i], lens[i]))
+				results[i] = 1;
+			else
+				results[i] = remote_dict_read_verdict (me, g_ptr_array_index (lines, line++));
+		done += n_frame;
+	}
+	g_ptr_array_free (lines, TRUE);
+
+	for (size_t i = done; i < n; i++)
+		results[i] = -1;
+}
+
+static int
+remote_dict_check (EnchantDict * me, const char *const word, size_t len)
+{
+	int result;
+	remote_dict_check_batch (me, &word, &len, 1, &result);
+	return result;
+}
+
+static char **
+remote_dict_suggest (EnchantDict * me, const char *const word,
+		     size_t len, size_t * out_n_suggs)
+{
+	*out_n_suggs = 0;
+	if (!remote_word_is_sendable (word, len) || !remote_dict_ensure_connected (me))
+		return NULL;
+
+	GPtrArray *lines = g_ptr_array_new_with_free_func (g_free);
+	char **suggs = NULL;
+	if (remote_dict_send_frame (me, "suggest", &word, &len, 1, lines)) {
+		/* "&" and a tab before each suggestion, if there are any */
+		const char *line = g_ptr_array_index (lines, 0);
+		if (line[0] == '&' && line[1] == '\t') {
+			suggs = g_strsplit (line + 2, "\t", -1);
+			*out_n_suggs = g_strv_length (suggs);
+		} else
+			remote_dict_read_verdict (me, line);
+	}
+	g_ptr_array_free (lines, TRUE);
+
+	return suggs;
+}
+
+static EnchantDict *
+remote_dict_new (EnchantProvider * me, const char *const tag)
+{
+	RemoteDict *rdict = g_new0 (RemoteDict, 1);
+	char *first_line = g_strconcat ("batch ", tag, NULL);
+	char *error;
+	gboolean connected = remote_connect (first_line, &rdict->in, &error);
+	g_free (first_line);
+	if (!connected) {
+		if (error)
+			enchant_provider_set_error (me, error);
+		g_free (error);
+		g_free (rdict);
+		return NULL;
+	}
+	rdict->tag = g_strdup (tag);
+
+	EnchantDict *dict = g_new0 (EnchantDict, 1);
+	dict->user_data = (void *) rdict;
+	dict->check = remote_dict_check;
+	dict->suggest = remote_dict_suggest;
+	dict->check_batch = remote_dict_check_batch;
+
+	return dict;
+}
+
+static EnchantDict *
+remote_provider_request_dict (EnchantProvider * me, const char *const tag)
+{
+	return remote_dict_new (me, tag);
+}
+
+static void
+remote_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, EnchantDict * dict)
+{
+	RemoteDict *rdict = (RemoteDict *) dict->user_data;
+	remote_dict_disconnect (rdict);
+	g_free (rdict->tag);
+	g_free (rdict);
+	g_free (dict);
+}
+
+static EnchantDict *
+remote_provider_clone_dict (EnchantProvider * me, EnchantDict * dict)
+{
+	RemoteDict *rdict = (RemoteDict *) dict->user_data;
+	return remote_dict_new (me, rdict->tag);
+}
+
+/* the server answers "list" with the dictionaries it has, a line each */
+static char **
+remote_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
+			    size_t * out_n_dicts)
+{
+	FILE *in;
+	char *error;
+
+	*out_n_dicts = 0;
+	if (!remote_connect ("list", &in, &error)) {
+		g_free (error);
+		return NULL;
+	}
+
+	GPtrArray *tags = g_ptr_array_new ();
+	GString *str = g_string_new (NULL);
+	while (remote_read_line (in, str))
+		if (str->len)
+			g_ptr_array_add (tags, g_strndup (str->str, str->len));
+	g_string_free (str, TRUE);
+	fclose (in);
+
+	*out_n_dicts = tags->len;
+	g_ptr_array_add (tags, NULL);
+	return (char **) g_ptr_array_free (tags, FALSE);
+}
+
+static int
+remote_provider_dictionary_exists (EnchantProvider * me, const char *const tag)
+{
+	EnchantDict *dict = remote_dict_new (me, tag);
+	if (dict == NULL)
+		return 0;
+	remote_provider_dispose_dict (me, dict);
+	return 1;
+}
+
+static void
+remote_provider_dispose (EnchantProvider * me)
+{
+	g_free (me);
+}
+
+static const char *
+remote_provider_identify (EnchantProvider * me _GL_UNUSED_PARAMETER)
+{
+	return "remote";
+}
+
+static const char *
+remote_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
+{
+	return "Enchant Server Provider";
+}
+
+EnchantProvider *init_enchant_provider (void);
+
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
+EnchantProvider *
+init_enchant_provider (void)
+{
+	EnchantProvider *provider = g_new0 (EnchantProvider, 1);
+	provider->dispose = remote_provider_dispose;
+	provider->request_dict = remote_provider_request_dict;
+	provider->dispose_dict = remote_provider_dispose_dict;
+	provider->dictionary_exists = remote_provider_dictionary_exists;
+	provider->identify = remote_provider_identify;
+	provider->describe = remote_provider_describe;
+	provider->list_dicts = remote_provider_list_dicts;
+	provider->clone_dict = remote_provider_clone_dict;
+
+	return provider;
+}
@@ -47,10 +47,20 @@
  * http://voikko.sourceforge.net/
  */
 
+/* A libvoikko handle serves one caller at a time, so while a dictionary
+ * is busy Enchant checks with clones of it, each with a handle of its
+ * own for the same language; Enchant creates them as threads come to
+ * wait and bounds how many it keeps */
+typedef struct {
+	struct VoikkoHandle *handle;
+	char *tag;
+} VoikkoDict;
+
 static int
 voikko_dict_check (EnchantDict * me, const char *const word, size_t len _GL_UNUSED_PARAMETER)
 {
-	int result = voikkoSpellCstr((struct VoikkoHandle *)me->user_data, word);
+	VoikkoDict *vdict = (VoikkoDict *) me->user_data;
+	int result = voikkoSpellCstr(vdict->handle, word);
 	if (result == VOIKKO_SPELL_FAILED)
 		return 1;
 	else if (result == VOIKKO_SPELL_OK)
@@ -63,11 +73,14 @@ static char **
 voikko_dict_suggest (EnchantDict * me, const char *const word,
 		     size_t len _GL_UNUSED_PARAMETER, size_t * out_n_suggs)
 {
-	char **voikko_sugg_arr = voikkoSuggestCstr((struct VoikkoHandle *)me->user_data, word);
+	VoikkoDict *vdict = (VoikkoDict *) me->user_data;
+	char **voikko_sugg_arr = voikkoSuggestCstr(vdict->handle, word);
 	if (voikko_sugg_arr == NULL)
 		return NULL;
 	for (*out_n_suggs = 0; voikko_sugg_arr[*out_n_suggs] != NULL; (*out_n_suggs)++);
 
+	/* copied, since libvoikko may allocate from a C runtime other
+	 * than the one Enchant frees the list with */
 	char **sugg_arr = calloc(sizeof (char *), *out_n_suggs + 1);
 	for (size_t i = 0; i < *out_n_suggs; i++) {
 		sugg_arr[i] = strdup (voikko_sugg_arr[i]);
@@ -76,13 +89,46 @@ voikko_dict_suggest (EnchantDict * me, const char *const word,
 	return sugg_arr;
 }
 
+static EnchantDict *
+voikko_dict_new (EnchantProvider * me, const char *const tag)
+{
+	const char * voikko_error;
+
+	struct VoikkoHandle *voikko_handle = voikkoInit (&voikko_error, tag, NULL);
+	if (voikko_handle == NULL) {
+		enchant_provider_set_error (me, voikko_error);
+		return NULL;
+	}
+
+	VoikkoDict *vdict = calloc (sizeof (VoikkoDict), 1);
+	vdict->handle = voikko_handle;
+	vdict->tag = strdup (tag);
+
+	EnchantDict *dict = calloc (sizeof (EnchantDict), 1);
+	dict->user_data = (void *)vdict;
+	dict->check = voikko_dict_check;
+	dict->suggest = voikko_dict_suggest;
+
+	return dict;
+}
+
 static void
 voikko_provider_dispose_dict (EnchantProvider * me _GL_UNUSED_PARAMETER, EnchantDict * dict)
 {
-	voikkoTerminate((struct VoikkoHandle *)dict->user_data);
+	VoikkoDict *vdict = (VoikkoDict *) dict->user_data;
+	voikkoTerminate(vdict->handle);
+	free (vdict->tag);
+	free (vdict);
 	free (dict);
 }
 
+static EnchantDict *
+voikko_provider_clone_dict (EnchantProvider * me, EnchantDict * dict)
+{
+	VoikkoDict *vdict = (VoikkoDict *) dict->user_data;
+	return voikko_dict_new (me, vdict->tag);
+}
+
 static char **
 voikko_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
 			    size_t * out_n_dicts)
@@ -129,24 +175,11 @@ voikko_provider_dictionary_exists (struct str_enchant_provider * me _GL_UNUSED_P
 static EnchantDict *
 voikko_provider_request_dict (EnchantProvider * me, const char *const tag)
 {
-	const char * voikko_error;
-
 	if (!voikko_provider_dictionary_exists (NULL, tag)) {
 		return NULL;
 	}
 
-	struct VoikkoHandle *voikko_handle = voikkoInit (&voikko_error, tag, NULL);
-	if (voikko_handle == NULL) {
-		enchant_provider_set_error (me, voikko_error);
-		return NULL;
-	}
-
-	EnchantDict *dict = calloc (sizeof (EnchantDict), 1);
-	dict->user_data = (void *)voikko_handle;
-	dict->check = voikko_dict_check;
-	dict->suggest = voikko_dict_suggest;
-
-	return dict;
+	return voikko_dict_new (me, tag);
 }
 
 static void
@@ -169,6 +202,12 @@ voikko_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 
 EnchantProvider *init_enchant_provider (void);
 
+unsigned int
+enchant_provider_abi_version (void)
+{
+	return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider (void)
 {
@@ -180,6 +219,7 @@ init_enchant_provider (void)
 	provider->identify = voikko_provider_identify;
 	provider->describe = voikko_provider_describe;
 	provider->list_dicts = voikko_provider_list_dicts;
+	provider->clone_dict = voikko_provider_clone_dict;
 
 	return provider;
 }
@@ -37,24 +37,24 @@
 #include "unused-parameter.h"
 
 
-static bool zemberek_service_is_running ()
+#define ZEMBEREK_SERVICE "net.zemberekserver.server.dbus"
+#define ZEMBEREK_PATH "/net/zemberekserver/server/dbus/ZemberekDbus"
+#define ZEMBEREK_INTERFACE "net.zemberekserver.server.dbus.ZemberekDbusInterface"
+
+// How many kelimeDenetle calls checkWords keeps waiting on the bus at once
+#define ZEMBEREK_MAX_PENDING 64
+
+static bool zemberek_service_is_running (DBusGConnection *connection)
 {
   GError *Error = NULL;
 
-  DBusGConnection *connection = dbus_g_bus_get (DBUS_BUS_SYSTEM,
-                                                &Error);
-  if (connection == NULL) {
-      g_error_free (Error);
-      return false;
-  }
   DBusGProxy *proxy = dbus_g_proxy_new_for_name_owner (connection,
-                                                       "net.zemberekserver.server.dbus",
-                                                       "/net/zemberekserver/server/dbus/ZemberekDbus",
-                                                       "net.zemberekserver.server.dbus.ZemberekDbusInterface",
+                                                       ZEMBEREK_SERVICE,
+                                                       ZEMBEREK_PATH,
+                                                       ZEMBEREK_INTERFACE,
                                                        &Error);
-  
-  dbus_g_connection_unref (connection);
   if (proxy == NULL) {
+    g_error_free (Error);
     return false;
   }
 
@@ -65,10 +65,11 @@ static bool zemberek_service_is_running ()
 class Zemberek
 {
 public:
-    Zemberek();
+    explicit Zemberek(DBusGConnection *connection);
     ~Zemberek();
     
     int checkWord(const char* word) const;
+    void checkWords(const char *const *words, const size_t *lens, size_t n, int *results);
     char** suggestWord(const char* word, size_t *out_n_suggs);
 
 private:
@@ -76,23 +77,16 @@ private:
     DBusGProxy *proxy;
 };
 
-Zemberek::Zemberek()
-  : connection(nullptr), proxy(nullptr)
+Zemberek::Zemberek(DBusGConnection *conn)
+  : connection(dbus_g_connection_ref (conn)), proxy(nullptr)
 {
-  GError *Error = NULL;
-
-  connection = dbus_g_bus_get (DBUS_BUS_SYSTEM,
-                               &Error);
-  if (connection == NULL) {
-      g_error_free (Error);
-      throw "couldn't connect to the system bus";
-  }
   proxy = dbus_g_proxy_new_for_name (connection,
-                                     "net.zemberekserver.server.dbus",
-                                     "/net/zemberekserver/server/dbus/ZemberekDbus",
-                                     "net.zemberekserver.server.dbus.ZemberekDbusInterface");
+                                     ZEMBEREK_SERVICE,
+                                     ZEMBEREK_PATH,
+                                     ZEMBEREK_INTERFACE);
 
   if (proxy == NULL) {
+    dbus_g_connection_unref (connection);
     throw "couldn't connect to the Zemberek service";
   }
 }
@@ -122,6 +116,44 @@ int Zemberek::checkWord(const char* word) const
 }
 
 
+// Sends the calls for up to ZEMBEREK_MAX_PENDING words before waiting on
+// the first reply, so the words share round trips to the service
+// rather than each taking one of its own
+void Zemberek::checkWords(const char *const *words, const size_t *lens, size_t n, int *results)
+{
+    DBusGProxyCall *pending[ZEMBEREK_MAX_PENDING];
+    char *pending_word[ZEMBEREK_MAX_PENDING];
+    size_t pending_index[ZEMBEREK_MAX_PENDING];
+
+    size_t next = 0;
+    while (next < n) {
+	size_t n_pending = 0;
+	for (; next < n && n_pending < ZEMBEREK_MAX_PENDING; next++) {
+	    char *word = g_strndup (words[next], lens[next]);
+	    pending[n_pending] = dbus_g_proxy_begin_call (proxy, "kelimeDenetle", NULL, NULL, NULL,
+							  G_TYPE_STRING, word, G_TYPE_INVALID);
+	    pending_word[n_pending] = word;
+	    pending_index[n_pending++] = next;
+	}
+
+	for (size_t i = 0; i < n_pending; i++) {
+	    size_t w = pending_index[i];
+	    gboolean result;
+	    GError *Error = NULL;
+	    if (pending[i] == NULL)
+		results[w] = -1;
+	    else if (!dbus_g_proxy_end_call (proxy, pending[i], &Error,
+					     G_TYPE_BOOLEAN, &result, G_TYPE_INVALID)) {
+		g_error_free (Error);
+		results[w] = -1;
+	    } else
+		results[w] = !result;
+	    g_free (pending_word[i]);
+	}
+    }
+}
+
+
 char** Zemberek::suggestWord(const char* word, size_t *out_n_suggs)
 {
     char** suggs;
@@ -136,6 +168,20 @@ char** Zemberek::suggestWord(const char* word, size_t *out_n_suggs)
     return suggs;
 }
 
+// The provider's one connection to the system bus, made on first use and
+// shared by its dictionaries and the probes for the service
+static DBusGConnection *
+zemberek_provider_connection (EnchantProvider *me)
+{
+    if (me->user_data == NULL) {
+	GError *Error = NULL;
+	me->user_data = dbus_g_bus_get (DBUS_BUS_SYSTEM, &Error);
+	if (me->user_data == NULL)
+	    g_error_free (Error);
+    }
+    return (DBusGConnection *) me->user_data;
+}
+
 
 extern "C" {
 
@@ -148,6 +194,14 @@ zemberek_dict_check (EnchantDict * me, const char *const word, size_t len _GL_UN
     return checker->checkWord(word);
 }
 
+static void
+zemberek_dict_check_batch (EnchantDict * me, const char *const *words, const size_t *lens,
+                           size_t n, int *results)
+{
+    Zemberek *checker = (Zemberek *) me->user_data;
+    checker->checkWords(words, lens, n, results);
+}
+
 static char**
 zemberek_dict_suggest (EnchantDict * me, const char *const word,
                        size_t len _GL_UNUSED_PARAMETER, size_t * out_n_suggs)
@@ -159,23 +213,30 @@ zemberek_dict_suggest (EnchantDict * me, const char *const word,
 static void
 zemberek_provider_dispose(EnchantProvider *me)
 {
+    if (me->user_data)
+	dbus_g_connection_unref ((DBusGConnection *) me->user_data);
     g_free(me);
 }
 
 static EnchantDict*
-zemberek_provider_request_dict(EnchantProvider *me _GL_UNUSED_PARAMETER, const char *tag)
+zemberek_provider_request_dict(EnchantProvider *me, const char *tag)
 {
     if (!((strcmp(tag, "tr") == 0) || (strncmp(tag, "tr_", 3) == 0)))
 	return NULL; // only handle turkish
 
+    DBusGConnection *connection = zemberek_provider_connection (me);
+    if (connection == NULL)
+	return NULL;
+
     try
       {
-	Zemberek* checker = new Zemberek();
+	Zemberek* checker = new Zemberek(connection);
 
 	EnchantDict* dict = g_new0(EnchantDict, 1);
 	dict->user_data = (void *) checker;
 	dict->check = zemberek_dict_check;
 	dict->suggest = zemberek_dict_suggest;
+	dict->check_batch = zemberek_dict_check_batch;
 
 	return dict;
       }
@@ -207,10 +268,11 @@ zemberek_provider_describe (EnchantProvider * me _GL_UNUSED_PARAMETER)
 }
 
 static char **
-zemberek_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
+zemberek_provider_list_dicts (EnchantProvider * me,
 			      size_t * out_n_dicts)
 {
-  if (!zemberek_service_is_running ())
+  DBusGConnection *connection = zemberek_provider_connection (me);
+  if (connection == NULL || !zemberek_service_is_running (connection))
     {
 	*out_n_dicts = 0;
 	return NULL;
@@ -225,6 +287,12 @@ zemberek_provider_list_dicts (EnchantProvider * me _GL_UNUSED_PARAMETER,
     }
 }
 
+unsigned int
+enchant_provider_abi_version(void)
+{
+    return ENCHANT_PROVIDER_ABI_VERSION;
+}
+
 EnchantProvider *
 init_enchant_provider(void)
 {
@@ -34,6 +34,27 @@
 #include <string>
 #include <vector>
 #include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#if __cplusplus >= 201703L
+#include <string_view>
+#include <type_traits>
+#include <functional>
+#include <future>
+#endif
+#if __cplusplus >= 202002L
+#include <span>
+#include <version>
+#endif
+#if defined(__cpp_lib_jthread)
+#include <optional>
+#include <stop_token>
+#endif
+#if defined(__cpp_lib_coroutine) && defined(__cpp_lib_jthread)
+#include <atomic>
+#include <coroutine>
+#endif
 
 namespace enchant 
 {
@@ -63,6 +84,372 @@ namespace enchant
 			std::string m_ex;
 		};
 
+#if __cplusplus >= 201703L
+	class Dict;
+
+	// The suggestions from one Dict::suggest_view call, read in place
+	// from the list the dictionary returned and freed with it
+	class Suggestions
+		{
+			friend class enchant::Dict;
+
+		public:
+
+			class const_iterator
+				{
+				public:
+					explicit const_iterator (char ** it) : m_it (it) {
+					}
+
+					std::string_view operator* () const {
+						return *m_it;
+					}
+
+					const_iterator & operator++ () {
+						++m_it;
+						return *this;
+					}
+
+					bool operator== (const const_iterator & rhs) const {
+						return m_it == rhs.m_it;
+					}
+
+					bool operator!= (const const_iterator & rhs) const {
+						return m_it != rhs.m_it;
+					}
+
+				private:
+					char ** m_it;
+				};
+
+			Suggestions (Suggestions && rhs) noexcept
+				: m_dict (rhs.m_dict), m_suggs (rhs.m_suggs), m_n_suggs (rhs.m_n_suggs) {
+				rhs.m_suggs = 0;
+				rhs.m_n_suggs = 0;
+			}
+
+			Suggestions& operator= (Suggestions && rhs) noexcept {
+				if (this != &rhs) {
+					if (m_suggs)
+						enchant_dict_free_string_list (m_dict, m_suggs);
+					m_dict = rhs.m_dict;
+					m_suggs = rhs.m_suggs;
+					m_n_suggs = rhs.m_n_suggs;
+					rhs.m_suggs = 0;
+					rhs.m_n_suggs = 0;
+				}
+				return *this;
+			}
+
+			~Suggestions () {
+				if (m_suggs)
+					enchant_dict_free_string_list (m_dict, m_suggs);
+			}
+
+			size_t size () const {
+				return m_n_suggs;
+			}
+
+			bool empty () const {
+				return m_n_suggs == 0;
+			}
+
+			std::string_view operator[] (size_t i) const {
+				return m_suggs[i];
+			}
+
+			const_iterator begin () const {
+				return const_iterator (m_suggs);
+			}
+
+			const_iterator end () const {
+				return const_iterator (m_suggs + m_n_suggs);
+			}
+
+		private:
+
+			Suggestions (EnchantDict * dict, char ** suggs, size_t n_suggs)
+				: m_dict (dict), m_suggs (suggs), m_n_suggs (suggs ? n_suggs : 0) {
+			}
+
+			// private, unimplemented
+			Suggestions (const Suggestions & rhs);
+			Suggestions& operator=(const Suggestions & rhs);
+
+			EnchantDict * m_dict;
+			char ** m_suggs;
+			size_t m_n_suggs;
+		}; // class enchant::Suggestions
+
+	// A misspelled word of a text given to Dict::check_text, pointing
+	// into that text
+	struct Misspelling
+		{
+			std::string_view word;
+			size_t offset;
+			size_t char_offset;
+			size_t char_len;
+		};
+
+	namespace detail
+		{
+			// Decodes the UTF-8 character at text[i] and moves i past
+			// it; a stray byte, or a sequence cut short by the end of
+			// text, reads as U+FFFD
+			inline char32_t utf8_next (std::string_view text, size_t & i) {
+				unsigned char c = text[i];
+				if (c < 0x80) {
+					i++;
+					return c;
+				}
+
+				size_t len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+				if (len == 1 || len > text.size() - i) {
+					i++;
+					return 0xfffd;
+				}
+
+				char32_t uc = c & (0x7f >> len);
+				for (size_t k = 1; k < len; k++)
+					uc = (uc << 6) | (text[i + k] & 0x3f);
+				i += len;
+				return uc;
+			}
+		}
+
+	// Tells which characters make up words as a dictionary does, from
+	// the table enchant_dict_get_word_character_table builds for it;
+	// a dictionary of 0 stands for the built-in rules
+	class TableWordChars
+		{
+		public:
+			explicit TableWordChars (EnchantDict * dict = 0)
+				: m_dict (dict), m_table (enchant_dict_get_word_character_table (dict)) {
+			}
+
+			bool is_word_character (char32_t uc, size_t n) const {
+				if (uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE)
+					return (m_table[uc] >> n) & 1;
+				return enchant_dict_is_word_character (m_dict, uc, n) != 0;
+			}
+
+		private:
+			EnchantDict * m_dict;
+			const uint8_t * m_table;
+		};
+
+	// A word of a text given to Tokenizer, pointing into that text
+	struct TextWord
+		{
+			std::string_view word;
+			size_t offset;
+			size_t char_offset;
+			size_t char_len;
+		};
+
+	// Splits UTF-8 texts into words the way enchant_dict_check_text
+	// does.  WordChars is anything with a
+	// bool is_word_character (char32_t uc, size_t n) const
+	// answering as enchant_dict_is_word_character does, so that it is
+	// inlined into the loop rather than called through the dictionary
+	template <typename WordChars = TableWordChars>
+	class Tokenizer
+		{
+		public:
+			explicit Tokenizer (WordChars word_chars = WordChars ())
+				: m_word_chars (word_chars) {
+			}
+
+			// Calls fn (const enchant::TextWord &) for each word of
+			// utf8text, in order; returns how many there were
+			template <typename Fn>
+			size_t for_each_word (std::string_view utf8text, Fn && fn) const {
+				size_t n_words = 0;
+				size_t i = 0;
+				size_t char_offset = 0;
+
+				while (i < utf8text.size()) {
+					size_t start = i;
+					size_t start_char = char_offset;
+					size_t next = i;
+					char32_t uc = detail::utf8_next (utf8text, next);
+
+					// Skip over word characters, noting where the
+					// last one that may end a word ends.
+					size_t word_end = start;
+					size_t word_end_char = start_char;
+					if (m_word_chars.is_word_character (uc, 0))
+						while (i < utf8text.size()) {
+							size_t after = i;
+							uc = detail::utf8_next (utf8text, after);
+							if (!m_word_chars.is_word_character (uc, 1))
+								break;
+							i = after;
+							char_offset++;
+							if (m_word_chars.is_word_character (uc, 2)) {
+								word_end = i;
+								word_end_char = char_offset;
+							}
+						}
+
+					if (i == start) {
+						// Skip a non-word character.
+						i = next;
+						char_offset++;
+						continue;
+					}
+
+					if (word_end == start)
+						continue;
+
+					TextWord w = { utf8text.substr (start, word_end - start), start,
+						       start_char, word_end_char - start_char };
+					fn (w);
+					n_words++;
+				}
+
+				return n_words;
+			}
+
+			// The words of utf8text, in order, pointing into it
+			std::vector<TextWord> words (std::string_view utf8text) const {
+				std::vector<TextWord> result;
+				for_each_word (utf8text, [&result] (const TextWord & w) {
+					result.push_back (w);
+				});
+				return result;
+			}
+
+		private:
+			WordChars m_word_chars;
+		};
+
+	// Whether words match as personal word lists match them: exactly,
+	// or regardless of case, lowering each character of both as
+	// enchant_get_lowercase_table does
+	enum class CaseMode { sensitive, insensitive };
+
+	// Compares words in a mode fixed at compile time, so that scanning
+	// a list does not weigh the mode for every entry
+	template <CaseMode Mode>
+	class WordMatcher
+		{
+		public:
+			WordMatcher ()
+				: m_lowercase (Mode == CaseMode::insensitive ? enchant_get_lowercase_table () : 0) {
+			}
+
+			bool matches (std::string_view word, std::string_view entry) const {
+				if constexpr (Mode == CaseMode::sensitive)
+					return word == entry;
+				else
+					return compare_folded (word, entry, false);
+			}
+
+			bool has_prefix (std::string_view word, std::string_view prefix) const {
+				if constexpr (Mode == CaseMode::sensitive)
+					return word.substr (0, prefix.size()) == prefix;
+				else
+					return compare_folded (word, prefix, true);
+			}
+
+			// The first of [first, last) that word matches, or last
+			template <typename It>
+			It find (It first, It last, std::string_view word) const {
+				for (; first != last; ++first)
+					if (matches (word, *first))
+						break;
+				return first;
+			}
+
+		private:
+			char32_t fold (char32_t uc) const {
+				return uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE ? m_lowercase[uc] : uc;
+			}
+
+			// Whether a matches b, or when prefix, begins with it
+			bool compare_folded (std::string_view a, std::string_view b, bool prefix) const {
+				size_t i = 0, j = 0;
+				while (i < a.size() && j < b.size()) {
+					unsigned char ca = a[i], cb = b[j];
+					if (ca < 0x80 && cb < 0x80) {
+						if (m_lowercase[ca] != m_lowercase[cb])
+							return false;
+						i++;
+						j++;
+					}
+					else if (fold (detail::utf8_next (a, i)) != fold (detail::utf8_next (b, j)))
+						return false;
+				}
+				return j == b.size() && (prefix || i == a.size());
+			}
+
+			const uint16_t * m_lowercase;
+		};
+#endif
+
+#if defined(__cpp_lib_coroutine) && defined(__cpp_lib_jthread)
+	// What Dict::co_suggest and Broker::co_request_dict return, to be
+	// co_await'ed once; the awaiting coroutine is resumed on the thread
+	// the result comes in on
+	template <typename T>
+	class Awaitable
+		{
+			friend class enchant::Dict;
+			friend class enchant::Broker;
+
+		public:
+
+			bool await_ready () const noexcept {
+				return false;
+			}
+
+			bool await_suspend (std::coroutine_handle<> handle) {
+				m_handle = handle;
+				m_start (*this);
+				// whichever of us and complete comes second resumes
+				return !m_done.exchange (true);
+			}
+
+			T await_resume () {
+				if (m_error)
+					std::rethrow_exception (m_error);
+				return std::move (*m_value);
+			}
+
+		private:
+
+			explicit Awaitable (std::function<void (Awaitable &)> start)
+				: m_start (std::move (start)), m_done (false) {
+			}
+
+			// private, unimplemented
+			Awaitable (const Awaitable & rhs);
+			Awaitable& operator=(const Awaitable & rhs);
+
+			void set_value (T value) {
+				m_value.emplace (std::move (value));
+				complete ();
+			}
+
+			void set_exception (std::exception_ptr error) {
+				m_error = error;
+				complete ();
+			}
+
+			void complete () {
+				if (m_done.exchange (true))
+					m_handle.resume ();
+			}
+
+			std::function<void (Awaitable &)> m_start;
+			std::coroutine_handle<> m_handle;
+			std::atomic<bool> m_done;
+			std::optional<T> m_value;
+			std::exception_ptr m_error;
+		}; // class enchant::Awaitable
+#endif
+
 	class Dict
 		{
 			friend class enchant::Broker;
@@ -73,11 +460,19 @@ namespace enchant
 				enchant_broker_free_dict (m_broker, m_dict);
 			}
 					
+#if __cplusplus >= 201703L
+			bool check (std::string_view utf8word) {
+				int val;
+
+				val = enchant_dict_check (m_dict, utf8word.data() ? utf8word.data() : "",
+							  utf8word.size());
+#else
 			bool check (const std::string & utf8word) {
 				int val;
 
 				val = enchant_dict_check (m_dict, utf8word.c_str(), 
 							  utf8word.size());
+#endif
 				if (val == 0)
 					return true;
 				else if (val > 0)
@@ -89,6 +484,160 @@ namespace enchant
 				return false; // never reached
 			}
 
+			std::vector<bool> check_batch (const std::vector<std::string> & utf8words) {
+				std::vector<const char *> words;
+				std::vector<ssize_t> lens;
+				for (size_t i = 0; i < utf8words.size(); i++) {
+					words.push_back (utf8words[i].c_str());
+					lens.push_back (utf8words[i].size());
+				}
+
+				std::vector<int> vals (utf8words.size());
+				enchant_dict_check_batch (m_dict, words.data(), lens.data(),
+							  words.size(), vals.data());
+
+				std::vector<bool> out (vals.size());
+				for (size_t i = 0; i < vals.size(); i++) {
+					if (vals[i] < 0)
+						throw enchant::Exception (enchant_dict_get_error (m_dict));
+					out[i] = vals[i] == 0;
+				}
+				return out;
+			}
+
+#if __cplusplus >= 201703L
+			// Checks n_words words at once into results, true for the
+			// correctly spelled ones
+			void check_batch (const std::string_view * utf8words, size_t n_words, bool * results) {
+				std::vector<const char *> words (n_words);
+				std::vector<ssize_t> lens (n_words);
+				for (size_t i = 0; i < n_words; i++) {
+					words[i] = utf8words[i].data() ? utf8words[i].data() : "";
+					lens[i] = utf8words[i].size();
+				}
+
+				std::vector<int> vals (n_words);
+				enchant_dict_check_batch (m_dict, words.data(), lens.data(),
+							  n_words, vals.data());
+
+				for (size_t i = 0; i < n_words; i++) {
+					if (vals[i] < 0)
+						throw enchant::Exception (enchant_dict_get_error (m_dict));
+					results[i] = vals[i] == 0;
+				}
+			}
+
+#if __cplusplus >= 202002L
+			void check (std::span<const std::string_view> utf8words, std::span<bool> results) {
+				if (results.size() < utf8words.size())
+					throw enchant::Exception ("fewer results than words");
+				check_batch (utf8words.data(), utf8words.size(), results.data());
+			}
+#endif
+
+			// Calls fn (const enchant::Misspelling &) for each misspelled
+			// word of utf8text, in order, as enchant_dict_check_text
+			// finds them; returns how many there were
+			template <typename Fn>
+			size_t check_text (std::string_view utf8text, Fn && fn) {
+				int n = enchant_dict_check_text (m_dict, utf8text.data() ? utf8text.data() : "",
+								 utf8text.size(), s_misspelling_fn<Fn>, (void *) &fn);
+				if (n < 0)
+					throw enchant::Exception (enchant_dict_get_error (m_dict));
+				return n;
+			}
+
+			// The misspelled words of utf8text, in order, pointing into it
+			std::vector<Misspelling> misspellings (std::string_view utf8text) {
+				std::vector<Misspelling> result;
+				check_text (utf8text, [&result] (const Misspelling & m) {
+					result.push_back (m);
+				});
+				return result;
+			}
+
+			// Splits texts into words as this dictionary does, without
+			// checking them; valid as long as the dictionary
+			Tokenizer<> tokenizer () const {
+				return Tokenizer<> (TableWordChars (m_dict));
+			}
+
+			// Reuses the strings already in out_suggestions, so that
+			// filling the same vector call after call seldom allocates
+			void suggest (std::string_view utf8word,
+				      std::vector<std::string> & out_suggestions) {
+				size_t n_suggs = 0;
+				char ** suggs;
+
+				suggs = enchant_dict_suggest (m_dict, utf8word.data() ? utf8word.data() : "",
+							      utf8word.size(), &n_suggs);
+				if (!suggs)
+					n_suggs = 0;
+
+				out_suggestions.resize (n_suggs);
+				for (size_t i = 0; i < n_suggs; i++)
+					out_suggestions[i].assign (suggs[i]);
+
+				if (suggs)
+					enchant_dict_free_string_list (m_dict, suggs);
+			}
+
+			std::vector<std::string> suggest (std::string_view utf8word) {
+				std::vector<std::string> result;
+				suggest (utf8word, result);
+				return result;
+			}
+
+			Suggestions suggest_view (std::string_view utf8word) {
+				size_t n_suggs = 0;
+				char ** suggs;
+
+				suggs = enchant_dict_suggest (m_dict, utf8word.data() ? utf8word.data() : "",
+							      utf8word.size(), &n_suggs);
+				return Suggestions (m_dict, suggs, n_suggs);
+			}
+
+			// Suggests as enchant_dict_suggest_async does; the Dict
+			// must be kept until the future is ready
+			std::future<std::vector<std::string> > suggest_async (std::string_view utf8word,
+									      int timeout_ms = -1) {
+				auto promise = std::make_shared<std::promise<std::vector<std::string> > > ();
+				std::future<std::vector<std::string> > result = promise->get_future ();
+				start_suggest (utf8word, timeout_ms, [promise] (std::vector<std::string> suggs) {
+					promise->set_value (std::move (suggs));
+				});
+				return result;
+			}
+
+#if defined(__cpp_lib_jthread)
+			// As above, cancelling the search once stop is requested;
+			// the future then gets no suggestions
+			std::future<std::vector<std::string> > suggest_async (std::string_view utf8word,
+									      std::stop_token stop,
+									      int timeout_ms = -1) {
+				auto promise = std::make_shared<std::promise<std::vector<std::string> > > ();
+				std::future<std::vector<std::string> > result = promise->get_future ();
+				start_suggest (utf8word, timeout_ms, [promise] (std::vector<std::string> suggs) {
+					promise->set_value (std::move (suggs));
+				})->cancel_on (std::move (stop));
+				return result;
+			}
+#endif
+
+#if defined(__cpp_lib_coroutine) && defined(__cpp_lib_jthread)
+			Awaitable<std::vector<std::string> > co_suggest (std::string_view utf8word,
+									 std::stop_token stop = std::stop_token (),
+									 int timeout_ms = -1) {
+				std::string word (utf8word);
+				return Awaitable<std::vector<std::string> > (
+					[this, word, stop, timeout_ms] (Awaitable<std::vector<std::string> > & awaitable) {
+						start_suggest (word, timeout_ms, [&awaitable] (std::vector<std::string> suggs) {
+							awaitable.set_value (std::move (suggs));
+						})->cancel_on (stop);
+					});
+			}
+#endif
+#else
 			void suggest (const std::string & utf8word, 
 				      std::vector<std::string> & out_suggestions) {
 				size_t n_suggs;
@@ -115,12 +664,56 @@ namespace enchant
 				suggest (utf8word, result);
 				return result;
 			}
-			
+#endif
+
+			std::vector<std::vector<std::string> > suggest_batch (const std::vector<std::string> & utf8words) {
+				std::vector<const char *> words;
+				std::vector<ssize_t> lens;
+				for (size_t i = 0; i < utf8words.size(); i++) {
+					words.push_back (utf8words[i].c_str());
+					lens.push_back (utf8words[i].size());
+				}
+
+				std::vector<size_t> n_suggs (utf8words.size());
+				char *** suggs_list = enchant_dict_suggest_batch (m_dict, words.data(), lens.data(),
+										  words.size(), n_suggs.data());
+
+				std::vector<std::vector<std::string> > result (utf8words.size());
+				if (suggs_list) {
+					for (size_t i = 0; i < result.size(); i++)
+						for (size_t j = 0; j < n_suggs[i]; j++)
+							result[i].push_back (suggs_list[i][j]);
+
+					enchant_dict_free_suggest_batch (m_dict, suggs_list);
+				}
+				return result;
+			}
+
+			std::vector<std::string> complete (const std::string & utf8prefix, size_t max_words = 0) {
+				size_t n_words = 0;
+				char ** words = enchant_dict_complete (m_dict, utf8prefix.c_str(), utf8prefix.size(),
+								       max_words, &n_words);
+
+				std::vector<std::string> result;
+				if (words) {
+					result.assign (words, words + n_words);
+					enchant_dict_free_string_list (m_dict, words);
+				}
+				return result;
+			}
+
 			void add (const std::string & utf8word) {
 				enchant_dict_add (m_dict, utf8word.c_str(), 
 							 utf8word.size());
 			}
 			
+			void add_many (const std::vector<std::string> & utf8words) {
+				std::vector<const char *> words;
+				for (size_t i = 0; i < utf8words.size(); i++)
+					words.push_back (utf8words[i].c_str());
+				enchant_dict_add_many (m_dict, words.data(), words.size());
+			}
+
 			void add_to_session (const std::string & utf8word) {
 				enchant_dict_add_to_session (m_dict, utf8word.c_str(), 
 							     utf8word.size());
@@ -174,6 +767,73 @@ namespace enchant
 			// space reserved for API/ABI expansion
 			void * _private[5];		       
 
+#if __cplusplus >= 201703L
+			// one enchant_dict_suggest_async call, kept until both it
+			// has called back and start_suggest has returned
+			struct SuggestCall
+				{
+					EnchantDict * dict;
+					EnchantSuggestRequest * request;
+					std::function<void (std::vector<std::string>)> done;
+#if defined(__cpp_lib_jthread)
+					std::optional<std::stop_callback<std::function<void ()> > > on_stop;
+
+					void cancel_on (std::stop_token stop) {
+						if (!stop.stop_possible ())
+							return;
+						EnchantDict * d = dict;
+						EnchantSuggestRequest * r = request;
+						on_stop.emplace (std::move (stop), std::function<void ()> ([d, r] () {
+							enchant_dict_cancel_suggest (d, r);
+						}));
+					}
+#endif
+
+					~SuggestCall () {
+#if defined(__cpp_lib_jthread)
+						on_stop.reset ();
+#endif
+						if (request)
+							enchant_dict_free_suggest_request (dict, request);
+					}
+				};
+
+			std::shared_ptr<SuggestCall> start_suggest (std::string_view utf8word, int timeout_ms,
+								   std::function<void (std::vector<std::string>)> done) {
+				std::shared_ptr<SuggestCall> call = std::make_shared<SuggestCall> ();
+				call->dict = m_dict;
+				call->request = 0;
+				call->done = std::move (done);
+
+				std::shared_ptr<SuggestCall> * held = new std::shared_ptr<SuggestCall> (call);
+				EnchantSuggestRequest * request =
+					enchant_dict_suggest_async (m_dict, utf8word.data() ? utf8word.data() : "",
+								    utf8word.size(), timeout_ms, s_suggest_fn, held);
+				if (!request) {
+					delete held;
+					throw enchant::Exception (enchant_dict_get_error (m_dict));
+				}
+				call->request = request;
+				return call;
+			}
+
+			static void s_suggest_fn (EnchantDict * dict, char ** suggs, size_t n_suggs,
+						  void * user_data) {
+				std::shared_ptr<SuggestCall> * held = static_cast<std::shared_ptr<SuggestCall> *> (user_data);
+				std::function<void (std::vector<std::string>)> done = std::move ((*held)->done);
+				delete held;
+
+				std::vector<std::string> result;
+				if (suggs) {
+					result.reserve (n_suggs);
+					for (size_t i = 0; i < n_suggs; i++)
+						result.push_back (suggs[i]);
+					enchant_dict_free_string_list (dict, suggs);
+				}
+				done (std::move (result));
+			}
+#endif
+
 			static void s_describe_fn (const char * const lang,
 						   const char * const provider_name,
 						   const char * const provider_desc,
@@ -187,6 +847,17 @@ namespace enchant
 				dict->m_provider_file = provider_file;
 			}
 
+#if __cplusplus >= 201703L
+			template <typename Fn>
+			static void s_misspelling_fn (EnchantDict *,
+						      const char * const word, size_t len,
+						      size_t offset, size_t char_offset, size_t char_len,
+						      void * user_data) {
+				Misspelling m = { std::string_view (word, len), offset, char_offset, char_len };
+				(*static_cast<typename std::remove_reference<Fn>::type *> (user_data)) (m);
+			}
+#endif
+
 			Dict (EnchantDict * dict, EnchantBroker * broker)
 				: m_dict (dict), m_broker (broker) {
 				enchant_dict_describe (m_dict, s_describe_fn, this);
@@ -206,6 +877,11 @@ namespace enchant
 			std::string m_provider_file;
 		}; // class enchant::Dict
 	
+	// A dictionary shared by whoever holds it, see
+	// Broker::request_shared_dict
+	typedef std::shared_ptr<Dict> SharedDict;
+
+	// Its methods may be called from several threads at once
 	class Broker
 		{
 			
@@ -231,6 +907,65 @@ namespace enchant
 				return new Dict (dict, m_broker);
 			}
 
+			// The tag stays valid as long as the broker does
+			EnchantTag * intern_tag (const std::string & lang) {
+				EnchantTag * tag = enchant_broker_intern_tag (m_broker, lang.c_str());
+
+				if (!tag) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+
+				return tag;
+			}
+
+			Dict * request_dict (EnchantTag * tag) {
+				EnchantDict * dict = enchant_broker_request_dict_by_tag (m_broker, tag);
+
+				if (!dict) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+
+				return new Dict (dict, m_broker);
+			}
+
+			// The same dictionary for all the requests for lang while
+			// any of them is held, and back to the broker's pool (see
+			// set_dict_pool) once none is, so that letting go of it does
+			// not mean loading it again next time.  The broker must
+			// outlive the dictionaries.
+			SharedDict request_shared_dict (const std::string & lang) {
+				{
+					std::lock_guard<std::mutex> lock (m_shared_lock);
+					std::map<std::string, std::weak_ptr<Dict> >::iterator it = m_shared.find (lang);
+					if (it != m_shared.end ()) {
+						SharedDict dict = it->second.lock ();
+						if (dict)
+							return dict;
+					}
+				}
+
+				// loaded unlocked, as loading may take a while
+				SharedDict dict (request_dict (lang));
+
+				std::lock_guard<std::mutex> lock (m_shared_lock);
+				std::weak_ptr<Dict> & shared = m_shared[lang];
+				SharedDict other = shared.lock ();
+				if (other)
+					return other;
+				shared = dict;
+
+				for (std::map<std::string, std::weak_ptr<Dict> >::iterator it = m_shared.begin ();
+				     it != m_shared.end ();) {
+					if (it->second.expired ())
+						m_shared.erase (it++);
+					else
+						++it;
+				}
+				return dict;
+			}
+
 			Dict * request_pwl_dict (const std::string & pwl) {
 				EnchantDict * dict = enchant_broker_request_pwl_dict (m_broker, pwl.c_str());
 				
@@ -242,6 +977,40 @@ namespace enchant
 				return new Dict (dict, m_broker);
 			}
 			
+			Dict * request_readonly_pwl_dict (const std::string & pwl) {
+				EnchantDict * dict = enchant_broker_request_readonly_pwl_dict (m_broker, pwl.c_str());
+				
+				if (!dict) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+				
+				return new Dict (dict, m_broker);
+			}
+			
+			Dict * request_overlay_dict (const std::string & lang, const std::string & user_dir) {
+				EnchantDict * dict = enchant_broker_request_overlay_dict (m_broker, lang.c_str(),
+											  user_dir.c_str());
+				
+				if (!dict) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+				
+				return new Dict (dict, m_broker);
+			}
+			
+			Dict * request_multi_dict (const std::string & langs) {
+				EnchantDict * dict = enchant_broker_request_multi_dict (m_broker, langs.c_str());
+				
+				if (!dict) {
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+					return 0; // never reached
+				}
+				
+				return new Dict (dict, m_broker);
+			}
+			
 			bool dict_exists (const std::string & lang) {
 				if (enchant_broker_dict_exists (m_broker, lang.c_str()))
 					return true;
@@ -260,13 +1029,153 @@ namespace enchant
 				enchant_broker_list_dicts (m_broker, fn, user_data);
 			}
 
+			void preload (const std::vector<std::string> & tags,
+				      EnchantPreloadFn fn = NULL, void * user_data = NULL) {
+				std::vector<const char *> c_tags;
+				for (size_t i = 0; i < tags.size(); i++)
+					c_tags.push_back (tags[i].c_str());
+				enchant_broker_preload (m_broker, c_tags.data(), c_tags.size(), fn, user_data);
+			}
+
+			void rescan () {
+				enchant_broker_rescan (m_broker);
+			}
+
+			void set_dict_pool (size_t max_dicts, int idle_timeout_ms = -1) {
+				enchant_broker_set_dict_pool (m_broker, max_dicts, idle_timeout_ms);
+			}
+
+			void set_executor (EnchantExecutorFn fn, void * user_data = NULL) {
+				enchant_broker_set_executor (m_broker, fn, user_data);
+			}
+
+			void set_worker_threads (int n_threads) {
+				enchant_broker_set_worker_threads (m_broker, n_threads);
+			}
+
+			void trim (int level) {
+				if (enchant_broker_trim (m_broker, level) != 0)
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+			}
+
+			void freeze () {
+				enchant_broker_freeze (m_broker);
+			}
+
+			bool reload_dict (const std::string & lang) {
+				int result = enchant_broker_reload_dict (m_broker, lang.c_str());
+				if (result < 0)
+					throw enchant::Exception (enchant_broker_get_error (m_broker));
+				return result == 1;
+			}
+
+#if __cplusplus >= 201703L
+			// Loads the dictionary on a background thread, through
+			// enchant_broker_preload
+			std::future<Dict *> request_dict_async (const std::string & lang) {
+				auto promise = std::make_shared<std::promise<Dict *> > ();
+				std::future<Dict *> result = promise->get_future ();
+				start_request (lang, [promise] (Dict * dict, std::exception_ptr error) {
+					if (error)
+						promise->set_exception (error);
+					else
+						promise->set_value (dict);
+				});
+				return result;
+			}
+
+#if defined(__cpp_lib_jthread)
+			// As above, failing with an enchant::Exception if stop is
+			// requested before the dictionary is in.  A dictionary loaded
+			// meanwhile stays with the broker, for its next request.
+			std::future<Dict *> request_dict_async (const std::string & lang, std::stop_token stop) {
+				auto promise = std::make_shared<std::promise<Dict *> > ();
+				std::future<Dict *> result = promise->get_future ();
+				start_request (lang, [promise] (Dict * dict, std::exception_ptr error) {
+					if (error)
+						promise->set_exception (error);
+					else
+						promise->set_value (dict);
+				}, std::move (stop));
+				return result;
+			}
+#endif
+
+#if defined(__cpp_lib_coroutine) && defined(__cpp_lib_jthread)
+			Awaitable<Dict *> co_request_dict (const std::string & lang,
+							  std::stop_token stop = std::stop_token ()) {
+				return Awaitable<Dict *> ([this, lang, stop] (Awaitable<Dict *> & awaitable) {
+					start_request (lang, [&awaitable] (Dict * dict, std::exception_ptr error) {
+						if (error)
+							awaitable.set_exception (error);
+						else
+							awaitable.set_value (dict);
+					}, stop);
+				});
+			}
+#endif
+#endif
+
 		private:
 
 			// not implemented
 			Broker (const Broker & rhs);
 			Broker& operator=(const Broker & rhs);
+
+#if __cplusplus >= 201703L
+			struct RequestCall
+				{
+					EnchantBroker * broker;
+					std::function<void (Dict *, std::exception_ptr)> done;
+#if defined(__cpp_lib_jthread)
+					std::stop_token stop;
+#endif
+				};
+
+#if defined(__cpp_lib_jthread)
+			void start_request (const std::string & lang,
+					    std::function<void (Dict *, std::exception_ptr)> done,
+					    std::stop_token stop = std::stop_token ()) {
+#else
+			void start_request (const std::string & lang,
+					    std::function<void (Dict *, std::exception_ptr)> done) {
+#endif
+				if (lang.empty ())
+					throw enchant::Exception ("no language tag");
+
+				RequestCall * call = new RequestCall;
+				call->broker = m_broker;
+				call->done = std::move (done);
+#if defined(__cpp_lib_jthread)
+				call->stop = std::move (stop);
+#endif
+				const char * tags[] = { lang.c_str () };
+				enchant_broker_preload (m_broker, tags, 1, s_preload_fn, call);
+			}
+
+			static void s_preload_fn (const char * const lang_tag, int, void * user_data) {
+				std::unique_ptr<RequestCall> call (static_cast<RequestCall *> (user_data));
+
+#if defined(__cpp_lib_jthread)
+				if (call->stop.stop_requested ()) {
+					call->done (0, std::make_exception_ptr (enchant::Exception ("cancelled")));
+					return;
+				}
+#endif
+				// takes over the dictionary just preloaded
+				EnchantDict * dict = enchant_broker_request_dict (call->broker, lang_tag);
+				if (!dict)
+					call->done (0, std::make_exception_ptr (
+						    enchant::Exception (enchant_broker_get_error (call->broker))));
+				else
+					call->done (new Dict (dict, call->broker), std::exception_ptr ());
+			}
+#endif
 			
 			EnchantBroker * m_broker;
+
+			std::mutex m_shared_lock;
+			std::map<std::string, std::weak_ptr<Dict> > m_shared;
 		}; // class enchant::Broker
 } // enchant namespace
 
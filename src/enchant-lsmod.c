@@ -72,21 +72,82 @@ describe_provider (const char * name,
 	printf ("%s (%s)\n", name, desc);
 }
 
+static void
+ignore_provider (const char * name _GL_UNUSED_PARAMETER,
+		 const char * desc _GL_UNUSED_PARAMETER,
+		 const char * file _GL_UNUSED_PARAMETER,
+		 void * user_data _GL_UNUSED_PARAMETER)
+{
+}
+
+static void
+add_load_times (const char * const provider_name _GL_UNUSED_PARAMETER,
+		const char * const provider_dll_file _GL_UNUSED_PARAMETER,
+		int64_t open_us, int64_t init_us, int64_t configure_us,
+		void * user_data)
+{
+	*(int64_t *)user_data += open_us + MAX (init_us, 0) + MAX (configure_us, 0);
+}
+
+static void
+describe_load_times (const char * const provider_name,
+		     const char * const provider_dll_file,
+		     int64_t open_us, int64_t init_us, int64_t configure_us,
+		     void * user_data _GL_UNUSED_PARAMETER)
+{
+	printf ("%s (%s): open %.3f ms", provider_name ? provider_name : "not loaded",
+		provider_dll_file, open_us / 1000.0);
+	if (init_us >= 0)
+		printf (", init %.3f ms", init_us / 1000.0);
+	if (configure_us >= 0)
+		printf (", configure %.3f ms", configure_us / 1000.0);
+	putchar ('\n');
+}
+
+/* -timings: how long setting up the broker, loading the provider
+ * modules and requesting dict took */
+static void
+print_timings (EnchantBroker * broker, EnchantDict * dict, gint64 broker_init_us, gint64 request_us)
+{
+	int64_t modules_us = 0;
+	gint64 start;
+
+	/* only the modules tried for dict are loaded so far */
+	enchant_broker_describe_load_times (broker, add_load_times, &modules_us);
+
+	/* the personal word lists are read when first needed */
+	start = g_get_monotonic_time ();
+	enchant_dict_check (dict, "enchant", -1);
+	gint64 pwl_us = g_get_monotonic_time () - start;
+
+	printf ("broker init: %.3f ms\n", broker_init_us / 1000.0);
+	enchant_dict_describe (dict, describe_dict, NULL);
+	printf ("dictionary request: %.3f ms, of which provider modules %.3f ms, dictionary %.3f ms\n",
+		request_us / 1000.0, modules_us / 1000.0, MAX (request_us - modules_us, 0) / 1000.0);
+	printf ("personal word lists: %.3f ms\n", pwl_us / 1000.0);
+
+	/* load the other modules too, so that each is told about */
+	enchant_broker_describe (broker, ignore_provider, NULL);
+	enchant_broker_describe_load_times (broker, describe_load_times, NULL);
+}
+
 static void
 usage (const char *progname)
 {
-	fprintf (stderr, "%s [[-lang|-word-chars] [language_tag]|-list-dicts|-help|-version]\n", progname);
+	fprintf (stderr, "%s [[-lang|-word-chars|-timings] [language_tag]|-list-dicts|-help|-version]\n", progname);
 }
 
 int
 main (int argc, char **argv)
 {
+	gint64 start = g_get_monotonic_time ();
 	EnchantBroker *broker = enchant_broker_init ();
+	gint64 broker_init_us = g_get_monotonic_time () - start;
 	char * lang_tag = NULL;
 	int retcode = 0;
 
 	if (argc > 1) {
-		if (!strcmp (argv[1], "-lang") || !strcmp(argv[1], "-word-chars")) {
+		if (!strcmp (argv[1], "-lang") || !strcmp(argv[1], "-word-chars") || !strcmp (argv[1], "-timings")) {
 			if (argc > 2) {
 				lang_tag = strdup (argv[2]);
 			} else {
@@ -101,10 +162,15 @@ main (int argc, char **argv)
 				fprintf (stderr, "Error: language tag not specified and environment variable $LANG not set\n");
 				retcode = 1;
 			} else {
+				start = g_get_monotonic_time ();
 				EnchantDict *dict = enchant_broker_request_dict (broker, lang_tag);
+				gint64 request_us = g_get_monotonic_time () - start;
 				if (!dict) {
 					fprintf (stderr, "No dictionary available for '%s'\n", lang_tag);
 					retcode = 1;
+				} else if (!strcmp (argv[1], "-timings")) {
+					print_timings (broker, dict, broker_init_us, request_us);
+					enchant_broker_free_dict (broker, dict);
 				} else {
 					enchant_dict_describe (dict,
 							       !strcmp (argv[1], "-lang") ? describe_dict : describe_word_chars,
@@ -70,6 +70,18 @@ GSList *enchant_get_conf_dirs (void);
 ENCHANT_MODULE_EXPORT
 char *enchant_get_prefix_dir(void);
 
+/**
+ * enchant_dir_stamp
+ * @dir: A non-null path to a directory or file
+ *
+ * Returns: the modification time of @dir in nanoseconds, as far as
+ * the system keeps it, or -1 if it cannot be found.  Providers that
+ * keep what is in their dictionary directories look at them again
+ * once this changes.
+ */
+ENCHANT_MODULE_EXPORT
+gint64 enchant_dir_stamp (const char * dir);
+
 /**
  * enchant_relocate
  *
@@ -90,6 +102,17 @@ char *enchant_relocate (const char *path);
  */
 void enchant_dict_set_error (EnchantDict * dict, const char * const err);
 
+/**
+ * enchant_dict_set_suggest_partial
+ * @dict: A non-null dictionary
+ *
+ * Tells that the suggestions the calling thread's suggest or
+ * suggest_bounded call on @dict is about to return are short of what
+ * the backend could find, see enchant_dict_get_suggest_partial.  This
+ * API is private to the providers.
+ */
+void enchant_dict_set_suggest_partial (EnchantDict * dict);
+
 /**
  * enchant_provider_set_error
  * @provider: A non-null provider
@@ -130,6 +153,41 @@ struct str_enchant_dict
 
 	int (*is_word_character) (struct str_enchant_dict * me,
 				  uint32_t uc_in, size_t n);
+
+	/* extensions, see ENCHANT_PROVIDER_ABI_VERSION */
+
+	/* optional, checks n words as check would each of them into
+	 * results; check must be set as well */
+	void (*check_batch) (struct str_enchant_dict * me,
+			     const char *const *words, const size_t *lens,
+			     size_t n, int *results);
+
+	/* optional, suggests as suggest would, hinted at the most
+	 * suggestions wanted and their greatest edit distance (0 and -1
+	 * for no limit), and the milliseconds left to find them in (-1
+	 * for no limit); a backend that cannot keep to the time may
+	 * return nothing, or what a cheaper search finds, telling so with
+	 * enchant_dict_set_suggest_partial; suggest must be set as well */
+	char **(*suggest_bounded) (struct str_enchant_dict * me,
+				   const char *const word, size_t len,
+				   size_t max_suggs, int max_distance, int timeout_ms,
+				   size_t * out_n_suggs);
+
+	/* version 2 */
+
+	/* optional, estimates the bytes the dictionary takes up that no
+	 * other dictionary shares, for enchant_dict_get_memory_usage */
+	size_t (*get_memory_usage) (struct str_enchant_dict * me);
+
+	/* version 3 */
+
+	/* optional, chooses how much of its search suggest and
+	 * suggest_bounded do: "fast", "balanced", the default, or
+	 * "thorough", for enchant_dict_set_suggest_profile; a clone
+	 * suggests as the dictionary it was made from does.  Returns 0,
+	 * or -1 for a profile it does not know */
+	int (*set_suggest_profile) (struct str_enchant_dict * me,
+				    const char *const profile);
 };
 	
 struct str_enchant_provider
@@ -156,8 +214,51 @@ struct str_enchant_provider
 
 	char ** (*list_dicts) (struct str_enchant_provider * me,
 			       size_t * out_n_dicts);
+
+	/* extensions, see ENCHANT_PROVIDER_ABI_VERSION */
+
+	/* ENCHANT_PROVIDER_* flags, set by the provider's init function */
+	unsigned int flags;
+
+	/* optional, returns the directories list_dicts looks in; while
+	 * none of them changes, list_dicts is not called again and what
+	 * it returned before is used instead */
+	char ** (*list_dict_dirs) (struct str_enchant_provider * me,
+				   size_t * out_n_dirs);
+
+	/* optional, returns another dictionary that checks and suggests
+	 * as dict does, to be disposed of with dispose_dict; dict may be in
+	 * use by another thread meanwhile.  Enchant hands a clone to a
+	 * thread that would otherwise wait for its turn at dict, unless
+	 * dict can have words added to it. */
+	EnchantDict * (*clone_dict) (struct str_enchant_provider * me,
+				     EnchantDict * dict);
 };
 
+/* The provider and its dictionaries may each be called from several
+ * threads at once; otherwise Enchant makes the calls into a dictionary
+ * take turns, and likewise those into the provider itself.
+ * get_extra_word_characters and is_word_character are always called
+ * without taking turns. */
+#define ENCHANT_PROVIDER_THREAD_SAFE (1 << 0)
+
+/* The version of the structures above a provider module is built
+ * against, which it tells by exporting enchant_provider_abi_version
+ * alongside init_enchant_provider.  Modules built before there were
+ * extensions allocate structures that end where they start, so Enchant
+ * reads no extension member from a module that does not export it,
+ * nor one added in a later version than the module tells. */
+#define ENCHANT_PROVIDER_ABI_VERSION 3
+
+/**
+ * enchant_provider_abi_version
+ *
+ * Implemented by the provider module, next to init_enchant_provider.
+ *
+ * Returns: ENCHANT_PROVIDER_ABI_VERSION as the module was built with
+ */
+unsigned int enchant_provider_abi_version (void);
+
 #ifdef __cplusplus
 }
 #endif
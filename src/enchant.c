@@ -45,21 +45,56 @@
 #ifdef _WIN32
 #include <windows.h>
 #endif
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#if defined (__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define BENCH_HEAP_IN_USE 1
+#endif
 
 #include "enchant.h"
 #include "enchant-provider.h"
+#include "unused-parameter.h"
 
 
 /* word has to be bigger than this to be checked */
 #define MIN_WORD_LENGTH 1
 
+/* bytes stdio reads and writes at a time */
+#define STDIO_BUFFER_SIZE 65536
+
+/* lines handed to a worker at a time with -j */
+#define LINES_PER_CHUNK 4096
+
+/* misspellings -a remembers the suggestions for, at most */
+#define SUGGEST_CACHE_SIZE 4096
+
+/* connections waiting for the server to accept them */
+#define SERVER_BACKLOG 64
+
+/* dictionaries the server keeps loaded once no client uses them */
+#define SERVER_DICT_POOL 16
+
+/* words in a frame of the batch protocol, at most */
+#define MAX_BATCH_WORDS 65536
+
 static const char *charset;
+static GIConv charset_to_utf8 = (GIConv) -1;	/* unless charset is UTF-8 already */
+static gboolean locale_is_utf8;	/* what is printed needs no converting */
 
 typedef enum 
 	{
 		MODE_NONE,
 		MODE_A,
-		MODE_L
+		MODE_L,
+		MODE_JSON
 	} IspellMode_t;
 
 static void 
@@ -73,222 +108,453 @@ static void
 print_help (const char * prog)
 {
 	fprintf (stderr,
-		 "Usage: %s -a|-l|-h|-v [-L] [-d DICTIONARY] [FILE]\n\
+		 "Usage: %s -a|-l|-J|-h|-v [-L] [-r] [-j JOBS] [-d DICTIONARY] [FILE]...\n\
+       %s --server SOCKET [-d DICTIONARY]\n\
+       %s --stats SOCKET\n\
+       %s --bench [-a] [-d DICTIONARY] FILE\n\
   -d DICTIONARY  use the given dictionary\n\
   -a             list suggestions in ispell pipe mode format\n\
   -l             list only the misspellings\n\
+  -J             list the misspellings as JSON, one object per line\n\
   -L             display line numbers\n\
+  -r             check the files in directories given, and below\n\
+  -j JOBS        check JOBS files at a time, or with -l and one input,\n\
+                 check it on JOBS threads\n\
   -h             display help and exit\n\
-  -v             display version information and exit\n", prog);
+  -v             display version information and exit\n\
+  --server SOCKET  answer -a and batch clients on a Unix socket\n\
+  --stats SOCKET   print the statistics of the server on a Unix socket\n\
+  --bench        time checking the words of FILE, with -a suggesting too\n", prog, prog, prog, prog);
 }
 
+/* Reads a line, a buffer-full at a time, into str without its line
+ * ending, converting it to UTF-8 with to_utf8 unless that is -1;
+ * returns TRUE if it was the last one */
 static gboolean
-consume_line (FILE * in, GString * str)
+consume_line (FILE * in, GIConv to_utf8, GString * str)
 {
-	int ch;
+	char buf[4096];
 	gsize bytes_read, bytes_written;
 	gchar * utf;
 	gboolean ret = TRUE;
 
 	g_string_truncate (str, 0);
 
-	while (ret && (ch = fgetc (in)) != EOF) {
-		if (ch == '\r')
-			continue;
-		else {
-			if (ch == '\n')
-				ret = FALSE;
-			else
-				g_string_append_c (str, ch);
+	while (fgets (buf, sizeof (buf), in)) {
+		size_t len = strlen (buf);
+		if (len && buf[len - 1] == '\n') {
+			g_string_append_len (str, buf, len - 1);
+			ret = FALSE;
+			break;
 		}
+		g_string_append_len (str, buf, len);
 	}
 
-	if (str->len) {
-		utf = g_convert(str->str, str->len, "UTF-8", charset, &bytes_read, &bytes_written, NULL);
+	if (memchr (str->str, '\r', str->len)) {
+		gsize kept = 0;
+		for (gsize i = 0; i < str->len; i++)
+			if (str->str[i] != '\r')
+				str->str[kept++] = str->str[i];
+		g_string_truncate (str, kept);
+	}
+
+	if (str->len && to_utf8 != (GIConv) -1) {
+		utf = g_convert_with_iconv (str->str, str->len, to_utf8, &bytes_read, &bytes_written, NULL);
 		if (utf) {
 			g_string_assign (str, utf);
 			g_free (utf);
-		} 
-		/* Else str->str stays the same. we'll assume that it's 
-		   already utf8 and glib is just being stupid. */
+		} else {
+			/* str->str stays the same. we'll assume that it's 
+			   already utf8 and glib is just being stupid. The
+			   converter starts over for the next line. */
+			g_iconv (to_utf8, NULL, NULL, NULL, NULL);
+		}
 	}
 
 	return ret;
 }
 
+/* Appends str to out as a JSON string */
 static void
-print_utf (const char * str)
+append_json_string (GString * out, const char * str, size_t len)
+{
+	g_string_append_c (out, '"');
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		if (c == '"' || c == '\\') {
+			g_string_append_c (out, '\\');
+			g_string_append_c (out, c);
+		} else if (c < 0x20)
+			g_string_append_printf (out, "\\u%04x", c);
+		else
+			g_string_append_c (out, c);
+	}
+	g_string_append_c (out, '"');
+}
+
+/* Appends str to out in the locale's charset */
+static void
+append_utf (GString * out, const char * str, size_t len)
 {
 	gsize bytes_read, bytes_written;
 	gchar * native;
 
-	native = g_locale_from_utf8 (str, -1, &bytes_read, &bytes_written, NULL);
+	if (locale_is_utf8) {
+		g_string_append_len (out, str, len);
+		return;
+	}
+
+	native = g_locale_from_utf8 (str, len, &bytes_read, &bytes_written, NULL);
 	if (native) {
-		fwrite (native, 1, bytes_written, stdout);
+		g_string_append_len (out, native, bytes_written);
 		g_free (native);
 	} else {
 		/* Assume that it's already utf8 and glib is just being stupid. */
-		printf ("%s", str);
+		g_string_append_len (out, str, len);
 	}
 }
 
+/* The bounds of the server's latency histograms, in microseconds, as
+ * named by the counters of enchant_broker_get_stats */
+static const gint64 latency_bounds_us[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+#define N_LATENCY_BOUNDS G_N_ELEMENTS (latency_bounds_us)
+
+/* What the server did for the clients of a dictionary, for "stats" */
+typedef struct
+{
+	GMutex * lock;		/* the server's, held while counting */
+	char * tag;
+	char * provider;
+	guint64 requests;
+	guint64 words;
+	guint64 request_us;
+	guint64 within[N_LATENCY_BOUNDS];	/* requests answered within each bound */
+} ServerTag;
+
+/* Counts a request for n_words words that started at start */
 static void
-do_mode_a (EnchantDict * dict, GString * word, size_t start_pos, size_t lineCount, gboolean terse_mode)
+server_tag_count (ServerTag * tag, guint64 n_words, gint64 start)
+{
+	gint64 us = g_get_monotonic_time () - start;
+
+	g_mutex_lock (tag->lock);
+	tag->requests++;
+	tag->words += n_words;
+	tag->request_us += us;
+	for (guint i = 0; i < N_LATENCY_BOUNDS; i++)
+		if (us <= latency_bounds_us[i])
+			tag->within[i]++;
+	g_mutex_unlock (tag->lock);
+}
+
+/* The words a client of the server accepted or rejected for its own
+ * session, kept out of the dictionary it shares with the others */
+typedef struct
+{
+	GHashTable * accepted;
+	GHashTable * rejected;
+	ServerTag * tag;	/* where the lines it sends are counted */
+} ClientSession;
+
+/* Checks word as enchant_dict_check does, heeding client's session
+ * if there is one */
+static int
+check_word (EnchantDict * dict, ClientSession * client, const char * word, size_t len)
+{
+	if (client && (g_hash_table_size (client->accepted) || g_hash_table_size (client->rejected))) {
+		char * key = g_strndup (word, len);
+		int val = -1;
+
+		if (g_hash_table_contains (client->rejected, key))
+			val = 1;
+		else if (g_hash_table_contains (client->accepted, key))
+			val = 0;
+		g_free (key);
+		if (val >= 0)
+			return val;
+	}
+
+	return enchant_dict_check (dict, word, len);
+}
+
+/* The do_mode_ functions print what their mode prints for a word and
+ * return TRUE if it is misspelled */
+static gboolean
+do_mode_a (GString * out, EnchantDict * dict, ClientSession * client, const char * word, size_t len, size_t start_pos, size_t lineCount, gboolean terse_mode)
 {
 	size_t n_suggs;
 	char ** suggs;	
 
-	if (word->len <= MIN_WORD_LENGTH || enchant_dict_check (dict, word->str, word->len) == 0) {
+	if (len <= MIN_WORD_LENGTH || check_word (dict, client, word, len) == 0) {
 		if (!terse_mode) {
 			if (lineCount)
-				printf ("* %u\n", (unsigned int)lineCount);
+				g_string_append_printf (out, "* %u\n", (unsigned int)lineCount);
 			else
-				printf ("*\n");
+				g_string_append (out, "*\n");
 		}
+		return FALSE;
 	}
 	else {
-		suggs = enchant_dict_suggest (dict, word->str, 
-					      word->len, &n_suggs);
+		suggs = enchant_dict_suggest (dict, word, len, &n_suggs);
 		if (!n_suggs || !suggs) {
-			printf ("# ");
+			g_string_append (out, "# ");
 			if (lineCount)
-				printf ("%u ", (unsigned int)lineCount);
-			print_utf (word->str);
-			printf (" %u\n", (unsigned int)start_pos);
+				g_string_append_printf (out, "%u ", (unsigned int)lineCount);
+			append_utf (out, word, len);
+			g_string_append_printf (out, " %u\n", (unsigned int)start_pos);
 		}
 		else {
 			size_t i = 0;
 			
-			printf ("& ");
+			g_string_append (out, "& ");
 			if (lineCount)
-				printf ("%u ", (unsigned int)lineCount);
-			print_utf (word->str);
-			printf (" %u %u:", (unsigned int)n_suggs, (unsigned int)start_pos);
+				g_string_append_printf (out, "%u ", (unsigned int)lineCount);
+			append_utf (out, word, len);
+			g_string_append_printf (out, " %u %u:", (unsigned int)n_suggs, (unsigned int)start_pos);
 			
 			for (i = 0; i < n_suggs; i++) {
-				putchar (' ');
-				print_utf (suggs[i]);
+				g_string_append_c (out, ' ');
+				append_utf (out, suggs[i], strlen (suggs[i]));
 
 				if (i != (n_suggs - 1))
-					putchar(',');
+					g_string_append_c (out, ',');
 				else
-					putchar('\n');
+					g_string_append_c (out, '\n');
 			}
 
 			enchant_dict_free_string_list (dict, suggs);
 		}
+		return TRUE;
 	}
 }
 
-static void
-do_mode_l (EnchantDict * dict, GString * word, size_t lineCount)
+static gboolean
+do_mode_l (GString * out, EnchantDict * dict, const char * word, size_t len, size_t lineCount)
 {
-	if (enchant_dict_check (dict, word->str, word->len) != 0) {
+	if (enchant_dict_check (dict, word, len) != 0) {
 		if (lineCount)
-			printf ("%u ", (unsigned int)lineCount);
-		print_utf (word->str);
-		putchar ('\n');
+			g_string_append_printf (out, "%u ", (unsigned int)lineCount);
+		append_utf (out, word, len);
+		g_string_append_c (out, '\n');
+		return TRUE;
 	}
+	return FALSE;
 }
 
-
-/* Splits a line into a set of (word,word_position) tuples. */
-static GSList *
-tokenize_line (EnchantDict * dict, GString * line)
+/* -J: a misspelling and where it is, its offsets counted in bytes and
+ * in characters from the start of its line */
+static gboolean
+do_mode_json (GString * out, EnchantDict * dict, const char * word, size_t len,
+	      size_t byte_offset, size_t char_offset, size_t lineCount)
 {
-	GSList * tokens = NULL;
-	gchar *utf = (char *) line->str;
-	size_t cur_pos = 0;
-	size_t start_pos = 0;
-	GString * word = g_string_new (NULL);
+	size_t n_suggs;
+	char ** suggs;
 
-	while (cur_pos < line->len && *utf) {
-		gunichar uc;
+	if (len <= MIN_WORD_LENGTH || enchant_dict_check (dict, word, len) == 0)
+		return FALSE;
 
-	        /* Skip non-word characters. */
-		cur_pos = g_utf8_pointer_to_offset ((const char*)line->str, utf);
-		uc = g_utf8_get_char (utf);
-		while (cur_pos < line->len && *utf && !enchant_dict_is_word_character (dict, uc, 0)) {
-		        utf = g_utf8_next_char (utf);
-			uc = g_utf8_get_char (utf);
-			cur_pos = g_utf8_pointer_to_offset ((const char*)line->str, utf);
-		}
-		start_pos = cur_pos;
-
-		/* Skip over word characters. */
-		while (cur_pos < line->len && *utf && enchant_dict_is_word_character (dict, uc, 1)) {
-			g_string_append_unichar (word, uc);
-		        utf = g_utf8_next_char (utf);
-			uc = g_utf8_get_char (utf);
-			cur_pos = g_utf8_pointer_to_offset ((const char*)line->str, utf);
+	g_string_append_printf (out, "{\"line\":%u,\"byte_offset\":%u,\"char_offset\":%u,\"word\":",
+				(unsigned int)lineCount, (unsigned int)byte_offset, (unsigned int)char_offset);
+	append_json_string (out, word, len);
+	g_string_append (out, ",\"suggestions\":[");
+	suggs = enchant_dict_suggest (dict, word, len, &n_suggs);
+	if (suggs) {
+		for (size_t i = 0; i < n_suggs; i++) {
+			if (i)
+				g_string_append_c (out, ',');
+			append_json_string (out, suggs[i], strlen (suggs[i]));
 		}
+		enchant_dict_free_string_list (dict, suggs);
+	}
+	g_string_append (out, "]}\n");
+	return TRUE;
+}
 
-	        /* Skip backwards over any characters that can't appear at the end of a word. */
-	        for (gchar *i_utf = word->str + word->len;
-		     (i_utf = g_utf8_find_prev_char (word->str, i_utf)) != NULL;
-		     g_string_truncate (word, i_utf - word->str)) {
-			uc = g_utf8_get_char (i_utf);
-			if (enchant_dict_is_word_character(dict, uc, 2))
-				break;
-		}
+/* A word of a line, pointing into it */
+typedef struct
+{
+	const char * word;
+	size_t len;
+	size_t char_offset;
+} Token;
+
+static void
+add_token (EnchantDict * dict _GL_UNUSED_PARAMETER, const char * const word, size_t len,
+	   size_t offset _GL_UNUSED_PARAMETER, size_t char_offset,
+	   size_t char_len _GL_UNUSED_PARAMETER, void * user_data)
+{
+	Token token = { word, len, char_offset };
+	g_array_append_val ((GArray *) user_data, token);
+}
+
+/* Splits a line into its words the way enchant_dict_check_text does,
+ * replacing what tokens held before. */
+static void
+tokenize_line (EnchantDict * dict, GString * line, GArray * tokens)
+{
+	g_array_set_size (tokens, 0);
+	enchant_dict_split_text (dict, line->str, line->len, add_token, tokens);
+}
+
+/* Lines of the input checked by one worker with -j, and what -l prints
+ * for them, in order */
+typedef struct
+{
+	GPtrArray * lines;
+	size_t first_line;	/* the number of the first line, or 0 without -L */
+	GString * out;
+	gboolean done;
+} Chunk;
+
+typedef struct
+{
+	EnchantDict * dict;
+	GMutex lock;	/* guards the chunks' done */
+	GCond chunk_done;
+} ParallelCheck;
+
+/* Does -l for the lines of a chunk, checking all their words in one go */
+static void
+check_chunk (gpointer data, gpointer user_data)
+{
+	Chunk * chunk = (Chunk *) data;
+	ParallelCheck * check = (ParallelCheck *) user_data;
+	GArray * tokens = g_array_new (FALSE, FALSE, sizeof (Token));
+	guint * first_token = g_new (guint, chunk->lines->len + 1);
+
+	for (guint i = 0; i < chunk->lines->len; i++) {
+		const char * line = g_ptr_array_index (chunk->lines, i);
+		first_token[i] = tokens->len;
+		enchant_dict_split_text (check->dict, line, -1, add_token, tokens);
+	}
+	first_token[chunk->lines->len] = tokens->len;
 
-		/* Save (word, position) tuple. */
-                if (word->len) {
-		        tokens = g_slist_append (tokens, g_string_new_len (word->str, word->len));
-			tokens = g_slist_append (tokens, GINT_TO_POINTER(start_pos));
-			g_string_truncate (word, 0);
+	const char ** words = g_new (const char *, MAX (tokens->len, 1));
+	ssize_t * lens = g_new (ssize_t, MAX (tokens->len, 1));
+	int * results = g_new (int, MAX (tokens->len, 1));
+	for (guint j = 0; j < tokens->len; j++) {
+		words[j] = g_array_index (tokens, Token, j).word;
+		lens[j] = g_array_index (tokens, Token, j).len;
+	}
+	enchant_dict_check_batch (check->dict, words, lens, tokens->len, results);
+
+	for (guint i = 0; i < chunk->lines->len; i++) {
+		const char * line = g_ptr_array_index (chunk->lines, i);
+		if (!*line)
+			continue;
+		if (first_token[i] == first_token[i + 1])
+			g_string_append_c (chunk->out, '\n');
+		for (guint j = first_token[i]; j < first_token[i + 1]; j++) {
+			if (results[j] == 0)
+				continue;
+			if (chunk->first_line)
+				g_string_append_printf (chunk->out, "%u ", (unsigned int)(chunk->first_line + i));
+			append_utf (chunk->out, words[j], lens[j]);
+			g_string_append_c (chunk->out, '\n');
 		}
 	}
-	g_string_free (word, TRUE);
 
-	return tokens;
+	g_free (words);
+	g_free (lens);
+	g_free (results);
+	g_free (first_token);
+	g_array_free (tokens, TRUE);
+
+	g_mutex_lock (&check->lock);
+	chunk->done = TRUE;
+	g_cond_broadcast (&check->chunk_done);
+	g_mutex_unlock (&check->lock);
 }
 
-static int
-parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary)
+/* Waits for the chunk to be checked, then prints what it found and
+ * frees it */
+static void
+write_chunk (ParallelCheck * check, Chunk * chunk)
 {
-	EnchantBroker * broker;
-	EnchantDict * dict;
-	
-	GString * str, * word = NULL;
-	GSList * tokens, *token_ptr;
-	gchar * lang;
-	size_t pos, lineCount = 0;
+	g_mutex_lock (&check->lock);
+	while (!chunk->done)
+		g_cond_wait (&check->chunk_done, &check->lock);
+	g_mutex_unlock (&check->lock);
 
-	gboolean was_last_line = FALSE, corrected_something = FALSE, terse_mode = FALSE;
+	fwrite (chunk->out->str, 1, chunk->out->len, stdout);
+	g_ptr_array_free (chunk->lines, TRUE);
+	g_string_free (chunk->out, TRUE);
+	g_free (chunk);
+}
 
-	if (mode == MODE_A)
-		print_version (stdout);
+/* -l on n_jobs threads: the input is handed out a chunk of lines at a
+ * time, and what is found is printed in the order of the input */
+static void
+parse_file_in_parallel (FILE * in, EnchantDict * dict, gboolean countLines, guint n_jobs)
+{
+	ParallelCheck check;
+	check.dict = dict;
+	g_mutex_init (&check.lock);
+	g_cond_init (&check.chunk_done);
 
-	if (dictionary)
-		lang = strdup (dictionary);
-	else {
-	        lang = enchant_get_user_language();
-		if(!lang)
-			return 1;
- 	}
+	GThreadPool * pool = g_thread_pool_new (check_chunk, &check, n_jobs, FALSE, NULL);
+	GQueue pending = G_QUEUE_INIT;
+	GString * str = g_string_new (NULL);
+	size_t lineCount = 0;
+	gboolean was_last_line = FALSE;
 
-	/* Enchant will get rid of trailing information like de_DE@euro or de_DE.ISO-8859-15 */
-	
-	broker = enchant_broker_init ();
-	dict = enchant_broker_request_dict (broker, lang);
+	while (!was_last_line) {
+		Chunk * chunk = g_new0 (Chunk, 1);
+		chunk->lines = g_ptr_array_new_with_free_func (g_free);
+		chunk->first_line = countLines ? lineCount + 1 : 0;
+		chunk->out = g_string_new (NULL);
+		while (!was_last_line && chunk->lines->len < LINES_PER_CHUNK) {
+			was_last_line = consume_line (in, charset_to_utf8, str);
+			lineCount++;
+			g_ptr_array_add (chunk->lines, g_strndup (str->str, str->len));
+		}
 
-	if (!dict) {
-		fprintf (stderr, "Couldn't create a dictionary for %s\n", lang);
-		free (lang);
-		enchant_broker_free (broker);
-		return 1;
+		g_queue_push_tail (&pending, chunk);
+		g_thread_pool_push (pool, chunk, NULL);
+
+		/* keep a couple of chunks queued for each worker, but no more */
+		while (g_queue_get_length (&pending) > 2 * n_jobs ||
+		       (was_last_line && !g_queue_is_empty (&pending)))
+			write_chunk (&check, g_queue_pop_head (&pending));
 	}
 
-	free (lang);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_string_free (str, TRUE);
+	g_mutex_clear (&check.lock);
+	g_cond_clear (&check.chunk_done);
+}
+
+/* Words checked and found misspelled */
+typedef struct
+{
+	size_t words;
+	size_t misspelled;
+} Counts;
+
+/* Does -a, -l or -J for what comes from in, converted with to_utf8,
+ * printing to to a line at a time, or if to is NULL gathering it all in
+ * out; what is checked is added to counts unless that is NULL */
+static void
+check_stream (FILE * in, GIConv to_utf8, FILE * to, GString * out, EnchantDict * dict,
+	      IspellMode_t mode, gboolean countLines, ClientSession * client, Counts * counts)
+{
+	GString * str;
+	GArray * tokens;
+	size_t lineCount = 0;
+
+	gboolean was_last_line = FALSE, corrected_something = FALSE, terse_mode = FALSE;
 
 	str = g_string_new (NULL);
+	tokens = g_array_new (FALSE, FALSE, sizeof (Token));
 	
 	while (!was_last_line) {
 		gboolean mode_A_no_command = FALSE;
-		was_last_line = consume_line (in, str);
+		guint n_line_words = 0;
+		was_last_line = consume_line (in, to_utf8, str);
+		gint64 start = client && client->tag ? g_get_monotonic_time () : 0;
 
-		if (countLines)
+		/* -J always tells the line */
+		if (countLines || mode == MODE_JSON)
 			lineCount++;
 
 		if (str->len) {
@@ -313,7 +579,11 @@ parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary
 				case '@': /* Accept for this session */
 					if (str->len == 1)
 						goto empty_word;
-					enchant_dict_add_to_session(dict, str->str + 1, -1);
+					if (client) {
+						g_hash_table_remove (client->rejected, str->str + 1);
+						g_hash_table_add (client->accepted, g_strdup (str->str + 1));
+					} else
+						enchant_dict_add_to_session(dict, str->str + 1, -1);
 					break;
 				case '/': /* Remove from personal word list */
 					if (str->len == 1)
@@ -323,7 +593,11 @@ parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary
 				case '_': /* Remove from this session */
 					if (str->len == 1)
 						goto empty_word;
-					enchant_dict_remove_from_session (dict, str->str + 1, -1);
+					if (client) {
+						g_hash_table_remove (client->accepted, str->str + 1);
+						g_hash_table_add (client->rejected, g_strdup (str->str + 1));
+					} else
+						enchant_dict_remove_from_session (dict, str->str + 1, -1);
 					break;
 
 				case '%': /* Exit terse mode */
@@ -352,7 +626,7 @@ parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary
 							ssize_t cor_len = strlen(str->str) - (cor - str->str);
 							enchant_dict_store_replacement(dict, mis, mis_len, cor, cor_len);
 						} else if (g_str_has_prefix(str->str, "$$wc")) { /* Return the extra word chars list */
-							printf("%s\n", enchant_dict_get_extra_word_characters(dict));
+							g_string_append_printf(out, "%s\n", enchant_dict_get_extra_word_characters(dict));
 						}
 					}
 					break;
@@ -365,115 +639,1370 @@ parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary
 					break;
 
 				empty_word:
-					printf ("Error: The word \"\" is invalid. Empty string.\n");
+					g_string_append (out, "Error: The word \"\" is invalid. Empty string.\n");
 				}
 			}
 
 			if (mode != MODE_A || mode_A_no_command) {
-				token_ptr = tokens = tokenize_line (dict, str);
-				if (tokens == NULL)
-					putchar('\n');
-				while (tokens != NULL) {
+				tokenize_line (dict, str, tokens);
+				n_line_words = tokens->len;
+				if (tokens->len == 0 && mode != MODE_JSON)
+					g_string_append_c (out, '\n');
+				for (guint i = 0; i < tokens->len; i++) {
+					Token *token = &g_array_index (tokens, Token, i);
+					gboolean misspelled = FALSE;
 					corrected_something = TRUE;
 
-					word = (GString *)tokens->data;
-					tokens = tokens->next;
-					pos = GPOINTER_TO_INT(tokens->data);
-					tokens = tokens->next;
-
 					if (mode == MODE_A)
-						do_mode_a (dict, word, pos, lineCount, terse_mode);
+						misspelled = do_mode_a (out, dict, client, token->word, token->len, token->char_offset, lineCount, terse_mode);
 					else if (mode == MODE_L)
-						do_mode_l (dict, word, lineCount);
-
-					g_string_free(word, TRUE);
+						misspelled = do_mode_l (out, dict, token->word, token->len, lineCount);
+					else if (mode == MODE_JSON)
+						misspelled = do_mode_json (out, dict, token->word, token->len, token->word - str->str,
+									   token->char_offset, lineCount);
+					if (counts) {
+						counts->words++;
+						if (misspelled)
+							counts->misspelled++;
+					}
 				}
-				if (token_ptr)
-					g_slist_free (token_ptr);
 			}
 		} 
 		
 		if (mode == MODE_A && corrected_something) {
-			putchar('\n');
+			g_string_append_c (out, '\n');
 		}
 		g_string_truncate (str, 0);
-		fflush (stdout);
+
+		/* What a line brings is written at once; an ispell client
+		 * waits for it before sending the next line, and -J is read
+		 * as it comes. */
+		if (to) {
+			fwrite (out->str, 1, out->len, to);
+			g_string_truncate (out, 0);
+			if (mode == MODE_A || mode == MODE_JSON)
+				fflush (to);
+		}
+		if (client && client->tag)
+			server_tag_count (client->tag, n_line_words, start);
+	}
+
+	g_array_free (tokens, TRUE);
+	g_string_free (str, TRUE);
+}
+
+/* Requests the dictionary the input is checked with into broker */
+static EnchantDict *
+open_dict (EnchantBroker * broker, IspellMode_t mode, gchar *dictionary)
+{
+	EnchantDict * dict;
+	gchar * lang;
+
+	if (dictionary)
+		lang = strdup (dictionary);
+	else {
+	        lang = enchant_get_user_language();
+		if(!lang)
+			return NULL;
+ 	}
+
+	/* Enchant will get rid of trailing information like de_DE@euro or de_DE.ISO-8859-15 */
+	
+	dict = enchant_broker_request_dict (broker, lang);
+
+	if (!dict) {
+		fprintf (stderr, "Couldn't create a dictionary for %s\n", lang);
+		free (lang);
+		return NULL;
+	}
+
+	free (lang);
+
+	/* Documents misspell the same names over and over; suggesting for
+	 * them again is left to the dictionary's cache, which forgets what
+	 * changes to the word lists make stale. */
+	if (mode == MODE_A || mode == MODE_JSON)
+		enchant_dict_set_suggest_cache_size (dict, SUGGEST_CACHE_SIZE);
+
+	return dict;
+}
+
+static int
+parse_file (FILE * in, IspellMode_t mode, gboolean countLines, gchar *dictionary, guint n_jobs)
+{
+	EnchantBroker * broker;
+	EnchantDict * dict;
+
+	if (mode == MODE_A)
+		print_version (stdout);
+
+	broker = enchant_broker_init ();
+	dict = open_dict (broker, mode, dictionary);
+	if (!dict) {
+		enchant_broker_free (broker);
+		return 1;
+	}
+
+	if (mode == MODE_L && n_jobs > 1)
+		parse_file_in_parallel (in, dict, countLines, n_jobs);
+	else {
+		GString * out = g_string_new (NULL);
+		check_stream (in, charset_to_utf8, stdout, out, dict, mode, countLines, NULL, NULL);
+		g_string_free (out, TRUE);
 	}
 
 	enchant_broker_free_dict (broker, dict);
 	enchant_broker_free (broker);
 
-	g_string_free (str, TRUE);
-
 	return 0;
 }
 
-int main (int argc, char ** argv)
+/* One of several files checked at once, and what was found in it */
+typedef struct
 {
-	IspellMode_t mode = MODE_NONE;
-	char * file = NULL;
-	int rval = 0;
-	FILE * fp = stdin;
-	gboolean countLines = FALSE;
-	gchar *dictionary = NULL;  /* -d dictionary */
+	gchar * name;
+	GString * out;
+	Counts counts;
+	gboolean unreadable;
+	gboolean done;
+} FileJob;
 
-	/* Initialize system locale */
-	setlocale(LC_ALL, "");
+typedef struct
+{
+	EnchantDict * dict;
+	IspellMode_t mode;
+	gboolean countLines;
+	GMutex lock;	/* guards the jobs' done */
+	GCond file_done;
+} FileCheck;
 
-	g_get_charset(&charset);
-#ifdef _WIN32
-	/* If reading from stdin, its CP may not be the system CP (which glib's locale gives us) */
-	if (GetFileType(GetStdHandle(STD_INPUT_HANDLE)) == FILE_TYPE_CHAR) {
-		charset = g_strdup_printf("CP%u", GetConsoleCP());
+/* Checks a whole file, gathering what it prints */
+static void
+check_file (gpointer data, gpointer user_data)
+{
+	FileJob * job = (FileJob *) data;
+	FileCheck * check = (FileCheck *) user_data;
+	FILE * in = g_fopen (job->name, "rb");
+
+	if (in) {
+		/* the converter keeps state, so each file has its own */
+		GIConv to_utf8 = charset_to_utf8 == (GIConv) -1 ? (GIConv) -1 : g_iconv_open ("UTF-8", charset);
+
+		setvbuf (in, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+		check_stream (in, to_utf8, NULL, job->out, check->dict, check->mode,
+			      check->countLines, NULL, &job->counts);
+		if (to_utf8 != (GIConv) -1)
+			g_iconv_close (to_utf8);
+		fclose (in);
+	} else
+		job->unreadable = TRUE;
+
+	g_mutex_lock (&check->lock);
+	job->done = TRUE;
+	g_cond_broadcast (&check->file_done);
+	g_mutex_unlock (&check->lock);
+}
+
+/* Waits for the file to be checked, then prints what was found in it
+ * under its name, adds up its counts and frees it */
+static void
+write_file (FileCheck * check, FileJob * job, Counts * total, guint * n_unreadable)
+{
+	g_mutex_lock (&check->lock);
+	while (!job->done)
+		g_cond_wait (&check->file_done, &check->lock);
+	g_mutex_unlock (&check->lock);
+
+	if (job->unreadable) {
+		fprintf (stderr, "Error: Could not open the file \"%s\" for reading.\n", job->name);
+		(*n_unreadable)++;
+	} else {
+		if (check->mode == MODE_JSON) {
+			GString * header = g_string_new ("{\"file\":");
+			gchar * name = g_filename_display_name (job->name);
+			append_json_string (header, name, strlen (name));
+			g_string_append (header, "}\n");
+			fwrite (header->str, 1, header->len, stdout);
+			g_string_free (header, TRUE);
+			g_free (name);
+		} else
+			printf ("==> %s <==\n", job->name);
+		fwrite (job->out->str, 1, job->out->len, stdout);
+		if (check->mode == MODE_A || check->mode == MODE_JSON)
+			fflush (stdout);
+		total->words += job->counts.words;
+		total->misspelled += job->counts.misspelled;
 	}
-#endif
 
-	int optchar;
-	while ((optchar = getopt (argc, argv, ":d:alvLm")) != -1) {
-		switch (optchar) {
-		case 'd':
-			dictionary = optarg;  /* Emacs calls ispell with '-d dictionary'. */
-			break;
-		/* The first mode specified takes precedence. */
-		case 'a':
-			if (mode == MODE_NONE)
-				mode = MODE_A;
-			break;
-		case 'l':
-			if (mode == MODE_NONE)
-				mode = MODE_L;
-			break;
-		case 'L':
-			countLines = TRUE;
-			break;
-		case 'v':
-			print_version (stderr);
-			exit (0);
-		case 'm':
-			/* Ignore: Emacs calls ispell with '-m'. */
-			break;
-		case 'h':
-			print_help (argv[0]);
-			exit (0);
-		case ':':
-			fprintf (stderr, "missing argument to option\n");
-			/* FALLTHROUGH */
-		case '?':
-			print_help (argv[0]);
-			exit (1);
-		}
+	g_free (job->name);
+	g_string_free (job->out, TRUE);
+	g_free (job);
+}
+
+/* Checks files on n_jobs threads with one dictionary, printing what
+ * each brings in the order they were given, then a summary */
+static int
+parse_files (GPtrArray * files, IspellMode_t mode, gboolean countLines, gchar *dictionary, guint n_jobs)
+{
+	EnchantBroker * broker;
+	FileCheck check;
+	Counts total = { 0, 0 };
+	guint n_unreadable = 0;
+
+	if (mode == MODE_A)
+		print_version (stdout);
+
+	broker = enchant_broker_init ();
+	check.dict = open_dict (broker, mode, dictionary);
+	if (!check.dict) {
+		enchant_broker_free (broker);
+		return 1;
 	}
+	check.mode = mode;
+	check.countLines = countLines;
+	g_mutex_init (&check.lock);
+	g_cond_init (&check.file_done);
 
-	/* Get file argument if given. */
-	if (optind < argc) {
-		file = argv[optind++];
+	GThreadPool * pool = g_thread_pool_new (check_file, &check, n_jobs, FALSE, NULL);
+	GQueue pending = G_QUEUE_INIT;
+
+	for (guint i = 0; i < files->len; i++) {
+		FileJob * job = g_new0 (FileJob, 1);
+		job->name = g_strdup (g_ptr_array_index (files, i));
+		job->out = g_string_new (NULL);
+
+		g_queue_push_tail (&pending, job);
+		g_thread_pool_push (pool, job, NULL);
+
+		/* keep a couple of files queued for each worker, but no more */
+		while (g_queue_get_length (&pending) > 2 * n_jobs)
+			write_file (&check, g_queue_pop_head (&pending), &total, &n_unreadable);
 	}
+	while (!g_queue_is_empty (&pending))
+		write_file (&check, g_queue_pop_head (&pending), &total, &n_unreadable);
+	fflush (stdout);
 
-	/* Exit with usage if either no mode is set, or if there are excess
-	   non-option arguments. */
-	if (mode == MODE_NONE || optind < argc) {
-		print_help (argv[0]);
-		exit (1);
+	fprintf (stderr, "%u files, %u words, %u misspelled\n",
+		 files->len - n_unreadable, (unsigned int)total.words, (unsigned int)total.misspelled);
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_mutex_clear (&check.lock);
+	g_cond_clear (&check.file_done);
+	enchant_broker_free_dict (broker, check.dict);
+	enchant_broker_free (broker);
+
+	return n_unreadable ? 1 : 0;
+}
+
+static gint
+compare_paths (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char * const *) a, *(const char * const *) b);
+}
+
+/* Adds path to files, or with recurse and path a directory, the files
+ * found under it in order of their names; symbolic links to
+ * directories are not followed.  Returns FALSE if a directory could not
+ * be read. */
+static gboolean
+collect_files (const char * path, gboolean recurse, GPtrArray * files)
+{
+	if (!recurse || !g_file_test (path, G_FILE_TEST_IS_DIR)) {
+		g_ptr_array_add (files, g_strdup (path));
+		return TRUE;
+	}
+
+	GDir * dir = g_dir_open (path, 0, NULL);
+	if (!dir) {
+		fprintf (stderr, "Error: Could not read the directory \"%s\".\n", path);
+		return FALSE;
+	}
+
+	GPtrArray * entries = g_ptr_array_new_with_free_func (g_free);
+	const gchar * name;
+	while ((name = g_dir_read_name (dir)))
+		g_ptr_array_add (entries, g_build_filename (path, name, NULL));
+	g_dir_close (dir);
+	g_ptr_array_sort (entries, compare_paths);
+
+	gboolean ok = TRUE;
+	for (guint i = 0; i < entries->len; i++) {
+		const char * entry = g_ptr_array_index (entries, i);
+		if (g_file_test (entry, G_FILE_TEST_IS_SYMLINK) && g_file_test (entry, G_FILE_TEST_IS_DIR))
+			continue;
+		if (g_file_test (entry, G_FILE_TEST_IS_DIR))
+			ok = collect_files (entry, recurse, files) && ok;
+		else if (g_file_test (entry, G_FILE_TEST_IS_REGULAR))
+			g_ptr_array_add (files, g_strdup (entry));
+	}
+	g_ptr_array_free (entries, TRUE);
+
+	return ok;
+}
+
+#ifdef G_OS_UNIX
+typedef struct
+{
+	EnchantBroker * broker;
+	const char * dictionary;	/* for clients that name none, or NULL */
+
+	GMutex lock;
+	GHashTable * tags;	/* ServerTag by dictionary and provider */
+	guint64 connections;
+	guint64 clients;	/* being answered now */
+} Server;
+
+typedef struct
+{
+	Server * server;
+	int fd;
+} Connection;
+
+static gboolean
+socket_address (const char * path, struct sockaddr_un * addr)
+{
+	if (strlen (path) >= sizeof (addr->sun_path))
+		return FALSE;
+
+	memset (addr, 0, sizeof (*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy (addr->sun_path, path);
+	return TRUE;
+}
+
+/* Returns a socket connected to the server on path, or -1 if there is
+ * none */
+static int
+connect_to_server (const char * path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (!socket_address (path, &addr))
+		return -1;
+
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return -1;
+	if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1) {
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* The batch protocol: a frame is a line "check N" or "suggest N"
+ * followed by N lines of a word each, and is answered with N lines,
+ * "*" for a word spelled right, "#" for one that is not, or for a
+ * "suggest" frame "&" and a tab before each suggestion when there are
+ * any, and "!", a space and why for one that could not be checked.  A
+ * frame that is not understood ends the connection. */
+static void
+serve_batch (FILE * in, FILE * to, EnchantDict * dict, ServerTag * tag)
+{
+	GString * str = g_string_new (NULL);
+	GString * out = g_string_new (NULL);
+	GPtrArray * words = g_ptr_array_new_with_free_func (g_free);
+
+	while (!consume_line (in, (GIConv) -1, str)) {
+		gboolean suggest = g_str_has_prefix (str->str, "suggest ");
+		const char * count;
+		char * end;
+		unsigned long n;
+
+		if (!suggest && !g_str_has_prefix (str->str, "check "))
+			break;
+		count = strchr (str->str, ' ') + 1;
+		n = strtoul (count, &end, 10);
+		if (!g_ascii_isdigit (*count) || *end != '\0' || n > MAX_BATCH_WORDS)
+			break;
+
+		g_ptr_array_set_size (words, 0);
+		while (words->len < n && !consume_line (in, (GIConv) -1, str))
+			g_ptr_array_add (words, g_strndup (str->str, str->len));
+		if (words->len < n)
+			break;
+		if (n == 0)
+			continue;
+
+		gint64 start = g_get_monotonic_time ();
+		const char * const * word = (const char * const *) words->pdata;
+		int * results = g_new (int, n);
+		enchant_dict_check_batch (dict, word, NULL, n, results);
+
+		/* the misspellings get their suggestions in one go */
+		const char ** missed = g_new (const char *, n);
+		size_t * n_suggs = g_new (size_t, n);
+		char *** suggs = NULL;
+		size_t n_missed = 0;
+		if (suggest) {
+			for (guint i = 0; i < n; i++)
+				if (results[i] > 0)
+					missed[n_missed++] = word[i];
+			if (n_missed)
+				suggs = enchant_dict_suggest_batch (dict, (const char * const *) missed, NULL, n_missed, n_suggs);
+		}
+
+		n_missed = 0;
+		for (guint i = 0; i < n; i++) {
+			if (results[i] == 0) {
+				g_string_append (out, "*\n");
+				continue;
+			}
+			if (results[i] < 0) {
+				const char * error = enchant_dict_get_error (dict);
+				if (error == NULL || strpbrk (error, "\r\n"))
+					error = "the word could not be checked";
+				g_string_append_printf (out, "! %s\n", error);
+				continue;
+			}
+			if (suggs && n_suggs[n_missed]) {
+				g_string_append_c (out, '&');
+				for (size_t j = 0; j < n_suggs[n_missed]; j++) {
+					g_string_append_c (out, '\t');
+					g_string_append (out, suggs[n_missed][j]);
+				}
+				g_string_append_c (out, '\n');
+			} else
+				g_string_append (out, "#\n");
+			n_missed++;
+		}
+
+		if (suggs)
+			enchant_dict_free_suggest_batch (dict, suggs);
+		g_free (n_suggs);
+		g_free (missed);
+		g_free (results);
+
+		fwrite (out->str, 1, out->len, to);
+		g_string_truncate (out, 0);
+		server_tag_count (tag, n, start);
+		if (fflush (to) == EOF)
+			break;
+	}
+
+	g_ptr_array_free (words, TRUE);
+	g_string_free (out, TRUE);
+	g_string_free (str, TRUE);
+}
+
+static void
+list_dict_tag (const char * const lang_tag,
+	       const char * const provider_name _GL_UNUSED_PARAMETER,
+	       const char * const provider_desc _GL_UNUSED_PARAMETER,
+	       const char * const provider_file _GL_UNUSED_PARAMETER,
+	       void * user_data)
+{
+	FILE * to = (FILE *) user_data;
+	fprintf (to, "%s\n", lang_tag);
+}
+
+static void
+describe_dict_tag (const char * const lang_tag,
+		   const char * const provider_name,
+		   const char * const provider_desc _GL_UNUSED_PARAMETER,
+		   const char * const provider_file _GL_UNUSED_PARAMETER,
+		   void * user_data)
+{
+	ServerTag * tag = (ServerTag *) user_data;
+	tag->tag = g_strdup (lang_tag);
+	tag->provider = g_strdup (provider_name);
+}
+
+static void
+server_tag_free (gpointer data)
+{
+	ServerTag * tag = (ServerTag *) data;
+	g_free (tag->tag);
+	g_free (tag->provider);
+	g_free (tag);
+}
+
+/* Where the requests answered out of dict are counted */
+static ServerTag *
+server_get_tag (Server * server, EnchantDict * dict)
+{
+	ServerTag * found, * tag = g_new0 (ServerTag, 1);
+
+	enchant_dict_describe (dict, describe_dict_tag, tag);
+	if (!tag->tag) {
+		tag->tag = g_strdup ("");
+		tag->provider = g_strdup ("");
+	}
+	char * key = g_strconcat (tag->tag, "\n", tag->provider, NULL);
+
+	g_mutex_lock (&server->lock);
+	found = g_hash_table_lookup (server->tags, key);
+	if (found) {
+		server_tag_free (tag);
+		g_free (key);
+	} else {
+		tag->lock = &server->lock;
+		g_hash_table_insert (server->tags, key, tag);
+		found = tag;
+	}
+	g_mutex_unlock (&server->lock);
+
+	return found;
+}
+
+static const char * const latency_bound_names[] = { "10us", "100us", "1ms", "10ms", "100ms", "1s" };
+
+/* The counters of enchant_broker_get_stats that "stats" tells as
+ * histograms: the count, the microseconds they add up to, and the
+ * counts within each latency bound, named after the count */
+static const struct {
+	const char * metric, * count, * sum_us;
+} stats_histograms[] = {
+	{ "enchant_provider_check_seconds", "provider_checks", "provider_check_us" },
+	{ "enchant_provider_suggest_seconds", "provider_suggests", "provider_suggest_us" }
+};
+
+typedef struct
+{
+	GPtrArray * names;	/* in the order they were told */
+	GHashTable * values;
+} Stats;
+
+static void
+collect_stat (const char * const name, uint64_t value, void * user_data)
+{
+	Stats * stats = (Stats *) user_data;
+	char * key = g_strdup (name);
+	guint64 * copy = g_new (guint64, 1);
+
+	*copy = value;
+	g_ptr_array_add (stats->names, key);
+	g_hash_table_insert (stats->values, key, copy);
+}
+
+static guint64
+stat_value (Stats * stats, const char * name)
+{
+	guint64 * value = g_hash_table_lookup (stats->values, name);
+	return value ? *value : 0;
+}
+
+static void
+append_stats_histogram (GString * out, const char * metric, const char * labels,
+			const guint64 * within, guint64 count, guint64 sum_us)
+{
+	const char * sep = *labels ? "," : "";
+
+	for (guint i = 0; i < N_LATENCY_BOUNDS; i++)
+		g_string_append_printf (out, "%s_bucket{%s%sle=\"%g\"} %" G_GUINT64_FORMAT "\n",
+					metric, labels, sep, latency_bounds_us[i] / 1e6, within[i]);
+	g_string_append_printf (out, "%s_bucket{%s%sle=\"+Inf\"} %" G_GUINT64_FORMAT "\n",
+				metric, labels, sep, count);
+	g_string_append_printf (out, "%s_sum%s%s%s %g\n", metric,
+				*labels ? "{" : "", labels, *labels ? "}" : "", sum_us / 1e6);
+	g_string_append_printf (out, "%s_count%s%s%s %" G_GUINT64_FORMAT "\n", metric,
+				*labels ? "{" : "", labels, *labels ? "}" : "", count);
+}
+
+/* Appends value to out as an OpenMetrics label value */
+static void
+append_label_value (GString * out, const char * value)
+{
+	for (; *value; value++) {
+		if (*value == '\\' || *value == '"')
+			g_string_append_c (out, '\\');
+		if (*value == '\n')
+			g_string_append (out, "\\n");
+		else
+			g_string_append_c (out, *value);
+	}
+}
+
+static gint
+compare_server_tags (gconstpointer a, gconstpointer b)
+{
+	const ServerTag * tag_a = *(const ServerTag * const *) a;
+	const ServerTag * tag_b = *(const ServerTag * const *) b;
+	int cmp = strcmp (tag_a->tag, tag_b->tag);
+	return cmp ? cmp : strcmp (tag_a->provider, tag_b->provider);
+}
+
+/* Answers "stats" with what the server and its broker have done, in
+ * the OpenMetrics text format */
+static void
+serve_stats (FILE * to, Server * server)
+{
+	GString * out = g_string_new (NULL);
+
+	g_mutex_lock (&server->lock);
+	g_string_append_printf (out,
+				"# TYPE enchant_server_connections counter\n"
+				"# HELP enchant_server_connections Clients that connected.\n"
+				"enchant_server_connections_total %" G_GUINT64_FORMAT "\n"
+				"# TYPE enchant_server_clients gauge\n"
+				"# HELP enchant_server_clients Clients being answered.\n"
+				"enchant_server_clients %" G_GUINT64_FORMAT "\n",
+				server->connections, server->clients);
+
+	GPtrArray * tags = g_ptr_array_new ();
+	GHashTableIter iter;
+	gpointer value;
+	g_hash_table_iter_init (&iter, server->tags);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (tags, value);
+	g_ptr_array_sort (tags, compare_server_tags);
+
+	/* a line of the ispell protocol, or a frame of the batch one, is a
+	 * request */
+	GString * labels = g_string_new (NULL);
+	const char * const counters[] = { "requests", "words" };
+	for (guint c = 0; c < G_N_ELEMENTS (counters); c++) {
+		g_string_append_printf (out, "# TYPE enchant_server_%s counter\n", counters[c]);
+		for (guint i = 0; i < tags->len; i++) {
+			ServerTag * tag = g_ptr_array_index (tags, i);
+			g_string_append_printf (out, "enchant_server_%s_total{tag=\"", counters[c]);
+			append_label_value (out, tag->tag);
+			g_string_append (out, "\",provider=\"");
+			append_label_value (out, tag->provider);
+			g_string_append_printf (out, "\"} %" G_GUINT64_FORMAT "\n", c == 0 ? tag->requests : tag->words);
+		}
+	}
+	g_string_append (out, "# TYPE enchant_server_request_seconds histogram\n");
+	for (guint i = 0; i < tags->len; i++) {
+		ServerTag * tag = g_ptr_array_index (tags, i);
+		g_string_assign (labels, "tag=\"");
+		append_label_value (labels, tag->tag);
+		g_string_append (labels, "\",provider=\"");
+		append_label_value (labels, tag->provider);
+		g_string_append_c (labels, '"');
+		append_stats_histogram (out, "enchant_server_request_seconds", labels->str,
+					tag->within, tag->requests, tag->request_us);
+	}
+	g_string_free (labels, TRUE);
+	g_ptr_array_free (tags, TRUE);
+	g_mutex_unlock (&server->lock);
+
+	/* the broker's counters, over all its dictionaries */
+	Stats stats;
+	stats.names = g_ptr_array_new ();
+	stats.values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	enchant_broker_get_stats (server->broker, collect_stat, &stats);
+
+	for (guint h = 0; h < G_N_ELEMENTS (stats_histograms); h++) {
+		guint64 within[N_LATENCY_BOUNDS];
+		for (guint i = 0; i < N_LATENCY_BOUNDS; i++) {
+			char * name = g_strdup_printf ("%s_within_%s", stats_histograms[h].count, latency_bound_names[i]);
+			within[i] = stat_value (&stats, name);
+			g_free (name);
+		}
+		g_string_append_printf (out, "# TYPE %s histogram\n", stats_histograms[h].metric);
+		append_stats_histogram (out, stats_histograms[h].metric, "", within,
+					stat_value (&stats, stats_histograms[h].count),
+					stat_value (&stats, stats_histograms[h].sum_us));
+	}
+
+	/* the others as counters, microseconds in seconds */
+	for (guint i = 0; i < stats.names->len; i++) {
+		const char * name = g_ptr_array_index (stats.names, i);
+		gboolean in_histogram = FALSE;
+		for (guint h = 0; h < G_N_ELEMENTS (stats_histograms); h++)
+			in_histogram |= g_str_has_prefix (name, stats_histograms[h].count) ||
+				strcmp (name, stats_histograms[h].sum_us) == 0;
+		if (in_histogram)
+			continue;
+
+		if (g_str_has_suffix (name, "_us")) {
+			int len = (int) strlen (name) - 3;
+			g_string_append_printf (out, "# TYPE enchant_%.*s_seconds counter\n"
+						"enchant_%.*s_seconds_total %g\n",
+						len, name, len, name, stat_value (&stats, name) / 1e6);
+		} else
+			g_string_append_printf (out, "# TYPE enchant_%s counter\n"
+						"enchant_%s_total %" G_GUINT64_FORMAT "\n",
+						name, name, stat_value (&stats, name));
+	}
+	g_hash_table_destroy (stats.values);
+	g_ptr_array_free (stats.names, TRUE);
+
+	/* and what its dictionaries take up */
+	stats.names = g_ptr_array_new ();
+	stats.values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	enchant_broker_get_memory_usage (server->broker, collect_stat, &stats);
+	g_string_append (out, "# TYPE enchant_memory_bytes gauge\n"
+			 "# HELP enchant_memory_bytes Estimated memory the loaded dictionaries take up.\n");
+	for (guint i = 0; i < stats.names->len; i++) {
+		const char * name = g_ptr_array_index (stats.names, i);
+		g_string_append_printf (out, "enchant_memory_bytes{kind=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					name, stat_value (&stats, name));
+	}
+	g_hash_table_destroy (stats.values);
+	g_ptr_array_free (stats.names, TRUE);
+
+	g_string_append (out, "# EOF\n");
+	fwrite (out->str, 1, out->len, to);
+	g_string_free (out, TRUE);
+}
+
+/* Serves a client on a thread of its own.  Its first line is "ispell"
+ * or "batch" for the protocol, then the dictionary, then for "ispell"
+ * an L to have the lines numbered; the server answers with the ispell
+ * version line, or with a line starting "! " saying why it cannot.  A
+ * first line "list" is answered with the version line and then the
+ * dictionaries there are, a line each, and "stats" with serve_stats,
+ * before hanging up. */
+static gpointer
+serve_client (gpointer data)
+{
+	Connection * conn = (Connection *) data;
+	Server * server = conn->server;
+	FILE * in, * to;
+	int fd;
+
+	fd = dup (conn->fd);
+	in = fdopen (conn->fd, "rb");
+	to = fd == -1 ? NULL : fdopen (fd, "wb");
+	if (!in || !to) {
+		if (in)
+			fclose (in);
+		else
+			close (conn->fd);
+		if (fd != -1)
+			close (fd);
+		g_free (conn);
+		return NULL;
+	}
+	setvbuf (in, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+	setvbuf (to, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+
+	g_mutex_lock (&server->lock);
+	server->connections++;
+	server->clients++;
+	g_mutex_unlock (&server->lock);
+
+	GString * str = g_string_new (NULL);
+	consume_line (in, (GIConv) -1, str);
+	gchar ** fields = g_strsplit (str->str, " ", 0);
+	guint n_fields = g_strv_length (fields);
+	gboolean batch = n_fields > 0 && strcmp (fields[0], "batch") == 0;
+	gchar * lang = NULL;
+
+	if (n_fields == 1 && strcmp (fields[0], "list") == 0) {
+		print_version (to);
+		enchant_broker_list_dicts (server->broker, list_dict_tag, to);
+	} else if (n_fields == 1 && strcmp (fields[0], "stats") == 0)
+		serve_stats (to, server);
+	else if (!batch && (n_fields == 0 || strcmp (fields[0], "ispell") != 0))
+		fprintf (to, "! Unknown protocol\n");
+	else if (n_fields > 1 && *fields[1])
+		lang = strdup (fields[1]);
+	else if (server->dictionary)
+		lang = strdup (server->dictionary);
+	else if (!(lang = enchant_get_user_language ()))
+		fprintf (to, "! No dictionary given\n");
+
+	if (lang) {
+		EnchantDict * dict = enchant_broker_request_dict (server->broker, lang);
+
+		if (!dict)
+			fprintf (to, "! Couldn't create a dictionary for %s\n", lang);
+		else {
+			ServerTag * tag = server_get_tag (server, dict);
+
+			enchant_dict_set_suggest_cache_size (dict, SUGGEST_CACHE_SIZE);
+			print_version (to);
+			if (batch)
+				serve_batch (in, to, dict, tag);
+			else {
+				ClientSession client;
+				GString * out = g_string_new (NULL);
+				gboolean countLines = n_fields > 2 && strcmp (fields[2], "L") == 0;
+
+				client.accepted = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+				client.rejected = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+				client.tag = tag;
+				check_stream (in, (GIConv) -1, to, out, dict, MODE_A, countLines, &client, NULL);
+				g_hash_table_destroy (client.accepted);
+				g_hash_table_destroy (client.rejected);
+				g_string_free (out, TRUE);
+			}
+			enchant_broker_free_dict (server->broker, dict);
+		}
+		free (lang);
+	}
+
+	g_strfreev (fields);
+	g_string_free (str, TRUE);
+	fclose (to);
+	fclose (in);
+	g_free (conn);
+
+	g_mutex_lock (&server->lock);
+	server->clients--;
+	g_mutex_unlock (&server->lock);
+	return NULL;
+}
+
+/* Answers the clients connecting to path, each on a thread of its own,
+ * out of one broker that keeps the dictionaries they use loaded */
+static int
+serve (const char * path, const char * dictionary)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	Server server;
+	mode_t mask;
+	int fd;
+
+	if (!socket_address (path, &addr)) {
+		fprintf (stderr, "Error: The socket path \"%s\" is too long.\n", path);
+		return 1;
+	}
+
+	/* A socket left behind by a server that is gone is replaced. */
+	fd = connect_to_server (path);
+	if (fd != -1) {
+		close (fd);
+		fprintf (stderr, "Error: A server is already listening on \"%s\".\n", path);
+		return 1;
+	}
+	if (lstat (path, &st) == 0 && S_ISSOCK (st.st_mode))
+		unlink (path);
+
+	/* Clients share the server's personal word lists, so only its user
+	 * gets to connect. */
+	fd = socket (AF_UNIX, SOCK_STREAM, 0);
+	mask = umask (077);
+	if (fd == -1 || bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1 ||
+	    listen (fd, SERVER_BACKLOG) == -1) {
+		umask (mask);
+		fprintf (stderr, "Error: Could not listen on \"%s\": %s\n", path, g_strerror (errno));
+		if (fd != -1)
+			close (fd);
+		return 1;
+	}
+	umask (mask);
+
+	/* Clients send and are sent UTF-8, whatever the server's locale. */
+	locale_is_utf8 = TRUE;
+	/* A client gone while it is answered is not the server's end. */
+	signal (SIGPIPE, SIG_IGN);
+
+	/* The remote provider would hand the clients back to the server. */
+	g_unsetenv ("ENCHANT_SERVER");
+
+	server.broker = enchant_broker_init ();
+	server.dictionary = dictionary;
+	g_mutex_init (&server.lock);
+	server.tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, server_tag_free);
+	server.connections = 0;
+	server.clients = 0;
+	enchant_broker_set_dict_pool (server.broker, SERVER_DICT_POOL, -1);
+	if (dictionary)
+		enchant_broker_preload (server.broker, (const char * const *) &dictionary, 1, NULL, NULL);
+
+	for (;;) {
+		int client = accept (fd, NULL, NULL);
+		if (client == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno == EMFILE || errno == ENFILE) {
+				/* wait for clients to go away */
+				g_usleep (G_USEC_PER_SEC / 10);
+				continue;
+			}
+			break;
+		}
+
+		Connection * conn = g_new (Connection, 1);
+		conn->server = &server;
+		conn->fd = client;
+		g_thread_unref (g_thread_new ("enchant-client", serve_client, conn));
+	}
+
+	/* Clients may still be being answered; exiting ends them. */
+	fprintf (stderr, "Error: Could not accept clients: %s\n", g_strerror (errno));
+	close (fd);
+	unlink (path);
+	return 1;
+}
+
+/* Prints what the server on path answers "stats" with */
+static int
+run_stats (const char * path)
+{
+	char buf[4096];
+	ssize_t n;
+	int fd;
+
+	fd = connect_to_server (path);
+	if (fd == -1) {
+		fprintf (stderr, "Error: No server is listening on \"%s\".\n", path);
+		return 1;
+	}
+	signal (SIGPIPE, SIG_IGN);
+	if (write (fd, "stats\n", 6) != 6) {
+		close (fd);
+		return 1;
+	}
+	shutdown (fd, SHUT_WR);
+
+	while ((n = read (fd, buf, sizeof (buf))) != 0) {
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			break;
+		fwrite (buf, 1, n, stdout);
+	}
+	close (fd);
+	return fflush (stdout) == EOF || n == -1;
+}
+
+/* Copies what the server sends to stdout, converting it a line at a
+ * time, and flushing it after each read as an ispell client expects */
+static gpointer
+relay_replies (gpointer data)
+{
+	int fd = GPOINTER_TO_INT (data);
+	char * buf = g_malloc (STDIO_BUFFER_SIZE);
+	GString * line = g_string_new (NULL);
+	GString * out = g_string_new (NULL);
+
+	for (;;) {
+		ssize_t n = read (fd, buf, STDIO_BUFFER_SIZE);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+
+		const char * p = buf, * end = buf + n, * nl;
+		while ((nl = memchr (p, '\n', end - p))) {
+			g_string_append_len (line, p, nl - p);
+			append_utf (out, line->str, line->len);
+			g_string_append_c (out, '\n');
+			g_string_truncate (line, 0);
+			p = nl + 1;
+		}
+		g_string_append_len (line, p, end - p);
+
+		fwrite (out->str, 1, out->len, stdout);
+		g_string_truncate (out, 0);
+		fflush (stdout);
+	}
+
+	append_utf (out, line->str, line->len);
+	fwrite (out->str, 1, out->len, stdout);
+	fflush (stdout);
+
+	g_string_free (out, TRUE);
+	g_string_free (line, TRUE);
+	g_free (buf);
+	return NULL;
+}
+
+/* Does -a through the server on path; returns -1 without it, so that
+ * the input is checked here instead */
+static int
+run_client (const char * path, FILE * in, gboolean countLines, gchar *dictionary)
+{
+	GString * str;
+	gchar * lang;
+	FILE * to;
+	int fd, wfd;
+	char c;
+
+	fd = connect_to_server (path);
+	if (fd == -1)
+		return -1;
+
+	/* The dictionary is picked by the client's locale, not the server's. */
+	if (dictionary)
+		lang = strdup (dictionary);
+	else if (!(lang = enchant_get_user_language ())) {
+		close (fd);
+		return 1;
+	}
+
+	wfd = dup (fd);
+	to = wfd == -1 ? NULL : fdopen (wfd, "wb");
+	if (!to) {
+		if (wfd != -1)
+			close (wfd);
+		close (fd);
+		free (lang);
+		return -1;
+	}
+	signal (SIGPIPE, SIG_IGN);
+	setvbuf (to, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+	fprintf (to, "ispell %s%s\n", lang, countLines ? " L" : "");
+	fflush (to);
+	free (lang);
+
+	/* The version line, or why the server cannot check */
+	str = g_string_new (NULL);
+	while (read (fd, &c, 1) == 1 && c != '\n')
+		g_string_append_c (str, c);
+	if (!g_str_has_prefix (str->str, "@(#)")) {
+		fprintf (stderr, "%s\n", g_str_has_prefix (str->str, "! ") ? str->str + 2 : "The server hung up");
+		g_string_free (str, TRUE);
+		fclose (to);
+		close (fd);
+		return 1;
+	}
+	printf ("%s\n", str->str);
+	fflush (stdout);
+
+	GThread * relay = g_thread_new ("enchant-relay", relay_replies, GINT_TO_POINTER (fd));
+	gboolean was_last_line = FALSE;
+	while (!was_last_line) {
+		was_last_line = consume_line (in, charset_to_utf8, str);
+		if (was_last_line && !str->len)
+			break;
+		fwrite (str->str, 1, str->len, to);
+		fputc ('\n', to);
+		/* each line is answered before an ispell client sends more */
+		if (fflush (to) == EOF)
+			break;
+	}
+	shutdown (wfd, SHUT_WR);
+	g_thread_join (relay);
+
+	g_string_free (str, TRUE);
+	fclose (to);
+	close (fd);
+	return 0;
+}
+#endif
+
+/* A monotonic clock in nanoseconds */
+static gint64
+bench_now (void)
+{
+#ifdef G_OS_UNIX
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+#else
+	return g_get_monotonic_time () * 1000;
+#endif
+}
+
+/* Bytes handed out by the heap, or -1 where that cannot be told */
+static gint64
+bench_heap_in_use (void)
+{
+#ifdef BENCH_HEAP_IN_USE
+	return (gint64) mallinfo2 ().uordblks;
+#else
+	return -1;
+#endif
+}
+
+static int
+compare_latencies (gconstpointer a, gconstpointer b)
+{
+	gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+	return x < y ? -1 : x > y;
+}
+
+/* Prints how many of what took how long, and how many per second */
+static void
+bench_report (const char * what, GArray * latencies)
+{
+	gint64 total = 0;
+
+	if (latencies->len == 0) {
+		printf ("%s: no words\n", what);
+		return;
+	}
+
+	g_array_sort (latencies, compare_latencies);
+	for (guint i = 0; i < latencies->len; i++)
+		total += g_array_index (latencies, gint64, i);
+
+	printf ("%s: %u words in %.3f ms, %.0f words/s", what, latencies->len,
+		total / 1e6, total ? latencies->len * 1e9 / total : 0.0);
+	static const double quantiles[] = { 0.5, 0.99, 0.999 };
+	static const char * const names[] = { "p50", "p99", "p999" };
+	for (guint q = 0; q < G_N_ELEMENTS (quantiles); q++) {
+		guint rank = (guint) (quantiles[q] * latencies->len + 0.999999);
+		gint64 ns = g_array_index (latencies, gint64, MAX (rank, 1) - 1);
+		printf (", %s %.2f us", names[q], ns / 1e3);
+	}
+	putchar ('\n');
+}
+
+static void
+bench_report_heap (const char * when, gint64 before)
+{
+	if (before >= 0)
+		printf ("heap %s: %+" G_GINT64_FORMAT " KiB\n", when, (bench_heap_in_use () - before) / 1024);
+}
+
+static void
+bench_describe_dict (const char * const lang_tag, const char * const provider_name,
+		     const char * const provider_desc, const char * const provider_file,
+		     void * user_data _GL_UNUSED_PARAMETER)
+{
+	printf ("dictionary: %s\nprovider: %s (%s), %s\n", lang_tag, provider_name, provider_desc, provider_file);
+}
+
+/* --bench: times setting up for file's language, then checking each
+ * of its words in turn, and with suggest finding suggestions for those
+ * that are misspelled */
+static int
+run_bench (const char * file, gchar *dictionary, gboolean suggest)
+{
+	EnchantBroker * broker;
+	EnchantDict * dict;
+	FILE * in;
+	gint64 heap, start;
+
+	in = g_fopen (file, "rb");
+	if (!in) {
+		fprintf (stderr, "Error: Could not open the file \"%s\" for reading.\n", file);
+		return 1;
+	}
+	setvbuf (in, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+
+	heap = bench_heap_in_use ();
+	start = bench_now ();
+	broker = enchant_broker_init ();
+	printf ("broker init: %.3f ms\n", (bench_now () - start) / 1e6);
+
+	start = bench_now ();
+	dict = open_dict (broker, MODE_L, dictionary);
+	if (!dict) {
+		enchant_broker_free (broker);
+		fclose (in);
+		return 1;
+	}
+	printf ("dictionary load: %.3f ms\n", (bench_now () - start) / 1e6);
+	enchant_dict_describe (dict, bench_describe_dict, NULL);
+
+	/* the whole corpus is split up front, so that only checking is timed */
+	GString * str = g_string_new (NULL);
+	GArray * tokens = g_array_new (FALSE, FALSE, sizeof (Token));
+	GPtrArray * words = g_ptr_array_new_with_free_func (g_free);
+	gboolean was_last_line = FALSE;
+	while (!was_last_line) {
+		was_last_line = consume_line (in, charset_to_utf8, str);
+		tokenize_line (dict, str, tokens);
+		for (guint i = 0; i < tokens->len; i++) {
+			Token * token = &g_array_index (tokens, Token, i);
+			g_ptr_array_add (words, g_strndup (token->word, token->len));
+		}
+	}
+	g_array_free (tokens, TRUE);
+	g_string_free (str, TRUE);
+	fclose (in);
+
+	/* The personal word lists are read when first needed. */
+	if (words->len) {
+		const char * first = g_ptr_array_index (words, 0);
+		start = bench_now ();
+		enchant_dict_check (dict, first, -1);
+		printf ("word lists load: %.3f ms\n", (bench_now () - start) / 1e6);
+	}
+	bench_report_heap ("after loading", heap);
+
+	GArray * check_ns = g_array_sized_new (FALSE, FALSE, sizeof (gint64), words->len);
+	GArray * suggest_ns = g_array_new (FALSE, FALSE, sizeof (gint64));
+	heap = bench_heap_in_use ();
+	for (guint i = 0; i < words->len; i++) {
+		const char * word = g_ptr_array_index (words, i);
+		int val;
+
+		start = bench_now ();
+		val = enchant_dict_check (dict, word, -1);
+		gint64 ns = bench_now () - start;
+		g_array_append_val (check_ns, ns);
+
+		if (suggest && val > 0) {
+			size_t n_suggs;
+			char ** suggs;
+
+			start = bench_now ();
+			suggs = enchant_dict_suggest (dict, word, -1, &n_suggs);
+			ns = bench_now () - start;
+			g_array_append_val (suggest_ns, ns);
+			if (suggs)
+				enchant_dict_free_string_list (dict, suggs);
+		}
+	}
+	bench_report ("check", check_ns);
+	if (suggest)
+		bench_report ("suggest", suggest_ns);
+	bench_report_heap ("after checking", heap);
+
+	g_array_free (suggest_ns, TRUE);
+	g_array_free (check_ns, TRUE);
+	g_ptr_array_free (words, TRUE);
+	enchant_broker_free_dict (broker, dict);
+	enchant_broker_free (broker);
+
+	return 0;
+}
+
+int main (int argc, char ** argv)
+{
+	IspellMode_t mode = MODE_NONE;
+	char * file = NULL;
+	int rval = 0;
+	FILE * fp = stdin;
+	gboolean countLines = FALSE;
+	gboolean recurse = FALSE;
+	gboolean bench = FALSE;
+	gchar *dictionary = NULL;  /* -d dictionary */
+	guint n_jobs = 0;  /* -j jobs, or 0 if not given */
+	const char * server_socket = NULL;  /* --server socket */
+	const char * stats_socket = NULL;  /* --stats socket */
+
+	/* Initialize system locale */
+	setlocale(LC_ALL, "");
+
+	gboolean is_utf8 = g_get_charset(&charset);
+	locale_is_utf8 = is_utf8;
+#ifdef _WIN32
+	/* If reading from stdin, its CP may not be the system CP (which glib's locale gives us) */
+	if (GetFileType(GetStdHandle(STD_INPUT_HANDLE)) == FILE_TYPE_CHAR) {
+		charset = g_strdup_printf("CP%u", GetConsoleCP());
+		is_utf8 = GetConsoleCP() == CP_UTF8;
+	}
+#endif
+	/* Input in UTF-8 already is taken as it is. */
+	if (!is_utf8)
+		charset_to_utf8 = g_iconv_open ("UTF-8", charset);
+
+	static const struct option long_options[] = {
+		{ "server", required_argument, NULL, 'S' },
+		{ "stats", required_argument, NULL, 'T' },
+		{ "bench", no_argument, NULL, 'B' },
+		{ NULL, 0, NULL, 0 }
+	};
+	int optchar;
+	while ((optchar = getopt_long (argc, argv, ":d:aj:JlrvLm", long_options, NULL)) != -1) {
+		switch (optchar) {
+		case 'd':
+			dictionary = optarg;  /* Emacs calls ispell with '-d dictionary'. */
+			break;
+		/* The first mode specified takes precedence. */
+		case 'a':
+			if (mode == MODE_NONE)
+				mode = MODE_A;
+			break;
+		case 'j':
+			{
+				char *end;
+				long jobs = strtol (optarg, &end, 10);
+				if (*optarg == '\0' || *end != '\0' || jobs < 1 || jobs > 1024) {
+					fprintf (stderr, "invalid number of jobs\n");
+					print_help (argv[0]);
+					exit (1);
+				}
+				n_jobs = (guint) jobs;
+			}
+			break;
+		case 'l':
+			if (mode == MODE_NONE)
+				mode = MODE_L;
+			break;
+		case 'J':
+			if (mode == MODE_NONE)
+				mode = MODE_JSON;
+			break;
+		case 'L':
+			countLines = TRUE;
+			break;
+		case 'r':
+			recurse = TRUE;
+			break;
+		case 'v':
+			print_version (stderr);
+			exit (0);
+		case 'm':
+			/* Ignore: Emacs calls ispell with '-m'. */
+			break;
+		case 'S':
+			server_socket = optarg;
+			break;
+		case 'T':
+			stats_socket = optarg;
+			break;
+		case 'B':
+			bench = TRUE;
+			break;
+		case 'h':
+			print_help (argv[0]);
+			exit (0);
+		case ':':
+			fprintf (stderr, "missing argument to option\n");
+			/* FALLTHROUGH */
+		case '?':
+			print_help (argv[0]);
+			exit (1);
+		}
+	}
+
+	if (server_socket) {
+		if (optind < argc) {
+			print_help (argv[0]);
+			exit (1);
+		}
+#ifdef G_OS_UNIX
+		return serve (server_socket, dictionary);
+#else
+		fprintf (stderr, "Error: There are no Unix sockets to serve on here.\n");
+		exit (1);
+#endif
+	}
+
+	if (stats_socket) {
+		if (optind < argc) {
+			print_help (argv[0]);
+			exit (1);
+		}
+#ifdef G_OS_UNIX
+		return run_stats (stats_socket);
+#else
+		fprintf (stderr, "Error: There are no Unix sockets to serve on here.\n");
+		exit (1);
+#endif
+	}
+
+	if (bench) {
+		if (argc - optind != 1) {
+			print_help (argv[0]);
+			exit (1);
+		}
+		rval = run_bench (argv[optind], dictionary, mode == MODE_A);
+		if (charset_to_utf8 != (GIConv) -1)
+			g_iconv_close (charset_to_utf8);
+		return rval;
+	}
+
+	/* Exit with usage if no mode is set. */
+	if (mode == MODE_NONE) {
+		print_help (argv[0]);
+		exit (1);
+	}
+
+	/* Several files, or directories, are checked at once, each file
+	 * by a thread of its own. */
+	if (argc - optind > 1 || (recurse && optind < argc)) {
+		GPtrArray * files = g_ptr_array_new_with_free_func (g_free);
+		gboolean readable = TRUE;
+
+		for (; optind < argc; optind++)
+			readable = collect_files (argv[optind], recurse, files) && readable;
+		setvbuf (stdout, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+		rval = parse_files (files, mode, countLines, dictionary,
+				    n_jobs ? n_jobs : g_get_num_processors ());
+		g_ptr_array_free (files, TRUE);
+		if (charset_to_utf8 != (GIConv) -1)
+			g_iconv_close (charset_to_utf8);
+		return readable ? rval : 1;
+	}
+
+	/* Get file argument if given. */
+	if (optind < argc) {
+		file = argv[optind++];
 	}
 
 	/* Process the file or standard input. */
@@ -484,9 +2013,23 @@ int main (int argc, char ** argv)
 			exit (1);
 		}
 	}
-	rval = parse_file (fp, mode, countLines, dictionary);
+	/* Reading blocks of input does not hold up the lines of an ispell
+	 * session on a pipe: stdio passes on whatever each read returns. */
+	setvbuf (fp, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+	/* The output is flushed where the ispell protocol needs it. */
+	setvbuf (stdout, NULL, _IOFBF, STDIO_BUFFER_SIZE);
+	rval = -1;
+#ifdef G_OS_UNIX
+	/* -a is answered by a server when there is one. */
+	if (mode == MODE_A && g_getenv ("ENCHANT_SERVER"))
+		rval = run_client (g_getenv ("ENCHANT_SERVER"), fp, countLines, dictionary);
+#endif
+	if (rval == -1)
+		rval = parse_file (fp, mode, countLines, dictionary, n_jobs);
 	if (file)
 		fclose (fp);
+	if (charset_to_utf8 != (GIConv) -1)
+		g_iconv_close (charset_to_utf8);
 	
 	return rval;
 }
@@ -30,7 +30,7 @@
 #ifndef ENCHANT_H
 #define ENCHANT_H
 
-#include <stdint.h> /* for uint32_t */
+#include <stdint.h> /* for uint8_t, uint16_t, uint32_t */
 #include <sys/types.h> /* for size_t, ssize_t */
 
 
@@ -51,6 +51,18 @@ extern "C" {
 typedef struct str_enchant_broker EnchantBroker;
 typedef struct str_enchant_dict   EnchantDict;
 
+/*
+ * A dictionary may be used from several threads at once: its session
+ * and personal word lists take locks, calls into providers that are
+ * not thread-safe take turns, and errors returned by
+ * enchant_dict_get_error are those of the calling thread.  A broker
+ * may equally be shared: dictionaries can be requested and freed from
+ * several threads, a tag being loaded once even when requested by many,
+ * and enchant_broker_get_error reports the calling thread's error.
+ * Only enchant_broker_init and enchant_broker_free must not race with
+ * other uses of the broker.
+ */
+
 ENCHANT_MODULE_EXPORT
 const char *enchant_get_version (void);
 
@@ -82,6 +94,42 @@ void enchant_broker_free (EnchantBroker * broker);
 ENCHANT_MODULE_EXPORT
 EnchantDict *enchant_broker_request_dict (EnchantBroker * broker, const char *const tag);
 
+typedef struct str_enchant_tag EnchantTag;
+
+/**
+ * enchant_broker_intern_tag
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request dictionaries for ("en_US", "de_DE", ...)
+ *
+ * Resolves @tag once, as enchant_broker_request_dict would, for
+ * requesting its dictionary again and again with
+ * enchant_broker_request_dict_by_tag.  Interning the same tag, or one
+ * written differently that names the same language ("en-us",
+ * "en_US.UTF-8"), returns the same #EnchantTag.
+ *
+ * Returns: An #EnchantTag, owned by @broker and valid until it is
+ * freed, or %null if @tag is not a valid language tag
+ */
+ENCHANT_MODULE_EXPORT
+EnchantTag *enchant_broker_intern_tag (EnchantBroker * broker, const char *const tag);
+
+/**
+ * enchant_broker_request_dict_by_tag
+ * @broker: A non-null #EnchantBroker
+ * @tag: A non-null #EnchantTag interned by @broker
+ *
+ * Like enchant_broker_request_dict(), but while the dictionary last
+ * returned for @tag is loaded, it is returned again without the tag
+ * being normalized or looked up, nor anything allocated.  A tag for
+ * which only the dictionary of its language alone was found keeps
+ * getting that one while it is loaded, until enchant_broker_rescan is
+ * called.
+ *
+ * Returns: An #EnchantDict, or %null if no suitable dictionary could be found. This dictionary is reference counted.
+ */
+ENCHANT_MODULE_EXPORT
+EnchantDict *enchant_broker_request_dict_by_tag (EnchantBroker * broker, EnchantTag * tag);
+
 /**
  * enchant_broker_request_pwl_dict
  *
@@ -95,6 +143,60 @@ EnchantDict *enchant_broker_request_dict (EnchantBroker * broker, const char *co
 ENCHANT_MODULE_EXPORT
 EnchantDict *enchant_broker_request_pwl_dict (EnchantBroker * broker, const char *const pwl);
 
+/**
+ * enchant_broker_request_readonly_pwl_dict
+ * @broker: A non-null #EnchantBroker
+ * @pwl: A non-null pathname in the GLib file name encoding (UTF-8 on Windows)
+ *       to an existing wordlist file
+ *
+ * Like enchant_broker_request_pwl_dict(), but for a wordlist that is only
+ * read, such as one managed centrally on shared storage.  Nothing is
+ * ever written to the file or created next to it; a compiled index
+ * already next to it is mapped rather than the file being parsed.
+ * Words cannot be added to or removed from the dictionary, which sets
+ * an error instead, though they can be added to the session.  Changes
+ * made to the file by others are still picked up.
+ *
+ * Returns: An EnchantDict, or %null if the file does not exist. This dictionary is reference counted.
+ */
+ENCHANT_MODULE_EXPORT
+EnchantDict *enchant_broker_request_readonly_pwl_dict (EnchantBroker * broker, const char *const pwl);
+
+/**
+ * enchant_broker_request_overlay_dict
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request a dictionary for ("en_US", "de_DE", ...)
+ * @user_dir: A non-null directory in the GLib file name encoding (UTF-8 on Windows)
+ *            holding the personal and exclude word lists to use, "<tag>.dic" and "<tag>.exc"
+ *
+ * Requests a dictionary that shares the one enchant_broker_request_dict would
+ * return for @tag, but with its own personal and exclude word lists and its
+ * own session, so that serving many users takes one copy of each language.
+ * Words added to or removed from it are not seen through any other dictionary.
+ *
+ * Returns: A new #EnchantDict on every call, or %null if no suitable dictionary
+ * could be found. Free it with enchant_broker_free_dict().
+ */
+ENCHANT_MODULE_EXPORT
+EnchantDict *enchant_broker_request_overlay_dict (EnchantBroker * broker, const char *const tag,
+						  const char *const user_dir);
+
+/**
+ * enchant_broker_request_multi_dict
+ * @broker: A non-null #EnchantBroker
+ * @tags: A non-null, comma-separated list of language tags ("en_US,de_DE", ...)
+ *
+ * Requests a dictionary made of the dictionaries for each of @tags, for text
+ * in more than one language.  It accepts a word any of them accepts, asking
+ * them in the order given, and suggests what all of them suggest, their best
+ * suggestions first.  Its personal and exclude word lists are its own.
+ *
+ * Returns: A new #EnchantDict on every call, or %null if there is no dictionary
+ * for one of @tags. Free it with enchant_broker_free_dict().
+ */
+ENCHANT_MODULE_EXPORT
+EnchantDict *enchant_broker_request_multi_dict (EnchantBroker * broker, const char *const tags);
+
 /**
  * enchant_broker_free_dict
  * @broker: A non-null #EnchantBroker
@@ -126,11 +228,221 @@ int enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag);
  * list of provider names. As a special exception, the "*" tag can
  * be used as a language tag to declare a default ordering for any
  * language that does not explictly declare an ordering.
+ *
+ * Providers joined with '|' (hunspell|nuspell,aspell) are taken to be
+ * as good as one another: the one found to be the fastest for the
+ * language is tried first, going by how long each took to open its
+ * dictionary and to check and suggest in earlier sessions.  Each is
+ * tried first once, to be measured.  What is measured is kept in the
+ * user's config directory when @broker is freed.
  */
 ENCHANT_MODULE_EXPORT
 void enchant_broker_set_ordering (EnchantBroker * broker,
                                   const char * const tag,
 				  const char * const ordering);
+
+/**
+ * EnchantPreloadFn
+ * @lang_tag: The language tag the dictionary was preloaded for
+ * @found: Non-zero if a dictionary was found for @lang_tag
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Called from a background thread as each dictionary preloaded with
+ * enchant_broker_preload is ready.
+ */
+typedef void (*EnchantPreloadFn) (const char * const lang_tag, int found,
+				  void * user_data);
+
+/**
+ * enchant_broker_preload
+ * @broker: A non-null #EnchantBroker
+ * @tags: The language tags to load dictionaries for, as enchant_broker_request_dict takes them
+ * @n_tags: The number of tags in @tags
+ * @fn: Optional, an #EnchantPreloadFn
+ * @user_data: Optional user-data
+ *
+ * Loads the dictionaries for @tags on background threads, so that
+ * requesting them later takes no time; a request for one still being
+ * loaded waits for it rather than loading it again.  @broker keeps
+ * each dictionary loaded until its first request takes it over, and
+ * freeing @broker waits for the loads still going.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_preload (EnchantBroker * broker,
+			     const char * const * tags, size_t n_tags,
+			     EnchantPreloadFn fn, void * user_data);
+
+/**
+ * enchant_broker_rescan
+ * @broker: A non-null #EnchantBroker
+ *
+ * Forgets which dictionaries @broker found missing and which ones the
+ * providers listed, so that they are asked again.  The broker notices
+ * dictionaries installed in the directories providers report on its
+ * own; this is for those it cannot tell about.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_rescan (EnchantBroker * broker);
+
+/**
+ * enchant_broker_set_dict_pool
+ * @broker: A non-null #EnchantBroker
+ * @max_dicts: How many freed dictionaries to keep loaded, 0 for none
+ * @idle_timeout_ms: How long to keep each of them, or -1 for as long as there is room
+ *
+ * Keeps up to @max_dicts dictionaries loaded after they are released
+ * with enchant_broker_free_dict, so that requesting one again does not
+ * load it again.  The least recently released are let go first, and
+ * those kept longer than @idle_timeout_ms are let go the next time
+ * @broker frees or requests a dictionary.  A dictionary requested
+ * again comes back as it was left, words added to its session
+ * included.  By default no dictionaries are kept.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_set_dict_pool (EnchantBroker * broker, size_t max_dicts, int idle_timeout_ms);
+
+/**
+ * enchant_broker_trim
+ * @broker: A non-null #EnchantBroker
+ * @level: How much to release, from 0 to 2
+ *
+ * Releases memory @broker's dictionaries can do without, for a process
+ * short of memory.  Level 0 disposes of the dictionaries the pool of
+ * enchant_broker_set_dict_pool keeps loaded, whatever it is set to
+ * keep.  Level 1 also empties the caches of
+ * enchant_dict_set_check_cache_size and
+ * enchant_dict_set_suggest_cache_size.  Level 2 also drops the tables
+ * and indexes the personal and exclude word lists build to look for
+ * suggestions, which the next suggestion builds again, compacts the
+ * word lists, and disposes of the copies of provider dictionaries made
+ * for threads to use at once.  Compacting copies the words first, so
+ * it takes more memory for a while.
+ *
+ * The dictionaries in use stay loaded and keep working, only slower
+ * for a while.
+ *
+ * Returns: 0 on success, -1 if @level is unknown
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_broker_trim (EnchantBroker * broker, int level);
+
+/**
+ * enchant_broker_freeze
+ * @broker: A non-null #EnchantBroker
+ *
+ * Gets the dictionaries @broker has loaded ready for a process about to
+ * fork workers, so that the workers keep sharing their memory rather
+ * than each copying the pages it touches.  Call it once the
+ * dictionaries are loaded, before forking.
+ *
+ * The personal and exclude word lists are read one last time, and the
+ * tables checking and looking for suggestions would build are built now
+ * rather than by each worker.  Their tries are moved to read-only
+ * memory of their own.  From then on the files are neither polled nor
+ * watched: changes other processes make to them are not seen, and words
+ * a worker adds or removes are still written to them, but only that
+ * worker sees them, its first change copying the word list's tries.
+ * The caches of enchant_dict_set_check_cache_size and
+ * enchant_dict_set_suggest_cache_size are emptied, so that each worker
+ * fills its own.  Write-behind is turned off, as its threads, like any
+ * other, are not carried over to the forked processes.
+ *
+ * Dictionaries loaded afterwards are not frozen.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_freeze (EnchantBroker * broker);
+
+/**
+ * enchant_broker_reload_dict
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag of a dictionary loaded before
+ *
+ * Loads again, from its provider, the dictionary
+ * enchant_broker_request_dict would hand out for @tag, say once its
+ * files are updated, and puts it in place of the one the handles given
+ * out point to.  They stay valid and keep their session, word lists,
+ * error messages and statistics.  The old dictionary keeps answering
+ * while the new one loads, and the verdicts
+ * enchant_dict_set_check_cache_size keeps are worked out again by the
+ * new one before it takes over; calls into the provider wait only for
+ * the swap itself.  Suggestions cached are looked for again as they are
+ * asked for.  Strings enchant_dict_get_extra_word_characters returned
+ * for it before are no longer valid, while the characters
+ * enchant_dict_is_word_character takes as part of words stay those of
+ * the dictionary first loaded.
+ *
+ * It can be called from any thread.
+ *
+ * Returns: 1 if it was reloaded, 0 if no dictionary for @tag is loaded
+ * from a provider, -1 on failure, with the old one kept
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_broker_reload_dict (EnchantBroker * broker, const char * const tag);
+
+/**
+ * enchant_broker_set_write_behind
+ * @broker: A non-null #EnchantBroker
+ * @enabled: Non-zero to write personal dictionary changes in the background
+ *
+ * When enabled, words added to or removed from the personal and exclude
+ * dictionaries of @broker's dictionaries take effect at once, but are
+ * written to disk by a background thread a few at a time.  Disabling it,
+ * freeing a dictionary or freeing @broker writes out any pending changes.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_set_write_behind (EnchantBroker * broker, int enabled);
+
+/**
+ * EnchantTaskFn
+ * @task: The task an #EnchantExecutorFn was handed
+ *
+ * Runs a piece of a broker's background work.
+ */
+typedef void (*EnchantTaskFn) (void * task);
+
+/**
+ * EnchantExecutorFn
+ * @run: The function that runs @task
+ * @task: The task to run
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Has @run called with @task once, on any thread, now or later.
+ */
+typedef void (*EnchantExecutorFn) (EnchantTaskFn run, void * task, void * user_data);
+
+/**
+ * enchant_broker_set_executor
+ * @broker: A non-null #EnchantBroker
+ * @fn: Optional, an #EnchantExecutorFn
+ * @user_data: Optional user-data
+ *
+ * Hands the work @broker does in the background to @fn instead of the
+ * threads of its own pool: preloading, asynchronous, batch and
+ * prefetched suggestions, asking the other providers of
+ * enchant_dict_set_suggest_fanout and the members of a composite
+ * dictionary at once, and listing dictionaries.  A call that waits for
+ * its background work does the part of it not started yet itself, so
+ * @fn may run the tasks as late, and as few at a time, as suits the
+ * application; only a fan-out with a timeout does not, and leaves out
+ * what is not done by then.  Every task must be run in the end, and
+ * enchant_broker_free() waits for them.  %null goes back to @broker's
+ * own threads.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_set_executor (EnchantBroker * broker, EnchantExecutorFn fn, void * user_data);
+
+/**
+ * enchant_broker_set_worker_threads
+ * @broker: A non-null #EnchantBroker
+ * @n_threads: The most threads to use, or 0 for one per processor
+ *
+ * Sets how many threads @broker's own pool has for the background work
+ * enchant_broker_set_executor lists, all of which it shares.  By
+ * default there is one per processor.  Tying the threads to processors
+ * is up to an executor of the application's.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_set_worker_threads (EnchantBroker * broker, int n_threads);
 /**
  * enchant_broker_get_error
  * @broker: A non-null broker
@@ -170,6 +482,83 @@ void enchant_broker_describe (EnchantBroker * broker,
 			      EnchantBrokerDescribeFn fn,
 			      void * user_data);
 
+/**
+ * EnchantLoadTimesFn
+ * @provider_name: The provider's identifier, or %null if its module failed to load
+ * @provider_dll_file: The module's filename in Glib file encoding (UTF8 on Windows)
+ * @open_us: Microseconds opening the module took
+ * @init_us: Microseconds its init_enchant_provider took, or -1 if it was not called
+ * @configure_us: Microseconds its configure_enchant_provider took, or -1 if it was not called
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to tell how long loading a provider module took
+ */
+typedef void (*EnchantLoadTimesFn) (const char * const provider_name,
+				    const char * const provider_dll_file,
+				    int64_t open_us, int64_t init_us, int64_t configure_us,
+				    void * user_data);
+
+/**
+ * enchant_broker_describe_load_times
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantLoadTimesFn
+ * @user_data: Optional user-data
+ *
+ * Tells how long loading each provider module @broker tried to load
+ * took.  Modules are loaded when they are first needed, so the ones
+ * not needed yet are left out; enchant_broker_describe loads them all.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_describe_load_times (EnchantBroker * broker,
+					 EnchantLoadTimesFn fn,
+					 void * user_data);
+
+/**
+ * EnchantStatsFn
+ * @name: The name of the counter, in ASCII
+ * @value: Its value
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to report the counters of enchant_dict_get_stats and
+ * enchant_broker_get_stats, and the figures of
+ * enchant_dict_get_memory_usage and enchant_broker_get_memory_usage,
+ * one at a time
+ */
+typedef void (*EnchantStatsFn) (const char * const name, uint64_t value, void * user_data);
+
+/**
+ * enchant_broker_get_stats
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports the counters of enchant_dict_get_stats added up over all the
+ * dictionaries @broker has handed out, those since freed included.
+ * The calls to a composite dictionary of
+ * enchant_broker_request_multi_dict are counted by its members only,
+ * and a word list several dictionaries share is counted by each of them.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_broker_get_stats (EnchantBroker * broker, EnchantStatsFn fn, void * user_data);
+
+/**
+ * enchant_broker_get_memory_usage
+ * @broker: A non-null #EnchantBroker
+ * @fn: An optional #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Estimates the memory taken up by the dictionaries @broker has loaded,
+ * those kept loaded by enchant_broker_set_dict_pool included, reporting
+ * the figures of enchant_dict_get_memory_usage to @fn if given.  A word
+ * list several dictionaries share is counted once.  A composite
+ * dictionary of enchant_broker_request_multi_dict is counted by its
+ * members only.
+ *
+ * Returns: the estimate, in bytes
+ */
+ENCHANT_MODULE_EXPORT
+uint64_t enchant_broker_get_memory_usage (EnchantBroker * broker, EnchantStatsFn fn, void * user_data);
+
 /**
  * enchant_dict_check
  * @dict: A non-null #EnchantDict
@@ -184,6 +573,45 @@ void enchant_broker_describe (EnchantBroker * broker,
 ENCHANT_MODULE_EXPORT
 int enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len);
 
+/**
+ * enchant_dict_check_batch
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @results: Where to put what enchant_dict_check would return for each word
+ *
+ * Checks many words at once, as enchant_dict_check would check each
+ * of them, but handing the spelling backend all the words it has to
+ * look at in one go.  A null, empty or invalid word gets a negative
+ * result.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_check_batch (EnchantDict * dict, const char *const *words,
+			       const ssize_t *lens, size_t n_words, int *results);
+
+/**
+ * enchant_dict_check_batch_bits
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @misspelled: Where to put (@n_words + 7) / 8 bytes of bits, one per word
+ *
+ * Checks many words at once as enchant_dict_check_batch does, but
+ * gives the results as a bitset for bindings to wrap as they are: bit
+ * i % 8 of byte i / 8, counting from the least significant, is set if
+ * word i is misspelled.  A null, empty or invalid word, or one the
+ * spelling backend failed on, counts as misspelled; the latter leaves
+ * an error for enchant_dict_get_error.  The bits past @n_words are
+ * cleared.
+ *
+ * Returns: the number of bits set, or -1 if any of those pre-conditions are not met
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_check_batch_bits (EnchantDict * dict, const char *const *words,
+				   const ssize_t *lens, size_t n_words, uint8_t *misspelled);
+
 /**
  * enchant_dict_suggest
  * @dict: A non-null #EnchantDict
@@ -200,6 +628,212 @@ ENCHANT_MODULE_EXPORT
 char **enchant_dict_suggest (EnchantDict * dict, const char *const word,
                              ssize_t len, size_t * out_n_suggs);
 
+/**
+ * enchant_dict_suggest_bounded
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @max_suggs: The most suggestions wanted, or 0 for no limit
+ * @max_distance: The greatest edit distance of the personal dictionary's suggestions, or -1 for the default
+ * @timeout_ms: How many milliseconds to spend at most, or -1 for no limit
+ * @out_n_suggs: The location to store the # of suggestions returned, or %null
+ *
+ * Finds suggestions as enchant_dict_suggest would, but with less
+ * effort.  The limits are passed on to the spelling backend as hints;
+ * a backend that cannot keep to @timeout_ms may be left out.  Once
+ * @timeout_ms has passed, what was found up to then is returned.
+ *
+ * Returns: A %null terminated list of UTF-8 encoded suggestions, or %null
+ */
+ENCHANT_MODULE_EXPORT
+char **enchant_dict_suggest_bounded (EnchantDict * dict, const char *const word,
+				     ssize_t len, size_t max_suggs, int max_distance,
+				     int timeout_ms, size_t * out_n_suggs);
+
+/**
+ * enchant_dict_get_suggest_partial
+ * @dict: A non-null #EnchantDict
+ *
+ * Tells whether the suggestions enchant_dict_suggest or
+ * enchant_dict_suggest_bounded last found for @dict on the calling
+ * thread are short of what could have been found: because the time
+ * ran out, a provider asked at the same time was left behind, or the
+ * spelling backend took a cheaper way to stay within the limits.
+ *
+ * Returns: 1 if they are, 0 if not
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_get_suggest_partial (EnchantDict * dict);
+
+/**
+ * enchant_dict_suggest_batch
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to find suggestions for, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @out_n_suggs: Where to put the # of suggestions for each word, or %null
+ *
+ * Finds suggestions for many words at once, as enchant_dict_suggest
+ * would for each of them.  If the spelling backend can be called from
+ * several threads, the words are worked on in parallel.  A null, empty
+ * or invalid word gets no suggestions.
+ *
+ * Returns: @n_words lists as enchant_dict_suggest would return them,
+ * all held in one block that must be released with
+ * enchant_dict_free_suggest_batch, or %null if @n_words is 0
+ */
+ENCHANT_MODULE_EXPORT
+char ***enchant_dict_suggest_batch (EnchantDict * dict, const char *const *words,
+				    const ssize_t *lens, size_t n_words, size_t * out_n_suggs);
+
+/**
+ * enchant_dict_free_suggest_batch
+ * @dict: A non-null #EnchantDict
+ * @suggs_list: A non-null result of enchant_dict_suggest_batch
+ *
+ * Releases all the lists in @suggs_list at once
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_free_suggest_batch (EnchantDict * dict, char ***suggs_list);
+
+/**
+ * EnchantPackedWords
+ * @n_lists: The number of lists of words
+ * @n_words: The number of words in all the lists
+ * @list_starts: @n_lists + 1 indexes into @offsets, list i holding
+ *   words @list_starts[i] up to @list_starts[i + 1]
+ * @offsets: @n_words + 1 byte offsets into @bytes, word j taking up
+ *   @offsets[j + 1] - @offsets[j] bytes, its NUL included
+ * @bytes: The words, in UTF-8 encoding, each followed by a NUL
+ *
+ * Lists of words laid out for bindings to wrap without copying them
+ * one by one: the header, @list_starts, @offsets and @bytes are all in
+ * the one block, released with a single enchant_dict_free_packed_words.
+ */
+typedef struct str_enchant_packed_words
+{
+	size_t n_lists;
+	size_t n_words;
+	const uint32_t *list_starts;
+	const uint32_t *offsets;
+	const char *bytes;
+} EnchantPackedWords;
+
+/**
+ * enchant_dict_suggest_packed
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to find suggestions for, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ *
+ * Finds suggestions for one word or many as enchant_dict_suggest_batch
+ * does, but returns them as one list per word of an
+ * #EnchantPackedWords.  A null, empty or invalid word gets an empty
+ * list.  The block comes from the allocator of enchant_set_allocator.
+ *
+ * Returns: the suggestions, to be released with
+ * enchant_dict_free_packed_words, or %null if any of those
+ * pre-conditions are not met
+ */
+ENCHANT_MODULE_EXPORT
+EnchantPackedWords *enchant_dict_suggest_packed (EnchantDict * dict, const char *const *words,
+						 const ssize_t *lens, size_t n_words);
+
+/**
+ * enchant_dict_free_packed_words
+ * @dict: A non-null #EnchantDict
+ * @packed: A non-null result of enchant_dict_suggest_packed
+ *
+ * Releases @packed and all its words at once
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_free_packed_words (EnchantDict * dict, EnchantPackedWords * packed);
+
+/**
+ * enchant_dict_complete
+ * @dict: A non-null #EnchantDict
+ * @prefix: The non-null start of a word, in UTF-8 encoding
+ * @len: The byte length of @prefix, or -1 for strlen (@prefix)
+ * @max_words: The most words wanted, or 0 for no limit
+ * @out_n_words: The location to store the # of words returned, or %null
+ *
+ * Finds the words of the personal dictionary that start with @prefix,
+ * in the order of their Unicode code points, shorter words before the
+ * longer ones they start.  A prefix without capitals matches words
+ * regardless of their case; any other has to match exactly.  Excluded
+ * words are left out.  The time taken depends on the words found, not
+ * on how many words the personal dictionary holds.  The spelling
+ * backend's own word list is not looked at.
+ *
+ * Returns: A %null terminated list of UTF-8 encoded words in their
+ * original spelling, to be released with
+ * enchant_dict_free_string_list, or %null if there are none
+ */
+ENCHANT_MODULE_EXPORT
+char **enchant_dict_complete (EnchantDict * dict, const char *const prefix, ssize_t len,
+			      size_t max_words, size_t * out_n_words);
+
+typedef struct str_enchant_suggest_request EnchantSuggestRequest;
+
+/**
+ * EnchantSuggestFn
+ * @dict: The #EnchantDict the suggestions were asked of
+ * @suggs: A %null terminated list of UTF-8 encoded suggestions, or %null
+ * @n_suggs: The # of suggestions in @suggs
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Called once the suggestions asked for with enchant_dict_suggest_async
+ * are in.  @suggs must be released with enchant_dict_free_string_list.
+ */
+typedef void (*EnchantSuggestFn) (EnchantDict * dict, char **suggs,
+				  size_t n_suggs, void * user_data);
+
+/**
+ * enchant_dict_suggest_async
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @timeout_ms: How many milliseconds to spend at most, or -1 for no limit
+ * @fn: A non-null #EnchantSuggestFn
+ * @user_data: Optional user-data
+ *
+ * Finds suggestions as enchant_dict_suggest would, on a background
+ * thread, and then calls @fn with them from that thread.  @fn is called
+ * exactly once, with no suggestions if the request was cancelled first.
+ * Once @timeout_ms has passed, @fn gets what was found up to then.
+ * @dict must not be freed until @fn has been called.
+ *
+ * Returns: A handle that must be released with
+ * enchant_dict_free_suggest_request, or %null if any of the
+ * pre-conditions are not met
+ */
+ENCHANT_MODULE_EXPORT
+EnchantSuggestRequest *enchant_dict_suggest_async (EnchantDict * dict, const char *const word,
+						   ssize_t len, int timeout_ms,
+						   EnchantSuggestFn fn, void * user_data);
+
+/**
+ * enchant_dict_cancel_suggest
+ * @dict: A non-null #EnchantDict
+ * @request: A non-null #EnchantSuggestRequest of @dict
+ *
+ * Asks for the search for @request's suggestions to be abandoned.
+ * Searches stop as soon as they notice, and a request that was not
+ * started yet is never started.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_cancel_suggest (EnchantDict * dict, EnchantSuggestRequest * request);
+
+/**
+ * enchant_dict_free_suggest_request
+ * @dict: A non-null #EnchantDict
+ * @request: A non-null #EnchantSuggestRequest of @dict
+ *
+ * Releases the handle, which does not cancel the request
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_free_suggest_request (EnchantDict * dict, EnchantSuggestRequest * request);
+
 /**
  * enchant_dict_add
  * @dict: A non-null #EnchantDict
@@ -212,6 +846,21 @@ char **enchant_dict_suggest (EnchantDict * dict, const char *const word,
 ENCHANT_MODULE_EXPORT
 void enchant_dict_add (EnchantDict * dict, const char *const word, ssize_t len);
 
+/**
+ * enchant_dict_add_many
+ * @dict: A non-null #EnchantDict
+ * @words: The words you wish to add to your personal dictionary, as NUL-terminated UTF-8 strings
+ * @n_words: The number of @words
+ *
+ * Adds each word as enchant_dict_add() would, but writes them to the personal
+ * dictionary file all at once.  Null, empty and invalid words are skipped.
+ *
+ * Remarks: if a word exists in the exclude dictionary, it will be removed from the
+ *          exclude dictionary
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_add_many (EnchantDict * dict, const char *const *words, size_t n_words);
+
 /**
  * enchant_dict_add_to_session
  * @dict: A non-null #EnchantDict
@@ -270,20 +919,274 @@ int enchant_dict_is_removed (EnchantDict * dict, const char *const word, ssize_t
  * @cor_len: The byte length of @cor, or -1 for strlen (@cor)
  *
  * Notes that you replaced @mis with @cor, so it's possibly more likely
- * that future occurrences of @mis will be replaced with @cor. So it might
- * bump @cor up in the suggestion list.
+ * that future occurrences of @mis will be replaced with @cor.
+ *
+ * Enchant remembers the corrections chosen for each misspelling, in a
+ * file next to the personal word list of @dict's language, or for as
+ * long as @dict is loaded for a dictionary without one.
+ * enchant_dict_suggest puts them before its other suggestions, most
+ * often chosen first.  A correction chosen three times, and at least
+ * three times as often as the others for @mis together, is suggested
+ * on its own, without asking the provider.  An excluded correction is
+ * not suggested.  The provider is told of the replacement as well, if it
+ * keeps track of replacements itself.
  */
 ENCHANT_MODULE_EXPORT
 void enchant_dict_store_replacement (EnchantDict * dict,
 				     const char *const mis, ssize_t mis_len,
 				     const char *const cor, ssize_t cor_len);
 
+/**
+ * enchant_dict_set_pwl_suggest_engine
+ * @dict: A non-null #EnchantDict
+ * @engine: The non-null name of the engine, "trie", "deletions" or "parallel"
+ *
+ * Chooses how suggestions are looked up in @dict's personal word list,
+ * which is shared by all dictionaries using the same file.  "trie", the
+ * default, searches the words directly.  "deletions" builds an index of
+ * the strings left by deleting a few letters from each word, which takes
+ * far more memory but finds suggestions in very large word lists much
+ * faster.  The index is built by the first suggestion, and saved next to
+ * the word list for large ones.  "parallel" searches the words as "trie"
+ * does, with the same results, but spreads the search of a large word
+ * list over as many threads as there are processors, which cuts the time
+ * a single suggestion takes.
+ *
+ * Returns: 0 on success, -1 if @engine is unknown
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_set_pwl_suggest_engine (EnchantDict * dict, const char *const engine);
+
+/**
+ * enchant_dict_set_suggest_profile
+ * @dict: A non-null #EnchantDict
+ * @profile: The non-null name of the profile, "fast", "balanced" or "thorough"
+ *
+ * Trades the quality of the suggestions @dict's spelling backend makes
+ * for the time it takes, for @dict alone.  "fast" looks only for the
+ * words one edit away, which suits autocorrection.  "balanced", the
+ * default, is the backend's own search, left out for words too long for
+ * it to finish in time.  "thorough" makes the backend's full search
+ * whatever the word, and adds the words one edit away it leaves out.  A
+ * time limit given to enchant_dict_suggest_bounded still holds.  The
+ * suggestions @dict cached are found again.  Only the hunspell backend
+ * offers the choice; the others search as usual whatever the profile.
+ *
+ * Returns: 0 on success, -1 if @profile is unknown
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_set_suggest_profile (EnchantDict * dict, const char *const profile);
+
+/**
+ * enchant_dict_set_pwl_frequencies
+ * @dict: A non-null #EnchantDict
+ * @filename: A file in the GLib file name encoding (UTF-8 on Windows)
+ *            listing a word and how often it is used on each line, or
+ *            %null to forget the frequencies
+ *
+ * Ranks the suggestions from @dict's personal word list that are as
+ * close to the misspelling as each other by how often they are used,
+ * most often first, regardless of case.  The counts are whole numbers
+ * separated from the words by white space; lines starting with '#'
+ * are skipped.  Knowing which words are common also lets the search
+ * leave out parts of a large word list that could not improve on the
+ * suggestions it has found.  The frequencies apply to all dictionaries
+ * using the same word list, including words added to it later.
+ *
+ * Returns: 0 on success, -1 if @filename could not be read
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_set_pwl_frequencies (EnchantDict * dict, const char *const filename);
+
+/**
+ * enchant_dict_set_check_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0 to disable the cache
+ *
+ * Makes enchant_dict_check remember the spelling backend's verdicts on
+ * the @n_words words most recently checked in @dict, so that words that
+ * come up again and again are not handed to the backend each time.
+ * The cache is disabled by default.  Adding and removing words empties
+ * it; the session and personal word lists, and changes made to them,
+ * are always looked at before the cache.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_set_check_cache_size (EnchantDict * dict, size_t n_words);
+
+/**
+ * enchant_dict_set_suggest_fanout
+ * @dict: A non-null #EnchantDict
+ * @max_providers: The most providers to ask, 1 or 0 for only @dict's own
+ * @timeout_ms: How long to wait for the other providers, or -1 for as long as they take
+ *
+ * Makes enchant_dict_suggest ask up to @max_providers - 1 other providers
+ * that have a dictionary for @dict's language as well, in the order the
+ * provider ordering lists them, all at the same time as @dict's own.  Their
+ * suggestions are merged by rank: each provider's best suggestion comes
+ * before any provider's second best, @dict's own first.  A provider that has
+ * not answered within @timeout_ms, or by the deadline of
+ * enchant_dict_suggest_bounded, is left out.  Suggestions come from @dict's
+ * own provider only by default.
+ *
+ * Returns: The number of providers @dict's suggestions come from, or 0 if it
+ * has none, as for a personal word list
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_set_suggest_fanout (EnchantDict * dict, size_t max_providers, int timeout_ms);
+
+/**
+ * enchant_dict_set_suggest_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0 to disable the cache
+ *
+ * Makes enchant_dict_suggest remember the suggestions it made for the
+ * @n_words words most recently looked up in @dict, and hand out copies
+ * of them when asked again.  The cache is disabled by default.  It is
+ * emptied whenever words are added to or removed from @dict, its
+ * session or its personal word lists, including by other programs, and
+ * when a replacement is stored.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_set_suggest_cache_size (EnchantDict * dict, size_t n_words);
+
+/**
+ * enchant_dict_get_suggest_cache_stats
+ * @dict: A non-null #EnchantDict
+ * @n_hits: Location for the number of suggestions found in the cache, or %null
+ * @n_misses: Location for the number of those that had to be worked out, or %null
+ *
+ * Tells how well the cache set up with enchant_dict_set_suggest_cache_size
+ * has done so far.  Lookups made while it was disabled are not counted.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_get_suggest_cache_stats (EnchantDict * dict, size_t * n_hits, size_t * n_misses);
+
+/**
+ * enchant_dict_set_suggest_prefetch
+ * @dict: A non-null #EnchantDict
+ * @max_pending: The most words to work out suggestions for at a time, or 0 not to
+ *
+ * Makes enchant_dict_check_text and enchant_text_checker_check work out
+ * the suggestions for the misspellings they find in the background,
+ * for the cache of enchant_dict_set_suggest_cache_size to have them
+ * ready when they are asked for.  At most @max_pending of them are
+ * waiting or being worked out at a time; the misspellings found while
+ * there is no room are left alone.  The work goes to the threads of
+ * @dict's broker, or to its executor (see enchant_broker_set_executor),
+ * but is only started once no other work is waiting to be.  What is
+ * still to be done for a text is given up when the text changes: for
+ * enchant_dict_check_text, when it checks another text, and for an
+ * #EnchantTextChecker, when it is edited or freed.  All of it is given
+ * up when @dict is freed.  Nothing is prefetched while the cache is
+ * disabled, and by default nothing is.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_set_suggest_prefetch (EnchantDict * dict, size_t max_pending);
+
+/**
+ * enchant_dict_set_suggest_store
+ * @dict: A non-null #EnchantDict
+ * @max_words: The most words to keep suggestions for, or 0 to stop using the store
+ *
+ * Makes enchant_dict_suggest keep the spelling backend's suggestions for
+ * up to @max_words words in a file under the user's config directory,
+ * one for each language and provider, so that they are not worked out
+ * again, in this process or a later one.  Only full lists are kept:
+ * suggestions asked for with enchant_dict_suggest_bounded limits, or
+ * merged from several providers by enchant_dict_set_suggest_fanout, are
+ * not.  The personal and session word lists are applied afresh to what
+ * the store holds each time.  The store is started over when the
+ * provider or the directories it finds its dictionaries in have changed
+ * since it was written, as far as they were when it was opened, and
+ * compacted when it has grown well beyond the words it holds.
+ * Processes sharing the store add to it, but each sees only what it
+ * held when opened and what it added itself.  The store is not used by
+ * default.
+ *
+ * Returns: 0 on success, -1 if @dict's provider does not tell where its
+ * dictionaries are, or its dictionaries learn words themselves
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_set_suggest_store (EnchantDict * dict, size_t max_words);
+
+/**
+ * enchant_dict_get_stats
+ * @dict: A non-null #EnchantDict
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports what @dict has done since it was loaded, one counter at a time.
+ *
+ * "checks" counts the words checked, each word given to
+ * enchant_dict_check_batch included; "checks_session",
+ * "checks_exclude" and "checks_personal" count those decided by the
+ * words added to or removed from the session, by the exclude list and
+ * by the personal word list, and "checks_provider" those left to the
+ * provider.  "check_cache_hits" and "check_cache_misses" tell how well
+ * the cache of enchant_dict_set_check_cache_size did with the latter.
+ * "suggests" counts the words suggestions were asked for, and
+ * "suggest_cache_hits" and "suggest_cache_misses" likewise, and
+ * "suggests_learned" those answered with a correction learned by
+ * enchant_dict_store_replacement alone, and "suggests_stored" those
+ * the store of enchant_dict_set_suggest_store had the backend's
+ * suggestions for.
+ * "pwl_reloads" counts the times the word lists were read from their
+ * files, the first time included, and "pwl_reload_us" the
+ * microseconds that took.
+ *
+ * "provider_checks" counts the calls into the provider to check words,
+ * a batch of them counting once, and "provider_check_us" the
+ * microseconds they took; "provider_checks_within_10us",
+ * "provider_checks_within_100us" and so on up to
+ * "provider_checks_within_1s" count those that took at most that long.
+ * "provider_suggests", "provider_suggest_us" and
+ * "provider_suggests_within_10us" to "provider_suggests_within_1s" do
+ * the same for suggestions.
+ *
+ * Later versions may report more counters, so look them up by name.
+ * The counters are kept without locking: a report made while other
+ * threads use @dict may be a little behind them.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_get_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
+/**
+ * enchant_dict_get_memory_usage
+ * @dict: A non-null #EnchantDict
+ * @fn: An optional #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Estimates the memory @dict takes up, reporting it to @fn if given one
+ * figure at a time, in bytes.
+ *
+ * "personal" and "exclude" are taken up by the personal word list and
+ * the exclude list, their tries and tables included, and "mapped" by
+ * the compiled indexes of them that are mapped from their files.
+ * "session_words" is taken up by the words added to or removed from the
+ * session, "check_cache" and "suggest_cache" by the caches of
+ * enchant_dict_set_check_cache_size and
+ * enchant_dict_set_suggest_cache_size, and "other" by the rest of
+ * Enchant's bookkeeping.  "provider" is what the provider estimates its
+ * dictionary to take up, or 0 if it cannot tell.  An overlay or a
+ * composite dictionary counts in the dictionaries it is made of.
+ *
+ * Word lists may be shared with other dictionaries of the same files,
+ * and are counted in full by each of them; see
+ * enchant_broker_get_memory_usage.  Later versions may report more
+ * figures, so look them up by name.
+ *
+ * Returns: the sum of the figures
+ */
+ENCHANT_MODULE_EXPORT
+uint64_t enchant_dict_get_memory_usage (EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
 /**
  * enchant_dict_free_string_list
  * @dict: A non-null #EnchantDict
- * @string_list: A non-null string list returned from enchant_dict_suggest
+ * @string_list: A non-null string list returned from enchant_dict_suggest or enchant_dict_complete
  *
- * Releases the string list
+ * Releases the string list.  The list and its strings are held in one
+ * block, so they must not be freed one by one.
  */
 ENCHANT_MODULE_EXPORT
 void enchant_dict_free_string_list (EnchantDict * dict, char **string_list);
@@ -339,6 +1242,191 @@ const char *enchant_dict_get_extra_word_characters (EnchantDict * dict);
 ENCHANT_MODULE_EXPORT
 int enchant_dict_is_word_character (EnchantDict * dict, uint32_t uc, size_t n);
 
+/**
+ * ENCHANT_WORD_CHARACTER_TABLE_SIZE:
+ *
+ * The number of entries in the tables of
+ * enchant_dict_get_word_character_table and enchant_get_lowercase_table,
+ * which cover the code points below it.
+ */
+#define ENCHANT_WORD_CHARACTER_TABLE_SIZE 0x10000
+
+/**
+ * enchant_dict_get_word_character_table
+ * @dict: An #EnchantDict, or %null
+ *
+ * Returns the table enchant_dict_is_word_character answers from for code
+ * points below %ENCHANT_WORD_CHARACTER_TABLE_SIZE: bit @n of the entry
+ * for a code point is set if it is valid at position @n of a word.  Code
+ * points past the table must still be asked of
+ * enchant_dict_is_word_character.
+ *
+ * The table is built the first time it is needed, and belongs to @dict;
+ * it stays valid until @dict is freed.  enchant_broker_reload_dict has a
+ * new one built, so ask for the table again after a reload.  If @dict is
+ * %null, the table of the built-in implementation is returned, which is
+ * never freed.
+ */
+ENCHANT_MODULE_EXPORT
+const uint8_t *enchant_dict_get_word_character_table (EnchantDict * dict);
+
+/**
+ * enchant_get_lowercase_table
+ *
+ * Returns the lower case of each code point below
+ * %ENCHANT_WORD_CHARACTER_TABLE_SIZE, as personal word lists fold words
+ * to match them without regard to case; code points whose lower case
+ * lies past the table map to themselves.  The table is built the first
+ * time it is needed, and is never freed.
+ */
+ENCHANT_MODULE_EXPORT
+const uint16_t *enchant_get_lowercase_table (void);
+
+/**
+ * EnchantMisspellingFn
+ * @dict: The #EnchantDict the text was checked against
+ * @word: The misspelled word, pointing into the text; not nul-terminated
+ * @len: The byte length of @word
+ * @offset: The byte offset of @word in the text
+ * @char_offset: The character offset of @word in the text
+ * @char_len: The length of @word in characters
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to report a misspelled word of a text
+ */
+typedef void (*EnchantMisspellingFn) (EnchantDict * dict,
+				      const char * const word, size_t len,
+				      size_t offset, size_t char_offset, size_t char_len,
+				      void * user_data);
+
+/**
+ * enchant_dict_check_text
+ * @dict: A non-null #EnchantDict
+ * @text: The non-null text you wish to check, in UTF-8 encoding
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ * @fn: A #EnchantMisspellingFn, or %null if you only want the count
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Splits @text into words following enchant_dict_is_word_character,
+ * checks them all as enchant_dict_check_batch would, and calls @fn for
+ * each misspelled word, in order.  If the spelling backend fails, @fn
+ * is not called at all.
+ *
+ * Returns: The number of misspelled words, or -1 on error
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_check_text (EnchantDict * dict, const char *const text, ssize_t len,
+			     EnchantMisspellingFn fn, void * user_data);
+
+/**
+ * EnchantTextWordFn
+ * @dict: The #EnchantDict the text was split for
+ * @word: The word, pointing into the text; not nul-terminated
+ * @len: The byte length of @word
+ * @offset: The byte offset of @word in the text
+ * @char_offset: The character offset of @word in the text
+ * @char_len: The length of @word in characters
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to report a word of a text
+ */
+typedef void (*EnchantTextWordFn) (EnchantDict * dict,
+				   const char * const word, size_t len,
+				   size_t offset, size_t char_offset, size_t char_len,
+				   void * user_data);
+
+/**
+ * enchant_dict_split_text
+ * @dict: A non-null #EnchantDict
+ * @text: The non-null text you wish to split, in UTF-8 encoding
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ * @fn: A #EnchantTextWordFn, or %null if you only want the count
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Splits @text into words the way enchant_dict_check_text does, in one
+ * pass over it, and calls @fn for each of them, in order, without
+ * checking them.
+ *
+ * Returns: The number of words, or -1 if @text is not valid UTF-8
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_dict_split_text (EnchantDict * dict, const char *const text, ssize_t len,
+			     EnchantTextWordFn fn, void * user_data);
+
+typedef struct str_enchant_text_checker EnchantTextChecker;
+
+/**
+ * enchant_text_checker_new
+ * @dict: A non-null #EnchantDict, to be kept until the checker is freed
+ * @text: The text you wish to check, in UTF-8 encoding; %null if @len is 0
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ *
+ * Keeps a copy of @text, split into words as enchant_dict_check_text
+ * does, for checking it again and again as it is edited.  Only the
+ * words an edit touches are split and checked again; the others keep
+ * their verdicts until words are added to or removed from @dict, its
+ * session or its word lists.
+ *
+ * Returns: an #EnchantTextChecker, to be freed with
+ * enchant_text_checker_free, or %null if @text is not valid UTF-8
+ */
+ENCHANT_MODULE_EXPORT
+EnchantTextChecker *enchant_text_checker_new (EnchantDict * dict, const char *const text, ssize_t len);
+
+/**
+ * enchant_text_checker_edit
+ * @checker: A non-null #EnchantTextChecker
+ * @offset: The byte offset in the text the edit starts at
+ * @deleted: The number of bytes the edit deletes from @offset on
+ * @inserted: The text the edit inserts at @offset, in UTF-8 encoding; %null if @len is 0
+ * @len: The byte length of @inserted, or -1 for strlen (@inserted)
+ *
+ * Applies an edit to the text of @checker, splitting the words around
+ * it again.  @offset and @offset + @deleted must not fall inside a
+ * character.
+ *
+ * Returns: 0 on success, or -1 if the edit is out of bounds or
+ * @inserted is not valid UTF-8, in which case the text is unchanged
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_text_checker_edit (EnchantTextChecker * checker, size_t offset, size_t deleted,
+			       const char *const inserted, ssize_t len);
+
+/**
+ * enchant_text_checker_check
+ * @checker: A non-null #EnchantTextChecker
+ * @fn: A #EnchantMisspellingFn, or %null if you only want the count
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Checks the words of the text of @checker that have no verdict yet,
+ * as enchant_dict_check_batch would, and calls @fn for each misspelled
+ * word of the text, in order, with offsets into the text as it stands
+ * after the edits so far.  If the spelling backend fails, @fn is not
+ * called at all, and the words are checked again the next time.
+ *
+ * Returns: The number of misspelled words, or -1 on error
+ */
+ENCHANT_MODULE_EXPORT
+int enchant_text_checker_check (EnchantTextChecker * checker, EnchantMisspellingFn fn, void * user_data);
+
+/**
+ * enchant_text_checker_get_text
+ * @checker: A non-null #EnchantTextChecker
+ * @out_len: The location to store the byte length of the text, or %null
+ *
+ * Returns: the text of @checker after the edits so far, nul-terminated,
+ * valid until the next edit
+ */
+ENCHANT_MODULE_EXPORT
+const char *enchant_text_checker_get_text (EnchantTextChecker * checker, size_t * out_len);
+
+/**
+ * enchant_text_checker_free
+ * @checker: A non-null #EnchantTextChecker
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_text_checker_free (EnchantTextChecker * checker);
+
 /**
  * EnchantDictDescribeFn
  * @lang_tag: The dictionary's language tag (eg: en_US, de_AT, ...)
@@ -382,12 +1470,87 @@ void enchant_broker_list_dicts (EnchantBroker * broker,
 				EnchantDictDescribeFn fn,
 				void * user_data);
 
+/**
+ * EnchantTraceFn
+ * @event: What is being done, see enchant_set_trace_fn
+ * @tag: The language tag of the dictionary, or the file of a word list, or %null
+ * @provider_name: The identifier of the provider asked, or %null
+ * @len: The byte length of the word, the number of words of a batch, or 0
+ * @elapsed_us: -1 when the call starts, and the microseconds it took when it ends
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to trace calls as they start and end
+ */
+typedef void (*EnchantTraceFn) (const char * const event,
+				const char * const tag,
+				const char * const provider_name,
+				size_t len, int64_t elapsed_us,
+				void * user_data);
+
+/**
+ * enchant_set_trace_fn
+ * @fn: An #EnchantTraceFn, or %null to stop tracing
+ * @user_data: Optional user-data
+ *
+ * Has @fn called, from whichever thread makes the call, at the start
+ * and at the end of each "check" and "suggest" of a dictionary, of each
+ * "request_dict" of a broker, of each "pwl_refresh" reading a personal
+ * word list again, and of each call into a provider:
+ * "provider_check", "provider_check_batch" and "provider_suggest".
+ * Calls already under way when @fn is set are not reported.  A function
+ * replaced may still be called by threads that were about to call it.
+ *
+ * Where the platform has them, the same is reported to the static
+ * probes enchant:enter and enchant:leave, and to the Enchant ETW
+ * provider on Windows.  While no one listens, tracing costs a test and
+ * a branch per call.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_set_trace_fn (EnchantTraceFn fn, void * user_data);
+
+/**
+ * EnchantMallocFn
+ * @size: The number of bytes wanted, never 0
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to allocate what Enchant hands to the application
+ *
+ * Returns: the block, or %null if there is no memory left, in which
+ * case Enchant aborts as it does when it runs out of memory itself
+ */
+typedef void * (*EnchantMallocFn) (size_t size, void * user_data);
+
+/**
+ * EnchantFreeFn
+ * @ptr: A non-null block an #EnchantMallocFn returned
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Callback used to release what an #EnchantMallocFn allocated
+ */
+typedef void (*EnchantFreeFn) (void * ptr, void * user_data);
+
+/**
+ * enchant_set_allocator
+ * @malloc_fn: An #EnchantMallocFn, or %null to go back to the default
+ * @free_fn: An #EnchantFreeFn, %null if and only if @malloc_fn is
+ * @user_data: Optional user-data
+ *
+ * Has the word lists Enchant hands out, its suggestions and
+ * completions, allocated with @malloc_fn and released with @free_fn.
+ * Only set it while no such list is outstanding, since a list must be
+ * released with the allocator it came from.
+ */
+ENCHANT_MODULE_EXPORT
+void enchant_set_allocator (EnchantMallocFn malloc_fn, EnchantFreeFn free_fn, void * user_data);
+
 /**
  * enchant_set_prefix_dir
  *
  * Set the prefix dir. This overrides any auto-detected value,
  * and can also be used on systems or installations where
- * auto-detection does not work.
+ * auto-detection does not work.  The directories worked out from the
+ * prefix before are worked out again; a broker already made keeps the
+ * provider modules it found.
  *
  */
 ENCHANT_MODULE_EXPORT
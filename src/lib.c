@@ -47,58 +47,324 @@
 #include "enchant.h"
 #include "enchant-provider.h"
 #include "pwl.h"
+#include "trace.h"
 #include "unused-parameter.h"
 #include "relocatable.h"
 #include "configmake.h"
 
 /********************************************************************************/
 
+/* a spelling backend's module, loaded the first time it is needed,
+ * see enchant_broker_load_provider */
+typedef struct str_enchant_provider_module
+{
+	char *filename;
+	char *name;	/* the provider's name, guessed from the file name until it is loaded */
+	gboolean tried;	/* whether it was loaded, or failed to */
+	EnchantProvider *provider;	/* once loaded, or NULL */
+	GModule *module;	/* the provider was loaded from */
+	unsigned int abi_version;	/* the module tells, see enchant_provider_has_extensions */
+
+	/* how long loading it took, in microseconds, -1 for the steps not
+	 * taken, see enchant_broker_describe_load_times */
+	gint64 open_time;
+	gint64 init_time;
+	gint64 configure_time;
+
+	/* what list_dicts found the last time, and the directories it was
+	 * found in with their modification times then, see
+	 * enchant_broker_list_provider_dicts */
+	char **dicts;
+	char **dict_dirs;
+	gint64 *dir_stamps;
+	size_t n_dict_dirs;
+} EnchantProviderModule;
+
+/* a provider ordering, parsed when it is set and resolved to the
+ * provider modules the first time it is used */
+typedef struct str_enchant_ordering
+{
+	char **names;		/* the providers named, best first */
+	guint *tiers;		/* the group each of them is in, or NULL if none has more than one, see enchant_broker_rank_providers */
+	GPtrArray *modules;	/* all the modules in that order, once known for sure */
+} EnchantOrdering;
+
+/* What a provider's dictionaries of a language took, added up over the
+ * sessions that used them, see enchant_broker_rank_providers */
+typedef enum
+{
+	ENCHANT_COST_SESSIONS = 0,	/* 0 if the provider had no dictionary for it */
+	ENCHANT_COST_REQUEST_US,
+	ENCHANT_COST_CHECKS,
+	ENCHANT_COST_CHECK_US,
+	ENCHANT_COST_SUGGESTS,
+	ENCHANT_COST_SUGGEST_US,
+	ENCHANT_N_COSTS
+} EnchantCost;
+
+/* Once this many sessions are counted, the totals are halved, so that
+ * what was measured lately counts the most */
+#define ENCHANT_COST_MAX_SESSIONS 64
+
+/* The latencies of the calls into the provider are counted in buckets
+ * of these upper bounds, in microseconds; slower calls are only counted
+ * in the totals */
+#define ENCHANT_N_LATENCY_BUCKETS 6
+static const gint64 enchant_latency_bounds[ENCHANT_N_LATENCY_BUCKETS] = { 10, 100, 1000, 10000, 100000, 1000000 };
+
+/* the counters enchant_dict_get_stats reports, in the order it does */
+typedef enum
+{
+	ENCHANT_STAT_CHECKS = 0,
+	ENCHANT_STAT_CHECKS_SESSION,
+	ENCHANT_STAT_CHECKS_EXCLUDE,
+	ENCHANT_STAT_CHECKS_PERSONAL,
+	ENCHANT_STAT_CHECKS_PROVIDER,
+	ENCHANT_STAT_CHECK_CACHE_HITS,
+	ENCHANT_STAT_CHECK_CACHE_MISSES,
+	ENCHANT_STAT_SUGGESTS,
+	ENCHANT_STAT_SUGGEST_CACHE_HITS,
+	ENCHANT_STAT_SUGGEST_CACHE_MISSES,
+	ENCHANT_STAT_SUGGESTS_LEARNED,
+	ENCHANT_STAT_SUGGESTS_STORED,
+	ENCHANT_STAT_PWL_RELOADS,
+	ENCHANT_STAT_PWL_RELOAD_US,
+	ENCHANT_STAT_PROVIDER_CHECKS,	/* followed by their total time and buckets */
+	ENCHANT_STAT_PROVIDER_CHECK_US,
+	ENCHANT_STAT_PROVIDER_CHECKS_WITHIN,
+	ENCHANT_STAT_PROVIDER_SUGGESTS = ENCHANT_STAT_PROVIDER_CHECKS_WITHIN + ENCHANT_N_LATENCY_BUCKETS,	/* likewise */
+	ENCHANT_STAT_PROVIDER_SUGGEST_US,
+	ENCHANT_STAT_PROVIDER_SUGGESTS_WITHIN,
+	ENCHANT_N_STATS = ENCHANT_STAT_PROVIDER_SUGGESTS_WITHIN + ENCHANT_N_LATENCY_BUCKETS
+} EnchantStat;
+
+/* the figures enchant_dict_get_memory_usage reports, in the order it does */
+typedef enum
+{
+	ENCHANT_MEMORY_PERSONAL = 0,
+	ENCHANT_MEMORY_EXCLUDE,
+	ENCHANT_MEMORY_MAPPED,
+	ENCHANT_MEMORY_SESSION_WORDS,
+	ENCHANT_MEMORY_CHECK_CACHE,
+	ENCHANT_MEMORY_SUGGEST_CACHE,
+	ENCHANT_MEMORY_PROVIDER,
+	ENCHANT_MEMORY_OTHER,
+	ENCHANT_N_MEMORY
+} EnchantMemory;
+
+/* Counters are added to without taking a lock: each thread adds to one
+ * of a few stripes of them, so that threads seldom contend for a cache
+ * line, and the stripes are summed up when they are read */
+#define ENCHANT_STATS_STRIPES 8
+#define ENCHANT_STATS_STRIDE ((ENCHANT_N_STATS + 7) & ~7)
+
+/* 64 bits wide even where gsize is not, so that the microseconds the
+ * provider took do not wrap after 71 minutes */
+typedef struct str_enchant_stats
+{
+	guint64 counts[ENCHANT_STATS_STRIPES * ENCHANT_STATS_STRIDE];
+} EnchantStats;
+
 struct str_enchant_broker
 {
-	GSList *provider_list;	/* list of all of the spelling backend providers */
+	char *module_dir;
+	GPtrArray *provider_modules;	/* the EnchantProviderModules found in module_dir, in order */
+	GMutex modules_lock;	/* guards loading them */
+	GMutex inventory_lock;	/* guards what the modules' providers listed */
+	GMutex lock;		/* guards the maps and write_behind below */
+	GCond loaded;		/* signalled when a dictionary finished loading */
 	GHashTable *dict_map;		/* map of language tag -> dictionary */
-	GHashTable *provider_ordering; /* map of language tag -> provider order */
+	GHashTable *tags;	/* map of language tag, as given or normalized -> its EnchantTag */
+	GPtrArray *interned_tags;	/* the EnchantTags, each once */
+	GHashTable *loading;	/* language tags being loaded by some thread */
+	GHashTable *missing;	/* map of language tag no provider had -> stamp of the dictionary dirs then */
+	guint rescans;		/* counts enchant_broker_rescan calls */
+	GHashTable *provider_ordering; /* map of language tag -> EnchantOrdering */
+	guint ordering_generation;	/* bumped whenever an ordering is set */
+	gboolean write_behind;	/* whether personal word lists are written in the background */
+	GQueue idle;		/* unreferenced dictionaries kept loaded, least recently freed first */
+	size_t idle_max;	/* see enchant_broker_set_dict_pool */
+	gint64 idle_timeout;	/* in microseconds, or -1 */
+	guint n_preloaded;	/* dictionaries preloaded and not requested yet */
+	GMutex provider_lock;	/* lets providers that are not thread-safe take turns */
+	GMutex stats_lock;	/* guards the fields below */
+	GPtrArray *sessions;	/* of the dictionaries counted in enchant_broker_get_stats */
+	guint64 retired_stats[ENCHANT_N_STATS];	/* what those since disposed of counted */
+	gboolean adaptive;	/* whether some ordering groups providers to be ranked */
+	GHashTable *provider_costs;	/* map of language tag -> provider name -> EnchantCost totals, read on first use */
+	gboolean costs_changed;	/* since they were read */
+
+	GMutex tasks_lock;	/* guards the fields below, see enchant_broker_submit */
+	GCond task_done;	/* signalled when a task or a runner finished */
+	GQueue tasks;		/* the EnchantTasks not started yet, oldest first */
+	GQueue background_tasks;	/* those of enchant_broker_submit_background, started once tasks is empty */
+	guint n_unfinished;	/* tasks submitted and not finished yet */
+	guint n_runners;	/* handed to the executor and not run yet */
+	EnchantExecutorFn executor;	/* see enchant_broker_set_executor, or NULL for workers */
+	void *executor_data;
+	GThreadPool *workers;	/* made on first use */
+	guint n_workers;	/* see enchant_broker_set_worker_threads */
+
+	struct str_enchant_errors *errors;	/* see enchant_errors_set */
+};
 
-	gchar * error;
+/* a language tag resolved once, see enchant_broker_intern_tag */
+struct str_enchant_tag
+{
+	char *tag;		/* normalized */
+	char *iso_639_tag;	/* its language alone, or NULL if that is tag */
+	EnchantDict *dict;	/* the one it was last requested as, while in dict_map; guarded by the broker's lock */
 };
 
+/* what the session's lists make of a word */
+typedef enum
+{
+	ENCHANT_SESSION_DEFER = 0,	/* up to the provider */
+	ENCHANT_SESSION_GOOD,
+	ENCHANT_SESSION_BAD
+} EnchantSessionVerdict;
+
+/* what the results in an EnchantWordCache depend on */
+typedef struct str_enchant_word_cache_stamp
+{
+	guint session;		/* generation of the session */
+	guint personal;		/* of its personal word list */
+	guint exclude;		/* of its exclude list */
+} EnchantWordCacheStamp;
+
+/* a bounded cache of results looked up by word, see enchant_word_cache_lookup */
+typedef struct str_enchant_word_cache
+{
+	GMutex lock;
+	GHashTable *entries;	/* recent words -> their EnchantWordCacheEntry, if enabled */
+	GQueue lru;		/* the entries, most recently used first */
+	size_t size;
+	EnchantWordCacheStamp stamp;	/* the entries were stored for */
+	GDestroyNotify value_free;
+	size_t n_hits, n_misses;
+} EnchantWordCache;
+
+/* a correction the user chose for a misspelling, see
+ * enchant_session_store_replacement */
+typedef struct str_enchant_replacement
+{
+	char *correction;
+	guint count;		/* of the times it was chosen */
+} EnchantReplacement;
+
+/* A correction chosen this many times, and at least as many times over
+ * as the others of its misspelling together, is taken to be the one
+ * wanted, see enchant_session_lookup_replacements */
+#define ENCHANT_REPLACEMENT_CONFIDENT_COUNT 3
+#define ENCHANT_REPLACEMENT_CONFIDENT_RATIO 3
+
 typedef struct str_enchant_session
 {
-	GHashTable *session_include;
-	GHashTable *session_exclude;
-	EnchantPWL *personal;
+	guint id;		/* unique, see enchant_dict_get_suggest_partial */
+	struct str_enchant_errors *errors;	/* see enchant_errors_set */
+	GRWLock lock;		/* guards session_words */
+	GHashTable *session_words;	/* words added to or removed from the session -> verdict */
+	GMutex pwl_lock;	/* guards opening the word lists and write_behind */
+	EnchantPWL *personal;	/* opened on first use, see enchant_session_get_personal */
 	EnchantPWL *exclude;
 
 	char * personal_filename;
 	char * exclude_filename;
+	char * replacements_filename;	/* or NULL to keep them in memory only */
 	char * language_tag;
 
-	char * error;
+	GMutex replacements_lock;	/* guards replacements */
+	GHashTable *replacements;	/* misspellings -> GPtrArray of EnchantReplacement, best first; read on first use */
+	struct str_enchant_suggest_store *suggest_store;	/* see enchant_dict_set_suggest_store, or NULL */
 
 	gboolean is_pwl;
+	gboolean readonly;	/* see enchant_broker_request_readonly_pwl_dict */
+	gboolean write_behind;	/* whether it asked its word lists for write-behind mode */
 
 	EnchantProvider * provider;
+	gboolean serialize_provider;	/* whether calls into the provider have to take turns */
+	gboolean dict_extended;	/* whether the dictionary's extension members can be read */
+	EnchantDict *provider_dict;	/* the provider's own, if it can tell its memory usage */
+	char *suggest_profile;	/* see enchant_dict_set_suggest_profile, or NULL for the default */
+	GMutex provider_lock;
+	GRWLock swap_lock;	/* held to read by calls into the provider's dictionary, see enchant_broker_reload_dict */
+
+	GMutex clones_lock;	/* guards the fields below */
+	GPtrArray *idle_clones;	/* of the provider's dictionary, see enchant_session_acquire_dict */
+	guint n_clones;		/* made so far, idle or in use */
+	guint max_clones;	/* 0 for a dictionary that is not cloned */
+
+	gint generation;	/* bumped when words are added or removed, see enchant_session_changed */
+	EnchantWordCache check_cache;	/* of the provider's verdicts */
+	EnchantWordCache suggest_cache;	/* of merged suggestions */
+
+	GMutex fanout_lock;	/* guards the fields below */
+	GPtrArray *fanout;	/* other providers' dictionaries, see enchant_dict_set_suggest_fanout */
+	int fanout_timeout_ms;
+	guint n_fanout_calls;	/* asking them, maybe left behind by their callers */
+	GCond fanout_done;
+
+	GMutex prefetch_lock;	/* guards the fields below */
+	GPtrArray *prefetches;	/* EnchantPrefetches not finished yet, see enchant_session_prefetch */
+	guint max_prefetches;	/* see enchant_dict_set_suggest_prefetch */
+	struct str_enchant_task_group *prefetch_group;	/* counts them for enchant_session_stop_prefetches */
+
+	EnchantStats stats;
+	EnchantBroker *broker;	/* whose totals it counts towards, see enchant_broker_add_session */
+	gint64 request_us;	/* how long the provider took to open the dictionary, or 0 if it is not ranked */
 } EnchantSession;
 
+
 typedef struct str_enchant_dict_private_data
 {
 	unsigned int reference_count;
 	EnchantSession* session;
+	guint8 *word_chars;	/* see enchant_dict_get_word_chars */
+	GSList *retired_word_chars;	/* those of the dictionary before a reload, kept till it is freed */
+	GList *idle_link;	/* in the broker's idle queue while kept unreferenced */
+	gboolean preloaded;	/* holds a reference for its first request, see enchant_broker_preload */
+	gint64 released;	/* monotonic time it was last freed */
+	/* the dictionaries an overlay or a composite dictionary is made of, see
+	 * enchant_broker_request_overlay_dict and enchant_broker_request_multi_dict */
+	EnchantDict **members;
+	size_t n_members;
 } EnchantDictPrivateData;
 
 typedef EnchantProvider *(*EnchantProviderInitFunc) (void);
 typedef void             (*EnchantPreConfigureFunc) (EnchantProvider * provider, const char * module_dir);
+typedef unsigned int     (*EnchantProviderAbiVersionFunc) (void);
 
 /********************************************************************************/
 /********************************************************************************/
 
+/* The directories are worked out once, and again only when what they
+ * depend on changes: the relocated paths on the prefix, see
+ * enchant_set_prefix_dir, and the user config dir on ENCHANT_CONFIG_DIR.
+ * Each caller gets a copy of its own. */
+static GMutex enchant_dirs_lock;	/* guards the fields below */
+static GHashTable *enchant_relocated;	/* path -> relocated path, made on first use */
+static gboolean enchant_user_config_dir_known;
+static char *enchant_user_config_dir;	/* or NULL if there is none */
+static char *enchant_user_config_dir_env;	/* ENCHANT_CONFIG_DIR it was worked out with */
+
 /* Relocate a path and ensure the result is allocated on the heap */
 char *
 enchant_relocate (const char *path)
 {
-	char *newpath = (char *) relocate (path);
-	if (path == newpath)
-		newpath = strdup (newpath);
+	g_mutex_lock (&enchant_dirs_lock);
+	if (enchant_relocated == NULL)
+		enchant_relocated = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	const char *relocated = g_hash_table_lookup (enchant_relocated, path);
+	if (relocated == NULL)
+		{
+			char *allocated;
+			relocated = g_strdup (relocate2 (path, &allocated));
+			free (allocated);
+			g_hash_table_insert (enchant_relocated, g_strdup (path), (gpointer) relocated);
+		}
+	char *newpath = strdup (relocated);
+	g_mutex_unlock (&enchant_dirs_lock);
+
 	return newpath;
 }
 
@@ -116,9 +382,23 @@ char *
 enchant_get_user_config_dir (void)
 {
 	const gchar * env = g_getenv("ENCHANT_CONFIG_DIR");
-	if (env)
-		return g_filename_to_utf8(env, -1, NULL, NULL, NULL);
-	return g_build_filename (g_get_user_config_dir (), "enchant", NULL);
+
+	g_mutex_lock (&enchant_dirs_lock);
+	if (!enchant_user_config_dir_known || g_strcmp0 (env, enchant_user_config_dir_env))
+		{
+			g_free (enchant_user_config_dir);
+			g_free (enchant_user_config_dir_env);
+			if (env)
+				enchant_user_config_dir = g_filename_to_utf8(env, -1, NULL, NULL, NULL);
+			else
+				enchant_user_config_dir = g_build_filename (g_get_user_config_dir (), "enchant", NULL);
+			enchant_user_config_dir_env = g_strdup (env);
+			enchant_user_config_dir_known = TRUE;
+		}
+	char *user_config_dir = g_strdup (enchant_user_config_dir);
+	g_mutex_unlock (&enchant_dirs_lock);
+
+	return user_config_dir;
 }
 
 GSList *
@@ -221,1212 +501,7047 @@ enchant_iso_639_from_tag (const char * const dict_tag)
 	return new_tag;
 }
 
+static guint
+enchant_session_id_new (void)
+{
+	static gint last_id;
+	return (guint) g_atomic_int_add (&last_id, 1) + 1;
+}
+
+/* Errors are kept per thread, so that one thread never reports the
+ * failure of another.  Each broker and session keeps its own errors
+ * rather than leaving them with the threads, so that they all go when
+ * it does. */
+typedef struct str_enchant_errors
+{
+	gint ref_count;
+	GMutex lock;		/* guards by_thread */
+	GHashTable *by_thread;	/* GThread * -> its last error */
+	gint n_errors;		/* the size of by_thread, read without the lock */
+} EnchantErrors;
+
+static EnchantErrors *
+enchant_errors_new (void)
+{
+	EnchantErrors *errors = g_new0 (EnchantErrors, 1);
+	errors->ref_count = 1;
+	g_mutex_init (&errors->lock);
+	errors->by_thread = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	return errors;
+}
+
+static EnchantErrors *
+enchant_errors_ref (EnchantErrors *errors)
+{
+	g_atomic_int_inc (&errors->ref_count);
+	return errors;
+}
+
 static void
-enchant_session_destroy (EnchantSession * session)
+enchant_errors_unref (EnchantErrors *errors)
 {
-	g_hash_table_destroy (session->session_include);
-	g_hash_table_destroy (session->session_exclude);
-	enchant_pwl_free (session->personal);
-	enchant_pwl_free (session->exclude);
-	g_free (session->personal_filename);
-	g_free (session->exclude_filename);
-	free (session->language_tag);
+	if (!g_atomic_int_dec_and_test (&errors->ref_count))
+		return;
+	g_hash_table_destroy (errors->by_thread);
+	g_mutex_clear (&errors->lock);
+	g_free (errors);
+}
 
-	if (session->error)
-		g_free (session->error);
+/* Only the calling thread ever replaces its own entry, so what is
+ * returned stays put until it sets or clears its error again. */
+static const char *
+enchant_errors_get (EnchantErrors *errors)
+{
+	if (g_atomic_int_get (&errors->n_errors) == 0)
+		return NULL;
+	g_mutex_lock (&errors->lock);
+	const char *err = g_hash_table_lookup (errors->by_thread, g_thread_self ());
+	g_mutex_unlock (&errors->lock);
+	return err;
+}
 
-	g_free (session);
+/* takes over err */
+static void
+enchant_errors_set (EnchantErrors *errors, char * err)
+{
+	g_mutex_lock (&errors->lock);
+	g_hash_table_replace (errors->by_thread, g_thread_self (), err);
+	g_atomic_int_set (&errors->n_errors, g_hash_table_size (errors->by_thread));
+	g_mutex_unlock (&errors->lock);
 }
 
-static EnchantSession *
-enchant_session_new_with_pwl (EnchantProvider * provider,
-			      const char * const pwl,
-			      const char * const excl,
-			      const char * const lang,
-			      gboolean fail_if_no_pwl)
+static void
+enchant_errors_clear (EnchantErrors *errors)
 {
-	EnchantPWL *personal = NULL;
-	if (pwl)
-		personal = enchant_pwl_init_with_file (pwl);
-	if (personal == NULL) {
-		if (fail_if_no_pwl)
-			return NULL;
-		else
-			personal = enchant_pwl_init ();
-	}
+	if (g_atomic_int_get (&errors->n_errors) == 0)
+		return;
+	g_mutex_lock (&errors->lock);
+	if (g_hash_table_remove (errors->by_thread, g_thread_self ()))
+		g_atomic_int_set (&errors->n_errors, g_hash_table_size (errors->by_thread));
+	g_mutex_unlock (&errors->lock);
+}
 
-	EnchantPWL *exclude = NULL;
-	if (excl)
-		exclude = enchant_pwl_init_with_file (excl);
-	if (exclude == NULL)
-		exclude = enchant_pwl_init ();
+/* The function enchant_set_trace_fn set.  One that is replaced is
+ * never freed, since other threads may still be calling it. */
+typedef struct str_enchant_trace_listener
+{
+	EnchantTraceFn fn;
+	void *user_data;
+} EnchantTraceListener;
 
-	EnchantSession * session = g_new0 (EnchantSession, 1);
-	session->session_include = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	session->session_exclude = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	session->personal = personal;
-	session->exclude = exclude;
-	session->provider = provider;
-	session->language_tag = strdup (lang);
-	session->personal_filename = g_strdup (pwl); /* Need g_strdup because may be NULL */
-	session->exclude_filename = g_strdup (excl); /* Need g_strdup because may be NULL */
+gpointer enchant_trace_listener;
 
-	return session;
+#if defined(ENCHANT_TRACE_HAVE_SDT)
+unsigned short enchant_enter_semaphore __attribute__ ((section (".probes")));
+unsigned short enchant_leave_semaphore __attribute__ ((section (".probes")));
+#endif
+
+#if defined(ENCHANT_TRACE_HAVE_ETW)
+/* {5a0f8e1c-3b9d-4c52-9a57-6f1e2d8b7c40} */
+TRACELOGGING_DEFINE_PROVIDER (enchant_trace_provider, "Enchant",
+			      (0x5a0f8e1c, 0x3b9d, 0x4c52, 0x9a, 0x57, 0x6f, 0x1e, 0x2d, 0x8b, 0x7c, 0x40));
+
+BOOL WINAPI
+DllMain (HINSTANCE instance _GL_UNUSED_PARAMETER, DWORD reason, LPVOID reserved _GL_UNUSED_PARAMETER)
+{
+	if (reason == DLL_PROCESS_ATTACH)
+		TraceLoggingRegister (enchant_trace_provider);
+	else if (reason == DLL_PROCESS_DETACH)
+		TraceLoggingUnregister (enchant_trace_provider);
+	return TRUE;
 }
+#endif
 
-static EnchantSession *
-_enchant_session_new (EnchantProvider *provider, const char * const user_config_dir,
-		      const char * const lang, gboolean fail_if_no_pwl)
+void
+enchant_set_trace_fn (EnchantTraceFn fn, void * user_data)
 {
-	if (!user_config_dir || !lang)
-		return NULL;
+	EnchantTraceListener *listener = NULL;
+	if (fn)
+		{
+			listener = g_new (EnchantTraceListener, 1);
+			listener->fn = fn;
+			listener->user_data = user_data;
+		}
+	g_atomic_pointer_set (&enchant_trace_listener, listener);
+}
 
-	char *filename = g_strdup_printf ("%s.dic", lang);
-	char *dic = g_build_filename (user_config_dir, filename, NULL);
-	g_free (filename);
+static const char *
+enchant_trace_provider_name (EnchantProvider * provider)
+{
+	return provider && provider->identify ? (*provider->identify) (provider) : NULL;
+}
 
-	filename = g_strdup_printf ("%s.exc", lang);
-	char *excl = g_build_filename (user_config_dir, filename, NULL);
-	g_free (filename);
+void
+enchant_trace_enter_slow (EnchantTrace * trace)
+{
+	const char *provider_name = enchant_trace_provider_name (trace->provider);
 
-	EnchantSession * session = enchant_session_new_with_pwl (provider, dic, excl, lang, fail_if_no_pwl);
+#if defined(ENCHANT_TRACE_HAVE_SDT)
+	DTRACE_PROBE4 (enchant, enter, trace->event, trace->tag, provider_name, trace->len);
+#endif
+#if defined(ENCHANT_TRACE_HAVE_ETW)
+	TraceLoggingWrite (enchant_trace_provider, "Enter",
+			   TraceLoggingString (trace->event, "Event"),
+			   TraceLoggingString (trace->tag, "Tag"),
+			   TraceLoggingString (provider_name, "Provider"),
+			   TraceLoggingUInt64 (trace->len, "Length"));
+#endif
+	EnchantTraceListener *listener = g_atomic_pointer_get (&enchant_trace_listener);
+	if (listener)
+		(*listener->fn) (trace->event, trace->tag, provider_name, trace->len, -1, listener->user_data);
 
-	g_free (dic);
-	g_free (excl);
+	/* what the listener does is not timed */
+	trace->start = g_get_monotonic_time ();
+}
 
-	return session;
+void
+enchant_trace_leave_slow (EnchantTrace * trace)
+{
+	gint64 elapsed = g_get_monotonic_time () - trace->start;
+	const char *provider_name = enchant_trace_provider_name (trace->provider);
+
+#if defined(ENCHANT_TRACE_HAVE_SDT)
+	DTRACE_PROBE5 (enchant, leave, trace->event, trace->tag, provider_name, trace->len, elapsed);
+#endif
+#if defined(ENCHANT_TRACE_HAVE_ETW)
+	TraceLoggingWrite (enchant_trace_provider, "Leave",
+			   TraceLoggingString (trace->event, "Event"),
+			   TraceLoggingString (trace->tag, "Tag"),
+			   TraceLoggingString (provider_name, "Provider"),
+			   TraceLoggingUInt64 (trace->len, "Length"),
+			   TraceLoggingInt64 (elapsed, "ElapsedUs"));
+#endif
+	EnchantTraceListener *listener = g_atomic_pointer_get (&enchant_trace_listener);
+	if (listener)
+		(*listener->fn) (trace->event, trace->tag, provider_name, trace->len, elapsed, listener->user_data);
 }
 
-static EnchantSession *
-enchant_session_new (EnchantProvider *provider, const char * const lang)
+static void enchant_session_set_write_behind (EnchantSession * session, gboolean enabled);
+static EnchantPWL *enchant_session_get_personal (EnchantSession * session);
+static void enchant_dict_destroyed (gpointer data);
+static EnchantPWL *enchant_session_get_exclude (EnchantSession * session);
+static void enchant_session_clear_error (EnchantSession * session);
+static void enchant_provider_lock (EnchantProvider * provider);
+static void enchant_provider_unlock (EnchantProvider * provider);
+static unsigned int enchant_provider_get_abi_version (EnchantProvider * provider);
+static gboolean enchant_provider_has_extensions (EnchantProvider * provider);
+static gboolean enchant_provider_is_thread_safe (EnchantProvider * provider);
+static gboolean enchant_provider_stamp_dict_dirs (EnchantProvider * provider, char *** out_dirs,
+						  gint64 ** out_stamps, size_t * out_n_dirs);
+
+/* The words added to and removed from a session are kept in one table,
+ * keyed by EnchantSessionWords so that it can be probed with a word
+ * that is not NUL-terminated without copying it */
+typedef struct str_enchant_session_word
 {
-	char *user_config_dir = enchant_get_user_config_dir ();
+	const char *word;
+	size_t len;
+} EnchantSessionWord;
 
-	EnchantSession * session = NULL;
-	session = _enchant_session_new (provider, user_config_dir, lang, TRUE);
+typedef struct str_enchant_word_cache_entry
+{
+	EnchantSessionWord key;
+	GList link;
+	gpointer value;
+	char word[];
+} EnchantWordCacheEntry;
+
+static guint
+enchant_session_word_hash (gconstpointer key)
+{
+	const EnchantSessionWord *word = key;
 
-	if (session == NULL && user_config_dir != NULL)
-		{
-			enchant_ensure_dir_exists (user_config_dir);
-			session = _enchant_session_new (provider, user_config_dir, lang, FALSE);
-		}
+	/* as g_str_hash */
+	guint hash = 5381;
+	for (size_t i = 0; i < word->len; i++)
+		hash = (hash << 5) + hash + (signed char) word->word[i];
+	return hash;
+}
 
-	g_free (user_config_dir);
+static gboolean
+enchant_session_word_equal (gconstpointer a, gconstpointer b)
+{
+	const EnchantSessionWord *word_a = a, *word_b = b;
+	return word_a->len == word_b->len && memcmp (word_a->word, word_b->word, word_a->len) == 0;
+}
 
-	return session;
+static GHashTable *
+enchant_session_list_new (void)
+{
+	return g_hash_table_new_full (enchant_session_word_hash, enchant_session_word_equal, g_free, NULL);
 }
 
+/* The provider's verdicts depend on the words added and removed through
+ * it, and suggestions on the session's lists and word lists as well. */
 static void
-enchant_session_add (EnchantSession * session, const char * const word, size_t len)
+enchant_session_changed (EnchantSession * session)
 {
-	char* key = g_strndup (word, len);
-	g_hash_table_remove (session->session_exclude, key);
-	g_hash_table_insert (session->session_include, key, GINT_TO_POINTER(TRUE));
+	g_atomic_int_inc (&session->generation);
 }
 
 static void
-enchant_session_remove (EnchantSession * session, const char * const word, size_t len)
+enchant_session_list_set (EnchantSession * session, const char * const word, size_t len,
+			  EnchantSessionVerdict verdict)
 {
-	char* key = g_strndup (word, len);
-	g_hash_table_remove (session->session_include, key);
-	g_hash_table_insert (session->session_exclude, key, GINT_TO_POINTER(TRUE));
+	/* the word is kept in the same block, after the key */
+	EnchantSessionWord *key = g_malloc (sizeof (EnchantSessionWord) + len + 1);
+	char *copy = (char *) (key + 1);
+	memcpy (copy, word, len);
+	copy[len] = '\0';
+	key->word = copy;
+	key->len = len;
+
+	g_rw_lock_writer_lock (&session->lock);
+	g_hash_table_replace (session->session_words, key, GINT_TO_POINTER (verdict));
+	g_rw_lock_writer_unlock (&session->lock);
+	enchant_session_changed (session);
 }
 
-static void
-enchant_session_add_personal (EnchantSession * session, const char * const word, size_t len)
+static EnchantSessionVerdict
+enchant_session_list_lookup (EnchantSession * session, const char * const word, size_t len)
 {
-	enchant_pwl_add(session->personal, word, len);
+	EnchantSessionWord key = { word, len };
+	EnchantSessionVerdict verdict = ENCHANT_SESSION_DEFER;
+
+	g_rw_lock_reader_lock (&session->lock);
+	if (g_hash_table_size (session->session_words) != 0)
+		verdict = GPOINTER_TO_INT (g_hash_table_lookup (session->session_words, &key));
+	g_rw_lock_reader_unlock (&session->lock);
+	return verdict;
 }
 
+/* The results in a cache are only good for the stamp they were stored
+ * with: a lookup with another stamp empties the cache first, and a
+ * result worked out for an older stamp is not stored.  Since lookups
+ * and stores are made without holding any other lock, this is what
+ * keeps a result from outliving a change made while it was worked out.
+ * Caches are disabled while their size is 0. */
 static void
-enchant_session_remove_personal (EnchantSession * session, const char * const word, size_t len)
+enchant_word_cache_init (EnchantWordCache * cache, GDestroyNotify value_free)
 {
-	enchant_pwl_remove(session->personal, word, len);
+	g_mutex_init (&cache->lock);
+	g_queue_init (&cache->lru);
+	cache->value_free = value_free;
 }
 
 static void
-enchant_session_add_exclude (EnchantSession * session, const char * const word, size_t len)
+enchant_word_cache_drop (EnchantWordCache * cache, EnchantWordCacheEntry * entry)
 {
-	enchant_pwl_add(session->exclude, word, len);
+	g_queue_unlink (&cache->lru, &entry->link);
+	g_hash_table_remove (cache->entries, &entry->key);
+	if (cache->value_free)
+		(*cache->value_free) (entry->value);
+	g_free (entry);
 }
 
 static void
-enchant_session_remove_exclude (EnchantSession * session, const char * const word, size_t len)
+enchant_word_cache_trim (EnchantWordCache * cache, size_t size)
 {
-	enchant_pwl_remove(session->exclude, word, len);
+	while (g_queue_get_length (&cache->lru) > size)
+		enchant_word_cache_drop (cache, g_queue_peek_tail (&cache->lru));
 }
 
-/* a word is excluded if it is in the exclude dictionary or in the session exclude list
- *  AND the word has not been added to the session include list
- */
+/* on a hit, sets *value to a copy of the result made with copy, if given */
 static gboolean
-enchant_session_exclude (EnchantSession * session, const char * const word, size_t len)
+enchant_word_cache_lookup (EnchantWordCache * cache, const char * const word, size_t len,
+			   const EnchantWordCacheStamp * stamp, GCopyFunc copy, gpointer * value)
 {
-	char * utf = g_strndup (word, len);
-	gboolean result = !g_hash_table_lookup (session->session_include, utf) &&
-		(g_hash_table_lookup (session->session_exclude, utf) ||
-		 enchant_pwl_check (session->exclude, word, len) == 0);
-	g_free (utf);
+	EnchantSessionWord key = { word, len };
+	EnchantWordCacheEntry *entry = NULL;
 
-	return result;
+	g_mutex_lock (&cache->lock);
+	if (cache->entries && memcmp (stamp, &cache->stamp, sizeof (*stamp)) != 0)
+		{
+			enchant_word_cache_trim (cache, 0);
+			cache->stamp = *stamp;
+		}
+	if (cache->entries)
+		entry = g_hash_table_lookup (cache->entries, &key);
+	if (entry)
+		{
+			g_queue_unlink (&cache->lru, &entry->link);
+			g_queue_push_head_link (&cache->lru, &entry->link);
+			*value = copy ? (*copy) (entry->value, NULL) : entry->value;
+			cache->n_hits++;
+		}
+	else if (cache->entries)
+		cache->n_misses++;
+	g_mutex_unlock (&cache->lock);
+
+	return entry != NULL;
+}
+
+/* takes over value */
+static void
+enchant_word_cache_store (EnchantWordCache * cache, const char * const word, size_t len,
+			  const EnchantWordCacheStamp * stamp, gpointer value)
+{
+	g_mutex_lock (&cache->lock);
+	if (cache->entries == NULL || memcmp (stamp, &cache->stamp, sizeof (*stamp)) != 0)
+		{
+			g_mutex_unlock (&cache->lock);
+			if (cache->value_free)
+				(*cache->value_free) (value);
+			return;
+		}
+
+	EnchantWordCacheEntry *entry = g_malloc (sizeof (EnchantWordCacheEntry) + len + 1);
+	memcpy (entry->word, word, len);
+	entry->word[len] = '\0';
+	entry->key.word = entry->word;
+	entry->key.len = len;
+	entry->link.data = entry;
+	entry->link.prev = entry->link.next = NULL;
+	entry->value = value;
+
+	/* another thread may have just stored it */
+	EnchantWordCacheEntry *old = g_hash_table_lookup (cache->entries, &entry->key);
+	if (old)
+		enchant_word_cache_drop (cache, old);
+	g_hash_table_insert (cache->entries, &entry->key, entry);
+	g_queue_push_head_link (&cache->lru, &entry->link);
+	enchant_word_cache_trim (cache, cache->size);
+	g_mutex_unlock (&cache->lock);
 }
 
+/* whether there is a result for word that is good for stamp, without
+ * counting it as a hit */
 static gboolean
-enchant_session_contains (EnchantSession * session, const char * const word, size_t len)
+enchant_word_cache_contains (EnchantWordCache * cache, const char * const word, size_t len,
+			     const EnchantWordCacheStamp * stamp)
 {
-	char * utf = g_strndup (word, len);
-	gboolean result = g_hash_table_lookup (session->session_include, utf) ||
-		(enchant_pwl_check (session->personal, word, len) == 0 &&
-		 (!enchant_pwl_check (session->exclude, word, len)) == 0);
-	g_free (utf);
+	EnchantSessionWord key = { word, len };
 
-	return result;
+	g_mutex_lock (&cache->lock);
+	gboolean found = cache->entries && memcmp (stamp, &cache->stamp, sizeof (*stamp)) == 0 &&
+		g_hash_table_contains (cache->entries, &key);
+	g_mutex_unlock (&cache->lock);
+	return found;
 }
 
-static void
-enchant_session_clear_error (EnchantSession * session)
+/* the words cached, least recently used first */
+static GPtrArray *
+enchant_word_cache_list (EnchantWordCache * cache)
 {
-	if (session->error)
+	GPtrArray *words = g_ptr_array_new_with_free_func (g_free);
+	g_mutex_lock (&cache->lock);
+	for (GList *l = cache->lru.tail; l; l = l->prev)
 		{
-			g_free (session->error);
-			session->error = NULL;
+			EnchantWordCacheEntry *entry = l->data;
+			g_ptr_array_add (words, g_strndup (entry->key.word, entry->key.len));
 		}
+	g_mutex_unlock (&cache->lock);
+	return words;
 }
 
-/********************************************************************************/
-/********************************************************************************/
+/* empties the cache for results good for stamp to be stored */
+static void
+enchant_word_cache_restamp (EnchantWordCache * cache, const EnchantWordCacheStamp * stamp)
+{
+	g_mutex_lock (&cache->lock);
+	enchant_word_cache_trim (cache, 0);
+	cache->stamp = *stamp;
+	g_mutex_unlock (&cache->lock);
+}
 
 static void
-enchant_free_string_list (char ** string_list)
+enchant_word_cache_empty (EnchantWordCache * cache)
 {
-	g_strfreev (string_list);
+	g_mutex_lock (&cache->lock);
+	enchant_word_cache_trim (cache, 0);
+	g_mutex_unlock (&cache->lock);
 }
 
-void
-enchant_dict_set_error (EnchantDict * dict, const char * const err)
+static void
+enchant_word_cache_resize (EnchantWordCache * cache, size_t size)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (err);
-	g_return_if_fail (g_utf8_validate(err, -1, NULL));
+	g_mutex_lock (&cache->lock);
+	if (size == 0 && cache->entries)
+		{
+			enchant_word_cache_trim (cache, 0);
+			g_hash_table_destroy (cache->entries);
+			cache->entries = NULL;
+		}
+	else if (size != 0)
+		{
+			if (cache->entries == NULL)
+				cache->entries = g_hash_table_new (enchant_session_word_hash,
+								   enchant_session_word_equal);
+			enchant_word_cache_trim (cache, size);
+		}
+	cache->size = size;
+	g_mutex_unlock (&cache->lock);
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-	session->error = strdup (err);
+static void
+enchant_word_cache_clear (EnchantWordCache * cache)
+{
+	enchant_word_cache_resize (cache, 0);
+	g_mutex_clear (&cache->lock);
 }
 
-const char *
-enchant_dict_get_error (EnchantDict * dict)
+static const char *const enchant_stat_names[ENCHANT_N_STATS] = {
+	"checks",
+	"checks_session",
+	"checks_exclude",
+	"checks_personal",
+	"checks_provider",
+	"check_cache_hits",
+	"check_cache_misses",
+	"suggests",
+	"suggest_cache_hits",
+	"suggest_cache_misses",
+	"suggests_learned",
+	"suggests_stored",
+	"pwl_reloads",
+	"pwl_reload_us",
+	"provider_checks",
+	"provider_check_us",
+	"provider_checks_within_10us",
+	"provider_checks_within_100us",
+	"provider_checks_within_1ms",
+	"provider_checks_within_10ms",
+	"provider_checks_within_100ms",
+	"provider_checks_within_1s",
+	"provider_suggests",
+	"provider_suggest_us",
+	"provider_suggests_within_10us",
+	"provider_suggests_within_100us",
+	"provider_suggests_within_1ms",
+	"provider_suggests_within_10ms",
+	"provider_suggests_within_100ms",
+	"provider_suggests_within_1s"
+};
+
+/* glib adds atomically only up to the width of a pointer, so where
+ * that is narrower than a counter the counters take a lock instead */
+#if GLIB_SIZEOF_VOID_P >= 8
+static inline void
+enchant_stats_counter_add (guint64 * counter, guint64 n)
 {
-	g_return_val_if_fail (dict, NULL);
+	g_atomic_pointer_add ((gsize *) counter, (gssize) n);
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	return session->error;
+static inline guint64
+enchant_stats_counter_get (guint64 * counter)
+{
+	return (gsize) g_atomic_pointer_get ((gsize *) counter);
 }
+#else
+G_LOCK_DEFINE_STATIC (enchant_stats_counters);
 
-int
-enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len)
+static void
+enchant_stats_counter_add (guint64 * counter, guint64 n)
 {
-	g_return_val_if_fail (dict, -1);
-	g_return_val_if_fail (word, -1);
+	G_LOCK (enchant_stats_counters);
+	*counter += n;
+	G_UNLOCK (enchant_stats_counters);
+}
 
-	if (len < 0)
-		len = strlen (word);
+static guint64
+enchant_stats_counter_get (guint64 * counter)
+{
+	G_LOCK (enchant_stats_counters);
+	guint64 n = *counter;
+	G_UNLOCK (enchant_stats_counters);
+	return n;
+}
+#endif
 
-	g_return_val_if_fail (len, -1);
-	g_return_val_if_fail (g_utf8_validate(word, len, NULL),-1);
+/* the calling thread's counters in stats */
+static guint64 *
+enchant_stats_stripe (EnchantStats * stats)
+{
+	static GPrivate stripe_key;
+	static gint n_threads;
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+	/* one more than the stripe, so that 0 stands for none yet */
+	guint stripe = GPOINTER_TO_UINT (g_private_get (&stripe_key));
+	if (stripe == 0)
+		{
+			stripe = (guint) g_atomic_int_add (&n_threads, 1) % ENCHANT_STATS_STRIPES + 1;
+			g_private_set (&stripe_key, GUINT_TO_POINTER (stripe));
+		}
+	return &stats->counts[(stripe - 1) * ENCHANT_STATS_STRIDE];
+}
 
-	/* first, see if it's to be excluded*/
-	if (enchant_session_exclude (session, word, len))
-		return 1;
+static void
+enchant_stats_add (EnchantStats * stats, EnchantStat stat, gsize n)
+{
+	if (n != 0)
+		enchant_stats_counter_add (&enchant_stats_stripe (stats)[stat], n);
+}
 
-	/* then, see if it's in our pwl or session*/
-	if (enchant_session_contains(session, word, len))
-		return 0;
+/* counts a call into the provider made at start, under calls and the
+ * counters that follow it */
+static void
+enchant_stats_add_latency (EnchantStats * stats, EnchantStat calls, gint64 start)
+{
+	gint64 us = g_get_monotonic_time () - start;
+	guint64 *counts = enchant_stats_stripe (stats);
 
-	if (dict->check)
-		return (*dict->check) (dict, word, len);
-	else if (session->is_pwl)
-		return 1;
+	enchant_stats_counter_add (&counts[calls], 1);
+	enchant_stats_counter_add (&counts[calls + 1], (guint64) us);
+	for (guint i = 0; i < ENCHANT_N_LATENCY_BUCKETS; i++)
+		if (us <= enchant_latency_bounds[i])
+			{
+				enchant_stats_counter_add (&counts[calls + 2 + i], 1);
+				break;
+			}
+}
 
-	return -1;
+/* adds the stripes up into totals */
+static void
+enchant_stats_sum (EnchantStats * stats, guint64 * totals)
+{
+	for (guint i = 0; i < ENCHANT_STATS_STRIPES; i++)
+		for (guint j = 0; j < ENCHANT_N_STATS; j++)
+			totals[j] += enchant_stats_counter_get (&stats->counts[i * ENCHANT_STATS_STRIDE + j]);
 }
 
-/* @suggs must have at least n_suggs + n_new_suggs space allocated
- * @n_suggs is the number if items currently appearing in @suggs
- *
- * returns the number of items in @suggs after merge is complete
- */
-static int
-enchant_dict_merge_suggestions(char ** suggs, size_t n_suggs, char ** new_suggs, size_t n_new_suggs)
+/* the buckets count the calls that took at most their bound, each
+ * call counting in the first of them only until now */
+static void
+enchant_stats_report (guint64 * totals, EnchantStatsFn fn, void * user_data)
 {
-	for (size_t i = 0; i < n_new_suggs; i++)
+	for (guint i = 1; i < ENCHANT_N_LATENCY_BUCKETS; i++)
 		{
-			char * normalized_new_sugg = g_utf8_normalize (new_suggs[i], -1, G_NORMALIZE_NFD);
+			totals[ENCHANT_STAT_PROVIDER_CHECKS_WITHIN + i] += totals[ENCHANT_STAT_PROVIDER_CHECKS_WITHIN + i - 1];
+			totals[ENCHANT_STAT_PROVIDER_SUGGESTS_WITHIN + i] += totals[ENCHANT_STAT_PROVIDER_SUGGESTS_WITHIN + i - 1];
+		}
 
-			int is_duplicate = 0;
-			for (size_t j = 0; !is_duplicate && j < n_suggs; j++)
-				{
-					char* normalized_sugg = g_utf8_normalize (suggs[j], -1, G_NORMALIZE_NFD);
-					is_duplicate = strcmp (normalized_sugg, normalized_new_sugg) == 0;
-					g_free (normalized_sugg);
-				}
-			g_free (normalized_new_sugg);
+	for (guint i = 0; i < ENCHANT_N_STATS; i++)
+		(*fn) (enchant_stat_names[i], totals[i], user_data);
+}
 
-			if (!is_duplicate)
-				suggs[n_suggs++] = strdup (new_suggs[i]);
-		}
+static const char *const enchant_memory_names[ENCHANT_N_MEMORY] = {
+	"personal",
+	"exclude",
+	"mapped",
+	"session_words",
+	"check_cache",
+	"suggest_cache",
+	"provider",
+	"other"
+};
 
-	return n_suggs;
+/* adds what the session counted, its caches and its word lists included,
+ * into totals */
+static void
+enchant_session_sum_stats (EnchantSession * session, guint64 * totals)
+{
+	enchant_stats_sum (&session->stats, totals);
+
+	g_mutex_lock (&session->check_cache.lock);
+	totals[ENCHANT_STAT_CHECK_CACHE_HITS] += session->check_cache.n_hits;
+	totals[ENCHANT_STAT_CHECK_CACHE_MISSES] += session->check_cache.n_misses;
+	g_mutex_unlock (&session->check_cache.lock);
+
+	g_mutex_lock (&session->suggest_cache.lock);
+	totals[ENCHANT_STAT_SUGGEST_CACHE_HITS] += session->suggest_cache.n_hits;
+	totals[ENCHANT_STAT_SUGGEST_CACHE_MISSES] += session->suggest_cache.n_misses;
+	g_mutex_unlock (&session->suggest_cache.lock);
+
+	/* word lists not opened yet have not been read */
+	EnchantPWL *lists[] = { g_atomic_pointer_get (&session->personal),
+				g_atomic_pointer_get (&session->exclude) };
+	for (guint i = 0; i < G_N_ELEMENTS (lists); i++)
+		if (lists[i])
+			{
+				size_t n_reloads;
+				uint64_t reload_us;
+				enchant_pwl_get_reload_stats (lists[i], &n_reloads, &reload_us);
+				totals[ENCHANT_STAT_PWL_RELOADS] += n_reloads;
+				totals[ENCHANT_STAT_PWL_RELOAD_US] += reload_us;
+			}
 }
 
-static char **
-enchant_dict_get_good_suggestions(EnchantDict * dict, char ** suggs, size_t n_suggs, size_t* out_n_filtered_suggs)
+/* The costs are kept between runs in a key file in the user's config
+ * dir, with a group for each language tag listing the totals of each
+ * provider that had a dictionary for it */
+static char *
+enchant_get_costs_file (void)
 {
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	char *user_config_dir = enchant_get_user_config_dir ();
+	if (user_config_dir == NULL)
+		return NULL;
 
-	char ** filtered_suggs = g_new0 (char *, n_suggs + 1);
-	size_t n_filtered_suggs = 0;
-	for (size_t i = 0; i < n_suggs; i++)
-		{
-			size_t sugg_len = strlen(suggs[i]);
+	char *file = g_build_filename (user_config_dir, "provider-costs", NULL);
+	g_free (user_config_dir);
 
-			if (sugg_len == 0)
-				continue;
+	return file;
+}
 
-			if (g_utf8_validate(suggs[i], sugg_len, NULL) &&
-			    !enchant_session_exclude(session, suggs[i], sugg_len))
-				filtered_suggs[n_filtered_suggs++] = strdup (suggs[i]);
+/* the totals of the provider called name for tag, made up if create */
+static guint64 *
+enchant_costs_lookup (GHashTable * costs, const char * const tag, const char * const name,
+		      gboolean create)
+{
+	GHashTable *tag_costs = g_hash_table_lookup (costs, tag);
+	if (tag_costs == NULL && create)
+		{
+			tag_costs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+			g_hash_table_insert (costs, g_strdup (tag), tag_costs);
 		}
+	if (tag_costs == NULL)
+		return NULL;
 
-	if (out_n_filtered_suggs)
-		*out_n_filtered_suggs = n_filtered_suggs;
+	guint64 *totals = g_hash_table_lookup (tag_costs, name);
+	if (totals == NULL && create)
+		{
+			totals = g_new0 (guint64, ENCHANT_N_COSTS);
+			g_hash_table_insert (tag_costs, g_strdup (name), totals);
+		}
 
-	return filtered_suggs;
+	return totals;
 }
 
-char **
-enchant_dict_suggest (EnchantDict * dict, const char *const word, ssize_t len, size_t * out_n_suggs)
+/* the costs of the providers, read first if need be, with stats_lock held */
+static GHashTable *
+enchant_broker_get_costs (EnchantBroker * broker)
 {
-	g_return_val_if_fail (dict, NULL);
-	g_return_val_if_fail (word, NULL);
-
-	if (len < 0)
-		len = strlen (word);
-
-	g_return_val_if_fail (len, NULL);
-	g_return_val_if_fail (g_utf8_validate(word, len, NULL), NULL);
+	if (broker->provider_costs)
+		return broker->provider_costs;
 
-	size_t n_dict_suggs = 0, n_pwl_suggs = 0, n_suggsT = 0;
-	char **dict_suggs = NULL, **pwl_suggs = NULL, **suggsT;
+	broker->provider_costs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							(GDestroyNotify) g_hash_table_unref);
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-
-	/* Check for suggestions from provider dictionary */
-	if (dict->suggest)
+	char *file = enchant_get_costs_file ();
+	GKeyFile *saved = g_key_file_new ();
+	if (file && g_key_file_load_from_file (saved, file, G_KEY_FILE_NONE, NULL))
 		{
-			dict_suggs = (*dict->suggest) (dict, word, len, &n_dict_suggs);
-			if (dict_suggs)
+			char **tags = g_key_file_get_groups (saved, NULL);
+			for (size_t i = 0; tags[i]; i++)
 				{
-					suggsT = enchant_dict_get_good_suggestions(dict, dict_suggs, n_dict_suggs, &n_suggsT);
-					enchant_free_string_list (dict_suggs);
-					dict_suggs = suggsT;
-					n_dict_suggs = n_suggsT;
-				}
+					char **names = g_key_file_get_keys (saved, tags[i], NULL, NULL);
+					for (size_t j = 0; names && names[j]; j++)
+						{
+							gsize n_values = 0;
+							char **values = g_key_file_get_string_list (saved, tags[i], names[j], &n_values, NULL);
+							if (values && n_values == ENCHANT_N_COSTS)
+								{
+									guint64 *totals = enchant_costs_lookup (broker->provider_costs, tags[i], names[j], TRUE);
+									for (gsize k = 0; k < n_values; k++)
+										totals[k] = g_ascii_strtoull (values[k], NULL, 10);
+								}
+							g_strfreev (values);
+						}
+					g_strfreev (names);
+				}
+			g_strfreev (tags);
 		}
+	g_key_file_free (saved);
+	g_free (file);
 
-	/* Check for suggestions from personal dictionary */
-	if (session->personal)
+	return broker->provider_costs;
+}
+
+/* Saves the costs, if they changed since they were read; what other
+ * processes saved meanwhile is overwritten */
+static void
+enchant_broker_save_costs (EnchantBroker * broker)
+{
+	if (!broker->costs_changed)
+		return;
+
+	char *file = enchant_get_costs_file ();
+	if (file == NULL)
+		return;
+
+	GKeyFile *saved = g_key_file_new ();
+	GHashTableIter tags;
+	gpointer tag, tag_costs;
+	g_hash_table_iter_init (&tags, broker->provider_costs);
+	while (g_hash_table_iter_next (&tags, &tag, &tag_costs))
 		{
-			pwl_suggs = enchant_pwl_suggest(session->personal, word, len, dict_suggs, &n_pwl_suggs);
-			if (pwl_suggs)
+			GHashTableIter providers;
+			gpointer name, totals;
+			g_hash_table_iter_init (&providers, tag_costs);
+			while (g_hash_table_iter_next (&providers, &name, &totals))
 				{
-					suggsT = enchant_dict_get_good_suggestions(dict, pwl_suggs, n_pwl_suggs, &n_suggsT);
-					enchant_free_string_list (pwl_suggs);
-					pwl_suggs = suggsT;
-					n_pwl_suggs = n_suggsT;
+					/* that a provider had no dictionary is not kept, in
+					 * case one is installed later */
+					if (((guint64 *) totals)[ENCHANT_COST_SESSIONS] == 0)
+						continue;
+
+					char *values[ENCHANT_N_COSTS + 1] = { NULL };
+					for (guint k = 0; k < ENCHANT_N_COSTS; k++)
+						values[k] = g_strdup_printf ("%" G_GUINT64_FORMAT, ((guint64 *) totals)[k]);
+					g_key_file_set_string_list (saved, tag, name, (const gchar * const *) values, ENCHANT_N_COSTS);
+					for (guint k = 0; k < ENCHANT_N_COSTS; k++)
+						g_free (values[k]);
 				}
 		}
 
-	/* Clone suggestions, if any */
-	char **suggs = NULL;
-	size_t n_suggs = n_pwl_suggs + n_dict_suggs;
-	if (n_suggs > 0)
+	gsize length;
+	char *contents = g_key_file_to_data (saved, &length, NULL);
+	char *dir = g_path_get_dirname (file);
+	enchant_ensure_dir_exists (dir);
+	(void) g_file_set_contents (file, contents, length, NULL);
+	g_free (dir);
+	g_free (contents);
+	g_key_file_free (saved);
+	g_free (file);
+}
+
+/* adds what the provider's dictionary took in session to its costs,
+ * with stats_lock held */
+static void
+enchant_broker_count_session_cost (EnchantBroker * broker, EnchantSession * session)
+{
+	if (!broker->adaptive || session->request_us == 0)
+		return;
+
+	guint64 stats[ENCHANT_N_STATS] = { 0 };
+	enchant_stats_sum (&session->stats, stats);
+
+	const char *name = (*session->provider->identify) (session->provider);
+	guint64 *totals = enchant_costs_lookup (enchant_broker_get_costs (broker), session->language_tag, name, TRUE);
+	if (totals[ENCHANT_COST_SESSIONS] >= ENCHANT_COST_MAX_SESSIONS)
+		for (guint k = 0; k < ENCHANT_N_COSTS; k++)
+			totals[k] /= 2;
+
+	totals[ENCHANT_COST_SESSIONS]++;
+	totals[ENCHANT_COST_REQUEST_US] += session->request_us;
+	totals[ENCHANT_COST_CHECKS] += stats[ENCHANT_STAT_PROVIDER_CHECKS];
+	totals[ENCHANT_COST_CHECK_US] += stats[ENCHANT_STAT_PROVIDER_CHECK_US];
+	totals[ENCHANT_COST_SUGGESTS] += stats[ENCHANT_STAT_PROVIDER_SUGGESTS];
+	totals[ENCHANT_COST_SUGGEST_US] += stats[ENCHANT_STAT_PROVIDER_SUGGEST_US];
+	broker->costs_changed = TRUE;
+}
+
+/* notes that the provider had no dictionary for tag, so that it is
+ * ranked last, see enchant_broker_rank_providers */
+static void
+enchant_broker_count_missing_dict (EnchantBroker * broker, EnchantProvider * provider,
+				   const char * const tag)
+{
+	g_mutex_lock (&broker->stats_lock);
+	if (broker->adaptive)
 		{
-			suggs = g_new0 (char *, n_suggs + 1);
-			n_suggs = enchant_dict_merge_suggestions(suggs, 0, dict_suggs, n_dict_suggs);
-			n_suggs = enchant_dict_merge_suggestions(suggs, n_suggs, pwl_suggs, n_pwl_suggs);
+			const char *name = (*provider->identify) (provider);
+			guint64 *totals = enchant_costs_lookup (enchant_broker_get_costs (broker), tag, name, TRUE);
+			if (totals[ENCHANT_COST_SESSIONS] != 0)
+				broker->costs_changed = TRUE;
+			memset (totals, 0, ENCHANT_N_COSTS * sizeof (guint64));
 		}
+	g_mutex_unlock (&broker->stats_lock);
+}
 
-	g_strfreev(dict_suggs);
-	g_strfreev(pwl_suggs);
-
-	if (out_n_suggs)
-		*out_n_suggs = n_suggs;
+/* how long a session making as many calls as the language's sessions
+ * usually do, checks and suggests, would take with the provider, in
+ * microseconds */
+static gdouble
+enchant_costs_per_session (const guint64 * totals, gdouble checks, gdouble suggests)
+{
+	gdouble n_sessions = (gdouble) totals[ENCHANT_COST_SESSIONS];
+	gdouble cost = totals[ENCHANT_COST_REQUEST_US] / n_sessions;
+	if (totals[ENCHANT_COST_CHECKS])
+		cost += checks * totals[ENCHANT_COST_CHECK_US] / totals[ENCHANT_COST_CHECKS];
+	if (totals[ENCHANT_COST_SUGGESTS])
+		cost += suggests * totals[ENCHANT_COST_SUGGEST_US] / totals[ENCHANT_COST_SUGGESTS];
+
+	return cost;
+}
 
-	return suggs;
+/* counts what session does towards the totals of broker, see
+ * enchant_broker_get_stats */
+static void
+enchant_broker_add_session (EnchantBroker * broker, EnchantSession * session)
+{
+	session->broker = broker;
+	g_mutex_lock (&broker->stats_lock);
+	g_ptr_array_add (broker->sessions, session);
+	g_mutex_unlock (&broker->stats_lock);
 }
 
-void
-enchant_dict_add (EnchantDict * dict, const char *const word, ssize_t len)
+/* keeps what session counted once it is gone */
+static void
+enchant_broker_remove_session (EnchantBroker * broker, EnchantSession * session)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (word);
+	g_mutex_lock (&broker->stats_lock);
+	enchant_session_sum_stats (session, broker->retired_stats);
+	enchant_broker_count_session_cost (broker, session);
+	g_ptr_array_remove_fast (broker->sessions, session);
+	g_mutex_unlock (&broker->stats_lock);
+}
 
-	if (len < 0)
-		len = strlen (word);
+/* The work a broker does in the background is queued as tasks, each
+ * handed to the executor as a runner that starts the oldest task not
+ * started yet.  A thread waiting for tasks starts those it waits for
+ * itself instead, see enchant_broker_wait_tasks, so that the pool need
+ * not have a thread to spare for them. */
+typedef struct str_enchant_task_group
+{
+	guint n_unfinished;	/* guarded by the broker's tasks_lock */
+} EnchantTaskGroup;
 
-	g_return_if_fail (len);
-	g_return_if_fail (g_utf8_validate(word, len, NULL));
+typedef struct str_enchant_task
+{
+	GFunc fn;
+	gpointer data;
+	GDestroyNotify destroy;	/* or NULL, called with data once the group no longer counts it */
+	EnchantTaskGroup *group;	/* or NULL */
+} EnchantTask;
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-	enchant_session_add_personal (session, word, len);
-	enchant_session_remove_exclude (session, word, len);
+static void
+enchant_broker_run_task (EnchantBroker * broker, EnchantTask * task)
+{
+	(*task->fn) (task->data, NULL);
+
+	g_mutex_lock (&broker->tasks_lock);
+	if (task->group)
+		task->group->n_unfinished--;
+	broker->n_unfinished--;
+	g_cond_broadcast (&broker->task_done);
+	g_mutex_unlock (&broker->tasks_lock);
+	if (task->destroy)
+		(*task->destroy) (task->data);
+	g_free (task);
+}
 
-	if (dict->add_to_personal)
-		(*dict->add_to_personal) (dict, word, len);
+/* a runner, as the executor calls it */
+static void
+enchant_broker_run_next (void * data)
+{
+	EnchantBroker *broker = (EnchantBroker *) data;
+
+	g_mutex_lock (&broker->tasks_lock);
+	EnchantTask *task = g_queue_pop_head (&broker->tasks);
+	if (task == NULL)
+		task = g_queue_pop_head (&broker->background_tasks);
+	g_mutex_unlock (&broker->tasks_lock);
+	if (task)
+		enchant_broker_run_task (broker, task);
+
+	g_mutex_lock (&broker->tasks_lock);
+	broker->n_runners--;
+	g_cond_broadcast (&broker->task_done);
+	g_mutex_unlock (&broker->tasks_lock);
 }
 
-void
-enchant_dict_add_to_session (EnchantDict * dict, const char *const word, ssize_t len)
+static void
+enchant_broker_worker_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (word);
+	enchant_broker_run_next (data);
+}
 
-	if (len < 0)
-		len = strlen (word);
+static void
+enchant_broker_queue_task (EnchantBroker * broker, GQueue * queue, GFunc fn, gpointer data,
+			   GDestroyNotify destroy, EnchantTaskGroup * group)
+{
+	EnchantTask *task = g_new (EnchantTask, 1);
+	task->fn = fn;
+	task->data = data;
+	task->destroy = destroy;
+	task->group = group;
+
+	g_mutex_lock (&broker->tasks_lock);
+	g_queue_push_tail (queue, task);
+	if (group)
+		group->n_unfinished++;
+	broker->n_unfinished++;
+	broker->n_runners++;
+	EnchantExecutorFn executor = broker->executor;
+	void *executor_data = broker->executor_data;
+	if (executor == NULL && broker->workers == NULL)
+		broker->workers = g_thread_pool_new (enchant_broker_worker_run, NULL,
+						     (gint) broker->n_workers, FALSE, NULL);
+	GThreadPool *workers = broker->workers;
+	g_mutex_unlock (&broker->tasks_lock);
+
+	if (executor)
+		(*executor) (enchant_broker_run_next, broker, executor_data);
+	else
+		g_thread_pool_push (workers, broker, NULL);
+}
 
-	g_return_if_fail (len);
-	g_return_if_fail (g_utf8_validate(word, len, NULL));
+/* queues fn to be called with data, counting it in group if not NULL */
+static void
+enchant_broker_submit (EnchantBroker * broker, GFunc fn, gpointer data, EnchantTaskGroup * group)
+{
+	enchant_broker_queue_task (broker, &broker->tasks, fn, data, NULL, group);
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+/* as enchant_broker_submit, calling destroy with data once the task is
+ * done and group no longer counts it, for a group that goes with data */
+static void
+enchant_broker_submit_full (EnchantBroker * broker, GFunc fn, gpointer data, GDestroyNotify destroy,
+			    EnchantTaskGroup * group)
+{
+	enchant_broker_queue_task (broker, &broker->tasks, fn, data, destroy, group);
+}
 
-	enchant_session_add (session, word, len);
-	if (dict->add_to_session)
-		(*dict->add_to_session) (dict, word, len);
+/* as enchant_broker_submit, for work nobody waits for: it is only
+ * started once no other task is waiting to be */
+static void
+enchant_broker_submit_background (EnchantBroker * broker, GFunc fn, gpointer data, EnchantTaskGroup * group)
+{
+	enchant_broker_queue_task (broker, &broker->background_tasks, fn, data, NULL, group);
 }
 
-int
-enchant_dict_is_added (EnchantDict * dict, const char *const word, ssize_t len)
+/* takes the oldest task of group not started yet, of any if group is
+ * NULL, off the queues, or returns NULL if there is none; called with
+ * the tasks_lock held */
+static EnchantTask *
+enchant_broker_take_task (EnchantBroker * broker, EnchantTaskGroup * group)
 {
-	g_return_val_if_fail (dict, 0);
-	g_return_val_if_fail (word, 0);
+	GQueue *queue = &broker->tasks;
+	GList *link = queue->head;
+	while (link && group && ((EnchantTask *) link->data)->group != group)
+		link = link->next;
+	if (link == NULL)
+		{
+			queue = &broker->background_tasks;
+			link = queue->head;
+			while (link && group && ((EnchantTask *) link->data)->group != group)
+				link = link->next;
+		}
+	if (link == NULL)
+		return NULL;
 
-	if (len < 0)
-		len = strlen (word);
+	EnchantTask *task = link->data;
+	g_queue_delete_link (queue, link);
+	return task;
+}
 
-	g_return_val_if_fail (len, 0);
-	g_return_val_if_fail (g_utf8_validate(word, len, NULL), 0);
+/* runs the oldest task of group not started yet on the calling thread;
+ * returns FALSE if there was none */
+static gboolean
+enchant_broker_run_group_task (EnchantBroker * broker, EnchantTaskGroup * group)
+{
+	g_mutex_lock (&broker->tasks_lock);
+	EnchantTask *task = enchant_broker_take_task (broker, group);
+	g_mutex_unlock (&broker->tasks_lock);
+	if (task == NULL)
+		return FALSE;
+
+	enchant_broker_run_task (broker, task);
+	return TRUE;
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+/* Waits for the tasks of group to finish, or for all of them if group
+ * is NULL, starting those not started yet on the calling thread; a
+ * worker waiting for tasks that no other worker is free to start would
+ * otherwise wait for ever. */
+static void
+enchant_broker_wait_tasks (EnchantBroker * broker, EnchantTaskGroup * group)
+{
+	g_mutex_lock (&broker->tasks_lock);
+	while (group ? group->n_unfinished : broker->n_unfinished)
+		{
+			EnchantTask *task = enchant_broker_take_task (broker, group);
+			if (task == NULL)
+				{
+					g_cond_wait (&broker->task_done, &broker->tasks_lock);
+					continue;
+				}
 
-	return enchant_session_contains (session, word, len);
+			g_mutex_unlock (&broker->tasks_lock);
+			enchant_broker_run_task (broker, task);
+			g_mutex_lock (&broker->tasks_lock);
+		}
+	g_mutex_unlock (&broker->tasks_lock);
 }
 
-void
-enchant_dict_remove (EnchantDict * dict, const char *const word, ssize_t len)
+static size_t
+enchant_word_cache_memory_usage (EnchantWordCache * cache)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (word);
-
-	if (len < 0)
-		len = strlen (word);
+	size_t size = 0;
+	g_mutex_lock (&cache->lock);
+	if (cache->entries)
+		size += enchant_hash_table_memory_usage (g_hash_table_size (cache->entries));
+	for (GList *link = cache->lru.head; link; link = link->next)
+		{
+			EnchantWordCacheEntry *entry = link->data;
+			size += sizeof (EnchantWordCacheEntry) + entry->key.len + 1;
 
-	g_return_if_fail (len);
-	g_return_if_fail (g_utf8_validate(word, len, NULL));
+			/* suggestions are kept packed, see enchant_strv_pack */
+			char **suggs = cache->value_free ? entry->value : NULL;
+			if (suggs)
+				{
+					size_t n = g_strv_length (suggs);
+					size += (n + 1) * sizeof (char *);
+					for (size_t i = 0; i < n; i++)
+						size += strlen (suggs[i]) + 1;
+				}
+		}
+	g_mutex_unlock (&cache->lock);
+	return size;
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+/* The suggestions a provider made, kept on disk between runs, see
+ * enchant_dict_set_suggest_store.  The file starts with a line telling
+ * what they were made with; each line after holds a word followed by
+ * its suggestions, each after a tab.  Lines are only ever appended,
+ * the last one for a word counting, until the file is compacted. */
+typedef struct str_enchant_suggest_store
+{
+	GMutex lock;		/* guards the fields below */
+	char *filename;
+	size_t max_words;	/* 0 while not in use */
+	GMappedFile *mapped;	/* what the file held when it was opened, or NULL */
+	GHashTable *entries;	/* words -> their suggestions, up to a line break, in mapped or appended */
+	GPtrArray *appended;	/* the lines added since it was opened */
+} EnchantSuggestStore;
+
+#define ENCHANT_SUGGEST_STORE_VERSION "enchant-suggestions 1"
+
+/* A file with more than this many times as many lines as words is
+ * compacted when opened, unless it is shorter than the minimum */
+#define ENCHANT_SUGGEST_STORE_SLACK 2
+#define ENCHANT_SUGGEST_STORE_MIN_COMPACT 64
+
+/* The first line of the session's store: what the suggestions depend
+ * on, the provider module and the directories its dictionaries are in
+ * as they are now, boiled down; NULL if the provider does not tell
+ * where its dictionaries are */
+static char *
+enchant_session_suggest_store_header (EnchantSession * session)
+{
+	EnchantProvider *provider = session->provider;
+	char **dirs;
+	gint64 *stamps;
+	size_t n_dirs;
 
-	enchant_session_remove_personal (session, word, len);
-	enchant_session_add_exclude(session, word, len);
+	if (!enchant_provider_stamp_dict_dirs (provider, &dirs, &stamps, &n_dirs))
+		return NULL;
 
-	if (dict->add_to_exclude)
-		(*dict->add_to_exclude) (dict, word, len);
+	GString *made_with = g_string_new (session->language_tag);
+	g_string_append_c (made_with, '\n');
+	EnchantBroker *broker = provider->owner;
+	g_mutex_lock (&broker->modules_lock);
+	for (guint i = 0; i < broker->provider_modules->len; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+			if (pm->provider == provider)
+				g_string_append_printf (made_with, "%s\n%" G_GINT64_FORMAT "\n",
+							pm->filename, enchant_dir_stamp (pm->filename));
+		}
+	g_mutex_unlock (&broker->modules_lock);
+	for (size_t i = 0; i < n_dirs; i++)
+		g_string_append_printf (made_with, "%s\n%" G_GINT64_FORMAT "\n", dirs[i], stamps[i]);
+	g_strfreev (dirs);
+	g_free (stamps);
+
+	char *checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, made_with->str, made_with->len);
+	char *header = g_strdup_printf ("%s %s\n", ENCHANT_SUGGEST_STORE_VERSION, checksum);
+	g_free (checksum);
+	g_string_free (made_with, TRUE);
+
+	return header;
 }
 
-void
-enchant_dict_remove_from_session (EnchantDict * dict, const char *const word, ssize_t len)
+static void
+enchant_suggest_store_clear (EnchantSuggestStore * store)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (word);
+	if (store->entries)
+		g_hash_table_destroy (store->entries);
+	if (store->appended)
+		g_ptr_array_free (store->appended, TRUE);
+	if (store->mapped)
+		g_mapped_file_unref (store->mapped);
+	store->entries = NULL;
+	store->appended = NULL;
+	store->mapped = NULL;
+}
 
-	if (len < 0)
-		len = strlen (word);
+static void
+enchant_suggest_store_free (EnchantSuggestStore * store)
+{
+	enchant_suggest_store_clear (store);
+	g_mutex_clear (&store->lock);
+	g_free (store->filename);
+	g_free (store);
+}
 
-	g_return_if_fail (len);
-	g_return_if_fail (g_utf8_validate(word, len, NULL));
+/* writes out the last line for each word, with the lock held; returns
+ * FALSE if the file could not be written */
+static gboolean
+enchant_suggest_store_compact (EnchantSuggestStore * store, const char * const header)
+{
+	GString *contents = g_string_new (header);
+	GHashTableIter iter;
+	gpointer word, suggs;
+	g_hash_table_iter_init (&iter, store->entries);
+	while (g_hash_table_iter_next (&iter, &word, &suggs))
+		{
+			const char *eol = strchr (suggs, '\n');
+			g_string_append (contents, word);
+			g_string_append_len (contents, suggs, eol + 1 - (const char *) suggs);
+		}
+	gboolean written = g_file_set_contents (store->filename, contents->str, contents->len, NULL);
+	g_string_free (contents, TRUE);
+	return written;
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+/* (Re)reads the file, starting it afresh if it was made with something
+ * other than header says, with the lock held */
+static void
+enchant_suggest_store_load (EnchantSuggestStore * store, const char * const header)
+{
+	enchant_suggest_store_clear (store);
+	store->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	store->appended = g_ptr_array_new_with_free_func (g_free);
+
+	size_t header_len = strlen (header);
+	size_t n_lines = 0;
+	GMappedFile *mapped = g_mapped_file_new (store->filename, FALSE, NULL);
+	const char *contents = mapped ? g_mapped_file_get_contents (mapped) : NULL;
+	size_t length = mapped ? g_mapped_file_get_length (mapped) : 0;
+	if (contents && length >= header_len && !memcmp (contents, header, header_len))
+		{
+			store->mapped = mapped;
+			const char *end = contents + length;
+			for (const char *line = contents + header_len; line < end; n_lines++)
+				{
+					/* a line not finished yet is left for when it is */
+					const char *eol = memchr (line, '\n', end - line);
+					if (eol == NULL)
+						break;
+					const char *word_end = memchr (line, '\t', eol - line);
+					if (word_end == NULL)
+						word_end = eol;
+					if (word_end != line)
+						g_hash_table_insert (store->entries, g_strndup (line, word_end - line),
+								     (gpointer) word_end);
+					line = eol + 1;
+				}
+		}
+	else
+		{
+			if (mapped)
+				g_mapped_file_unref (mapped);
+			char *dir = g_path_get_dirname (store->filename);
+			enchant_ensure_dir_exists (dir);
+			g_free (dir);
+			(void) g_file_set_contents (store->filename, header, header_len, NULL);
+		}
 
-	enchant_session_remove (session, word, len);
+	/* the lines for the same words pile up over the runs, and from the
+	 * processes that share the file */
+	if (n_lines >= ENCHANT_SUGGEST_STORE_MIN_COMPACT &&
+	    n_lines > ENCHANT_SUGGEST_STORE_SLACK * g_hash_table_size (store->entries) &&
+	    enchant_suggest_store_compact (store, header))
+		enchant_suggest_store_load (store, header);
 }
 
-int
-enchant_dict_is_removed (EnchantDict * dict, const char *const word, ssize_t len)
+/* the suggestions stored for word, as a g_strfreev list; returns FALSE
+ * if there are none */
+static gboolean
+enchant_suggest_store_lookup (EnchantSuggestStore * store, const char * const word, size_t len,
+			      char *** out_suggs, size_t * out_n_suggs)
 {
-	g_return_val_if_fail (dict, 0);
-	g_return_val_if_fail (word, 0);
+	const char *suggs = NULL;
 
-	if (len < 0)
-		len = strlen (word);
+	g_mutex_lock (&store->lock);
+	if (store->max_words)
+		{
+			char *key = g_strndup (word, len);
+			suggs = g_hash_table_lookup (store->entries, key);
+			g_free (key);
+		}
+	if (suggs)
+		{
+			const char *eol = strchr (suggs, '\n');
+			*out_suggs = NULL;
+			*out_n_suggs = 0;
+			if (eol != suggs)
+				{
+					char *line = g_strndup (suggs + 1, eol - suggs - 1);
+					*out_suggs = g_strsplit (line, "\t", -1);
+					*out_n_suggs = g_strv_length (*out_suggs);
+					g_free (line);
+				}
+		}
+	g_mutex_unlock (&store->lock);
 
-	g_return_val_if_fail (len, 0);
-	g_return_val_if_fail (g_utf8_validate(word, len, NULL), 0);
+	return suggs != NULL;
+}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+/* appends what the provider suggested for word, unless the store is
+ * full or a tab or a line break is in the way */
+static void
+enchant_suggest_store_add (EnchantSuggestStore * store, const char * const word, size_t len,
+			   char ** suggs, size_t n_suggs)
+{
+	if (memchr (word, '\t', len) || memchr (word, '\n', len))
+		return;
+	GString *line = g_string_new_len (word, len);
+	for (size_t i = 0; i < n_suggs; i++)
+		{
+			if (strchr (suggs[i], '\t') || strchr (suggs[i], '\n'))
+				{
+					g_string_free (line, TRUE);
+					return;
+				}
+			g_string_append_c (line, '\t');
+			g_string_append (line, suggs[i]);
+		}
+	g_string_append_c (line, '\n');
 
-	return enchant_session_exclude (session, word, len);
+	g_mutex_lock (&store->lock);
+	if (store->max_words && g_hash_table_size (store->entries) < store->max_words)
+		{
+			FILE *f = g_fopen (store->filename, "ab");
+			if (f)
+				{
+					fwrite (line->str, 1, line->len, f);
+					fclose (f);
+				}
+			char *text = g_string_free (line, FALSE);
+			g_ptr_array_add (store->appended, text);
+			g_hash_table_insert (store->entries, g_strndup (word, len), text + len);
+			line = NULL;
+		}
+	g_mutex_unlock (&store->lock);
+
+	if (line)
+		g_string_free (line, TRUE);
 }
 
-void
-enchant_dict_store_replacement (EnchantDict * dict,
-				const char *const mis, ssize_t mis_len,
-				const char *const cor, ssize_t cor_len)
+/* adds the bytes the session takes up into totals, leaving out the word
+ * lists and the sessions in seen, which it is added to */
+static void
+enchant_session_sum_memory (EnchantSession * session, GHashTable * seen, guint64 * totals)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (mis);
-	g_return_if_fail (cor);
-
-	if (mis_len < 0)
-		mis_len = strlen (mis);
+	if (!g_hash_table_add (seen, session))
+		return;
 
-	if (cor_len < 0)
-		cor_len = strlen (cor);
+	totals[ENCHANT_MEMORY_OTHER] += sizeof (EnchantSession) + strlen (session->language_tag) + 1;
+	if (session->personal_filename)
+		totals[ENCHANT_MEMORY_OTHER] += strlen (session->personal_filename) + 1;
+	if (session->exclude_filename)
+		totals[ENCHANT_MEMORY_OTHER] += strlen (session->exclude_filename) + 1;
+	if (session->replacements_filename)
+		totals[ENCHANT_MEMORY_OTHER] += strlen (session->replacements_filename) + 1;
 
-	g_return_if_fail (mis_len);
-	g_return_if_fail (cor_len);
+	g_mutex_lock (&session->replacements_lock);
+	if (session->replacements)
+		{
+			totals[ENCHANT_MEMORY_OTHER] += enchant_hash_table_memory_usage (g_hash_table_size (session->replacements));
+			GHashTableIter iter;
+			gpointer key, value;
+			g_hash_table_iter_init (&iter, session->replacements);
+			while (g_hash_table_iter_next (&iter, &key, &value))
+				{
+					GPtrArray *corrections = value;
+					totals[ENCHANT_MEMORY_OTHER] += strlen (key) + 1 + sizeof (GPtrArray) +
+						corrections->len * (sizeof (gpointer) + sizeof (EnchantReplacement));
+					for (guint i = 0; i < corrections->len; i++)
+						totals[ENCHANT_MEMORY_OTHER] +=
+							strlen (((EnchantReplacement *) g_ptr_array_index (corrections, i))->correction) + 1;
+				}
+		}
+	g_mutex_unlock (&session->replacements_lock);
 
-	g_return_if_fail (g_utf8_validate(mis, mis_len, NULL));
-	g_return_if_fail (g_utf8_validate(cor, cor_len, NULL));
+	EnchantSuggestStore *store = g_atomic_pointer_get (&session->suggest_store);
+	if (store)
+		{
+			g_mutex_lock (&store->lock);
+			totals[ENCHANT_MEMORY_OTHER] += sizeof (EnchantSuggestStore) + strlen (store->filename) + 1;
+			if (store->entries)
+				{
+					totals[ENCHANT_MEMORY_OTHER] += enchant_hash_table_memory_usage (g_hash_table_size (store->entries));
+					GHashTableIter words;
+					gpointer word;
+					g_hash_table_iter_init (&words, store->entries);
+					while (g_hash_table_iter_next (&words, &word, NULL))
+						totals[ENCHANT_MEMORY_OTHER] += strlen (word) + 1;
+					for (guint i = 0; i < store->appended->len; i++)
+						totals[ENCHANT_MEMORY_OTHER] += strlen (g_ptr_array_index (store->appended, i)) + 1;
+				}
+			if (store->mapped)
+				totals[ENCHANT_MEMORY_MAPPED] += g_mapped_file_get_length (store->mapped);
+			g_mutex_unlock (&store->lock);
+		}
 
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
+	g_rw_lock_reader_lock (&session->lock);
+	totals[ENCHANT_MEMORY_SESSION_WORDS] += enchant_hash_table_memory_usage (g_hash_table_size (session->session_words));
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, session->session_words);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		totals[ENCHANT_MEMORY_SESSION_WORDS] += sizeof (EnchantSessionWord) + ((EnchantSessionWord *) key)->len + 1;
+	g_rw_lock_reader_unlock (&session->lock);
+
+	totals[ENCHANT_MEMORY_CHECK_CACHE] += enchant_word_cache_memory_usage (&session->check_cache);
+	totals[ENCHANT_MEMORY_SUGGEST_CACHE] += enchant_word_cache_memory_usage (&session->suggest_cache);
+
+	/* word lists not opened yet take up nothing, and those shared
+	 * with other sessions are counted once */
+	EnchantPWL *lists[] = { g_atomic_pointer_get (&session->personal),
+				g_atomic_pointer_get (&session->exclude) };
+	EnchantMemory kinds[] = { ENCHANT_MEMORY_PERSONAL, ENCHANT_MEMORY_EXCLUDE };
+	for (guint i = 0; i < G_N_ELEMENTS (lists); i++)
+		if (lists[i] && g_hash_table_add (seen, lists[i]))
+			{
+				size_t heap, mapped;
+				enchant_pwl_get_memory_usage (lists[i], &heap, &mapped);
+				totals[kinds[i]] += heap;
+				totals[ENCHANT_MEMORY_MAPPED] += mapped;
+			}
 
-	/* if it's not implemented, it's not worth emulating */
-	if (dict->store_replacement)
-		(*dict->store_replacement) (dict, mis, mis_len, cor, cor_len);
+	/* clones are taken to cost what their dictionary does */
+	EnchantDict *dict = session->provider_dict;
+	if (dict)
+		{
+			g_rw_lock_reader_lock (&session->swap_lock);
+			if (session->serialize_provider)
+				g_mutex_lock (&session->provider_lock);
+			size_t size = (*dict->get_memory_usage) (dict);
+			if (session->serialize_provider)
+				g_mutex_unlock (&session->provider_lock);
+			g_rw_lock_reader_unlock (&session->swap_lock);
+
+			g_mutex_lock (&session->clones_lock);
+			totals[ENCHANT_MEMORY_PROVIDER] += (guint64) size * (1 + session->n_clones);
+			g_mutex_unlock (&session->clones_lock);
+		}
 }
 
-void
-enchant_dict_free_string_list (EnchantDict * dict, char **string_list)
+/* stops enchant_broker_get_memory_usage from asking the provider's
+ * dictionary of session, which is about to be disposed of */
+static void
+enchant_session_forget_provider_dict (EnchantSession * session)
 {
-	g_return_if_fail (dict);
-
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-	g_strfreev(string_list);
+	if (session->broker)
+		g_mutex_lock (&session->broker->stats_lock);
+	session->provider_dict = NULL;
+	if (session->broker)
+		g_mutex_unlock (&session->broker->stats_lock);
 }
 
-void
-enchant_dict_describe (EnchantDict * dict, EnchantDictDescribeFn fn, void * user_data)
+static guint64
+enchant_memory_report (guint64 * totals, EnchantStatsFn fn, void * user_data)
 {
-	g_return_if_fail (dict);
-	g_return_if_fail (fn);
-
-	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
-	enchant_session_clear_error (session);
-	EnchantProvider * provider = session->provider;
-
-	const char * name, * desc, * file;
-	if (provider)
-		{
-			GModule *module = (GModule *) provider->enchant_private_data;
-			file = g_module_name (module);
-			name = (*provider->identify) (provider);
-			desc = (*provider->describe) (provider);
-		}
-	else
+	guint64 total = 0;
+	for (guint i = 0; i < ENCHANT_N_MEMORY; i++)
 		{
-			file = session->personal_filename;
-			name = "Personal Wordlist";
-			desc = "Personal Wordlist";
+			total += totals[i];
+			if (fn)
+				(*fn) (enchant_memory_names[i], totals[i], user_data);
 		}
+	return total;
+}
 
-	const char *tag = session->language_tag;
-	(*fn) (tag, name, desc, file, user_data);
+static void
+enchant_session_get_stamp (EnchantSession * session, gboolean with_word_lists,
+			   EnchantWordCacheStamp * stamp)
+{
+	stamp->session = (guint) g_atomic_int_get (&session->generation);
+	stamp->personal = with_word_lists ? enchant_pwl_get_generation (enchant_session_get_personal (session)) : 0;
+	stamp->exclude = with_word_lists ? enchant_pwl_get_generation (enchant_session_get_exclude (session)) : 0;
 }
 
+static void
+enchant_session_destroy (EnchantSession * session)
+{
+	if (session->broker)
+		enchant_broker_remove_session (session->broker, session);
+	if (session->suggest_store)
+		enchant_suggest_store_free (session->suggest_store);
+	enchant_session_set_write_behind (session, FALSE);
+	enchant_word_cache_clear (&session->check_cache);
+	enchant_word_cache_clear (&session->suggest_cache);
+	g_hash_table_destroy (session->session_words);
+	g_rw_lock_clear (&session->lock);
+	g_mutex_clear (&session->provider_lock);
+	g_rw_lock_clear (&session->swap_lock);
+	g_mutex_clear (&session->pwl_lock);
+	g_ptr_array_unref (session->idle_clones);
+	g_mutex_clear (&session->clones_lock);
+
+	/* the other providers still being asked for suggestions hold on to
+	 * their dictionaries */
+	g_mutex_lock (&session->fanout_lock);
+	while (session->n_fanout_calls != 0)
+		g_cond_wait (&session->fanout_done, &session->fanout_lock);
+	g_mutex_unlock (&session->fanout_lock);
+	if (session->fanout)
+		g_ptr_array_unref (session->fanout);
+	g_mutex_clear (&session->fanout_lock);
+	g_cond_clear (&session->fanout_done);
+
+	g_ptr_array_unref (session->prefetches);
+	g_free (session->prefetch_group);
+	g_mutex_clear (&session->prefetch_lock);
+
+	if (session->personal)
+		enchant_pwl_free (session->personal);
+	if (session->exclude)
+		enchant_pwl_free (session->exclude);
+	g_free (session->personal_filename);
+	g_free (session->exclude_filename);
+	g_free (session->replacements_filename);
+	g_free (session->suggest_profile);
+	free (session->language_tag);
+	if (session->replacements)
+		g_hash_table_destroy (session->replacements);
+	g_mutex_clear (&session->replacements_lock);
+	enchant_errors_unref (session->errors);
+
+	g_free (session);
+}
+
+static EnchantSession *
+enchant_session_new_with_pwl (EnchantProvider * provider,
+			      const char * const pwl,
+			      const char * const excl,
+			      const char * const lang,
+			      gboolean fail_if_no_pwl)
+{
+	/* a word list that has to be there is opened, and created, now;
+	 * otherwise they are opened when first used */
+	EnchantPWL *personal = NULL;
+	if (fail_if_no_pwl) {
+		if (pwl)
+			personal = enchant_pwl_init_with_file (pwl);
+		if (personal == NULL)
+			return NULL;
+	}
+
+	EnchantSession * session = g_new0 (EnchantSession, 1);
+	session->id = enchant_session_id_new ();
+	session->errors = enchant_errors_new ();
+	g_rw_lock_init (&session->lock);
+	g_mutex_init (&session->provider_lock);
+	g_rw_lock_init (&session->swap_lock);
+	g_mutex_init (&session->pwl_lock);
+	g_mutex_init (&session->clones_lock);
+	g_mutex_init (&session->replacements_lock);
+	session->idle_clones = g_ptr_array_new ();
+	g_mutex_init (&session->fanout_lock);
+	g_cond_init (&session->fanout_done);
+	session->fanout_timeout_ms = -1;
+	g_mutex_init (&session->prefetch_lock);
+	session->prefetches = g_ptr_array_new ();
+	session->prefetch_group = g_new0 (EnchantTaskGroup, 1);
+	enchant_word_cache_init (&session->check_cache, NULL);
+	enchant_word_cache_init (&session->suggest_cache, g_free);
+	session->session_words = enchant_session_list_new ();
+	session->personal = personal;
+	session->provider = provider;
+	session->serialize_provider = provider && !enchant_provider_is_thread_safe (provider);
+	session->dict_extended = provider == NULL || enchant_provider_has_extensions (provider);
+	session->language_tag = strdup (lang);
+	session->personal_filename = g_strdup (pwl); /* Need g_strdup because may be NULL */
+	session->exclude_filename = g_strdup (excl); /* Need g_strdup because may be NULL */
+
+	return session;
+}
+
+static EnchantSession *
+_enchant_session_new (EnchantProvider *provider, const char * const user_config_dir,
+		      const char * const lang)
+{
+	if (!user_config_dir || !lang)
+		return NULL;
+
+	char *filename = g_strdup_printf ("%s.dic", lang);
+	char *dic = g_build_filename (user_config_dir, filename, NULL);
+	g_free (filename);
+
+	filename = g_strdup_printf ("%s.exc", lang);
+	char *excl = g_build_filename (user_config_dir, filename, NULL);
+	g_free (filename);
+
+	EnchantSession * session = enchant_session_new_with_pwl (provider, dic, excl, lang, FALSE);
+
+	filename = g_strdup_printf ("%s.rep", lang);
+	session->replacements_filename = g_build_filename (user_config_dir, filename, NULL);
+	g_free (filename);
+
+	g_free (dic);
+	g_free (excl);
+
+	return session;
+}
+
+static EnchantSession *
+enchant_session_new (EnchantProvider *provider, const char * const lang)
+{
+	char *user_config_dir = enchant_get_user_config_dir ();
+
+	/* neither the word lists nor the directory they are in are touched
+	 * until they are used */
+	EnchantSession * session = _enchant_session_new (provider, user_config_dir, lang);
+
+	g_free (user_config_dir);
+
+	return session;
+}
+
+static EnchantPWL *
+enchant_session_open_pwl (EnchantSession * session, EnchantPWL ** pwl, const char * const filename)
+{
+	EnchantPWL *opened = g_atomic_pointer_get (pwl);
+	if (opened)
+		return opened;
+
+	g_mutex_lock (&session->pwl_lock);
+	opened = *pwl;
+	if (opened == NULL)
+		{
+			/* a file that is not there yet is an empty list */
+			opened = filename ? enchant_pwl_init_with_optional_file (filename) : enchant_pwl_init ();
+			if (session->write_behind)
+				enchant_pwl_set_write_behind (opened, TRUE);
+			g_atomic_pointer_set (pwl, opened);
+		}
+	g_mutex_unlock (&session->pwl_lock);
+	return opened;
+}
+
+static EnchantPWL *
+enchant_session_get_personal (EnchantSession * session)
+{
+	return enchant_session_open_pwl (session, &session->personal, session->personal_filename);
+}
+
+static EnchantPWL *
+enchant_session_get_exclude (EnchantSession * session)
+{
+	return enchant_session_open_pwl (session, &session->exclude, session->exclude_filename);
+}
+
+static void
+enchant_replacement_free (gpointer data)
+{
+	EnchantReplacement *replacement = data;
+	g_free (replacement->correction);
+	g_free (replacement);
+}
+
+/* counts one more choice of cor for mis, keeping the corrections of mis
+ * ordered by how often they were chosen */
+static void
+enchant_replacements_add (GHashTable * replacements,
+			  const char * const mis, size_t mis_len,
+			  const char * const cor, size_t cor_len)
+{
+	char *key = g_strndup (mis, mis_len);
+	GPtrArray *corrections = g_hash_table_lookup (replacements, key);
+	if (corrections == NULL)
+		{
+			corrections = g_ptr_array_new_with_free_func (enchant_replacement_free);
+			g_hash_table_insert (replacements, key, corrections);
+		}
+	else
+		g_free (key);
+
+	guint i;
+	for (i = 0; i < corrections->len; i++)
+		{
+			EnchantReplacement *replacement = g_ptr_array_index (corrections, i);
+			if (strlen (replacement->correction) == cor_len &&
+			    memcmp (replacement->correction, cor, cor_len) == 0)
+				break;
+		}
+	if (i == corrections->len)
+		{
+			EnchantReplacement *replacement = g_new (EnchantReplacement, 1);
+			replacement->correction = g_strndup (cor, cor_len);
+			replacement->count = 0;
+			g_ptr_array_add (corrections, replacement);
+		}
+
+	EnchantReplacement *replacement = g_ptr_array_index (corrections, i);
+	replacement->count++;
+	for (; i > 0 && ((EnchantReplacement *) g_ptr_array_index (corrections, i - 1))->count < replacement->count; i--)
+		corrections->pdata[i] = corrections->pdata[i - 1];
+	corrections->pdata[i] = replacement;
+}
+
+/* The replacements file has a line "misspelling\tcorrection" for each
+ * time a correction was chosen.  It is read once, when the session's
+ * replacements are first needed; called with replacements_lock held. */
+static GHashTable *
+enchant_session_get_replacements (EnchantSession * session)
+{
+	if (session->replacements)
+		return session->replacements;
+
+	session->replacements = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						       (GDestroyNotify) g_ptr_array_unref);
+	char *contents;
+	if (session->replacements_filename &&
+	    g_file_get_contents (session->replacements_filename, &contents, NULL, NULL))
+		{
+			char **lines = g_strsplit (contents, "\n", -1);
+			for (char **line = lines; *line; line++)
+				{
+					char *tab = strchr (*line, '\t');
+					if (tab == NULL || tab == *line || tab[1] == '\0' ||
+					    !enchant_utf8_validate (*line, strlen (*line), NULL))
+						continue;
+					enchant_replacements_add (session->replacements, *line, tab - *line,
+								  tab + 1, strlen (tab + 1));
+				}
+			g_strfreev (lines);
+			g_free (contents);
+		}
+	return session->replacements;
+}
+
+static void
+enchant_session_store_replacement (EnchantSession * session,
+				   const char * const mis, size_t mis_len,
+				   const char * const cor, size_t cor_len)
+{
+	g_mutex_lock (&session->replacements_lock);
+	enchant_replacements_add (enchant_session_get_replacements (session), mis, mis_len, cor, cor_len);
+
+	/* a word with a tab or a line break in it is not written out */
+	if (session->replacements_filename &&
+	    !memchr (mis, '\t', mis_len) && !memchr (mis, '\n', mis_len) &&
+	    !memchr (cor, '\t', cor_len) && !memchr (cor, '\n', cor_len))
+		{
+			char *dir = g_path_get_dirname (session->replacements_filename);
+			enchant_ensure_dir_exists (dir);
+			g_free (dir);
+
+			FILE *f = g_fopen (session->replacements_filename, "ab");
+			if (f)
+				{
+					char *line = g_strdup_printf ("%.*s\t%.*s\n", (int) mis_len, mis, (int) cor_len, cor);
+					fputs (line, f);
+					fclose (f);
+					g_free (line);
+				}
+		}
+	g_mutex_unlock (&session->replacements_lock);
+}
+
+/* the corrections chosen for word so far, best first, as a g_strfreev
+ * list, or NULL if there are none; tells whether the best is chosen
+ * often enough to go without other suggestions */
+static char **
+enchant_session_lookup_replacements (EnchantSession * session, const char * const word, size_t len,
+				     size_t * out_n_corrections, gboolean * out_confident)
+{
+	char **corrections = NULL;
+	*out_n_corrections = 0;
+	*out_confident = FALSE;
+
+	g_mutex_lock (&session->replacements_lock);
+	char *key = g_strndup (word, len);
+	GPtrArray *replacements = g_hash_table_lookup (enchant_session_get_replacements (session), key);
+	g_free (key);
+	if (replacements)
+		{
+			guint others = 0;
+			corrections = g_new (char *, replacements->len + 1);
+			for (guint i = 0; i < replacements->len; i++)
+				{
+					EnchantReplacement *replacement = g_ptr_array_index (replacements, i);
+					corrections[i] = g_strdup (replacement->correction);
+					if (i != 0)
+						others += replacement->count;
+				}
+			corrections[replacements->len] = NULL;
+
+			guint best = ((EnchantReplacement *) g_ptr_array_index (replacements, 0))->count;
+			*out_n_corrections = replacements->len;
+			*out_confident = best >= ENCHANT_REPLACEMENT_CONFIDENT_COUNT &&
+				best >= ENCHANT_REPLACEMENT_CONFIDENT_RATIO * others;
+		}
+	g_mutex_unlock (&session->replacements_lock);
+	return corrections;
+}
+
+/* the word lists may be shared, so each session asks or stops asking
+ * for write-behind mode once; one not opened yet asks when it is */
+static void
+enchant_session_set_write_behind (EnchantSession * session, gboolean enabled)
+{
+	g_mutex_lock (&session->pwl_lock);
+	if (!enabled != !session->write_behind)
+		{
+			session->write_behind = enabled;
+			if (session->personal)
+				enchant_pwl_set_write_behind (session->personal, enabled);
+			if (session->exclude)
+				enchant_pwl_set_write_behind (session->exclude, enabled);
+		}
+	g_mutex_unlock (&session->pwl_lock);
+}
+
+/* write out what the word lists opened so far hold back */
+static void
+enchant_session_flush (EnchantSession * session)
+{
+	g_mutex_lock (&session->pwl_lock);
+	if (session->write_behind)
+		{
+			if (session->personal)
+				enchant_pwl_flush (session->personal);
+			if (session->exclude)
+				enchant_pwl_flush (session->exclude);
+		}
+	g_mutex_unlock (&session->pwl_lock);
+}
+
+static void
+enchant_session_add (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_session_list_set (session, word, len, ENCHANT_SESSION_GOOD);
+}
+
+static void
+enchant_session_remove (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_session_list_set (session, word, len, ENCHANT_SESSION_BAD);
+}
+
+static void
+enchant_session_add_personal (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_pwl_add(enchant_session_get_personal (session), word, len);
+}
+
+static void
+enchant_session_add_personal_many (EnchantSession * session, const char * const * words, size_t n_words)
+{
+	enchant_pwl_add_many(enchant_session_get_personal (session), words, n_words);
+}
+
+static void
+enchant_session_remove_personal (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_pwl_remove(enchant_session_get_personal (session), word, len);
+}
+
+static void
+enchant_session_add_exclude (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_pwl_add(enchant_session_get_exclude (session), word, len);
+}
+
+static void
+enchant_session_remove_exclude (EnchantSession * session, const char * const word, size_t len)
+{
+	enchant_pwl_remove(enchant_session_get_exclude (session), word, len);
+}
+
+/* a word is excluded if it is in the exclude dictionary or in the session exclude list
+ *  AND the word has not been added to the session include list
+ */
+static gboolean
+enchant_session_exclude (EnchantSession * session, const char * const word, size_t len)
+{
+	EnchantSessionVerdict verdict = enchant_session_list_lookup (session, word, len);
+	return verdict == ENCHANT_SESSION_BAD ||
+		(verdict == ENCHANT_SESSION_DEFER && enchant_pwl_check (enchant_session_get_exclude (session), word, len) == 0);
+}
+
+static gboolean
+enchant_session_exclude_suggestion (EnchantSession * session, const EnchantSuggestion * sugg)
+{
+	EnchantSessionVerdict verdict = enchant_session_list_lookup (session, sugg->word, sugg->len);
+	return verdict == ENCHANT_SESSION_BAD ||
+		(verdict == ENCHANT_SESSION_DEFER && enchant_pwl_check_suggestion (enchant_session_get_exclude (session), sugg) == 0);
+}
+
+static gboolean
+enchant_session_contains (EnchantSession * session, const char * const word, size_t len)
+{
+	return enchant_session_list_lookup (session, word, len) == ENCHANT_SESSION_GOOD ||
+		(enchant_pwl_check (enchant_session_get_personal (session), word, len) == 0 &&
+		 (!enchant_pwl_check (enchant_session_get_exclude (session), word, len)) == 0);
+}
+
+/* what the session makes of a word, consulting each of its lists once:
+ * the session's own words come first, then the exclude dictionary and
+ * then the personal one, as enchant_session_exclude and
+ * enchant_session_contains would have it; counts which list decided */
+static EnchantSessionVerdict
+enchant_session_check (EnchantSession * session, const char * const word, size_t len)
+{
+	EnchantSessionVerdict verdict = enchant_session_list_lookup (session, word, len);
+	if (verdict != ENCHANT_SESSION_DEFER)
+		{
+			enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS_SESSION, 1);
+			return verdict;
+		}
+
+	if (enchant_pwl_check (enchant_session_get_exclude (session), word, len) == 0)
+		{
+			enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS_EXCLUDE, 1);
+			return ENCHANT_SESSION_BAD;
+		}
+	if (enchant_pwl_check (enchant_session_get_personal (session), word, len) == 0)
+		{
+			enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS_PERSONAL, 1);
+			return ENCHANT_SESSION_GOOD;
+		}
+	return ENCHANT_SESSION_DEFER;
+}
+
+/* Errors are kept per thread, see enchant_errors_set */
+static const char *
+enchant_session_get_error (EnchantSession * session)
+{
+	return enchant_errors_get (session->errors);
+}
+
+/* takes over err */
+static void
+enchant_session_set_error (EnchantSession * session, char * err)
+{
+	enchant_errors_set (session->errors, err);
+}
+
+static void
+enchant_session_clear_error (EnchantSession * session)
+{
+	enchant_errors_clear (session->errors);
+}
+
+/* whether the words are read-only, in which case it sets the error */
+static gboolean
+enchant_session_refuse_changes (EnchantSession * session)
+{
+	if (!session->readonly)
+		return FALSE;
+
+	enchant_session_set_error (session, g_strdup_printf ("Personal wordlist '%s' is read-only",
+							     session->personal_filename));
+	return TRUE;
+}
+
+/* providers that do not declare ENCHANT_PROVIDER_THREAD_SAFE are called
+ * for a dictionary by one thread at a time; and none is called while
+ * enchant_broker_reload_dict swaps it */
+static void
+enchant_session_lock_provider (EnchantSession * session)
+{
+	g_rw_lock_reader_lock (&session->swap_lock);
+	if (session->serialize_provider)
+		g_mutex_lock (&session->provider_lock);
+}
+
+static void
+enchant_session_unlock_provider (EnchantSession * session)
+{
+	if (session->serialize_provider)
+		g_mutex_unlock (&session->provider_lock);
+	g_rw_lock_reader_unlock (&session->swap_lock);
+}
+
+/* Where a provider can clone its dictionary, a thread that would wait
+ * for its turn at @dict checks with an idle clone instead, or with a new
+ * one while there are fewer than one per processor.  Returns what to
+ * call, to be handed back to enchant_session_release_dict. */
+static EnchantDict *
+enchant_session_acquire_dict (EnchantSession * session, EnchantDict * dict)
+{
+	g_rw_lock_reader_lock (&session->swap_lock);
+	if (!session->serialize_provider)
+		return dict;
+	if (session->max_clones == 0 || g_mutex_trylock (&session->provider_lock))
+		{
+			if (session->max_clones == 0)
+				g_mutex_lock (&session->provider_lock);
+			return dict;
+		}
+
+	EnchantDict *clone = NULL;
+	gboolean make_clone = FALSE;
+	g_mutex_lock (&session->clones_lock);
+	if (session->idle_clones->len != 0)
+		clone = g_ptr_array_remove_index_fast (session->idle_clones, session->idle_clones->len - 1);
+	else if (session->n_clones < session->max_clones)
+		{
+			session->n_clones++;
+			make_clone = TRUE;
+		}
+	g_mutex_unlock (&session->clones_lock);
+
+	if (make_clone)
+		{
+			EnchantProvider *provider = session->provider;
+			enchant_provider_lock (provider);
+			clone = (*provider->clone_dict) (provider, dict);
+			enchant_provider_unlock (provider);
+
+			if (clone)
+				/* errors the clone reports are the dictionary's */
+				clone->enchant_private_data = dict->enchant_private_data;
+			else
+				{
+					g_mutex_lock (&session->clones_lock);
+					session->n_clones--;
+					g_mutex_unlock (&session->clones_lock);
+				}
+		}
+
+	if (clone)
+		return clone;
+
+	g_mutex_lock (&session->provider_lock);
+	return dict;
+}
+
+static void
+enchant_session_release_dict (EnchantSession * session, EnchantDict * dict, EnchantDict * used)
+{
+	if (session->serialize_provider && used == dict)
+		g_mutex_unlock (&session->provider_lock);
+	else if (session->serialize_provider)
+		{
+			g_mutex_lock (&session->clones_lock);
+			g_ptr_array_add (session->idle_clones, used);
+			g_mutex_unlock (&session->clones_lock);
+		}
+	g_rw_lock_reader_unlock (&session->swap_lock);
+}
+
+/* disposes of the clones no thread is using, see enchant_broker_trim */
+static void
+enchant_session_dispose_idle_clones (EnchantSession * session)
+{
+	g_mutex_lock (&session->clones_lock);
+	GPtrArray *idle = session->idle_clones;
+	session->idle_clones = g_ptr_array_new ();
+	session->n_clones -= idle->len;
+	g_mutex_unlock (&session->clones_lock);
+
+	EnchantProvider *provider = session->provider;
+	for (guint i = 0; i < idle->len; i++)
+		{
+			EnchantDict *clone = g_ptr_array_index (idle, i);
+			clone->enchant_private_data = NULL;
+			enchant_provider_lock (provider);
+			(*provider->dispose_dict) (provider, clone);
+			enchant_provider_unlock (provider);
+		}
+	g_ptr_array_unref (idle);
+}
+
+/* the clones are all idle by the time their dictionary goes */
+static void
+enchant_session_dispose_clones (EnchantSession * session)
+{
+	EnchantProvider *provider = session->provider;
+	for (guint i = 0; i < session->idle_clones->len; i++)
+		{
+			EnchantDict *clone = g_ptr_array_index (session->idle_clones, i);
+			clone->enchant_private_data = NULL;
+			enchant_provider_lock (provider);
+			(*provider->dispose_dict) (provider, clone);
+			enchant_provider_unlock (provider);
+		}
+	g_ptr_array_set_size (session->idle_clones, 0);
+	session->n_clones = 0;
+}
+
+/********************************************************************************/
+/********************************************************************************/
+
+static void
+enchant_free_string_list (char ** string_list)
+{
+	g_strfreev (string_list);
+}
+
+/* The functions enchant_set_allocator set.  Like the trace listener,
+ * one that is replaced is never freed. */
+typedef struct str_enchant_allocator
+{
+	EnchantMallocFn malloc_fn;
+	EnchantFreeFn free_fn;
+	void *user_data;
+} EnchantAllocator;
+
+static gpointer enchant_allocator;
+
+void
+enchant_set_allocator (EnchantMallocFn malloc_fn, EnchantFreeFn free_fn, void * user_data)
+{
+	g_return_if_fail ((malloc_fn == NULL) == (free_fn == NULL));
+
+	EnchantAllocator *allocator = NULL;
+	if (malloc_fn)
+		{
+			allocator = g_new (EnchantAllocator, 1);
+			allocator->malloc_fn = malloc_fn;
+			allocator->free_fn = free_fn;
+			allocator->user_data = user_data;
+		}
+	g_atomic_pointer_set (&enchant_allocator, allocator);
+}
+
+/* allocates what is handed to the caller, to be released with
+ * enchant_result_free; aborts as g_malloc does when out of memory */
+static gpointer
+enchant_result_alloc (size_t size)
+{
+	EnchantAllocator *allocator = g_atomic_pointer_get (&enchant_allocator);
+	if (allocator == NULL)
+		return g_malloc (size);
+
+	gpointer block = (*allocator->malloc_fn) (size, allocator->user_data);
+	if (block == NULL)
+		g_error ("enchant: failed to allocate %" G_GSIZE_FORMAT " bytes", size);
+	return block;
+}
+
+static void
+enchant_result_free (gpointer block)
+{
+	if (block == NULL)
+		return;
+
+	EnchantAllocator *allocator = g_atomic_pointer_get (&enchant_allocator);
+	if (allocator == NULL)
+		g_free (block);
+	else
+		(*allocator->free_fn) (block, allocator->user_data);
+}
+
+/* Suggestion lists are handed out in one block each, the pointers
+ * followed by the text they point to, so that a list is made with one
+ * allocation and released with one free.  Those kept by Enchant itself
+ * are g_malloc'ed, the others come from enchant_result_alloc. */
+static char **
+enchant_strv_pack (char *const * strv, size_t n, gboolean for_caller)
+{
+	size_t size = (n + 1) * sizeof (char *);
+	for (size_t i = 0; i < n; i++)
+		size += strlen (strv[i]) + 1;
+
+	char *block = for_caller ? enchant_result_alloc (size) : g_malloc (size);
+	char **packed = (char **) block;
+	char *text = block + (n + 1) * sizeof (char *);
+	for (size_t i = 0; i < n; i++)
+		{
+			size_t len = strlen (strv[i]) + 1;
+			memcpy (text, strv[i], len);
+			packed[i] = text;
+			text += len;
+		}
+	packed[n] = NULL;
+
+	return packed;
+}
+
+void
+enchant_dict_set_error (EnchantDict * dict, const char * const err)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (err);
+	g_return_if_fail (g_utf8_validate(err, -1, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_set_error (session, g_strdup (err));
+}
+
+const char *
+enchant_dict_get_error (EnchantDict * dict)
+{
+	g_return_val_if_fail (dict, NULL);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	return enchant_session_get_error (session);
+}
+
+/* Set by a provider whose suggestions fall short during the call, see
+ * enchant_dict_set_suggest_partial; and, kept per thread as errors are,
+ * one more than the error key of the session whose suggestions last fell
+ * short, see enchant_dict_get_suggest_partial */
+static GPrivate enchant_provider_suggest_partial;
+static GPrivate enchant_suggest_partial;
+
+void
+enchant_dict_set_suggest_partial (EnchantDict * dict)
+{
+	g_return_if_fail (dict);
+
+	g_private_set (&enchant_provider_suggest_partial, GINT_TO_POINTER (TRUE));
+}
+
+int
+enchant_dict_get_suggest_partial (EnchantDict * dict)
+{
+	g_return_val_if_fail (dict, 0);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	return GPOINTER_TO_UINT (g_private_get (&enchant_suggest_partial)) == session->id + 1;
+}
+
+static int
+_enchant_dict_check (EnchantDict * dict, EnchantSession * session, const char *const word, size_t len)
+{
+	enchant_session_clear_error (session);
+	enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS, 1);
+
+	/* first, see if it's excluded, or in our pwl or session */
+	switch (enchant_session_check (session, word, len))
+		{
+		case ENCHANT_SESSION_BAD:
+			return 1;
+		case ENCHANT_SESSION_GOOD:
+			return 0;
+		case ENCHANT_SESSION_DEFER:
+			break;
+		}
+
+	if (dict->check)
+		{
+			EnchantWordCacheStamp stamp;
+			gpointer cached_result;
+
+			enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS_PROVIDER, 1);
+
+			/* only a hint, the cache checks for itself under its lock */
+			gboolean cached = session->check_cache.size != 0;
+			if (cached)
+				{
+					enchant_session_get_stamp (session, FALSE, &stamp);
+					if (enchant_word_cache_lookup (&session->check_cache, word, len, &stamp,
+								       NULL, &cached_result))
+						return GPOINTER_TO_INT (cached_result);
+				}
+
+			EnchantDict *checker = enchant_session_acquire_dict (session, dict);
+			EnchantTrace trace;
+			enchant_trace_enter (&trace, "provider_check", session->language_tag, session->provider, len);
+			gint64 start = g_get_monotonic_time ();
+			int result = (*checker->check) (checker, word, len);
+			enchant_stats_add_latency (&session->stats, ENCHANT_STAT_PROVIDER_CHECKS, start);
+			enchant_trace_leave (&trace);
+			enchant_session_release_dict (session, dict, checker);
+
+			if (cached && result >= 0)
+				enchant_word_cache_store (&session->check_cache, word, len, &stamp,
+							  GINT_TO_POINTER (result));
+			return result;
+		}
+	else if (session->is_pwl)
+		return 1;
+
+	return -1;
+}
+
+int
+enchant_dict_check (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (word, -1);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, -1);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL),-1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	EnchantTrace trace;
+	enchant_trace_enter (&trace, "check", session->language_tag, session->provider, len);
+	int result = _enchant_dict_check (dict, session, word, len);
+	enchant_trace_leave (&trace);
+	return result;
+}
+
+void
+enchant_dict_check_batch (EnchantDict * dict, const char *const *words,
+			  const ssize_t *lens, size_t n_words, int *results)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (words || n_words == 0);
+	g_return_if_fail (results || n_words == 0);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	/* the words left to the provider, and where their results go */
+	const char **provider_words = g_new (const char *, MAX (n_words, 1));
+	size_t *provider_lens = g_new (size_t, MAX (n_words, 1));
+	size_t *provider_index = g_new (size_t, MAX (n_words, 1));
+	size_t n_provider_words = 0;
+	size_t n_checked = 0, n_deferred = 0;
+
+	EnchantWordCacheStamp stamp;
+	gboolean cached = dict->check && session->check_cache.size != 0;
+	if (cached)
+		enchant_session_get_stamp (session, FALSE, &stamp);
+
+	for (size_t i = 0; i < n_words; i++)
+		{
+			const char *word = words[i];
+			size_t len = word == NULL ? 0 : lens && lens[i] >= 0 ? (size_t) lens[i] : strlen (word);
+
+			results[i] = -1;
+			if (len == 0 || !enchant_utf8_validate (word, len, NULL))
+				continue;
+			n_checked++;
+
+			gpointer cached_result;
+			switch (enchant_session_check (session, word, len))
+				{
+				case ENCHANT_SESSION_BAD:
+					results[i] = 1;
+					break;
+				case ENCHANT_SESSION_GOOD:
+					results[i] = 0;
+					break;
+				case ENCHANT_SESSION_DEFER:
+					if (!dict->check)
+						{
+							results[i] = session->is_pwl ? 1 : -1;
+							break;
+						}
+					n_deferred++;
+					if (cached && enchant_word_cache_lookup (&session->check_cache, word, len,
+										      &stamp, NULL, &cached_result))
+						results[i] = GPOINTER_TO_INT (cached_result);
+					else
+						{
+							provider_words[n_provider_words] = word;
+							provider_lens[n_provider_words] = len;
+							provider_index[n_provider_words++] = i;
+						}
+					break;
+				}
+		}
+
+	enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS, n_checked);
+	enchant_stats_add (&session->stats, ENCHANT_STAT_CHECKS_PROVIDER, n_deferred);
+
+	if (n_provider_words != 0)
+		{
+			int *provider_results = g_new (int, n_provider_words);
+
+			/* a batch counts as one call */
+			EnchantDict *checker = enchant_session_acquire_dict (session, dict);
+			EnchantTrace trace;
+			enchant_trace_enter (&trace, "provider_check_batch", session->language_tag,
+					     session->provider, n_provider_words);
+			gint64 start = g_get_monotonic_time ();
+			if (session->dict_extended && checker->check_batch)
+				(*checker->check_batch) (checker, provider_words, provider_lens, n_provider_words, provider_results);
+			else
+				for (size_t j = 0; j < n_provider_words; j++)
+					provider_results[j] = (*checker->check) (checker, provider_words[j], provider_lens[j]);
+			enchant_stats_add_latency (&session->stats, ENCHANT_STAT_PROVIDER_CHECKS, start);
+			enchant_trace_leave (&trace);
+			enchant_session_release_dict (session, dict, checker);
+
+			for (size_t j = 0; j < n_provider_words; j++)
+				{
+					results[provider_index[j]] = provider_results[j];
+					if (cached && provider_results[j] >= 0)
+						enchant_word_cache_store (&session->check_cache, provider_words[j], provider_lens[j],
+									  &stamp, GINT_TO_POINTER (provider_results[j]));
+				}
+			g_free (provider_results);
+		}
+
+	g_free (provider_words);
+	g_free (provider_lens);
+	g_free (provider_index);
+}
+
+int
+enchant_dict_check_batch_bits (EnchantDict * dict, const char *const *words,
+			       const ssize_t *lens, size_t n_words, uint8_t *misspelled)
+{
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (words || n_words == 0, -1);
+	g_return_val_if_fail (misspelled || n_words == 0, -1);
+
+	int *results = g_new (int, MAX (n_words, 1));
+	enchant_dict_check_batch (dict, words, lens, n_words, results);
+
+	if (n_words)
+		memset (misspelled, 0, (n_words + 7) / 8);
+	int n_misspelled = 0;
+	for (size_t i = 0; i < n_words; i++)
+		if (results[i] != 0)
+			{
+				misspelled[i / 8] |= 1 << (i % 8);
+				n_misspelled++;
+			}
+	g_free (results);
+	return n_misspelled;
+}
+
+/* Lists the words of @new_suggs that are not in @seen yet, by their
+ * normalized spelling, at the end of @suggs.  @seen and @suggs borrow
+ * the spellings, so @new_suggs must outlive them.
+ * @suggs must have at least n_suggs + n_new_suggs space allocated
+ * @n_suggs is the number if items currently appearing in @suggs
+ *
+ * returns the number of items in @suggs after merge is complete
+ */
+static size_t
+enchant_dict_merge_suggestions(GHashTable *seen, char ** suggs, size_t n_suggs,
+			       EnchantSuggestion * new_suggs, size_t n_new_suggs)
+{
+	for (size_t i = 0; i < n_new_suggs; i++)
+		{
+			EnchantSuggestion *sugg = &new_suggs[i];
+			if (g_hash_table_contains (seen, sugg->normalized))
+				continue;
+
+			g_hash_table_add (seen, sugg->normalized);
+			suggs[n_suggs++] = sugg->word;
+		}
+
+	return n_suggs;
+}
+
+static void
+enchant_dict_free_suggestions (EnchantSuggestion * suggs, size_t n_suggs)
+{
+	for (size_t i = 0; i < n_suggs; i++)
+		enchant_suggestion_clear (&suggs[i]);
+	g_free (suggs);
+}
+
+/* drops the suggestions that are excluded, keeping the others in
+ * place; returns how many are left */
+static size_t
+enchant_dict_keep_good_suggestions(EnchantDict * dict, EnchantSuggestion * suggs, size_t n_suggs)
+{
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+
+	size_t n_good_suggs = 0;
+	for (size_t i = 0; i < n_suggs; i++)
+		{
+			if (!enchant_session_exclude_suggestion(session, &suggs[i]))
+				suggs[n_good_suggs++] = suggs[i];
+			else
+				enchant_suggestion_clear (&suggs[i]);
+		}
+
+	return n_good_suggs;
+}
+
+/* takes over the provider's suggestions, dropping those that are empty
+ * or not valid UTF-8 */
+static EnchantSuggestion *
+enchant_dict_take_suggestions(char ** dict_suggs, size_t n_dict_suggs, size_t * out_n_suggs)
+{
+	EnchantSuggestion *suggs = g_new (EnchantSuggestion, MAX (n_dict_suggs, 1));
+	size_t n_suggs = 0;
+	for (size_t i = 0; i < n_dict_suggs; i++)
+		{
+			size_t sugg_len = strlen(dict_suggs[i]);
+
+			if (sugg_len != 0 && enchant_utf8_validate (dict_suggs[i], sugg_len, NULL))
+				enchant_suggestion_init (&suggs[n_suggs++], dict_suggs[i], sugg_len);
+			else
+				g_free (dict_suggs[i]);
+		}
+	g_free (dict_suggs);
+
+	*out_n_suggs = n_suggs;
+	return suggs;
+}
+
+static gpointer
+enchant_dict_copy_suggestions (gconstpointer suggs, gpointer data _GL_UNUSED_PARAMETER)
+{
+	return ((char **) suggs)[0] ? enchant_strv_pack ((char **) suggs, g_strv_length ((char **) suggs), TRUE) : NULL;
+}
+
+/* how much effort finding suggestions may take */
+typedef struct str_enchant_suggest_bounds
+{
+	size_t max_suggs;	/* 0 for no limit */
+	int max_distance;	/* -1 for no limit */
+	gint64 deadline;	/* in g_get_monotonic_time, or G_MAXINT64 */
+	gint *cancelled;	/* set to give up, or NULL */
+} EnchantSuggestBounds;
+
+static const EnchantSuggestBounds enchant_suggest_unbounded = { 0, -1, G_MAXINT64, NULL };
+
+static void
+enchant_suggest_bounds_init (EnchantSuggestBounds * bounds, size_t max_suggs,
+			     int max_distance, int timeout_ms)
+{
+	bounds->max_suggs = max_suggs;
+	bounds->max_distance = max_distance < 0 ? -1 : max_distance;
+	bounds->deadline = timeout_ms < 0 ? G_MAXINT64 :
+		g_get_monotonic_time () + (gint64) timeout_ms * G_TIME_SPAN_MILLISECOND;
+	bounds->cancelled = NULL;
+}
+
+static gboolean
+enchant_suggest_bounds_limit_results (const EnchantSuggestBounds * bounds)
+{
+	return bounds->max_suggs != 0 || bounds->max_distance >= 0 || bounds->deadline != G_MAXINT64;
+}
+
+/* polled through an EnchantPWLStop too */
+static int
+enchant_suggest_bounds_reached (void * data)
+{
+	const EnchantSuggestBounds *bounds = data;
+	return (bounds->cancelled && g_atomic_int_get (bounds->cancelled)) ||
+		(bounds->deadline != G_MAXINT64 && g_get_monotonic_time () >= bounds->deadline);
+}
+
+/* the milliseconds left for a provider, or -1 */
+static int
+enchant_suggest_bounds_timeout (const EnchantSuggestBounds * bounds)
+{
+	if (bounds->deadline == G_MAXINT64)
+		return -1;
+
+	gint64 left = (bounds->deadline - g_get_monotonic_time ()) / G_TIME_SPAN_MILLISECOND;
+	return (int) CLAMP (left, 0, G_MAXINT);
+}
+
+/* drops the suggestions after the first max_suggs, if that is a limit */
+static size_t
+enchant_dict_limit_suggestions (EnchantSuggestion * suggs, size_t n_suggs, size_t max_suggs)
+{
+	if (max_suggs == 0 || n_suggs <= max_suggs)
+		return n_suggs;
+
+	for (size_t i = max_suggs; i < n_suggs; i++)
+		enchant_suggestion_clear (&suggs[i]);
+	return max_suggs;
+}
+
+/* The other providers a dictionary with a suggestion fan-out asks, see
+ * enchant_dict_set_suggest_fanout.  A call is held by the caller until
+ * it has taken what was found in time, and by each item's task until it
+ * is done, so that one that misses the deadline can be left behind. */
+typedef struct str_enchant_fanout_call EnchantFanoutCall;
+
+typedef struct str_enchant_fanout_item
+{
+	EnchantFanoutCall *call;
+	EnchantDict *dict;
+	char **suggs;
+	size_t n_suggs;
+	gboolean done;
+} EnchantFanoutItem;
+
+struct str_enchant_fanout_call
+{
+	gint ref_count;
+	gint abandoned;		/* set once the caller stops waiting */
+	GMutex lock;		/* guards the items' results and n_pending */
+	GCond done;
+	size_t n_pending;
+	EnchantSession *session;	/* waits for the call before it goes */
+	GPtrArray *dicts;	/* kept until the last worker is done with them */
+	char *word;
+	size_t len;
+	size_t max_suggs;
+	int max_distance;
+	gint64 deadline;
+	EnchantTaskGroup group;	/* the items' tasks, for the caller to run those not started */
+	size_t n_items;
+	EnchantFanoutItem items[];
+};
+
+static void
+enchant_provider_free_suggestions (char ** suggs, size_t n_suggs)
+{
+	if (suggs == NULL)
+		return;
+	for (size_t i = 0; i < n_suggs; i++)
+		g_free (suggs[i]);
+	g_free (suggs);
+}
+
+static void
+enchant_fanout_call_unref (EnchantFanoutCall * call)
+{
+	if (!g_atomic_int_dec_and_test (&call->ref_count))
+		return;
+
+	for (size_t i = 0; i < call->n_items; i++)
+		enchant_provider_free_suggestions (call->items[i].suggs, call->items[i].n_suggs);
+	g_ptr_array_unref (call->dicts);
+	g_mutex_clear (&call->lock);
+	g_cond_clear (&call->done);
+	g_free (call->word);
+
+	EnchantSession *session = call->session;
+	g_free (call);
+
+	g_mutex_lock (&session->fanout_lock);
+	session->n_fanout_calls--;
+	g_cond_broadcast (&session->fanout_done);
+	g_mutex_unlock (&session->fanout_lock);
+}
+
+static void
+enchant_fanout_item_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantFanoutItem *item = data;
+	EnchantFanoutCall *call = item->call;
+	EnchantDict *dict = item->dict;
+	EnchantSession *session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+
+	char **suggs = NULL;
+	size_t n_suggs = 0;
+	gint64 now = g_get_monotonic_time ();
+	if (!g_atomic_int_get (&call->abandoned) && now < call->deadline && dict->suggest)
+		{
+			gboolean bounded = call->max_suggs != 0 || call->max_distance >= 0 ||
+				call->deadline != G_MAXINT64;
+			int timeout_ms = call->deadline == G_MAXINT64 ? -1 :
+				(int) ((call->deadline - now) / G_TIME_SPAN_MILLISECOND);
+
+			EnchantDict *checker = enchant_session_acquire_dict (session, dict);
+			if (session->dict_extended && checker->suggest_bounded && bounded)
+				suggs = (*checker->suggest_bounded) (checker, call->word, call->len, call->max_suggs,
+								     call->max_distance, timeout_ms, &n_suggs);
+			else
+				suggs = (*checker->suggest) (checker, call->word, call->len, &n_suggs);
+			enchant_session_release_dict (session, dict, checker);
+			/* a provider that fails just has nothing to add */
+			enchant_session_clear_error (session);
+		}
+
+	g_mutex_lock (&call->lock);
+	item->suggs = suggs;
+	item->n_suggs = suggs ? n_suggs : 0;
+	item->done = TRUE;
+	call->n_pending--;
+	g_cond_signal (&call->done);
+	g_mutex_unlock (&call->lock);
+}
+
+static void
+enchant_fanout_item_release (gpointer data)
+{
+	enchant_fanout_call_unref (((EnchantFanoutItem *) data)->call);
+}
+
+/* starts asking the session's other providers for suggestions, if it has
+ * any; returns NULL otherwise */
+static EnchantFanoutCall *
+enchant_session_start_fanout (EnchantSession * session, const char *const word, size_t len,
+			      const EnchantSuggestBounds * bounds)
+{
+	g_mutex_lock (&session->fanout_lock);
+	GPtrArray *dicts = session->fanout ? g_ptr_array_ref (session->fanout) : NULL;
+	int timeout_ms = session->fanout_timeout_ms;
+	if (dicts)
+		session->n_fanout_calls++;
+	g_mutex_unlock (&session->fanout_lock);
+	if (dicts == NULL)
+		return NULL;
+
+	EnchantFanoutCall *call = g_malloc0 (sizeof (EnchantFanoutCall) + dicts->len * sizeof (EnchantFanoutItem));
+	call->ref_count = 1 + dicts->len;
+	g_mutex_init (&call->lock);
+	g_cond_init (&call->done);
+	call->n_pending = call->n_items = dicts->len;
+	call->session = session;
+	call->dicts = dicts;
+	call->word = g_strndup (word, len);
+	call->len = len;
+	call->max_suggs = bounds->max_suggs;
+	call->max_distance = bounds->max_distance;
+	/* the sooner of the fan-out's own deadline and the caller's */
+	call->deadline = bounds->deadline;
+	if (timeout_ms >= 0)
+		call->deadline = MIN (call->deadline, g_get_monotonic_time () + (gint64) timeout_ms * G_TIME_SPAN_MILLISECOND);
+
+	for (size_t i = 0; i < call->n_items; i++)
+		{
+			call->items[i].call = call;
+			call->items[i].dict = g_ptr_array_index (dicts, i);
+			enchant_broker_submit_full (session->broker, enchant_fanout_item_run, &call->items[i],
+						    enchant_fanout_item_release, &call->group);
+		}
+
+	return call;
+}
+
+/* Waits for the other providers until the deadline, and interleaves
+ * what those done by then suggested with suggs by rank: every
+ * provider's first suggestion, suggs' first, then every second one and
+ * so on.  Takes over suggs, and sets complete to whether every
+ * provider was done in time. */
+static char **
+enchant_fanout_call_finish (EnchantFanoutCall * call, char ** suggs, size_t * n_suggs,
+			    gboolean * complete)
+{
+	size_t n_lists = 1 + call->n_items;
+	char ***lists = g_newa (char **, n_lists);
+	size_t *n_list_suggs = g_newa (size_t, n_lists);
+	lists[0] = suggs;
+	n_list_suggs[0] = suggs ? *n_suggs : 0;
+
+	EnchantBroker *broker = call->session->broker;
+	g_mutex_lock (&call->lock);
+	while (call->n_pending != 0)
+		{
+			if (call->deadline == G_MAXINT64)
+				{
+					/* with no deadline to give up at, the items
+					 * not started yet are run here, as in
+					 * enchant_broker_wait_tasks */
+					g_mutex_unlock (&call->lock);
+					gboolean ran = enchant_broker_run_group_task (broker, &call->group);
+					g_mutex_lock (&call->lock);
+					if (!ran && call->n_pending != 0)
+						g_cond_wait (&call->done, &call->lock);
+				}
+			else if (!g_cond_wait_until (&call->done, &call->lock, call->deadline))
+				break;
+		}
+	g_atomic_int_set (&call->abandoned, 1);
+	*complete = call->n_pending == 0;
+
+	/* what comes later is freed with the call */
+	for (size_t i = 0; i < call->n_items; i++)
+		{
+			EnchantFanoutItem *item = &call->items[i];
+			lists[i + 1] = item->done ? item->suggs : NULL;
+			n_list_suggs[i + 1] = item->done ? item->n_suggs : 0;
+			if (item->done)
+				item->suggs = NULL;
+		}
+	g_mutex_unlock (&call->lock);
+	enchant_fanout_call_unref (call);
+
+	size_t max_n_list_suggs = 0;
+	for (size_t i = 0; i < n_lists; i++)
+		max_n_list_suggs = MAX (max_n_list_suggs, n_list_suggs[i]);
+
+	GPtrArray *merged = g_ptr_array_new ();
+	for (size_t rank = 0; rank < max_n_list_suggs; rank++)
+		for (size_t i = 0; i < n_lists; i++)
+			if (rank < n_list_suggs[i])
+				g_ptr_array_add (merged, lists[i][rank]);
+	for (size_t i = 0; i < n_lists; i++)
+		g_free (lists[i]);
+
+	*n_suggs = merged->len;
+	if (merged->len == 0)
+		{
+			g_ptr_array_free (merged, TRUE);
+			return NULL;
+		}
+	g_ptr_array_add (merged, NULL);
+	return (char **) g_ptr_array_free (merged, FALSE);
+}
+
+/* as enchant_dict_suggest, within bounds; once the deadline passes or
+ * the suggestions are cancelled, the steps left are skipped and what
+ * the steps before found is kept */
+static char **
+_enchant_dict_suggest_within (EnchantDict * dict, const char *const word, size_t len,
+			      const EnchantSuggestBounds * bounds, size_t * out_n_suggs)
+{
+	size_t n_dict_suggs = 0, n_pwl_suggs = 0;
+	EnchantSuggestion *dict_suggs = NULL, *pwl_suggs = NULL;
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	g_private_set (&enchant_suggest_partial, NULL);
+	enchant_stats_add (&session->stats, ENCHANT_STAT_SUGGESTS, 1);
+
+	/* only a hint, the cache checks for itself under its lock; the
+	 * first suggestions of a full list are as good as any */
+	EnchantWordCacheStamp stamp;
+	gboolean cached = session->suggest_cache.size != 0;
+	if (cached && bounds->max_distance < 0)
+		{
+			gpointer cached_suggs;
+
+			enchant_session_get_stamp (session, TRUE, &stamp);
+			if (enchant_word_cache_lookup (&session->suggest_cache, word, len, &stamp,
+						       enchant_dict_copy_suggestions, &cached_suggs))
+				{
+					size_t n_cached_suggs = cached_suggs ? g_strv_length (cached_suggs) : 0;
+					if (bounds->max_suggs != 0 && n_cached_suggs > bounds->max_suggs)
+						{
+							((char **) cached_suggs)[bounds->max_suggs] = NULL;
+							n_cached_suggs = bounds->max_suggs;
+						}
+					if (out_n_suggs)
+						*out_n_suggs = n_cached_suggs;
+					return cached_suggs;
+				}
+		}
+	/* what is found within limits is not the full list */
+	cached = cached && !enchant_suggest_bounds_limit_results (bounds);
+	gboolean partial = FALSE;
+
+	/* every step below works on the normal forms worked out here */
+	EnchantSuggestion query;
+	enchant_suggestion_init (&query, g_strndup (word, len), len);
+
+	/* The corrections chosen for the word before come first; one chosen
+	 * often enough is all there is to suggest, unless it is excluded
+	 * now */
+	size_t n_learned_suggs = 0;
+	EnchantSuggestion *learned_suggs = NULL;
+	gboolean confident;
+	char **learned = enchant_session_lookup_replacements (session, word, len, &n_learned_suggs, &confident);
+	if (learned)
+		{
+			size_t n_learned = n_learned_suggs;
+			learned_suggs = enchant_dict_take_suggestions(learned, n_learned, &n_learned_suggs);
+			n_learned_suggs = enchant_dict_keep_good_suggestions(dict, learned_suggs, n_learned_suggs);
+			n_learned_suggs = enchant_dict_limit_suggestions(learned_suggs, n_learned_suggs, bounds->max_suggs);
+			confident = confident && n_learned_suggs == n_learned;
+			if (confident)
+				{
+					enchant_stats_add (&session->stats, ENCHANT_STAT_SUGGESTS_LEARNED, 1);
+					n_learned_suggs = enchant_dict_limit_suggestions(learned_suggs, n_learned_suggs, 1);
+				}
+		}
+
+	/* Check for suggestions from provider dictionary, telling it about
+	 * the limits if it can make use of them, and from the other
+	 * providers it fans out to meanwhile */
+	if (!confident && dict->suggest && !enchant_suggest_bounds_reached ((gpointer) bounds))
+		{
+			char **provider_suggs;
+			EnchantFanoutCall *fanout = enchant_session_start_fanout (session, word, len, bounds);
+
+			/* the store holds the provider's full lists, as it alone
+			 * makes them */
+			EnchantSuggestStore *store = g_atomic_pointer_get (&session->suggest_store);
+			if (fanout || enchant_suggest_bounds_limit_results (bounds))
+				store = NULL;
+
+			if (store && enchant_suggest_store_lookup (store, word, len, &provider_suggs, &n_dict_suggs))
+				enchant_stats_add (&session->stats, ENCHANT_STAT_SUGGESTS_STORED, 1);
+			else
+				{
+					EnchantDict *checker = enchant_session_acquire_dict (session, dict);
+					g_private_set (&enchant_provider_suggest_partial, NULL);
+					EnchantTrace trace;
+					enchant_trace_enter (&trace, "provider_suggest", session->language_tag, session->provider, len);
+					gint64 start = g_get_monotonic_time ();
+					if (session->dict_extended && checker->suggest_bounded &&
+					    enchant_suggest_bounds_limit_results (bounds))
+						provider_suggs = (*checker->suggest_bounded) (checker, word, len, bounds->max_suggs,
+											      bounds->max_distance,
+											      enchant_suggest_bounds_timeout (bounds),
+											      &n_dict_suggs);
+					else
+						provider_suggs = (*checker->suggest) (checker, word, len, &n_dict_suggs);
+					enchant_stats_add_latency (&session->stats, ENCHANT_STAT_PROVIDER_SUGGESTS, start);
+					enchant_trace_leave (&trace);
+					partial = g_private_get (&enchant_provider_suggest_partial) != NULL;
+					enchant_session_release_dict (session, dict, checker);
+					if (store && !partial && enchant_session_get_error (session) == NULL)
+						enchant_suggest_store_add (store, word, len, provider_suggs,
+									   provider_suggs ? n_dict_suggs : 0);
+				}
+			if (fanout)
+				{
+					gboolean complete;
+					provider_suggs = enchant_fanout_call_finish (fanout, provider_suggs,
+										     &n_dict_suggs, &complete);
+					/* what a provider left behind would have added is missing */
+					partial = partial || !complete;
+				}
+			if (provider_suggs)
+				{
+					dict_suggs = enchant_dict_take_suggestions(provider_suggs, n_dict_suggs, &n_dict_suggs);
+					n_dict_suggs = enchant_dict_keep_good_suggestions(dict, dict_suggs, n_dict_suggs);
+					n_dict_suggs = enchant_dict_limit_suggestions(dict_suggs, n_dict_suggs, bounds->max_suggs);
+				}
+		}
+
+	/* Check for suggestions from personal dictionary, as many as there
+	 * is room left for */
+	size_t max_pwl_suggs = bounds->max_suggs == 0 ? ENCHANT_PWL_MAX_SUGGS : bounds->max_suggs - n_dict_suggs;
+	if (!confident && max_pwl_suggs != 0 && !enchant_suggest_bounds_reached ((gpointer) bounds))
+		{
+			EnchantPWLStop stop = { enchant_suggest_bounds_reached, (gpointer) bounds };
+			gboolean stoppable = bounds->deadline != G_MAXINT64 || bounds->cancelled;
+
+			pwl_suggs = enchant_pwl_suggest(enchant_session_get_personal (session), &query, dict_suggs, n_dict_suggs,
+							max_pwl_suggs, bounds->max_distance,
+							stoppable ? &stop : NULL, &n_pwl_suggs);
+			n_pwl_suggs = enchant_dict_keep_good_suggestions(dict, pwl_suggs, n_pwl_suggs);
+		}
+
+	/* Merge suggestions, if any, keeping the learned ones first and then
+	 * the provider's, into the one block handed out */
+	char **suggs = NULL;
+	size_t n_suggs = n_learned_suggs + n_pwl_suggs + n_dict_suggs;
+	if (n_suggs > 0)
+		{
+			GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+			char **merged = g_newa (char *, n_suggs);
+			n_suggs = enchant_dict_merge_suggestions(seen, merged, 0, learned_suggs, n_learned_suggs);
+			n_suggs = enchant_dict_merge_suggestions(seen, merged, n_suggs, dict_suggs, n_dict_suggs);
+			n_suggs = enchant_dict_merge_suggestions(seen, merged, n_suggs, pwl_suggs, n_pwl_suggs);
+			g_hash_table_destroy (seen);
+			if (bounds->max_suggs != 0 && n_suggs > bounds->max_suggs)
+				n_suggs = bounds->max_suggs;
+			suggs = enchant_strv_pack (merged, n_suggs, TRUE);
+		}
+
+	enchant_dict_free_suggestions (learned_suggs, n_learned_suggs);
+	enchant_dict_free_suggestions (dict_suggs, n_dict_suggs);
+	enchant_dict_free_suggestions (pwl_suggs, n_pwl_suggs);
+	enchant_suggestion_clear (&query);
+
+	/* an empty list stands for no suggestions; what a search cut short
+	 * found is not worth keeping */
+	partial = partial || enchant_suggest_bounds_reached ((gpointer) bounds);
+	if (partial)
+		g_private_set (&enchant_suggest_partial, GUINT_TO_POINTER (session->id + 1));
+	else if (cached && enchant_session_get_error (session) == NULL)
+		enchant_word_cache_store (&session->suggest_cache, word, len, &stamp,
+					  enchant_strv_pack (suggs, n_suggs, FALSE));
+
+	if (out_n_suggs)
+		*out_n_suggs = n_suggs;
+
+	return suggs;
+}
+
+static char **
+enchant_dict_suggest_within (EnchantDict * dict, const char *const word, size_t len,
+			     const EnchantSuggestBounds * bounds, size_t * out_n_suggs)
+{
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	EnchantTrace trace;
+	enchant_trace_enter (&trace, "suggest", session->language_tag, session->provider, len);
+	char **suggs = _enchant_dict_suggest_within (dict, word, len, bounds, out_n_suggs);
+	enchant_trace_leave (&trace);
+	return suggs;
+}
+
+char **
+enchant_dict_suggest (EnchantDict * dict, const char *const word, ssize_t len, size_t * out_n_suggs)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (word, NULL);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, NULL);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL), NULL);
+
+	return enchant_dict_suggest_within (dict, word, len, &enchant_suggest_unbounded, out_n_suggs);
+}
+
+char **
+enchant_dict_suggest_bounded (EnchantDict * dict, const char *const word, ssize_t len,
+			      size_t max_suggs, int max_distance, int timeout_ms,
+			      size_t * out_n_suggs)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (word, NULL);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, NULL);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL), NULL);
+
+	EnchantSuggestBounds bounds;
+	enchant_suggest_bounds_init (&bounds, max_suggs, max_distance, timeout_ms);
+	return enchant_dict_suggest_within (dict, word, len, &bounds, out_n_suggs);
+}
+
+static int
+enchant_session_accept_completion (const char * const word, void * data)
+{
+	return !enchant_session_exclude ((EnchantSession *) data, word, strlen (word));
+}
+
+char **
+enchant_dict_complete (EnchantDict * dict, const char *const prefix, ssize_t len,
+		       size_t max_words, size_t * out_n_words)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (prefix, NULL);
+
+	if (len < 0)
+		len = strlen (prefix);
+
+	g_return_val_if_fail (enchant_utf8_validate(prefix, len, NULL), NULL);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	/* a prefix without capitals completes to words of any case, as
+	 * editors' completion does */
+	gboolean fold = enchant_case_shape (prefix, len) == ENCHANT_CASE_LOWER;
+	EnchantPWLAccept accept = { enchant_session_accept_completion, session };
+	size_t n_words = 0;
+	char **words = enchant_pwl_complete (enchant_session_get_personal (session), prefix, len, fold,
+					     max_words, &accept, &n_words);
+
+	char **completions = n_words ? enchant_strv_pack (words, n_words, TRUE) : NULL;
+	g_strfreev (words);
+	if (out_n_words)
+		*out_n_words = n_words;
+	return completions;
+}
+
+/* one of the words of enchant_dict_suggest_batch */
+typedef struct str_enchant_suggest_task
+{
+	EnchantDict *dict;
+	const char *word;
+	size_t len;
+	char **suggs;
+	size_t n_suggs;
+	char *error;	/* errors are kept per thread, so the caller's takes this over */
+} EnchantSuggestTask;
+
+static void
+enchant_suggest_task_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantSuggestTask *task = data;
+	EnchantSession * session = ((EnchantDictPrivateData*)task->dict->enchant_private_data)->session;
+
+	task->suggs = enchant_dict_suggest (task->dict, task->word, task->len, &task->n_suggs);
+	task->error = g_strdup (enchant_session_get_error (session));
+	enchant_session_clear_error (session);
+}
+
+/* packs the tasks' suggestions into one block: the lists first, then
+ * their words, then the words' text; frees the tasks' own lists */
+static char ***
+enchant_suggest_tasks_pack (EnchantSuggestTask * tasks, size_t n_tasks, size_t * out_n_suggs)
+{
+	size_t n_ptrs = n_tasks, n_bytes = 0;
+	for (size_t i = 0; i < n_tasks; i++)
+		if (tasks[i].suggs)
+			{
+				n_ptrs += tasks[i].n_suggs + 1;
+				for (size_t j = 0; j < tasks[i].n_suggs; j++)
+					n_bytes += strlen (tasks[i].suggs[j]) + 1;
+			}
+
+	char *block = enchant_result_alloc (n_ptrs * sizeof (char *) + n_bytes);
+	char ***lists = (char ***) block;
+	char **words = (char **) (block + n_tasks * sizeof (char **));
+	char *text = block + n_ptrs * sizeof (char *);
+	for (size_t i = 0; i < n_tasks; i++)
+		{
+			if (out_n_suggs)
+				out_n_suggs[i] = tasks[i].suggs ? tasks[i].n_suggs : 0;
+			if (tasks[i].suggs == NULL)
+				{
+					lists[i] = NULL;
+					continue;
+				}
+
+			lists[i] = words;
+			for (size_t j = 0; j < tasks[i].n_suggs; j++)
+				{
+					size_t len = strlen (tasks[i].suggs[j]) + 1;
+					memcpy (text, tasks[i].suggs[j], len);
+					*words++ = text;
+					text += len;
+				}
+			*words++ = NULL;
+			enchant_result_free (tasks[i].suggs);
+		}
+
+	return lists;
+}
+
+/* packs the tasks' suggestions as an EnchantPackedWords: the header,
+ * the list starts, the offsets, then the text; frees the tasks' own
+ * lists */
+static EnchantPackedWords *
+enchant_suggest_tasks_pack_flat (EnchantSuggestTask * tasks, size_t n_tasks)
+{
+	size_t n_words = 0, n_bytes = 0;
+	for (size_t i = 0; i < n_tasks; i++)
+		if (tasks[i].suggs)
+			{
+				n_words += tasks[i].n_suggs;
+				for (size_t j = 0; j < tasks[i].n_suggs; j++)
+					n_bytes += strlen (tasks[i].suggs[j]) + 1;
+			}
+
+	size_t n_offsets = (n_tasks + 1) + (n_words + 1);
+	char *block = enchant_result_alloc (sizeof (EnchantPackedWords) + n_offsets * sizeof (uint32_t) + n_bytes);
+	EnchantPackedWords *packed = (EnchantPackedWords *) block;
+	uint32_t *list_starts = (uint32_t *) (block + sizeof (EnchantPackedWords));
+	uint32_t *offsets = list_starts + n_tasks + 1;
+	char *bytes = (char *) (offsets + n_words + 1);
+
+	packed->n_lists = n_tasks;
+	packed->n_words = n_words;
+	packed->list_starts = list_starts;
+	packed->offsets = offsets;
+	packed->bytes = bytes;
+
+	uint32_t word = 0, offset = 0;
+	for (size_t i = 0; i < n_tasks; i++)
+		{
+			list_starts[i] = word;
+			for (size_t j = 0; tasks[i].suggs && j < tasks[i].n_suggs; j++)
+				{
+					size_t len = strlen (tasks[i].suggs[j]) + 1;
+					memcpy (bytes + offset, tasks[i].suggs[j], len);
+					offsets[word++] = offset;
+					offset += len;
+				}
+			enchant_result_free (tasks[i].suggs);
+		}
+	list_starts[n_tasks] = word;
+	offsets[n_words] = offset;
+
+	return packed;
+}
+
+/* finds the suggestions of enchant_dict_suggest_batch and
+ * enchant_dict_suggest_packed, one task per word, to be packed */
+static EnchantSuggestTask *
+enchant_dict_run_suggest_tasks (EnchantDict * dict, const char *const *words,
+				const ssize_t *lens, size_t n_words)
+{
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	EnchantSuggestTask *tasks = g_new0 (EnchantSuggestTask, n_words);
+	size_t n_valid_words = 0;
+	for (size_t i = 0; i < n_words; i++)
+		{
+			tasks[i].dict = dict;
+			tasks[i].word = words[i];
+			tasks[i].len = words[i] == NULL ? 0 : lens && lens[i] >= 0 ? (size_t) lens[i] : strlen (words[i]);
+			if (tasks[i].len != 0 && enchant_utf8_validate (tasks[i].word, tasks[i].len, NULL))
+				n_valid_words++;
+			else
+				tasks[i].len = 0;
+		}
+
+	/* a provider that has to take turns would make the workers queue up */
+	if (n_valid_words > 1 && !session->serialize_provider)
+		{
+			EnchantTaskGroup group = { 0 };
+			for (size_t i = 0; i < n_words; i++)
+				if (tasks[i].len != 0)
+					enchant_broker_submit (session->broker, enchant_suggest_task_run, &tasks[i], &group);
+			enchant_broker_wait_tasks (session->broker, &group);
+		}
+	else
+		for (size_t i = 0; i < n_words; i++)
+			if (tasks[i].len != 0)
+				enchant_suggest_task_run (&tasks[i], NULL);
+
+	/* report the first error any of the words ran into */
+	for (size_t i = 0; i < n_words; i++)
+		if (tasks[i].error)
+			{
+				if (enchant_session_get_error (session) == NULL)
+					enchant_session_set_error (session, tasks[i].error);
+				else
+					g_free (tasks[i].error);
+			}
+
+	return tasks;
+}
+
+char ***
+enchant_dict_suggest_batch (EnchantDict * dict, const char *const *words,
+			    const ssize_t *lens, size_t n_words, size_t * out_n_suggs)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (words || n_words == 0, NULL);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	if (n_words == 0)
+		return NULL;
+
+	EnchantSuggestTask *tasks = enchant_dict_run_suggest_tasks (dict, words, lens, n_words);
+	char ***suggs_list = enchant_suggest_tasks_pack (tasks, n_words, out_n_suggs);
+	g_free (tasks);
+	return suggs_list;
+}
+
+EnchantPackedWords *
+enchant_dict_suggest_packed (EnchantDict * dict, const char *const *words,
+			     const ssize_t *lens, size_t n_words)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (words || n_words == 0, NULL);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	EnchantSuggestTask *tasks = n_words ? enchant_dict_run_suggest_tasks (dict, words, lens, n_words) : NULL;
+	EnchantPackedWords *packed = enchant_suggest_tasks_pack_flat (tasks, n_words);
+	g_free (tasks);
+	return packed;
+}
+
+/* held by the caller until enchant_dict_free_suggest_request, and by
+ * the thread working on it until it has called back */
+struct str_enchant_suggest_request
+{
+	gint ref_count;
+	gint cancelled;
+	EnchantSuggestBounds bounds;	/* with the deadline, and cancelled */
+
+	EnchantDict *dict;
+	char *word;
+	size_t len;
+	EnchantSuggestFn fn;
+	void *user_data;
+};
+
+static void
+enchant_suggest_request_unref (EnchantSuggestRequest * request)
+{
+	if (g_atomic_int_dec_and_test (&request->ref_count))
+		{
+			g_free (request->word);
+			g_free (request);
+		}
+}
+
+static void
+enchant_suggest_request_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantSuggestRequest *request = data;
+	EnchantSession * session = ((EnchantDictPrivateData*)request->dict->enchant_private_data)->session;
+
+	char **suggs = NULL;
+	size_t n_suggs = 0;
+	if (!g_atomic_int_get (&request->cancelled))
+		suggs = enchant_dict_suggest_within (request->dict, request->word, request->len,
+						     &request->bounds, &n_suggs);
+	if (g_atomic_int_get (&request->cancelled))
+		{
+			enchant_result_free (suggs);
+			suggs = NULL;
+			n_suggs = 0;
+		}
+	enchant_session_clear_error (session);
+
+	(*request->fn) (request->dict, suggs, n_suggs, request->user_data);
+	enchant_suggest_request_unref (request);
+}
+
+EnchantSuggestRequest *
+enchant_dict_suggest_async (EnchantDict * dict, const char *const word, ssize_t len,
+			    int timeout_ms, EnchantSuggestFn fn, void * user_data)
+{
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (word, NULL);
+	g_return_val_if_fail (fn, NULL);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, NULL);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL), NULL);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	EnchantSuggestRequest *request = g_new0 (EnchantSuggestRequest, 1);
+	request->ref_count = 2;
+	enchant_suggest_bounds_init (&request->bounds, 0, -1, timeout_ms);
+	request->bounds.cancelled = &request->cancelled;
+	request->dict = dict;
+	request->word = g_strndup (word, len);
+	request->len = len;
+	request->fn = fn;
+	request->user_data = user_data;
+
+	enchant_broker_submit (session->broker, enchant_suggest_request_run, request, NULL);
+	return request;
+}
+
+void
+enchant_dict_cancel_suggest (EnchantDict * dict, EnchantSuggestRequest * request)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (request);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	g_atomic_int_set (&request->cancelled, 1);
+}
+
+void
+enchant_dict_free_suggest_request (EnchantDict * dict, EnchantSuggestRequest * request)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (request);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_suggest_request_unref (request);
+}
+
+/* A suggestion worked out ahead of time, at low priority, for the
+ * suggest cache to have when it is asked for.  The misspellings the
+ * text checking functions find are prefetched up to max_prefetches at
+ * a time; those found in a text are cancelled when the text changes,
+ * and all of them when the dictionary is freed. */
+typedef struct str_enchant_prefetch
+{
+	gint cancelled;
+	EnchantSuggestBounds bounds;	/* with cancelled */
+
+	EnchantDict *dict;
+	char *word;
+	size_t len;
+	gconstpointer text;	/* the EnchantTextChecker it was found by, or NULL for enchant_dict_check_text */
+} EnchantPrefetch;
+
+static void
+enchant_prefetch_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantPrefetch *prefetch = data;
+	EnchantSession * session = ((EnchantDictPrivateData*)prefetch->dict->enchant_private_data)->session;
+
+	/* what is cut short is not cached, and no more is wanted of it */
+	if (!g_atomic_int_get (&prefetch->cancelled))
+		{
+			EnchantWordCacheStamp stamp;
+			enchant_session_get_stamp (session, TRUE, &stamp);
+			if (!enchant_word_cache_contains (&session->suggest_cache, prefetch->word, prefetch->len, &stamp))
+				enchant_result_free (enchant_dict_suggest_within (prefetch->dict, prefetch->word, prefetch->len,
+										  &prefetch->bounds, NULL));
+		}
+	enchant_session_clear_error (session);
+
+	g_mutex_lock (&session->prefetch_lock);
+	g_ptr_array_remove_fast (session->prefetches, prefetch);
+	g_mutex_unlock (&session->prefetch_lock);
+	g_free (prefetch->word);
+	g_free (prefetch);
+}
+
+/* queues the suggestions for a misspelling found in text to be
+ * prefetched, if dict prefetches them and there is room */
+static void
+enchant_session_prefetch (EnchantSession * session, EnchantDict * dict,
+			  const char *const word, size_t len, gconstpointer text)
+{
+	/* only a hint, as in _enchant_dict_suggest_within */
+	if (session->suggest_cache.size == 0 || session->broker == NULL)
+		return;
+
+	g_mutex_lock (&session->prefetch_lock);
+	gboolean wanted = session->prefetches->len < session->max_prefetches;
+	for (guint i = 0; wanted && i < session->prefetches->len; i++)
+		{
+			EnchantPrefetch *other = g_ptr_array_index (session->prefetches, i);
+			wanted = g_atomic_int_get (&other->cancelled) ||
+				other->len != len || memcmp (other->word, word, len) != 0;
+		}
+	if (!wanted)
+		{
+			g_mutex_unlock (&session->prefetch_lock);
+			return;
+		}
+
+	EnchantPrefetch *prefetch = g_new0 (EnchantPrefetch, 1);
+	enchant_suggest_bounds_init (&prefetch->bounds, 0, -1, -1);
+	prefetch->bounds.cancelled = &prefetch->cancelled;
+	prefetch->dict = dict;
+	prefetch->word = g_strndup (word, len);
+	prefetch->len = len;
+	prefetch->text = text;
+	g_ptr_array_add (session->prefetches, prefetch);
+	g_mutex_unlock (&session->prefetch_lock);
+
+	enchant_broker_submit_background (session->broker, enchant_prefetch_run, prefetch,
+					  session->prefetch_group);
+}
+
+/* cancels the prefetches of the misspellings found in text */
+static void
+enchant_session_cancel_prefetches (EnchantSession * session, gconstpointer text)
+{
+	g_mutex_lock (&session->prefetch_lock);
+	for (guint i = 0; i < session->prefetches->len; i++)
+		{
+			EnchantPrefetch *prefetch = g_ptr_array_index (session->prefetches, i);
+			if (prefetch->text == text)
+				g_atomic_int_set (&prefetch->cancelled, 1);
+		}
+	g_mutex_unlock (&session->prefetch_lock);
+}
+
+/* cancels every prefetch and waits for them, doing those not started
+ * yet itself */
+static void
+enchant_session_stop_prefetches (EnchantSession * session)
+{
+	g_mutex_lock (&session->prefetch_lock);
+	session->max_prefetches = 0;
+	for (guint i = 0; i < session->prefetches->len; i++)
+		g_atomic_int_set (&((EnchantPrefetch *) g_ptr_array_index (session->prefetches, i))->cancelled, 1);
+	g_mutex_unlock (&session->prefetch_lock);
+
+	if (session->broker)
+		enchant_broker_wait_tasks (session->broker, session->prefetch_group);
+}
+
+void
+enchant_dict_set_suggest_prefetch (EnchantDict * dict, size_t max_pending)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	g_mutex_lock (&session->prefetch_lock);
+	session->max_prefetches = (guint) MIN (max_pending, G_MAXUINT);
+	g_mutex_unlock (&session->prefetch_lock);
+}
+
+void
+enchant_dict_add (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (word);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_if_fail (len);
+	g_return_if_fail (enchant_utf8_validate(word, len, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	if (enchant_session_refuse_changes (session))
+		return;
+
+	enchant_session_add_personal (session, word, len);
+	enchant_session_remove_exclude (session, word, len);
+
+	if (dict->add_to_personal)
+		{
+			enchant_session_lock_provider (session);
+			(*dict->add_to_personal) (dict, word, len);
+			enchant_session_unlock_provider (session);
+			enchant_session_changed (session);
+		}
+}
+
+void
+enchant_dict_add_many (EnchantDict * dict, const char *const *words, size_t n_words)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (words || n_words == 0);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	if (enchant_session_refuse_changes (session))
+		return;
+
+	/* skip the words enchant_dict_add would refuse */
+	const char **valid_words = g_new (const char *, n_words + 1);
+	size_t n_valid_words = 0;
+	for (size_t i = 0; i < n_words; i++)
+		if (words[i] && *words[i] && enchant_utf8_validate (words[i], -1, NULL))
+			valid_words[n_valid_words++] = words[i];
+
+	enchant_session_add_personal_many (session, valid_words, n_valid_words);
+	for (size_t i = 0; i < n_valid_words; i++)
+		{
+			size_t len = strlen (valid_words[i]);
+			enchant_session_remove_exclude (session, valid_words[i], len);
+
+			if (dict->add_to_personal)
+				{
+					enchant_session_lock_provider (session);
+					(*dict->add_to_personal) (dict, valid_words[i], len);
+					enchant_session_unlock_provider (session);
+				}
+		}
+	if (dict->add_to_personal)
+		enchant_session_changed (session);
+	g_free (valid_words);
+}
+
+void
+enchant_dict_add_to_session (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (word);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_if_fail (len);
+	g_return_if_fail (enchant_utf8_validate(word, len, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	enchant_session_add (session, word, len);
+	if (dict->add_to_session)
+		{
+			enchant_session_lock_provider (session);
+			(*dict->add_to_session) (dict, word, len);
+			enchant_session_unlock_provider (session);
+			enchant_session_changed (session);
+		}
+}
+
+int
+enchant_dict_is_added (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_val_if_fail (dict, 0);
+	g_return_val_if_fail (word, 0);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, 0);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL), 0);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	return enchant_session_contains (session, word, len);
+}
+
+void
+enchant_dict_remove (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (word);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_if_fail (len);
+	g_return_if_fail (enchant_utf8_validate(word, len, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	if (enchant_session_refuse_changes (session))
+		return;
+
+	enchant_session_remove_personal (session, word, len);
+	enchant_session_add_exclude(session, word, len);
+
+	if (dict->add_to_exclude)
+		{
+			enchant_session_lock_provider (session);
+			(*dict->add_to_exclude) (dict, word, len);
+			enchant_session_unlock_provider (session);
+			enchant_session_changed (session);
+		}
+}
+
+void
+enchant_dict_remove_from_session (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (word);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_if_fail (len);
+	g_return_if_fail (enchant_utf8_validate(word, len, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	enchant_session_remove (session, word, len);
+}
+
+int
+enchant_dict_is_removed (EnchantDict * dict, const char *const word, ssize_t len)
+{
+	g_return_val_if_fail (dict, 0);
+	g_return_val_if_fail (word, 0);
+
+	if (len < 0)
+		len = strlen (word);
+
+	g_return_val_if_fail (len, 0);
+	g_return_val_if_fail (enchant_utf8_validate(word, len, NULL), 0);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	return enchant_session_exclude (session, word, len);
+}
+
+void
+enchant_dict_store_replacement (EnchantDict * dict,
+				const char *const mis, ssize_t mis_len,
+				const char *const cor, ssize_t cor_len)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (mis);
+	g_return_if_fail (cor);
+
+	if (mis_len < 0)
+		mis_len = strlen (mis);
+
+	if (cor_len < 0)
+		cor_len = strlen (cor);
+
+	g_return_if_fail (mis_len);
+	g_return_if_fail (cor_len);
+
+	g_return_if_fail (enchant_utf8_validate(mis, mis_len, NULL));
+	g_return_if_fail (enchant_utf8_validate(cor, cor_len, NULL));
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	/* the provider may make use of it as well */
+	if (dict->store_replacement)
+		{
+			enchant_session_lock_provider (session);
+			(*dict->store_replacement) (dict, mis, mis_len, cor, cor_len);
+			enchant_session_unlock_provider (session);
+		}
+	enchant_session_store_replacement (session, mis, mis_len, cor, cor_len);
+	enchant_session_changed (session);
+}
+
+int
+enchant_dict_set_pwl_suggest_engine (EnchantDict * dict, const char *const engine)
+{
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (engine, -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	EnchantPWLSuggestEngine pwl_engine;
+	if (strcmp (engine, "trie") == 0)
+		pwl_engine = ENCHANT_PWL_SUGGEST_TRIE;
+	else if (strcmp (engine, "deletions") == 0)
+		pwl_engine = ENCHANT_PWL_SUGGEST_DELETIONS;
+	else if (strcmp (engine, "parallel") == 0)
+		pwl_engine = ENCHANT_PWL_SUGGEST_PARALLEL;
+	else
+		{
+			enchant_session_set_error (session, g_strdup_printf ("unknown suggestion engine \"%s\"", engine));
+			return -1;
+		}
+
+	enchant_pwl_set_suggest_engine (enchant_session_get_personal (session), pwl_engine);
+	return 0;
+}
+
+/* whether the provider's dictionary can be told a suggestion profile */
+static gboolean
+enchant_session_has_suggest_profiles (EnchantSession * session, EnchantDict * dict)
+{
+	return session->provider && enchant_provider_get_abi_version (session->provider) >= 3 &&
+		dict->set_suggest_profile;
+}
+
+int
+enchant_dict_set_suggest_profile (EnchantDict * dict, const char *const profile)
+{
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (profile, -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	if (strcmp (profile, "fast") != 0 && strcmp (profile, "balanced") != 0 &&
+	    strcmp (profile, "thorough") != 0)
+		{
+			enchant_session_set_error (session, g_strdup_printf ("unknown suggestion profile \"%s\"", profile));
+			return -1;
+		}
+
+	/* set while no thread is suggesting, and the clones, made with the
+	 * profile before, are let go */
+	g_rw_lock_writer_lock (&session->swap_lock);
+	int result = 0;
+	if (enchant_session_has_suggest_profiles (session, dict))
+		{
+			result = (*dict->set_suggest_profile) (dict, profile);
+			enchant_session_dispose_idle_clones (session);
+		}
+	if (result == 0)
+		{
+			g_free (session->suggest_profile);
+			session->suggest_profile = g_strdup (profile);
+		}
+	g_rw_lock_writer_unlock (&session->swap_lock);
+
+	if (result != 0)
+		{
+			if (enchant_session_get_error (session) == NULL)
+				enchant_session_set_error (session, g_strdup_printf ("suggestion profile \"%s\" not supported", profile));
+			return -1;
+		}
+
+	/* the suggestions cached were found with the one before */
+	enchant_session_changed (session);
+	return 0;
+}
+
+int
+enchant_dict_set_pwl_frequencies (EnchantDict * dict, const char *const filename)
+{
+	g_return_val_if_fail (dict, -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	if (enchant_pwl_set_frequencies (enchant_session_get_personal (session), filename) != 0)
+		{
+			enchant_session_set_error (session, g_strdup_printf ("Couldn't read word frequencies from '%s'", filename));
+			return -1;
+		}
+	return 0;
+}
+
+void
+enchant_dict_set_check_cache_size (EnchantDict * dict, size_t n_words)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_word_cache_resize (&session->check_cache, n_words);
+}
+
+void
+enchant_dict_set_suggest_cache_size (EnchantDict * dict, size_t n_words)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_word_cache_resize (&session->suggest_cache, n_words);
+}
+
+void
+enchant_dict_get_suggest_cache_stats (EnchantDict * dict, size_t * n_hits, size_t * n_misses)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	g_mutex_lock (&session->suggest_cache.lock);
+	if (n_hits)
+		*n_hits = session->suggest_cache.n_hits;
+	if (n_misses)
+		*n_misses = session->suggest_cache.n_misses;
+	g_mutex_unlock (&session->suggest_cache.lock);
+}
+
+int
+enchant_dict_set_suggest_store (EnchantDict * dict, size_t max_words)
+{
+	g_return_val_if_fail (dict, -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	EnchantSuggestStore *store = g_atomic_pointer_get (&session->suggest_store);
+	if (max_words == 0)
+		{
+			if (store)
+				{
+					g_mutex_lock (&store->lock);
+					store->max_words = 0;
+					enchant_suggest_store_clear (store);
+					g_mutex_unlock (&store->lock);
+				}
+			return 0;
+		}
+
+	/* a backend that learns words makes suggestions nothing on disk
+	 * tells apart */
+	if (session->provider == NULL || dict->add_to_personal || dict->add_to_session ||
+	    dict->add_to_exclude || dict->store_replacement)
+		{
+			enchant_session_set_error (session, g_strdup ("the suggestions of this dictionary cannot be stored"));
+			return -1;
+		}
+
+	char *header = enchant_session_suggest_store_header (session);
+	char *config_dir = enchant_get_user_config_dir ();
+	if (header == NULL || config_dir == NULL)
+		{
+			enchant_session_set_error (session, g_strdup ("the suggestions of this dictionary cannot be stored"));
+			g_free (header);
+			g_free (config_dir);
+			return -1;
+		}
+
+	if (store == NULL)
+		{
+			char *name = g_strdup_printf ("%s.%s", session->language_tag,
+						      (*session->provider->identify) (session->provider));
+			store = g_new0 (EnchantSuggestStore, 1);
+			g_mutex_init (&store->lock);
+			store->filename = g_build_filename (config_dir, "suggestions", name, NULL);
+			g_free (name);
+			if (!g_atomic_pointer_compare_and_exchange (&session->suggest_store, NULL, store))
+				{
+					enchant_suggest_store_free (store);
+					store = g_atomic_pointer_get (&session->suggest_store);
+				}
+		}
+	g_free (config_dir);
+
+	/* the dictionaries may have changed since it was last opened */
+	g_mutex_lock (&store->lock);
+	store->max_words = max_words;
+	enchant_suggest_store_load (store, header);
+	g_mutex_unlock (&store->lock);
+	g_free (header);
+
+	return 0;
+}
+
+void
+enchant_dict_get_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (fn);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	guint64 totals[ENCHANT_N_STATS] = { 0 };
+	enchant_session_sum_stats (session, totals);
+	enchant_stats_report (totals, fn, user_data);
+}
+
+/* A hook for the tests, left out of enchant.h on purpose: reports like
+ * enchant_dict_get_stats "pwl_suggest_nodes", the trie nodes the
+ * searches of @dict's word lists for suggestions visited, and
+ * "pwl_file_polls", the system calls made to tell whether their files
+ * changed.  Neither depends on how fast the machine is, which is what
+ * tests/bench/enchant_regress.cpp needs. */
+ENCHANT_MODULE_EXPORT
+void enchant_dict_get_work_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
+void
+enchant_dict_get_work_stats (EnchantDict * dict, EnchantStatsFn fn, void * user_data)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (fn);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	uint64_t n_nodes_visited = 0, n_file_polls = 0;
+	EnchantPWL *lists[] = { g_atomic_pointer_get (&session->personal),
+				g_atomic_pointer_get (&session->exclude) };
+	for (guint i = 0; i < G_N_ELEMENTS (lists); i++)
+		if (lists[i])
+			{
+				uint64_t nodes, polls;
+				enchant_pwl_get_work_stats (lists[i], &nodes, &polls);
+				n_nodes_visited += nodes;
+				n_file_polls += polls;
+			}
+
+	(*fn) ("pwl_suggest_nodes", n_nodes_visited, user_data);
+	(*fn) ("pwl_file_polls", n_file_polls, user_data);
+}
+
+static void
+enchant_dict_sum_memory (EnchantDict * dict, GHashTable * seen, guint64 * totals)
+{
+	EnchantDictPrivateData *enchant_dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	enchant_session_sum_memory (enchant_dict_private_data->session, seen, totals);
+	for (size_t i = 0; i < enchant_dict_private_data->n_members; i++)
+		enchant_dict_sum_memory (enchant_dict_private_data->members[i], seen, totals);
+}
+
+uint64_t
+enchant_dict_get_memory_usage (EnchantDict * dict, EnchantStatsFn fn, void * user_data)
+{
+	g_return_val_if_fail (dict, 0);
+
+	GHashTable *seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	guint64 totals[ENCHANT_N_MEMORY] = { 0 };
+	enchant_dict_sum_memory (dict, seen, totals);
+	g_hash_table_destroy (seen);
+	return enchant_memory_report (totals, fn, user_data);
+}
+
+void
+enchant_dict_free_string_list (EnchantDict * dict, char **string_list)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_result_free (string_list);
+}
+
+void
+enchant_dict_free_suggest_batch (EnchantDict * dict, char ***suggs_list)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_result_free (suggs_list);
+}
+
+void
+enchant_dict_free_packed_words (EnchantDict * dict, EnchantPackedWords * packed)
+{
+	g_return_if_fail (dict);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	enchant_result_free (packed);
+}
+
+void
+enchant_dict_describe (EnchantDict * dict, EnchantDictDescribeFn fn, void * user_data)
+{
+	g_return_if_fail (dict);
+	g_return_if_fail (fn);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+	EnchantProvider * provider = session->provider;
+
+	const char * name, * desc, * file;
+	if (provider)
+		{
+			EnchantProviderModule *pm = (EnchantProviderModule *) provider->enchant_private_data;
+			file = g_module_name (pm->module);
+			name = (*provider->identify) (provider);
+			desc = (*provider->describe) (provider);
+		}
+	else
+		{
+			file = session->personal_filename;
+			name = "Personal Wordlist";
+			desc = "Personal Wordlist";
+		}
+
+	const char *tag = session->language_tag;
+	(*fn) (tag, name, desc, file, user_data);
+}
+
+/***********************************************************************************/
 /***********************************************************************************/
-/***********************************************************************************/
 
-static void
-enchant_broker_clear_error (EnchantBroker * broker)
+static void
+enchant_broker_clear_error (EnchantBroker * broker)
+{
+	enchant_errors_clear (broker->errors);
+}
+
+static void
+enchant_broker_set_error (EnchantBroker * broker, const char * const err)
+{
+	enchant_errors_set (broker->errors, g_strdup (err));
+}
+
+/* Whether the provider's module was built with the extension members
+ * of EnchantProvider and EnchantDict, which are past the end of the
+ * structures of one built before them */
+static unsigned int
+enchant_provider_get_abi_version (EnchantProvider * provider)
+{
+	EnchantProviderModule *pm = (EnchantProviderModule *) provider->enchant_private_data;
+	return pm->abi_version;
+}
+
+static gboolean
+enchant_provider_has_extensions (EnchantProvider * provider)
+{
+	return enchant_provider_get_abi_version (provider) >= 1;
+}
+
+static gboolean
+enchant_provider_is_thread_safe (EnchantProvider * provider)
+{
+	return enchant_provider_has_extensions (provider) &&
+		(provider->flags & ENCHANT_PROVIDER_THREAD_SAFE);
+}
+
+/* the broker-level calls of providers that do not declare
+ * ENCHANT_PROVIDER_THREAD_SAFE are made by one thread at a time */
+static void
+enchant_provider_lock (EnchantProvider * provider)
+{
+	if (!enchant_provider_is_thread_safe (provider))
+		g_mutex_lock (&provider->owner->provider_lock);
+}
+
+static void
+enchant_provider_unlock (EnchantProvider * provider)
+{
+	if (!enchant_provider_is_thread_safe (provider))
+		g_mutex_unlock (&provider->owner->provider_lock);
+}
+
+static int
+enchant_provider_is_valid(EnchantProvider * provider)
+{
+	if (provider == NULL)
+		g_warning ("EnchantProvider cannot be NULL\n");
+	else if (provider->identify == NULL)
+		g_warning ("EnchantProvider's identify method cannot be NULL\n");
+	else if (!g_utf8_validate((*provider->identify)(provider), -1, NULL))
+		g_warning ("EnchantProvider's identify method does not return valid UTF-8.\n");
+	else if (provider->describe == NULL)
+		g_warning ("EnchantProvider's describe method cannot be NULL\n");
+	else if (!g_utf8_validate((*provider->describe)(provider), -1, NULL))
+		g_warning ("EnchantProvider's describe method does not return valid UTF-8.\n");
+	else if (provider->dispose == NULL)
+		g_warning ("EnchantProvider's dispose method cannot be NULL\n");
+	else if (provider->dispose_dict == NULL)
+		g_warning ("EnchantProvider's dispose_dict method cannot be NULL\n");
+	else if (provider->list_dicts == NULL)
+		g_warning ("EnchantProvider's list_dicts method cannot be NULL\n");
+	else
+		return 1;
+
+	return 0;
+}
+
+static EnchantProvider *
+enchant_provider_module_open (EnchantBroker * broker, EnchantProviderModule * pm)
+{
+	GModule *module = NULL;
+	EnchantProvider *provider = NULL;
+	char *dir_entry = g_path_get_basename (pm->filename);
+
+#ifdef _WIN32
+	/* Suppress error popups for failing to load plugins */
+	UINT old_error_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
+#endif
+	pm->init_time = pm->configure_time = -1;
+	gint64 start = g_get_monotonic_time ();
+	module = g_module_open (pm->filename, (GModuleFlags) 0);
+	pm->open_time = g_get_monotonic_time () - start;
+	if (module)
+		{
+			EnchantProviderInitFunc init_func;
+			if (g_module_symbol (module, "init_enchant_provider", (gpointer *) (&init_func))
+			    && init_func)
+				{
+					start = g_get_monotonic_time ();
+					provider = init_func ();
+					pm->init_time = g_get_monotonic_time () - start;
+					if (!enchant_provider_is_valid(provider))
+						{
+							g_warning ("Error loading plugin: %s's init_enchant_provider returned invalid provider.\n", dir_entry);
+							if(provider)
+								{
+									provider->dispose(provider);
+									provider = NULL;
+								}
+							g_module_close (module);
+						}
+				}
+			else
+				{
+					g_module_close (module);
+				}
+		}
+	else
+		{
+			g_warning ("Error loading plugin: %s\n", g_module_error());
+		}
+#ifdef _WIN32
+	/* Restore the original error mode */
+	SetErrorMode(old_error_mode);
+#endif
+
+	if (provider)
+		{
+			/* optional entry point to allow modules to look for associated files */
+			EnchantPreConfigureFunc conf_func;
+			if (g_module_symbol (module, "configure_enchant_provider", (gpointer *) (&conf_func))
+			    && conf_func)
+				{
+					start = g_get_monotonic_time ();
+					conf_func (provider, broker->module_dir);
+					pm->configure_time = g_get_monotonic_time () - start;
+					if (!enchant_provider_is_valid(provider))
+						{
+							g_warning ("Error loading plugin: %s's configure_enchant_provider modified provider and it is now invalid.\n", dir_entry);
+							provider->dispose(provider);
+							provider = NULL;
+							g_module_close (module);
+						}
+				}
+		}
+	if (provider)
+		{
+			/* without it, the module was built before there were
+			 * extensions, see ENCHANT_PROVIDER_ABI_VERSION */
+			EnchantProviderAbiVersionFunc abi_func;
+			if (g_module_symbol (module, "enchant_provider_abi_version", (gpointer *) (&abi_func))
+			    && abi_func)
+				pm->abi_version = abi_func ();
+
+			pm->module = module;
+			provider->enchant_private_data = (void *) pm;
+			provider->owner = broker;
+		}
+	g_free (dir_entry);
+
+	return provider;
+}
+
+/* Loads the module if it has not been tried yet, with modules_lock held */
+static EnchantProvider *
+enchant_broker_load_provider_locked (EnchantBroker * broker, EnchantProviderModule * pm)
+{
+	if (!pm->tried)
+		{
+			pm->tried = TRUE;
+			pm->provider = enchant_provider_module_open (broker, pm);
+
+			/* from now on go by the name it gives itself */
+			g_free (pm->name);
+			pm->name = pm->provider ? g_strdup ((*pm->provider->identify) (pm->provider)) : NULL;
+		}
+
+	return pm->provider;
+}
+
+static EnchantProvider *
+enchant_broker_load_provider (EnchantBroker * broker, EnchantProviderModule * pm)
+{
+	g_mutex_lock (&broker->modules_lock);
+	EnchantProvider *provider = enchant_broker_load_provider_locked (broker, pm);
+	g_mutex_unlock (&broker->modules_lock);
+
+	return provider;
+}
+
+static void
+enchant_provider_module_free (gpointer data)
+{
+	EnchantProviderModule *pm = (EnchantProviderModule *) data;
+
+	if (pm->provider)
+		{
+			(*pm->provider->dispose) (pm->provider);
+
+			/* close module only after invoking dispose */
+			g_module_close (pm->module);
+		}
+	g_free (pm->filename);
+	g_free (pm->name);
+	g_strfreev (pm->dicts);
+	g_strfreev (pm->dict_dirs);
+	g_free (pm->dir_stamps);
+	g_free (pm);
+}
+
+/* Lists the modules in the module directory without opening them, so
+ * that only the providers a program asks for are ever loaded.  Modules
+ * are named enchant_<provider name>, which is taken as their name
+ * until they are loaded and can tell. */
+static void
+enchant_find_providers (EnchantBroker * broker)
+{
+	broker->provider_modules = g_ptr_array_new_with_free_func (enchant_provider_module_free);
+	broker->module_dir = enchant_relocate (PKGLIBDIR "-" ENCHANT_MAJOR_VERSION);
+	if (!broker->module_dir)
+		return;
+
+	GDir *dir = g_dir_open (broker->module_dir, 0, NULL);
+	if (!dir)
+		return;
+
+	size_t g_module_suffix_len = strlen (G_MODULE_SUFFIX);
+	const char *dir_entry;
+	while ((dir_entry = g_dir_read_name (dir)) != NULL)
+		{
+			size_t entry_len = strlen (dir_entry);
+			if ((entry_len > g_module_suffix_len) &&
+				!strcmp(dir_entry+(entry_len-g_module_suffix_len), G_MODULE_SUFFIX))
+				{
+					EnchantProviderModule *pm = g_new0 (EnchantProviderModule, 1);
+					pm->filename = g_build_filename (broker->module_dir, dir_entry, NULL);
+					if (g_str_has_prefix (dir_entry, "enchant_"))
+						pm->name = g_strndup (dir_entry + strlen ("enchant_"),
+								      entry_len - strlen ("enchant_") - g_module_suffix_len - 1);
+					g_ptr_array_add (broker->provider_modules, pm);
+				}
+		}
+
+	g_dir_close (dir);
+}
+
+static void
+enchant_ordering_free (gpointer data)
+{
+	EnchantOrdering *ordering = (EnchantOrdering *) data;
+
+	g_strfreev (ordering->names);
+	g_free (ordering->tiers);
+	if (ordering->modules)
+		g_ptr_array_unref (ordering->modules);
+	g_free (ordering);
+}
+
+static void
+enchant_load_ordering_from_file (EnchantBroker * broker, const char * file)
+{
+	GIOChannel * ch = g_io_channel_new_file (file, "r", NULL);
+	if (!ch)
+		return;
+
+	gchar *line;
+	gsize terminator;
+	while (G_IO_STATUS_NORMAL == g_io_channel_read_line (ch, &line, NULL, &terminator, NULL)) {
+		char *colon = strchr (line, ':');
+		if (colon != NULL)
+			{
+				char * tag = g_strndup (line, colon - line);
+				char * ordering = g_strndup (colon + 1, terminator - 1);
+				enchant_broker_set_ordering (broker, tag, ordering);
+
+				g_free (tag);
+				g_free (ordering);
+			}
+		g_free (line);
+	}
+
+	g_io_channel_unref (ch);
+}
+
+static void
+enchant_load_provider_ordering (EnchantBroker * broker)
+{
+	broker->provider_ordering = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, enchant_ordering_free);
+
+	GSList *conf_dirs = enchant_get_conf_dirs ();
+	for (GSList *iter = conf_dirs; iter; iter = iter->next)
+		{
+			char *ordering_file = g_build_filename (iter->data, "enchant.ordering", NULL);
+			enchant_load_ordering_from_file (broker, ordering_file);
+			g_free (ordering_file);
+		}
+
+	g_slist_free_full (conf_dirs, g_free);
+}
+
+/* The module of the provider called name, loading the modules whose
+ * names are not known for sure until one turns out to be it; tells in
+ * out_certain whether the module found was loaded and so really is the
+ * one, or only has a file name to match */
+static EnchantProviderModule *
+enchant_broker_find_provider_module (EnchantBroker * broker, const char * const name,
+				     gboolean * out_certain)
+{
+	EnchantProviderModule *found = NULL;
+
+	g_mutex_lock (&broker->modules_lock);
+	for (guint i = 0; i < broker->provider_modules->len && !found; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+			if (pm->name && !strcmp (name, pm->name))
+				found = pm;
+		}
+	for (guint i = 0; i < broker->provider_modules->len && !found; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+			if (!pm->tried && enchant_broker_load_provider_locked (broker, pm) &&
+			    !strcmp (name, pm->name))
+				found = pm;
+		}
+	*out_certain = found == NULL || found->tried;
+	g_mutex_unlock (&broker->modules_lock);
+
+	return found;
+}
+
+static gint
+enchant_ordered_providers_index (GPtrArray * modules, gconstpointer pm)
+{
+	for (guint i = 0; i < modules->len; i++)
+		if (g_ptr_array_index (modules, i) == pm)
+			return i;
+
+	return -1;
+}
+
+/* Lists the modules named, followed by the others; it is only kept if
+ * out_certain comes back TRUE, as a module that has not been loaded
+ * may yet turn out to be some other provider than its file name says */
+static GPtrArray *
+enchant_broker_resolve_ordering (EnchantBroker * broker, char ** names, gboolean * out_certain)
+{
+	GPtrArray *modules = g_ptr_array_sized_new (broker->provider_modules->len);
+
+	*out_certain = TRUE;
+	for (size_t i = 0; names[i]; i++)
+		{
+			gboolean certain;
+			EnchantProviderModule *pm = enchant_broker_find_provider_module (broker, names[i], &certain);
+			if (pm && enchant_ordered_providers_index (modules, pm) == -1)
+				g_ptr_array_add (modules, pm);
+			*out_certain = *out_certain && certain;
+		}
+
+	/* append providers not in the list */
+	for (guint i = 0; i < broker->provider_modules->len; i++)
+		{
+			gpointer pm = g_ptr_array_index (broker->provider_modules, i);
+			if (enchant_ordered_providers_index (modules, pm) == -1)
+				g_ptr_array_add (modules, pm);
+		}
+
+	return modules;
+}
+
+/* Providers an ordering groups together, as in "hunspell|nuspell", are
+ * alike enough for whichever of them is the fastest for tag to be
+ * tried first.  Each one that has not opened a dictionary for tag yet
+ * goes first in its group, so that what it takes gets measured, and one
+ * that had none for it last; the others go cheapest first, see
+ * enchant_costs_per_session.  Returns modules so ranked, in a new array. */
+static GPtrArray *
+enchant_broker_rank_providers (EnchantBroker * broker, const char * const tag, char ** names,
+			       const guint * tiers, GPtrArray * modules)
+{
+	GPtrArray *ranked = g_ptr_array_sized_new (modules->len);
+	guint *module_tiers = g_new (guint, modules->len);
+	char **module_names = g_new (char *, modules->len);
+	gdouble *costs = g_new (gdouble, modules->len);
+
+	/* their names change as they are loaded */
+	g_mutex_lock (&broker->modules_lock);
+	for (guint i = 0; i < modules->len; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (modules, i);
+			g_ptr_array_add (ranked, pm);
+			module_names[i] = g_strdup (pm->name);	/* or NULL */
+			module_tiers[i] = G_MAXUINT;	/* not named, so not ranked */
+			for (size_t j = 0; names[j] && pm->name; j++)
+				if (!strcmp (names[j], pm->name))
+					{
+						module_tiers[i] = tiers[j];
+						break;
+					}
+		}
+	g_mutex_unlock (&broker->modules_lock);
+
+	g_mutex_lock (&broker->stats_lock);
+	GHashTable *tag_costs = g_hash_table_lookup (enchant_broker_get_costs (broker), tag);
+
+	/* the calls a session for tag usually makes, whichever the provider */
+	guint64 workload[ENCHANT_N_COSTS] = { 0 };
+	if (tag_costs)
+		{
+			GHashTableIter iter;
+			gpointer totals;
+			g_hash_table_iter_init (&iter, tag_costs);
+			while (g_hash_table_iter_next (&iter, NULL, &totals))
+				for (guint k = 0; k < ENCHANT_N_COSTS; k++)
+					workload[k] += ((guint64 *) totals)[k];
+		}
+	gdouble n_sessions = (gdouble) MAX (workload[ENCHANT_COST_SESSIONS], 1);
+	gdouble checks = workload[ENCHANT_COST_CHECKS] / n_sessions;
+	gdouble suggests = workload[ENCHANT_COST_SUGGESTS] / n_sessions;
+
+	for (guint i = 0; i < modules->len; i++)
+		{
+			guint64 *totals = tag_costs && module_names[i] ? g_hash_table_lookup (tag_costs, module_names[i]) : NULL;
+			if (totals == NULL)
+				costs[i] = -1;
+			else if (totals[ENCHANT_COST_SESSIONS] == 0)
+				costs[i] = G_MAXDOUBLE;
+			else
+				costs[i] = enchant_costs_per_session (totals, checks, suggests);
+		}
+	g_mutex_unlock (&broker->stats_lock);
+
+	/* the groups keep their places; within each, the order given breaks ties */
+	for (guint i = 1; i < ranked->len; i++)
+		for (guint j = i; j > 0 && module_tiers[j] != G_MAXUINT &&
+			     module_tiers[j - 1] == module_tiers[j] && costs[j - 1] > costs[j]; j--)
+			{
+				gpointer pm = ranked->pdata[j];
+				ranked->pdata[j] = ranked->pdata[j - 1];
+				ranked->pdata[j - 1] = pm;
+				gdouble cost = costs[j];
+				costs[j] = costs[j - 1];
+				costs[j - 1] = cost;
+			}
+
+	g_free (costs);
+	for (guint i = 0; i < modules->len; i++)
+		g_free (module_names[i]);
+	g_free (module_names);
+	g_free (module_tiers);
+
+	return ranked;
+}
+
+/* The provider modules to try for tag, best first, to be released with
+ * g_ptr_array_unref; they are loaded with enchant_broker_load_provider,
+ * which may fail */
+static GPtrArray *
+enchant_get_ordered_providers (EnchantBroker * broker, const char * const tag)
+{
+	GPtrArray *modules = NULL;
+	char **names = NULL;
+	guint *tiers = NULL;
+
+	g_mutex_lock (&broker->lock);
+	EnchantOrdering *ordering = (EnchantOrdering *)g_hash_table_lookup (broker->provider_ordering, (gpointer)tag);
+	if (!ordering)
+		ordering = (EnchantOrdering *)g_hash_table_lookup (broker->provider_ordering, (gpointer)"*");
+	if (!ordering)
+		modules = g_ptr_array_ref (broker->provider_modules);
+	else
+		{
+			if (ordering->modules)
+				modules = g_ptr_array_ref (ordering->modules);
+			if (!ordering->modules || ordering->tiers)
+				names = g_strdupv (ordering->names);
+			if (ordering->tiers)
+				{
+					tiers = g_new (guint, g_strv_length (names));
+					memcpy (tiers, ordering->tiers, g_strv_length (names) * sizeof (guint));
+				}
+		}
+	guint generation = broker->ordering_generation;
+	g_mutex_unlock (&broker->lock);
+
+	if (!modules)
+		{
+			gboolean certain;
+			modules = enchant_broker_resolve_ordering (broker, names, &certain);
+
+			if (certain)
+				{
+					/* unless the ordering was replaced meanwhile */
+					g_mutex_lock (&broker->lock);
+					if (broker->ordering_generation == generation && ordering->modules == NULL)
+						ordering->modules = g_ptr_array_ref (modules);
+					g_mutex_unlock (&broker->lock);
+				}
+		}
+
+	if (tiers)
+		{
+			GPtrArray *ranked = enchant_broker_rank_providers (broker, tag, names, tiers, modules);
+			g_ptr_array_unref (modules);
+			modules = ranked;
+		}
+	g_strfreev (names);
+	g_free (tiers);
+
+	return modules;
+}
+
+static void
+enchant_dict_destroyed (gpointer data)
+{
+	g_return_if_fail (data);
+
+	EnchantDict *dict = (EnchantDict *) data;
+	EnchantDictPrivateData *enchant_dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	EnchantSession *session = enchant_dict_private_data->session;
+	EnchantProvider *owner = session->provider;
+
+	enchant_session_stop_prefetches (session);
+
+	if (enchant_dict_private_data->members)
+		{
+			g_free (dict->user_data);
+			g_free (dict);
+			for (size_t i = 0; i < enchant_dict_private_data->n_members; i++)
+				enchant_broker_free_dict (owner->owner, enchant_dict_private_data->members[i]);
+			g_free (enchant_dict_private_data->members);
+		}
+	else if (owner)
+		{
+			enchant_session_forget_provider_dict (session);
+			enchant_session_dispose_clones (session);
+			enchant_provider_lock (owner);
+			(*owner->dispose_dict) (owner, dict);
+			enchant_provider_unlock (owner);
+		}
+	else if(session->is_pwl)
+		g_free (dict);
+
+	g_free(enchant_dict_private_data->word_chars);
+	g_slist_free_full(enchant_dict_private_data->retired_word_chars, g_free);
+	g_free(enchant_dict_private_data);
+
+	enchant_session_destroy (session);
+}
+
+static void
+enchant_tag_free (gpointer data)
+{
+	EnchantTag *tag = (EnchantTag *) data;
+	g_free (tag->tag);
+	g_free (tag->iso_639_tag);
+	g_free (tag);
+}
+
+EnchantBroker *
+enchant_broker_init (void)
+{
+	g_return_val_if_fail (g_module_supported (), NULL);
+
+	EnchantBroker *broker = g_new0 (EnchantBroker, 1);
+	g_mutex_init (&broker->lock);
+	g_cond_init (&broker->loaded);
+	g_mutex_init (&broker->provider_lock);
+	g_mutex_init (&broker->modules_lock);
+	g_mutex_init (&broker->inventory_lock);
+	g_mutex_init (&broker->stats_lock);
+	g_mutex_init (&broker->tasks_lock);
+	g_cond_init (&broker->task_done);
+	broker->n_workers = g_get_num_processors ();
+	broker->sessions = g_ptr_array_new ();
+	broker->errors = enchant_errors_new ();
+	broker->dict_map = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, enchant_dict_destroyed);
+	broker->tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	broker->interned_tags = g_ptr_array_new_with_free_func (enchant_tag_free);
+	broker->loading = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	broker->missing = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	enchant_find_providers (broker);
+	enchant_load_provider_ordering (broker);
+
+	return broker;
+}
+
+void
+enchant_broker_free (EnchantBroker * broker)
+{
+	g_return_if_fail (broker);
+
+	/* let the dictionaries still being preloaded finish, and whatever
+	 * else is going on in the background, then the runners handed to
+	 * the executor for tasks started meanwhile */
+	enchant_broker_wait_tasks (broker, NULL);
+	g_mutex_lock (&broker->tasks_lock);
+	while (broker->n_runners)
+		g_cond_wait (&broker->task_done, &broker->tasks_lock);
+	g_mutex_unlock (&broker->tasks_lock);
+	if (broker->workers)
+		g_thread_pool_free (broker->workers, FALSE, TRUE);
+
+	guint n_remaining = g_hash_table_size (broker->dict_map) - broker->idle.length - broker->n_preloaded;
+	if (n_remaining)
+		g_warning ("%u dictionaries weren't free'd.\n", n_remaining);
+
+	/* write out the changes the personal word lists still hold */
+	enchant_broker_set_write_behind (broker, 0);
+
+	/* will destroy any remaining dictionaries for us */
+	g_hash_table_destroy (broker->dict_map);
+	g_hash_table_destroy (broker->tags);
+	g_ptr_array_free (broker->interned_tags, TRUE);
+	g_hash_table_destroy (broker->loading);
+	g_hash_table_destroy (broker->missing);
+	g_hash_table_destroy (broker->provider_ordering);
+
+	/* with what the dictionaries just destroyed took */
+	enchant_broker_save_costs (broker);
+	if (broker->provider_costs)
+		g_hash_table_destroy (broker->provider_costs);
+
+	g_ptr_array_free (broker->provider_modules, TRUE);
+	free (broker->module_dir);
+	g_mutex_clear (&broker->lock);
+	g_cond_clear (&broker->loaded);
+	g_mutex_clear (&broker->provider_lock);
+	g_mutex_clear (&broker->modules_lock);
+	g_mutex_clear (&broker->inventory_lock);
+	g_ptr_array_free (broker->sessions, TRUE);
+	g_mutex_clear (&broker->stats_lock);
+	g_mutex_clear (&broker->tasks_lock);
+	g_cond_clear (&broker->task_done);
+	enchant_errors_unref (broker->errors);
+	g_free (broker);
+}
+
+gint64
+enchant_dir_stamp (const char * dir)
+{
+	GStatBuf stats;
+
+	if (g_stat (dir, &stats) != 0)
+		return -1;
+#if defined(_WIN32)
+	return (gint64) stats.st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	return (gint64) stats.st_mtimespec.tv_sec * 1000000000 + stats.st_mtimespec.tv_nsec;
+#else
+	return (gint64) stats.st_mtim.tv_sec * 1000000000 + stats.st_mtim.tv_nsec;
+#endif
+}
+
+static gboolean
+enchant_provider_module_inventory_is_current (EnchantProviderModule * pm, char ** dirs,
+					      const gint64 * stamps, size_t n_dirs)
+{
+	if (pm->dicts == NULL || pm->n_dict_dirs != n_dirs)
+		return FALSE;
+	for (size_t i = 0; i < n_dirs; i++)
+		if (strcmp (pm->dict_dirs[i], dirs[i]) || pm->dir_stamps[i] != stamps[i])
+			return FALSE;
+
+	return TRUE;
+}
+
+static void
+enchant_provider_module_set_inventory (EnchantProviderModule * pm, char ** dicts,
+				       char ** dirs, gint64 * stamps, size_t n_dirs)
+{
+	g_strfreev (pm->dicts);
+	g_strfreev (pm->dict_dirs);
+	g_free (pm->dir_stamps);
+	pm->dicts = dicts;
+	pm->dict_dirs = dirs;
+	pm->dir_stamps = stamps;
+	pm->n_dict_dirs = n_dirs;
+}
+
+/* The inventory is kept between runs in a key file in the user's
+ * config dir, with a group for each provider listing its directories,
+ * their stamps and its dictionaries */
+static char *
+enchant_get_inventory_file (void)
+{
+	char *user_config_dir = enchant_get_user_config_dir ();
+	if (user_config_dir == NULL)
+		return NULL;
+
+	char *file = g_build_filename (user_config_dir, "inventory", NULL);
+	g_free (user_config_dir);
+
+	return file;
+}
+
+/* Takes what was saved of the provider's inventory, with inventory_lock held */
+static void
+enchant_provider_module_restore_inventory (EnchantProviderModule * pm)
+{
+	char *file = enchant_get_inventory_file ();
+	if (file == NULL)
+		return;
+
+	GKeyFile *inventory = g_key_file_new ();
+	if (g_key_file_load_from_file (inventory, file, G_KEY_FILE_NONE, NULL))
+		{
+			gsize n_dirs = 0, n_stamps = 0;
+			char **dirs = g_key_file_get_string_list (inventory, pm->name, "dirs", &n_dirs, NULL);
+			char **stamps = g_key_file_get_string_list (inventory, pm->name, "stamps", &n_stamps, NULL);
+			char **dicts = g_key_file_get_string_list (inventory, pm->name, "dicts", NULL, NULL);
+
+			if (dirs && stamps && dicts && n_dirs == n_stamps)
+				{
+					gint64 *dir_stamps = g_new (gint64, n_dirs);
+					for (gsize i = 0; i < n_dirs; i++)
+						dir_stamps[i] = g_ascii_strtoll (stamps[i], NULL, 10);
+					enchant_provider_module_set_inventory (pm, dicts, dirs, dir_stamps, n_dirs);
+				}
+			else
+				{
+					g_strfreev (dirs);
+					g_strfreev (dicts);
+				}
+			g_strfreev (stamps);
+		}
+	g_key_file_free (inventory);
+	g_free (file);
+}
+
+/* Saves the provider's inventory alongside those of the others, with
+ * inventory_lock held */
+static void
+enchant_provider_module_save_inventory (EnchantProviderModule * pm)
+{
+	char *file = enchant_get_inventory_file ();
+	if (file == NULL)
+		return;
+
+	GKeyFile *inventory = g_key_file_new ();
+	(void) g_key_file_load_from_file (inventory, file, G_KEY_FILE_KEEP_COMMENTS, NULL);
+
+	char **stamps = g_new0 (char *, pm->n_dict_dirs + 1);
+	for (size_t i = 0; i < pm->n_dict_dirs; i++)
+		stamps[i] = g_strdup_printf ("%" G_GINT64_FORMAT, pm->dir_stamps[i]);
+	g_key_file_set_string_list (inventory, pm->name, "dirs",
+				    (const gchar * const *) pm->dict_dirs, pm->n_dict_dirs);
+	g_key_file_set_string_list (inventory, pm->name, "stamps",
+				    (const gchar * const *) stamps, pm->n_dict_dirs);
+	g_key_file_set_string_list (inventory, pm->name, "dicts",
+				    (const gchar * const *) pm->dicts, g_strv_length (pm->dicts));
+	g_strfreev (stamps);
+
+	gsize length;
+	char *contents = g_key_file_to_data (inventory, &length, NULL);
+	char *dir = g_path_get_dirname (file);
+	enchant_ensure_dir_exists (dir);
+	(void) g_file_set_contents (file, contents, length, NULL);
+	g_free (dir);
+	g_free (contents);
+	g_key_file_free (inventory);
+	g_free (file);
+}
+
+/* Asks the provider which directories its dictionaries are in and
+ * stamps them; returns FALSE if it does not say */
+static gboolean
+enchant_provider_stamp_dict_dirs (EnchantProvider * provider, char *** out_dirs,
+				  gint64 ** out_stamps, size_t * out_n_dirs)
+{
+	if (!enchant_provider_has_extensions (provider) || provider->list_dict_dirs == NULL)
+		return FALSE;
+
+	size_t n_dirs = 0;
+	enchant_provider_lock (provider);
+	char **dirs = (*provider->list_dict_dirs) (provider, &n_dirs);
+	enchant_provider_unlock (provider);
+	if (dirs == NULL)
+		return FALSE;
+
+	gint64 *stamps = g_new (gint64, n_dirs);
+	for (size_t i = 0; i < n_dirs; i++)
+		stamps[i] = enchant_dir_stamp (dirs[i]);
+
+	*out_dirs = dirs;
+	*out_stamps = stamps;
+	*out_n_dirs = n_dirs;
+	return TRUE;
+}
+
+/* A copy of what the provider listed while its directories were as
+ * stamped now, or NULL if they have changed since */
+static char **
+enchant_broker_lookup_inventory (EnchantBroker * broker, EnchantProviderModule * pm,
+				 char ** dirs, const gint64 * stamps, size_t n_dirs)
+{
+	char **dicts = NULL;
+
+	g_mutex_lock (&broker->inventory_lock);
+	if (pm->dicts == NULL)
+		enchant_provider_module_restore_inventory (pm);
+	if (enchant_provider_module_inventory_is_current (pm, dirs, stamps, n_dirs))
+		dicts = g_strdupv (pm->dicts);
+	g_mutex_unlock (&broker->inventory_lock);
+
+	return dicts;
+}
+
+/* Returns what the module's provider lists, to be freed with
+ * g_strfreev.  A provider that reports the directories its
+ * dictionaries are in is only asked again once one of them changes,
+ * which is also checked against the inventory saved by an earlier run. */
+static char **
+enchant_broker_list_provider_dicts (EnchantBroker * broker, EnchantProviderModule * pm,
+				    EnchantProvider * provider)
+{
+	char **dirs = NULL;
+	gint64 *stamps = NULL;
+	size_t n_dirs = 0;
+	gboolean has_dirs = enchant_provider_stamp_dict_dirs (provider, &dirs, &stamps, &n_dirs);
+
+	if (has_dirs)
+		{
+			char **dicts = enchant_broker_lookup_inventory (broker, pm, dirs, stamps, n_dirs);
+			if (dicts)
+				{
+					g_strfreev (dirs);
+					g_free (stamps);
+					return dicts;
+				}
+		}
+
+	size_t n_dicts = 0;
+	enchant_provider_lock (provider);
+	char **listed = (*provider->list_dicts) (provider, &n_dicts);
+	enchant_provider_unlock (provider);
+
+	char **dicts = g_new0 (char *, n_dicts + 1);
+	for (size_t i = 0; i < n_dicts; i++)
+		dicts[i] = g_strdup (listed[i]);
+	enchant_free_string_list (listed);
+
+	if (has_dirs)
+		{
+			/* stamped before listing, so that a change made
+			 * meanwhile is listed next time */
+			g_mutex_lock (&broker->inventory_lock);
+			enchant_provider_module_set_inventory (pm, g_strdupv (dicts), dirs, stamps, n_dirs);
+			enchant_provider_module_save_inventory (pm);
+			g_mutex_unlock (&broker->inventory_lock);
+		}
+
+	return dicts;
+}
+
+/* Whether a current inventory lists the dictionary; one that does not
+ * is no proof that the provider lacks it */
+static gboolean
+enchant_broker_inventory_has_dict (EnchantBroker * broker, EnchantProviderModule * pm,
+				   EnchantProvider * provider, const char * const tag)
+{
+	char **dirs, **dicts;
+	gint64 *stamps;
+	size_t n_dirs;
+
+	if (!enchant_provider_stamp_dict_dirs (provider, &dirs, &stamps, &n_dirs))
+		return FALSE;
+	dicts = enchant_broker_lookup_inventory (broker, pm, dirs, stamps, n_dirs);
+	g_strfreev (dirs);
+	g_free (stamps);
+
+	gboolean found = FALSE;
+	for (size_t i = 0; dicts && dicts[i] && !found; i++)
+		found = !strcmp (dicts[i], tag);
+	g_strfreev (dicts);
+
+	return found;
+}
+
+/* Sums up the state of the directories all the providers keep their
+ * dictionaries in, or returns NULL if that cannot tell whether some
+ * dictionary was installed: when a provider does not say where it
+ * keeps them, or has not even been loaded */
+static char *
+enchant_broker_stamp_all_dict_dirs (EnchantBroker * broker)
+{
+	GPtrArray *providers = g_ptr_array_new ();
+	gboolean complete = TRUE;
+
+	g_mutex_lock (&broker->modules_lock);
+	for (guint i = 0; i < broker->provider_modules->len && complete; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+			if (!pm->tried)
+				complete = FALSE;
+			else if (pm->provider)
+				g_ptr_array_add (providers, pm->provider);
+		}
+	g_mutex_unlock (&broker->modules_lock);
+
+	GString *stamp = complete ? g_string_new (NULL) : NULL;
+	for (guint i = 0; i < providers->len && stamp; i++)
+		{
+			char **dirs;
+			gint64 *stamps;
+			size_t n_dirs;
+
+			if (enchant_provider_stamp_dict_dirs (g_ptr_array_index (providers, i), &dirs, &stamps, &n_dirs))
+				{
+					for (size_t j = 0; j < n_dirs; j++)
+						g_string_append_printf (stamp, "%s\n%" G_GINT64_FORMAT "\n", dirs[j], stamps[j]);
+					g_strfreev (dirs);
+					g_free (stamps);
+				}
+			else
+				{
+					g_string_free (stamp, TRUE);
+					stamp = NULL;
+				}
+		}
+	g_ptr_array_free (providers, TRUE);
+
+	return stamp ? g_string_free (stamp, FALSE) : NULL;
+}
+
+/* Whether no provider had tag while the dictionary directories were
+ * last as dirs_stamp says */
+static gboolean
+enchant_broker_dict_is_missing (EnchantBroker * broker, const char * const tag, const char * dirs_stamp)
+{
+	if (dirs_stamp == NULL)
+		return FALSE;
+
+	g_mutex_lock (&broker->lock);
+	const char *missing_stamp = (const char *) g_hash_table_lookup (broker->missing, tag);
+	gboolean missing = missing_stamp && !strcmp (missing_stamp, dirs_stamp);
+	g_mutex_unlock (&broker->lock);
+
+	return missing;
+}
+
+/* the dict_map key of a read-only word list, kept apart from one
+ * opened for writing */
+static char *
+enchant_readonly_pwl_key (const char * const pwl)
+{
+	return g_strconcat ("readonly:", pwl, NULL);
+}
+
+/* Takes dict out of dict_map, with the lock held */
+static void
+enchant_broker_steal_dict (EnchantBroker * broker, EnchantDict * dict)
+{
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	char *readonly_key = session->readonly ? enchant_readonly_pwl_key (session->personal_filename) : NULL;
+	const char *tag = session->provider ? session->language_tag :
+		readonly_key ? readonly_key : session->personal_filename;
+	gpointer key = NULL;
+
+	g_hash_table_lookup_extended (broker->dict_map, tag, &key, NULL);
+	g_hash_table_steal (broker->dict_map, tag);
+	g_free (key);
+	g_free (readonly_key);
+
+	for (guint i = 0; i < broker->interned_tags->len; i++)
+		{
+			EnchantTag *interned = g_ptr_array_index (broker->interned_tags, i);
+			if (interned->dict == dict)
+				interned->dict = NULL;
+		}
+}
+
+/* Takes the dictionaries the pool is not to keep any longer, or all of
+ * them, out of dict_map, with the lock held; returns them to be
+ * destroyed once it is released */
+static GSList *
+enchant_broker_trim_idle (EnchantBroker * broker, gboolean all)
+{
+	GSList *evicted = NULL;
+	gint64 now = broker->idle.length ? g_get_monotonic_time () : 0;
+
+	while (broker->idle.length)
+		{
+			EnchantDict *dict = (EnchantDict *) g_queue_peek_head (&broker->idle);
+			EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+			if (!all && broker->idle.length <= broker->idle_max &&
+			    (broker->idle_timeout < 0 || now - dict_private_data->released < broker->idle_timeout))
+				break;
+
+			g_queue_pop_head (&broker->idle);
+			dict_private_data->idle_link = NULL;
+			enchant_broker_steal_dict (broker, dict);
+			evicted = g_slist_prepend (evicted, dict);
+		}
+
+	return evicted;
+}
+
+/* Hands out another reference to dict, which is in dict_map, with the
+ * lock held */
+static void
+enchant_broker_take_dict (EnchantBroker * broker, EnchantDict * dict)
+{
+	EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	if (dict_private_data->idle_link)
+		{
+			g_queue_delete_link (&broker->idle, dict_private_data->idle_link);
+			dict_private_data->idle_link = NULL;
+		}
+	if (dict_private_data->preloaded)
+		{
+			/* take over the reference it was preloaded with */
+			dict_private_data->preloaded = FALSE;
+			broker->n_preloaded--;
+		}
+	else
+		dict_private_data->reference_count++;
+}
+
+/* Looks up the dictionary loaded for key, waiting for another thread
+ * that is loading it.  Returns it with a new reference, or NULL when
+ * the calling thread is to load it and then call
+ * enchant_broker_publish_dict, whether it succeeded or not. */
+static EnchantDict *
+enchant_broker_claim_dict (EnchantBroker * broker, const char * const key)
+{
+	g_mutex_lock (&broker->lock);
+	while (g_hash_table_contains (broker->loading, key))
+		g_cond_wait (&broker->loaded, &broker->lock);
+
+	EnchantDict *dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) key);
+	if (dict)
+		enchant_broker_take_dict (broker, dict);
+	else
+		g_hash_table_add (broker->loading, g_strdup (key));
+	GSList *evicted = enchant_broker_trim_idle (broker, FALSE);
+	g_mutex_unlock (&broker->lock);
+
+	g_slist_free_full (evicted, enchant_dict_destroyed);
+
+	return dict;
+}
+
+/* ends the load of key claimed by the calling thread; dict may be NULL */
+static void
+enchant_broker_publish_dict (EnchantBroker * broker, const char * const key, EnchantDict * dict)
+{
+	g_mutex_lock (&broker->lock);
+	if (dict)
+		{
+			EnchantSession *session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+			enchant_session_set_write_behind (session, broker->write_behind);
+			g_hash_table_insert (broker->dict_map, g_strdup (key), dict);
+		}
+	g_hash_table_remove (broker->loading, key);
+	g_cond_broadcast (&broker->loaded);
+	g_mutex_unlock (&broker->lock);
+}
+
+EnchantDict *
+enchant_broker_request_pwl_dict (EnchantBroker * broker, const char *const pwl)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (pwl && strlen(pwl), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	EnchantDict *dict = enchant_broker_claim_dict (broker, pwl);
+	if (dict)
+		return dict;
+
+	/* since the broker pwl file is a read/write file (there is no readonly dictionary associated)
+	 * there is no need for complementary exclude file to add a word to. The word just needs to be
+	 * removed from the broker pwl file
+	 */
+	EnchantSession *session = enchant_session_new_with_pwl (NULL, pwl, NULL, "Personal Wordlist", TRUE);
+	if (!session)
+		{
+			enchant_errors_set (broker->errors,
+					   g_strdup_printf ("Couldn't open personal wordlist '%s'", pwl));
+			enchant_broker_publish_dict (broker, pwl, NULL);
+			return NULL;
+		}
+
+	session->is_pwl = 1;
+	enchant_broker_add_session (broker, session);
+
+	dict = g_new0 (EnchantDict, 1);
+	EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+	enchant_dict_private_data->reference_count = 1;
+	enchant_dict_private_data->session = session;
+	dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+	enchant_broker_publish_dict (broker, pwl, dict);
+
+	return dict;
+}
+
+EnchantDict *
+enchant_broker_request_readonly_pwl_dict (EnchantBroker * broker, const char *const pwl)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (pwl && strlen(pwl), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	char *key = enchant_readonly_pwl_key (pwl);
+	EnchantDict *dict = enchant_broker_claim_dict (broker, key);
+	if (dict)
+		{
+			g_free (key);
+			return dict;
+		}
+
+	EnchantPWL *personal = enchant_pwl_init_readonly (pwl);
+	if (!personal)
+		{
+			enchant_errors_set (broker->errors,
+					   g_strdup_printf ("Couldn't open personal wordlist '%s'", pwl));
+			enchant_broker_publish_dict (broker, key, NULL);
+			g_free (key);
+			return NULL;
+		}
+
+	/* with no exclude file, nor anything else to write to */
+	EnchantSession *session = enchant_session_new_with_pwl (NULL, NULL, NULL, "Personal Wordlist", FALSE);
+	session->personal = personal;
+	session->personal_filename = g_strdup (pwl);
+	session->is_pwl = 1;
+	session->readonly = TRUE;
+	enchant_broker_add_session (broker, session);
+
+	dict = g_new0 (EnchantDict, 1);
+	EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+	enchant_dict_private_data->reference_count = 1;
+	enchant_dict_private_data->session = session;
+	dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+	enchant_broker_publish_dict (broker, key, dict);
+	g_free (key);
+
+	return dict;
+}
+
+/* asks the provider for a dictionary of its own, with a session */
+static EnchantDict *
+enchant_provider_request_dict (EnchantProvider * provider, const char *const tag)
+{
+	gint64 start = g_get_monotonic_time ();
+	enchant_provider_lock (provider);
+	EnchantDict *dict = (*provider->request_dict) (provider, tag);
+	enchant_provider_unlock (provider);
+
+	if (dict)
+		{
+			EnchantSession *session = enchant_session_new (provider, tag);
+			session->request_us = MAX (g_get_monotonic_time () - start, 1);
+			enchant_broker_add_session (provider->owner, session);
+			EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+			enchant_dict_private_data->reference_count = 1;
+			enchant_dict_private_data->session = session;
+			dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+			if (enchant_provider_get_abi_version (provider) >= 2 && dict->get_memory_usage)
+				session->provider_dict = dict;
+
+			/* a clone would not see what is added to the dictionary */
+			if (session->dict_extended && provider->clone_dict && session->serialize_provider &&
+			    !dict->add_to_personal && !dict->add_to_session &&
+			    !dict->add_to_exclude && !dict->store_replacement)
+				session->max_clones = g_get_num_processors () - 1;
+		}
+
+	return dict;
+}
+
+static EnchantDict *
+_enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+{
+	EnchantTrace trace;
+	enchant_trace_enter (&trace, "request_dict", tag, NULL, 0);
+
+	EnchantDict *dict = enchant_broker_claim_dict (broker, tag);
+	if (dict)
+		{
+			trace.provider = ((EnchantDictPrivateData*)dict->enchant_private_data)->session->provider;
+			enchant_trace_leave (&trace);
+			return dict;
+		}
+
+	/* a dictionary no provider had is not asked for again until one of
+	 * the dictionary directories changes */
+	g_mutex_lock (&broker->lock);
+	guint rescans = broker->rescans;
+	g_mutex_unlock (&broker->lock);
+	char *dirs_stamp = enchant_broker_stamp_all_dict_dirs (broker);
+	if (enchant_broker_dict_is_missing (broker, tag, dirs_stamp))
+		{
+			g_free (dirs_stamp);
+			enchant_broker_publish_dict (broker, tag, NULL);
+			enchant_trace_leave (&trace);
+			return NULL;
+		}
+
+	GPtrArray * modules = enchant_get_ordered_providers (broker, tag);
+	for (guint i = 0; i < modules->len; i++)
+		{
+			EnchantProvider * provider;
+
+			provider = enchant_broker_load_provider (broker, g_ptr_array_index (modules, i));
+
+			if (provider && provider->request_dict)
+				{
+					dict = enchant_provider_request_dict (provider, tag);
+					if (dict)
+						{
+							trace.provider = provider;
+							break;
+						}
+					enchant_broker_count_missing_dict (broker, provider, tag);
+				}
+		}
+	g_ptr_array_unref (modules);
+
+	g_mutex_lock (&broker->lock);
+	if (dict == NULL && dirs_stamp && rescans == broker->rescans)
+		g_hash_table_insert (broker->missing, g_strdup (tag), dirs_stamp);
+	else
+		{
+			g_hash_table_remove (broker->missing, tag);
+			g_free (dirs_stamp);
+		}
+	g_mutex_unlock (&broker->lock);
+	enchant_broker_publish_dict (broker, tag, dict);
+	enchant_trace_leave (&trace);
+
+	return dict;
+}
+
+EnchantDict *
+enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+{
+	EnchantDict *dict = NULL;
+
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tag && strlen(tag), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
+	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+		{
+			enchant_broker_set_error (broker, "invalid tag character found");
+		}
+	else if ((dict = _enchant_broker_request_dict (broker, normalized_tag)) == NULL)
+		{
+			char * iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+			dict = _enchant_broker_request_dict (broker, iso_639_only_tag);
+			free (iso_639_only_tag);
+		}
+	free (normalized_tag);
+
+	return dict;
+}
+
+EnchantTag *
+enchant_broker_intern_tag (EnchantBroker * broker, const char *const tag)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tag && strlen(tag), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	EnchantTag *interned = (EnchantTag *) g_hash_table_lookup (broker->tags, tag);
+	g_mutex_unlock (&broker->lock);
+	if (interned)
+		return interned;
+
+	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
+	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+		{
+			enchant_broker_set_error (broker, "invalid tag character found");
+			free (normalized_tag);
+			return NULL;
+		}
+
+	/* "en-us" and "en_US.UTF-8" are interned as the same tag */
+	g_mutex_lock (&broker->lock);
+	interned = (EnchantTag *) g_hash_table_lookup (broker->tags, normalized_tag);
+	if (interned == NULL)
+		{
+			interned = g_new0 (EnchantTag, 1);
+			interned->tag = g_strdup (normalized_tag);
+			char * iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+			if (strcmp (iso_639_only_tag, normalized_tag))
+				interned->iso_639_tag = g_strdup (iso_639_only_tag);
+			free (iso_639_only_tag);
+			g_ptr_array_add (broker->interned_tags, interned);
+			g_hash_table_insert (broker->tags, g_strdup (normalized_tag), interned);
+		}
+	if (!g_hash_table_contains (broker->tags, tag))
+		g_hash_table_insert (broker->tags, g_strdup (tag), interned);
+	g_mutex_unlock (&broker->lock);
+	free (normalized_tag);
+
+	return interned;
+}
+
+EnchantDict *
+enchant_broker_request_dict_by_tag (EnchantBroker * broker, EnchantTag * tag)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tag, NULL);
+
+	enchant_broker_clear_error (broker);
+
+	/* the dictionary it was last requested as, while it is loaded */
+	GSList *evicted = NULL;
+	g_mutex_lock (&broker->lock);
+	EnchantDict *dict = tag->dict;
+	if (dict)
+		{
+			enchant_broker_take_dict (broker, dict);
+			evicted = enchant_broker_trim_idle (broker, FALSE);
+		}
+	g_mutex_unlock (&broker->lock);
+
+	if (dict)
+		{
+			g_slist_free_full (evicted, enchant_dict_destroyed);
+
+			EnchantTrace trace;
+			enchant_trace_enter (&trace, "request_dict", tag->tag, NULL, 0);
+			trace.provider = ((EnchantDictPrivateData*)dict->enchant_private_data)->session->provider;
+			enchant_trace_leave (&trace);
+			return dict;
+		}
+
+	dict = _enchant_broker_request_dict (broker, tag->tag);
+	if (dict == NULL && tag->iso_639_tag)
+		dict = _enchant_broker_request_dict (broker, tag->iso_639_tag);
+
+	/* the reference just taken keeps it in dict_map meanwhile */
+	if (dict)
+		{
+			g_mutex_lock (&broker->lock);
+			tag->dict = dict;
+			g_mutex_unlock (&broker->lock);
+		}
+
+	return dict;
+}
+
+/* An overlay passes what it does not handle itself on to the dictionary
+ * it shares, taking turns with everyone else who shares it, or to one of
+ * its clones.  Nothing that would change that dictionary is passed on. */
+static EnchantDict *
+enchant_overlay_lock_base (EnchantDict * me)
+{
+	EnchantDict *base = ((EnchantDictPrivateData*)me->enchant_private_data)->members[0];
+	return enchant_session_acquire_dict (((EnchantDictPrivateData*)base->enchant_private_data)->session, base);
+}
+
+static void
+enchant_overlay_unlock_base (EnchantDict * me, EnchantDict * used)
+{
+	EnchantDict *base = ((EnchantDictPrivateData*)me->enchant_private_data)->members[0];
+	enchant_session_release_dict (((EnchantDictPrivateData*)base->enchant_private_data)->session, base, used);
+}
+
+static int
+enchant_overlay_check (EnchantDict * me, const char *const word, size_t len)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	int result = (*base->check) (base, word, len);
+	enchant_overlay_unlock_base (me, base);
+	return result;
+}
+
+static void
+enchant_overlay_check_batch (EnchantDict * me, const char *const *words, const size_t *lens,
+			     size_t n, int *results)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	(*base->check_batch) (base, words, lens, n, results);
+	enchant_overlay_unlock_base (me, base);
+}
+
+static char **
+enchant_overlay_suggest (EnchantDict * me, const char *const word, size_t len, size_t * out_n_suggs)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	char **suggs = (*base->suggest) (base, word, len, out_n_suggs);
+	enchant_overlay_unlock_base (me, base);
+	return suggs;
+}
+
+static char **
+enchant_overlay_suggest_bounded (EnchantDict * me, const char *const word, size_t len,
+				 size_t max_suggs, int max_distance, int timeout_ms,
+				 size_t * out_n_suggs)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	char **suggs = (*base->suggest_bounded) (base, word, len, max_suggs, max_distance,
+						 timeout_ms, out_n_suggs);
+	enchant_overlay_unlock_base (me, base);
+	return suggs;
+}
+
+static const char *
+enchant_overlay_get_extra_word_characters (EnchantDict * me)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	const char *chars = (*base->get_extra_word_characters) (base);
+	enchant_overlay_unlock_base (me, base);
+	return chars;
+}
+
+static int
+enchant_overlay_is_word_character (EnchantDict * me, uint32_t uc, size_t n)
+{
+	EnchantDict *base = enchant_overlay_lock_base (me);
+	int result = (*base->is_word_character) (base, uc, n);
+	enchant_overlay_unlock_base (me, base);
+	return result;
+}
+
+EnchantDict *
+enchant_broker_request_overlay_dict (EnchantBroker * broker, const char *const tag,
+				     const char *const user_dir)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tag && strlen(tag), NULL);
+	g_return_val_if_fail (user_dir && strlen(user_dir), NULL);
+
+	EnchantDict *base = enchant_broker_request_dict (broker, tag);
+	if (!base)
+		return NULL;
+
+	EnchantSession *base_session = ((EnchantDictPrivateData*)base->enchant_private_data)->session;
+	EnchantSession *session = _enchant_session_new (base_session->provider, user_dir,
+							base_session->language_tag);
+	/* the forwarders take turns on the base's lock, and the provider
+	 * reports its errors through the base */
+	session->serialize_provider = FALSE;
+	session->id = base_session->id;
+	enchant_errors_unref (session->errors);
+	session->errors = enchant_errors_ref (base_session->errors);
+	enchant_session_set_write_behind (session, broker->write_behind);
+	enchant_broker_add_session (broker, session);
+
+	EnchantDict *dict = g_new0 (EnchantDict, 1);
+	if (base->check)
+		dict->check = enchant_overlay_check;
+	if (base_session->dict_extended && base->check_batch)
+		dict->check_batch = enchant_overlay_check_batch;
+	if (base->suggest)
+		dict->suggest = enchant_overlay_suggest;
+	if (base_session->dict_extended && base->suggest_bounded)
+		dict->suggest_bounded = enchant_overlay_suggest_bounded;
+	if (base->get_extra_word_characters)
+		dict->get_extra_word_characters = enchant_overlay_get_extra_word_characters;
+	if (base->is_word_character)
+		dict->is_word_character = enchant_overlay_is_word_character;
+
+	EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+	enchant_dict_private_data->reference_count = 1;
+	enchant_dict_private_data->session = session;
+	enchant_dict_private_data->members = g_new (EnchantDict *, 1);
+	enchant_dict_private_data->members[0] = base;
+	enchant_dict_private_data->n_members = 1;
+	dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+	return dict;
+}
+
+/* A composite dictionary accepts a word one of its members accepts,
+ * asking them in turn: a check takes less time than handing it to
+ * another thread would.  Suggestions take long enough to be worth
+ * asking the members for all at once. */
+static int
+enchant_multi_dict_check (EnchantDict * me, const char *const word, size_t len)
+{
+	EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)me->enchant_private_data;
+	int result = -1;
+
+	for (size_t i = 0; i < dict_private_data->n_members; i++)
+		{
+			EnchantDict *member = dict_private_data->members[i];
+			int member_result = enchant_dict_check (member, word, len);
+			if (member_result == 0)
+				return 0;
+			if (member_result > 0)
+				result = 1;
+			else if (result < 0 && enchant_dict_get_error (member))
+				enchant_dict_set_error (me, enchant_dict_get_error (member));
+		}
+
+	return result;
+}
+
+/* each member is given the words the ones before it did not accept */
+static void
+enchant_multi_dict_check_batch (EnchantDict * me, const char *const *words, const size_t *lens,
+				size_t n, int *results)
+{
+	EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)me->enchant_private_data;
+	const char **member_words = g_new (const char *, MAX (n, 1));
+	ssize_t *member_lens = g_new (ssize_t, MAX (n, 1));
+	size_t *member_index = g_new (size_t, MAX (n, 1));
+	int *member_results = g_new (int, MAX (n, 1));
+
+	for (size_t i = 0; i < n; i++)
+		results[i] = -1;
+
+	for (size_t m = 0; m < dict_private_data->n_members; m++)
+		{
+			size_t n_member_words = 0;
+			for (size_t i = 0; i < n; i++)
+				if (results[i] != 0)
+					{
+						member_words[n_member_words] = words[i];
+						member_lens[n_member_words] = (ssize_t) lens[i];
+						member_index[n_member_words++] = i;
+					}
+			if (n_member_words == 0)
+				break;
+
+			enchant_dict_check_batch (dict_private_data->members[m], member_words, member_lens,
+						  n_member_words, member_results);
+			for (size_t j = 0; j < n_member_words; j++)
+				if (member_results[j] >= 0)
+					results[member_index[j]] = member_results[j];
+		}
+
+	g_free (member_words);
+	g_free (member_lens);
+	g_free (member_index);
+	g_free (member_results);
+}
+
+static char **
+enchant_multi_dict_suggest (EnchantDict * me, const char *const word, size_t len,
+			    size_t * out_n_suggs)
+{
+	EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)me->enchant_private_data;
+	size_t n_members = dict_private_data->n_members;
+
+	EnchantSuggestTask *tasks = g_new0 (EnchantSuggestTask, n_members);
+	for (size_t i = 0; i < n_members; i++)
+		{
+			tasks[i].dict = dict_private_data->members[i];
+			tasks[i].word = word;
+			tasks[i].len = len;
+		}
+
+	/* the calling thread asks the first member while the others are asked */
+	if (n_members > 1)
+		{
+			EnchantBroker *broker = dict_private_data->session->broker;
+			EnchantTaskGroup group = { 0 };
+			for (size_t i = 1; i < n_members; i++)
+				enchant_broker_submit (broker, enchant_suggest_task_run, &tasks[i], &group);
+			enchant_suggest_task_run (&tasks[0], NULL);
+			enchant_broker_wait_tasks (broker, &group);
+		}
+	else
+		enchant_suggest_task_run (&tasks[0], NULL);
+
+	/* the members' best suggestions first: their first ones, then
+	 * their second ones and so on */
+	size_t n_suggs = 0, max_n_suggs = 0;
+	for (size_t i = 0; i < n_members; i++)
+		max_n_suggs = MAX (max_n_suggs, tasks[i].suggs ? tasks[i].n_suggs : 0);
+
+	GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+	GPtrArray *suggs = g_ptr_array_new ();
+	for (size_t rank = 0; rank < max_n_suggs; rank++)
+		for (size_t i = 0; i < n_members; i++)
+			if (tasks[i].suggs && rank < tasks[i].n_suggs &&
+			    g_hash_table_add (seen, tasks[i].suggs[rank]))
+				g_ptr_array_add (suggs, g_strdup (tasks[i].suggs[rank]));
+	g_hash_table_destroy (seen);
+	n_suggs = suggs->len;
+
+	for (size_t i = 0; i < n_members; i++)
+		{
+			if (tasks[i].error && n_suggs == 0 && enchant_dict_get_error (me) == NULL)
+				enchant_dict_set_error (me, tasks[i].error);
+			g_free (tasks[i].error);
+			enchant_result_free (tasks[i].suggs);
+		}
+	g_free (tasks);
+
+	*out_n_suggs = n_suggs;
+	g_ptr_array_add (suggs, NULL);
+	return (char **) g_ptr_array_free (suggs, FALSE);
+}
+
+static const char *
+enchant_multi_dict_get_extra_word_characters (EnchantDict * me)
+{
+	return (const char *) me->user_data;
+}
+
+static int
+enchant_multi_dict_is_word_character (EnchantDict * me, uint32_t uc, size_t n)
+{
+	EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)me->enchant_private_data;
+
+	for (size_t i = 0; i < dict_private_data->n_members; i++)
+		if (enchant_dict_is_word_character (dict_private_data->members[i], uc, n))
+			return 1;
+	return 0;
+}
+
+EnchantDict *
+enchant_broker_request_multi_dict (EnchantBroker * broker, const char *const tags)
+{
+	g_return_val_if_fail (broker, NULL);
+	g_return_val_if_fail (tags && strlen(tags), NULL);
+
+	enchant_broker_clear_error (broker);
+
+	char **tokens = g_strsplit (tags, ",", -1);
+	GPtrArray *members = g_ptr_array_new ();
+	GString *tag = g_string_new (NULL);
+	GString *extra_chars = g_string_new (NULL);
+	gboolean found_all = TRUE;
+	for (size_t i = 0; tokens[i] && found_all; i++)
+		{
+			char *token = g_strstrip (tokens[i]);
+			if (*token == '\0')
+				continue;
+
+			EnchantDict *member = enchant_broker_request_dict (broker, token);
+			if (member == NULL)
+				{
+					if (enchant_broker_get_error (broker) == NULL)
+						enchant_errors_set (broker->errors,
+								   g_strdup_printf ("No dictionary for '%s'", token));
+					found_all = FALSE;
+					break;
+				}
+			g_ptr_array_add (members, member);
+
+			EnchantSession *member_session = ((EnchantDictPrivateData*)member->enchant_private_data)->session;
+			if (tag->len)
+				g_string_append_c (tag, ',');
+			g_string_append (tag, member_session->language_tag);
+
+			/* the word characters any of the members takes */
+			const char *chars = enchant_dict_get_extra_word_characters (member);
+			for (const char *c = chars; c && *c; c = g_utf8_next_char (c))
+				{
+					char *ch = g_strndup (c, g_utf8_next_char (c) - c);
+					if (!strstr (extra_chars->str, ch))
+						g_string_append (extra_chars, ch);
+					g_free (ch);
+				}
+		}
+	g_strfreev (tokens);
+
+	if (!found_all || members->len == 0)
+		{
+			for (guint i = 0; i < members->len; i++)
+				enchant_broker_free_dict (broker, g_ptr_array_index (members, i));
+			g_ptr_array_free (members, TRUE);
+			g_string_free (tag, TRUE);
+			g_string_free (extra_chars, TRUE);
+			return NULL;
+		}
+
+	EnchantDict *first = g_ptr_array_index (members, 0);
+	EnchantSession *first_session = ((EnchantDictPrivateData*)first->enchant_private_data)->session;
+	char *user_config_dir = enchant_get_user_config_dir ();
+	EnchantSession *session = _enchant_session_new (first_session->provider, user_config_dir, tag->str);
+	g_free (user_config_dir);
+	g_string_free (tag, TRUE);
+	/* the members take turns on their own providers */
+	session->serialize_provider = FALSE;
+	enchant_session_set_write_behind (session, broker->write_behind);
+	enchant_broker_add_session (broker, session);
+
+	EnchantDict *dict = g_new0 (EnchantDict, 1);
+	dict->user_data = g_string_free (extra_chars, FALSE);
+	dict->check = enchant_multi_dict_check;
+	dict->check_batch = enchant_multi_dict_check_batch;
+	dict->suggest = enchant_multi_dict_suggest;
+	dict->get_extra_word_characters = enchant_multi_dict_get_extra_word_characters;
+	dict->is_word_character = enchant_multi_dict_is_word_character;
+
+	EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
+	enchant_dict_private_data->reference_count = 1;
+	enchant_dict_private_data->session = session;
+	enchant_dict_private_data->n_members = members->len;
+	enchant_dict_private_data->members = (EnchantDict **) g_ptr_array_free (members, FALSE);
+	dict->enchant_private_data = (void *)enchant_dict_private_data;
+
+	return dict;
+}
+
+int
+enchant_dict_set_suggest_fanout (EnchantDict * dict, size_t max_providers, int timeout_ms)
+{
+	g_return_val_if_fail (dict, -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_clear_error (session);
+
+	if (session->provider == NULL)
+		return 0;
+
+	/* the other providers the ordering lists for the dictionary's
+	 * language, each with a dictionary of its own */
+	GPtrArray *fanout = NULL;
+	if (max_providers > 1)
+		{
+			EnchantBroker *broker = session->provider->owner;
+			GPtrArray *modules = enchant_get_ordered_providers (broker, session->language_tag);
+			fanout = g_ptr_array_new_with_free_func (enchant_dict_destroyed);
+			for (guint i = 0; i < modules->len && fanout->len + 1 < max_providers; i++)
+				{
+					EnchantProvider *provider = enchant_broker_load_provider (broker, g_ptr_array_index (modules, i));
+					if (provider == NULL || provider == session->provider || !provider->request_dict)
+						continue;
+
+					EnchantDict *other = enchant_provider_request_dict (provider, session->language_tag);
+					if (other)
+						g_ptr_array_add (fanout, other);
+				}
+			g_ptr_array_unref (modules);
+
+			if (fanout->len == 0)
+				{
+					g_ptr_array_unref (fanout);
+					fanout = NULL;
+				}
+		}
+	int n_providers = fanout ? (int) fanout->len + 1 : 1;
+
+	g_mutex_lock (&session->fanout_lock);
+	GPtrArray *old_fanout = session->fanout;
+	session->fanout = fanout;
+	session->fanout_timeout_ms = timeout_ms < 0 ? -1 : timeout_ms;
+	g_mutex_unlock (&session->fanout_lock);
+
+	/* calls still asking them hold on to the old ones */
+	if (old_fanout)
+		g_ptr_array_unref (old_fanout);
+	enchant_session_changed (session);
+
+	return n_providers;
+}
+
+void
+enchant_broker_describe (EnchantBroker * broker, EnchantBrokerDescribeFn fn, void * user_data)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	enchant_broker_clear_error (broker);
+
+	for (guint i = 0; i < broker->provider_modules->len; i++)
+		{
+			EnchantProvider *provider = enchant_broker_load_provider (broker, g_ptr_array_index (broker->provider_modules, i));
+			if (!provider)
+				continue;
+			EnchantProviderModule *pm = (EnchantProviderModule *) provider->enchant_private_data;
+
+			const char *name = (*provider->identify) (provider);
+			const char *desc = (*provider->describe) (provider);
+			const char *file = g_module_name (pm->module);
+
+			(*fn) (name, desc, file, user_data);
+		}
+}
+
+void
+enchant_broker_describe_load_times (EnchantBroker * broker, EnchantLoadTimesFn fn, void * user_data)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	enchant_broker_clear_error (broker);
+
+	/* a module is not changed once it was tried */
+	GPtrArray *tried = g_ptr_array_new ();
+	g_mutex_lock (&broker->modules_lock);
+	for (guint i = 0; i < broker->provider_modules->len; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+			if (pm->tried)
+				g_ptr_array_add (tried, pm);
+		}
+	g_mutex_unlock (&broker->modules_lock);
+
+	for (guint i = 0; i < tried->len; i++)
+		{
+			EnchantProviderModule *pm = g_ptr_array_index (tried, i);
+			(*fn) (pm->name, pm->filename, pm->open_time, pm->init_time, pm->configure_time, user_data);
+		}
+	g_ptr_array_free (tried, TRUE);
+}
+
+void
+enchant_broker_get_stats (EnchantBroker * broker, EnchantStatsFn fn, void * user_data)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	guint64 totals[ENCHANT_N_STATS];
+	g_mutex_lock (&broker->stats_lock);
+	memcpy (totals, broker->retired_stats, sizeof (totals));
+	for (guint i = 0; i < broker->sessions->len; i++)
+		enchant_session_sum_stats (g_ptr_array_index (broker->sessions, i), totals);
+	g_mutex_unlock (&broker->stats_lock);
+
+	enchant_stats_report (totals, fn, user_data);
+}
+
+uint64_t
+enchant_broker_get_memory_usage (EnchantBroker * broker, EnchantStatsFn fn, void * user_data)
+{
+	g_return_val_if_fail (broker, 0);
+
+	GHashTable *seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	guint64 totals[ENCHANT_N_MEMORY] = { 0 };
+	g_mutex_lock (&broker->stats_lock);
+	for (guint i = 0; i < broker->sessions->len; i++)
+		enchant_session_sum_memory (g_ptr_array_index (broker->sessions, i), seen, totals);
+	g_mutex_unlock (&broker->stats_lock);
+	g_hash_table_destroy (seen);
+	return enchant_memory_report (totals, fn, user_data);
+}
+
+/* one of the provider modules enchant_broker_list_dicts asks */
+typedef struct str_enchant_list_task
+{
+	EnchantBroker *broker;
+	EnchantProviderModule *pm;
+	char **dicts;	/* what it listed, or NULL */
+	char *error;	/* errors are kept per thread, so the caller's takes this over */
+} EnchantListTask;
+
+static void
+enchant_list_task_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantListTask *task = data;
+	EnchantProvider *provider = enchant_broker_load_provider (task->broker, task->pm);
+
+	if (provider && provider->list_dicts)
+		task->dicts = enchant_broker_list_provider_dicts (task->broker, task->pm, provider);
+	task->error = g_strdup (enchant_broker_get_error (task->broker));
+	enchant_broker_clear_error (task->broker);
+}
+
+void
+enchant_broker_list_dicts (EnchantBroker * broker, EnchantDictDescribeFn fn, void * user_data)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (fn);
+
+	GHashTable *tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	enchant_broker_clear_error (broker);
+
+	/* the providers scan their directories or ask their services at
+	 * once; they are gone through in order after */
+	guint n_modules = broker->provider_modules->len;
+	EnchantListTask *tasks = g_new0 (EnchantListTask, n_modules);
+	for (guint j = 0; j < n_modules; j++)
+		{
+			tasks[j].broker = broker;
+			tasks[j].pm = g_ptr_array_index (broker->provider_modules, j);
+		}
+	if (n_modules > 1)
+		{
+			EnchantTaskGroup group = { 0 };
+			for (guint j = 0; j < n_modules; j++)
+				enchant_broker_submit (broker, enchant_list_task_run, &tasks[j], &group);
+			enchant_broker_wait_tasks (broker, &group);
+		}
+	else
+		for (guint j = 0; j < n_modules; j++)
+			enchant_list_task_run (&tasks[j], NULL);
+
+	for (guint j = 0; j < n_modules; j++)
+		{
+			EnchantProviderModule *pm = tasks[j].pm;
+			char ** dicts = tasks[j].dicts;
+
+			/* report the first error any of the providers ran into */
+			if (tasks[j].error)
+				{
+					if (enchant_broker_get_error (broker) == NULL)
+						enchant_broker_set_error (broker, tasks[j].error);
+					g_free (tasks[j].error);
+				}
+
+			if (dicts)
+				{
+					for (size_t i = 0; dicts[i]; i++)
+						{
+							const char * tag;
+
+							tag = dicts[i];
+							if (enchant_is_valid_dictionary_tag (tag)) {
+								gpointer ptr;
+								GPtrArray *providers;
+								gint this_priority;
+
+								providers = enchant_get_ordered_providers (broker, tag);
+								this_priority = enchant_ordered_providers_index (providers, pm);
+								if (this_priority != -1) {
+									gint min_priority;
+
+									min_priority = this_priority + 1;
+									ptr = g_hash_table_lookup (tags, tag);
+									if (ptr != NULL)
+										min_priority = enchant_ordered_providers_index (providers, ptr);
+									if (this_priority < min_priority)
+										g_hash_table_insert (tags, strdup (tag), pm);
+								}
+								g_ptr_array_unref (providers);
+							}
+						}
+
+					g_strfreev (dicts);
+				}
+		}
+	g_free (tasks);
+
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init (&iter, tags);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		{
+			const char * tag, * name, * desc, * file;
+			EnchantProvider * provider;
+			GModule *module;
+
+			tag = (const char *) key;
+			provider = ((EnchantProviderModule *) value)->provider;
+			module = ((EnchantProviderModule *) value)->module;
+			name = (*provider->identify) (provider);
+			desc = (*provider->describe) (provider);
+			file = g_module_name (module);
+			(*fn) (tag, name, desc, file, user_data);
+		}
+
+	g_hash_table_destroy (tags);
+}
+
+void
+enchant_broker_free_dict (EnchantBroker * broker, EnchantDict * dict)
+{
+	g_return_if_fail (broker);
+	g_return_if_fail (dict);
+
+	enchant_broker_clear_error (broker);
+
+	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+	GSList *evicted = NULL;
+
+	g_mutex_lock (&broker->lock);
+	dict_private_data->reference_count--;
+	if(dict_private_data->reference_count == 0)
+		{
+			if (dict_private_data->members)
+				evicted = g_slist_prepend (evicted, dict); /* they are not in dict_map */
+			else if (broker->idle_max > 0)
+				{
+					/* keep it for the next request, but write out its
+					 * changes as freeing it would */
+					enchant_session_flush (dict_private_data->session);
+					dict_private_data->released = g_get_monotonic_time ();
+					g_queue_push_tail (&broker->idle, dict);
+					dict_private_data->idle_link = g_queue_peek_tail_link (&broker->idle);
+				}
+			else
+				{
+					enchant_broker_steal_dict (broker, dict);
+					evicted = g_slist_prepend (evicted, dict);
+				}
+		}
+	evicted = g_slist_concat (evicted, enchant_broker_trim_idle (broker, FALSE));
+	g_mutex_unlock (&broker->lock);
+
+	/* dispose of the dictionaries without keeping other threads waiting */
+	g_slist_free_full (evicted, enchant_dict_destroyed);
+}
+
+static int
+enchant_provider_dictionary_exists (EnchantBroker * broker, EnchantProviderModule * pm,
+				    EnchantProvider * provider, const char * const tag)
+{
+	int exists = 0;
+
+	if (enchant_broker_inventory_has_dict (broker, pm, provider, tag))
+		return 1;
+
+	if (provider->dictionary_exists)
+		{
+			enchant_provider_lock (provider);
+			exists = (*provider->dictionary_exists) (provider, tag);
+			enchant_provider_unlock (provider);
+		}
+	else if (provider->list_dicts)
+		{
+			char ** dicts = enchant_broker_list_provider_dicts (broker, pm, provider);
+
+			for (size_t i = 0; dicts[i]; i++)
+				{
+					if (!strcmp(dicts[i], tag)) {
+						exists = 1;
+						break;
+					}
+				}
+
+			g_strfreev (dicts);
+		}
+
+	return exists;
+}
+
+static int
+_enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag)
+{
+	/* don't query the providers if it is an empty string */
+	if (tag == NULL || *tag == '\0')
+		return 0;
+
+	/* don't query the providers if we can just do a quick map lookup */
+	g_mutex_lock (&broker->lock);
+	gboolean loaded = g_hash_table_contains (broker->dict_map, tag);
+	g_mutex_unlock (&broker->lock);
+	if (loaded)
+		return 1;
+
+	for (guint i = 0; i < broker->provider_modules->len; i++) {
+		EnchantProviderModule *pm = g_ptr_array_index (broker->provider_modules, i);
+		EnchantProvider *provider = enchant_broker_load_provider (broker, pm);
+		if (provider && enchant_provider_dictionary_exists (broker, pm, provider, tag))
+			return 1;
+	}
+
+	return 0;
+}
+
+int
+enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag)
+{
+	g_return_val_if_fail (broker, 0);
+	g_return_val_if_fail (tag && strlen(tag), 0);
+
+	enchant_broker_clear_error (broker);
+
+	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
+	int exists = 0;
+
+	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+		{
+			enchant_broker_set_error (broker, "invalid tag character found");
+		}
+	else if ((exists = _enchant_broker_dict_exists (broker, normalized_tag)) == 0)
+		{
+			char * iso_639_only_tag;
+
+			iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+
+			if (strcmp (normalized_tag, iso_639_only_tag) != 0)
+				{
+					exists = _enchant_broker_dict_exists (broker, iso_639_only_tag);
+				}
+
+			free (iso_639_only_tag);
+		}
+
+	free (normalized_tag);
+	return exists;
+}
+
+const char *
+enchant_dict_get_extra_word_characters (EnchantDict *dict)
+{
+	g_return_val_if_fail (dict, NULL);
+
+	if (!dict->get_extra_word_characters)
+		return "";
+
+	EnchantSession *session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	g_rw_lock_reader_lock (&session->swap_lock);
+	const char *chars = (*dict->get_extra_word_characters) (dict);
+	g_rw_lock_reader_unlock (&session->swap_lock);
+	return chars;
+}
+
+static int
+enchant_is_word_character_default (gunichar uc, size_t n)
+{
+	/* Accept quote marks anywhere except at the end of a word */
+	if (uc == g_utf8_get_char("'") || uc == g_utf8_get_char("’")) {
+		return n < 2;
+	}
+
+	GUnicodeType type = g_unichar_type(uc);
+
+	switch (type) {
+	case G_UNICODE_MODIFIER_LETTER:
+	case G_UNICODE_LOWERCASE_LETTER:
+	case G_UNICODE_TITLECASE_LETTER:
+	case G_UNICODE_UPPERCASE_LETTER:
+	case G_UNICODE_OTHER_LETTER:
+	case G_UNICODE_COMBINING_MARK: /* Older name for G_UNICODE_SPACING_MARK; deprecated since glib 2.30 */
+	case G_UNICODE_ENCLOSING_MARK:
+	case G_UNICODE_NON_SPACING_MARK:
+	case G_UNICODE_DECIMAL_NUMBER:
+	case G_UNICODE_LETTER_NUMBER:
+	case G_UNICODE_OTHER_NUMBER:
+	case G_UNICODE_CONNECT_PUNCTUATION:
+		return 1;     /* Enchant 1.3.0 defines word chars like this. */
+
+	case G_UNICODE_DASH_PUNCTUATION:
+		if ((n == 1) && (type == G_UNICODE_DASH_PUNCTUATION)) {
+			return 1; /* hyphens only accepted within a word. */
+		}
+		/* Fallthrough */
+
+	case G_UNICODE_CONTROL:
+	case G_UNICODE_FORMAT:
+	case G_UNICODE_UNASSIGNED:
+	case G_UNICODE_PRIVATE_USE:
+	case G_UNICODE_SURROGATE:
+	case G_UNICODE_CLOSE_PUNCTUATION:
+	case G_UNICODE_FINAL_PUNCTUATION:
+	case G_UNICODE_INITIAL_PUNCTUATION:
+	case G_UNICODE_OTHER_PUNCTUATION:
+	case G_UNICODE_OPEN_PUNCTUATION:
+	case G_UNICODE_CURRENCY_SYMBOL:
+	case G_UNICODE_MODIFIER_SYMBOL:
+	case G_UNICODE_MATH_SYMBOL:
+	case G_UNICODE_OTHER_SYMBOL:
+	case G_UNICODE_LINE_SEPARATOR:
+	case G_UNICODE_PARAGRAPH_SEPARATOR:
+	case G_UNICODE_SPACE_SEPARATOR:
+	default:
+		return 0;
+	}
+}
+
+static int
+enchant_dict_classify_word_character (EnchantDict * dict, gunichar uc, size_t n)
+{
+	if (dict->is_word_character)
+		{
+			EnchantSession *session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+			g_rw_lock_reader_lock (&session->swap_lock);
+			int result = (*dict->is_word_character) (dict, uc, n);
+			g_rw_lock_reader_unlock (&session->swap_lock);
+			return result;
+		}
+	return enchant_is_word_character_default (uc, n);
+}
+
+/* The first 64k code points' word-character classes, built once per
+ * dictionary, and again after enchant_broker_reload_dict: bit n of an
+ * entry is set if the character is valid at position n, as in
+ * enchant_dict_is_word_character.
+ */
+static const guint8 *
+enchant_dict_get_word_chars (EnchantDict * dict)
 {
-	if (broker->error)
+	EnchantDictPrivateData *priv = (EnchantDictPrivateData*)dict->enchant_private_data;
+	guint8 *word_chars = g_atomic_pointer_get (&priv->word_chars);
+	if (word_chars)
+		return word_chars;
+
+	/* built from one dictionary throughout, and published before a
+	 * reload can retire it, by holding swap_lock while it is built */
+	EnchantSession *session = priv->session;
+	word_chars = g_new0 (guint8, ENCHANT_WORD_CHARACTER_TABLE_SIZE);
+	g_rw_lock_reader_lock (&session->swap_lock);
+	for (gunichar uc = 0; uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE; uc++)
+		for (size_t n = 0; n <= 2; n++)
+			if (dict->is_word_character ? (*dict->is_word_character) (dict, uc, n)
+						    : enchant_is_word_character_default (uc, n))
+				word_chars[uc] |= 1 << n;
+	if (!g_atomic_pointer_compare_and_exchange (&priv->word_chars, NULL, word_chars))
 		{
-			g_free (broker->error);
-			broker->error = NULL;
+			/* another thread got there first */
+			g_free (word_chars);
+			word_chars = g_atomic_pointer_get (&priv->word_chars);
 		}
+	g_rw_lock_reader_unlock (&session->swap_lock);
+
+	return word_chars;
 }
 
-static void
-enchant_broker_set_error (EnchantBroker * broker, const char * const err)
+static inline int
+enchant_dict_lookup_word_character (EnchantDict * dict, const guint8 *word_chars, gunichar uc, size_t n)
 {
-	enchant_broker_clear_error (broker);
-	broker->error = strdup (err);
+	if (uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE)
+		return (word_chars[uc] >> n) & 1;
+	return enchant_dict_classify_word_character (dict, uc, n);
 }
 
-static int
-enchant_provider_is_valid(EnchantProvider * provider)
+int
+enchant_dict_is_word_character (EnchantDict * dict, uint32_t uc_in, size_t n)
 {
-	if (provider == NULL)
-		g_warning ("EnchantProvider cannot be NULL\n");
-	else if (provider->identify == NULL)
-		g_warning ("EnchantProvider's identify method cannot be NULL\n");
-	else if (!g_utf8_validate((*provider->identify)(provider), -1, NULL))
-		g_warning ("EnchantProvider's identify method does not return valid UTF-8.\n");
-	else if (provider->describe == NULL)
-		g_warning ("EnchantProvider's describe method cannot be NULL\n");
-	else if (!g_utf8_validate((*provider->describe)(provider), -1, NULL))
-		g_warning ("EnchantProvider's describe method does not return valid UTF-8.\n");
-	else if (provider->dispose == NULL)
-		g_warning ("EnchantProvider's dispose method cannot be NULL\n");
-	else if (provider->dispose_dict == NULL)
-		g_warning ("EnchantProvider's dispose_dict method cannot be NULL\n");
-	else if (provider->list_dicts == NULL)
-		g_warning ("EnchantProvider's list_dicts method cannot be NULL\n");
-	else
-		return 1;
+	g_return_val_if_fail (n <= 2, 0);
 
-	return 0;
+	if (dict)
+		return enchant_dict_lookup_word_character (dict, enchant_dict_get_word_chars (dict),
+							   (gunichar)uc_in, n);
+
+	return enchant_is_word_character_default ((gunichar)uc_in, n);
 }
 
-static void
-enchant_load_providers_in_dir (EnchantBroker * broker, const char *dir_name)
+const uint8_t *
+enchant_dict_get_word_character_table (EnchantDict * dict)
 {
-	GDir *dir = g_dir_open (dir_name, 0, NULL);
-	if (!dir)
-		return;
+	static guint8 *default_word_chars = NULL;
 
-	size_t g_module_suffix_len = strlen (G_MODULE_SUFFIX);
-	const char *dir_entry;
-	while ((dir_entry = g_dir_read_name (dir)) != NULL)
+	if (dict)
+		return enchant_dict_get_word_chars (dict);
+
+	if (g_once_init_enter (&default_word_chars))
 		{
-			GModule *module = NULL;
-			EnchantProvider *provider = NULL;
+			guint8 *word_chars = g_new0 (guint8, ENCHANT_WORD_CHARACTER_TABLE_SIZE);
+			for (gunichar uc = 0; uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE; uc++)
+				for (size_t n = 0; n <= 2; n++)
+					if (enchant_is_word_character_default (uc, n))
+						word_chars[uc] |= 1 << n;
+			g_once_init_leave (&default_word_chars, word_chars);
+		}
 
-			size_t entry_len = strlen (dir_entry);
-			if ((entry_len > g_module_suffix_len) &&
-				!strcmp(dir_entry+(entry_len-g_module_suffix_len), G_MODULE_SUFFIX))
-				{
-#ifdef _WIN32
-					/* Suppress error popups for failing to load plugins */
-					UINT old_error_mode = SetErrorMode(SEM_FAILCRITICALERRORS);
-#endif
-					char * filename = g_build_filename (dir_name, dir_entry, NULL);
-					module = g_module_open (filename, (GModuleFlags) 0);
-					if (module)
-						{
-							EnchantProviderInitFunc init_func;
-							if (g_module_symbol (module, "init_enchant_provider", (gpointer *) (&init_func))
-							    && init_func)
-								{
-									provider = init_func ();
-									if (!enchant_provider_is_valid(provider))
-										{
-											g_warning ("Error loading plugin: %s's init_enchant_provider returned invalid provider.\n", dir_entry);
-											if(provider)
-												{
-													provider->dispose(provider);
-													provider = NULL;
-												}
-											g_module_close (module);
-										}
-								}
-							else
-								{
-									g_module_close (module);
-								}
-						}
-					else
-						{
-							g_warning ("Error loading plugin: %s\n", g_module_error());
-						}
+	return default_word_chars;
+}
 
-					g_free (filename);
-#ifdef _WIN32
-					/* Restore the original error mode */
-					SetErrorMode(old_error_mode);
-#endif
-				}
-			if (provider)
-				{
-					/* optional entry point to allow modules to look for associated files */
-					EnchantPreConfigureFunc conf_func;
-					if (g_module_symbol (module, "configure_enchant_provider", (gpointer *) (&conf_func))
-					    && conf_func)
-						{
-							conf_func (provider, dir_name);
-							if (!enchant_provider_is_valid(provider))
-								{
-									g_warning ("Error loading plugin: %s's configure_enchant_provider modified provider and it is now invalid.\n", dir_entry);
-									provider->dispose(provider);
-									provider = NULL;
-									g_module_close (module);
-								}
-						}
-				}
-			if (provider)
+const uint16_t *
+enchant_get_lowercase_table (void)
+{
+	static guint16 *lowercase = NULL;
+
+	if (g_once_init_enter (&lowercase))
+		{
+			guint16 *table = g_new (guint16, ENCHANT_WORD_CHARACTER_TABLE_SIZE);
+			for (gunichar uc = 0; uc < ENCHANT_WORD_CHARACTER_TABLE_SIZE; uc++)
 				{
-					provider->enchant_private_data = (void *) module;
-					provider->owner = broker;
-					broker->provider_list = g_slist_append (broker->provider_list, (gpointer)provider);
+					gunichar lower = g_unichar_tolower (uc);
+					table[uc] = lower < ENCHANT_WORD_CHARACTER_TABLE_SIZE ? lower : uc;
 				}
+			g_once_init_leave (&lowercase, table);
 		}
 
-	g_dir_close (dir);
+	return lowercase;
 }
 
-static void
-enchant_load_providers (EnchantBroker * broker)
+/* A word of a text, as byte and character offsets into it */
+typedef struct {
+	size_t offset;
+	size_t len;
+	size_t char_offset;
+	size_t char_len;
+} EnchantTextWord;
+
+/* Takes one step of splitting a text into words, from *p to the end:
+ * skips a character that cannot start a word, or a run of word
+ * characters, telling in word what is left of the run once the
+ * characters that cannot end a word are taken off its end.  Splitting
+ * only ever starts again where a step left off, so it can be resumed
+ * from any word's start.
+ */
+static gboolean
+enchant_text_next_word (EnchantDict * dict, const guint8 *word_chars, const char *text, const char *end,
+			const char **p_inout, size_t *char_offset_inout, EnchantTextWord *word)
 {
-	char *module_dir = enchant_relocate (PKGLIBDIR "-" ENCHANT_MAJOR_VERSION);
-	if (module_dir)
-		enchant_load_providers_in_dir (broker, module_dir);
-	free (module_dir);
-}
+	const char *p = *p_inout;
+	size_t char_offset = *char_offset_inout;
+	const char *start = p;
+	size_t start_char = char_offset;
+
+	/* Skip over word characters. */
+	if (enchant_dict_lookup_word_character (dict, word_chars, g_utf8_get_char (p), 0))
+		while (p < end && enchant_dict_lookup_word_character (dict, word_chars, g_utf8_get_char (p), 1))
+			{
+				p = g_utf8_next_char (p);
+				char_offset++;
+			}
 
-static void
-enchant_load_ordering_from_file (EnchantBroker * broker, const char * file)
-{
-	GIOChannel * ch = g_io_channel_new_file (file, "r", NULL);
-	if (!ch)
-		return;
+	if (p == start)
+		{
+			/* Skip a non-word character. */
+			*p_inout = g_utf8_next_char (p);
+			*char_offset_inout = char_offset + 1;
+			return FALSE;
+		}
+	*p_inout = p;
+	*char_offset_inout = char_offset;
 
-	gchar *line;
-	gsize terminator;
-	while (G_IO_STATUS_NORMAL == g_io_channel_read_line (ch, &line, NULL, &terminator, NULL)) {
-		char *colon = strchr (line, ':');
-		if (colon != NULL)
-			{
-				char * tag = g_strndup (line, colon - line);
-				char * ordering = g_strndup (colon + 1, terminator - 1);
-				enchant_broker_set_ordering (broker, tag, ordering);
+	/* Skip backwards over any characters that can't appear at the end of a word. */
+	const char *word_end = p;
+	size_t word_end_char = char_offset;
+	while (word_end > start)
+		{
+			const char *prev = g_utf8_prev_char (word_end);
+			if (enchant_dict_lookup_word_character (dict, word_chars, g_utf8_get_char (prev), 2))
+				break;
+			word_end = prev;
+			word_end_char--;
+		}
 
-				g_free (tag);
-				g_free (ordering);
-			}
-		g_free (line);
-	}
+	if (word_end == start)
+		return FALSE;
 
-	g_io_channel_unref (ch);
+	word->offset = start - text;
+	word->len = word_end - start;
+	word->char_offset = start_char;
+	word->char_len = word_end_char - start_char;
+	return TRUE;
 }
 
-static void
-enchant_load_provider_ordering (EnchantBroker * broker)
+/* Splits @text into words the way the enchant program splits its
+ * lines, and the way enchant_dict_is_word_character describes.
+ */
+static GArray *
+enchant_text_split_words (EnchantDict * dict, const char *text, size_t len)
 {
-	broker->provider_ordering = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	GArray *words = g_array_new (FALSE, FALSE, sizeof (EnchantTextWord));
+	const guint8 *word_chars = enchant_dict_get_word_chars (dict);
+	const char *end = text + len;
+	const char *p = text;
+	size_t char_offset = 0;
 
-	GSList *conf_dirs = enchant_get_conf_dirs ();
-	for (GSList *iter = conf_dirs; iter; iter = iter->next)
+	while (p < end)
 		{
-			char *ordering_file = g_build_filename (iter->data, "enchant.ordering", NULL);
-			enchant_load_ordering_from_file (broker, ordering_file);
-			g_free (ordering_file);
+			EnchantTextWord word;
+			if (enchant_text_next_word (dict, word_chars, text, end, &p, &char_offset, &word))
+				g_array_append_val (words, word);
 		}
 
-	g_slist_free_full (conf_dirs, g_free);
+	return words;
 }
 
-static GSList *
-enchant_get_ordered_providers (EnchantBroker * broker, const char * const tag)
+int
+enchant_dict_check_text (EnchantDict * dict, const char *const text, ssize_t len,
+			 EnchantMisspellingFn fn, void * user_data)
 {
-	char * ordering = (char *)g_hash_table_lookup (broker->provider_ordering, (gpointer)tag);
-	if (!ordering)
-		ordering = (char *)g_hash_table_lookup (broker->provider_ordering, (gpointer)"*");
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (text, -1);
 
-	GSList * list = NULL;
+	if (len < 0)
+		len = strlen (text);
 
-	if (ordering)
-		{
-			char **tokens = g_strsplit (ordering, ",", 0);
-			if (tokens)
-				{
-					for (size_t i = 0; tokens[i]; i++)
-						{
-							char *token = g_strstrip(tokens[i]);
+	g_return_val_if_fail (enchant_utf8_validate(text, len, NULL), -1);
 
-							for (GSList * iter = broker->provider_list; iter != NULL; iter = g_slist_next (iter))
-								{
-									EnchantProvider *provider = (EnchantProvider*)iter->data;
-									if (provider && !strcmp (token, (*provider->identify)(provider)))
-										list = g_slist_append (list, (gpointer)provider);
-								}
-						}
-					g_strfreev (tokens);
-				}
-		}
+	GArray *text_words = enchant_text_split_words (dict, text, len);
+	size_t n_words = text_words->len;
 
-	/* append providers not in the list, or from an unordered list */
-	for (GSList * iter = broker->provider_list; iter != NULL; iter = g_slist_next (iter))
+	const char **words = g_new (const char *, MAX (n_words, 1));
+	ssize_t *lens = g_new (ssize_t, MAX (n_words, 1));
+	int *results = g_new (int, MAX (n_words, 1));
+	for (size_t i = 0; i < n_words; i++)
 		{
-			if (!g_slist_find (list, iter->data))
-				list = g_slist_append (list, iter->data);
+			EnchantTextWord *word = &g_array_index (text_words, EnchantTextWord, i);
+			words[i] = text + word->offset;
+			lens[i] = word->len;
 		}
 
-	return list;
-}
+	enchant_dict_check_batch (dict, words, lens, n_words, results);
 
-static void
-enchant_dict_destroyed (gpointer data)
-{
-	g_return_if_fail (data);
+	/* report nothing if the backend failed, so that the error stays put */
+	int n_misspelled = 0;
+	for (size_t i = 0; i < n_words && n_misspelled >= 0; i++)
+		if (results[i] < 0)
+			n_misspelled = -1;
+		else if (results[i] > 0)
+			n_misspelled++;
 
-	EnchantDict *dict = (EnchantDict *) data;
-	EnchantDictPrivateData *enchant_dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
-	EnchantSession *session = enchant_dict_private_data->session;
-	EnchantProvider *owner = session->provider;
+	/* what was found in the text checked before is not wanted any more */
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_cancel_prefetches (session, NULL);
+	for (size_t i = 0; i < n_words && n_misspelled > 0; i++)
+		if (results[i] > 0)
+			enchant_session_prefetch (session, dict, words[i], lens[i], NULL);
 
-	if (owner)
-		(*owner->dispose_dict) (owner, dict);
-	else if(session->is_pwl)
-		g_free (dict);
+	for (size_t i = 0; i < n_words && n_misspelled > 0 && fn; i++)
+		if (results[i] > 0)
+			{
+				EnchantTextWord *word = &g_array_index (text_words, EnchantTextWord, i);
+				(*fn) (dict, words[i], word->len, word->offset,
+				       word->char_offset, word->char_len, user_data);
+			}
 
-	g_free(enchant_dict_private_data);
+	g_free (words);
+	g_free (lens);
+	g_free (results);
+	g_array_free (text_words, TRUE);
 
-	enchant_session_destroy (session);
+	return n_misspelled;
 }
 
-static void
-enchant_provider_free (gpointer data)
+int
+enchant_dict_split_text (EnchantDict * dict, const char *const text, ssize_t len,
+			 EnchantTextWordFn fn, void * user_data)
 {
-	g_return_if_fail (data);
-
-	EnchantProvider *provider = (EnchantProvider *) data;
-	GModule *module = (GModule *) provider->enchant_private_data;
-	(*provider->dispose) (provider);
+	g_return_val_if_fail (dict, -1);
+	g_return_val_if_fail (text, -1);
 
-	/* close module only after invoking dispose */
-	g_module_close (module);
-}
+	if (len < 0)
+		len = strlen (text);
 
-EnchantBroker *
-enchant_broker_init (void)
-{
-	g_return_val_if_fail (g_module_supported (), NULL);
+	if (!enchant_utf8_validate (text, len, NULL))
+		return -1;
 
-	EnchantBroker *broker = g_new0 (EnchantBroker, 1);
-	broker->dict_map = g_hash_table_new_full (g_str_hash, g_str_equal,
-						  g_free, enchant_dict_destroyed);
-	enchant_load_providers (broker);
-	enchant_load_provider_ordering (broker);
+	GArray *text_words = enchant_text_split_words (dict, text, len);
+	int n_words = text_words->len;
+	for (guint i = 0; i < text_words->len && fn; i++)
+		{
+			EnchantTextWord *word = &g_array_index (text_words, EnchantTextWord, i);
+			(*fn) (dict, text + word->offset, word->len, word->offset,
+			       word->char_offset, word->char_len, user_data);
+		}
+	g_array_free (text_words, TRUE);
 
-	return broker;
+	return n_words;
 }
 
-void
-enchant_broker_free (EnchantBroker * broker)
+/* what the verdicts of dict depend on, those of its members included;
+ * each part only ever grows, so sums of them do too */
+static void
+enchant_dict_get_stamp (EnchantDict * dict, EnchantWordCacheStamp * stamp)
 {
-	g_return_if_fail (broker);
+	EnchantDictPrivateData *priv = (EnchantDictPrivateData*)dict->enchant_private_data;
+	enchant_session_get_stamp (priv->session, TRUE, stamp);
+	for (size_t i = 0; i < priv->n_members; i++)
+		{
+			EnchantWordCacheStamp member;
+			enchant_dict_get_stamp (priv->members[i], &member);
+			stamp->session += member.session;
+			stamp->personal += member.personal;
+			stamp->exclude += member.exclude;
+		}
+}
 
-	guint n_remaining = g_hash_table_size (broker->dict_map);
-	if (n_remaining)
-		g_warning ("%u dictionaries weren't free'd.\n", n_remaining);
+/* a word of an EnchantTextChecker's text, and what checking it gave */
+typedef struct {
+	EnchantTextWord word;
+	int result;		/* as enchant_dict_check's, or ENCHANT_TEXT_UNCHECKED */
+} EnchantCheckedWord;
 
-	/* will destroy any remaining dictionaries for us */
-	g_hash_table_destroy (broker->dict_map);
-	g_hash_table_destroy (broker->provider_ordering);
+#define ENCHANT_TEXT_UNCHECKED (-2)
 
-	g_slist_free_full (broker->provider_list, enchant_provider_free);
-	enchant_broker_clear_error (broker);
-	g_free (broker);
-}
+struct str_enchant_text_checker
+{
+	EnchantDict *dict;
+	GString *text;
+	GArray *words;		/* of EnchantCheckedWord, in order */
+	EnchantWordCacheStamp stamp;	/* of the dictionary when the results were worked out */
+};
 
-EnchantDict *
-enchant_broker_request_pwl_dict (EnchantBroker * broker, const char *const pwl)
+EnchantTextChecker *
+enchant_text_checker_new (EnchantDict * dict, const char *const text, ssize_t len)
 {
-	g_return_val_if_fail (broker, NULL);
-	g_return_val_if_fail (pwl && strlen(pwl), NULL);
+	g_return_val_if_fail (dict, NULL);
+	g_return_val_if_fail (text || len == 0, NULL);
 
-	enchant_broker_clear_error (broker);
+	if (text == NULL)
+		len = 0;
+	else if (len < 0)
+		len = strlen (text);
 
-	EnchantDict *dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) pwl);
-	if (dict) {
-		((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
-		return dict;
-	}
+	g_return_val_if_fail (len == 0 || enchant_utf8_validate(text, len, NULL), NULL);
 
-	/* since the broker pwl file is a read/write file (there is no readonly dictionary associated)
-	 * there is no need for complementary exclude file to add a word to. The word just needs to be
-	 * removed from the broker pwl file
-	 */
-	EnchantSession *session = enchant_session_new_with_pwl (NULL, pwl, NULL, "Personal Wordlist", TRUE);
-	if (!session)
+	EnchantTextChecker *checker = g_new0 (EnchantTextChecker, 1);
+	checker->dict = dict;
+	checker->text = g_string_new_len (text ? text : "", len);
+	checker->words = g_array_new (FALSE, FALSE, sizeof (EnchantCheckedWord));
+
+	GArray *text_words = enchant_text_split_words (dict, checker->text->str, len);
+	g_array_set_size (checker->words, text_words->len);
+	for (guint i = 0; i < text_words->len; i++)
 		{
-			broker->error = g_strdup_printf ("Couldn't open personal wordlist '%s'", pwl);
-			return NULL;
+			EnchantCheckedWord *word = &g_array_index (checker->words, EnchantCheckedWord, i);
+			word->word = g_array_index (text_words, EnchantTextWord, i);
+			word->result = ENCHANT_TEXT_UNCHECKED;
 		}
+	g_array_free (text_words, TRUE);
 
-	session->is_pwl = 1;
-
-	dict = g_new0 (EnchantDict, 1);
-	EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
-	enchant_dict_private_data->reference_count = 1;
-	enchant_dict_private_data->session = session;
-	dict->enchant_private_data = (void *)enchant_dict_private_data;
+	return checker;
+}
 
-	g_hash_table_insert (broker->dict_map, (gpointer)strdup (pwl), dict);
+void
+enchant_text_checker_free (EnchantTextChecker * checker)
+{
+	g_return_if_fail (checker);
 
-	return dict;
+	EnchantSession * session = ((EnchantDictPrivateData*)checker->dict->enchant_private_data)->session;
+	enchant_session_cancel_prefetches (session, checker);
+	g_string_free (checker->text, TRUE);
+	g_array_free (checker->words, TRUE);
+	g_free (checker);
 }
 
-static EnchantDict *
-_enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+const char *
+enchant_text_checker_get_text (EnchantTextChecker * checker, size_t * out_len)
 {
-	EnchantDict *dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, (gpointer) tag);
-	if (dict) {
-		((EnchantDictPrivateData*)dict->enchant_private_data)->reference_count++;
-		return dict;
-	}
+	g_return_val_if_fail (checker, NULL);
+
+	if (out_len)
+		*out_len = checker->text->len;
+	return checker->text->str;
+}
 
-	GSList * list = enchant_get_ordered_providers (broker, tag);
-	for (GSList *listIter = list; listIter != NULL; listIter = g_slist_next (listIter))
+/* the index of the first word starting at offset or after it */
+static guint
+enchant_text_checker_find_word (EnchantTextChecker * checker, size_t offset)
+{
+	guint lo = 0, hi = checker->words->len;
+	while (lo < hi)
 		{
-			EnchantProvider * provider;
+			guint mid = lo + (hi - lo) / 2;
+			if (g_array_index (checker->words, EnchantCheckedWord, mid).word.offset < offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	return lo;
+}
 
-			provider = (EnchantProvider *) listIter->data;
+static gboolean
+enchant_utf8_is_boundary (const char *text, size_t len, size_t offset)
+{
+	return offset == len || (((guchar) text[offset]) & 0xc0) != 0x80;
+}
 
-			if (provider->request_dict)
+int
+enchant_text_checker_edit (EnchantTextChecker * checker, size_t offset, size_t deleted,
+			   const char *const inserted, ssize_t len)
+{
+	g_return_val_if_fail (checker, -1);
+	g_return_val_if_fail (inserted || len <= 0, -1);
+
+	if (inserted == NULL)
+		len = 0;
+	else if (len < 0)
+		len = strlen (inserted);
+
+	GString *text = checker->text;
+	g_return_val_if_fail (offset <= text->len && deleted <= text->len - offset, -1);
+	g_return_val_if_fail (enchant_utf8_is_boundary (text->str, text->len, offset), -1);
+	g_return_val_if_fail (enchant_utf8_is_boundary (text->str, text->len, offset + deleted), -1);
+	g_return_val_if_fail (len == 0 || enchant_utf8_validate(inserted, len, NULL), -1);
+
+	EnchantSession * session = ((EnchantDictPrivateData*)checker->dict->enchant_private_data)->session;
+	enchant_session_cancel_prefetches (session, checker);
+
+	/* Splitting starts again at the start of the word before the edit,
+	 * which may run on into it, or at the edit if there is none, and
+	 * the words from there up to the first one after the edit that it
+	 * comes to the start of again are replaced.  The words after that
+	 * split as they did, only further on. */
+	GArray *words = checker->words;
+	guint first = enchant_text_checker_find_word (checker, offset);
+	const char *p;
+	size_t char_offset;
+	if (first > 0)
+		{
+			first--;
+			EnchantTextWord *before = &g_array_index (words, EnchantCheckedWord, first).word;
+			p = text->str + before->offset;
+			char_offset = before->char_offset;
+		}
+	else
+		{
+			p = text->str + offset;
+			char_offset = g_utf8_strlen (text->str, offset);
+		}
+	size_t p_offset = p - text->str;
+	guint next = enchant_text_checker_find_word (checker, offset + deleted);
+
+	ssize_t delta = len - (ssize_t) deleted;
+	ssize_t char_delta = (ssize_t) (len ? g_utf8_strlen (inserted, len) : 0) -
+		(ssize_t) g_utf8_strlen (text->str + offset, deleted);
+	g_string_erase (text, offset, deleted);
+	g_string_insert_len (text, offset, inserted ? inserted : "", len);
+
+	const guint8 *word_chars = enchant_dict_get_word_chars (checker->dict);
+	const char *end = text->str + text->len;
+	const char *edit_end = text->str + offset + len;
+	GArray *split = g_array_new (FALSE, FALSE, sizeof (EnchantCheckedWord));
+	p = text->str + p_offset;
+	while (p < end)
+		{
+			if (p >= edit_end)
 				{
-					dict = (*provider->request_dict) (provider, tag);
-
-					if (dict)
-						{
+					size_t old_offset = (p - text->str) - delta;
+					while (next < words->len &&
+					       g_array_index (words, EnchantCheckedWord, next).word.offset < old_offset)
+						next++;
+					if (next < words->len &&
+					    g_array_index (words, EnchantCheckedWord, next).word.offset == old_offset)
+						break;
+				}
 
-							EnchantSession *session = enchant_session_new (provider, tag);
-							EnchantDictPrivateData *enchant_dict_private_data = g_new0 (EnchantDictPrivateData, 1);
-							enchant_dict_private_data->reference_count = 1;
-							enchant_dict_private_data->session = session;
-							dict->enchant_private_data = (void *)enchant_dict_private_data;
-							g_hash_table_insert (broker->dict_map, (gpointer)strdup (tag), dict);
-							break;
-						}
+			EnchantCheckedWord word;
+			if (enchant_text_next_word (checker->dict, word_chars, text->str, end, &p, &char_offset, &word.word))
+				{
+					word.result = ENCHANT_TEXT_UNCHECKED;
+					g_array_append_val (split, word);
 				}
 		}
-	g_slist_free (list);
+	if (p >= end)
+		next = words->len;
 
-	return dict;
+	g_array_remove_range (words, first, next - first);
+	g_array_insert_vals (words, first, split->data, split->len);
+	for (guint i = first + split->len; i < words->len; i++)
+		{
+			EnchantTextWord *word = &g_array_index (words, EnchantCheckedWord, i).word;
+			word->offset += delta;
+			word->char_offset += char_delta;
+		}
+	g_array_free (split, TRUE);
+
+	return 0;
 }
 
-EnchantDict *
-enchant_broker_request_dict (EnchantBroker * broker, const char *const tag)
+int
+enchant_text_checker_check (EnchantTextChecker * checker, EnchantMisspellingFn fn, void * user_data)
 {
-	EnchantDict *dict = NULL;
+	g_return_val_if_fail (checker, -1);
 
-	g_return_val_if_fail (broker, NULL);
-	g_return_val_if_fail (tag && strlen(tag), NULL);
+	EnchantDict *dict = checker->dict;
+	GArray *words = checker->words;
 
-	enchant_broker_clear_error (broker);
+	/* a change to the words added or removed makes every verdict stale */
+	EnchantWordCacheStamp stamp;
+	enchant_dict_get_stamp (dict, &stamp);
+	if (memcmp (&stamp, &checker->stamp, sizeof (stamp)) != 0)
+		{
+			for (guint i = 0; i < words->len; i++)
+				g_array_index (words, EnchantCheckedWord, i).result = ENCHANT_TEXT_UNCHECKED;
+			checker->stamp = stamp;
+		}
 
-	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
-	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+	size_t n_unchecked = 0;
+	for (guint i = 0; i < words->len; i++)
+		if (g_array_index (words, EnchantCheckedWord, i).result == ENCHANT_TEXT_UNCHECKED)
+			n_unchecked++;
+
+	if (n_unchecked != 0)
 		{
-			enchant_broker_set_error (broker, "invalid tag character found");
+			const char **batch = g_new (const char *, n_unchecked);
+			ssize_t *lens = g_new (ssize_t, n_unchecked);
+			guint *indexes = g_new (guint, n_unchecked);
+			int *results = g_new (int, n_unchecked);
+			size_t n = 0;
+			for (guint i = 0; i < words->len; i++)
+				{
+					EnchantCheckedWord *word = &g_array_index (words, EnchantCheckedWord, i);
+					if (word->result != ENCHANT_TEXT_UNCHECKED)
+						continue;
+					batch[n] = checker->text->str + word->word.offset;
+					lens[n] = word->word.len;
+					indexes[n++] = i;
+				}
+
+			enchant_dict_check_batch (dict, batch, lens, n, results);
+
+			/* keep nothing if the backend failed, so that the error
+			 * stays put and the words are checked again next time */
+			gboolean failed = FALSE;
+			for (size_t i = 0; i < n && !failed; i++)
+				failed = results[i] < 0;
+			for (size_t i = 0; i < n && !failed; i++)
+				g_array_index (words, EnchantCheckedWord, indexes[i]).result = results[i];
+
+			g_free (batch);
+			g_free (lens);
+			g_free (indexes);
+			g_free (results);
+			if (failed)
+				return -1;
 		}
-	else if ((dict = _enchant_broker_request_dict (broker, normalized_tag)) == NULL)
+
+	EnchantSession * session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	int n_misspelled = 0;
+	for (guint i = 0; i < words->len; i++)
 		{
-			char * iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
-			dict = _enchant_broker_request_dict (broker, iso_639_only_tag);
-			free (iso_639_only_tag);
+			EnchantCheckedWord *word = &g_array_index (words, EnchantCheckedWord, i);
+			if (word->result <= 0)
+				continue;
+			n_misspelled++;
+			enchant_session_prefetch (session, dict, checker->text->str + word->word.offset,
+						  word->word.len, checker);
+			if (fn)
+				(*fn) (dict, checker->text->str + word->word.offset, word->word.len, word->word.offset,
+				       word->word.char_offset, word->word.char_len, user_data);
 		}
-	free (normalized_tag);
 
-	return dict;
+	return n_misspelled;
 }
 
 void
-enchant_broker_describe (EnchantBroker * broker, EnchantBrokerDescribeFn fn, void * user_data)
+enchant_broker_set_ordering (EnchantBroker * broker, const char * const tag, const char * const ordering)
 {
 	g_return_if_fail (broker);
-	g_return_if_fail (fn);
+	g_return_if_fail (tag && strlen(tag));
+	g_return_if_fail (ordering && strlen(ordering));
 
 	enchant_broker_clear_error (broker);
 
-	for (GSList *list = broker->provider_list; list != NULL; list = g_slist_next (list))
+	char *tag_dupl = enchant_normalize_dictionary_tag (tag);
+	char *ordering_dupl = g_strstrip (g_strdup (ordering));
+
+	if (tag_dupl && strlen(tag_dupl) &&
+		ordering_dupl && strlen(ordering_dupl))
 		{
-			EnchantProvider *provider = (EnchantProvider *) list->data;
-			GModule *module = (GModule *) provider->enchant_private_data;
+			/* parse the ordering once, here, rather than on each request;
+			 * the providers of a group, as in "hunspell|nuspell", are ranked */
+			char **tokens = g_strsplit (ordering_dupl, ",", 0);
+			GPtrArray *names = g_ptr_array_new ();
+			GArray *tiers = g_array_new (FALSE, FALSE, sizeof (guint));
+			gboolean grouped = FALSE;
+			for (guint i = 0; tokens[i]; i++)
+				{
+					char **group = g_strsplit (tokens[i], "|", 0);
+					guint n_grouped = 0;
+					for (size_t j = 0; group[j]; j++)
+						{
+							char *name = g_strstrip (group[j]);
+							if (*name)
+								{
+									g_ptr_array_add (names, g_strdup (name));
+									g_array_append_val (tiers, i);
+									n_grouped++;
+								}
+						}
+					grouped = grouped || n_grouped > 1;
+					g_strfreev (group);
+				}
+			g_strfreev (tokens);
+			g_ptr_array_add (names, NULL);
 
-			const char *name = (*provider->identify) (provider);
-			const char *desc = (*provider->describe) (provider);
-			const char *file = g_module_name (module);
+			EnchantOrdering *parsed = g_new0 (EnchantOrdering, 1);
+			parsed->names = (char **) g_ptr_array_free (names, FALSE);
+			parsed->tiers = (guint *) g_array_free (tiers, !grouped);
 
-			(*fn) (name, desc, file, user_data);
+			if (grouped)
+				{
+					g_mutex_lock (&broker->stats_lock);
+					broker->adaptive = TRUE;
+					g_mutex_unlock (&broker->stats_lock);
+				}
+
+			/* we will free parsed && tag_dupl when the hash is destroyed */
+			g_mutex_lock (&broker->lock);
+			g_hash_table_insert (broker->provider_ordering, (gpointer)tag_dupl,
+					     (gpointer)parsed);
+			broker->ordering_generation++;
+			g_mutex_unlock (&broker->lock);
 		}
+	else
+		g_free (tag_dupl);
+	g_free (ordering_dupl);
+}
+
+static void
+enchant_broker_dict_set_write_behind (gpointer key _GL_UNUSED_PARAMETER, gpointer value, gpointer user_data)
+{
+	EnchantDict *dict = (EnchantDict *) value;
+	EnchantSession *session = ((EnchantDictPrivateData*)dict->enchant_private_data)->session;
+	enchant_session_set_write_behind (session, GPOINTER_TO_INT (user_data));
 }
 
 void
-enchant_broker_list_dicts (EnchantBroker * broker, EnchantDictDescribeFn fn, void * user_data)
+enchant_broker_set_write_behind (EnchantBroker * broker, int enabled)
 {
 	g_return_if_fail (broker);
-	g_return_if_fail (fn);
-
-	GHashTable *tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-	enchant_broker_clear_error (broker);
+	g_mutex_lock (&broker->lock);
+	broker->write_behind = enabled != 0;
+	g_hash_table_foreach (broker->dict_map, enchant_broker_dict_set_write_behind,
+			      GINT_TO_POINTER (broker->write_behind));
+	g_mutex_unlock (&broker->lock);
+}
 
-	for (GSList *list = broker->provider_list; list != NULL; list = g_slist_next (list))
-		{
-			EnchantProvider *provider = (EnchantProvider *) list->data;
+void
+enchant_broker_set_executor (EnchantBroker * broker, EnchantExecutorFn fn, void * user_data)
+{
+	g_return_if_fail (broker);
 
-			if (provider->list_dicts)
-				{
-					size_t n_dicts;
-					char ** dicts = (*provider->list_dicts) (provider, &n_dicts);
+	g_mutex_lock (&broker->tasks_lock);
+	broker->executor = fn;
+	broker->executor_data = user_data;
+	g_mutex_unlock (&broker->tasks_lock);
+}
 
-					for (size_t i = 0; i < n_dicts; i++)
-						{
-							const char * tag;
+void
+enchant_broker_set_worker_threads (EnchantBroker * broker, int n_threads)
+{
+	g_return_if_fail (broker);
 
-							tag = dicts[i];
-							if (enchant_is_valid_dictionary_tag (tag)) {
-								gpointer ptr;
-								GSList *providers;
-								gint this_priority;
+	g_mutex_lock (&broker->tasks_lock);
+	broker->n_workers = n_threads > 0 ? (guint) n_threads : g_get_num_processors ();
+	if (broker->workers)
+		g_thread_pool_set_max_threads (broker->workers, (gint) broker->n_workers, NULL);
+	g_mutex_unlock (&broker->tasks_lock);
+}
 
-								providers = enchant_get_ordered_providers (broker, tag);
-								this_priority = g_slist_index (providers, provider);
-								if (this_priority != -1) {
-									gint min_priority;
+typedef struct str_enchant_preload
+{
+	EnchantBroker *broker;
+	char *tag;
+	EnchantPreloadFn fn;
+	void *user_data;
+} EnchantPreload;
 
-									min_priority = this_priority + 1;
-									ptr = g_hash_table_lookup (tags, tag);
-									if (ptr != NULL)
-										min_priority = g_slist_index (providers, ptr);
-									if (this_priority < min_priority)
-										g_hash_table_insert (tags, strdup (tag), provider);
-								}
-								g_slist_free (providers);
-							}
-						}
+static void
+enchant_broker_preload_run (gpointer data, gpointer user_data _GL_UNUSED_PARAMETER)
+{
+	EnchantPreload *preload = (EnchantPreload *) data;
+	EnchantBroker *broker = preload->broker;
 
-					enchant_free_string_list (dicts);
+	EnchantDict *dict = enchant_broker_request_dict (broker, preload->tag);
+	if (dict)
+		{
+			/* keep the reference for the first request, unless an
+			 * earlier preload already does */
+			EnchantDictPrivateData *dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
+			g_mutex_lock (&broker->lock);
+			if (dict_private_data->preloaded)
+				dict_private_data->reference_count--;
+			else
+				{
+					dict_private_data->preloaded = TRUE;
+					broker->n_preloaded++;
 				}
+			g_mutex_unlock (&broker->lock);
 		}
 
-	GHashTableIter iter;
-	gpointer key, value;
-	g_hash_table_iter_init (&iter, tags);
-	while (g_hash_table_iter_next (&iter, &key, &value))
-		{
-			const char * tag, * name, * desc, * file;
-			EnchantProvider * provider;
-			GModule *module;
-
-			tag = (const char *) key;
-			provider = (EnchantProvider *) value;
-			module = (GModule *) provider->enchant_private_data;
-			name = (*provider->identify) (provider);
-			desc = (*provider->describe) (provider);
-			file = g_module_name (module);
-			(*fn) (tag, name, desc, file, user_data);
-		}
+	if (preload->fn)
+		(*preload->fn) (preload->tag, dict != NULL, preload->user_data);
 
-	g_hash_table_destroy (tags);
+	g_free (preload->tag);
+	g_free (preload);
 }
 
 void
-enchant_broker_free_dict (EnchantBroker * broker, EnchantDict * dict)
+enchant_broker_preload (EnchantBroker * broker, const char * const * tags, size_t n_tags,
+			EnchantPreloadFn fn, void * user_data)
 {
 	g_return_if_fail (broker);
-	g_return_if_fail (dict);
+	g_return_if_fail (tags || n_tags == 0);
 
 	enchant_broker_clear_error (broker);
 
-	EnchantDictPrivateData * dict_private_data = (EnchantDictPrivateData*)dict->enchant_private_data;
-	dict_private_data->reference_count--;
-	if(dict_private_data->reference_count == 0)
+	for (size_t i = 0; i < n_tags; i++)
 		{
-			EnchantSession * session = dict_private_data->session;
+			if (tags[i] == NULL || *tags[i] == '\0')
+				continue;
 
-			if (session->provider)
-				g_hash_table_remove (broker->dict_map, session->language_tag);
-			else
-				g_hash_table_remove (broker->dict_map, session->personal_filename);
+			EnchantPreload *preload = g_new0 (EnchantPreload, 1);
+			preload->broker = broker;
+			preload->tag = g_strdup (tags[i]);
+			preload->fn = fn;
+			preload->user_data = user_data;
+			enchant_broker_submit (broker, enchant_broker_preload_run, preload, NULL);
 		}
 }
 
-static int
-enchant_provider_dictionary_exists (EnchantProvider * provider, const char * const tag)
+void
+enchant_broker_rescan (EnchantBroker * broker)
 {
-	int exists = 0;
+	g_return_if_fail (broker);
 
-	if (provider->dictionary_exists)
-		{
-			exists = (*provider->dictionary_exists) (provider, tag);
-		}
-	else if (provider->list_dicts)
-		{
-			size_t n_dicts;
-			char ** dicts = (*provider->list_dicts) (provider, &n_dicts);
+	enchant_broker_clear_error (broker);
 
-			for (size_t i = 0; i < n_dicts; i++)
-				{
-					if (!strcmp(dicts[i], tag)) {
-						exists = 1;
-						break;
-					}
-				}
+	g_mutex_lock (&broker->lock);
+	g_hash_table_remove_all (broker->missing);
+	broker->rescans++;
+	/* a tag that fell back to its language alone may be found now */
+	for (guint i = 0; i < broker->interned_tags->len; i++)
+		((EnchantTag *) g_ptr_array_index (broker->interned_tags, i))->dict = NULL;
+	g_mutex_unlock (&broker->lock);
+
+	g_mutex_lock (&broker->inventory_lock);
+	for (guint i = 0; i < broker->provider_modules->len; i++)
+		enchant_provider_module_set_inventory (g_ptr_array_index (broker->provider_modules, i),
+						       NULL, NULL, NULL, 0);
+
+	/* or it would be restored from the saved copy */
+	char *inventory_file = enchant_get_inventory_file ();
+	if (inventory_file)
+		(void) g_remove (inventory_file);
+	g_free (inventory_file);
+	g_mutex_unlock (&broker->inventory_lock);
+}
 
-			enchant_free_string_list (dicts);
-		}
+void
+enchant_broker_set_dict_pool (EnchantBroker * broker, size_t max_dicts, int idle_timeout_ms)
+{
+	g_return_if_fail (broker);
 
-	return exists;
+	enchant_broker_clear_error (broker);
+
+	g_mutex_lock (&broker->lock);
+	broker->idle_max = max_dicts;
+	broker->idle_timeout = idle_timeout_ms < 0 ? -1 : (gint64) idle_timeout_ms * 1000;
+	GSList *evicted = enchant_broker_trim_idle (broker, FALSE);
+	g_mutex_unlock (&broker->lock);
+
+	g_slist_free_full (evicted, enchant_dict_destroyed);
 }
 
-static int
-_enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag)
+/* releases what the session can do without, leaving out the word
+ * lists in seen, which it adds its own to */
+static void
+enchant_session_trim (EnchantSession * session, int level, GHashTable * seen)
 {
-	/* don't query the providers if it is an empty string */
-	if (tag == NULL || *tag == '\0')
-		return 0;
-
-	/* don't query the providers if we can just do a quick map lookup */
-	if (g_hash_table_lookup (broker->dict_map, (gpointer) tag) != NULL)
-		return 1;
+	enchant_word_cache_empty (&session->check_cache);
+	enchant_word_cache_empty (&session->suggest_cache);
+	if (level < 2)
+		return;
 
-	for (GSList *list = broker->provider_list; list != NULL; list = g_slist_next (list)) {
-		if (enchant_provider_dictionary_exists ((EnchantProvider *) list->data, tag))
-			return 1;
-	}
+	EnchantPWL *lists[] = { g_atomic_pointer_get (&session->personal),
+				g_atomic_pointer_get (&session->exclude) };
+	for (guint i = 0; i < G_N_ELEMENTS (lists); i++)
+		if (lists[i] && g_hash_table_add (seen, lists[i]))
+			enchant_pwl_trim (lists[i]);
 
-	return 0;
+	if (session->max_clones != 0)
+		enchant_session_dispose_idle_clones (session);
 }
 
 int
-enchant_broker_dict_exists (EnchantBroker * broker, const char * const tag)
+enchant_broker_trim (EnchantBroker * broker, int level)
 {
-	g_return_val_if_fail (broker, 0);
-	g_return_val_if_fail (tag && strlen(tag), 0);
+	g_return_val_if_fail (broker, -1);
 
 	enchant_broker_clear_error (broker);
-
-	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
-	int exists = 0;
-
-	if(!enchant_is_valid_dictionary_tag(normalized_tag))
+	if (level < 0 || level > 2)
 		{
-			enchant_broker_set_error (broker, "invalid tag character found");
+			enchant_broker_set_error (broker, "unknown trim level");
+			return -1;
 		}
-	else if ((exists = _enchant_broker_dict_exists (broker, normalized_tag)) == 0)
-		{
-			char * iso_639_only_tag;
-
-			iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
 
-			if (strcmp (normalized_tag, iso_639_only_tag) != 0)
-				{
-					exists = _enchant_broker_dict_exists (broker, iso_639_only_tag);
-				}
+	/* the pool's dictionaries go whatever it is set to keep */
+	g_mutex_lock (&broker->lock);
+	GSList *evicted = enchant_broker_trim_idle (broker, TRUE);
+	g_mutex_unlock (&broker->lock);
+	g_slist_free_full (evicted, enchant_dict_destroyed);
 
-			free (iso_639_only_tag);
+	if (level >= 1)
+		{
+			GHashTable *seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+			g_mutex_lock (&broker->stats_lock);
+			for (guint i = 0; i < broker->sessions->len; i++)
+				enchant_session_trim (g_ptr_array_index (broker->sessions, i), level, seen);
+			g_mutex_unlock (&broker->stats_lock);
+			g_hash_table_destroy (seen);
 		}
 
-	free (normalized_tag);
-	return exists;
+	return 0;
 }
 
-_GL_ATTRIBUTE_PURE const char *
-enchant_dict_get_extra_word_characters (EnchantDict *dict)
+/* gets the session's word lists ready for a fork, leaving out those in
+ * seen, which it adds its own to */
+static void
+enchant_session_freeze (EnchantSession * session, GHashTable * seen)
 {
-	g_return_val_if_fail (dict, NULL);
-
-	return dict->get_extra_word_characters ? (*dict->get_extra_word_characters) (dict) : "";
+	/* or the first worker to add to them would copy what they hold */
+	enchant_word_cache_empty (&session->check_cache);
+	enchant_word_cache_empty (&session->suggest_cache);
+
+	EnchantPWL *personal = enchant_session_get_personal (session);
+	if (g_hash_table_add (seen, personal))
+		enchant_pwl_freeze (personal, TRUE);
+	EnchantPWL *exclude = enchant_session_get_exclude (session);
+	if (g_hash_table_add (seen, exclude))
+		enchant_pwl_freeze (exclude, FALSE);
 }
 
-_GL_ATTRIBUTE_PURE int
-enchant_dict_is_word_character (EnchantDict * dict, uint32_t uc_in, size_t n)
+void
+enchant_broker_freeze (EnchantBroker * broker)
 {
-	g_return_val_if_fail (n <= 2, 0);
-
-	if (dict && dict->is_word_character)
-		return (*dict->is_word_character) (dict, uc_in, n);
+	g_return_if_fail (broker);
 
-	gunichar uc = (gunichar)uc_in;
+	enchant_broker_clear_error (broker);
 
-	/* Accept quote marks anywhere except at the end of a word */
-	if (uc == g_utf8_get_char("'") || uc == g_utf8_get_char("’")) {
-		return n < 2;
-	}
+	/* the flushers' threads would not be there in the forked processes */
+	enchant_broker_set_write_behind (broker, FALSE);
 
-	GUnicodeType type = g_unichar_type(uc);
+	GHashTable *seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_mutex_lock (&broker->stats_lock);
+	for (guint i = 0; i < broker->sessions->len; i++)
+		enchant_session_freeze (g_ptr_array_index (broker->sessions, i), seen);
+	g_mutex_unlock (&broker->stats_lock);
+	g_hash_table_destroy (seen);
+}
 
-	switch (type) {
-	case G_UNICODE_MODIFIER_LETTER:
-	case G_UNICODE_LOWERCASE_LETTER:
-	case G_UNICODE_TITLECASE_LETTER:
-	case G_UNICODE_UPPERCASE_LETTER:
-	case G_UNICODE_OTHER_LETTER:
-	case G_UNICODE_COMBINING_MARK: /* Older name for G_UNICODE_SPACING_MARK; deprecated since glib 2.30 */
-	case G_UNICODE_ENCLOSING_MARK:
-	case G_UNICODE_NON_SPACING_MARK:
-	case G_UNICODE_DECIMAL_NUMBER:
-	case G_UNICODE_LETTER_NUMBER:
-	case G_UNICODE_OTHER_NUMBER:
-	case G_UNICODE_CONNECT_PUNCTUATION:
-		return 1;     /* Enchant 1.3.0 defines word chars like this. */
+/* how much of its dictionaries' struct the session's provider fills in,
+ * see enchant_provider_has_extensions */
+static size_t
+enchant_session_dict_size (EnchantSession * session)
+{
+	if (!session->dict_extended)
+		return G_STRUCT_OFFSET (EnchantDict, check_batch);
+	if (enchant_provider_get_abi_version (session->provider) < 2)
+		return G_STRUCT_OFFSET (EnchantDict, get_memory_usage);
+	if (enchant_provider_get_abi_version (session->provider) < 3)
+		return G_STRUCT_OFFSET (EnchantDict, set_suggest_profile);
+	return sizeof (EnchantDict);
+}
 
-	case G_UNICODE_DASH_PUNCTUATION:
-		if ((n == 1) && (type == G_UNICODE_DASH_PUNCTUATION)) {
-			return 1; /* hyphens only accepted within a word. */
-		}
-		/* Fallthrough */
+/* tells the provider's dictionary the words added to the session */
+static void
+enchant_session_replay (EnchantSession * session, EnchantDict * dict)
+{
+	if (!dict->add_to_session)
+		return;
 
-	case G_UNICODE_CONTROL:
-	case G_UNICODE_FORMAT:
-	case G_UNICODE_UNASSIGNED:
-	case G_UNICODE_PRIVATE_USE:
-	case G_UNICODE_SURROGATE:
-	case G_UNICODE_CLOSE_PUNCTUATION:
-	case G_UNICODE_FINAL_PUNCTUATION:
-	case G_UNICODE_INITIAL_PUNCTUATION:
-	case G_UNICODE_OTHER_PUNCTUATION:
-	case G_UNICODE_OPEN_PUNCTUATION:
-	case G_UNICODE_CURRENCY_SYMBOL:
-	case G_UNICODE_MODIFIER_SYMBOL:
-	case G_UNICODE_MATH_SYMBOL:
-	case G_UNICODE_OTHER_SYMBOL:
-	case G_UNICODE_LINE_SEPARATOR:
-	case G_UNICODE_PARAGRAPH_SEPARATOR:
-	case G_UNICODE_SPACE_SEPARATOR:
-	default:
-		return 0;
-	}
+	GHashTableIter iter;
+	gpointer key, value;
+	g_rw_lock_reader_lock (&session->lock);
+	g_hash_table_iter_init (&iter, session->session_words);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		if (GPOINTER_TO_INT (value) == ENCHANT_SESSION_GOOD)
+			{
+				EnchantSessionWord *word = (EnchantSessionWord *) key;
+				(*dict->add_to_session) (dict, word->word, word->len);
+			}
+	g_rw_lock_reader_unlock (&session->lock);
 }
 
-void
-enchant_broker_set_ordering (EnchantBroker * broker, const char * const tag, const char * const ordering)
+int
+enchant_broker_reload_dict (EnchantBroker * broker, const char * const tag)
 {
-	g_return_if_fail (broker);
-	g_return_if_fail (tag && strlen(tag));
-	g_return_if_fail (ordering && strlen(ordering));
+	g_return_val_if_fail (broker, -1);
+	g_return_val_if_fail (tag && strlen(tag), -1);
 
 	enchant_broker_clear_error (broker);
 
-	char *tag_dupl = enchant_normalize_dictionary_tag (tag);
-	char *ordering_dupl = g_strstrip (g_strdup (ordering));
+	char * normalized_tag = enchant_normalize_dictionary_tag (tag);
+	if (!enchant_is_valid_dictionary_tag (normalized_tag))
+		{
+			enchant_broker_set_error (broker, "invalid tag character found");
+			free (normalized_tag);
+			return -1;
+		}
 
-	if (tag_dupl && strlen(tag_dupl) &&
-		ordering_dupl && strlen(ordering_dupl))
+	/* the one enchant_broker_request_dict would hand out, kept from
+	 * being disposed of meanwhile */
+	char * iso_639_only_tag = enchant_iso_639_from_tag (normalized_tag);
+	g_mutex_lock (&broker->lock);
+	EnchantDict *dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, normalized_tag);
+	if (dict == NULL)
+		dict = (EnchantDict*)g_hash_table_lookup (broker->dict_map, iso_639_only_tag);
+	EnchantDictPrivateData *dict_private_data = dict ? (EnchantDictPrivateData*)dict->enchant_private_data : NULL;
+	if (dict && (dict_private_data->members || dict_private_data->session->provider == NULL))
+		dict = NULL;
+	if (dict)
 		{
-			/* we will free ordering_dupl && tag_dupl when the hash is destroyed */
-			g_hash_table_insert (broker->provider_ordering, (gpointer)tag_dupl,
-					     (gpointer)(ordering_dupl));
+			dict_private_data->reference_count++;
+			if (dict_private_data->idle_link)
+				{
+					/* enchant_broker_free_dict puts it back */
+					g_queue_delete_link (&broker->idle, dict_private_data->idle_link);
+					dict_private_data->idle_link = NULL;
+				}
 		}
-	else
+	g_mutex_unlock (&broker->lock);
+	free (iso_639_only_tag);
+	free (normalized_tag);
+
+	if (dict == NULL)
+		return 0;
+
+	/* the old dictionary keeps answering while the new one loads */
+	EnchantSession *session = dict_private_data->session;
+	EnchantProvider *provider = session->provider;
+	enchant_provider_lock (provider);
+	EnchantDict *fresh = (*provider->request_dict) (provider, session->language_tag);
+	enchant_provider_unlock (provider);
+	if (fresh == NULL)
+		{
+			enchant_broker_free_dict (broker, dict);
+			enchant_errors_set (broker->errors,
+					   g_strdup_printf ("Couldn't reload dictionary '%s'", session->language_tag));
+			return -1;
+		}
+	/* errors it reports are the dictionary's */
+	fresh->enchant_private_data = dict_private_data;
+
+	/* the verdicts cached are worked out again by the new one, so that
+	 * the checks that hit the cache before do not all go to it after */
+	GPtrArray *cached = enchant_word_cache_list (&session->check_cache);
+	int *verdicts = g_new (int, cached->len + 1);
+	enchant_provider_lock (provider);
+	for (guint i = 0; i < cached->len; i++)
+		{
+			const char *word = g_ptr_array_index (cached, i);
+			verdicts[i] = fresh->check ? (*fresh->check) (fresh, word, strlen (word)) : -1;
+		}
+	enchant_provider_unlock (provider);
+
+	/* the handles given out stay the same, with what they point to
+	 * swapped while no thread is calling the provider */
+	EnchantWordCacheStamp stamp;
+	EnchantDict old;
+	size_t size = enchant_session_dict_size (session);
+	g_rw_lock_writer_lock (&session->swap_lock);
+	if (session->suggest_profile && enchant_session_has_suggest_profiles (session, fresh))
+		(*fresh->set_suggest_profile) (fresh, session->suggest_profile);
+	memcpy (&old, dict, size);
+	memcpy (dict, fresh, size);
+	memcpy (fresh, &old, size);
+	/* the new one may tell word characters apart differently; the old
+	 * table is kept, as callers may still be reading it */
+	guint8 *word_chars = g_atomic_pointer_get (&dict_private_data->word_chars);
+	if (word_chars)
 		{
-			g_free (tag_dupl);
-			g_free (ordering_dupl);
+			dict_private_data->retired_word_chars = g_slist_prepend (dict_private_data->retired_word_chars, word_chars);
+			g_atomic_pointer_set (&dict_private_data->word_chars, NULL);
 		}
+	enchant_session_dispose_idle_clones (session);
+	enchant_session_replay (session, dict);
+	enchant_session_changed (session);
+	enchant_session_get_stamp (session, FALSE, &stamp);
+	enchant_word_cache_restamp (&session->check_cache, &stamp);
+	g_rw_lock_writer_unlock (&session->swap_lock);
+
+	/* least recently used first, to keep their order */
+	for (guint i = 0; i < cached->len; i++)
+		if (verdicts[i] >= 0)
+			{
+				const char *word = g_ptr_array_index (cached, i);
+				enchant_word_cache_store (&session->check_cache, word, strlen (word), &stamp,
+							  GINT_TO_POINTER (verdicts[i]));
+			}
+	g_free (verdicts);
+	g_ptr_array_unref (cached);
+
+	fresh->enchant_private_data = NULL;
+	enchant_provider_lock (provider);
+	(*provider->dispose_dict) (provider, fresh);
+	enchant_provider_unlock (provider);
+
+	enchant_broker_free_dict (broker, dict);
+	return 1;
 }
 
 void
@@ -1447,7 +7562,7 @@ enchant_broker_get_error (EnchantBroker * broker)
 {
 	g_return_val_if_fail (broker, NULL);
 
-	return broker->error;
+	return enchant_errors_get (broker->errors);
 }
 
 char *
@@ -1486,6 +7601,12 @@ enchant_set_prefix_dir(const char *new_prefix)
 {
 #ifdef ENABLE_RELOCATABLE
 	set_relocation_prefix (INSTALLPREFIX, new_prefix);
+
+	/* what was relocated against the old prefix is worked out again */
+	g_mutex_lock (&enchant_dirs_lock);
+	if (enchant_relocated)
+		g_hash_table_remove_all (enchant_relocated);
+	g_mutex_unlock (&enchant_dirs_lock);
 #else
 	(void)new_prefix;
 #endif
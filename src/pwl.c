@@ -33,11 +33,13 @@
  *  type EnchantPWL.
  *
  *  Under the hood, a PWL is stored as a Trie.  Checking strings for
- *  correctness and making suggestions is done by traversing the Trie
- *  while allowing a certain number of miss-steps.  Due to the prefix
- *  compression of the Trie, this allows all strings in the PWL within
- *  a given edit distance of the target word to be enumerated quite
- *  efficiently.
+ *  correctness and making suggestions is done by running a
+ *  Damerau-Levenshtein automaton for the target word along the paths
+ *  of the Trie, abandoning a path as soon as the automaton shows that
+ *  no string below it is within the allowed number of miss-steps.  Due
+ *  to the prefix compression of the Trie, this allows all strings in
+ *  the PWL within a given edit distance of the target word to be
+ *  enumerated quite efficiently.
  *
  *  Ideas for the future:
  *
@@ -60,52 +62,246 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+#define ENCHANT_PWL_HAVE_INOTIFY 1
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#define ENCHANT_PWL_HAVE_MMAN 1
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "enchant-provider.h"
 #include "unused-parameter.h"
 
 #include "pwl.h"
+#include "trace.h"
 
 #define ENCHANT_PWL_MAX_ERRORS 3
-#define ENCHANT_PWL_MAX_SUGGS 15
+
+/* Journaled changes are written this long after the first of them,
+ * or once they take up this many bytes */
+#define ENCHANT_PWL_JOURNAL_DELAY (2 * G_TIME_SPAN_SECOND)
+#define ENCHANT_PWL_JOURNAL_MAX_SIZE 65536
+
+/* Word lists with at least this many entries get a compiled index */
+#define ENCHANT_PWL_INDEX_MIN_WORDS 1000
+#define ENCHANT_PWL_INDEX_MAGIC "EPWLIDX"
+#define ENCHANT_PWL_INDEX_VERSION 5
+/* An index is written anew once the lines read on top of it are more
+ * than this fraction (1/n) of the words */
+#define ENCHANT_PWL_INDEX_REFRESH 8
+#define ENCHANT_PWL_INDEX_BYTE_ORDER 0x01020304
+
+/* Word lists of at least this many bytes are read from scratch on
+ * several threads, each taking at least the chunk size */
+#define ENCHANT_PWL_PARALLEL_MIN_SIZE (1 << 20)
+#define ENCHANT_PWL_PARALLEL_MIN_CHUNK (256 << 10)
+#define ENCHANT_PWL_PARALLEL_MAX_THREADS 16
+
+/* The parallel suggestion engine only spreads searches of word lists
+ * with at least this many lowercase spellings over threads */
+#define ENCHANT_PWL_PARALLEL_SUGGEST_MIN_WORDS 1000
+
+/* Bytes compared to decide whether a word list has only been appended to */
+#define ENCHANT_PWL_FINGERPRINT_SIZE 64
+
+/* Prefix of a line recording the removal of the word that follows it.
+ * Starting with '#' makes older versions skip it as a comment. */
+#define ENCHANT_PWL_TOMBSTONE "#!remove "
 
 static const gunichar BOM = 0xfeff;
 
 /*  A PWL dictionary is stored as a Trie-like data structure EnchantTrie.
- *  The EnchantTrie datatype is completely recursive - all child nodes
- *  are simply EnchantTrie pointers.  This means that all functions 
- *  that potentially modify a trie need to return the modified trie,
- *  as additional memory may have been allocated.
+ *  All nodes of a trie, their child edges and the strings stored in
+ *  them live in three growable arrays owned by the EnchantTrie (an
+ *  arena), and refer to each other by index rather than by pointer.
+ *  The trie is released all at once by enchant_trie_free.
  *
- *  The empty trie is simply the null pointer.  If a trie contains
- *  a single string, it is recorded in the "value" attribute and
- *  "subtries" is set to NULL.  When two or more strings are contained,
- *  "value" is NULL and "subtries" is a GHashTable mapping the first
- *  character of each string to the subtrie containing the remainder of
- *  that string.
+ *  The empty trie is simply the null pointer.  If a node contains a
+ *  single string, it is recorded in the "value" attribute (an offset
+ *  into the string pool) and the node has no edges.  When two or more
+ *  strings are contained, "value" is unset and the node's edges,
+ *  sorted by codepoint, map the first character of each string to the
+ *  node containing the remainder of that string.  Node 0 is the root.
  *
  *  All strings stored in the Trie are assumed to be in UTF format.
  *  Branching is done on unicode characters, not individual bytes.
+ *
+ *  A trie may also be weighed (see enchant_trie_weigh), giving each
+ *  node the highest frequency of the strings below it, so that a
+ *  search can tell which subtries hold the more common words.
  */
+typedef struct str_enchant_trie_edge
+{
+	gunichar ch;           /* character on this edge, 0 for end-of-string */
+	guint32 node;          /* index of the child node */
+} EnchantTrieEdge;
+
+typedef struct str_enchant_trie_node
+{
+	guint32 edges;         /* index of the first edge in the edge pool */
+	guint32 n_edges;       /* number of edges in use */
+	guint32 edges_cap;     /* number of edges allocated for this node */
+	guint32 value;         /* final string found under this node */
+} EnchantTrieNode;
+
 typedef struct str_enchant_trie EnchantTrie;
 struct str_enchant_trie
 {
-	char* value;           /* final string found under this node */
-	GHashTable* subtries;  /* Maps characters to subtries */
+	EnchantTrieNode* nodes;
+	guint32 n_nodes;
+	guint32 nodes_cap;
+
+	EnchantTrieEdge* edges;
+	guint32 n_edges;
+	guint32 edges_cap;
+
+	char* strings;         /* NUL-terminated values packed end to end */
+	guint32 n_strings;
+	guint32 strings_cap;
+
+	guint32 dead_nodes;    /* nodes no longer reachable from the root */
+
+	guint32* weights;      /* of the nodes weighed, or NULL */
+	guint32 n_weights;     /* those added since have no bound */
+
+	GMappedFile* mapped;   /* set while the arrays point into a compiled index */
+	gpointer sealed;       /* set while they live in a read-only block, see enchant_trie_freeze */
+	gsize sealed_size;
 };
 
+/* what part of the word list file has already been read into the trie */
+typedef struct str_enchant_pwl_fingerprint
+{
+	long offset;
+	char head[ENCHANT_PWL_FINGERPRINT_SIZE];  /* first bytes of the file */
+	size_t head_len;
+	char tail[ENCHANT_PWL_FINGERPRINT_SIZE];  /* last bytes before offset */
+	size_t tail_len;
+} EnchantPWLFingerprint;
+
+/* what the word list file looked like when it was last read */
+typedef struct str_enchant_pwl_file_stamp
+{
+	gint64 size;
+	gint64 mtime_ns;       /* modification time, in nanoseconds where available */
+	guint64 inode;
+} EnchantPWLFileStamp;
+
+typedef struct str_enchant_pwl_deletions EnchantPWLDeletions;
+
 struct str_enchant_pwl
 {
 	EnchantTrie* trie;
 	char * filename;
-	time_t file_changed;
-	GHashTable *words_in_trie;
+	char * canonical_filename;  /* key of a shared PWL in enchant_pwl_registry */
+	guint ref_count;       /* guarded by enchant_pwl_registry_lock */
+	guint write_behind_users;  /* likewise */
+	gboolean readonly;     /* see enchant_pwl_init_readonly */
+	EnchantPWLFileStamp file_changed;
+	EnchantPWLFingerprint file_read;
+	size_t file_lines;
+	size_t file_tombstones;  /* removal lines not yet compacted away */
+	GHashTable *words_in_trie;  /* normalized spelling -> original, the same string if they are alike */
+	GStringChunk *words;   /* keys and values of words_in_trie, and keys of folded_words */
+	gsize words_size;      /* bytes inserted into words since it was last cleared */
+	EnchantTrie* folded_trie;  /* lowercase spellings of the words, see enchant_pwl_fold_words */
+	GHashTable *folded_words;  /* lowercase spelling, a words_in_trie key if alike -> GSList of them */
+	EnchantPWLSuggestEngine suggest_engine;
+	GHashTable *frequencies;  /* lowercase spelling -> frequency, see enchant_pwl_set_frequencies, or NULL */
+	EnchantPWLDeletions *deletions;  /* index of the folded words, see enchant_pwl_build_deletions */
+	GMappedFile *index;    /* compiled index words_in_trie may point into */
+	guint64 *filter;       /* Bloom filter of the words_in_trie keys, see enchant_pwl_build_filter */
+	guint32 filter_mask;   /* number of bits in the filter - 1 */
+	guint32 filter_room;   /* words it can take before it is rebuilt */
+	gint generation;       /* bumped whenever the words change */
+	gint n_reloads;        /* see enchant_pwl_get_reload_stats */
+	guint64 reload_us;	/* guarded by enchant_pwl_reload_stats */
+	gsize n_nodes_visited; /* see enchant_pwl_get_work_stats */
+	gsize n_file_polls;
+	gint frozen;           /* no longer following the file, see enchant_pwl_freeze */
+
+#if defined(ENCHANT_PWL_HAVE_INOTIFY)
+	int watch_fd;          /* inotify instance watching the file's directory, or -1 */
+	char *watch_name;      /* the file's name within it */
+#elif defined(_WIN32)
+	HANDLE watch_handle;   /* change notification on the file's directory */
+#endif
+	gboolean file_stale;   /* the file is to be stat'ed whether or not it is watched */
+	gint64 poll_interval;  /* how long an unwatched file goes without being stat'ed */
+	gint64 poll_due;       /* monotonic time it is next stat'ed */
+	gboolean background_reload;  /* whole rereads are left to the reloader, see enchant_pwl_reloader */
+	gboolean reloading;    /* while the reloader has not swapped in what it read; guarded by file_lock */
+	GThread *reloader;     /* the last one started */
+
+	GRWLock lock;          /* held for writing while the words are changed */
+	GMutex file_lock;      /* held while the file is read or written */
+	GMutex journal_lock;   /* guards the journal and the flusher */
+	GCond journal_cond;
+	GString *journal;      /* lines not written yet, see enchant_pwl_set_write_behind */
+	gint64 journal_since;  /* monotonic time the oldest of them was added */
+	GThread *flusher;
+	gboolean flusher_stop;
+
+	GMutex updates_lock;   /* guards the updates below, see enchant_pwl_update */
+	GCond updates_cond;
+	GPtrArray *updates;    /* EnchantPWLUpdates waiting to be applied */
+	gboolean updating;     /* whether some writer is applying them */
 };
 
-/* Special Trie node indicating the end of a string */
-static EnchantTrie n_EOSTrie;
-static EnchantTrie* EOSTrie = &n_EOSTrie;
+/*  A compiled index is a copy of the trie arrays and of words_in_trie,
+ *  written next to the word list as "<filename>.idx" so that a large
+ *  word list can be mapped into memory instead of being parsed.  The
+ *  file starts with this header, followed by the nodes, the edges, the
+ *  string pool and n_words pairs of NUL-terminated normalized and
+ *  original spellings, the latter empty if alike.  It covers the first
+ *  source_offset bytes (source_lines lines) of the word list, whose
+ *  fingerprint it keeps, and is used for as long as those bytes are
+ *  unchanged, the lines appended since being read on top of it.
+ *  n_tombstones counts the removal lines it covers, which are not
+ *  otherwise recorded.
+ */
+typedef struct str_enchant_pwl_index_header
+{
+	char magic[8];
+	guint32 version;
+	guint32 byte_order;
+	guint64 source_size;
+	gint64 source_mtime_ns;
+	guint64 source_inode;
+	guint32 n_nodes;
+	guint32 n_edges;
+	guint32 n_strings;
+	guint32 n_words;
+	guint32 n_tombstones;
+	guint32 reserved;
+	guint64 words_size;
+	guint64 source_offset;
+	guint64 source_lines;
+	guint32 head_len;
+	guint32 tail_len;
+	char head[ENCHANT_PWL_FINGERPRINT_SIZE];
+	char tail[ENCHANT_PWL_FINGERPRINT_SIZE];
+} EnchantPWLIndexHeader;
+
+/* Value offset of a node that holds no string */
+#define ENCHANT_TRIE_NO_VALUE G_MAXUINT32
+
+/* Special node index indicating the end of a string */
+#define ENCHANT_TRIE_EOS (G_MAXUINT32 - 1)
+
+/* Node index returned when there is no such subtrie */
+#define ENCHANT_TRIE_NO_NODE G_MAXUINT32
 
 /* mode for searching trie */
 typedef enum enum_matcher_mode EnchantTrieMatcherMode;
@@ -115,24 +311,64 @@ enum enum_matcher_mode
 	case_insensitive
 };
 
+/*  The EnchantLevAutomaton is a deterministic automaton accepting the
+ *  strings within max_errors insertions, deletions, substitutions and
+ *  transpositions of adjacent characters of a word, the same distance
+ *  as computed by edit_dist.  A state is the last row of the edit_dist
+ *  table for the characters consumed so far, together with the cost of
+ *  a transposition the next character would complete, each capped at
+ *  max_errors + 1.  States are numbered as they are discovered.
+ *
+ *  All characters not in the word act alike, so a transition depends
+ *  only on which of the word's distinct characters (its "classes") is
+ *  consumed, if any.  Transitions are computed the first time they are
+ *  taken, so only the part of the automaton a search visits is built.
+ */
+typedef struct str_enchant_lev_automaton EnchantLevAutomaton;
+struct str_enchant_lev_automaton
+{
+	gunichar* classes;     /* distinct characters of the word */
+	guint32 n_classes;
+	guint32* word;         /* class of each character of the word */
+	guint32 len;
+	guint32 latin1[256];   /* class of each of the first 256 characters */
+	guint8 dead;           /* max_errors + 1, meaning too many errors */
+
+	GStringChunk* encoded; /* states, one byte per table entry plus one */
+	GHashTable* state_ids; /* encoded state -> state number + 1 */
+	const char** states;
+	guint8* min_errors;    /* fewest errors reachable from each state */
+	guint8* errors;        /* errors of a string ending in each state */
+	guint32* transitions;  /* n_classes + 1 per state */
+	guint32 n_states;
+	guint32 states_cap;
+};
+
+/* Transition not computed yet */
+#define ENCHANT_LEV_NO_STATE G_MAXUINT32
+
 /*  The EnchantTrieMatcher structure maintains the state necessary to
  *  search for matching strings within an EnchantTrie.  It includes a
  *  callback function which will be called with each matching string
  *  as it is found.  The arguments to this function are:
  *
- *      - a freshly-allocated copy of the matching string, which must
- *        be freed by external code
+ *      - the matching string, which lives in the matcher's path buffer
+ *        and must be copied if it is needed after the call
  *      - the EnchantTrieMatcher object, giving the context of the match
  *        (e.g. number of errors)
+ *
+ *  The callback may lower max_errors to narrow the rest of the search,
+ *  and settle it, once it has no use for more matches with
+ *  settled_errors errors unless they are heavier than settled_weight;
+ *  subtries that can hold nothing better are then left out.
  */
 typedef struct str_enchant_trie_matcher EnchantTrieMatcher;
 struct str_enchant_trie_matcher
 {
-	int num_errors;		/* Num errors encountered so far. */
+	int num_errors;		/* Num errors of the match being reported */
 	int max_errors;		/* Max errors before search should terminate */
 
-	char* word;	/* Word being searched for */
-	ssize_t word_pos;	/* Current position in the word */
+	EnchantLevAutomaton* automaton;	/* Recognizes the word being searched for */
 
 	char* path;		    /* Path taken through the trie so far */
 	ssize_t path_len;	/* Length of allocated path string */
@@ -140,49 +376,117 @@ struct str_enchant_trie_matcher
 
 	EnchantTrieMatcherMode mode;
 
-	void (*cbfunc)(char*,EnchantTrieMatcher*); /* callback func */
+	void (*cbfunc)(const char*,EnchantTrieMatcher*); /* callback func */
 	void* cbdata;		/* Private data for use by callback func */
+
+	const EnchantPWLStop* stop;	/* Polled to cut the search short, or NULL */
+	guint32 n_visits;	/* Nodes visited, to poll stop every so often and for the stats */
+
+	gint* bound;		/* max_errors shared with the matchers searching other parts of the trie, or NULL */
+
+	int settled_errors;	/* G_MAXINT until settled */
+	guint32 settled_weight;
 };
 
 /*  To allow the list of suggestions to be built up an item at a time,
- *  its state is maintained in an EnchantSuggList object.
+ *  its state is maintained in an EnchantSuggList object.  It keeps the
+ *  max_suggs best suggestions found so far in a binary heap with the
+ *  worst one at the root, and the words in it in a set.  Suggestions
+ *  are words_in_trie keys, so they are neither copied nor compared by
+ *  contents.  The fewer errors the better, then the more frequent.
  */
+typedef struct str_enchant_sugg
+{
+	const char* word;
+	int errs;
+	guint32 weight;		/* frequency of its lowercase spelling, 0 if not known */
+	guint32 seq;		/* order found, to keep the order of ties */
+} EnchantSugg;
+
 typedef struct str_enchant_sugg_list
 {
-	char** suggs;
-	int* sugg_errs;
+	EnchantSugg* suggs;
 	size_t n_suggs;
+	size_t max_suggs;
+	guint32 n_found;
+	GHashTable* listed;		/* words in suggs */
+	GHashTable* folded_words;	/* words behind each lowercase match */
+	GHashTable* frequencies;	/* of the lowercase matches, or NULL */
 } EnchantSuggList;
 
 /*
  *   Function Prototypes
  */
 
-static void enchant_pwl_add_to_trie(EnchantPWL *pwl,
+static gboolean enchant_pwl_add_to_trie(EnchantPWL *pwl,
+					const char *const word, size_t len);
+static const char *enchant_pwl_insert_word(EnchantPWL *pwl, const char *const word, size_t len,
+					   const char *const normalized_word);
+static gboolean enchant_pwl_remove_from_trie(EnchantPWL *pwl,
 					const char *const word, size_t len);
 static void enchant_pwl_refresh_from_file(EnchantPWL* pwl);
-static void enchant_pwl_check_cb(char* match,EnchantTrieMatcher* matcher);
-static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher);
+static gboolean enchant_pwl_reread_file(EnchantPWL* pwl, gboolean whole);
+static gboolean enchant_pwl_can_read_tail(EnchantPWL* pwl, FILE* f, const GStatBuf* stats);
+static void enchant_pwl_watch_file(EnchantPWL *pwl);
+static void enchant_pwl_unwatch_file(EnchantPWL *pwl);
+static void enchant_pwl_append_lines(EnchantPWL *pwl, const char *const text, size_t len);
+static void enchant_pwl_switch_write_behind(EnchantPWL *pwl, gboolean enabled);
+static int enchant_pwl_lookup(EnchantPWL *pwl, const char *const word, size_t len,
+			      const char *const normalized, size_t normalized_len);
+static void enchant_pwl_free_deletions(EnchantPWL *pwl);
+static void enchant_pwl_build_deletions(EnchantPWL *pwl);
+static void enchant_pwl_build_filter(EnchantPWL *pwl);
+static void enchant_pwl_fold_words(EnchantPWL *pwl);
+static void enchant_pwl_add_deletions(EnchantPWL *pwl, const char *const folded);
+static void enchant_pwl_suggest_cb(const char* match,EnchantTrieMatcher* matcher);
+static void enchant_pwl_suggest_add(EnchantSuggList* sugg_list, const char* match, int num_errors, guint32 weight);
+static EnchantTrie* enchant_trie_new(void);
+static EnchantTrie* enchant_trie_new_mapped(GMappedFile* mapped, const EnchantPWLIndexHeader* header);
+static EnchantTrie* enchant_trie_compact(const EnchantTrie* trie);
+static EnchantTrie* enchant_trie_join(EnchantTrie** parts, guint n_parts);
+static void enchant_trie_ensure_writable(EnchantTrie* trie);
+static void enchant_trie_freeze(EnchantTrie* trie);
 static void enchant_trie_free(EnchantTrie* trie);
-static void enchant_trie_free_cb(void*,void*,void*);
+static void enchant_trie_weigh(EnchantTrie* trie, GHashTable* frequencies);
+static void enchant_trie_raise_weights(EnchantTrie* trie, const char *const word, guint32 weight);
+static void enchant_trie_order_edges(EnchantTrie* trie, guint32 node, guint32* order, guint32 n);
+static gboolean enchant_trie_is_empty(EnchantTrie* trie);
+static gboolean enchant_trie_find_edge(EnchantTrie* trie, guint32 node, gunichar ch, guint32 *pos);
 static EnchantTrie* enchant_trie_insert(EnchantTrie* trie,const char *const word);
-static void enchant_trie_remove(EnchantTrie* trie,const char *const word);
+static void enchant_trie_remove(EnchantTrie* trie,guint32 node,const char *const word);
 static void enchant_trie_find_matches(EnchantTrie* trie,EnchantTrieMatcher *matcher);
-static void enchant_trie_find_matches_cb(void* keyV,void* subtrieV,void* matcherV);
-static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word, size_t len,
+static void enchant_trie_find_matches_at(EnchantTrie* trie,guint32 node,guint32 state,EnchantTrieMatcher *matcher);
+static void enchant_trie_find_matches_through(EnchantTrie* trie,const EnchantTrieEdge* edge,guint32 state,EnchantTrieMatcher *matcher);
+static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const normalized_word, size_t len,
 				int maxerrs,
 				EnchantTrieMatcherMode mode,
-				void(*cbfunc)(char*,EnchantTrieMatcher*),
+				void(*cbfunc)(const char*,EnchantTrieMatcher*),
 				void* cbdata);
 static void enchant_trie_matcher_free(EnchantTrieMatcher* matcher);
-static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,char* newchars);
+static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,const char* newchars,ssize_t len);
 static void enchant_trie_matcher_poppath(EnchantTrieMatcher* matcher,int num);
+static EnchantLevAutomaton* enchant_lev_automaton_new(const char* const word, int max_errors);
+static void enchant_lev_automaton_free(EnchantLevAutomaton* automaton);
+static guint32 enchant_lev_automaton_class(EnchantLevAutomaton* automaton, gunichar ch);
+static guint32 enchant_lev_automaton_step(EnchantLevAutomaton* automaton, guint32 state, gunichar ch);
+static guint32 enchant_lev_automaton_step_class(EnchantLevAutomaton* automaton, guint32 state, guint32 c);
 
-static int edit_dist(const char* word1, const char* word2);
+static int edit_dist(const char* word1, const char* word2, int max_dist);
 
 #define enchant_lock_file(f)
 #define enchant_unlock_file(f)
 
+/*  A PWL backed by a file is shared by everyone who opens the file, so
+ *  that a process with many brokers holds one copy of each word list.
+ *  The registry maps the canonical path of each file to its PWL, which
+ *  is freed when the last reference to it is dropped.  Readers of the
+ *  words hold a PWL's lock for reading, and changes to them hold it for
+ *  writing; file_lock is always taken first.
+ */
+static GMutex enchant_pwl_registry_lock;
+static GHashTable *enchant_pwl_registry;
+static GHashTable *enchant_pwl_readonly_registry;  /* likewise, of those opened read-only */
+
 /**
  * enchant_pwl_init
  *
@@ -191,16 +495,82 @@ static int edit_dist(const char* word1, const char* word2);
 EnchantPWL* enchant_pwl_init(void)
 {
 	EnchantPWL *pwl = g_new0(EnchantPWL, 1);
-	pwl->words_in_trie = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	pwl->words_in_trie = g_hash_table_new (g_str_hash, g_str_equal);
+	pwl->words = g_string_chunk_new (4096);
+#if defined(ENCHANT_PWL_HAVE_INOTIFY)
+	pwl->watch_fd = -1;
+#elif defined(_WIN32)
+	pwl->watch_handle = INVALID_HANDLE_VALUE;
+#endif
+	pwl->ref_count = 1;
+	g_rw_lock_init (&pwl->lock);
+	g_mutex_init (&pwl->file_lock);
+	g_mutex_init (&pwl->journal_lock);
+	g_cond_init (&pwl->journal_cond);
+	g_mutex_init (&pwl->updates_lock);
+	g_cond_init (&pwl->updates_cond);
+	pwl->updates = g_ptr_array_new ();
+
+	return pwl;
+}
+
+/* the absolute path of an existing file, with the links in it resolved */
+static char* enchant_pwl_canonical_filename(const char * file)
+{
+	char *canonical = NULL;
+#ifdef _WIN32
+	gunichar2 *wfile = g_utf8_to_utf16 (file, -1, NULL, NULL, NULL);
+	wchar_t *wpath = wfile ? _wfullpath (NULL, wfile, 0) : NULL;
+	char *path = wpath ? g_utf16_to_utf8 (wpath, -1, NULL, NULL, NULL) : NULL;
+	if (path)
+		canonical = g_utf8_casefold (path, -1); /* file names are not case sensitive */
+	g_free (path);
+	free (wpath);
+	g_free (wfile);
+#else
+	char *path = realpath (file, NULL);
+	if (path)
+		canonical = g_strdup (path);
+	free (path);
+#endif
+	return canonical ? canonical : g_strdup (file);
+}
+
+static EnchantPWL* enchant_pwl_open_file(const char * file, gboolean readonly)
+{
+	char *canonical_filename = enchant_pwl_canonical_filename (file);
+	g_mutex_lock (&enchant_pwl_registry_lock);
+	GHashTable **registry = readonly ? &enchant_pwl_readonly_registry : &enchant_pwl_registry;
+	if (*registry == NULL)
+		*registry = g_hash_table_new (g_str_hash, g_str_equal);
+
+	EnchantPWL *pwl = g_hash_table_lookup (*registry, canonical_filename);
+	if (pwl)
+		{
+			pwl->ref_count++;
+			g_mutex_unlock (&enchant_pwl_registry_lock);
+			g_free (canonical_filename);
+			return pwl;
+		}
+
+	pwl = enchant_pwl_init();
+	pwl->filename = g_strdup(file);
+	pwl->canonical_filename = canonical_filename;
+	pwl->readonly = readonly;
 
+	enchant_pwl_watch_file(pwl);
+	enchant_pwl_refresh_from_file(pwl);
+	g_hash_table_insert (*registry, canonical_filename, pwl);
+	g_mutex_unlock (&enchant_pwl_registry_lock);
 	return pwl;
 }
 
 /**
  * enchant_pwl_init_with_file
  *
- * Returns: a new PWL object used to store/check/suggest words
- * or NULL if the file cannot be opened or created
+ * Returns: a PWL object used to store/check/suggest words
+ * or NULL if the file cannot be opened or created.  A PWL already
+ * open on the same file is shared, with a new reference to it.
  */ 
 EnchantPWL* enchant_pwl_init_with_file(const char * file)
 {
@@ -210,37 +580,395 @@ EnchantPWL* enchant_pwl_init_with_file(const char * file)
 	if(fd == NULL)
 		return NULL;
 	fclose(fd);
-	EnchantPWL *pwl = enchant_pwl_init();
-	pwl->filename = g_strdup(file);
-	pwl->file_changed = 0;
 
-	enchant_pwl_refresh_from_file(pwl);
-	return pwl;
+	return enchant_pwl_open_file(file, FALSE);
 }
 
-static void enchant_pwl_refresh_from_file(EnchantPWL* pwl)
+/**
+ * enchant_pwl_init_with_optional_file
+ *
+ * Like enchant_pwl_init_with_file, but without touching the file: one
+ * that does not exist is an empty word list, and it is created, along
+ * with its directory, when a word is first written to it.
+ *
+ * Returns: a PWL object used to store/check/suggest words
+ */
+EnchantPWL* enchant_pwl_init_with_optional_file(const char * file)
 {
-	GStatBuf stats;
-	if(!pwl->filename ||
-	   g_stat(pwl->filename, &stats) != 0 || /* presumably I won't be able to open the file either */
-	   pwl->file_changed == stats.st_mtime) /* nothing changed since last read */
-		return;
+	g_return_val_if_fail (file != NULL, NULL);
+
+	return enchant_pwl_open_file(file, FALSE);
+}
+
+/**
+ * enchant_pwl_init_readonly
+ *
+ * Like enchant_pwl_init_with_file, but for reading only: the file has
+ * to exist, nothing is ever written to it or next to it, and words
+ * cannot be added or removed.  A compiled index someone else wrote
+ * next to it is still mapped instead of the file being parsed.  It is
+ * shared only with others who opened it read-only.
+ *
+ * Returns: a PWL object used to check/suggest words
+ * or NULL if the file does not exist.
+ */
+EnchantPWL* enchant_pwl_init_readonly(const char * file)
+{
+	g_return_val_if_fail (file != NULL, NULL);
+
+	if (!g_file_test (file, G_FILE_TEST_IS_REGULAR))
+		return NULL;
+
+	return enchant_pwl_open_file(file, TRUE);
+}
+
+int enchant_pwl_is_readonly(EnchantPWL *pwl)
+{
+	return pwl->readonly;
+}
+
+/*  Rather than stat the file before every operation, the directory it
+ *  is in is watched for changes (with inotify on Linux and a change
+ *  notification on Windows), and the file is only stat'ed after some.
+ *  Elsewhere, or if the directory cannot be watched, the file is
+ *  stat'ed at most once every ENCHANT_PWL_POLL_INTERVAL milliseconds,
+ *  by default every time.
+ */
+static void enchant_pwl_watch_file(EnchantPWL *pwl)
+{
+	pwl->file_stale = TRUE;
+
+	const char *interval = g_getenv ("ENCHANT_PWL_POLL_INTERVAL");
+	if (interval)
+		pwl->poll_interval = MAX (g_ascii_strtoll (interval, NULL, 10), 0) * (G_TIME_SPAN_SECOND / 1000);
+	const char *background = g_getenv ("ENCHANT_PWL_BACKGROUND_RELOAD");
+	pwl->background_reload = background && g_ascii_strtoll (background, NULL, 10) != 0;
+
+	char *dir = g_path_get_dirname (pwl->filename);
+#if defined(ENCHANT_PWL_HAVE_INOTIFY)
+	pwl->watch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (pwl->watch_fd >= 0 &&
+	    inotify_add_watch (pwl->watch_fd, dir, IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+			       IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE |
+			       IN_DELETE_SELF | IN_MOVE_SELF) < 0)
+		{
+			close (pwl->watch_fd);
+			pwl->watch_fd = -1;
+		}
+	pwl->watch_name = g_path_get_basename (pwl->filename);
+#elif defined(_WIN32)
+	wchar_t *wdir = g_utf8_to_utf16 (dir, -1, NULL, NULL, NULL);
+	pwl->watch_handle = wdir ? FindFirstChangeNotificationW (wdir, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME |
+								   FILE_NOTIFY_CHANGE_SIZE |
+								   FILE_NOTIFY_CHANGE_LAST_WRITE)
+		: INVALID_HANDLE_VALUE;
+	g_free (wdir);
+#endif
+	g_free (dir);
+}
+
+static void enchant_pwl_unwatch_file(EnchantPWL *pwl)
+{
+#if defined(ENCHANT_PWL_HAVE_INOTIFY)
+	if (pwl->watch_fd >= 0)
+		close (pwl->watch_fd);
+	pwl->watch_fd = -1;
+	g_free (pwl->watch_name);
+	pwl->watch_name = NULL;
+#elif defined(_WIN32)
+	if (pwl->watch_handle != INVALID_HANDLE_VALUE)
+		FindCloseChangeNotification (pwl->watch_handle);
+	pwl->watch_handle = INVALID_HANDLE_VALUE;
+#endif
+}
+
+/* whether the file may have changed since this was last asked */
+static gboolean enchant_pwl_file_may_have_changed(EnchantPWL *pwl)
+{
+	gboolean changed = pwl->file_stale;
+	pwl->file_stale = FALSE;
+
+#if defined(ENCHANT_PWL_HAVE_INOTIFY)
+	if (pwl->watch_fd >= 0)
+		{
+			guint64 buffer[512]; /* aligned for struct inotify_event */
+			ssize_t n;
+			g_atomic_pointer_add (&pwl->n_file_polls, 1);
+			while ((n = read (pwl->watch_fd, buffer, sizeof (buffer))) > 0)
+				{
+					const char *event_it = (const char *) buffer;
+					const char *end = event_it + n;
+					while (event_it < end)
+						{
+							const struct inotify_event *event = (const struct inotify_event *) event_it;
+							if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF) ||
+							    (event->len && strcmp (event->name, pwl->watch_name) == 0))
+								changed = TRUE;
+							/* the directory itself went away, so poll from now on */
+							if (event->mask & IN_IGNORED)
+								{
+									close (pwl->watch_fd);
+									pwl->watch_fd = -1;
+									return TRUE;
+								}
+							event_it += sizeof (struct inotify_event) + event->len;
+						}
+					g_atomic_pointer_add (&pwl->n_file_polls, 1);	/* for the next read */
+				}
+			return changed;
+		}
+#elif defined(_WIN32)
+	if (pwl->watch_handle != INVALID_HANDLE_VALUE)
+		{
+			g_atomic_pointer_add (&pwl->n_file_polls, 1);
+			if (WaitForSingleObject (pwl->watch_handle, 0) == WAIT_OBJECT_0)
+				{
+					changed = TRUE;
+					if (!FindNextChangeNotification (pwl->watch_handle))
+						{
+							FindCloseChangeNotification (pwl->watch_handle);
+							pwl->watch_handle = INVALID_HANDLE_VALUE;
+						}
+				}
+			return changed;
+		}
+#endif
+
+	gint64 now = g_get_monotonic_time ();
+	if (!changed && now < pwl->poll_due)
+		return FALSE;
+	pwl->poll_due = now + pwl->poll_interval;
+	return TRUE;
+}
+
+static void enchant_pwl_free_folded(EnchantPWL* pwl)
+{
+	enchant_pwl_free_deletions(pwl);
+	enchant_trie_free(pwl->folded_trie);
+	pwl->folded_trie = NULL;
+	if (pwl->folded_words)
+		{
+			g_hash_table_destroy (pwl->folded_words);
+			pwl->folded_words = NULL;
+		}
+}
+
+static void enchant_pwl_free_filter(EnchantPWL* pwl)
+{
+	g_free(pwl->filter);
+	pwl->filter = NULL;
+}
 
+static void enchant_pwl_clear(EnchantPWL* pwl)
+{
+	enchant_pwl_free_folded(pwl);
+	enchant_pwl_free_filter(pwl);
+	memset(&pwl->file_read, 0, sizeof(pwl->file_read));
+	pwl->file_lines = 0;
+	pwl->file_tombstones = 0;
 	enchant_trie_free(pwl->trie);
 	pwl->trie = NULL;
-	g_hash_table_destroy (pwl->words_in_trie);
-	pwl->words_in_trie = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_remove_all (pwl->words_in_trie);
+	g_string_chunk_clear (pwl->words);
+	pwl->words_size = 0;
+	g_atomic_int_inc (&pwl->generation);
+	if (pwl->index)
+		{
+			g_mapped_file_unref (pwl->index);
+			pwl->index = NULL;
+		}
+}
 
-	FILE *f = g_fopen(pwl->filename, "r");
-	if (!f) 
-		return;
+/* exchange the words of two PWLs, along with what was read of their files */
+static void enchant_pwl_swap_words(EnchantPWL* a, EnchantPWL* b)
+{
+#define ENCHANT_PWL_SWAP(type, field) G_STMT_START { type tmp = a->field; a->field = b->field; b->field = tmp; } G_STMT_END
+	ENCHANT_PWL_SWAP (EnchantTrie*, trie);
+	ENCHANT_PWL_SWAP (EnchantPWLFileStamp, file_changed);
+	ENCHANT_PWL_SWAP (EnchantPWLFingerprint, file_read);
+	ENCHANT_PWL_SWAP (size_t, file_lines);
+	ENCHANT_PWL_SWAP (size_t, file_tombstones);
+	ENCHANT_PWL_SWAP (GHashTable*, words_in_trie);
+	ENCHANT_PWL_SWAP (GStringChunk*, words);
+	ENCHANT_PWL_SWAP (gsize, words_size);
+	ENCHANT_PWL_SWAP (EnchantTrie*, folded_trie);
+	ENCHANT_PWL_SWAP (GHashTable*, folded_words);
+	ENCHANT_PWL_SWAP (EnchantPWLDeletions*, deletions);
+	ENCHANT_PWL_SWAP (GMappedFile*, index);
+	ENCHANT_PWL_SWAP (guint64*, filter);
+	ENCHANT_PWL_SWAP (guint32, filter_mask);
+	ENCHANT_PWL_SWAP (guint32, filter_room);
+#undef ENCHANT_PWL_SWAP
+}
+
+static void enchant_pwl_stamp_file(EnchantPWLFileStamp* stamp, const GStatBuf* stats)
+{
+	stamp->size = stats->st_size;
+#if defined(_WIN32)
+	stamp->mtime_ns = (gint64) stats->st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	stamp->mtime_ns = (gint64) stats->st_mtimespec.tv_sec * 1000000000 + stats->st_mtimespec.tv_nsec;
+#else
+	stamp->mtime_ns = (gint64) stats->st_mtim.tv_sec * 1000000000 + stats->st_mtim.tv_nsec;
+#endif
+	stamp->inode = stats->st_ino;
+}
 
-	pwl->file_changed = stats.st_mtime;
+static gboolean enchant_pwl_stamp_equal(const EnchantPWLFileStamp* a, const EnchantPWLFileStamp* b)
+{
+	return a->size == b->size && a->mtime_ns == b->mtime_ns && a->inode == b->inode;
+}
 
-	enchant_lock_file (f);
-	
+/* map the compiled index of the word list f if the part of f it covers
+ * is unchanged, leaving f positioned at the end of that part */
+static gboolean enchant_pwl_load_index(EnchantPWL* pwl, FILE* f, const GStatBuf* stats)
+{
+	char *index_file = g_strconcat (pwl->filename, ".idx", NULL);
+	GMappedFile *map = g_mapped_file_new (index_file, FALSE, NULL);
+	g_free (index_file);
+	if (map == NULL)
+		return FALSE;
+
+	const char *data = g_mapped_file_get_contents (map);
+	gsize length = g_mapped_file_get_length (map);
+	const EnchantPWLIndexHeader *header = (const EnchantPWLIndexHeader *) data;
+	if (data == NULL || length < sizeof (EnchantPWLIndexHeader) ||
+	    memcmp (header->magic, ENCHANT_PWL_INDEX_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != ENCHANT_PWL_INDEX_VERSION ||
+	    header->byte_order != ENCHANT_PWL_INDEX_BYTE_ORDER ||
+	    header->source_offset > (guint64) stats->st_size ||
+	    header->head_len > ENCHANT_PWL_FINGERPRINT_SIZE ||
+	    header->tail_len > ENCHANT_PWL_FINGERPRINT_SIZE ||
+	    header->n_nodes == 0 ||
+	    length != sizeof (EnchantPWLIndexHeader)
+		      + (guint64) header->n_nodes * sizeof (EnchantTrieNode)
+		      + (guint64) header->n_edges * sizeof (EnchantTrieEdge)
+		      + header->n_strings + header->words_size)
+		{
+			g_mapped_file_unref (map);
+			return FALSE;
+		}
+
+	/* as if the part of the file it covers had just been read */
+	EnchantPWLFingerprint *read = &pwl->file_read;
+	read->offset = header->source_offset;
+	read->head_len = header->head_len;
+	memcpy (read->head, header->head, header->head_len);
+	read->tail_len = header->tail_len;
+	memcpy (read->tail, header->tail, header->tail_len);
+	if (!enchant_pwl_can_read_tail (pwl, f, stats))
+		{
+			memset (read, 0, sizeof (*read));
+			g_mapped_file_unref (map);
+			return FALSE;
+		}
+
+	/* make sure a damaged index cannot send us outside of the mapping */
+	const EnchantTrieNode *nodes = (const EnchantTrieNode *) (header + 1);
+	const EnchantTrieEdge *edges = (const EnchantTrieEdge *) (nodes + header->n_nodes);
+	const char *strings = (const char *) (edges + header->n_edges);
+	const char *words = strings + header->n_strings;
+	gboolean valid = header->n_strings == 0 || strings[header->n_strings - 1] == '\0';
+	for (guint32 i = 0; valid && i < header->n_nodes; i++)
+		valid = (guint64) nodes[i].edges + nodes[i].n_edges <= header->n_edges &&
+			(nodes[i].value == ENCHANT_TRIE_NO_VALUE || nodes[i].value < header->n_strings);
+	for (guint32 i = 0; valid && i < header->n_edges; i++)
+		valid = edges[i].node == ENCHANT_TRIE_EOS || edges[i].node < header->n_nodes;
+
+	const char *word = words, *words_end = words + header->words_size;
+	for (guint32 i = 0; valid && i < header->n_words; i++)
+		{
+			const char *end = memchr (word, '\0', words_end - word);
+			const char *original = end ? end + 1 : NULL;
+			end = original ? memchr (original, '\0', words_end - original) : NULL;
+			if (end == NULL)
+				{
+					valid = FALSE;
+					break;
+				}
+			g_hash_table_insert (pwl->words_in_trie, (char *) word,
+					     (char *) (*original ? original : word));
+			word = end + 1;
+		}
+
+	if (!valid)
+		{
+			g_hash_table_remove_all (pwl->words_in_trie);
+			memset (read, 0, sizeof (*read));
+			g_mapped_file_unref (map);
+			return FALSE;
+		}
+
+	pwl->trie = enchant_trie_new_mapped (map, header);
+	pwl->index = map;
+	pwl->file_lines = header->source_lines;
+	pwl->file_tombstones = header->n_tombstones;
+	return TRUE;
+}
+
+static void enchant_pwl_save_index(EnchantPWL* pwl, const EnchantPWLFileStamp* stamp)
+{
+	/* write (and keep using) a trie without the slack of incremental building */
+	EnchantTrie *trie = enchant_trie_compact (pwl->trie);
+	enchant_trie_free (pwl->trie);
+	pwl->trie = trie;
+
+	EnchantPWLIndexHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, ENCHANT_PWL_INDEX_MAGIC, sizeof (header.magic));
+	header.version = ENCHANT_PWL_INDEX_VERSION;
+	header.byte_order = ENCHANT_PWL_INDEX_BYTE_ORDER;
+	header.source_size = stamp->size;
+	header.source_mtime_ns = stamp->mtime_ns;
+	header.source_inode = stamp->inode;
+	header.n_nodes = trie->n_nodes;
+	header.n_edges = trie->n_edges;
+	header.n_strings = trie->n_strings;
+	header.n_words = g_hash_table_size (pwl->words_in_trie);
+	header.n_tombstones = pwl->file_tombstones;
+	header.source_offset = pwl->file_read.offset;
+	header.source_lines = pwl->file_lines;
+	header.head_len = pwl->file_read.head_len;
+	memcpy (header.head, pwl->file_read.head, pwl->file_read.head_len);
+	header.tail_len = pwl->file_read.tail_len;
+	memcpy (header.tail, pwl->file_read.tail, pwl->file_read.tail_len);
+
+	GString *words = g_string_new (NULL);
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init (&iter, pwl->words_in_trie);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		{
+			g_string_append_len (words, key, strlen (key) + 1);
+			if (value != key)
+				g_string_append_len (words, value, strlen (value));
+			g_string_append_c (words, '\0');
+		}
+	header.words_size = words->len;
+
+	GString *contents = g_string_sized_new (sizeof (header) + trie->n_nodes * sizeof (EnchantTrieNode)
+						+ trie->n_edges * sizeof (EnchantTrieEdge) + trie->n_strings + words->len);
+	g_string_append_len (contents, (const char *) &header, sizeof (header));
+	g_string_append_len (contents, (const char *) trie->nodes, trie->n_nodes * sizeof (EnchantTrieNode));
+	g_string_append_len (contents, (const char *) trie->edges, trie->n_edges * sizeof (EnchantTrieEdge));
+	g_string_append_len (contents, trie->strings, trie->n_strings);
+	g_string_append_len (contents, words->str, words->len);
+
+	/* written to a temporary file and renamed into place; failing to
+	 * write it (e.g. read-only directory) only costs us the speedup */
+	char *index_file = g_strconcat (pwl->filename, ".idx", NULL);
+	g_file_set_contents (index_file, contents->str, contents->len, NULL);
+	g_free (index_file);
+
+	g_string_free (contents, TRUE);
+	g_string_free (words, TRUE);
+}
+
+/* parse the lines of f from the current position on into the trie */
+static void enchant_pwl_read_lines(EnchantPWL* pwl, FILE* f)
+{
 	char buffer[BUFSIZ + 1];
-	size_t line_number = 1;
+	size_t line_number = pwl->file_lines + 1;
 	for (; NULL != (fgets (buffer, sizeof (buffer), f)); ++line_number)
 		{
 			char *line = buffer;
@@ -259,259 +987,2027 @@ static void enchant_pwl_refresh_from_file(EnchantPWL* pwl)
 				}
 
 			g_strchomp(line);
-			if( line[0] && line[0] != '#')
+			if (g_str_has_prefix (line, ENCHANT_PWL_TOMBSTONE))
+				{
+					const char *word = line + strlen (ENCHANT_PWL_TOMBSTONE);
+					if(enchant_utf8_validate (word, -1, NULL))
+						enchant_pwl_remove_from_trie(pwl, word, strlen(word));
+					else
+						g_warning ("Bad UTF-8 sequence in %s at line:%zu\n", pwl->filename, line_number);
+					pwl->file_tombstones++;
+				}
+			else if( line[0] && line[0] != '#')
 				{
-					if(g_utf8_validate(line, -1, NULL))
+					if(enchant_utf8_validate (line, -1, NULL))
 						enchant_pwl_add_to_trie(pwl, line, strlen(line));
 					else
 						g_warning ("Bad UTF-8 sequence in %s at line:%zu\n", pwl->filename, line_number);
 				}
 		}
-	
-	enchant_unlock_file (f);
-	fclose (f);
+	pwl->file_lines = line_number - 1;
 }
 
-void enchant_pwl_free(EnchantPWL *pwl)
+/* A line of a chunk of the word list, as enchant_pwl_parse_chunk
+ * finds it; blank lines and comments are left out */
+typedef enum
 {
-	enchant_trie_free(pwl->trie);
-	g_free(pwl->filename);
-	g_hash_table_destroy (pwl->words_in_trie);
-	g_free(pwl);
-}
+	ENCHANT_PWL_LINE_ADD,
+	ENCHANT_PWL_LINE_REMOVE,
+	ENCHANT_PWL_LINE_BAD_UTF8,
+	ENCHANT_PWL_LINE_TOO_LONG
+} EnchantPWLLineKind;
 
-static void enchant_pwl_add_to_trie(EnchantPWL *pwl,
-					const char *const word, size_t len)
+typedef struct str_enchant_pwl_line
 {
-	char * normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
-	if(NULL != g_hash_table_lookup (pwl->words_in_trie, normalized_word)) {
-		g_free (normalized_word);
-		return;
-	}
-	
-	g_hash_table_insert (pwl->words_in_trie, normalized_word, g_strndup(word,len));
-
-	pwl->trie = enchant_trie_insert(pwl->trie, normalized_word);
+	EnchantPWLLineKind kind;
+	gboolean tombstone;
+	size_t line;           /* counted from 0 at the start of the chunk */
+	const char *word;      /* NUL-terminated within the chunk */
+	size_t len;
+	char *normalized;      /* NULL if the same as word */
+} EnchantPWLLine;
+
+typedef struct str_enchant_pwl_chunk
+{
+	char *start;           /* whole lines of the file, which parsing writes to */
+	char *end;
+	gboolean at_file_start;
+	GArray *lines;         /* of EnchantPWLLine */
+	size_t n_lines;
+} EnchantPWLChunk;
+
+/* Runs fn on each of the n items, all but the first on threads of
+ * their own */
+static void enchant_pwl_run_parallel(GThreadFunc fn, gpointer *items, guint n)
+{
+	GThread **threads = g_newa (GThread *, n);
+	for (guint i = 1; i < n; i++)
+		threads[i] = g_thread_new ("enchant-pwl-load", fn, items[i]);
+	fn (items[0]);
+	for (guint i = 1; i < n; i++)
+		g_thread_join (threads[i]);
 }
 
-static void enchant_pwl_remove_from_trie(EnchantPWL *pwl,
-					const char *const word, size_t len)
+/* Parses the lines of a chunk as enchant_pwl_read_lines does, validating
+ * and normalizing the words but leaving the word list alone */
+static gpointer enchant_pwl_parse_chunk(gpointer data)
 {
-	char * normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+	EnchantPWLChunk *chunk = (EnchantPWLChunk *) data;
 
-	if( g_hash_table_remove (pwl->words_in_trie, normalized_word) )
+	chunk->lines = g_array_new (FALSE, FALSE, sizeof (EnchantPWLLine));
+	for (char *line = chunk->start; line < chunk->end; chunk->n_lines++)
 		{
-			enchant_trie_remove(pwl->trie, normalized_word);
-			if(pwl->trie && pwl->trie->subtries == NULL && pwl->trie->value == NULL) {
-				enchant_trie_free (pwl->trie);
-				pwl->trie = NULL; /* make trie empty if has no content */
-			}
+			char *eol = memchr (line, '\n', chunk->end - line);
+			char *next = eol ? eol + 1 : chunk->end;
+			EnchantPWLLine parsed = { 0 };
+			parsed.line = chunk->n_lines;
+
+			/* as read a buffer of BUFSIZ at a time */
+			if ((size_t) (next - line) > BUFSIZ || (!eol && next - line == BUFSIZ))
+				{
+					parsed.kind = ENCHANT_PWL_LINE_TOO_LONG;
+					g_array_append_val (chunk->lines, parsed);
+					line = next;
+					continue;
+				}
+			if (eol)
+				*eol = '\0';
+			if (chunk->at_file_start && chunk->n_lines == 0 && BOM == g_utf8_get_char (line))
+				line = g_utf8_next_char (line);
+			g_strchomp (line);
+
+			const char *word = line;
+			parsed.tombstone = g_str_has_prefix (line, ENCHANT_PWL_TOMBSTONE);
+			if (parsed.tombstone)
+				word += strlen (ENCHANT_PWL_TOMBSTONE);
+			else if (line[0] == '\0' || line[0] == '#')
+				{
+					line = next;
+					continue;
+				}
+
+			parsed.word = word;
+			parsed.len = strlen (word);
+			if (!enchant_utf8_validate (word, parsed.len, NULL))
+				parsed.kind = ENCHANT_PWL_LINE_BAD_UTF8;
+			else
+				{
+					parsed.kind = parsed.tombstone ? ENCHANT_PWL_LINE_REMOVE : ENCHANT_PWL_LINE_ADD;
+					if (enchant_utf8_ascii_prefix (word, parsed.len) != parsed.len)
+						parsed.normalized = g_utf8_normalize (word, parsed.len, G_NORMALIZE_NFD);
+				}
+			g_array_append_val (chunk->lines, parsed);
+			line = next;
 		}
-	
-	g_free(normalized_word);
+
+	return NULL;
 }
 
-void enchant_pwl_add(EnchantPWL *pwl,
-			 const char *const word, size_t len)
+/* The words in the trie starting with a few first characters */
+typedef struct str_enchant_trie_part
 {
-	enchant_pwl_refresh_from_file(pwl);
+	GPtrArray *words;
+	EnchantTrie *trie;
+} EnchantTriePart;
 
-	enchant_pwl_add_to_trie(pwl, word, len);
+static gpointer enchant_pwl_build_trie_part(gpointer data)
+{
+	EnchantTriePart *part = (EnchantTriePart *) data;
+	for (guint i = 0; i < part->words->len; i++)
+		part->trie = enchant_trie_insert (part->trie, g_ptr_array_index (part->words, i));
+	return NULL;
+}
 
-	if (pwl->filename != NULL)
-	{
-		FILE *f = g_fopen(pwl->filename, "a+");
-		if (f)
-			{
-				/* Since this function does not signal I/O
-				   errors, only use return values to avoid
-				   doing things that seem futile. */
-
-				enchant_lock_file (f);
-				GStatBuf stats;
-				if(g_stat(pwl->filename, &stats)==0)
-					pwl->file_changed = stats.st_mtime;
-
-				/* Add a newline if the file doesn't end with one. */
-				if (fseek (f, -1, SEEK_END) == 0)
-					{
-						int c = getc (f);
-						fseek (f, 0L, SEEK_CUR); /* ISO C requires positioning between read and write. */
-						if (c != '\n')
-							putc ('\n', f);
-					}
-
-				if (fwrite (word, sizeof(char), len, f) == len)
-					{
-						putc ('\n', f);
-					}
-				enchant_unlock_file (f);
-				fclose (f);
-			}	
-	}
+static gint enchant_pwl_compare_sizes(gconstpointer a, gconstpointer b)
+{
+	guint len_a = (*(GPtrArray *const *) a)->len, len_b = (*(GPtrArray *const *) b)->len;
+	return len_a < len_b ? 1 : len_a > len_b ? -1 : 0;
 }
 
-void enchant_pwl_remove(EnchantPWL *pwl,
-			 const char *const word, size_t len)
+/* Builds the trie of the words on n_threads threads, the words starting
+ * with the same character going into the same part, and joins the parts */
+static void enchant_pwl_build_trie(EnchantPWL* pwl, guint n_threads)
 {
-	if(enchant_pwl_check(pwl, word, len) == 1)
-		return;
+	GHashTable *by_first = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+						      (GDestroyNotify) g_ptr_array_unref);
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, pwl->words_in_trie);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		{
+			gpointer ch = GUINT_TO_POINTER (g_utf8_get_char (key));
+			GPtrArray *words = g_hash_table_lookup (by_first, ch);
+			if (words == NULL)
+				{
+					words = g_ptr_array_new ();
+					g_hash_table_insert (by_first, ch, words);
+				}
+			g_ptr_array_add (words, key);
+		}
 
-	enchant_pwl_refresh_from_file(pwl);
+	/* the largest groups first, each to the part with the fewest words */
+	GPtrArray *groups = g_ptr_array_sized_new (g_hash_table_size (by_first));
+	gpointer value;
+	g_hash_table_iter_init (&iter, by_first);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (groups, value);
+	g_ptr_array_sort (groups, enchant_pwl_compare_sizes);
+	n_threads = MIN (n_threads, groups->len);
+	EnchantTriePart *parts = g_new0 (EnchantTriePart, n_threads);
+	gpointer *items = g_new (gpointer, n_threads);
+	for (guint i = 0; i < n_threads; i++)
+		{
+			parts[i].words = g_ptr_array_new ();
+			items[i] = &parts[i];
+		}
+	for (guint i = 0; i < groups->len; i++)
+		{
+			GPtrArray *group = g_ptr_array_index (groups, i);
+			guint fewest = 0;
+			for (guint j = 1; j < n_threads; j++)
+				if (parts[j].words->len < parts[fewest].words->len)
+					fewest = j;
+			for (guint j = 0; j < group->len; j++)
+				g_ptr_array_add (parts[fewest].words, g_ptr_array_index (group, j));
+		}
+	g_ptr_array_unref (groups);
+	g_hash_table_destroy (by_first);
 
-	enchant_pwl_remove_from_trie(pwl, word, len);
+	enchant_pwl_run_parallel (enchant_pwl_build_trie_part, items, n_threads);
 
-	if (pwl->filename)
+	EnchantTrie **tries = g_new (EnchantTrie *, n_threads);
+	for (guint i = 0; i < n_threads; i++)
 		{
-			char * contents;
-			size_t length;
+			tries[i] = parts[i].trie;
+			g_ptr_array_free (parts[i].words, TRUE);
+		}
+	pwl->trie = enchant_trie_join (tries, n_threads);
+	g_free (tries);
+	g_free (items);
+	g_free (parts);
+}
 
-			if(!g_file_get_contents(pwl->filename, &contents, &length, NULL))
-				return;
+/* Reads the lines of f from the start into the empty trie, as
+ * enchant_pwl_read_lines would.  The file is split into chunks of whole
+ * lines whose words are validated and normalized on threads of their
+ * own, then added to words_in_trie in order, and the trie is built from
+ * them on threads again. */
+static void enchant_pwl_read_lines_parallel(EnchantPWL* pwl, FILE* f, gint64 size_hint)
+{
+	GString *contents = g_string_sized_new (size_hint + 1);
+	char buffer[BUFSIZ];
+	size_t n_read;
+	while ((n_read = fread (buffer, 1, sizeof (buffer), f)) != 0)
+		g_string_append_len (contents, buffer, n_read);
+
+	guint n_threads = MIN (g_get_num_processors (), ENCHANT_PWL_PARALLEL_MAX_THREADS);
+	n_threads = MAX (1, MIN (n_threads, contents->len / ENCHANT_PWL_PARALLEL_MIN_CHUNK));
+
+	/* chunks of about the same size, each ending after a line break */
+	EnchantPWLChunk *chunks = g_new0 (EnchantPWLChunk, n_threads);
+	gpointer *items = g_new (gpointer, n_threads);
+	char *end = contents->str + contents->len;
+	char *start = contents->str;
+	guint n_chunks = 0;
+	for (guint i = 0; i < n_threads && start < end; i++)
+		{
+			char *stop = i + 1 == n_threads ? end : contents->str + contents->len / n_threads * (i + 1);
+			if (stop < start)
+				stop = start;
+			char *eol = stop < end ? memchr (stop, '\n', end - stop) : NULL;
+			stop = eol ? eol + 1 : end;
+			chunks[n_chunks].start = start;
+			chunks[n_chunks].end = stop;
+			chunks[n_chunks].at_file_start = start == contents->str;
+			items[n_chunks] = &chunks[n_chunks];
+			n_chunks++;
+			start = stop;
+		}
+	if (n_chunks)
+		enchant_pwl_run_parallel (enchant_pwl_parse_chunk, items, n_chunks);
 
-			FILE *f = g_fopen(pwl->filename, "wb"); /*binary because g_file_get_contents reads binary*/
-			if (f)
+	size_t line_number = pwl->file_lines + 1;
+	for (guint i = 0; i < n_chunks; i++)
+		{
+			for (guint j = 0; j < chunks[i].lines->len; j++)
 				{
-					enchant_lock_file (f);
-					char *key = g_strndup(word, len);
-
-					char *filestart;
-					if(BOM == g_utf8_get_char(contents))
+					EnchantPWLLine *line = &g_array_index (chunks[i].lines, EnchantPWLLine, j);
+					const char *normalized = line->normalized ? line->normalized : line->word;
+					switch (line->kind)
 						{
-							filestart = g_utf8_next_char(contents);
-							fwrite (contents, sizeof(char), filestart-contents, f);
+						case ENCHANT_PWL_LINE_TOO_LONG:
+							g_warning ("Line too long (ignored) in %s at line:%zu\n", pwl->filename, line_number + line->line);
+							break;
+						case ENCHANT_PWL_LINE_BAD_UTF8:
+							g_warning ("Bad UTF-8 sequence in %s at line:%zu\n", pwl->filename, line_number + line->line);
+							break;
+						case ENCHANT_PWL_LINE_ADD:
+							enchant_pwl_insert_word (pwl, line->word, line->len, normalized);
+							break;
+						case ENCHANT_PWL_LINE_REMOVE:
+							if (g_hash_table_remove (pwl->words_in_trie, normalized))
+								g_atomic_int_inc (&pwl->generation);
+							break;
 						}
-					else
-						filestart = contents;
+					if (line->tombstone)
+						pwl->file_tombstones++;
+					g_free (line->normalized);
+				}
+			line_number += chunks[i].n_lines;
+			g_array_free (chunks[i].lines, TRUE);
+		}
+	pwl->file_lines = line_number - 1;
 
-					char *searchstart = filestart;
-					for(;;)
-						{
-							/*find word*/
-							char *needle = strstr(searchstart, key);
-							if(needle == NULL)
-								{
-									fwrite (searchstart, sizeof(char), length - (searchstart - contents), f);
-									break;
-								}
-							else 
-								{
-									char* foundend = needle+len;
-									if((needle == filestart || contents[needle-contents-1] == '\n' || contents[needle-contents-1] == '\r') &&
-										(foundend == contents + length || *foundend == '\n' || *foundend == '\r'))
-										{
-											fwrite (searchstart, sizeof(char), needle - searchstart, f);
-											searchstart = foundend;
-											while (*searchstart == '\n' || *searchstart == '\r')
-												++searchstart;
-										}
-									else {
-										fwrite (searchstart, sizeof(char), needle - searchstart+1, f);
-										searchstart = needle+1;
-									}
-								}
-						}
-					g_free(key);
-					
-					GStatBuf stats;
-					if(g_stat(pwl->filename, &stats)==0)
-						pwl->file_changed = stats.st_mtime;
+	if (n_threads > 1 && g_hash_table_size (pwl->words_in_trie) > 1)
+		enchant_pwl_build_trie (pwl, n_threads);
+	else
+		{
+			GHashTableIter iter;
+			gpointer key;
+			g_hash_table_iter_init (&iter, pwl->words_in_trie);
+			while (g_hash_table_iter_next (&iter, &key, NULL))
+				pwl->trie = enchant_trie_insert (pwl->trie, key);
+		}
 
-					enchant_unlock_file (f);
+	g_free (items);
+	g_free (chunks);
+	g_string_free (contents, TRUE);
+}
 
-					fclose (f);
-				}	
-			g_free(contents);
+/* read the bytes at the start of f and just before offset */
+static void enchant_pwl_read_fingerprint(FILE* f, long offset, EnchantPWLFingerprint* fingerprint)
+{
+	fingerprint->offset = offset;
+	fseek (f, 0L, SEEK_SET);
+	fingerprint->head_len = fread (fingerprint->head, 1, MIN (offset, ENCHANT_PWL_FINGERPRINT_SIZE), f);
+	long tail_start = MAX (0L, offset - ENCHANT_PWL_FINGERPRINT_SIZE);
+	fseek (f, tail_start, SEEK_SET);
+	fingerprint->tail_len = fread (fingerprint->tail, 1, offset - tail_start, f);
+}
+
+/* whether f still starts with the part of the file we already read, so
+ * that only what has been appended to it needs to be parsed */
+static gboolean enchant_pwl_can_read_tail(EnchantPWL* pwl, FILE* f, const GStatBuf* stats)
+{
+	const EnchantPWLFingerprint *read = &pwl->file_read;
+	if (read->offset == 0 || stats->st_size < read->offset)
+		return FALSE;
+
+	EnchantPWLFingerprint current;
+	enchant_pwl_read_fingerprint (f, read->offset, &current);
+	if (current.head_len != read->head_len || current.tail_len != read->tail_len ||
+	    memcmp (current.head, read->head, read->head_len) != 0 ||
+	    memcmp (current.tail, read->tail, read->tail_len) != 0)
+		return FALSE;
+
+	/* the last word we read must not have been continued */
+	if (read->tail_len && read->tail[read->tail_len - 1] != '\n')
+		{
+			int c = getc (f);
+			if (c != EOF && c != '\n' && c != '\r')
+				return FALSE;
 		}
+
+	return fseek (f, read->offset, SEEK_SET) == 0;
 }
 
-static int enchant_pwl_contains(EnchantPWL *pwl, const char *const word, size_t len)
+/*  In write-behind mode, lines for the file are appended to a journal
+ *  rather than written at once, and a flusher thread writes them out
+ *  in one go ENCHANT_PWL_JOURNAL_DELAY after the first of them, or as
+ *  soon as they add up to ENCHANT_PWL_JOURNAL_MAX_SIZE.  The trie is
+ *  updated right away, so only the file lags behind.  Whoever writes
+ *  the journal holds file_lock, which keeps the writes in order.
+ */
+
+/* write out the journal, returning whether there was anything in it;
+ * called with file_lock held */
+static gboolean enchant_pwl_write_journal(EnchantPWL* pwl)
 {
-	int count = 0;
-	EnchantTrieMatcher *matcher = enchant_trie_matcher_init(word, len, 0, case_sensitive, enchant_pwl_check_cb,
-								&count);
-	enchant_trie_find_matches(pwl->trie,matcher);
-	enchant_trie_matcher_free(matcher);
+	g_mutex_lock (&pwl->journal_lock);
+	GString *pending = NULL;
+	if (pwl->journal && pwl->journal->len > 0)
+		{
+			pending = pwl->journal;
+			pwl->journal = g_string_new (NULL);
+		}
+	g_mutex_unlock (&pwl->journal_lock);
+
+	if (pending == NULL)
+		return FALSE;
 
-	return count != 0;
+	enchant_pwl_append_lines (pwl, pending->str, pending->len);
+	g_string_free (pending, TRUE);
+	return TRUE;
 }
 
-static int enchant_is_all_caps(const char*const word, size_t len)
+static gpointer enchant_pwl_flusher(gpointer data)
 {
-	g_return_val_if_fail (word && *word, 0);
+	EnchantPWL *pwl = data;
 
-	int hasCap = 0;
-	for (const char *it = word; it < word + len; it = g_utf8_next_char(it))
+	g_mutex_lock (&pwl->journal_lock);
+	while (!pwl->flusher_stop)
 		{
-			GUnicodeType type = g_unichar_type(g_utf8_get_char(it));
-			switch(type)
+			if (pwl->journal->len == 0)
+				g_cond_wait (&pwl->journal_cond, &pwl->journal_lock);
+			else if (pwl->journal->len >= ENCHANT_PWL_JOURNAL_MAX_SIZE ||
+				 !g_cond_wait_until (&pwl->journal_cond, &pwl->journal_lock,
+						     pwl->journal_since + ENCHANT_PWL_JOURNAL_DELAY))
 				{
-				case G_UNICODE_UPPERCASE_LETTER:
-					hasCap = 1;
-					break;
-				case G_UNICODE_TITLECASE_LETTER:
-				case G_UNICODE_LOWERCASE_LETTER:
-					return 0;
-
-				case G_UNICODE_CONTROL:
-				case G_UNICODE_FORMAT:
-				case G_UNICODE_UNASSIGNED:
-				case G_UNICODE_PRIVATE_USE:
-				case G_UNICODE_SURROGATE:
-				case G_UNICODE_MODIFIER_LETTER:
-				case G_UNICODE_OTHER_LETTER:
-				case G_UNICODE_COMBINING_MARK:
-				case G_UNICODE_ENCLOSING_MARK:
-				case G_UNICODE_NON_SPACING_MARK:
-				case G_UNICODE_DECIMAL_NUMBER:
-				case G_UNICODE_LETTER_NUMBER:
-				case G_UNICODE_OTHER_NUMBER:
-				case G_UNICODE_CONNECT_PUNCTUATION:
-				case G_UNICODE_DASH_PUNCTUATION:
-				case G_UNICODE_CLOSE_PUNCTUATION:
-				case G_UNICODE_FINAL_PUNCTUATION:
-				case G_UNICODE_INITIAL_PUNCTUATION:
-				case G_UNICODE_OTHER_PUNCTUATION:
-				case G_UNICODE_OPEN_PUNCTUATION:
-				case G_UNICODE_CURRENCY_SYMBOL:
-				case G_UNICODE_MODIFIER_SYMBOL:
-				case G_UNICODE_MATH_SYMBOL:
-				case G_UNICODE_OTHER_SYMBOL:
-				case G_UNICODE_LINE_SEPARATOR:
-				case G_UNICODE_PARAGRAPH_SEPARATOR:
-				case G_UNICODE_SPACE_SEPARATOR:
-				default:
-					break;
+					g_mutex_unlock (&pwl->journal_lock);
+					g_mutex_lock (&pwl->file_lock);
+					enchant_pwl_write_journal (pwl);
+					g_mutex_unlock (&pwl->file_lock);
+					g_mutex_lock (&pwl->journal_lock);
 				}
 		}
+	g_mutex_unlock (&pwl->journal_lock);
 
-	return hasCap;
+	return NULL;
 }
 
-static _GL_ATTRIBUTE_PURE int enchant_is_title_case(const char * const word, size_t len)
+/* append text made of whole lines to the file, or to the journal */
+static void enchant_pwl_write_lines(EnchantPWL *pwl, const char *const text, size_t len)
 {
-	g_return_val_if_fail (word && *word, 0);
-
-	gunichar ch = g_utf8_get_char(word);
-	GUnicodeType type = g_unichar_type(ch);
-	if ((type != G_UNICODE_UPPERCASE_LETTER && type != G_UNICODE_TITLECASE_LETTER) ||
-		ch != g_unichar_totitle(ch))
-		return 0;
-			
-	for (const char* it = g_utf8_next_char(word); it < word + len; it = g_utf8_next_char(it))
+	g_mutex_lock (&pwl->journal_lock);
+	if (pwl->flusher)
 		{
-			type = g_unichar_type(g_utf8_get_char(it));
-			if (type == G_UNICODE_UPPERCASE_LETTER || type == G_UNICODE_TITLECASE_LETTER)
-				return 0;
+			if (pwl->journal->len == 0)
+				pwl->journal_since = g_get_monotonic_time ();
+			g_string_append_len (pwl->journal, text, len);
+			if (pwl->journal->len >= ENCHANT_PWL_JOURNAL_MAX_SIZE)
+				g_cond_signal (&pwl->journal_cond);
+			g_mutex_unlock (&pwl->journal_lock);
+			return;
 		}
+	g_mutex_unlock (&pwl->journal_lock);
 
-	return 1;
+	g_mutex_lock (&pwl->file_lock);
+	enchant_pwl_append_lines (pwl, text, len);
+	g_mutex_unlock (&pwl->file_lock);
 }
 
-static gchar* enchant_utf8_strtitle(const gchar*str, gssize len)
+/**
+ * enchant_pwl_flush
+ *
+ * Writes out the changes still in the journal, if any.
+ */
+void enchant_pwl_flush(EnchantPWL *pwl)
 {
-	gchar *upperStr = g_utf8_strup(str, len); /* for locale-sensitive casing */
-	gunichar title_case_char = g_unichar_totitle(g_utf8_get_char(upperStr));
+	g_mutex_lock (&pwl->file_lock);
+	enchant_pwl_write_journal (pwl);
+	g_mutex_unlock (&pwl->file_lock);
+}
+
+/**
+ * enchant_pwl_set_write_behind
+ *
+ * Asks for write-behind mode, or withdraws a request for it.  A shared
+ * PWL is in write-behind mode while anyone asks for it, and writes out
+ * the journal when it leaves it.  A PWL without a file has nothing to
+ * write behind.
+ */
+void enchant_pwl_set_write_behind(EnchantPWL *pwl, int enabled)
+{
+	if (pwl->filename == NULL)
+		return;
+
+	g_mutex_lock (&enchant_pwl_registry_lock);
+	if (enabled)
+		pwl->write_behind_users++;
+	else if (pwl->write_behind_users > 0)
+		pwl->write_behind_users--;
+	if (!pwl->write_behind_users != !pwl->flusher)
+		enchant_pwl_switch_write_behind (pwl, pwl->write_behind_users > 0);
+	g_mutex_unlock (&enchant_pwl_registry_lock);
+}
+
+/* start or stop the flusher; called with enchant_pwl_registry_lock held */
+static void enchant_pwl_switch_write_behind(EnchantPWL *pwl, gboolean enabled)
+{
+	if (enabled)
+		{
+			pwl->journal = g_string_new (NULL);
+			pwl->flusher_stop = FALSE;
+			pwl->flusher = g_thread_new ("enchant-pwl", enchant_pwl_flusher, pwl);
+			return;
+		}
+
+	g_mutex_lock (&pwl->journal_lock);
+	pwl->flusher_stop = TRUE;
+	g_cond_signal (&pwl->journal_cond);
+	g_mutex_unlock (&pwl->journal_lock);
+	g_thread_join (pwl->flusher);
+
+	g_mutex_lock (&pwl->journal_lock);
+	pwl->flusher = NULL;
+	g_mutex_unlock (&pwl->journal_lock);
+
+	enchant_pwl_flush (pwl);
+	g_string_free (pwl->journal, TRUE);
+	pwl->journal = NULL;
+}
+
+/* reload_us is 64 bits wide even where gsize is not, which glib cannot
+ * add to atomically, so it takes a lock; reloads are few */
+G_LOCK_DEFINE_STATIC (enchant_pwl_reload_stats);
+
+static void enchant_pwl_add_reload_us(EnchantPWL *pwl, gint64 us)
+{
+	G_LOCK (enchant_pwl_reload_stats);
+	pwl->reload_us += (guint64) us;
+	G_UNLOCK (enchant_pwl_reload_stats);
+}
+
+/*  With ENCHANT_PWL_BACKGROUND_RELOAD set, a word list that has to be
+ *  read again from the start is read into a PWL of its own by a
+ *  reloader thread, while the words read before stay in use.  The two
+ *  then swap their words, which holds the lock for writing no longer
+ *  than that takes.  The reloader holds file_lock throughout, so the
+ *  file cannot change under it; should the words change in memory in
+ *  the meantime, what it read is dropped and the next refresh reads
+ *  the file again.
+ */
+static gpointer enchant_pwl_reloader(gpointer data)
+{
+	EnchantPWL *pwl = data;
+
+	g_mutex_lock (&pwl->file_lock);
+	EnchantTrace trace;
+	enchant_trace_enter (&trace, "pwl_reload", pwl->filename, NULL, 0);
+	gint64 start = g_get_monotonic_time ();
+	enchant_pwl_write_journal (pwl);
+	gint generation = g_atomic_int_get (&pwl->generation);
+
+	/* built here rather than by the first readers after the swap */
+	g_rw_lock_reader_lock (&pwl->lock);
+	gboolean fold = pwl->folded_words != NULL;
+	gboolean deletions = pwl->deletions != NULL;
+	EnchantPWLSuggestEngine engine = pwl->suggest_engine;
+	GHashTable *frequencies = pwl->frequencies ? g_hash_table_ref (pwl->frequencies) : NULL;
+	g_rw_lock_reader_unlock (&pwl->lock);
+
+	EnchantPWL *fresh = enchant_pwl_init ();
+	fresh->filename = g_strdup (pwl->filename);
+	fresh->readonly = pwl->readonly;
+	fresh->suggest_engine = engine;
+	fresh->frequencies = frequencies;	/* to weigh the folded trie by */
+	enchant_pwl_reread_file (fresh, TRUE);
+	enchant_pwl_build_filter (fresh);
+	if (fold)
+		enchant_pwl_fold_words (fresh);
+	if (deletions)
+		enchant_pwl_build_deletions (fresh);
+
+	g_rw_lock_writer_lock (&pwl->lock);
+	gboolean current = g_atomic_int_get (&pwl->generation) == generation;
+	if (current)
+		{
+			enchant_pwl_swap_words (pwl, fresh);
+			g_atomic_int_inc (&pwl->generation);
+		}
+	g_rw_lock_writer_unlock (&pwl->lock);
+
+	/* the words read before, or the ones just read if they were dropped */
+	enchant_pwl_free (fresh);
+
+	if (current)
+		{
+			g_atomic_int_inc (&pwl->n_reloads);
+			enchant_pwl_add_reload_us (pwl, g_get_monotonic_time () - start);
+		}
+	else
+		pwl->file_stale = TRUE;
+	pwl->reloading = FALSE;
+	enchant_trace_leave (&trace);
+	g_mutex_unlock (&pwl->file_lock);
+	return NULL;
+}
+
+static void enchant_pwl_refresh_from_file(EnchantPWL* pwl)
+{
+	/* while the flusher is writing, the trie is at least as recent
+	 * as the file, so there is no need to wait for it; nor for the
+	 * reloader, which is to catch up with the file by itself */
+	if (!pwl->filename || g_atomic_int_get (&pwl->frozen) || !g_mutex_trylock (&pwl->file_lock))
+		return;
+
+	if (!pwl->reloading && enchant_pwl_file_may_have_changed (pwl))
+		{
+			EnchantTrace trace;
+			enchant_trace_enter (&trace, "pwl_refresh", pwl->filename, NULL, 0);
+			gint64 start = g_get_monotonic_time ();
+			EnchantPWLFileStamp before = pwl->file_changed;
+			g_rw_lock_writer_lock (&pwl->lock);
+			/* the first time round there are no words to go on using */
+			gboolean whole = !pwl->background_reload || pwl->file_read.offset == 0;
+			gboolean reread = enchant_pwl_reread_file (pwl, whole);
+			g_rw_lock_writer_unlock (&pwl->lock);
+			if (!reread)
+				{
+					if (pwl->reloader)
+						g_thread_join (pwl->reloader);
+					pwl->reloading = TRUE;
+					pwl->reloader = g_thread_new ("enchant-pwl-reload", enchant_pwl_reloader, pwl);
+				}
+			else if (!enchant_pwl_stamp_equal (&before, &pwl->file_changed))
+				{
+					g_atomic_int_inc (&pwl->n_reloads);
+					enchant_pwl_add_reload_us (pwl, g_get_monotonic_time () - start);
+				}
+			enchant_trace_leave (&trace);
+		}
+	g_mutex_unlock (&pwl->file_lock);
+}
+
+/* bring the trie up to date with the file; called with file_lock held
+ * and the lock held for writing.  Returns FALSE, having left the words
+ * alone, if the file has to be read from the start but whole is not set */
+static gboolean enchant_pwl_reread_file(EnchantPWL* pwl, gboolean whole)
+{
+	GStatBuf stats;
+	EnchantPWLFileStamp stamp;
+	g_atomic_pointer_add (&pwl->n_file_polls, 1);
+	if(g_stat(pwl->filename, &stats) != 0) /* presumably I won't be able to open the file either */
+		return TRUE;
+	enchant_pwl_stamp_file(&stamp, &stats);
+	if (enchant_pwl_stamp_equal(&stamp, &pwl->file_changed)) /* nothing changed since last read */
+		return TRUE;
+
+	/* let the file catch up with the journal before reading it */
+	if (enchant_pwl_write_journal (pwl))
+		{
+			if (g_stat(pwl->filename, &stats) != 0)
+				return TRUE;
+			enchant_pwl_stamp_file(&stamp, &stats);
+		}
+
+	FILE *f = g_fopen(pwl->filename, "rb");
+	if (f)
+		{
+			enchant_lock_file (f);
+			if (enchant_pwl_can_read_tail (pwl, f, &stats))
+				{
+					pwl->file_changed = stamp;
+					enchant_pwl_read_lines (pwl, f);
+					enchant_pwl_read_fingerprint (f, ftell (f), &pwl->file_read);
+					enchant_unlock_file (f);
+					fclose (f);
+					return TRUE;
+				}
+			enchant_unlock_file (f);
+			if (!whole)
+				{
+					fclose (f);
+					return FALSE;
+				}
+		}
+
+	enchant_pwl_clear(pwl);
+
+	if (f && enchant_pwl_load_index(pwl, f, &stats))
+		{
+			/* then whatever was appended since it was written, writing
+			 * it anew once that makes up a good part of the words */
+			size_t indexed_lines = pwl->file_lines;
+			pwl->file_changed = stamp;
+			enchant_pwl_read_lines (pwl, f);
+			enchant_pwl_read_fingerprint (f, ftell (f), &pwl->file_read);
+			fclose (f);
+			if (!pwl->readonly &&
+			    (pwl->file_lines - indexed_lines) * ENCHANT_PWL_INDEX_REFRESH > g_hash_table_size (pwl->words_in_trie))
+				enchant_pwl_save_index (pwl, &stamp);
+			return TRUE;
+		}
+
+	if (!f) 
+		return TRUE;
+
+	pwl->file_changed = stamp;
+
+	enchant_lock_file (f);
+	fseek (f, 0L, SEEK_SET);
+	if (stats.st_size >= ENCHANT_PWL_PARALLEL_MIN_SIZE)
+		enchant_pwl_read_lines_parallel (pwl, f, stats.st_size);
+	else
+		enchant_pwl_read_lines (pwl, f);
+	enchant_pwl_read_fingerprint (f, ftell (f), &pwl->file_read);
+	enchant_unlock_file (f);
+	fclose (f);
+
+	if (!pwl->readonly && g_hash_table_size (pwl->words_in_trie) >= ENCHANT_PWL_INDEX_MIN_WORDS)
+		enchant_pwl_save_index (pwl, &stamp);
+	return TRUE;
+}
+
+/**
+ * enchant_pwl_free
+ *
+ * Drops a reference to the PWL, freeing it with the last one.
+ */
+void enchant_pwl_free(EnchantPWL *pwl)
+{
+	if (pwl->canonical_filename)
+		{
+			g_mutex_lock (&enchant_pwl_registry_lock);
+			gboolean last = --pwl->ref_count == 0;
+			if (last)
+				{
+					g_hash_table_remove (pwl->readonly ? enchant_pwl_readonly_registry : enchant_pwl_registry,
+							     pwl->canonical_filename);
+					if (pwl->flusher)
+						enchant_pwl_switch_write_behind (pwl, FALSE);
+				}
+			g_mutex_unlock (&enchant_pwl_registry_lock);
+			if (!last)
+				return;
+		}
+
+	if (pwl->reloader)
+		g_thread_join (pwl->reloader);
+	enchant_pwl_unwatch_file(pwl);
+	enchant_pwl_free_folded(pwl);
+	enchant_pwl_free_filter(pwl);
+	enchant_trie_free(pwl->trie);
+	g_free(pwl->filename);
+	g_free(pwl->canonical_filename);
+	g_hash_table_destroy (pwl->words_in_trie);
+	g_string_chunk_free (pwl->words);
+	if (pwl->frequencies)
+		g_hash_table_unref (pwl->frequencies);
+	if (pwl->index)
+		g_mapped_file_unref (pwl->index);
+	g_rw_lock_clear (&pwl->lock);
+	g_mutex_clear (&pwl->file_lock);
+	g_mutex_clear (&pwl->journal_lock);
+	g_cond_clear (&pwl->journal_cond);
+	g_mutex_clear (&pwl->updates_lock);
+	g_cond_clear (&pwl->updates_cond);
+	g_ptr_array_free (pwl->updates, TRUE);
+	g_free(pwl);
+}
+
+/* record a words_in_trie key under its lowercase spelling */
+static void enchant_pwl_add_folded(EnchantPWL *pwl, const char *const key)
+{
+	char *folded = g_utf8_strdown (key, -1);
+	GSList *words = g_hash_table_lookup (pwl->folded_words, folded);
+	if (words)
+		{
+			/* keep the head, since the table holds it */
+			words->next = g_slist_prepend (words->next, (char *) key);
+			g_free (folded);
+			return;
+		}
+
+	/* a word in lowercase already is its own lowercase spelling */
+	char *stored = (char *) key;
+	if (strcmp (folded, key) != 0)
+		{
+			stored = g_string_chunk_insert (pwl->words, folded);
+			pwl->words_size += strlen (folded) + 1;
+		}
+	g_hash_table_insert (pwl->folded_words, stored, g_slist_prepend (NULL, (char *) key));
+	pwl->folded_trie = enchant_trie_insert (pwl->folded_trie, folded);
+	if (pwl->frequencies && pwl->folded_trie->weights == NULL)
+		enchant_trie_weigh (pwl->folded_trie, pwl->frequencies);
+	else if (pwl->frequencies)
+		enchant_trie_raise_weights (pwl->folded_trie, folded,
+					    GPOINTER_TO_UINT (g_hash_table_lookup (pwl->frequencies, folded)));
+	if (pwl->deletions)
+		enchant_pwl_add_deletions (pwl, folded);
+	g_free (folded);
+}
+
+static void enchant_pwl_remove_folded(EnchantPWL *pwl, const char *const normalized_word)
+{
+	char *folded = g_utf8_strdown (normalized_word, -1);
+	gpointer orig_folded, value;
+	if (!g_hash_table_lookup_extended (pwl->folded_words, folded, &orig_folded, &value))
+		{
+			g_free (folded);
+			return;
+		}
+
+	GSList *words = value;
+	if (strcmp (words->data, normalized_word) != 0)
+		{
+			GSList *link = words;
+			while (link->next && strcmp (link->next->data, normalized_word) != 0)
+				link = link->next;
+			if (link->next)
+				link->next = g_slist_delete_link (link->next, link->next);
+		}
+	else if (words->next)
+		{
+			g_hash_table_steal (pwl->folded_words, folded);
+			g_hash_table_insert (pwl->folded_words, orig_folded, g_slist_delete_link (words, words));
+		}
+	else
+		{
+			g_hash_table_remove (pwl->folded_words, folded);
+			enchant_trie_ensure_writable (pwl->folded_trie);
+			enchant_trie_remove (pwl->folded_trie, 0, folded);
+			if (enchant_trie_is_empty (pwl->folded_trie)) {
+				enchant_trie_free (pwl->folded_trie);
+				pwl->folded_trie = NULL;
+			} else if (pwl->folded_trie->dead_nodes > pwl->folded_trie->n_nodes / 2) {
+				/* reclaim the arena */
+				enchant_trie_free (pwl->folded_trie);
+				pwl->folded_trie = NULL;
+				GHashTableIter iter;
+				gpointer key;
+				g_hash_table_iter_init (&iter, pwl->folded_words);
+				while (g_hash_table_iter_next (&iter, &key, NULL))
+					pwl->folded_trie = enchant_trie_insert (pwl->folded_trie, key);
+				enchant_trie_weigh (pwl->folded_trie, pwl->frequencies);
+			}
+		}
+	g_free (folded);
+}
+
+/*  Case-insensitive searches run on a second trie of the lowercase
+ *  spellings of the words, so that they need plain comparisons only.
+ *  It is built by the first suggestion, which a PWL only used for
+ *  checks (such as an exclude list) never asks for, and is kept up to
+ *  date from then on.
+ */
+static void enchant_pwl_fold_words(EnchantPWL *pwl)
+{
+	if (pwl->folded_words)
+		return;
+
+	pwl->folded_words = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   NULL, (GDestroyNotify) g_slist_free);
+
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, pwl->words_in_trie);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		enchant_pwl_add_folded (pwl, key);
+
+	/* lay it out depth first, as searches walk it */
+	EnchantTrie *compacted = enchant_trie_compact (pwl->folded_trie);
+	enchant_trie_free (pwl->folded_trie);
+	pwl->folded_trie = compacted;
+	enchant_trie_weigh (pwl->folded_trie, pwl->frequencies);
+}
+
+/*  For very large word lists, suggestions can instead be looked up in
+ *  a deletion index (see enchant_pwl_set_suggest_engine).  Two words
+ *  are within n errors of each other only if deleting at most n
+ *  characters from each gives the same string, and the same goes for
+ *  their first ENCHANT_PWL_DELETIONS_PREFIX characters.  So the index
+ *  holds the hash of every such deletion from the start of each
+ *  lowercase spelling, with the spelling, and a search looks up the
+ *  deletions from the start of the word it is given, checking the
+ *  spellings found with edit_dist.
+ *
+ *  It is built by the first suggestion and, for word lists that get a
+ *  compiled index, saved next to the word list as "<filename>.del".
+ *  Spellings added since are kept aside and checked one by one, until
+ *  there are too many of them and the index is built anew.  Removed
+ *  spellings stay in it and are skipped.
+ */
+#define ENCHANT_PWL_DELETIONS_PREFIX 7
+#define ENCHANT_PWL_DELETIONS_MAX_ADDED 1024
+#define ENCHANT_PWL_DELETIONS_MAGIC "EPWLDEL"
+#define ENCHANT_PWL_DELETIONS_VERSION 1
+
+typedef struct str_enchant_pwl_deletion
+{
+	guint32 hash;          /* of the string left by the deletion */
+	guint32 word;          /* spelling it was made from */
+} EnchantPWLDeletion;
+
+struct str_enchant_pwl_deletions
+{
+	char* strings;         /* NUL-terminated spellings packed end to end */
+	guint32* words;        /* offset of each spelling in strings */
+	guint32 n_words;
+	gsize strings_size;
+	EnchantPWLDeletion* deletions;  /* sorted by hash, then word */
+	guint32 n_deletions;
+	GPtrArray* added;      /* spellings added since it was built */
+	GMappedFile* mapped;   /* set while the arrays point into a saved index */
+};
+
+/* "<filename>.del" starts with this, followed by the deletions, the
+ * offsets of the words and the strings */
+typedef struct str_enchant_pwl_deletions_header
+{
+	char magic[8];
+	guint32 version;
+	guint32 byte_order;
+	guint64 source_size;
+	gint64 source_mtime_ns;
+	guint64 source_inode;
+	guint32 prefix_len;
+	guint32 max_errors;
+	guint32 n_words;
+	guint32 n_deletions;
+	guint64 strings_size;
+} EnchantPWLDeletionsHeader;
+
+static void enchant_pwl_free_deletions(EnchantPWL *pwl)
+{
+	EnchantPWLDeletions *deletions = pwl->deletions;
+	if (deletions == NULL)
+		return;
+
+	if (deletions->mapped)
+		g_mapped_file_unref (deletions->mapped);
+	else
+		{
+			g_free (deletions->strings);
+			g_free (deletions->words);
+			g_free (deletions->deletions);
+		}
+	g_ptr_array_free (deletions->added, TRUE);
+	g_free (deletions);
+	pwl->deletions = NULL;
+}
+
+/* hash into hashes each string left by deleting from min_deleted to
+ * max_deleted of the first ENCHANT_PWL_DELETIONS_PREFIX characters of
+ * word, and the rest */
+static guint32 enchant_pwl_hash_deletions(const char *const word, int min_deleted, int max_deleted,
+					  guint32 *hashes)
+{
+	const char *chars[ENCHANT_PWL_DELETIONS_PREFIX + 1];
+	guint32 n_chars = 0;
+	for (chars[0] = word; n_chars < ENCHANT_PWL_DELETIONS_PREFIX && *chars[n_chars]; n_chars++)
+		chars[n_chars + 1] = g_utf8_next_char (chars[n_chars]);
+
+	guint32 n_hashes = 0;
+	for (guint32 deleted = 0; deleted < (1u << n_chars); deleted++)
+		{
+			int n_deleted = 0;
+			for (guint32 bits = deleted; bits; bits &= bits - 1)
+				n_deleted++;
+			if (n_deleted < min_deleted || n_deleted > max_deleted)
+				continue;
+
+			/* FNV-1a, as for the filter */
+			guint32 hash = 2166136261u;
+			for (guint32 i = 0; i < n_chars; i++)
+				if (!(deleted & (1u << i)))
+					for (const char *c = chars[i]; c < chars[i + 1]; c++)
+						hash = (hash ^ (guchar) *c) * 16777619u;
+			hashes[n_hashes++] = hash;
+		}
+	return n_hashes;
+}
+
+/* the most hashes enchant_pwl_hash_deletions gives */
+#define ENCHANT_PWL_DELETIONS_MAX_HASHES (1u << ENCHANT_PWL_DELETIONS_PREFIX)
+
+static int enchant_pwl_deletion_compare(gconstpointer a, gconstpointer b)
+{
+	const EnchantPWLDeletion *deletion_a = a, *deletion_b = b;
+	if (deletion_a->hash != deletion_b->hash)
+		return deletion_a->hash < deletion_b->hash ? -1 : 1;
+	return deletion_a->word < deletion_b->word ? -1 : deletion_a->word > deletion_b->word;
+}
+
+static void enchant_pwl_save_deletions(EnchantPWL *pwl, const EnchantPWLFileStamp* stamp)
+{
+	EnchantPWLDeletions *deletions = pwl->deletions;
+
+	EnchantPWLDeletionsHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, ENCHANT_PWL_DELETIONS_MAGIC, sizeof (header.magic));
+	header.version = ENCHANT_PWL_DELETIONS_VERSION;
+	header.byte_order = ENCHANT_PWL_INDEX_BYTE_ORDER;
+	header.source_size = stamp->size;
+	header.source_mtime_ns = stamp->mtime_ns;
+	header.source_inode = stamp->inode;
+	header.prefix_len = ENCHANT_PWL_DELETIONS_PREFIX;
+	header.max_errors = ENCHANT_PWL_MAX_ERRORS;
+	header.n_words = deletions->n_words;
+	header.n_deletions = deletions->n_deletions;
+	header.strings_size = deletions->strings_size;
+
+	GString *contents = g_string_sized_new (sizeof (header) + deletions->n_deletions * sizeof (EnchantPWLDeletion)
+						+ deletions->n_words * sizeof (guint32) + deletions->strings_size);
+	g_string_append_len (contents, (const char *) &header, sizeof (header));
+	g_string_append_len (contents, (const char *) deletions->deletions, deletions->n_deletions * sizeof (EnchantPWLDeletion));
+	g_string_append_len (contents, (const char *) deletions->words, deletions->n_words * sizeof (guint32));
+	g_string_append_len (contents, deletions->strings, deletions->strings_size);
+
+	char *deletions_file = g_strconcat (pwl->filename, ".del", NULL);
+	g_file_set_contents (deletions_file, contents->str, contents->len, NULL);
+	g_free (deletions_file);
+	g_string_free (contents, TRUE);
+}
+
+static gboolean enchant_pwl_load_deletions(EnchantPWL *pwl, const EnchantPWLFileStamp* stamp)
+{
+	char *deletions_file = g_strconcat (pwl->filename, ".del", NULL);
+	GMappedFile *map = g_mapped_file_new (deletions_file, FALSE, NULL);
+	g_free (deletions_file);
+	if (map == NULL)
+		return FALSE;
+
+	const char *data = g_mapped_file_get_contents (map);
+	gsize length = g_mapped_file_get_length (map);
+	const EnchantPWLDeletionsHeader *header = (const EnchantPWLDeletionsHeader *) data;
+	if (data == NULL || length < sizeof (EnchantPWLDeletionsHeader) ||
+	    memcmp (header->magic, ENCHANT_PWL_DELETIONS_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != ENCHANT_PWL_DELETIONS_VERSION ||
+	    header->byte_order != ENCHANT_PWL_INDEX_BYTE_ORDER ||
+	    header->source_size != (guint64) stamp->size ||
+	    header->source_mtime_ns != stamp->mtime_ns ||
+	    header->source_inode != stamp->inode ||
+	    header->prefix_len != ENCHANT_PWL_DELETIONS_PREFIX ||
+	    header->max_errors != ENCHANT_PWL_MAX_ERRORS ||
+	    length != sizeof (EnchantPWLDeletionsHeader)
+		      + (guint64) header->n_deletions * sizeof (EnchantPWLDeletion)
+		      + (guint64) header->n_words * sizeof (guint32) + header->strings_size)
+		{
+			g_mapped_file_unref (map);
+			return FALSE;
+		}
+
+	/* make sure a damaged index cannot send us outside of the mapping */
+	EnchantPWLDeletion *entries = (EnchantPWLDeletion *) (header + 1);
+	guint32 *words = (guint32 *) (entries + header->n_deletions);
+	char *strings = (char *) (words + header->n_words);
+	gboolean valid = header->strings_size == 0 || strings[header->strings_size - 1] == '\0';
+	for (guint32 i = 0; valid && i < header->n_words; i++)
+		valid = words[i] < header->strings_size;
+	for (guint32 i = 0; valid && i < header->n_deletions; i++)
+		valid = entries[i].word < header->n_words;
+	if (!valid)
+		{
+			g_mapped_file_unref (map);
+			return FALSE;
+		}
+
+	EnchantPWLDeletions *deletions = g_new0 (EnchantPWLDeletions, 1);
+	deletions->strings = strings;
+	deletions->words = words;
+	deletions->n_words = header->n_words;
+	deletions->strings_size = header->strings_size;
+	deletions->deletions = entries;
+	deletions->n_deletions = header->n_deletions;
+	deletions->added = g_ptr_array_new_with_free_func (g_free);
+	deletions->mapped = map;
+	pwl->deletions = deletions;
+	return TRUE;
+}
+
+/* whether the file is not being written and has nothing waiting to be;
+ * if so, its stamp is copied to stamp */
+static gboolean enchant_pwl_file_at_rest(EnchantPWL *pwl, EnchantPWLFileStamp *stamp)
+{
+	memset (stamp, 0, sizeof (*stamp));
+
+	/* file_lock comes before the lock, so it can only be tried here */
+	if (pwl->filename == NULL || !g_mutex_trylock (&pwl->file_lock))
+		return FALSE;
+
+	g_mutex_lock (&pwl->journal_lock);
+	gboolean at_rest = pwl->journal == NULL || pwl->journal->len == 0;
+	g_mutex_unlock (&pwl->journal_lock);
+	*stamp = pwl->file_changed;
+	g_mutex_unlock (&pwl->file_lock);
+	return at_rest && stamp->size > 0;
+}
+
+/* load or build the deletion index of the folded words */
+static void enchant_pwl_build_deletions(EnchantPWL *pwl)
+{
+	/* an index saved for the file as it is now is as good as a new one */
+	EnchantPWLFileStamp stamp;
+	gboolean at_rest = enchant_pwl_file_at_rest (pwl, &stamp);
+	if (at_rest && enchant_pwl_load_deletions (pwl, &stamp))
+		return;
+
+	EnchantPWLDeletions *deletions = g_new0 (EnchantPWLDeletions, 1);
+	deletions->n_words = g_hash_table_size (pwl->folded_words);
+	deletions->words = g_new (guint32, deletions->n_words);
+	deletions->added = g_ptr_array_new_with_free_func (g_free);
+
+	GString *strings = g_string_new (NULL);
+	GArray *entries = g_array_new (FALSE, FALSE, sizeof (EnchantPWLDeletion));
+	guint32 hashes[ENCHANT_PWL_DELETIONS_MAX_HASHES];
+	guint32 n_words = 0;
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, pwl->folded_words);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		{
+			deletions->words[n_words] = strings->len;
+			g_string_append_len (strings, key, strlen (key) + 1);
+
+			guint32 n_hashes = enchant_pwl_hash_deletions (key, 0, ENCHANT_PWL_MAX_ERRORS, hashes);
+			for (guint32 i = 0; i < n_hashes; i++)
+				{
+					EnchantPWLDeletion deletion = { hashes[i], n_words };
+					g_array_append_val (entries, deletion);
+				}
+			n_words++;
+		}
+
+	/* deleting different characters can leave the same string */
+	g_array_sort (entries, enchant_pwl_deletion_compare);
+	EnchantPWLDeletion *entry = (EnchantPWLDeletion *) entries->data;
+	guint32 n_deletions = 0;
+	for (guint32 i = 0; i < entries->len; i++)
+		if (n_deletions == 0 || enchant_pwl_deletion_compare (&entry[i], &entry[n_deletions - 1]) != 0)
+			entry[n_deletions++] = entry[i];
+
+	deletions->n_deletions = n_deletions;
+	deletions->deletions = (EnchantPWLDeletion *) g_array_free (entries, FALSE);
+	deletions->strings_size = strings->len;
+	deletions->strings = g_string_free (strings, FALSE);
+	pwl->deletions = deletions;
+
+	if (at_rest && deletions->n_words >= ENCHANT_PWL_INDEX_MIN_WORDS)
+		enchant_pwl_save_deletions (pwl, &stamp);
+}
+
+/* keep a spelling new to the folded words for searches of the index */
+static void enchant_pwl_add_deletions(EnchantPWL *pwl, const char *const folded)
+{
+	if (pwl->deletions->added->len >= ENCHANT_PWL_DELETIONS_MAX_ADDED)
+		enchant_pwl_free_deletions (pwl); /* built anew by the next search */
+	else
+		g_ptr_array_add (pwl->deletions->added, g_strdup (folded));
+}
+
+typedef struct str_enchant_pwl_deletions_match
+{
+	const char* folded;
+	int errs;
+	guint32 weight;
+} EnchantPWLDeletionsMatch;
+
+static void enchant_pwl_deletions_consider(EnchantSuggList *sugg_list, GHashTable *considered,
+					   GArray *matches, int *max_errors,
+					   const char *const pattern, const char *const folded)
+{
+	if (!g_hash_table_add (considered, (char *) folded) ||
+	    !g_hash_table_contains (sugg_list->folded_words, folded))
+		return;
+
+	int errs = edit_dist (pattern, folded, *max_errors);
+	if (errs > *max_errors)
+		return;
+
+	/* only get best errors, as the trie search does */
+	if (errs < *max_errors)
+		*max_errors = errs;
+	guint32 weight = sugg_list->frequencies ?
+		GPOINTER_TO_UINT (g_hash_table_lookup (sugg_list->frequencies, folded)) : 0;
+	EnchantPWLDeletionsMatch match = { folded, errs, weight };
+	g_array_append_val (matches, match);
+}
+
+/* consider the words with a deletion of the given hash */
+static void enchant_pwl_deletions_lookup(EnchantPWLDeletions *deletions, EnchantSuggList *sugg_list,
+					 GHashTable *considered, GArray *matches, int *max_errors,
+					 const char *const pattern, guint32 hash)
+{
+	/* the first deletion with the hash */
+	guint32 lo = 0, hi = deletions->n_deletions;
+	while (lo < hi)
+		{
+			guint32 mid = lo + (hi - lo) / 2;
+			if (deletions->deletions[mid].hash < hash)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+	for (; lo < deletions->n_deletions && deletions->deletions[lo].hash == hash; lo++)
+		enchant_pwl_deletions_consider (sugg_list, considered, matches, max_errors, pattern,
+						deletions->strings + deletions->words[deletions->deletions[lo].word]);
+}
+
+static int enchant_pwl_deletions_match_compare(gconstpointer a, gconstpointer b)
+{
+	const EnchantPWLDeletionsMatch *match_a = a, *match_b = b;
+	if (match_a->errs != match_b->errs)
+		return match_a->errs < match_b->errs ? -1 : 1;
+	if (match_a->weight != match_b->weight)
+		return match_a->weight > match_b->weight ? -1 : 1;
+	return strcmp (match_a->folded, match_b->folded);
+}
+
+/* add the best matches for word in the index to sugg_list, in the order
+ * the trie search would find them */
+static void enchant_pwl_deletions_suggest(EnchantPWL *pwl, const EnchantSuggestion *word,
+					  int max_errors, const EnchantPWLStop *stop,
+					  EnchantSuggList *sugg_list)
+{
+	EnchantPWLDeletions *deletions = pwl->deletions;
+	char *pattern = g_utf8_strdown (word->normalized, word->normalized_len);
+
+	GHashTable *considered = g_hash_table_new (g_str_hash, g_str_equal);
+	GArray *matches = g_array_new (FALSE, FALSE, sizeof (EnchantPWLDeletionsMatch));
+	for (guint32 i = 0; i < deletions->added->len; i++)
+		enchant_pwl_deletions_consider (sugg_list, considered, matches, &max_errors, pattern,
+						g_ptr_array_index (deletions->added, i));
+
+	/* a word within n errors is found by deleting at most n characters,
+	 * so fewer deletions need be tried once closer words are found */
+	guint32 hashes[ENCHANT_PWL_DELETIONS_MAX_HASHES];
+	for (int n_deleted = 0; n_deleted <= max_errors; n_deleted++)
+		{
+			if (stop && stop->stopped (stop->data))
+				break;
+
+			guint32 n_hashes = enchant_pwl_hash_deletions (pattern, n_deleted, n_deleted, hashes);
+			for (guint32 i = 0; i < n_hashes; i++)
+				enchant_pwl_deletions_lookup (deletions, sugg_list, considered, matches, &max_errors, pattern, hashes[i]);
+		}
+
+
+	g_array_sort (matches, enchant_pwl_deletions_match_compare);
+	for (guint32 i = 0; i < matches->len; i++)
+		{
+			EnchantPWLDeletionsMatch *match = &g_array_index (matches, EnchantPWLDeletionsMatch, i);
+			if (match->errs > max_errors)
+				break;
+			for (GSList *words = g_hash_table_lookup (sugg_list->folded_words, match->folded); words; words = words->next)
+				enchant_pwl_suggest_add (sugg_list, words->data, match->errs, match->weight);
+		}
+
+	g_array_free (matches, TRUE);
+	g_hash_table_destroy (considered);
+	g_free (pattern);
+}
+
+/**
+ * enchant_pwl_set_suggest_engine
+ *
+ * Chooses how the PWL looks for suggestions.
+ */
+void enchant_pwl_set_suggest_engine(EnchantPWL *pwl, EnchantPWLSuggestEngine engine)
+{
+	g_rw_lock_writer_lock (&pwl->lock);
+	pwl->suggest_engine = engine;
+	if (engine != ENCHANT_PWL_SUGGEST_DELETIONS)
+		enchant_pwl_free_deletions (pwl);
+	g_rw_lock_writer_unlock (&pwl->lock);
+}
+
+/* the frequencies of a list of "word count" lines, by lowercase spelling */
+static GHashTable *enchant_pwl_parse_frequencies(const char *const contents, gsize length)
+{
+	GHashTable *frequencies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	const char *line = contents, *end = contents + length;
+	while (line < end)
+		{
+			const char *eol = memchr (line, '\n', end - line);
+			if (eol == NULL)
+				eol = end;
+			const char *next = eol < end ? eol + 1 : end;
+
+			/* the count is the last field, the word what comes before */
+			const char *count = eol;
+			while (count > line && g_ascii_isspace (count[-1]))
+				count--;
+			const char *word_end = count;
+			while (count > line && g_ascii_isdigit (count[-1]))
+				count--;
+			const char *word_start = line;
+			while (word_start < count && g_ascii_isspace (*word_start))
+				word_start++;
+			if (count == word_end || count == line || !g_ascii_isspace (count[-1]) ||
+			    *word_start == '#')
+				{
+					line = next;
+					continue;
+				}
+			const char *sep = count;
+			while (sep > word_start && g_ascii_isspace (sep[-1]))
+				sep--;
+
+			guint64 value = g_ascii_strtoull (count, NULL, 10);
+			guint32 frequency = (guint32) MIN (value, G_MAXUINT32);
+			if (sep > word_start && frequency != 0 && g_utf8_validate (word_start, sep - word_start, NULL))
+				{
+					char *normalized = g_utf8_normalize (word_start, sep - word_start, G_NORMALIZE_NFD);
+					char *folded = g_utf8_strdown (normalized, -1);
+					g_free (normalized);
+
+					guint32 known = GPOINTER_TO_UINT (g_hash_table_lookup (frequencies, folded));
+					if (frequency > known)
+						g_hash_table_insert (frequencies, folded, GUINT_TO_POINTER (frequency));
+					else
+						g_free (folded);
+				}
+			line = next;
+		}
+
+	if (g_hash_table_size (frequencies) == 0)
+		{
+			g_hash_table_destroy (frequencies);
+			return NULL;
+		}
+	return frequencies;
+}
+
+/**
+ * enchant_pwl_set_frequencies
+ *
+ * Ranks the suggestions with as many errors as each other by the
+ * frequencies the file lists, see enchant_dict_set_pwl_frequencies.
+ * The folded trie is weighed by them, which lets a search leave out
+ * the subtries that cannot improve on a full list.
+ */
+int enchant_pwl_set_frequencies(EnchantPWL *pwl, const char *const filename)
+{
+	GHashTable *frequencies = NULL;
+	if (filename)
+		{
+			char *contents;
+			gsize length;
+			if (!g_file_get_contents (filename, &contents, &length, NULL))
+				return -1;
+			frequencies = enchant_pwl_parse_frequencies (contents, length);
+			g_free (contents);
+		}
+
+	g_rw_lock_writer_lock (&pwl->lock);
+	if (pwl->frequencies)
+		g_hash_table_unref (pwl->frequencies);
+	pwl->frequencies = frequencies;
+	enchant_trie_weigh (pwl->folded_trie, frequencies);
+	g_atomic_int_inc (&pwl->generation);
+	g_rw_lock_writer_unlock (&pwl->lock);
+	return 0;
+}
+
+/*  Most words checked against a PWL are not in it, so lookups are
+ *  fronted by a Bloom filter of the normalized words, which turns
+ *  away most misses before the hash table is consulted.  It sets two
+ *  bits per word in an array of at least ENCHANT_PWL_FILTER_BITS bits
+ *  per word.  It is built by the first check, with room for as many
+ *  words again, and dropped to be built anew once they outgrow it.
+ *  Removed words stay in it until then.
+ */
+#define ENCHANT_PWL_FILTER_BITS 16
+
+static guint32 enchant_pwl_filter_hash(const char *const word, size_t len)
+{
+	/* FNV-1a */
+	guint32 hash = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ (guchar) word[i]) * 16777619u;
+	return hash;
+}
+
+/* the second bit, derived from the hash by a multiplicative mix */
+static guint32 enchant_pwl_filter_rehash(guint32 hash)
+{
+	hash = (hash ^ (hash >> 15)) * 0x2c1b3c6du;
+	return hash ^ (hash >> 12);
+}
+
+static void enchant_pwl_filter_add(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	guint32 hash = enchant_pwl_filter_hash (word, len);
+	guint32 bit = hash & pwl->filter_mask;
+	pwl->filter[bit / 64] |= G_GUINT64_CONSTANT(1) << (bit % 64);
+	bit = enchant_pwl_filter_rehash (hash) & pwl->filter_mask;
+	pwl->filter[bit / 64] |= G_GUINT64_CONSTANT(1) << (bit % 64);
+}
+
+static gboolean enchant_pwl_filter_may_contain(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	guint32 hash = enchant_pwl_filter_hash (word, len);
+	guint32 bit = hash & pwl->filter_mask;
+	if (!(pwl->filter[bit / 64] & (G_GUINT64_CONSTANT(1) << (bit % 64))))
+		return FALSE;
+	bit = enchant_pwl_filter_rehash (hash) & pwl->filter_mask;
+	return (pwl->filter[bit / 64] & (G_GUINT64_CONSTANT(1) << (bit % 64))) != 0;
+}
+
+static void enchant_pwl_build_filter(EnchantPWL *pwl)
+{
+	guint64 capacity = MAX (2 * (guint64) g_hash_table_size (pwl->words_in_trie), 64);
+	guint64 n_bits = 64;
+	while (n_bits < capacity * ENCHANT_PWL_FILTER_BITS && n_bits < (G_GUINT64_CONSTANT(1) << 32))
+		n_bits <<= 1;
+
+	pwl->filter = g_new0 (guint64, n_bits / 64);
+	pwl->filter_mask = (guint32) (n_bits - 1);
+	pwl->filter_room = (guint32) MIN (capacity - g_hash_table_size (pwl->words_in_trie), G_MAXUINT32);
+
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, pwl->words_in_trie);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		enchant_pwl_filter_add (pwl, key, strlen (key));
+}
+
+/* Words up to this long are normalized without allocating */
+#define ENCHANT_PWL_NORMALIZE_BUF_SIZE 64
+
+/* The NFD form of word, nul-terminated.  ASCII is its own normal form,
+ * so it is only copied, into buf when it fits; *to_free is left with
+ * what has to be freed afterwards, if anything */
+static const char *enchant_pwl_normalize(const char *const word, size_t len,
+					 char *buf, char **to_free)
+{
+	*to_free = NULL;
+	if (enchant_utf8_ascii_prefix (word, len) == len)
+		{
+			if (len < ENCHANT_PWL_NORMALIZE_BUF_SIZE)
+				{
+					memcpy (buf, word, len);
+					buf[len] = '\0';
+					return buf;
+				}
+			return *to_free = g_strndup (word, len);
+		}
+	return *to_free = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+}
+
+/* records word, normalized as normalized_word, in words_in_trie but not
+ * in the trie; returns its key, or NULL if it was there already */
+static const char *enchant_pwl_insert_word(EnchantPWL *pwl, const char *const word, size_t len,
+					   const char *const normalized_word)
+{
+	if(NULL != g_hash_table_lookup (pwl->words_in_trie, normalized_word))
+		return NULL;
+
+	/* most words are stored as they are spelt, ASCII ones always */
+	char *key = g_string_chunk_insert (pwl->words, normalized_word);
+	char *original = key;
+	pwl->words_size += strlen (key) + 1;
+	if (strlen (key) != len || memcmp (key, word, len) != 0)
+		{
+			original = g_string_chunk_insert_len (pwl->words, word, len);
+			pwl->words_size += len + 1;
+		}
+	g_hash_table_insert (pwl->words_in_trie, key, original);
+
+	g_atomic_int_inc (&pwl->generation);
+	if (pwl->folded_words)
+		enchant_pwl_add_folded (pwl, key);
+	if (pwl->filter)
+		{
+			if (pwl->filter_room == 0)
+				enchant_pwl_free_filter (pwl);
+			else
+				{
+					enchant_pwl_filter_add (pwl, key, strlen (key));
+					pwl->filter_room--;
+				}
+		}
+	return key;
+}
+
+static gboolean enchant_pwl_add_to_trie(EnchantPWL *pwl,
+					const char *const word, size_t len)
+{
+	char buf[ENCHANT_PWL_NORMALIZE_BUF_SIZE], *to_free;
+	const char *normalized_word = enchant_pwl_normalize (word, len, buf, &to_free);
+	const char *key = enchant_pwl_insert_word (pwl, word, len, normalized_word);
+	if (key)
+		pwl->trie = enchant_trie_insert(pwl->trie, key);
+	g_free (to_free);
+	return key != NULL;
+}
+
+/* rebuild the trie from scratch, dropping the space held by removed words */
+static void enchant_pwl_rebuild_trie(EnchantPWL *pwl)
+{
+	enchant_trie_free(pwl->trie);
+	pwl->trie = NULL;
+
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init (&iter, pwl->words_in_trie);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		pwl->trie = enchant_trie_insert(pwl->trie, (const char*)key);
+}
+
+static gboolean enchant_pwl_remove_from_trie(EnchantPWL *pwl,
+					const char *const word, size_t len)
+{
+	char buf[ENCHANT_PWL_NORMALIZE_BUF_SIZE], *to_free;
+	const char *normalized_word = enchant_pwl_normalize (word, len, buf, &to_free);
+
+	gboolean removed = g_hash_table_remove (pwl->words_in_trie, normalized_word);
+	if (removed)
+		{
+			g_atomic_int_inc (&pwl->generation);
+			if (pwl->folded_words)
+				enchant_pwl_remove_folded (pwl, normalized_word);
+
+			enchant_trie_ensure_writable(pwl->trie);
+			enchant_trie_remove(pwl->trie, 0, normalized_word);
+			if(enchant_trie_is_empty (pwl->trie)) {
+				enchant_trie_free (pwl->trie);
+				pwl->trie = NULL; /* make trie empty if has no content */
+			} else if(pwl->trie && pwl->trie->dead_nodes > pwl->trie->n_nodes / 2) {
+				enchant_pwl_rebuild_trie (pwl); /* reclaim the arena */
+			}
+		}
+	
+	g_free(to_free);
+	return removed;
+}
+
+/* append text made of whole lines to the word list file */
+static void enchant_pwl_append_lines(EnchantPWL *pwl, const char *const text, size_t len)
+{
+	FILE *f = g_fopen(pwl->filename, "a+");
+	if (f == NULL)
+		{
+			/* the file may have been opened without being created,
+			 * and its directory may not be there yet either */
+			char *dir = g_path_get_dirname (pwl->filename);
+			g_mkdir_with_parents (dir, 0700);
+			g_free (dir);
+			f = g_fopen(pwl->filename, "a+");
+		}
+	if (f)
+		{
+			/* Since this function does not signal I/O
+			   errors, only use return values to avoid
+			   doing things that seem futile. */
+
+			enchant_lock_file (f);
+
+			/* when all of the file has been read, there is no need
+			 * to read back what is appended to it */
+			GStatBuf stats;
+			EnchantPWLFileStamp stamp;
+			gboolean up_to_date = FALSE;
+			if (g_stat(pwl->filename, &stats) == 0)
+				{
+					enchant_pwl_stamp_file(&stamp, &stats);
+					up_to_date = enchant_pwl_stamp_equal(&stamp, &pwl->file_changed) &&
+						pwl->file_read.offset == stats.st_size;
+				}
+
+			/* Add a newline if the file doesn't end with one. */
+			if (fseek (f, -1, SEEK_END) == 0)
+				{
+					int c = getc (f);
+					fseek (f, 0L, SEEK_CUR); /* ISO C requires positioning between read and write. */
+					if (c != '\n')
+						putc ('\n', f);
+				}
+
+			if (fwrite (text, sizeof(char), len, f) == len && up_to_date &&
+			    fflush (f) == 0 && g_stat(pwl->filename, &stats) == 0)
+				{
+					enchant_pwl_stamp_file(&pwl->file_changed, &stats);
+					for (size_t i = 0; i < len; i++)
+						if (text[i] == '\n')
+							pwl->file_lines++;
+					enchant_pwl_read_fingerprint (f, stats.st_size, &pwl->file_read);
+				}
+			enchant_unlock_file (f);
+			fclose (f);
+		}
+}
+
+/* rewrite the word list without its removal lines and the words they
+ * cancelled; the new file is written next to it and renamed into place,
+ * all with the file locked, so that no other process appends a word in
+ * between that would be lost.  Called with file_lock held and the lock
+ * held for reading. */
+static void enchant_pwl_compact_file(EnchantPWL *pwl)
+{
+	/* words still in the journal are not in the file to be kept */
+	enchant_pwl_write_journal(pwl);
+
+	FILE *f = g_fopen(pwl->filename, "rb");
+	if (f == NULL)
+		return;
+	enchant_lock_file (f);
+
+	GString *read = g_string_new (NULL);
+	char buffer[BUFSIZ];
+	size_t n_read;
+	while ((n_read = fread (buffer, 1, sizeof (buffer), f)) != 0)
+		g_string_append_len (read, buffer, n_read);
+	char *contents = read->str;
+	size_t length = read->len;
+
+	GString *compacted = g_string_sized_new (length);
+	GHashTable *written = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	char *line = contents;
+	if(BOM == g_utf8_get_char(contents))
+		{
+			line = g_utf8_next_char(contents);
+			g_string_append_len (compacted, contents, line - contents);
+		}
+
+	char *end = contents + length;
+	while (line < end)
+		{
+			char *eol = memchr (line, '\n', end - line);
+			size_t line_len = eol ? (size_t) (eol - line) : (size_t) (end - line);
+			char *word = g_strndup (line, line_len);
+			g_strchomp (word);
+
+			/* comments and lines we never read are kept as they are,
+			 * words only once and only while they are in the list */
+			gboolean keep = TRUE;
+			if (g_str_has_prefix (word, ENCHANT_PWL_TOMBSTONE))
+				keep = FALSE;
+			else if (word[0] && word[0] != '#' && line_len < BUFSIZ &&
+				 enchant_utf8_validate (word, -1, NULL))
+				{
+					char buf[ENCHANT_PWL_NORMALIZE_BUF_SIZE], *to_free;
+					const char *normalized_word = enchant_pwl_normalize (word, strlen (word), buf, &to_free);
+					char *original = g_hash_table_lookup (pwl->words_in_trie, normalized_word);
+					keep = original != NULL && strcmp (original, word) == 0 &&
+						!g_hash_table_contains (written, original);
+					if (keep)
+						g_hash_table_add (written, original);
+					g_free (to_free);
+				}
+
+			if (keep)
+				{
+					g_string_append_len (compacted, line, line_len);
+					g_string_append_c (compacted, '\n');
+				}
+			g_free (word);
+			line += line_len + 1;
+		}
+
+	char *compacted_filename = g_strconcat (pwl->filename, ".compact", NULL);
+	gboolean replaced = g_file_set_contents (compacted_filename, compacted->str, compacted->len, NULL);
+#if defined(_WIN32)
+	/* a file still open cannot be renamed over */
+	enchant_unlock_file (f);
+	fclose (f);
+	f = NULL;
+#endif
+	if (replaced && g_rename (compacted_filename, pwl->filename) != 0)
+		{
+			g_unlink (compacted_filename);
+			replaced = FALSE;
+		}
+	g_free (compacted_filename);
+
+	if (replaced)
+		{
+			/* the file, a new one now, holds just what the trie does */
+			GStatBuf stats;
+			FILE *compacted_f = g_fopen(pwl->filename, "rb");
+			if (compacted_f && g_stat(pwl->filename, &stats) == 0 && stats.st_size == (goffset) compacted->len)
+				{
+					enchant_pwl_stamp_file(&pwl->file_changed, &stats);
+					enchant_pwl_read_fingerprint (compacted_f, compacted->len, &pwl->file_read);
+					pwl->file_lines = 0;
+					for (size_t i = 0; i < compacted->len; i++)
+						if (compacted->str[i] == '\n')
+							pwl->file_lines++;
+				}
+			else
+				{
+					/* read all of it next time */
+					memset(&pwl->file_changed, 0, sizeof(pwl->file_changed));
+					memset(&pwl->file_read, 0, sizeof(pwl->file_read));
+				}
+			if (compacted_f)
+				fclose (compacted_f);
+			pwl->file_tombstones = 0;
+		}
+
+	if (f)
+		{
+			enchant_unlock_file (f);
+			fclose (f);
+		}
+	g_hash_table_destroy (written);
+	g_string_free (compacted, TRUE);
+	g_string_free (read, TRUE);
+}
+
+/*  Words added and removed by many threads at once would have them
+ *  take turns at the lock and at the file one word at a time.  Instead
+ *  each writer queues its update, and whichever finds no one applying
+ *  them applies all those queued so far, taking the lock for writing
+ *  and appending to the file once for all of them, while the others
+ *  wait for theirs to be done.
+ */
+typedef struct str_enchant_pwl_update
+{
+	const char *word;
+	size_t len;
+	gboolean remove;
+	gboolean changed;      /* whether it added or removed the word */
+	gboolean done;
+} EnchantPWLUpdate;
+
+static void enchant_pwl_apply_updates(EnchantPWL *pwl, GPtrArray *updates)
+{
+	GString *lines = g_string_new (NULL);
+	size_t n_removed = 0;
+	g_rw_lock_writer_lock (&pwl->lock);
+	for (guint i = 0; i < updates->len; i++)
+		{
+			EnchantPWLUpdate *update = g_ptr_array_index (updates, i);
+			if (update->remove)
+				{
+					update->changed = enchant_pwl_remove_from_trie(pwl, update->word, update->len);
+					if (!update->changed)
+						continue;
+					g_string_append (lines, ENCHANT_PWL_TOMBSTONE);
+					n_removed++;
+				}
+			else
+				update->changed = enchant_pwl_add_to_trie(pwl, update->word, update->len);
+			g_string_append_len (lines, update->word, update->len);
+			g_string_append_c (lines, '\n');
+		}
+	g_rw_lock_writer_unlock (&pwl->lock);
+
+	if (pwl->filename != NULL && lines->len > 0)
+		{
+			enchant_pwl_write_lines(pwl, lines->str, lines->len);
+			if (n_removed > 0)
+				{
+					/* record the removals rather than rewriting the file,
+					 * until removal lines outnumber the words left */
+					g_mutex_lock (&pwl->file_lock);
+					g_rw_lock_reader_lock (&pwl->lock);
+					pwl->file_tombstones += n_removed;
+					if (pwl->file_tombstones > g_hash_table_size (pwl->words_in_trie))
+						enchant_pwl_compact_file(pwl);
+					g_rw_lock_reader_unlock (&pwl->lock);
+					g_mutex_unlock (&pwl->file_lock);
+				}
+		}
+	g_string_free (lines, TRUE);
+}
+
+/* queue update and wait until it is applied, applying it and those
+ * queued with it if no one else is applying any */
+static void enchant_pwl_update(EnchantPWL *pwl, EnchantPWLUpdate *update)
+{
+	g_mutex_lock (&pwl->updates_lock);
+	g_ptr_array_add (pwl->updates, update);
+	while (!update->done && pwl->updating)
+		g_cond_wait (&pwl->updates_cond, &pwl->updates_lock);
+	if (update->done)
+		{
+			g_mutex_unlock (&pwl->updates_lock);
+			return;
+		}
+
+	GPtrArray *updates = pwl->updates;
+	pwl->updates = g_ptr_array_new ();
+	pwl->updating = TRUE;
+	g_mutex_unlock (&pwl->updates_lock);
+
+	enchant_pwl_apply_updates (pwl, updates);
+
+	g_mutex_lock (&pwl->updates_lock);
+	for (guint i = 0; i < updates->len; i++)
+		((EnchantPWLUpdate *) g_ptr_array_index (updates, i))->done = TRUE;
+	/* those queued meanwhile wake to have one of them apply theirs */
+	pwl->updating = FALSE;
+	g_cond_broadcast (&pwl->updates_cond);
+	g_mutex_unlock (&pwl->updates_lock);
+	g_ptr_array_free (updates, TRUE);
+}
+
+void enchant_pwl_add(EnchantPWL *pwl,
+			 const char *const word, size_t len)
+{
+	if (pwl->readonly)
+		return;
+
+	enchant_pwl_refresh_from_file(pwl);
+
+	EnchantPWLUpdate update = { word, len, FALSE, FALSE, FALSE };
+	enchant_pwl_update(pwl, &update);
+}
+
+void enchant_pwl_add_many(EnchantPWL *pwl,
+			  const char *const *words, size_t n_words)
+{
+	if (pwl->readonly)
+		return;
+
+	enchant_pwl_refresh_from_file(pwl);
+
+	/* write the new words in one go, as enchant_pwl_add would one by one */
+	GString *lines = g_string_new (NULL);
+	g_rw_lock_writer_lock (&pwl->lock);
+	for (size_t i = 0; i < n_words; i++)
+		{
+			size_t len = strlen (words[i]);
+			if (enchant_pwl_add_to_trie(pwl, words[i], len))
+				{
+					g_string_append_len (lines, words[i], len);
+					g_string_append_c (lines, '\n');
+				}
+		}
+	g_rw_lock_writer_unlock (&pwl->lock);
+
+	if (pwl->filename != NULL && lines->len > 0)
+		enchant_pwl_write_lines(pwl, lines->str, lines->len);
+	g_string_free (lines, TRUE);
+}
+
+/* tells whether the words changed since an earlier call, having first
+ * caught up with changes to the file */
+unsigned int enchant_pwl_get_generation(EnchantPWL *pwl)
+{
+	enchant_pwl_refresh_from_file(pwl);
+	return (guint) g_atomic_int_get (&pwl->generation);
+}
+
+void enchant_pwl_get_reload_stats(EnchantPWL *pwl, size_t *n_reloads, uint64_t *reload_us)
+{
+	*n_reloads = (size_t) g_atomic_int_get (&pwl->n_reloads);
+	G_LOCK (enchant_pwl_reload_stats);
+	*reload_us = pwl->reload_us;
+	G_UNLOCK (enchant_pwl_reload_stats);
+}
+
+void enchant_pwl_get_work_stats(EnchantPWL *pwl, uint64_t *n_nodes_visited, uint64_t *n_file_polls)
+{
+	*n_nodes_visited = (uint64_t) (gsize) g_atomic_pointer_get (&pwl->n_nodes_visited);
+	*n_file_polls = (uint64_t) (gsize) g_atomic_pointer_get (&pwl->n_file_polls);
+}
+
+void enchant_pwl_trim(EnchantPWL *pwl)
+{
+	g_rw_lock_writer_lock (&pwl->lock);
+
+	/* folded again, and indexed again, by the next search for suggestions */
+	enchant_pwl_free_folded (pwl);
+
+	if (pwl->trie && pwl->trie->mapped == NULL)
+		{
+			EnchantTrie *trie = enchant_trie_compact (pwl->trie);
+			enchant_trie_free (pwl->trie);
+			pwl->trie = trie;
+		}
+
+	/* the words of a compiled index are where it is mapped */
+	if (pwl->index == NULL)
+		{
+			GHashTable *words_in_trie = g_hash_table_new (g_str_hash, g_str_equal);
+			GStringChunk *words = g_string_chunk_new (4096);
+			gsize words_size = 0;
+			GHashTableIter iter;
+			gpointer key, value;
+			g_hash_table_iter_init (&iter, pwl->words_in_trie);
+			while (g_hash_table_iter_next (&iter, &key, &value))
+				{
+					char *copy = g_string_chunk_insert (words, key);
+					words_size += strlen (key) + 1;
+					if (value != key)
+						{
+							value = g_string_chunk_insert (words, value);
+							words_size += strlen (value) + 1;
+						}
+					g_hash_table_insert (words_in_trie, copy, value != key ? value : copy);
+				}
+			g_hash_table_destroy (pwl->words_in_trie);
+			g_string_chunk_free (pwl->words);
+			pwl->words_in_trie = words_in_trie;
+			pwl->words = words;
+			pwl->words_size = words_size;
+		}
+
+	g_rw_lock_writer_unlock (&pwl->lock);
+}
+
+size_t enchant_hash_table_memory_usage(size_t n_entries)
+{
+	/* GHashTable keeps its slots at most three quarters full, in a
+	 * power of two of at least 8 of them, each with a hash, a key
+	 * and a value */
+	size_t n_slots = 8;
+	while (n_slots * 3 / 4 < n_entries)
+		n_slots *= 2;
+	return 64 + n_slots * (sizeof (guint) + 2 * sizeof (gpointer));
+}
+
+static size_t enchant_trie_memory_usage(const EnchantTrie* trie)
+{
+	if (trie == NULL)
+		return 0;
+
+	size_t size = sizeof (EnchantTrie) + trie->n_weights * sizeof (guint32);
+	if (trie->mapped == NULL)
+		size += trie->nodes_cap * sizeof (EnchantTrieNode) +
+			trie->edges_cap * sizeof (EnchantTrieEdge) +
+			trie->strings_cap;
+	return size;
+}
+
+void enchant_pwl_get_memory_usage(EnchantPWL *pwl, size_t *heap, size_t *mapped)
+{
+	size_t heap_size = sizeof (EnchantPWL), mapped_size = 0;
+	if (pwl->filename)
+		heap_size += strlen (pwl->filename) + 1;
+	if (pwl->canonical_filename)
+		heap_size += strlen (pwl->canonical_filename) + 1;
+
+	g_rw_lock_reader_lock (&pwl->lock);
+	size_t n_words = g_hash_table_size (pwl->words_in_trie);
+	heap_size += enchant_hash_table_memory_usage (n_words) + pwl->words_size;
+	heap_size += enchant_trie_memory_usage (pwl->trie);
+	if (pwl->index)
+		mapped_size += g_mapped_file_get_length (pwl->index);
+
+	if (pwl->folded_words)
+		{
+			/* each word is in the list of its lowercase spelling */
+			heap_size += enchant_hash_table_memory_usage (g_hash_table_size (pwl->folded_words)) +
+				     n_words * sizeof (GSList);
+			heap_size += enchant_trie_memory_usage (pwl->folded_trie);
+		}
+	if (pwl->filter)
+		heap_size += ((size_t) pwl->filter_mask + 1) / 8;
+	if (pwl->frequencies)
+		{
+			heap_size += enchant_hash_table_memory_usage (g_hash_table_size (pwl->frequencies));
+			GHashTableIter iter;
+			gpointer key;
+			g_hash_table_iter_init (&iter, pwl->frequencies);
+			while (g_hash_table_iter_next (&iter, &key, NULL))
+				heap_size += strlen (key) + 1;
+		}
+
+	EnchantPWLDeletions *deletions = pwl->deletions;
+	if (deletions)
+		{
+			heap_size += sizeof (EnchantPWLDeletions);
+			if (deletions->mapped)
+				mapped_size += g_mapped_file_get_length (deletions->mapped);
+			else
+				heap_size += deletions->strings_size +
+					     deletions->n_words * sizeof (guint32) +
+					     deletions->n_deletions * sizeof (EnchantPWLDeletion);
+			heap_size += deletions->added->len * sizeof (gpointer);
+			for (guint i = 0; i < deletions->added->len; i++)
+				heap_size += strlen (g_ptr_array_index (deletions->added, i)) + 1;
+		}
+	g_rw_lock_reader_unlock (&pwl->lock);
+
+	g_mutex_lock (&pwl->journal_lock);
+	if (pwl->journal)
+		heap_size += sizeof (GString) + pwl->journal->allocated_len;
+	g_mutex_unlock (&pwl->journal_lock);
+
+	*heap = heap_size;
+	*mapped = mapped_size;
+}
+
+void enchant_pwl_remove(EnchantPWL *pwl,
+			 const char *const word, size_t len)
+{
+	if(pwl->readonly || enchant_pwl_check(pwl, word, len) == 1)
+		return;
+
+	enchant_pwl_refresh_from_file(pwl);
+
+	EnchantPWLUpdate update = { word, len, TRUE, FALSE, FALSE };
+	enchant_pwl_update(pwl, &update);
+}
+
+static gboolean enchant_pwl_contains_folded(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	char buf[ENCHANT_PWL_NORMALIZE_BUF_SIZE], *to_free;
+	const char *normalized_word = enchant_pwl_normalize (word, len, buf, &to_free);
+	char *folded = g_utf8_strdown (normalized_word, -1);
+	gboolean found = g_hash_table_contains (pwl->folded_words, folded);
+	g_free (folded);
+	g_free (to_free);
+	return found;
+}
+
+static int enchant_pwl_contains(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	if (g_hash_table_size (pwl->words_in_trie) == 0)
+		return 0;
+
+	/* ASCII is its own normal form */
+	size_t ascii_len = enchant_utf8_ascii_prefix (word, len);
+
+	char *normalized_word = NULL;
+	const char *key = word;
+	if (ascii_len < len)
+		{
+			normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+			if (normalized_word == NULL)
+				return 0;
+			key = normalized_word;
+			len = strlen (normalized_word);
+		}
+
+	int found = 0;
+	if (enchant_pwl_filter_may_contain (pwl, key, len))
+		{
+			if (normalized_word == NULL)
+				key = normalized_word = g_strndup (word, len);
+			found = g_hash_table_contains (pwl->words_in_trie, key);
+		}
+
+	g_free (normalized_word);
+	return found;
+}
+
+EnchantCaseShape enchant_case_shape(const char *const word, size_t len)
+{
+	int initial = -1;	/* whether the first character can begin a title-case word */
+	int capital_after_initial = 0, has_capital = 0, has_upper = 0, has_lower = 0;
+
+	for (const char *it = word; it < word + len; )
+		{
+			int upper, capital, lower, title_initial;
+			guchar c = (guchar) *it;
+			if (c < 0x80)
+				{
+					/* ASCII needs no table lookups, and is its own title case */
+					upper = capital = c >= 'A' && c <= 'Z';
+					lower = c >= 'a' && c <= 'z';
+					title_initial = upper;
+					it++;
+				}
+			else
+				{
+					gunichar ch = g_utf8_get_char (it);
+					GUnicodeType type = g_unichar_type (ch);
+					upper = type == G_UNICODE_UPPERCASE_LETTER;
+					capital = upper || type == G_UNICODE_TITLECASE_LETTER;
+					lower = type == G_UNICODE_LOWERCASE_LETTER || type == G_UNICODE_TITLECASE_LETTER;
+					title_initial = capital && ch == g_unichar_totitle (ch);
+					it = g_utf8_next_char (it);
+				}
+
+			if (initial < 0)
+				initial = title_initial;
+			else
+				capital_after_initial |= capital;
+			has_capital |= capital;
+			has_upper |= upper;
+			has_lower |= lower;
+		}
+
+	if (initial > 0 && !capital_after_initial)
+		return ENCHANT_CASE_TITLE;
+	if (has_upper && !has_lower)
+		return ENCHANT_CASE_ALL_CAPS;
+	return has_capital ? ENCHANT_CASE_MIXED : ENCHANT_CASE_LOWER;
+}
+
+static gchar* enchant_utf8_strtitle(const gchar*str, gssize len)
+{
+	gchar *upperStr = g_utf8_strup(str, len); /* for locale-sensitive casing */
+	gunichar title_case_char = g_unichar_totitle(g_utf8_get_char(upperStr));
 	gchar title_case_utf8[7];
 	gint utf8len = g_unichar_to_utf8(title_case_char, title_case_utf8);
 	title_case_utf8[utf8len] = '\0';
@@ -521,295 +3017,1247 @@ static gchar* enchant_utf8_strtitle(const gchar*str, gssize len)
 	g_free(upperStr);
 	g_free(lowerTail);
 
-	return result;
+	return result;
+}
+
+/*  Take the lock for reading, once the filter and, if asked for, the
+ *  folded trie and deletion index that are built on first use have been.
+ */
+static gboolean enchant_pwl_ready(EnchantPWL *pwl, gboolean fold)
+{
+	if (pwl->filter == NULL)
+		return FALSE;
+	if (!fold)
+		return TRUE;
+	return pwl->folded_words != NULL &&
+		(pwl->suggest_engine != ENCHANT_PWL_SUGGEST_DELETIONS || pwl->deletions != NULL);
+}
+
+static void enchant_pwl_lock_for_reading(EnchantPWL *pwl, gboolean fold)
+{
+	g_rw_lock_reader_lock (&pwl->lock);
+	while (!enchant_pwl_ready (pwl, fold))
+		{
+			g_rw_lock_reader_unlock (&pwl->lock);
+
+			g_rw_lock_writer_lock (&pwl->lock);
+			if (pwl->filter == NULL)
+				enchant_pwl_build_filter (pwl);
+			if (fold)
+				enchant_pwl_fold_words (pwl);
+			if (fold && pwl->suggest_engine == ENCHANT_PWL_SUGGEST_DELETIONS && pwl->deletions == NULL)
+				enchant_pwl_build_deletions (pwl);
+			g_rw_lock_writer_unlock (&pwl->lock);
+
+			/* a writer may drop them again in between */
+			g_rw_lock_reader_lock (&pwl->lock);
+		}
+}
+
+/**
+ * enchant_pwl_freeze
+ *
+ * Gets the PWL ready for a process about to fork.  It catches up with
+ * the file one last time and builds what checking, and if fold is set
+ * looking for suggestions, would build later, so that no forked process
+ * builds its own.  The tries are moved to read-only memory, which the
+ * processes keep sharing for as long as none of them adds or removes
+ * words.  From then on the file is neither polled nor watched: each
+ * process polling it would touch the pages, and the children would take
+ * one another's notifications.
+ */
+void enchant_pwl_freeze(EnchantPWL *pwl, int fold)
+{
+	enchant_pwl_refresh_from_file (pwl);
+
+	/* let a reload under way swap in what it read */
+	g_mutex_lock (&pwl->file_lock);
+	while (pwl->reloading)
+		{
+			g_mutex_unlock (&pwl->file_lock);
+			g_usleep (1000);
+			g_mutex_lock (&pwl->file_lock);
+		}
+	if (pwl->reloader)
+		{
+			g_thread_join (pwl->reloader);
+			pwl->reloader = NULL;
+		}
+	enchant_pwl_write_journal (pwl);
+	g_atomic_int_set (&pwl->frozen, TRUE);
+	enchant_pwl_unwatch_file (pwl);
+	g_mutex_unlock (&pwl->file_lock);
+
+	enchant_pwl_lock_for_reading (pwl, fold);
+	g_rw_lock_reader_unlock (&pwl->lock);
+
+	g_rw_lock_writer_lock (&pwl->lock);
+	if (pwl->trie && pwl->trie->mapped == NULL && pwl->trie->dead_nodes > 0)
+		{
+			EnchantTrie *trie = enchant_trie_compact (pwl->trie);
+			enchant_trie_free (pwl->trie);
+			pwl->trie = trie;
+		}
+	enchant_trie_freeze (pwl->trie);
+	enchant_trie_freeze (pwl->folded_trie);
+	g_rw_lock_writer_unlock (&pwl->lock);
+}
+
+int enchant_pwl_check(EnchantPWL *pwl, const char *const word, size_t len)
+{
+	enchant_pwl_refresh_from_file(pwl);
+
+	enchant_pwl_lock_for_reading(pwl, FALSE);
+	int result = enchant_pwl_lookup(pwl, word, len, NULL, 0);
+	g_rw_lock_reader_unlock (&pwl->lock);
+	return result;
+}
+
+int enchant_pwl_check_suggestion(EnchantPWL *pwl, const EnchantSuggestion *sugg)
+{
+	enchant_pwl_refresh_from_file(pwl);
+
+	enchant_pwl_lock_for_reading(pwl, FALSE);
+	int result = enchant_pwl_lookup(pwl, sugg->word, sugg->len,
+					sugg->normalized, sugg->normalized_len);
+	g_rw_lock_reader_unlock (&pwl->lock);
+	return result;
+}
+
+/* normalized is the NUL-terminated NFD form of word, if known */
+static int enchant_pwl_lookup(EnchantPWL *pwl, const char *const word, size_t len,
+			      const char *const normalized, size_t normalized_len)
+{
+	int exists;
+	if (normalized)
+		exists = g_hash_table_size (pwl->words_in_trie) != 0 &&
+			enchant_pwl_filter_may_contain (pwl, normalized, normalized_len) &&
+			g_hash_table_contains (pwl->words_in_trie, normalized);
+	else
+		exists = enchant_pwl_contains(pwl, word, len);
+
+	if(exists)
+		return 0;
+
+	EnchantCaseShape shape = enchant_case_shape(word, len);
+	if(shape == ENCHANT_CASE_TITLE || shape == ENCHANT_CASE_ALL_CAPS)
+		{
+			/* only words spelled like this one but for case can match */
+			if (pwl->folded_words && !enchant_pwl_contains_folded(pwl, word, len))
+				return 1;
+
+			char * lower_case_word = g_utf8_strdown(word, len);
+			exists = enchant_pwl_contains(pwl, lower_case_word, strlen(lower_case_word));
+			g_free(lower_case_word);
+			if(exists)
+				return 0;
+
+			if(shape == ENCHANT_CASE_ALL_CAPS)
+			{
+				char * title_case_word = enchant_utf8_strtitle(word, len);
+				exists = enchant_pwl_contains(pwl, title_case_word, strlen(title_case_word));
+				g_free(title_case_word);
+				if(exists)
+					return 0;
+			}
+		}
+
+	return 1; /* not found */
+}
+
+static int enchant_pwl_sugg_compare(gconstpointer a, gconstpointer b)
+{
+	const EnchantSugg *sugg_a = a, *sugg_b = b;
+	if (sugg_a->errs != sugg_b->errs)
+		return sugg_a->errs < sugg_b->errs ? -1 : 1;
+	if (sugg_a->weight != sugg_b->weight)
+		return sugg_a->weight > sugg_b->weight ? -1 : 1;
+	return sugg_a->seq < sugg_b->seq ? -1 : sugg_a->seq > sugg_b->seq;
+}
+
+/* Whether any byte of the eight is zero or has its high bit set */
+#define ENCHANT_UTF8_ONES G_GUINT64_CONSTANT(0x0101010101010101)
+#define ENCHANT_UTF8_HIGHS G_GUINT64_CONSTANT(0x8080808080808080)
+#define ENCHANT_UTF8_NOT_ASCII(chunk) ((((chunk) - ENCHANT_UTF8_ONES) | (chunk)) & ENCHANT_UTF8_HIGHS)
+
+size_t enchant_utf8_ascii_prefix(const char *const str, size_t len)
+{
+	size_t i = 0;
+	for (; i + sizeof (guint64) <= len; i += sizeof (guint64))
+		{
+			guint64 chunk;
+			memcpy (&chunk, str + i, sizeof chunk);
+			if (ENCHANT_UTF8_NOT_ASCII (chunk))
+				break;
+		}
+	while (i < len && str[i] != '\0' && !((guchar) str[i] & 0x80))
+		i++;
+	return i;
+}
+
+int enchant_utf8_validate(const char *const str, ssize_t len, int *is_ascii)
+{
+	size_t n = len < 0 ? strlen (str) : (size_t) len;
+	size_t ascii_len = enchant_utf8_ascii_prefix (str, n);
+
+	if (is_ascii)
+		*is_ascii = ascii_len == n;
+	if (ascii_len == n)
+		return TRUE;
+
+	/* the prefix ends on a character boundary */
+	return g_utf8_validate (str + ascii_len, n - ascii_len, NULL);
+}
+
+void enchant_suggestion_init(EnchantSuggestion *sugg, char *word, size_t len)
+{
+	sugg->word = word;
+	sugg->len = len;
+	sugg->distance = -1;
+
+	/* ASCII is its own normal form */
+	size_t ascii_len = enchant_utf8_ascii_prefix (word, len);
+
+	if (ascii_len < len)
+		{
+			sugg->normalized = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
+			sugg->normalized_len = strlen (sugg->normalized);
+		}
+	else
+		{
+			sugg->normalized = word;
+			sugg->normalized_len = len;
+		}
+}
+
+void enchant_suggestion_clear(EnchantSuggestion *sugg)
+{
+	if (sugg->normalized != sugg->word)
+		g_free (sugg->normalized);
+	g_free (sugg->word);
+	sugg->word = sugg->normalized = NULL;
+}
+
+/* the spellings of the suggestions, best first, in the case of word */
+static EnchantSuggestion* enchant_pwl_case_and_denormalize_suggestions(EnchantPWL *pwl,
+								 const EnchantSuggestion *word,
+								 EnchantSuggList* suggs_list)
+{
+	gchar* (*utf8_case_convert_function)(const gchar*str, gssize len) = NULL;
+	switch (enchant_case_shape(word->word, word->len))
+		{
+		case ENCHANT_CASE_TITLE:
+			utf8_case_convert_function = enchant_utf8_strtitle;
+			break;
+		case ENCHANT_CASE_ALL_CAPS:
+			utf8_case_convert_function = g_utf8_strup;
+			break;
+		default:
+			break;
+		}
+
+	qsort (suggs_list->suggs, suggs_list->n_suggs, sizeof (EnchantSugg), enchant_pwl_sugg_compare);
+
+	EnchantSuggestion *suggs = g_new (EnchantSuggestion, MAX (suggs_list->n_suggs, 1));
+	GHashTable *cased = g_hash_table_new (g_str_hash, g_str_equal);
+	size_t n_suggs = 0;
+	for (size_t i = 0; i < suggs_list->n_suggs; ++i)
+		{
+			const char *key = suggs_list->suggs[i].word;
+			gchar* suggestion = g_hash_table_lookup (pwl->words_in_trie, key);
+			size_t suggestion_len = strlen(suggestion);
+
+			gchar* cased_suggestion;
+			gboolean recased = utf8_case_convert_function &&
+				enchant_case_shape(suggestion, suggestion_len) != ENCHANT_CASE_ALL_CAPS;
+			if (recased)
+				cased_suggestion = utf8_case_convert_function(suggestion, suggestion_len);
+			else
+				cased_suggestion = g_strndup(suggestion, suggestion_len);
+
+			/* words differing only in case may now be spelled alike */
+			if (g_hash_table_contains (cased, cased_suggestion))
+				{
+					g_free(cased_suggestion);
+					continue;
+				}
+			g_hash_table_add (cased, cased_suggestion);
+
+			EnchantSuggestion *sugg = &suggs[n_suggs++];
+			if (recased)
+				enchant_suggestion_init (sugg, cased_suggestion, strlen (cased_suggestion));
+			else
+				{
+					/* the word's normal form is its key */
+					sugg->word = cased_suggestion;
+					sugg->len = suggestion_len;
+					sugg->normalized_len = strlen (key);
+					sugg->normalized = strcmp (key, cased_suggestion) == 0 ?
+						cased_suggestion : g_strndup (key, sugg->normalized_len);
+				}
+			sugg->distance = suggs_list->suggs[i].errs;
+		}
+	g_hash_table_destroy (cased);
+	suggs_list->n_suggs = n_suggs;
+	return suggs;
+}
+
+/* fills in the distances of the suggestions, up to the best one */
+static int best_distance(EnchantSuggestion* suggs, size_t n_suggs, const EnchantSuggestion *word)
+{
+	int best_dist = g_utf8_strlen(word->normalized, word->normalized_len);
+
+	for (size_t i = 0; i < n_suggs && best_dist > 0; i++)
+		{
+			int dist = edit_dist(word->normalized, suggs[i].normalized, best_dist);
+			if (dist <= best_dist)
+				suggs[i].distance = dist;
+			best_dist = MIN (dist, best_dist);
+		}
+
+	return best_dist;
+}
+
+/* A search of the folded trie spread over threads, each taking the
+ * subtries below the root's edges one at a time, in the order a single
+ * matcher would search them, with a matcher of its own, and gathering
+ * what it finds under each apart */
+typedef struct str_enchant_pwl_parallel_suggest
+{
+	EnchantTrie *trie;
+	const EnchantSuggestion *word;
+	int max_dist;
+	const EnchantPWLStop *stop;
+	guint32 *order;		/* of the root's edges */
+	EnchantSuggList *lists;	/* one per edge, in that order */
+	gint next_edge;		/* the first one no thread has taken */
+	gint bound;		/* the fewest errors found so far */
+	gsize n_visits;		/* by all the threads */
+} EnchantPWLParallelSuggest;
+
+static gpointer enchant_pwl_suggest_subtries(gpointer data)
+{
+	EnchantPWLParallelSuggest *search = (EnchantPWLParallelSuggest *) data;
+	const EnchantTrieNode *root = &search->trie->nodes[0];
+
+	EnchantTrieMatcher *matcher = enchant_trie_matcher_init(search->word->normalized,
+								search->word->normalized_len,
+								search->max_dist,
+								case_insensitive,
+								enchant_pwl_suggest_cb,
+								NULL);
+	matcher->stop = search->stop;
+	matcher->bound = &search->bound;
+	GHashTable *listed = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	guint edge;
+	while ((edge = (guint) g_atomic_int_add (&search->next_edge, 1)) < root->n_edges)
+		{
+			EnchantSuggList *sugg_list = &search->lists[edge];
+			sugg_list->listed = listed;
+			matcher->cbdata = sugg_list;
+			matcher->settled_errors = G_MAXINT;
+			enchant_trie_find_matches_through (search->trie, &search->trie->edges[root->edges + search->order[edge]],
+							   0, matcher);
+		}
+
+	g_hash_table_destroy (listed);
+	g_atomic_pointer_add (&search->n_visits, (gssize) matcher->n_visits);
+	enchant_trie_matcher_free (matcher);
+	return NULL;
+}
+
+/* enchant_trie_find_matches with enchant_pwl_suggest_cb, on several threads;
+ * finds the same suggestions in the same order */
+static void enchant_pwl_suggest_parallel(EnchantPWL *pwl, const EnchantSuggestion *word, int max_dist,
+					 const EnchantPWLStop *stop, EnchantSuggList *sugg_list)
+{
+	EnchantPWLParallelSuggest search;
+	search.trie = pwl->folded_trie;
+	search.word = word;
+	search.max_dist = max_dist;
+	search.stop = stop;
+	search.next_edge = 0;
+	search.bound = max_dist;
+	search.n_visits = 0;
+
+	guint n_edges = search.trie->nodes[0].n_edges;
+	search.order = g_new (guint32, n_edges);
+	for (guint i = 0; i < n_edges; i++)
+		search.order[i] = i;
+	enchant_trie_order_edges (search.trie, 0, search.order, n_edges);
+	search.lists = g_new0 (EnchantSuggList, n_edges);
+	for (guint i = 0; i < n_edges; i++)
+		{
+			search.lists[i].suggs = g_new (EnchantSugg, MAX (sugg_list->max_suggs, 1));
+			search.lists[i].max_suggs = sugg_list->max_suggs;
+			search.lists[i].folded_words = sugg_list->folded_words;
+			search.lists[i].frequencies = sugg_list->frequencies;
+		}
+
+	guint n_threads = MIN (MIN ((guint) g_get_num_processors (), ENCHANT_PWL_PARALLEL_MAX_THREADS), n_edges);
+	gpointer *items = g_newa (gpointer, n_threads);
+	for (guint i = 0; i < n_threads; i++)
+		items[i] = &search;
+	enchant_pwl_run_parallel (enchant_pwl_suggest_subtries, items, n_threads);
+
+	/* in the order a single matcher would have found them */
+	for (guint i = 0; i < n_edges; i++)
+		{
+			EnchantSuggList *found = &search.lists[i];
+			qsort (found->suggs, found->n_suggs, sizeof (EnchantSugg), enchant_pwl_sugg_compare);
+			for (size_t j = 0; j < found->n_suggs; j++)
+				enchant_pwl_suggest_add (sugg_list, found->suggs[j].word, found->suggs[j].errs,
+							 found->suggs[j].weight);
+			g_free (found->suggs);
+		}
+	g_free (search.lists);
+	g_free (search.order);
+	g_atomic_pointer_add (&pwl->n_nodes_visited, (gssize) search.n_visits);
+}
+
+/* gives the best set of at most max_suggs suggestions from pwl that are at
+ * least as good as the given suggs (if suggs == NULL just best from pwl) */
+EnchantSuggestion* enchant_pwl_suggest(EnchantPWL *pwl, const EnchantSuggestion *word,
+				       EnchantSuggestion *suggs, size_t n_suggs,
+				       size_t max_suggs, int max_errors,
+				       const EnchantPWLStop *stop, size_t* out_n_suggs)
+{
+	if (max_errors < 0)
+		max_errors = ENCHANT_PWL_MAX_ERRORS;
+	int max_dist = suggs ? best_distance(suggs, n_suggs, word) : max_errors;
+	max_dist = MIN (max_dist, max_errors);
+
+	enchant_pwl_refresh_from_file(pwl);
+
+	enchant_pwl_lock_for_reading(pwl, TRUE);
+
+	EnchantSuggList sugg_list;
+	sugg_list.suggs = g_new(EnchantSugg, MAX (max_suggs, 1));
+	sugg_list.n_suggs = 0;
+	sugg_list.max_suggs = max_suggs;
+	sugg_list.n_found = 0;
+	sugg_list.listed = g_hash_table_new (g_direct_hash, g_direct_equal);
+	sugg_list.folded_words = pwl->folded_words;
+	sugg_list.frequencies = pwl->frequencies;
+
+	if (pwl->deletions)
+		/* the index holds no more deletions than that */
+		enchant_pwl_deletions_suggest(pwl, word, MIN (max_dist, ENCHANT_PWL_MAX_ERRORS), stop, &sugg_list);
+	else if (pwl->suggest_engine == ENCHANT_PWL_SUGGEST_PARALLEL &&
+		 g_hash_table_size (pwl->folded_words) >= ENCHANT_PWL_PARALLEL_SUGGEST_MIN_WORDS &&
+		 pwl->folded_trie->nodes[0].value == ENCHANT_TRIE_NO_VALUE)
+		enchant_pwl_suggest_parallel(pwl, word, max_dist, stop, &sugg_list);
+	else
+		{
+			EnchantTrieMatcher *matcher = enchant_trie_matcher_init(word->normalized,
+										word->normalized_len,
+										max_dist,
+										case_insensitive,
+										enchant_pwl_suggest_cb,
+										&sugg_list);
+			matcher->stop = stop;
+			enchant_trie_find_matches(pwl->folded_trie,matcher);
+			g_atomic_pointer_add (&pwl->n_nodes_visited, (gssize) matcher->n_visits);
+			enchant_trie_matcher_free(matcher);
+		}
+
+	g_hash_table_destroy(sugg_list.listed);
+
+	EnchantSuggestion *result = enchant_pwl_case_and_denormalize_suggestions(pwl, word, &sugg_list);
+	g_rw_lock_reader_unlock (&pwl->lock);
+	g_free(sugg_list.suggs);
+	(*out_n_suggs) = sugg_list.n_suggs;
+	
+	return result;
+}
+
+/* what enchant_pwl_complete has found so far */
+typedef struct str_enchant_pwl_completion
+{
+	EnchantPWL *pwl;
+	gboolean fold;
+	const EnchantPWLAccept *accept;
+	GPtrArray *words;	/* original spellings, NULL-terminated once done */
+	size_t max_words;	/* 0 for no limit */
+} EnchantPWLCompletion;
+
+/* takes the word if the caller wants it; returns FALSE once there are enough */
+static gboolean enchant_pwl_completion_add(EnchantPWLCompletion *completion, const char *const key)
+{
+	const char *word = g_hash_table_lookup (completion->pwl->words_in_trie, key);
+	if (word == NULL)
+		return TRUE;
+	if (completion->accept && !(*completion->accept->accepted) (word, completion->accept->data))
+		return TRUE;
+
+	g_ptr_array_add (completion->words, g_strdup (word));
+	return completion->max_words == 0 || completion->words->len < completion->max_words;
+}
+
+static int enchant_pwl_completion_compare(gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char *const *) a, *(const char *const *) b);
+}
+
+/* a spelling found in the trie searched; for the folded trie, that is
+ * each of the words spelled like it but for case, in order */
+static gboolean enchant_pwl_completion_found(EnchantPWLCompletion *completion, const char *const spelling)
+{
+	if (!completion->fold)
+		return enchant_pwl_completion_add (completion, spelling);
+
+	GSList *keys = g_hash_table_lookup (completion->pwl->folded_words, spelling);
+	guint n_keys = g_slist_length (keys);
+	const char **sorted = g_newa (const char *, MAX (n_keys, 1));
+	guint i = 0;
+	for (GSList *link = keys; link; link = link->next)
+		sorted[i++] = link->data;
+	qsort (sorted, n_keys, sizeof (const char *), enchant_pwl_completion_compare);
+
+	for (i = 0; i < n_keys; i++)
+		if (!enchant_pwl_completion_add (completion, sorted[i]))
+			return FALSE;
+	return TRUE;
+}
+
+/* reports the strings below node in codepoint order, path holding what
+ * leads to it; returns FALSE once the completion has enough of them */
+static gboolean enchant_trie_complete_at(EnchantTrie* trie, guint32 node, GString *path,
+					 EnchantPWLCompletion *completion)
+{
+	if (node == ENCHANT_TRIE_EOS)
+		return enchant_pwl_completion_found (completion, path->str);
+
+	const EnchantTrieNode* n = &trie->nodes[node];
+	gsize path_len = path->len;
+	if (n->value != ENCHANT_TRIE_NO_VALUE) {
+		g_string_append (path, trie->strings + n->value);
+		gboolean more = enchant_pwl_completion_found (completion, path->str);
+		g_string_truncate (path, path_len);
+		return more;
+	}
+
+	/* the end-of-string edge sorts first, so shorter words come first */
+	for (guint32 i = 0; i < n->n_edges; i++) {
+		const EnchantTrieEdge* edge = &trie->edges[n->edges + i];
+		if (edge->ch != 0)
+			g_string_append_unichar (path, edge->ch);
+		gboolean more = enchant_trie_complete_at (trie, edge->node, path, completion);
+		g_string_truncate (path, path_len);
+		if (!more)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* walks down to where the strings starting with prefix are, leaving
+ * what leads there in path; ENCHANT_TRIE_NO_NODE if there are none */
+static guint32 enchant_trie_find_prefix(EnchantTrie* trie, const char *const prefix, GString *path)
+{
+	if (trie == NULL)
+		return ENCHANT_TRIE_NO_NODE;
+
+	guint32 node = 0;
+	const char *rest = prefix;
+	for (;;) {
+		const EnchantTrieNode* n = &trie->nodes[node];
+		if (n->value != ENCHANT_TRIE_NO_VALUE)
+			return g_str_has_prefix (trie->strings + n->value, rest) ? node : ENCHANT_TRIE_NO_NODE;
+		if (rest[0] == '\0')
+			return node;
+
+		guint32 pos;
+		gunichar ch = g_utf8_get_char (rest);
+		if (!enchant_trie_find_edge (trie, node, ch, &pos))
+			return ENCHANT_TRIE_NO_NODE;
+		g_string_append_unichar (path, ch);
+		node = trie->edges[n->edges + pos].node;
+		rest = g_utf8_next_char (rest);
+	}
 }
 
-int enchant_pwl_check(EnchantPWL *pwl, const char *const word, size_t len)
+char **enchant_pwl_complete(EnchantPWL *pwl, const char *const prefix, size_t len, int fold,
+			    size_t max_words, const EnchantPWLAccept *accept, size_t *out_n_words)
 {
+	char buf[ENCHANT_PWL_NORMALIZE_BUF_SIZE], *to_free;
+	const char *normalized = enchant_pwl_normalize (prefix, len, buf, &to_free);
+	char *folded = fold ? g_utf8_strdown (normalized, -1) : NULL;
+
 	enchant_pwl_refresh_from_file(pwl);
 
-	int exists = enchant_pwl_contains(pwl, word, len);
-	
-	if(exists)
-		return 0;
+	enchant_pwl_lock_for_reading(pwl, fold);
 
-	int isAllCaps = 0;
-	if(enchant_is_title_case(word, len) || (isAllCaps = enchant_is_all_caps(word, len)))
-		{
-			char * lower_case_word = g_utf8_strdown(word, len);
-			exists = enchant_pwl_contains(pwl, lower_case_word, strlen(lower_case_word));
-			g_free(lower_case_word);
-			if(exists)
-				return 0;
+	EnchantPWLCompletion completion;
+	completion.pwl = pwl;
+	completion.fold = fold;
+	completion.accept = accept;
+	completion.words = g_ptr_array_new ();
+	completion.max_words = max_words;
 
-			if(isAllCaps)
-			{
-				char * title_case_word = enchant_utf8_strtitle(word, len);
-				exists = enchant_pwl_contains(pwl, title_case_word, strlen(title_case_word));
-				g_free(title_case_word);
-				if(exists)
-					return 0;
-			}
-		}
+	EnchantTrie *trie = fold ? pwl->folded_trie : pwl->trie;
+	GString *path = g_string_new (NULL);
+	guint32 node = enchant_trie_find_prefix (trie, fold ? folded : normalized, path);
+	if (node != ENCHANT_TRIE_NO_NODE)
+		enchant_trie_complete_at (trie, node, path, &completion);
+	g_string_free (path, TRUE);
 
-	return 1; /* not found */
+	g_rw_lock_reader_unlock (&pwl->lock);
+
+	g_free (folded);
+	g_free (to_free);
+
+	*out_n_words = completion.words->len;
+	g_ptr_array_add (completion.words, NULL);
+	return (char **) g_ptr_array_free (completion.words, FALSE);
 }
 
 /* matcher callback when a match is found*/
-static void enchant_pwl_check_cb(char* match,EnchantTrieMatcher* matcher)
+static void enchant_pwl_suggest_cb(const char* match,EnchantTrieMatcher* matcher)
 {
-	g_free(match);
-	(*((int*)(matcher->cbdata)))++;
+	EnchantSuggList *sugg_list = (EnchantSuggList*)(matcher->cbdata);
+
+	/* only get best errors so adapt */
+	if(matcher->num_errors < matcher->max_errors)
+		matcher->max_errors = matcher->num_errors;
+
+	/* the match is a lowercase spelling, suggest the words spelled so */
+	guint32 weight = sugg_list->frequencies ?
+		GPOINTER_TO_UINT (g_hash_table_lookup (sugg_list->frequencies, match)) : 0;
+	for (GSList *words = g_hash_table_lookup (sugg_list->folded_words, match); words; words = words->next)
+		enchant_pwl_suggest_add(sugg_list, words->data, matcher->num_errors, weight);
+
+	/* a full list takes only what beats the worst of it */
+	if (sugg_list->max_suggs != 0 && sugg_list->n_suggs == sugg_list->max_suggs) {
+		matcher->settled_errors = sugg_list->suggs[0].errs;
+		matcher->settled_weight = sugg_list->suggs[0].weight;
+	}
 }
 
-static void enchant_pwl_case_and_denormalize_suggestions(EnchantPWL *pwl, 
-							 const char *const word, size_t len, 
-							 EnchantSuggList* suggs_list)
+/* move the suggestion at pos down the heap to its place */
+static void enchant_pwl_sugg_sift_down(EnchantSuggList* sugg_list, size_t pos)
 {
-	gchar* (*utf8_case_convert_function)(const gchar*str, gssize len) = NULL;
-	if(enchant_is_title_case(word, len))
-		utf8_case_convert_function = enchant_utf8_strtitle;
-	else if (enchant_is_all_caps(word, len))
-		utf8_case_convert_function = g_utf8_strup;
-	
-	for (size_t i = 0; i < suggs_list->n_suggs; ++i)
+	EnchantSugg *heap = sugg_list->suggs;
+	for (;;)
 		{
-			gchar* suggestion = g_hash_table_lookup (pwl->words_in_trie, suggs_list->suggs[i]);
-			size_t suggestion_len = strlen(suggestion);
+			size_t worst = pos, child = 2 * pos + 1;
+			for (size_t i = child; i < child + 2 && i < sugg_list->n_suggs; i++)
+				if (enchant_pwl_sugg_compare (&heap[i], &heap[worst]) > 0)
+					worst = i;
+			if (worst == pos)
+				return;
 
-			gchar* cased_suggestion;
-			if (utf8_case_convert_function && !enchant_is_all_caps(suggestion, suggestion_len))
-				cased_suggestion = utf8_case_convert_function(suggestion, suggestion_len);
-			else
-				cased_suggestion = g_strndup(suggestion, suggestion_len);
-			
-			g_free(suggs_list->suggs[i]);
-			suggs_list->suggs[i] = cased_suggestion;
+			EnchantSugg tmp = heap[pos];
+			heap[pos] = heap[worst];
+			heap[worst] = tmp;
+			pos = worst;
 		}
 }
 
-static int best_distance(char** suggs, const char *const word, size_t len)
+static void enchant_pwl_suggest_add(EnchantSuggList* sugg_list, const char* match, int num_errors, guint32 weight)
 {
-	char *normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
-	int best_dist = g_utf8_strlen(normalized_word, -1);
+	EnchantSugg *heap = sugg_list->suggs;
 
-	for (char **sugg_it = suggs; *sugg_it; ++sugg_it)
+	/* Remove all elements with worse score */
+	while (sugg_list->n_suggs > 0 && heap[0].errs > num_errors)
 		{
-			char* normalized_sugg = g_utf8_normalize (*sugg_it, -1, G_NORMALIZE_NFD);
-			int dist = edit_dist(normalized_word, normalized_sugg);
-			g_free(normalized_sugg);
-			best_dist = MIN (dist, best_dist);
+			g_hash_table_remove (sugg_list->listed, heap[0].word);
+			heap[0] = heap[--sugg_list->n_suggs];
+			enchant_pwl_sugg_sift_down (sugg_list, 0);
 		}
 
-	g_free(normalized_word);
-	return best_dist;
+	/* If it's already listed or not going to fit, just throw it away */
+	if (sugg_list->n_suggs >= sugg_list->max_suggs ||
+	    !g_hash_table_add (sugg_list->listed, (char *) match))
+		return;
+
+	size_t pos = sugg_list->n_suggs++;
+	EnchantSugg sugg = { match, num_errors, weight, sugg_list->n_found++ };
+	while (pos > 0 && enchant_pwl_sugg_compare (&sugg, &heap[(pos - 1) / 2]) > 0)
+		{
+			heap[pos] = heap[(pos - 1) / 2];
+			pos = (pos - 1) / 2;
+		}
+	heap[pos] = sugg;
 }
 
-/* gives the best set of suggestions from pwl that are at least as good as the 
- * given suggs (if suggs == NULL just best from pwl) */
-char** enchant_pwl_suggest(EnchantPWL *pwl, const char *const word,
-			   size_t len, char** suggs, size_t* out_n_suggs)
+/* size bytes of memory mapped apart from the heap, to be made
+ * read-only by enchant_sealed_seal, or NULL if there is none */
+static gpointer enchant_sealed_new(gsize size)
 {
-	int max_dist = suggs ? best_distance(suggs, word, len) : ENCHANT_PWL_MAX_ERRORS;
-	max_dist = MIN (max_dist, ENCHANT_PWL_MAX_ERRORS);
+#if defined(ENCHANT_PWL_HAVE_MMAN)
+	gpointer block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return block == MAP_FAILED ? NULL : block;
+#else
+	(void) size;
+	return NULL;
+#endif
+}
 
-	enchant_pwl_refresh_from_file(pwl);
+static void enchant_sealed_seal(gpointer block, gsize size)
+{
+#if defined(ENCHANT_PWL_HAVE_MMAN)
+	mprotect(block, size, PROT_READ);
+#else
+	(void) block;
+	(void) size;
+#endif
+}
 
-	EnchantSuggList sugg_list;
-	sugg_list.suggs = g_new0(char*,ENCHANT_PWL_MAX_SUGGS+1);
-	sugg_list.sugg_errs = g_new0(int,ENCHANT_PWL_MAX_SUGGS);
-	sugg_list.n_suggs = 0;
+static void enchant_sealed_free(gpointer block, gsize size)
+{
+#if defined(ENCHANT_PWL_HAVE_MMAN)
+	munmap(block, size);
+#else
+	(void) block;
+	(void) size;
+#endif
+}
 
-	EnchantTrieMatcher *matcher = enchant_trie_matcher_init(word, len, max_dist,
-								case_insensitive,
-								enchant_pwl_suggest_cb,
-								&sugg_list);
-	enchant_trie_find_matches(pwl->trie,matcher);
-	enchant_trie_matcher_free(matcher);
+static EnchantTrie* enchant_trie_new(void)
+{
+	EnchantTrie* trie = g_new0(EnchantTrie, 1);
+	trie->nodes_cap = 16;
+	trie->nodes = g_new(EnchantTrieNode, trie->nodes_cap);
+	trie->edges_cap = 16;
+	trie->edges = g_new(EnchantTrieEdge, trie->edges_cap);
+	trie->strings_cap = 256;
+	trie->strings = g_new(char, trie->strings_cap);
+	return trie;
+}
 
-	g_free(sugg_list.sugg_errs);
-	sugg_list.suggs[sugg_list.n_suggs] = NULL;
-	(*out_n_suggs) = sugg_list.n_suggs;
+/* a read-only trie whose arrays live in a compiled index */
+static EnchantTrie* enchant_trie_new_mapped(GMappedFile* mapped, const EnchantPWLIndexHeader* header)
+{
+	EnchantTrie* trie = g_new0(EnchantTrie, 1);
+	trie->nodes = (EnchantTrieNode*) (header + 1);
+	trie->n_nodes = trie->nodes_cap = header->n_nodes;
+	trie->edges = (EnchantTrieEdge*) (trie->nodes + header->n_nodes);
+	trie->n_edges = trie->edges_cap = header->n_edges;
+	trie->strings = (char*) (trie->edges + header->n_edges);
+	trie->n_strings = trie->strings_cap = header->n_strings;
+	trie->mapped = g_mapped_file_ref(mapped);
+	return trie;
+}
 
-	enchant_pwl_case_and_denormalize_suggestions(pwl, word, len, &sugg_list);
-	
-	return sugg_list.suggs;
+/* copy the arrays of a mapped or frozen trie to the heap before modifying it */
+static void enchant_trie_ensure_writable(EnchantTrie* trie)
+{
+	if(trie == NULL || (trie->mapped == NULL && trie->sealed == NULL))
+		return;
+
+	trie->nodes_cap = MAX(trie->n_nodes, 16);
+	EnchantTrieNode* nodes = g_new(EnchantTrieNode, trie->nodes_cap);
+	memcpy(nodes, trie->nodes, trie->n_nodes * sizeof(EnchantTrieNode));
+	trie->nodes = nodes;
+
+	trie->edges_cap = MAX(trie->n_edges, 16);
+	EnchantTrieEdge* edges = g_new(EnchantTrieEdge, trie->edges_cap);
+	memcpy(edges, trie->edges, trie->n_edges * sizeof(EnchantTrieEdge));
+	trie->edges = edges;
+
+	trie->strings_cap = MAX(trie->n_strings, 256);
+	char* strings = g_new(char, trie->strings_cap);
+	memcpy(strings, trie->strings, trie->n_strings);
+	trie->strings = strings;
+
+	if(trie->mapped) {
+		g_mapped_file_unref(trie->mapped);
+		trie->mapped = NULL;
+	} else {
+		enchant_sealed_free(trie->sealed, trie->sealed_size);
+		trie->sealed = NULL;
+	}
 }
 
-/* matcher callback when a match is found*/
-static void enchant_pwl_suggest_cb(char* match,EnchantTrieMatcher* matcher)
+/* move the arrays of trie into a read-only block of their own, just big
+ * enough for them, so that the pages stay shared with the processes
+ * forked from this one; left as they are if there is no such memory */
+static void enchant_trie_freeze(EnchantTrie* trie)
 {
-	EnchantSuggList *sugg_list = (EnchantSuggList*)(matcher->cbdata);
+	if(trie == NULL || trie->mapped || trie->sealed)
+		return;
 
-	/* only get best errors so adapt */
-	if(matcher->num_errors < matcher->max_errors)
-		matcher->max_errors = matcher->num_errors;
+	gsize nodes_size = trie->n_nodes * sizeof(EnchantTrieNode);
+	gsize edges_size = trie->n_edges * sizeof(EnchantTrieEdge);
+	gsize size = nodes_size + edges_size + trie->n_strings;
+	char* block = enchant_sealed_new(size);
+	if(block == NULL)
+		return;
 
-	/* Find appropriate location in the array, if any */
-	/* In future, this could be done using binary search...  */
-	size_t loc;
-	for(loc=0; loc < sugg_list->n_suggs; loc++) {
-		/* Better than an existing suggestion, so stop */
-		if(sugg_list->sugg_errs[loc] > matcher->num_errors) {
-			break;
+	memcpy(block, trie->nodes, nodes_size);
+	memcpy(block + nodes_size, trie->edges, edges_size);
+	memcpy(block + nodes_size + edges_size, trie->strings, trie->n_strings);
+	g_free(trie->nodes);
+	g_free(trie->edges);
+	g_free(trie->strings);
+
+	trie->nodes = (EnchantTrieNode*) block;
+	trie->nodes_cap = trie->n_nodes;
+	trie->edges = (EnchantTrieEdge*) (block + nodes_size);
+	trie->edges_cap = trie->n_edges;
+	trie->strings = block + nodes_size + edges_size;
+	trie->strings_cap = trie->n_strings;
+	trie->sealed = block;
+	trie->sealed_size = size;
+	enchant_sealed_seal(block, size);
+}
+
+static void enchant_trie_free(EnchantTrie* trie)
+{
+	if(trie == NULL)
+		return;
+
+	if(trie->mapped) {
+		g_mapped_file_unref(trie->mapped);
+	} else if(trie->sealed) {
+		enchant_sealed_free(trie->sealed, trie->sealed_size);
+	} else {
+		g_free(trie->nodes);
+		g_free(trie->edges);
+		g_free(trie->strings);
+	}
+	g_free(trie->weights);
+	g_free(trie);
+}
+
+static guint32 enchant_trie_new_node(EnchantTrie* trie)
+{
+	if (trie->n_nodes == trie->nodes_cap) {
+		trie->nodes_cap *= 2;
+		trie->nodes = g_renew(EnchantTrieNode, trie->nodes, trie->nodes_cap);
+	}
+
+	EnchantTrieNode* node = &trie->nodes[trie->n_nodes];
+	node->edges = 0;
+	node->n_edges = 0;
+	node->edges_cap = 0;
+	node->value = ENCHANT_TRIE_NO_VALUE;
+	return trie->n_nodes++;
+}
+
+static guint32 enchant_trie_new_string(EnchantTrie* trie, const char *const str)
+{
+	guint32 len = strlen(str) + 1;
+	if (trie->n_strings + len > trie->strings_cap) {
+		while (trie->n_strings + len > trie->strings_cap)
+			trie->strings_cap *= 2;
+		trie->strings = g_renew(char, trie->strings, trie->strings_cap);
+	}
+
+	memcpy(trie->strings + trie->n_strings, str, len);
+	guint32 offset = trie->n_strings;
+	trie->n_strings += len;
+	return offset;
+}
+
+static gboolean enchant_trie_is_empty(EnchantTrie* trie)
+{
+	return trie != NULL && trie->nodes[0].value == ENCHANT_TRIE_NO_VALUE
+		&& trie->nodes[0].n_edges == 0;
+}
+
+/* binary search for the edge labelled ch, returns whether it was found
+ * and stores its position (or the insertion point) in pos */
+static gboolean enchant_trie_find_edge(EnchantTrie* trie, guint32 node, gunichar ch, guint32 *pos)
+{
+	const EnchantTrieEdge* edges = trie->edges + trie->nodes[node].edges;
+	guint32 lo = 0, hi = trie->nodes[node].n_edges;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (edges[mid].ch < ch)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*pos = lo;
+	return lo < trie->nodes[node].n_edges && edges[lo].ch == ch;
+}
+
+static void enchant_trie_add_edge(EnchantTrie* trie, guint32 node, guint32 pos, gunichar ch, guint32 child)
+{
+	EnchantTrieNode* n = &trie->nodes[node];
+	if (n->n_edges == n->edges_cap) {
+		guint32 cap = n->edges_cap ? n->edges_cap * 2 : 2;
+		gboolean last = n->edges_cap != 0 && n->edges + n->edges_cap == trie->n_edges;
+		guint32 start = last ? n->edges : trie->n_edges;
+		if (start + cap > trie->edges_cap) {
+			while (start + cap > trie->edges_cap)
+				trie->edges_cap *= 2;
+			trie->edges = g_renew(EnchantTrieEdge, trie->edges, trie->edges_cap);
 		}
-		/* Already in the list with better score, just return */
-		if(strcmp(match,sugg_list->suggs[loc])==0) {
-			g_free(match);
-			return;
+		if (!last) {
+			/* move to a fresh block at the end of the pool; the old
+			 * block is wasted until the trie is rebuilt */
+			memcpy(trie->edges + start, trie->edges + n->edges, n->n_edges * sizeof(EnchantTrieEdge));
+			n->edges = start;
 		}
-	}
-	/* If it's not going to fit, just throw it away */
-	if(loc >= ENCHANT_PWL_MAX_SUGGS) {
-		g_free(match);
-		return;
+		n->edges_cap = cap;
+		trie->n_edges = start + cap;
 	}
 
-	int changes = 1;  /* num words added to list */
-	
-	/* Remove all elements with worse score */
-	for(size_t i=loc; i < sugg_list->n_suggs; i++){
-		g_free(sugg_list->suggs[i]);
-		changes--;
+	EnchantTrieEdge* edges = trie->edges + n->edges;
+	memmove(edges + pos + 1, edges + pos, (n->n_edges - pos) * sizeof(EnchantTrieEdge));
+	edges[pos].ch = ch;
+	edges[pos].node = child;
+	n->n_edges++;
+}
+
+static void enchant_trie_remove_edge(EnchantTrie* trie, guint32 node, guint32 pos)
+{
+	EnchantTrieNode* n = &trie->nodes[node];
+	EnchantTrieEdge* edges = trie->edges + n->edges;
+	memmove(edges + pos, edges + pos + 1, (n->n_edges - pos - 1) * sizeof(EnchantTrieEdge));
+	n->n_edges--;
+}
+
+/* add str below a node which stores its strings in subtries; returns the
+ * existing subtrie the remainder of str still has to go into, if any */
+static guint32 enchant_trie_insert_child(EnchantTrie* trie, guint32 node, const char *const str)
+{
+	guint32 pos;
+	if (str[0] == '\0') {
+		/* Mark end-of-string with special node */
+		if (!enchant_trie_find_edge(trie, node, 0, &pos))
+			enchant_trie_add_edge(trie, node, pos, 0, ENCHANT_TRIE_EOS);
+		return ENCHANT_TRIE_NO_NODE;
 	}
 
-	sugg_list->suggs[loc] = match;
-	sugg_list->sugg_errs[loc] = matcher->num_errors;
-	sugg_list->n_suggs = sugg_list->n_suggs + changes;
+	gunichar ch = g_utf8_get_char(str);
+	if (enchant_trie_find_edge(trie, node, ch, &pos))
+		return trie->edges[trie->nodes[node].edges + pos].node;
+
+	guint32 child = enchant_trie_new_node(trie);
+	guint32 value = enchant_trie_new_string(trie, g_utf8_next_char(str));
+	trie->nodes[child].value = value;
+	enchant_trie_add_edge(trie, node, pos, ch, child);
+	return ENCHANT_TRIE_NO_NODE;
 }
 
-static void enchant_trie_free(EnchantTrie* trie)
+/* copy node of src and everything below it into dst, giving every node an
+ * exactly sized edge block */
+static guint32 enchant_trie_copy_node(EnchantTrie* dst, const EnchantTrie* src, guint32 node)
 {
-	/* Don't try to free NULL or the EOSTrie pointer */
-	if(trie == NULL || trie == EOSTrie) {
-		return;
+	const EnchantTrieNode* n = &src->nodes[node];
+	guint32 copy = enchant_trie_new_node(dst);
+	if (n->value != ENCHANT_TRIE_NO_VALUE) {
+		guint32 value = enchant_trie_new_string(dst, src->strings + n->value);
+		dst->nodes[copy].value = value;
+	}
+
+	if (n->n_edges != 0) {
+		guint32 start = dst->n_edges;
+		if (start + n->n_edges > dst->edges_cap) {
+			while (start + n->n_edges > dst->edges_cap)
+				dst->edges_cap *= 2;
+			dst->edges = g_renew(EnchantTrieEdge, dst->edges, dst->edges_cap);
+		}
+		dst->n_edges = start + n->n_edges;
+		dst->nodes[copy].edges = start;
+		dst->nodes[copy].n_edges = dst->nodes[copy].edges_cap = n->n_edges;
+
+		for (guint32 i = 0; i < n->n_edges; i++) {
+			const EnchantTrieEdge* edge = &src->edges[n->edges + i];
+			guint32 child = edge->node == ENCHANT_TRIE_EOS ? ENCHANT_TRIE_EOS
+				: enchant_trie_copy_node(dst, src, edge->node);
+			dst->edges[start + i].ch = edge->ch;
+			dst->edges[start + i].node = child;
+		}
 	}
+	return copy;
+}
+
+static EnchantTrie* enchant_trie_compact(const EnchantTrie* trie)
+{
+	if (trie == NULL)
+		return NULL;
 
-	/* Because we have not set a destroy function for the hashtable
-	 * (to make code cleaner below), we need to explicitly free all
-	 * subtries with a callback function.
-	 */
-	if (trie->subtries != NULL) {
-		g_hash_table_foreach(trie->subtries,enchant_trie_free_cb,NULL);
-		g_hash_table_destroy(trie->subtries);
+	EnchantTrie* copy = enchant_trie_new();
+	enchant_trie_copy_node(copy, trie, 0);
+	return copy;
+}
+
+/* make room for n_nodes, n_edges and n_strings more in the pools */
+static void enchant_trie_reserve(EnchantTrie* trie, guint32 n_nodes, guint32 n_edges, guint32 n_strings)
+{
+	if (trie->n_nodes + n_nodes > trie->nodes_cap) {
+		while (trie->n_nodes + n_nodes > trie->nodes_cap)
+			trie->nodes_cap *= 2;
+		trie->nodes = g_renew(EnchantTrieNode, trie->nodes, trie->nodes_cap);
+	}
+	if (trie->n_edges + n_edges > trie->edges_cap) {
+		while (trie->n_edges + n_edges > trie->edges_cap)
+			trie->edges_cap *= 2;
+		trie->edges = g_renew(EnchantTrieEdge, trie->edges, trie->edges_cap);
 	}
+	if (trie->n_strings + n_strings > trie->strings_cap) {
+		while (trie->n_strings + n_strings > trie->strings_cap)
+			trie->strings_cap *= 2;
+		trie->strings = g_renew(char, trie->strings, trie->strings_cap);
+	}
+}
 
-	g_free(trie->value);
-	g_free(trie);
+static int enchant_trie_edge_compare(gconstpointer a, gconstpointer b)
+{
+	gunichar ch_a = ((const EnchantTrieEdge*) a)->ch, ch_b = ((const EnchantTrieEdge*) b)->ch;
+	return ch_a < ch_b ? -1 : ch_a > ch_b;
 }
 
-static void enchant_trie_free_cb(void* key _GL_UNUSED_PARAMETER,
-				 void* value,
-				 void* data _GL_UNUSED_PARAMETER)
+/* The trie holding the words of the parts, which hold two words or more
+ * between them, no two parts any word starting with the same character;
+ * the same trie as inserting the words one by one would give.  The
+ * arrays of each part are copied in one go, its root left unused. */
+static EnchantTrie* enchant_trie_join(EnchantTrie** parts, guint n_parts)
 {
-	enchant_trie_free((EnchantTrie*) value);
+	EnchantTrie* trie = enchant_trie_new();
+	enchant_trie_new_node(trie);
+	GArray* root_edges = g_array_new(FALSE, FALSE, sizeof(EnchantTrieEdge));
+
+	for (guint i = 0; i < n_parts; i++) {
+		EnchantTrie* part = parts[i];
+		if (part == NULL)
+			continue;
+
+		EnchantTrieNode* root = &part->nodes[0];
+		if (root->value != ENCHANT_TRIE_NO_VALUE) {
+			/* a single word, pushed down below its first character */
+			const char* word = part->strings + root->value;
+			EnchantTrieEdge edge = { g_utf8_get_char(word), enchant_trie_new_node(trie) };
+			guint32 value = enchant_trie_new_string(trie, g_utf8_next_char(word));
+			trie->nodes[edge.node].value = value;
+			g_array_append_val(root_edges, edge);
+			enchant_trie_free(part);
+			continue;
+		}
+
+		guint32 node_base = trie->n_nodes, edge_base = trie->n_edges, string_base = trie->n_strings;
+		enchant_trie_reserve(trie, part->n_nodes, part->n_edges, part->n_strings);
+		for (guint32 j = 0; j < part->n_nodes; j++) {
+			EnchantTrieNode* n = &trie->nodes[node_base + j];
+			*n = part->nodes[j];
+			n->edges += edge_base;
+			if (n->value != ENCHANT_TRIE_NO_VALUE)
+				n->value += string_base;
+		}
+		for (guint32 j = 0; j < part->n_edges; j++) {
+			EnchantTrieEdge* e = &trie->edges[edge_base + j];
+			*e = part->edges[j];
+			if (e->node != ENCHANT_TRIE_EOS)
+				e->node += node_base;
+		}
+		memcpy(trie->strings + string_base, part->strings, part->n_strings);
+		trie->n_nodes += part->n_nodes;
+		trie->n_edges += part->n_edges;
+		trie->n_strings += part->n_strings;
+		trie->dead_nodes += part->dead_nodes + 1;
+
+		for (guint32 j = 0; j < root->n_edges; j++) {
+			EnchantTrieEdge edge = part->edges[root->edges + j];
+			edge.node += node_base;
+			g_array_append_val(root_edges, edge);
+		}
+		enchant_trie_free(part);
+	}
+
+	g_array_sort(root_edges, enchant_trie_edge_compare);
+	enchant_trie_reserve(trie, 0, root_edges->len, 0);
+	memcpy(trie->edges + trie->n_edges, root_edges->data, root_edges->len * sizeof(EnchantTrieEdge));
+	trie->nodes[0].edges = trie->n_edges;
+	trie->nodes[0].n_edges = trie->nodes[0].edges_cap = root_edges->len;
+	trie->n_edges += root_edges->len;
+	g_array_free(root_edges, TRUE);
+
+	return trie;
 }
 
 static EnchantTrie* enchant_trie_insert(EnchantTrie* trie,const char *const word)
 {
 	if (trie == NULL) {
-		trie = g_new0(EnchantTrie, 1);
+		trie = enchant_trie_new();
+		enchant_trie_new_node(trie);
 	}
-
-	if (trie->value == NULL) {
-		if (trie->subtries == NULL) {
-			/*  When single word, store in trie->value */
-			trie->value = g_strdup(word);
+	enchant_trie_ensure_writable(trie);
+
+	guint32 node = 0;
+	const char *rest = word;
+	while (node != ENCHANT_TRIE_NO_NODE) {
+		EnchantTrieNode* n = &trie->nodes[node];
+		if (n->value != ENCHANT_TRIE_NO_VALUE) {
+			/* Push the single word down into a subtrie, and reinsert */
+			char *tmpWord = g_strdup(trie->strings + n->value);
+			n->value = ENCHANT_TRIE_NO_VALUE;
+			enchant_trie_insert_child(trie, node, tmpWord);
+			g_free(tmpWord);
+		} else if (n->n_edges == 0) {
+			/*  When single word, store in node->value */
+			guint32 value = enchant_trie_new_string(trie, rest);
+			trie->nodes[node].value = value;
+			break;
 		} else {
 			/* Store multiple words in subtries */
-			if (word[0] == '\0') {
-				/* Mark end-of-string with special node */
-				char *tmpWord = g_strdup("");
-				g_hash_table_insert(trie->subtries, tmpWord, EOSTrie);
-			} else {
-				ssize_t nxtCh = (ssize_t)(g_utf8_next_char(word)-word);
-				char *tmpWord = g_strndup(word,nxtCh);
-				EnchantTrie* subtrie = g_hash_table_lookup(trie->subtries, tmpWord);
-				subtrie = enchant_trie_insert(subtrie, word + nxtCh);
-				g_hash_table_insert(trie->subtries, tmpWord, subtrie);
-			}
+			const char *next = rest[0] ? g_utf8_next_char(rest) : rest;
+			node = enchant_trie_insert_child(trie, node, rest);
+			rest = next;
 		}
-	} else {
-		/* Create new hash table for subtries, and reinsert */
-		trie->subtries = g_hash_table_new_full(g_str_hash, 
-						       g_str_equal, g_free, NULL);
-		char *tmpWord = trie->value;
-		trie->value = NULL;
-		enchant_trie_insert(trie, tmpWord);
-		enchant_trie_insert(trie, word);
-		g_free(tmpWord);
 	}
 
 	return trie;
 }
 
-static void enchant_trie_remove(EnchantTrie* trie,const char *const word)
+static void enchant_trie_remove(EnchantTrie* trie,guint32 node,const char *const word)
 {
-	if (trie == NULL)
+	if (trie == NULL || node == ENCHANT_TRIE_EOS)
 		return;
 
-	if (trie->value == NULL) {
-		if (trie->subtries != NULL) {
-			/* Store multiple words in subtries */
+	EnchantTrieNode* n = &trie->nodes[node];
+	if (n->value == ENCHANT_TRIE_NO_VALUE) {
+		if (n->n_edges != 0) {
+			guint32 pos;
 			if (word[0] == '\0') {
 				/* End-of-string is marked with special node */
-				g_hash_table_remove(trie->subtries, "");
-			} else {
-				ssize_t nxtCh = (ssize_t)(g_utf8_next_char(word) - word);
-				char *tmpWord = g_strndup(word, nxtCh);
-				EnchantTrie *subtrie = g_hash_table_lookup(trie->subtries, tmpWord);
-				enchant_trie_remove(subtrie, word + nxtCh);
-
-				if(subtrie->subtries == NULL && subtrie->value == NULL) {
-					g_hash_table_remove(trie->subtries, tmpWord);
-					enchant_trie_free (subtrie);
+				if (enchant_trie_find_edge(trie, node, 0, &pos))
+					enchant_trie_remove_edge(trie, node, pos);
+			} else if (enchant_trie_find_edge(trie, node, g_utf8_get_char(word), &pos)) {
+				guint32 subtrie = trie->edges[n->edges + pos].node;
+				enchant_trie_remove(trie, subtrie, g_utf8_next_char(word));
+
+				EnchantTrieNode* sub = &trie->nodes[subtrie];
+				if(sub->n_edges == 0 && sub->value == ENCHANT_TRIE_NO_VALUE) {
+					enchant_trie_remove_edge(trie, node, pos);
+					trie->dead_nodes++;
 				}
-
-				g_free(tmpWord);
 			}
 
-			if(g_hash_table_size(trie->subtries) == 1)
+			if(n->n_edges == 1)
 				{
-					GList* keys = g_hash_table_get_keys(trie->subtries);
-					char *key = (char*) keys->data;
-					EnchantTrie *subtrie = g_hash_table_lookup(trie->subtries, key);
+					const EnchantTrieEdge* edge = &trie->edges[n->edges];
 
 					/* only remove trie nodes that have values by propagating these up */
-					if(subtrie->value)
+					if(edge->node != ENCHANT_TRIE_EOS && trie->nodes[edge->node].value != ENCHANT_TRIE_NO_VALUE)
 						{
-							trie->value = g_strconcat(key, subtrie->value, NULL);
-							enchant_trie_free(subtrie);
-							g_hash_table_destroy(trie->subtries);
-							trie->subtries = NULL;
+							char key[7];
+							key[g_unichar_to_utf8(edge->ch, key)] = '\0';
+							char *value = g_strconcat(key, trie->strings + trie->nodes[edge->node].value, NULL);
+							trie->nodes[edge->node].value = ENCHANT_TRIE_NO_VALUE;
+							enchant_trie_remove_edge(trie, node, 0);
+							trie->dead_nodes++;
+
+							guint32 offset = enchant_trie_new_string(trie, value);
+							trie->nodes[node].value = offset;
+							g_free(value);
 						}
-
-					g_list_free(keys);
 				}
 		}
 	} else {
-		if(strcmp(trie->value, word) == 0)
+		if(strcmp(trie->strings + n->value, word) == 0)
 		{
-			g_free(trie->value);
-			trie->value = NULL;
+			n->value = ENCHANT_TRIE_NO_VALUE;
 		}
 	}
 }
 
-static EnchantTrie* enchant_trie_get_subtrie(EnchantTrie* trie, 
-					     EnchantTrieMatcher* matcher,
-					     char** nxtChS)
+/* the highest frequency of the strings below node, as far as known */
+static guint32 enchant_trie_weight(const EnchantTrie* trie, guint32 node)
 {
-	if(trie->subtries == NULL || *nxtChS == NULL)
-		return NULL;
+	if (trie->weights == NULL)
+		return 0;
+	return node < trie->n_weights ? trie->weights[node] : G_MAXUINT32;
+}
+
+static guint32 enchant_trie_weigh_node(EnchantTrie* trie, guint32 node, GString* path, GHashTable* frequencies)
+{
+	const EnchantTrieNode* n = &trie->nodes[node];
+	guint32 weight = 0;
+	gsize len = path->len;
+
+	if (n->value != ENCHANT_TRIE_NO_VALUE) {
+		g_string_append(path, trie->strings + n->value);
+		weight = GPOINTER_TO_UINT(g_hash_table_lookup(frequencies, path->str));
+		g_string_truncate(path, len);
+	}
+	for (guint32 i = 0; i < n->n_edges; i++) {
+		const EnchantTrieEdge* edge = &trie->edges[n->edges + i];
+		guint32 edge_weight;
+		if (edge->node == ENCHANT_TRIE_EOS) {
+			edge_weight = GPOINTER_TO_UINT(g_hash_table_lookup(frequencies, path->str));
+		} else {
+			g_string_append_unichar(path, edge->ch);
+			edge_weight = enchant_trie_weigh_node(trie, edge->node, path, frequencies);
+			g_string_truncate(path, len);
+		}
+		weight = MAX(weight, edge_weight);
+	}
+
+	trie->weights[node] = weight;
+	return weight;
+}
+
+/* give every node the highest frequency of the strings below it, or
+ * drop the weights if there are no frequencies */
+static void enchant_trie_weigh(EnchantTrie* trie, GHashTable* frequencies)
+{
+	if (trie == NULL)
+		return;
+
+	g_free(trie->weights);
+	trie->weights = NULL;
+	trie->n_weights = 0;
+	if (frequencies == NULL)
+		return;
+
+	trie->weights = g_new0(guint32, MAX(trie->n_nodes, 1));
+	trie->n_weights = trie->n_nodes;
+	GString* path = g_string_new(NULL);
+	enchant_trie_weigh_node(trie, 0, path, frequencies);
+	g_string_free(path, TRUE);
+}
+
+/* keep the weights of the nodes on the way to word, which was just
+ * inserted, bounding its own */
+static void enchant_trie_raise_weights(EnchantTrie* trie, const char *const word, guint32 weight)
+{
+	if (trie == NULL || trie->weights == NULL || weight == 0)
+		return;
 
-	EnchantTrie *subtrie = g_hash_table_lookup(trie->subtries,*nxtChS);
-	if(subtrie == NULL && matcher->mode == case_insensitive) {
-		char* nxtChSUp = g_utf8_strup(*nxtChS, -1); /* we ignore the title case scenario since that will give us an edit_distance of one which is acceptable since this mode is used for suggestions*/
-		g_free(*nxtChS);
-		*nxtChS = nxtChSUp;
-		subtrie = g_hash_table_lookup(trie->subtries,nxtChSUp);
+	guint32 node = 0;
+	const char* rest = word;
+	for (;;) {
+		if (node < trie->n_weights)
+			trie->weights[node] = MAX(trie->weights[node], weight);
+
+		const EnchantTrieNode* n = &trie->nodes[node];
+		guint32 pos;
+		if (n->value != ENCHANT_TRIE_NO_VALUE || rest[0] == '\0' ||
+		    !enchant_trie_find_edge(trie, node, g_utf8_get_char(rest), &pos))
+			return;
+		node = trie->edges[n->edges + pos].node;
+		rest = g_utf8_next_char(rest);
 	}
-	return subtrie;
+}
+
+/* sort the n edge positions of node in order, heaviest first and
+ * otherwise in the order of the trie; the end of a string counts as
+ * heavy as node */
+static void enchant_trie_order_edges(EnchantTrie* trie, guint32 node, guint32* order, guint32 n)
+{
+	if (trie->weights == NULL)
+		return;
+
+	const EnchantTrieEdge* edges = trie->edges + trie->nodes[node].edges;
+	guint32* weights = g_newa(guint32, n);
+	for (guint32 i = 0; i < n; i++)
+		weights[i] = enchant_trie_weight(trie, edges[order[i]].node == ENCHANT_TRIE_EOS ?
+						 node : edges[order[i]].node);
+
+	for (guint32 i = 1; i < n; i++)
+		for (guint32 j = i; j > 0 && weights[j-1] < weights[j]; j--) {
+			guint32 tmp = order[j];
+			order[j] = order[j-1];
+			order[j-1] = tmp;
+			tmp = weights[j];
+			weights[j] = weights[j-1];
+			weights[j-1] = tmp;
+		}
 }
 
 static void enchant_trie_find_matches(EnchantTrie* trie,EnchantTrieMatcher *matcher)
@@ -821,152 +4269,296 @@ static void enchant_trie_find_matches(EnchantTrie* trie,EnchantTrieMatcher *matc
 		return;
 	}
 
-	/* Bail out if over the error limits */
-	if(matcher->num_errors > matcher->max_errors){
+	enchant_trie_find_matches_at(trie, 0, 0, matcher);
+}
+
+/* report the string in path and suffix as a match if the automaton accepts it in state */
+static void enchant_trie_matcher_report(EnchantTrieMatcher *matcher, guint32 state, const char *const suffix)
+{
+	int errs = matcher->automaton->errors[state];
+	if (errs > matcher->max_errors)
+		return;
+
+	size_t len = strlen(suffix);
+	matcher->num_errors = errs;
+	enchant_trie_matcher_pushpath(matcher, suffix, len);
+	matcher->cbfunc(matcher->path, matcher);
+	enchant_trie_matcher_poppath(matcher, len);
+
+	/* let the other matchers prune with what this one has found */
+	if (matcher->bound) {
+		int bound = g_atomic_int_get(matcher->bound);
+		while (matcher->max_errors < bound &&
+		       !g_atomic_int_compare_and_exchange(matcher->bound, bound, matcher->max_errors))
+			bound = g_atomic_int_get(matcher->bound);
+	}
+}
+
+static void enchant_trie_find_matches_at(EnchantTrie* trie,guint32 node,guint32 state,EnchantTrieMatcher *matcher)
+{
+	EnchantLevAutomaton *automaton = matcher->automaton;
+
+	/* Once told to stop, let nothing more get within the error limits */
+	if ((++matcher->n_visits & 0xff) == 0 && matcher->stop &&
+	    matcher->stop->stopped(matcher->stop->data)) {
+		matcher->max_errors = -1;
+	}
+
+	/* Take up what the matchers searching elsewhere have found */
+	if (matcher->bound) {
+		int bound = g_atomic_int_get(matcher->bound);
+		if (bound < matcher->max_errors)
+			matcher->max_errors = bound;
+	}
+
+	/* Bail out if nothing below can get within the error limits */
+	if(automaton->min_errors[state] > matcher->max_errors){
 		return;
 	}
 
 	/* If the end of a string has been reached, no point recursing */
-	if (trie == EOSTrie) {
-		size_t word_len = strlen(matcher->word);
-		int errs = matcher->num_errors;
-		if((ssize_t)word_len > matcher->word_pos) {
-			matcher->num_errors = errs + word_len - matcher->word_pos;
-		}
-		if (matcher->num_errors <= matcher->max_errors) {
-			matcher->cbfunc(g_strdup(matcher->path),matcher);
-		}
-		matcher->num_errors = errs;
+	if (node == ENCHANT_TRIE_EOS) {
+		enchant_trie_matcher_report(matcher, state, "");
 		return;
 	}
 
-	/* If there is a value, just check it, no recursion */
-	if (trie->value != NULL) {
-		gchar* value;
-		int errs = matcher->num_errors;
-		value = trie->value;
-		if(matcher->mode == case_insensitive)
-			{
-				value = g_utf8_strdown(value, -1);
-			}
-		matcher->num_errors = errs + edit_dist(value, 
-					   &(matcher->word[matcher->word_pos]));
-		if(matcher->mode == case_insensitive)
-			{
-				g_free(value);
-			}
+	/* Or if nothing below can beat what was found, on errors or weight */
+	if(automaton->min_errors[state] >= matcher->settled_errors &&
+	   enchant_trie_weight(trie, node) <= matcher->settled_weight){
+		return;
+	}
 
-		if (matcher->num_errors <= matcher->max_errors) {
-			matcher->cbfunc(g_strconcat(matcher->path,
-							trie->value,NULL),
-					matcher);
+	/* If there is a value, just run it through the automaton, no recursion */
+	const EnchantTrieNode* n = &trie->nodes[node];
+	if (n->value != ENCHANT_TRIE_NO_VALUE) {
+		const char* value = trie->strings + n->value;
+		for (const char* p = value; *p; p = g_utf8_next_char(p)) {
+			state = enchant_lev_automaton_step(automaton, state, g_utf8_get_char(p));
+			if (automaton->min_errors[state] > matcher->max_errors)
+				return;
 		}
-		matcher->num_errors = errs;
+		enchant_trie_matcher_report(matcher, state, value);
 		return;
 	}
 
-	ssize_t nxtChI = (ssize_t)(g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
-	char *nxtChS = g_strndup(&matcher->word[matcher->word_pos],
-				 (nxtChI - matcher->word_pos));
-
-	/* Precisely match the first character, and recurse */
-	EnchantTrie* subtrie = enchant_trie_get_subtrie(trie, matcher, &nxtChS);
-	if (subtrie != NULL) {
-		enchant_trie_matcher_pushpath(matcher,nxtChS);
-		ssize_t oldPos = matcher->word_pos;
-		matcher->word_pos = nxtChI;
-		enchant_trie_find_matches(subtrie,matcher);
-		matcher->word_pos = oldPos;
-		enchant_trie_matcher_poppath(matcher,strlen(nxtChS));
+	/* If only the word's own characters can lead to a match from here,
+	 * look their edges up instead of trying every edge in turn */
+	guint32 n_edges = n->n_edges;
+	guint32* edges = NULL;
+	guint32 other = n_edges > automaton->n_classes + 1
+		? enchant_lev_automaton_step_class(automaton, state, automaton->n_classes)
+		: ENCHANT_LEV_NO_STATE;
+	if (other != ENCHANT_LEV_NO_STATE && automaton->min_errors[other] > matcher->max_errors) {
+		edges = g_newa(guint32, automaton->n_classes + 1);
+		n_edges = 0;
+		guint32 pos;
+		if (trie->edges[n->edges].ch == 0)
+			edges[n_edges++] = 0;
+		for (guint32 c = 0; c < automaton->n_classes; c++)
+			if (enchant_trie_find_edge(trie, node, automaton->classes[c], &pos))
+				edges[n_edges++] = pos;
+
+		/* keep visiting them in the order of the trie */
+		for (guint32 i = 1; i < n_edges; i++)
+			for (guint32 j = i; j > 0 && edges[j-1] > edges[j]; j--) {
+				pos = edges[j];
+				edges[j] = edges[j-1];
+				edges[j-1] = pos;
+			}
 	}
 
-	g_free(nxtChS);
-
-	matcher->num_errors++;
-	if (matcher->word[matcher->word_pos] != '\0') {
-		/* Match on inserting word[0] */
-		ssize_t oldPos = matcher->word_pos;
-		matcher->word_pos = nxtChI;
-		enchant_trie_find_matches(trie,matcher);
-		matcher->word_pos = oldPos;
+	/* Or heaviest first, if weighed, to settle the search sooner */
+	if (trie->weights && n_edges > 1) {
+		guint32* order = g_newa(guint32, n_edges);
+		for (guint32 i = 0; i < n_edges; i++)
+			order[i] = edges ? edges[i] : i;
+		enchant_trie_order_edges(trie, node, order, n_edges);
+		edges = order;
 	}
-	/* for each subtrie, match on delete or substitute word[0] or transpose word[0] and word[1] */
-	g_hash_table_foreach(trie->subtries,
-				enchant_trie_find_matches_cb,
-				matcher);
-	matcher->num_errors--;
+
+	for (guint32 i = 0; i < n_edges; i++)
+		enchant_trie_find_matches_through(trie, &trie->edges[n->edges + (edges ? edges[i] : i)], state, matcher);
 }
 
-static void enchant_trie_find_matches_cb(void* keyV,void* subtrieV,void* matcherV)
+/* search below edge, the automaton being in state before its character */
+static void enchant_trie_find_matches_through(EnchantTrie* trie,const EnchantTrieEdge* edge,guint32 state,EnchantTrieMatcher *matcher)
 {
-	char *key = (char*) keyV;
-	EnchantTrie *subtrie = (EnchantTrie*) subtrieV;
-	EnchantTrieMatcher *matcher = (EnchantTrieMatcher*) matcherV;
-
-	ssize_t nxtChI = (ssize_t) (g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
+	if (edge->ch == 0) {
+		enchant_trie_find_matches_at(trie, edge->node, state, matcher);
+		return;
+	}
 
-	/* Dont handle actual matches, that's already done */
-	if (strncmp(key,&matcher->word[matcher->word_pos],nxtChI-matcher->word_pos) == 0) {
+	EnchantLevAutomaton *automaton = matcher->automaton;
+	guint32 next = enchant_lev_automaton_step(automaton, state, edge->ch);
+	if (automaton->min_errors[next] > matcher->max_errors)
 		return;
+
+	char key[6];
+	int keyLen = g_unichar_to_utf8(edge->ch, key);
+	enchant_trie_matcher_pushpath(matcher,key,keyLen);
+	enchant_trie_find_matches_at(trie, edge->node, next, matcher);
+	enchant_trie_matcher_poppath(matcher,keyLen);
+}
+
+/* add the state given as table entries, unless it exists, and return its number */
+static guint32 enchant_lev_automaton_add_state(EnchantLevAutomaton* automaton, const guint8* table)
+{
+	guint32 size = 2 * (automaton->len + 1);
+	char *encoded = g_newa(char, size + 1);
+	guint8 min_errors = automaton->dead;
+	for (guint32 i = 0; i < size; i++) {
+		encoded[i] = (char) (table[i] + 1); /* keep clear of the terminator */
+		min_errors = MIN (min_errors, table[i]);
+	}
+	encoded[size] = '\0';
+
+	gpointer id = g_hash_table_lookup(automaton->state_ids, encoded);
+	if (id != NULL)
+		return GPOINTER_TO_UINT(id) - 1;
+
+	if (automaton->n_states == automaton->states_cap) {
+		automaton->states_cap = MAX (16, automaton->states_cap * 2);
+		automaton->states = g_renew(const char*, automaton->states, automaton->states_cap);
+		automaton->min_errors = g_renew(guint8, automaton->min_errors, automaton->states_cap);
+		automaton->errors = g_renew(guint8, automaton->errors, automaton->states_cap);
+		automaton->transitions = g_renew(guint32, automaton->transitions,
+						 automaton->states_cap * (automaton->n_classes + 1));
 	}
 
-	enchant_trie_matcher_pushpath(matcher,key);
+	guint32 state = automaton->n_states++;
+	automaton->states[state] = g_string_chunk_insert_len(automaton->encoded, encoded, size);
+	automaton->min_errors[state] = min_errors;
+	automaton->errors[state] = table[automaton->len];
+	for (guint32 i = 0; i <= automaton->n_classes; i++)
+		automaton->transitions[state * (automaton->n_classes + 1) + i] = ENCHANT_LEV_NO_STATE;
+	g_hash_table_insert(automaton->state_ids, (char*) automaton->states[state], GUINT_TO_POINTER(state + 1));
+	return state;
+}
+
+static EnchantLevAutomaton* enchant_lev_automaton_new(const char* const word, int max_errors)
+{
+	EnchantLevAutomaton* automaton = g_new0(EnchantLevAutomaton, 1);
+	glong len;
+	gunichar* chars = g_utf8_to_ucs4_fast(word, -1, &len);
+
+	automaton->len = len;
+	automaton->word = g_new(guint32, len);
+	automaton->classes = g_new(gunichar, len);
+	for (glong i = 0; i < len; i++) {
+		guint32 c;
+		for (c = 0; c < automaton->n_classes && automaton->classes[c] != chars[i]; c++)
+			;
+		if (c == automaton->n_classes)
+			automaton->classes[automaton->n_classes++] = chars[i];
+		automaton->word[i] = c;
+	}
+	g_free(chars);
+
+	automaton->dead = (guint8) MIN (max_errors + 1, G_MAXUINT8 - 1);
+	for (gunichar ch = 0; ch < G_N_ELEMENTS (automaton->latin1); ch++)
+		automaton->latin1[ch] = enchant_lev_automaton_class(automaton, ch);
+	automaton->encoded = g_string_chunk_new(1024);
+	automaton->state_ids = g_hash_table_new(g_str_hash, g_str_equal);
+
+	/* the start state: the word's prefixes are as many deletions away
+	 * from the empty string, and there is nothing to transpose */
+	guint8* table = g_newa(guint8, 2 * (len + 1));
+	for (glong j = 0; j <= len; j++) {
+		table[j] = (guint8) MIN (j, automaton->dead);
+		table[len + 1 + j] = automaton->dead;
+	}
+	enchant_lev_automaton_add_state(automaton, table);
 
-	/* Match on deleting word[0] */
-	enchant_trie_find_matches(subtrie,matcher);
-	/* Match on substituting word[0] */
-	ssize_t oldPos = matcher->word_pos;
-	matcher->word_pos = nxtChI;
-	enchant_trie_find_matches(subtrie,matcher);
+	return automaton;
+}
 
-	enchant_trie_matcher_poppath(matcher,strlen(key));
+static void enchant_lev_automaton_free(EnchantLevAutomaton* automaton)
+{
+	g_free(automaton->classes);
+	g_free(automaton->word);
+	g_string_chunk_free(automaton->encoded);
+	g_hash_table_destroy(automaton->state_ids);
+	g_free(automaton->states);
+	g_free(automaton->min_errors);
+	g_free(automaton->errors);
+	g_free(automaton->transitions);
+	g_free(automaton);
+}
 
-	/* Match on transposing word[0] and word[1] */
-	char *key2 = g_strndup(&matcher->word[oldPos],nxtChI-oldPos);
-	EnchantTrie *subtrie2 = enchant_trie_get_subtrie(subtrie, matcher, &key2);
+/* the class of ch, n_classes if it is not in the word */
+static guint32 enchant_lev_automaton_class(EnchantLevAutomaton* automaton, gunichar ch)
+{
+	guint32 c;
+	for (c = 0; c < automaton->n_classes && automaton->classes[c] != ch; c++)
+		;
+	return c;
+}
 
-	if(subtrie2 != NULL) {
-		nxtChI = (ssize_t) (g_utf8_next_char(&matcher->word[matcher->word_pos]) - matcher->word);
-		if (strncmp(key,&matcher->word[matcher->word_pos],nxtChI-matcher->word_pos) == 0) {
-			matcher->word_pos = nxtChI;
-			enchant_trie_matcher_pushpath(matcher,key);
-			enchant_trie_matcher_pushpath(matcher,key2);
+/* the state reached from state on consuming ch */
+static guint32 enchant_lev_automaton_step(EnchantLevAutomaton* automaton, guint32 state, gunichar ch)
+{
+	guint32 c = ch < G_N_ELEMENTS (automaton->latin1) ? automaton->latin1[ch]
+		: enchant_lev_automaton_class(automaton, ch);
+	return enchant_lev_automaton_step_class(automaton, state, c);
+}
 
-			enchant_trie_find_matches(subtrie2,matcher);
-			enchant_trie_matcher_poppath(matcher,strlen(key2));
-			enchant_trie_matcher_poppath(matcher,strlen(key));
-		}
+/* the state reached from state on consuming a character of class c,
+ * n_classes standing for any character not in the word */
+static guint32 enchant_lev_automaton_step_class(EnchantLevAutomaton* automaton, guint32 state, guint32 c)
+{
+	guint32 transition = state * (automaton->n_classes + 1) + c;
+	if (automaton->transitions[transition] != ENCHANT_LEV_NO_STATE)
+		return automaton->transitions[transition];
+
+	/* one more row of the edit_dist table */
+	const guint32 len = automaton->len;
+	const guint32* word = automaton->word;
+	const char* encoded = automaton->states[state];
+	guint8* row = g_newa(guint8, 2 * (len + 1));
+	guint8* transposed = row + len + 1;
+	guint8* next = g_newa(guint8, 2 * (len + 1));
+	guint8* next_transposed = next + len + 1;
+	for (guint32 j = 0; j < 2 * (len + 1); j++)
+		row[j] = (guint8) (encoded[j] - 1);
+
+	next[0] = MIN (row[0] + 1, automaton->dead);
+	next_transposed[0] = automaton->dead;
+	for (guint32 j = 1; j <= len; j++) {
+		int cost = word[j-1] != c;
+		int v = MIN (row[j] + 1, next[j-1] + 1);
+		v = MIN (v, row[j-1] + cost);
+		if (j > 1 && word[j-2] == c)
+			v = MIN (v, transposed[j]);
+		next[j] = (guint8) MIN (v, automaton->dead);
+
+		/* ch followed by word[j-2] swaps the two */
+		if (j > 1 && !cost)
+			next_transposed[j] = (guint8) MIN (row[j-2] + (word[j-2] != word[j-1]), automaton->dead);
+		else
+			next_transposed[j] = automaton->dead;
 	}
 
-	g_free(key2);
-	
-	matcher->word_pos = oldPos;
+	guint32 target = enchant_lev_automaton_add_state(automaton, next);
+	automaton->transitions[transition] = target;
+	return target;
 }
 
-static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word,
+/* the word is to be in NFD already */
+static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const normalized_word,
 						     size_t len,
 						     int maxerrs,
 						     EnchantTrieMatcherMode mode,
-						     void(*cbfunc)(char*,EnchantTrieMatcher*),
+						     void(*cbfunc)(const char*,EnchantTrieMatcher*),
 						     void* cbdata)
 {
-	char * normalized_word = g_utf8_normalize (word, len, G_NORMALIZE_NFD);
-	len = strlen(normalized_word);
-
-	char * pattern = normalized_word;
-	if (mode == case_insensitive)
-		{
-			pattern = g_utf8_strdown (normalized_word, len);
-			g_free(normalized_word);
-		}
+	char * pattern = mode == case_insensitive ?
+		g_utf8_strdown (normalized_word, len) : g_strndup (normalized_word, len);
 
 	EnchantTrieMatcher* matcher = g_new(EnchantTrieMatcher,1);
 	matcher->num_errors = 0;
 	matcher->max_errors = maxerrs;
-	matcher->word = g_new0(char,len+maxerrs+2); // Ensure matcher does not overrun buffer: +2 for transpose check
-	strcpy(matcher->word, pattern);
+	matcher->automaton = enchant_lev_automaton_new(pattern, maxerrs);
 	g_free(pattern);
-	matcher->word_pos = 0;
 	matcher->path = g_new0(char,len+maxerrs+1);
 	matcher->path[0] = '\0';
 	matcher->path_len = len+maxerrs+1;
@@ -974,28 +4566,30 @@ static EnchantTrieMatcher* enchant_trie_matcher_init(const char* const word,
 	matcher->mode = mode;
 	matcher->cbfunc = cbfunc;
 	matcher->cbdata = cbdata;
+	matcher->stop = NULL;
+	matcher->n_visits = 0;
+	matcher->bound = NULL;
+	matcher->settled_errors = G_MAXINT;
+	matcher->settled_weight = 0;
 
 	return matcher;
 }
 
 static void enchant_trie_matcher_free(EnchantTrieMatcher* matcher)
 {
-	g_free(matcher->word);
+	enchant_lev_automaton_free(matcher->automaton);
 	g_free(matcher->path);
 	g_free(matcher);
 }
 
-static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,char* newchars)
+static void enchant_trie_matcher_pushpath(EnchantTrieMatcher* matcher,const char* newchars,ssize_t len)
 {
-	ssize_t len = strlen(newchars);
 	if(matcher->path_pos + len >= matcher->path_len) {
 		matcher->path_len = matcher->path_len + len + 10;
 		matcher->path = g_renew(char,matcher->path,matcher->path_len);
 	}
 
-	for (ssize_t i = 0; i < len; i++) {
-		matcher->path[matcher->path_pos + i] = newchars[i];
-	}
+	memcpy(matcher->path + matcher->path_pos, newchars, len);
 	matcher->path_pos = matcher->path_pos + len;
 	matcher->path[matcher->path_pos] = '\0';
 }
@@ -1010,9 +4604,82 @@ static void enchant_trie_matcher_poppath(EnchantTrieMatcher* matcher,int num)
 	matcher->path[matcher->path_pos] = '\0';
 }
 
-static int edit_dist(const char* utf8word1, const char* utf8word2)
+/* Myers' bit-parallel edit distance with Hyyrö's extension to adjacent
+ * transpositions, for a pattern of at most 64 characters: bit i of the
+ * vectors holds the vertical difference at row i + 1 of the edit_dist
+ * table column for the text read so far */
+static int edit_dist_bit_parallel(const char* pattern, glong len1,
+				  const char* text, glong len2, int max_dist)
+{
+	gunichar chars[64];
+	guint64 masks[64];
+	int n_chars = 0;
+
+	const char* p = pattern;
+	for (glong i = 0; i < len1; i++, p = g_utf8_next_char(p)) {
+		gunichar ch = g_utf8_get_char(p);
+		int k;
+		for (k = 0; k < n_chars && chars[k] != ch; k++)
+			;
+		if (k == n_chars) {
+			chars[n_chars] = ch;
+			masks[n_chars++] = 0;
+		}
+		masks[k] |= G_GUINT64_CONSTANT(1) << i;
+	}
+
+	const guint64 last = G_GUINT64_CONSTANT(1) << (len1 - 1);
+	guint64 pv = ~G_GUINT64_CONSTANT(0), mv = 0, d0 = 0, prev_eq = 0;
+	int score = len1;
+	glong j = 0;
+	for (const char* t = text; *t; t = g_utf8_next_char(t)) {
+		gunichar ch = g_utf8_get_char(t);
+		guint64 eq = 0;
+		for (int k = 0; k < n_chars; k++)
+			if (chars[k] == ch) {
+				eq = masks[k];
+				break;
+			}
+
+		guint64 tr = ((~d0 & eq) << 1) & prev_eq;
+		d0 = (((eq & pv) + pv) ^ pv) | eq | mv | tr;
+		guint64 hp = mv | ~(d0 | pv);
+		guint64 hn = d0 & pv;
+		if (hp & last)
+			score++;
+		else if (hn & last)
+			score--;
+		hp = (hp << 1) | 1;
+		hn <<= 1;
+		pv = hn | ~(d0 | hp);
+		mv = hp & d0;
+		prev_eq = eq;
+
+		/* each character left can bring the distance down by one at most */
+		if (score - (len2 - ++j) > max_dist)
+			return max_dist + 1;
+	}
+
+	return score;
+}
+
+/* the edit distance between the words, or a number greater than
+ * max_dist if it exceeds max_dist */
+static int edit_dist(const char* utf8word1, const char* utf8word2, int max_dist)
 {
-	glong len1, len2;
+	glong len1 = g_utf8_strlen(utf8word1, -1);
+	glong len2 = g_utf8_strlen(utf8word2, -1);
+	if (ABS (len1 - len2) > max_dist)
+		return max_dist + 1;
+
+	/* the distance is symmetric, so use the shorter word as the pattern */
+	if (len1 > len2)
+		return edit_dist(utf8word2, utf8word1, max_dist);
+	if (len1 == 0)
+		return len2;
+	if (len1 <= 64)
+		return edit_dist_bit_parallel(utf8word1, len1, utf8word2, len2, max_dist);
+
 	gunichar * word1 = g_utf8_to_ucs4_fast(utf8word1, -1, &len1);
 	gunichar * word2 = g_utf8_to_ucs4_fast(utf8word2, -1, &len2);
 
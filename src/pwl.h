@@ -40,16 +40,131 @@ typedef struct str_enchant_pwl EnchantPWL;
 
 /* Create and initialise a new, empty PWL */
 EnchantPWL* enchant_pwl_init(void);
+/* Open the PWL of a file, shared with everyone else who has it open */
 EnchantPWL* enchant_pwl_init_with_file(const char * file);
+/* Likewise, but a file that does not exist is empty, and only created
+ * when a word is written to it */
+EnchantPWL* enchant_pwl_init_with_optional_file(const char * file);
+/* Open the PWL of an existing file for reading only, never writing to
+ * the file or creating files next to it; adding and removing words do
+ * nothing */
+EnchantPWL* enchant_pwl_init_readonly(const char * file);
+int enchant_pwl_is_readonly(EnchantPWL * me);
 
 void enchant_pwl_add(EnchantPWL * me, const char *const word, size_t len);
+/* Add the NUL-terminated words, appending them to the file in a single write */
+void enchant_pwl_add_many(EnchantPWL * me, const char *const *words, size_t n_words);
 void enchant_pwl_remove(EnchantPWL * me, const char *const word, size_t len);
 int enchant_pwl_check(EnchantPWL * me,const char *const word, size_t len);
-/*gives the best set of suggestions from pwl that are at least as good as the given suggs*/
-char** enchant_pwl_suggest(EnchantPWL *me, const char *const word,
-			   size_t len, char ** suggs, size_t* out_n_suggs);
+unsigned int enchant_pwl_get_generation(EnchantPWL * me);
+/* How many times the words were read from the file, the first time
+ * included, and how many microseconds that took in all */
+void enchant_pwl_get_reload_stats(EnchantPWL * me, size_t *n_reloads, uint64_t *reload_us);
+/* How many trie nodes the suggestion searches visited, and how many
+ * system calls were made to tell whether the file changed */
+void enchant_pwl_get_work_stats(EnchantPWL * me, uint64_t *n_nodes_visited, uint64_t *n_file_polls);
+/* Estimate the bytes the words take up on the heap, and in the compiled
+ * indexes mapped from the file's directory */
+void enchant_pwl_get_memory_usage(EnchantPWL * me, size_t *heap, size_t *mapped);
+/* Estimate the bytes a GHashTable of n_entries takes up, its entries'
+ * keys and values left out */
+size_t enchant_hash_table_memory_usage(size_t n_entries);
+/* Like g_utf8_validate, but going over ASCII eight bytes at a time;
+ * is_ascii, if not NULL, tells whether str is all ASCII */
+int enchant_utf8_validate(const char *const str, ssize_t len, int *is_ascii);
+/* The length of the run of nonzero ASCII bytes str starts with */
+size_t enchant_utf8_ascii_prefix(const char *const str, size_t len);
+
+/* How a word is capitalized, which decides what other casings of it
+ * a word list accepts; a word whose only capital is its first letter
+ * is title case */
+typedef enum {
+	ENCHANT_CASE_LOWER,	/* no capitals, or no cased letters at all */
+	ENCHANT_CASE_TITLE,	/* a capital or title-case letter first, and none after */
+	ENCHANT_CASE_ALL_CAPS,	/* capitals and no lowercase letters */
+	ENCHANT_CASE_MIXED
+} EnchantCaseShape;
+
+/* Classify word in one pass */
+EnchantCaseShape enchant_case_shape(const char *const word, size_t len);
+
+/* Number of suggestions a PWL gives a dictionary */
+#define ENCHANT_PWL_MAX_SUGGS 15
+
+/* A word looked up or suggested in enchant_dict_suggest, along with
+ * what the steps of making suggestions work out about it, so that each
+ * is worked out once */
+typedef struct str_enchant_suggestion
+{
+	char *word;		/* in UTF-8, owned */
+	size_t len;
+	char *normalized;	/* its NFD form, which is word itself if ASCII */
+	size_t normalized_len;
+	int distance;		/* edit distance from the word looked up, or -1 */
+} EnchantSuggestion;
+
+/* Take over word, which must be valid UTF-8, and normalize it */
+void enchant_suggestion_init(EnchantSuggestion * sugg, char *word, size_t len);
+void enchant_suggestion_clear(EnchantSuggestion * sugg);
+
+/* As enchant_pwl_check, without normalizing the word again */
+int enchant_pwl_check_suggestion(EnchantPWL * me, const EnchantSuggestion * sugg);
+
+/* Lets a search for suggestions be cut short: stopped is polled every
+ * so often, and once it returns nonzero the search ends with what it
+ * has found so far */
+typedef struct str_enchant_pwl_stop
+{
+	int (*stopped)(void *data);
+	void *data;
+} EnchantPWLStop;
+
+/*gives the best set of at most max_suggs suggestions from pwl that are at least as good as the given suggs,
+ *whose distances are filled in along the way; they are at most max_errors away, or the default limit
+ *if it is negative; stop may be NULL*/
+EnchantSuggestion* enchant_pwl_suggest(EnchantPWL *me, const EnchantSuggestion * word,
+				       EnchantSuggestion * suggs, size_t n_suggs,
+				       size_t max_suggs, int max_errors,
+				       const EnchantPWLStop * stop, size_t* out_n_suggs);
+/* Lets the caller pass over words: accepted is called with the
+ * original spelling of each word found, and one it returns zero for
+ * is left out */
+typedef struct str_enchant_pwl_accept
+{
+	int (*accepted)(const char *const word, void *data);
+	void *data;
+} EnchantPWLAccept;
+
+/*gives, in codepoint order of their normal forms, at most max_words (0 for no limit) of the words
+ *of pwl that start with prefix, in their original spellings and as a g_strfreev list; ignoring case
+ *through the lowercase spellings if fold is set; accept may be NULL*/
+char **enchant_pwl_complete(EnchantPWL *me, const char *const prefix, size_t len, int fold,
+			    size_t max_words, const EnchantPWLAccept *accept, size_t *out_n_words);
+/* Drop a reference to the PWL; the PWL functions are safe to call from many threads */
 void enchant_pwl_free(EnchantPWL* me);
 
+/* How a PWL looks for suggestions */
+typedef enum {
+	ENCHANT_PWL_SUGGEST_TRIE,	/* search the trie of the words, the default */
+	ENCHANT_PWL_SUGGEST_DELETIONS,	/* look them up in an index of deletions, for very large word lists */
+	ENCHANT_PWL_SUGGEST_PARALLEL	/* search the trie on several threads, for very large word lists */
+} EnchantPWLSuggestEngine;
+
+void enchant_pwl_set_suggest_engine(EnchantPWL * me, EnchantPWLSuggestEngine engine);
+int enchant_pwl_set_frequencies(EnchantPWL * me, const char *const filename);
+
+/* Write additions and removals to the file from a background thread */
+void enchant_pwl_set_write_behind(EnchantPWL * me, int enabled);
+/* Write out the additions and removals not written yet */
+void enchant_pwl_flush(EnchantPWL * me);
+/* Release what is built again when needed, and the slack the words
+ * have gathered as they were added and removed */
+void enchant_pwl_trim(EnchantPWL * me);
+/* Get ready for a fork: build what checking, and looking for suggestions
+ * if fold is set, would build, move the tries to read-only memory and
+ * stop following changes to the file */
+void enchant_pwl_freeze(EnchantPWL * me, int fold);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,121 @@
+/* enchant
+ * Copyright (C) 2003 Dom Lachowicz
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * In addition, as a special exception, Dom Lachowicz
+ * gives permission to link the code of this program with
+ * non-LGPL Spelling Provider libraries (eg: a MSFT Office
+ * spell checker backend) and distribute linked combinations including
+ * the two.  You must obey the GNU Lesser General Public License in all
+ * respects for all of the code used other than said providers.  If you modify
+ * this file, you may extend this exception to your version of the
+ * file, but you are not obligated to do so.  If you do not wish to
+ * do so, delete this exception statement from your version.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <glib.h>
+#include "enchant-provider.h"
+
+/* Static probes for the calls traced, where the platform has them:
+ * USDT probes enchant:enter and enchant:leave for SystemTap, DTrace,
+ * bpftrace and perf, and the TraceLogging events Enter and Leave of the
+ * Enchant ETW provider on Windows.  They carry the arguments of
+ * EnchantTraceFn. */
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define ENCHANT_TRACE_HAVE_SDT 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+#define ENCHANT_TRACE_HAVE_ETW 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one call being traced, see enchant_trace_enter */
+typedef struct str_enchant_trace
+{
+	const char *event;
+	const char *tag;
+	EnchantProvider *provider;
+	size_t len;
+	gint64 start;		/* monotonic time it was entered, or 0 if no one was listening */
+} EnchantTrace;
+
+/* the function enchant_set_trace_fn set, if any */
+extern gpointer enchant_trace_listener;
+
+#if defined(ENCHANT_TRACE_HAVE_SDT)
+/* set by the tracers attached to the probes */
+extern unsigned short enchant_enter_semaphore;
+extern unsigned short enchant_leave_semaphore;
+#define ENCHANT_TRACE_SDT_ENABLED() (enchant_enter_semaphore != 0 || enchant_leave_semaphore != 0)
+#else
+#define ENCHANT_TRACE_SDT_ENABLED() 0
+#endif
+
+#if defined(ENCHANT_TRACE_HAVE_ETW)
+TRACELOGGING_DECLARE_PROVIDER (enchant_trace_provider);
+#define ENCHANT_TRACE_ETW_ENABLED() TraceLoggingProviderEnabled (enchant_trace_provider, 0, 0)
+#else
+#define ENCHANT_TRACE_ETW_ENABLED() 0
+#endif
+
+void enchant_trace_enter_slow (EnchantTrace * trace);
+void enchant_trace_leave_slow (EnchantTrace * trace);
+
+/* Starts tracing a call, which is a test and a branch while no one
+ * listens; @tag, @provider and @len may be changed before
+ * enchant_trace_leave, and must be valid until then */
+static inline void
+enchant_trace_enter (EnchantTrace * trace, const char * event, const char * tag,
+		     EnchantProvider * provider, size_t len)
+{
+	trace->start = 0;
+	if (G_UNLIKELY (g_atomic_pointer_get (&enchant_trace_listener) != NULL ||
+			ENCHANT_TRACE_SDT_ENABLED () || ENCHANT_TRACE_ETW_ENABLED ()))
+		{
+			trace->event = event;
+			trace->tag = tag;
+			trace->provider = provider;
+			trace->len = len;
+			enchant_trace_enter_slow (trace);
+		}
+}
+
+static inline void
+enchant_trace_leave (EnchantTrace * trace)
+{
+	if (G_UNLIKELY (trace->start != 0))
+		enchant_trace_leave_slow (trace);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -97,6 +97,30 @@ MockEnGbProviderListDictionaries (EnchantProvider *,
     return out_list;
 }
 
+// Has the mock provider, when the broker loads it, make dictionaries
+// that take their time, see mock_provider.cpp
+struct MockLatencyEnvironment
+{
+    MockLatencyEnvironment(const char *checkLatency, const char *suggestLatency,
+                           const char *nSuggs, const char *suggLen, bool nonReentrant)
+    {
+        g_setenv("ENCHANT_MOCK_CHECK_LATENCY", checkLatency, TRUE);
+        g_setenv("ENCHANT_MOCK_SUGGEST_LATENCY", suggestLatency, TRUE);
+        g_setenv("ENCHANT_MOCK_N_SUGGS", nSuggs, TRUE);
+        g_setenv("ENCHANT_MOCK_SUGG_LEN", suggLen, TRUE);
+        g_setenv("ENCHANT_MOCK_NON_REENTRANT", nonReentrant ? "1" : "0", TRUE);
+    }
+
+    ~MockLatencyEnvironment()
+    {
+        g_unsetenv("ENCHANT_MOCK_CHECK_LATENCY");
+        g_unsetenv("ENCHANT_MOCK_SUGGEST_LATENCY");
+        g_unsetenv("ENCHANT_MOCK_N_SUGGS");
+        g_unsetenv("ENCHANT_MOCK_SUGG_LEN");
+        g_unsetenv("ENCHANT_MOCK_NON_REENTRANT");
+    }
+};
+
 typedef void (*SET_CONFIGURE)(ConfigureHook);
 
 struct EnchantBrokerTestFixture : EnchantTestFixture
@@ -196,6 +220,10 @@ struct EnchantBrokerTestFixture : EnchantTestFixture
 
 
     EnchantProvider* GetMockProvider(){
+        // providers are only loaded once they are needed
+        if(_broker){
+            enchant_broker_describe(_broker, IgnoreProviderDescription, NULL);
+        }
         return mock_provider;
     }
 
@@ -234,6 +262,11 @@ struct EnchantBrokerTestFixture : EnchantTestFixture
 
     private: 
      std::stack<std::string> pwlFilenames;
+     static void IgnoreProviderDescription (const char * const, const char * const,
+                                            const char * const, void *)
+    {
+    }
+
      static EnchantProvider * mock_provider;
      static ConfigureHook userMockProviderConfiguration;
      static ConfigureHook userMockProvider2Configuration;
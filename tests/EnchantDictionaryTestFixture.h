@@ -309,7 +309,7 @@ struct EnchantDictionaryTestFixture : EnchantBrokerTestFixture
         std::vector<std::string> result;
         if(expectedSuggestions != NULL && begin < cSuggestions){
             result.insert(result.begin(), expectedSuggestions+begin, expectedSuggestions+cSuggestions);
-            FreeStringList(expectedSuggestions);
+            g_strfreev(expectedSuggestions);
         }
 
         return result;
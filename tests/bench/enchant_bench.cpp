@@ -0,0 +1,398 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Microbenchmarks for the broker, the personal word lists and the
+ * providers, run with "make bench".  Each result is printed as one JSON
+ * object per line:
+ *
+ *   {"benchmark": "pwl/100k/check", "iterations": 123, "ns_per_op": 81.2, "ops_per_sec": 12315271}
+ *
+ * Options:
+ *   --min-time=SECONDS  how long to repeat each benchmark for (0.2)
+ *   --filter=TEXT       only run the benchmarks whose name contains TEXT
+ *   --max-words=N       skip the personal word lists longer than N words
+ *   --prefix=DIR        also time each provider installed under DIR
+ */
+
+#include "EnchantDictionaryTestFixture.h"
+#include "enchant.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+EnchantProvider * EnchantBrokerTestFixture::mock_provider=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProviderConfiguration=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProvider2Configuration=NULL;
+
+static double min_time = 0.2;
+static const char *filter = NULL;
+static size_t max_words = 1000000;
+static const char *prefix = NULL;
+
+// Calls op, which does units_per_call operations each time, until
+// min_time has passed, and prints how long an operation took
+static void
+Bench(const std::string& name, size_t units_per_call, const std::function<void()>& op,
+      bool warm_up = true)
+{
+    if (filter && name.find(filter) == std::string::npos)
+        return;
+
+    if (warm_up)
+        op();
+
+    size_t calls = 0;
+    gint64 start = g_get_monotonic_time();
+    gint64 elapsed;
+    do {
+        op();
+        calls++;
+        elapsed = g_get_monotonic_time() - start;
+    } while (elapsed < min_time * G_USEC_PER_SEC);
+
+    double ns_per_op = elapsed * 1000.0 / ((double) calls * units_per_call);
+    gchar *escaped = g_strescape(name.c_str(), NULL);
+    printf("{\"benchmark\": \"%s\", \"iterations\": %lu, \"ns_per_op\": %.1f, \"ops_per_sec\": %.0f}\n",
+           escaped, (unsigned long) (calls * units_per_call), ns_per_op, 1e9 / ns_per_op);
+    fflush(stdout);
+    g_free(escaped);
+}
+
+// The i'th of a set of distinct made-up words of seven letters
+static std::string
+MakeWord(size_t i)
+{
+    guint32 x = (guint32) i * 2654435761u;   // a bijection, keeping them distinct
+    std::string word(7, 'a');
+    for (size_t j = 0; j < word.size(); j++) {
+        word[j] = 'a' + (char) (x % 26);
+        x /= 26;
+    }
+    return word;
+}
+
+// word with one letter changed, as a typo would
+static std::string
+Misspell(const std::string& word)
+{
+    std::string result(word);
+    result[result.size() / 2] = result[result.size() / 2] == 'z' ? 'y' : 'z';
+    return result;
+}
+
+static std::vector<std::string>
+MakeWords(size_t n)
+{
+    std::vector<std::string> words;
+    words.reserve(n);
+    for (size_t i = 0; i < n; i++)
+        words.push_back(MakeWord(i));
+    return words;
+}
+
+static void
+BenchCheck(const std::string& name, EnchantDict *dict, const std::vector<std::string>& words)
+{
+    size_t i = 0;
+    Bench(name + "/check", 1, [&] () {
+        const std::string& word = words[i++ % words.size()];
+        enchant_dict_check(dict, word.c_str(), word.size());
+    });
+
+    std::vector<const char *> batch;
+    std::vector<ssize_t> lens;
+    for (size_t j = 0; j < words.size(); j++) {
+        batch.push_back(words[j].c_str());
+        lens.push_back(words[j].size());
+    }
+    std::vector<int> results(words.size());
+    Bench(name + "/check_batch", words.size(), [&] () {
+        enchant_dict_check_batch(dict, batch.data(), lens.data(), batch.size(), results.data());
+    });
+}
+
+static void
+BenchSuggest(const std::string& name, EnchantDict *dict, const std::vector<std::string>& words)
+{
+    size_t i = 0;
+    Bench(name, 1, [&] () {
+        const std::string& word = words[i++ % words.size()];
+        size_t n_suggs;
+        char **suggs = enchant_dict_suggest(dict, word.c_str(), word.size(), &n_suggs);
+        if (suggs)
+            enchant_dict_free_string_list(dict, suggs);
+    });
+}
+
+static int
+BenchDictionaryCheck(EnchantDict *, const char *const word, size_t)
+{
+    return word[0] < 'n' ? 0 : 1;
+}
+
+static EnchantDict*
+BenchProviderRequestDictionary(EnchantProvider *me, const char *tag)
+{
+    EnchantDict *dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = BenchDictionaryCheck;
+    return dict;
+}
+
+static void
+Bench_ProviderConfiguration(EnchantProvider *me, const char *)
+{
+    me->request_dict = BenchProviderRequestDictionary;
+    me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+// The cost of the broker itself, in front of a provider that does
+// next to nothing
+static void
+BenchMock()
+{
+    EnchantDictionaryTestFixture fixture(Bench_ProviderConfiguration);
+    std::vector<std::string> words = MakeWords(4096);
+    std::vector<std::string> misspelled;
+    for (size_t i = 0; i < words.size(); i++)
+        misspelled.push_back(Misspell(words[i]));
+
+    BenchCheck("mock", fixture._dict, words);
+    BenchSuggest("mock/suggest", fixture._dict, misspelled);
+
+    // the provider's suggestions merged with, and deduplicated against,
+    // as many from the personal word list
+    std::vector<std::string> merged(misspelled.begin(), misspelled.begin() + 256);
+    for (size_t i = 0; i < merged.size(); i++)
+        for (char c = 'a'; c < 'e'; c++) {
+            std::string word(merged[i]);
+            word[0] = c;
+            fixture.AddWordToDictionary(word);
+        }
+    BenchSuggest("mock/suggest_merge", fixture._dict, merged);
+
+    // splitting text into words, counted per word
+    std::string text;
+    for (size_t i = 0; text.size() < 64 * 1024; i++) {
+        text += words[i % words.size()];
+        text += i % 8 == 7 ? ". " : " ";
+    }
+    int n_words = enchant_dict_split_text(fixture._dict, text.c_str(), text.size(), NULL, NULL);
+    Bench("mock/split_text", n_words, [&] () {
+        enchant_dict_split_text(fixture._dict, text.c_str(), text.size(), NULL, NULL);
+    });
+    Bench("mock/check_text", n_words, [&] () {
+        enchant_dict_check_text(fixture._dict, text.c_str(), text.size(), NULL, NULL);
+    });
+}
+
+// Checks each of words against dict from each of n_threads threads
+static void
+CheckFromThreads(EnchantDict *dict, const std::vector<std::string>& words, int n_threads)
+{
+    struct Checker
+    {
+        static gpointer Run(gpointer data)
+        {
+            std::pair<EnchantDict *, const std::vector<std::string> *> *job =
+                static_cast<std::pair<EnchantDict *, const std::vector<std::string> *> *>(data);
+            for (size_t i = 0; i < job->second->size(); i++)
+                enchant_dict_check(job->first, (*job->second)[i].c_str(), (*job->second)[i].size());
+            return NULL;
+        }
+    };
+
+    std::pair<EnchantDict *, const std::vector<std::string> *> job(dict, &words);
+    std::vector<GThread *> threads;
+    for (int i = 0; i < n_threads; i++)
+        threads.push_back(g_thread_new("check", Checker::Run, &job));
+    for (int i = 0; i < n_threads; i++)
+        g_thread_join(threads[i]);
+}
+
+// The same, with a provider that takes 50us to check a word and 500us
+// give or take 250us to suggest, see mock_provider.cpp; the batches show
+// how well the broker spreads the work over threads
+static void
+BenchMockLatency()
+{
+    g_setenv("ENCHANT_MOCK_CHECK_LATENCY", "50", TRUE);
+    g_setenv("ENCHANT_MOCK_SUGGEST_LATENCY", "500:250", TRUE);
+    {
+        EnchantBrokerTestFixture fixture;
+        EnchantDict *dict = fixture.RequestDictionary("qaa");
+        std::vector<std::string> words = MakeWords(64);
+
+        BenchCheck("mock_latency", dict, words);
+        BenchSuggest("mock_latency/suggest", dict, words);
+
+        std::vector<const char *> batch;
+        std::vector<ssize_t> lens;
+        for (size_t i = 0; i < words.size(); i++) {
+            batch.push_back(words[i].c_str());
+            lens.push_back(words[i].size());
+        }
+        std::vector<size_t> n_suggs(words.size());
+        Bench("mock_latency/suggest_batch", words.size(), [&] () {
+            char ***suggs_list = enchant_dict_suggest_batch(dict, batch.data(), lens.data(),
+                                                            batch.size(), n_suggs.data());
+            if (suggs_list)
+                enchant_dict_free_suggest_batch(dict, suggs_list);
+        });
+
+        // the same checks from several threads at once, which a provider
+        // that spends its time waiting should get through proportionally
+        // faster, unless the broker makes them take turns
+        for (int n_threads = 1; n_threads <= 8; n_threads *= 2)
+            Bench("mock_latency/check/" + std::to_string(n_threads) + "_threads",
+                  n_threads * words.size(), [&] () {
+                CheckFromThreads(dict, words, n_threads);
+            });
+
+        fixture.FreeDictionary(dict);
+    }
+    g_unsetenv("ENCHANT_MOCK_CHECK_LATENCY");
+    g_unsetenv("ENCHANT_MOCK_SUGGEST_LATENCY");
+}
+
+// Loading, checking against and suggesting from personal word lists of
+// n_words words
+static void
+BenchPwl(const std::string& name, size_t n_words)
+{
+    EnchantBrokerTestFixture fixture;
+    std::vector<std::string> words = MakeWords(n_words);
+
+    std::string filename = EnchantTestFixture::GetTemporaryFilename("bench");
+    FILE *file = fopen(filename.c_str(), "w");
+    for (size_t i = 0; i < words.size(); i++)
+        fprintf(file, "%s\n", words[i].c_str());
+    fclose(file);
+
+    Bench(name + "/load", n_words, [&] () {
+        EnchantDict *dict = enchant_broker_request_pwl_dict(fixture._broker, filename.c_str());
+        enchant_dict_check(dict, words[0].c_str(), words[0].size());
+        enchant_broker_free_dict(fixture._broker, dict);
+    }, false);
+
+    EnchantDict *dict = enchant_broker_request_pwl_dict(fixture._broker, filename.c_str());
+    std::vector<std::string> present, absent;
+    for (size_t i = 0; i < 4096; i++) {
+        present.push_back(words[(i * 7919) % words.size()]);
+        absent.push_back(Misspell(present.back()));
+    }
+    BenchCheck(name, dict, present);
+    BenchCheck(name + "/absent", dict, absent);
+    BenchSuggest(name + "/suggest", dict, absent);
+    enchant_broker_free_dict(fixture._broker, dict);
+
+    EnchantTestFixture::DeleteFile(filename);
+}
+
+static void
+CollectDictionary(const char * const lang_tag, const char * const provider_name,
+                  const char * const, const char * const, void * user_data)
+{
+    std::vector<std::pair<std::string, std::string> > *dicts =
+        static_cast<std::vector<std::pair<std::string, std::string> > *>(user_data);
+    for (size_t i = 0; i < dicts->size(); i++)
+        if ((*dicts)[i].first == provider_name)
+            return;
+    dicts->push_back(std::make_pair(std::string(provider_name), std::string(lang_tag)));
+}
+
+// Each provider installed under prefix, with the first of its dictionaries
+static void
+BenchProviders()
+{
+    static const char *const sample[] = {
+        "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+        "spelling", "dictionary", "receive", "separate", "necessary",
+        "recieve", "seperate", "neccessary", "definately", "occured"
+    };
+
+    enchant_set_prefix_dir(prefix);
+    EnchantBroker *broker = enchant_broker_init();
+
+    std::vector<std::pair<std::string, std::string> > dicts;
+    enchant_broker_list_dicts(broker, CollectDictionary, &dicts);
+
+    std::vector<std::string> words(sample, sample + G_N_ELEMENTS(sample));
+    for (size_t i = 0; i < dicts.size(); i++) {
+        enchant_broker_set_ordering(broker, dicts[i].second.c_str(), dicts[i].first.c_str());
+        std::string name = dicts[i].first + "/" + dicts[i].second;
+
+        EnchantDict *dict = NULL;
+        Bench(name + "/load", 1, [&] () {
+            if (dict)
+                enchant_broker_free_dict(broker, dict);
+            dict = enchant_broker_request_dict(broker, dicts[i].second.c_str());
+        }, false);
+        if (!dict)
+            continue;
+
+        BenchCheck(name, dict, words);
+        BenchSuggest(name + "/suggest", dict, words);
+        enchant_broker_free_dict(broker, dict);
+    }
+
+    enchant_broker_free(broker);
+}
+
+int
+main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "--min-time="))
+            min_time = g_ascii_strtod(argv[i] + strlen("--min-time="), NULL);
+        else if (g_str_has_prefix(argv[i], "--filter="))
+            filter = argv[i] + strlen("--filter=");
+        else if (g_str_has_prefix(argv[i], "--max-words="))
+            max_words = strtoul(argv[i] + strlen("--max-words="), NULL, 10);
+        else if (g_str_has_prefix(argv[i], "--prefix="))
+            prefix = argv[i] + strlen("--prefix=");
+        else {
+            fprintf(stderr, "usage: %s [--min-time=SECONDS] [--filter=TEXT] [--max-words=N] [--prefix=DIR]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    enchant_set_prefix_dir(".");
+
+    BenchMock();
+    BenchMockLatency();
+
+    static const size_t pwl_sizes[] = { 1000, 100000, 1000000 };
+    static const char *const pwl_names[] = { "pwl/1k", "pwl/100k", "pwl/1M" };
+    for (size_t i = 0; i < G_N_ELEMENTS(pwl_sizes); i++)
+        if (pwl_sizes[i] <= max_words)
+            BenchPwl(pwl_names[i], pwl_sizes[i]);
+
+    if (prefix)
+        BenchProviders();
+
+    return 0;
+}
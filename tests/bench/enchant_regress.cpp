@@ -0,0 +1,314 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Regression tests for the work the hot paths do, built and run with the
+ * other tests by "make check".  Rather than timing anything, each test
+ * counts, per operation and over a fixed set of operations:
+ *
+ *   pwl_file_polls     system calls made to tell whether a personal word
+ *                      list's file changed
+ *   pwl_suggest_nodes  trie nodes the suggestion searches visited
+ *
+ * as enchant_dict_get_work_stats reports them, a hook lib.c keeps for the
+ * tests.  Neither depends on the machine or the C library, so the same
+ * figures hold everywhere.
+ *
+ * It fails if any of them comes out more than 10% above its figure in
+ * the baseline file, one "name value" line per counter, or has no figure
+ * there to be checked against, and is skipped while the baseline file
+ * has no figures at all.
+ *
+ * Options:
+ *   --baseline=FILE  the baseline file (bench/enchant_regress.baseline)
+ *   --update         write what was counted to the baseline file instead
+ */
+
+#include <stdlib.h>
+
+#include "EnchantDictionaryTestFixture.h"
+#include "enchant.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" ENCHANT_MODULE_EXPORT
+void enchant_dict_get_work_stats(EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
+EnchantProvider * EnchantBrokerTestFixture::mock_provider=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProviderConfiguration=NULL;
+ConfigureHook EnchantBrokerTestFixture::userMockProvider2Configuration=NULL;
+
+static const double tolerance = 0.1;
+
+// what each counter came to, per operation
+static std::map<std::string, double> measured;
+
+static void
+CollectStats(const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *stats = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*stats)[name] = value;
+}
+
+static std::map<std::string, uint64_t>
+GetStats(EnchantDict *dict)
+{
+    std::map<std::string, uint64_t> stats;
+    enchant_dict_get_work_stats(dict, CollectStats, &stats);
+    return stats;
+}
+
+// Calls op once for each of words, after a first call to warm up with, and
+// records how much each of the dictionary's counters named in stat_names
+// went up by per call
+static void
+Measure(const std::string& name, EnchantDict *dict, const std::vector<std::string>& words,
+        const std::vector<std::string>& stat_names,
+        const std::function<void(const std::string&)>& op)
+{
+    op(words[0]);
+
+    std::map<std::string, uint64_t> before = GetStats(dict);
+    for (size_t i = 1; i < words.size(); i++)
+        op(words[i]);
+    std::map<std::string, uint64_t> after = GetStats(dict);
+
+    double n_ops = (double) (words.size() - 1);
+    for (size_t i = 0; i < stat_names.size(); i++)
+        measured[name + "/" + stat_names[i]] = (after[stat_names[i]] - before[stat_names[i]]) / n_ops;
+}
+
+static void
+Check(EnchantDict *dict, const std::string& word)
+{
+    enchant_dict_check(dict, word.c_str(), word.size());
+}
+
+static void
+Suggest(EnchantDict *dict, const std::string& word)
+{
+    size_t n_suggs;
+    char **suggs = enchant_dict_suggest(dict, word.c_str(), word.size(), &n_suggs);
+    if (suggs)
+        enchant_dict_free_string_list(dict, suggs);
+}
+
+// The i'th of a set of distinct made-up words of seven letters, as in
+// enchant_bench.cpp
+static std::string
+MakeWord(size_t i)
+{
+    guint32 x = (guint32) i * 2654435761u;
+    std::string word(7, 'a');
+    for (size_t j = 0; j < word.size(); j++) {
+        word[j] = 'a' + (char) (x % 26);
+        x /= 26;
+    }
+    return word;
+}
+
+// word with one letter changed, as a typo would
+static std::string
+Misspell(const std::string& word)
+{
+    std::string result(word);
+    result[result.size() / 2] = result[result.size() / 2] == 'z' ? 'y' : 'z';
+    return result;
+}
+
+static int
+RegressDictionaryCheck(EnchantDict *, const char *const word, size_t)
+{
+    return word[0] < 'n' ? 0 : 1;
+}
+
+static EnchantDict*
+RegressProviderRequestDictionary(EnchantProvider *me, const char *tag)
+{
+    EnchantDict *dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = RegressDictionaryCheck;
+    return dict;
+}
+
+static void
+Regress_ProviderConfiguration(EnchantProvider *me, const char *)
+{
+    me->request_dict = RegressProviderRequestDictionary;
+    me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+// The broker in front of a provider that does next to nothing, with a
+// personal word list of a few hundred words
+static void
+MeasureMock()
+{
+    EnchantDictionaryTestFixture fixture(Regress_ProviderConfiguration);
+    std::vector<std::string> words, misspelled;
+    for (size_t i = 0; i < 1024; i++) {
+        words.push_back(MakeWord(i));
+        misspelled.push_back(Misspell(words.back()));
+    }
+    for (size_t i = 0; i < 256; i++)
+        fixture.AddWordToDictionary(MakeWord(i * 4));
+
+    std::vector<std::string> stats;
+    stats.push_back("pwl_file_polls");
+    Measure("mock/check", fixture._dict, words, stats,
+            [&] (const std::string& word) { Check(fixture._dict, word); });
+    stats.push_back("pwl_suggest_nodes");
+    Measure("mock/suggest", fixture._dict, misspelled, stats,
+            [&] (const std::string& word) { Suggest(fixture._dict, word); });
+}
+
+// A personal word list of 10000 words on its own
+static void
+MeasurePwl()
+{
+    EnchantBrokerTestFixture fixture;
+
+    std::string filename = EnchantTestFixture::GetTemporaryFilename("regress");
+    FILE *file = fopen(filename.c_str(), "w");
+    for (size_t i = 0; i < 10000; i++)
+        fprintf(file, "%s\n", MakeWord(i).c_str());
+    fclose(file);
+
+    EnchantDict *dict = enchant_broker_request_pwl_dict(fixture._broker, filename.c_str());
+    std::vector<std::string> present, absent;
+    for (size_t i = 0; i < 1024; i++) {
+        present.push_back(MakeWord((i * 7919) % 10000));
+        absent.push_back(Misspell(present.back()));
+    }
+
+    std::vector<std::string> stats;
+    stats.push_back("pwl_file_polls");
+    Measure("pwl/10k/check", dict, present, stats,
+            [&] (const std::string& word) { Check(dict, word); });
+    Measure("pwl/10k/check_absent", dict, absent, stats,
+            [&] (const std::string& word) { Check(dict, word); });
+    stats.push_back("pwl_suggest_nodes");
+    Measure("pwl/10k/suggest", dict, std::vector<std::string>(absent.begin(), absent.begin() + 128), stats,
+            [&] (const std::string& word) { Suggest(dict, word); });
+
+    enchant_broker_free_dict(fixture._broker, dict);
+    EnchantTestFixture::DeleteFile(filename);
+}
+
+static std::map<std::string, double>
+ReadBaseline(const char *filename)
+{
+    std::map<std::string, double> baseline;
+    gchar *contents;
+    if (!g_file_get_contents(filename, &contents, NULL, NULL))
+        return baseline;
+
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    for (gchar **line = lines; *line; line++) {
+        gchar **fields = g_strsplit_set(g_strstrip(*line), " \t", 2);
+        if (fields[0] && fields[0][0] != '\0' && fields[0][0] != '#' && fields[1])
+            baseline[fields[0]] = g_ascii_strtod(fields[1], NULL);
+        g_strfreev(fields);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+    return baseline;
+}
+
+static const char baseline_header[] =
+    "# The counters of enchant_regress.cpp, per operation: \"make check\" fails\n"
+    "# when one of them comes out more than 10% above its figure here, or has\n"
+    "# none.  After a change that does more work for good reason, or less,\n"
+    "# record them again with \"make regress-baseline\" and commit the result.\n";
+
+static bool
+WriteBaseline(const char *filename)
+{
+    GString *contents = g_string_new(baseline_header);
+    for (std::map<std::string, double>::const_iterator it = measured.begin(); it != measured.end(); ++it) {
+        char value[G_ASCII_DTOSTR_BUF_SIZE];
+        g_string_append_printf(contents, "%s %s\n", it->first.c_str(),
+                               g_ascii_formatd(value, sizeof(value), "%.2f", it->second));
+    }
+    gboolean written = g_file_set_contents(filename, contents->str, contents->len, NULL);
+    g_string_free(contents, TRUE);
+    return written;
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *baseline_file = REGRESS_BASELINE;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (g_str_has_prefix(argv[i], "--baseline="))
+            baseline_file = argv[i] + strlen("--baseline=");
+        else if (strcmp(argv[i], "--update") == 0)
+            update = true;
+        else {
+            fprintf(stderr, "usage: %s [--baseline=FILE] [--update]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    enchant_set_prefix_dir(".");
+
+    MeasureMock();
+    MeasurePwl();
+
+    if (update) {
+        if (!WriteBaseline(baseline_file)) {
+            fprintf(stderr, "couldn't write %s\n", baseline_file);
+            return 1;
+        }
+        return 0;
+    }
+
+    // 77 tells the test harness the test was skipped
+    std::map<std::string, double> baseline = ReadBaseline(baseline_file);
+    if (baseline.empty()) {
+        printf("no figures in %s; run \"make regress-baseline\" and commit the result\n", baseline_file);
+        return 77;
+    }
+
+    int failures = 0;
+    for (std::map<std::string, double>::const_iterator it = measured.begin(); it != measured.end(); ++it) {
+        std::map<std::string, double>::const_iterator expected = baseline.find(it->first);
+        if (expected == baseline.end()) {
+            printf("%s: %.2f, not in %s; run \"make regress-baseline\" and commit the result\n",
+                   it->first.c_str(), it->second, baseline_file);
+            failures++;
+        } else if (it->second > expected->second * (1 + tolerance) + 0.005) {
+            printf("%s: %.2f, up from %.2f\n", it->first.c_str(), it->second, expected->second);
+            failures++;
+        } else if (it->second < expected->second * (1 - tolerance) - 0.005) {
+            printf("%s: %.2f, down from %.2f; run \"make regress-baseline\" to keep it there\n",
+                   it->first.c_str(), it->second, expected->second);
+        } else {
+            printf("%s: %.2f\n", it->first.c_str(), it->second);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include <vector>
+#include "EnchantBrokerTestFixture.h"
+
+struct LoadTimes
+{
+    std::string Name;
+    std::string DllFile;
+    int64_t Open, Init, Configure;
+};
+
+static void LoadTimesCallback (const char * const provider_name,
+                               const char * const provider_dll_file,
+                               int64_t open_us, int64_t init_us, int64_t configure_us,
+                               void * user_data)
+{
+    std::vector<LoadTimes>* loadTimes = reinterpret_cast<std::vector<LoadTimes>*>(user_data);
+    LoadTimes times = { provider_name ? provider_name : "", provider_dll_file,
+                        open_us, init_us, configure_us };
+    loadTimes->push_back(times);
+}
+
+static void LoadTimes_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->identify = MockProviderIdentify;
+     me->describe = MockProviderDescribe;
+}
+
+struct EnchantBrokerDescribeLoadTimes_TestFixture : EnchantBrokerTestFixture
+{
+    std::vector<LoadTimes> _loadTimes;
+
+    //Setup
+    EnchantBrokerDescribeLoadTimes_TestFixture():
+            EnchantBrokerTestFixture(LoadTimes_ProviderConfiguration)
+    { }
+
+    const LoadTimes* FindMock()
+    {
+        for (size_t i = 0; i < _loadTimes.size(); i++)
+            if (_loadTimes[i].Name == "mock")
+                return &_loadTimes[i];
+        return NULL;
+    }
+};
+
+/**
+ * enchant_broker_describe_load_times
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantLoadTimesFn
+ * @user_data: Optional user-data
+ *
+ * Tells how long loading each provider module @broker tried to load
+ * took.  Modules are loaded when they are first needed, so the ones
+ * not needed yet are left out; enchant_broker_describe loads them all.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_NothingLoadedYet_NothingTold)
+{
+    enchant_broker_describe_load_times(_broker, LoadTimesCallback, &_loadTimes);
+    CHECK_EQUAL((unsigned int)0, _loadTimes.size());
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_ProvidersLoaded_EachStepTimed)
+{
+    GetMockProvider();
+
+    enchant_broker_describe_load_times(_broker, LoadTimesCallback, &_loadTimes);
+    const LoadTimes* mock = FindMock();
+    CHECK(mock != NULL);
+    if (mock) {
+        CHECK(mock->DllFile.length());
+        CHECK(mock->Open >= 0);
+        CHECK(mock->Init >= 0);
+        CHECK(mock->Configure >= 0);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_DictionaryRequested_ItsProviderTold)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+
+    enchant_broker_describe_load_times(_broker, LoadTimesCallback, &_loadTimes);
+    CHECK(FindMock() != NULL);
+    if (dict)
+        FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_HasPreviousError_ErrorCleared)
+{
+    SetErrorOnMockProvider("something bad happened");
+
+    enchant_broker_describe_load_times(_broker, LoadTimesCallback, &_loadTimes);
+
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_get_error(_broker));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_NullBroker_DoNothing)
+{
+    enchant_broker_describe_load_times(NULL, LoadTimesCallback, &_loadTimes);
+    CHECK_EQUAL((unsigned int)0, _loadTimes.size());
+}
+
+TEST_FIXTURE(EnchantBrokerDescribeLoadTimes_TestFixture,
+             EnchantBrokerDescribeLoadTimes_NullCallback_DoNothing)
+{
+    GetMockProvider();
+    enchant_broker_describe_load_times(_broker, NULL, &_loadTimes);
+}
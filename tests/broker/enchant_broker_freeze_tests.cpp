@@ -0,0 +1,129 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+#include <algorithm>
+
+struct EnchantBrokerFreeze_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantBrokerFreeze_TestFixture():
+            EnchantDictionaryTestFixture(EmptyDictionary_ProviderConfiguration)
+    { }
+
+    bool IsSuggested(const std::string& misspelling, const std::string& word)
+    {
+        std::vector<std::string> suggs = GetSuggestionsFromWord(misspelling);
+        return std::find(suggs.begin(), suggs.end(), word) != suggs.end();
+    }
+};
+
+/**
+ * enchant_broker_freeze
+ * @broker: A non-null #EnchantBroker
+ *
+ * Gets the dictionaries @broker has loaded ready for a process about to
+ * fork workers, so that the workers keep sharing their memory rather
+ * than each copying the pages it touches.
+ *
+ * Dictionaries loaded afterwards are not frozen.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_WordsAdded_StillFound)
+{
+    AddWordToDictionary("hello");
+    AddWordToDictionary("world");
+
+    enchant_broker_freeze(_broker);
+
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+    CHECK(!IsWordInDictionary("helo"));
+    CHECK(IsSuggested("helo", "hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_WordsInFile_StillFound)
+{
+    ExternalAddWordToDictionary("hello");
+
+    enchant_broker_freeze(_broker);
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_FileChangedExternally_NotSeen)
+{
+    enchant_broker_freeze(_broker);
+    ExternalAddWordToDictionary("hello");
+
+    CHECK(!IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_WordAddedAfterwards_FoundAndWritten)
+{
+    AddWordToDictionary("hello");
+    enchant_broker_freeze(_broker);
+
+    AddWordToDictionary("world");
+    RemoveWordFromDictionary("hello");
+    CHECK(IsWordInDictionary("world"));
+    CHECK(!IsWordInDictionary("hello"));
+    CHECK(IsSuggested("wrld", "world"));
+
+    ReloadTestDictionary();
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_WriteBehind_PendingWordsWritten)
+{
+    enchant_broker_set_write_behind(_broker, 1);
+    AddWordToDictionary("hello");
+
+    enchant_broker_freeze(_broker);
+    CHECK(PersonalWordListFileHasContents());
+}
+
+TEST_FIXTURE(EnchantBrokerFreeze_TestFixture,
+             EnchantBrokerFreeze_Twice_WordsStillFound)
+{
+    AddWordToDictionary("hello");
+
+    enchant_broker_freeze(_broker);
+    enchant_broker_freeze(_broker);
+
+    CHECK(IsWordInDictionary("hello"));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST(EnchantBrokerFreeze_NullBroker_DoNothing)
+{
+    enchant_broker_freeze(NULL);
+}
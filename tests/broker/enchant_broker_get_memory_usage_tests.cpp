@@ -0,0 +1,140 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <map>
+
+static size_t
+MockDictionaryGetMemoryUsage (EnchantDict *)
+{
+    return 1000;
+}
+
+static EnchantDict*
+MockProviderRequestMemoryDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        dict->get_memory_usage = MockDictionaryGetMemoryUsage;
+    return dict;
+}
+
+static void GetMemoryUsage_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestMemoryDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectMemory (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *usage = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*usage)[name] = value;
+}
+
+struct EnchantBrokerGetMemoryUsage_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerGetMemoryUsage_TestFixture():
+            EnchantBrokerTestFixture(GetMemoryUsage_ProviderConfiguration)
+    { }
+
+    std::map<std::string, uint64_t> GetMemoryUsage()
+    {
+        std::map<std::string, uint64_t> usage;
+        enchant_broker_get_memory_usage(_broker, CollectMemory, &usage);
+        return usage;
+    }
+};
+
+/**
+ * enchant_broker_get_memory_usage
+ * @broker: A non-null #EnchantBroker
+ * @fn: An optional #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Estimates the memory taken up by the dictionaries @broker has loaded,
+ * reporting the figures of enchant_dict_get_memory_usage to @fn if given.
+ *
+ * Returns: the estimate, in bytes
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerGetMemoryUsage_TestFixture,
+             EnchantBrokerGetMemoryUsage_NoDictionaries_0)
+{
+    std::map<std::string, uint64_t> usage = GetMemoryUsage();
+    CHECK(!usage.empty());
+    CHECK_EQUAL(0, enchant_broker_get_memory_usage(_broker, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantBrokerGetMemoryUsage_TestFixture,
+             EnchantBrokerGetMemoryUsage_TwoDictionaries_Added)
+{
+    EnchantDict* enGb = RequestDictionary("en_GB");
+    EnchantDict* qaa = RequestDictionary("qaa");
+
+    CHECK_EQUAL(2000, GetMemoryUsage()["provider"]);
+    CHECK_EQUAL(enchant_dict_get_memory_usage(enGb, NULL, NULL) +
+                enchant_dict_get_memory_usage(qaa, NULL, NULL),
+                enchant_broker_get_memory_usage(_broker, NULL, NULL));
+
+    FreeDictionary(enGb);
+    FreeDictionary(qaa);
+}
+
+TEST_FIXTURE(EnchantBrokerGetMemoryUsage_TestFixture,
+             EnchantBrokerGetMemoryUsage_DictionaryFreed_NotCounted)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    FreeDictionary(dict);
+
+    CHECK_EQUAL(0, enchant_broker_get_memory_usage(_broker, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantBrokerGetMemoryUsage_TestFixture,
+             EnchantBrokerGetMemoryUsage_OverlayDictionary_BaseCountedOnce)
+{
+    EnchantDict* base = RequestDictionary("en_GB");
+    EnchantDict* overlay = enchant_broker_request_overlay_dict(_broker, "en_GB", GetTempUserEnchantDir().c_str());
+    CHECK(overlay);
+
+    std::map<std::string, uint64_t> usage;
+    enchant_dict_get_memory_usage(overlay, CollectMemory, &usage);
+    CHECK_EQUAL(1000, usage["provider"]);
+    CHECK_EQUAL(1000, GetMemoryUsage()["provider"]);
+
+    FreeDictionary(overlay);
+    FreeDictionary(base);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerGetMemoryUsage_TestFixture,
+             EnchantBrokerGetMemoryUsage_NullBroker_0)
+{
+    std::map<std::string, uint64_t> usage;
+    CHECK_EQUAL(0, enchant_broker_get_memory_usage(NULL, CollectMemory, &usage));
+    CHECK(usage.empty());
+}
@@ -0,0 +1,135 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <map>
+
+static void GetStats_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockEnGbAndQaaProviderRequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectStats (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *stats = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*stats)[name] = value;
+}
+
+struct EnchantBrokerGetStats_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerGetStats_TestFixture():
+            EnchantBrokerTestFixture(GetStats_ProviderConfiguration)
+    { }
+
+    std::map<std::string, uint64_t> GetStats()
+    {
+        std::map<std::string, uint64_t> stats;
+        enchant_broker_get_stats(_broker, CollectStats, &stats);
+        return stats;
+    }
+
+    void CheckInSession(EnchantDict* dict, const char* word)
+    {
+        enchant_dict_add_to_session(dict, word, -1);
+        enchant_dict_check(dict, word, -1);
+    }
+};
+
+/**
+ * enchant_broker_get_stats
+ * @broker: A non-null #EnchantBroker
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports the counters of enchant_dict_get_stats added up over all the
+ * dictionaries @broker has handed out, those since freed included.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_NoDictionaries_AllZero)
+{
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK(!stats.empty());
+    CHECK_EQUAL(0, stats["checks"]);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_TwoDictionaries_Added)
+{
+    EnchantDict* enGb = RequestDictionary("en_GB");
+    EnchantDict* qaa = RequestDictionary("qaa");
+    CheckInSession(enGb, "hello");
+    CheckInSession(qaa, "hello");
+    CheckInSession(qaa, "world");
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(3, stats["checks"]);
+    CHECK_EQUAL(3, stats["checks_session"]);
+
+    FreeDictionary(enGb);
+    FreeDictionary(qaa);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_DictionaryFreed_StillCounted)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    CheckInSession(dict, "hello");
+    FreeDictionary(dict);
+
+    CHECK_EQUAL(1, GetStats()["checks"]);
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_CompositeDictionary_CountedByMembers)
+{
+    EnchantDict* dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    CHECK(dict);
+    enchant_dict_check(dict, "hello", -1);
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(2, stats["checks"]);
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_NullBroker_DoNothing)
+{
+    std::map<std::string, uint64_t> stats;
+    enchant_broker_get_stats(NULL, CollectStats, &stats);
+    CHECK(stats.empty());
+}
+
+TEST_FIXTURE(EnchantBrokerGetStats_TestFixture,
+             EnchantBrokerGetStats_NullFn_DoNothing)
+{
+    enchant_broker_get_stats(_broker, NULL, NULL);
+}
@@ -130,6 +130,49 @@ struct EnchantBrokerListDictionaries_ProviderDuplicateTags_TestFixture : Enchant
     { }
 };
 
+static int listDictionariesCount;
+static char** CountingListDictionaries (EnchantProvider * me, size_t * out_n_dicts)
+{
+    listDictionariesCount++;
+    return MockEnGbProviderListDictionaries(me, out_n_dicts);
+}
+
+static bool dictionaryExistsCalled;
+static int DictionaryExists (EnchantProvider *, const char *const)
+{
+    dictionaryExistsCalled = true;
+    return 0;
+}
+
+static std::string dictionaryDir;
+static char** ListDictionaryDirs (EnchantProvider *, size_t * out_n_dirs)
+{
+    *out_n_dirs = 1;
+    char** out_list = g_new0 (char *, *out_n_dirs + 1);
+    out_list[0] = g_strdup (dictionaryDir.c_str());
+
+    return out_list;
+}
+
+static void List_Dictionaries_ProviderConfigurationWithDirs (EnchantProvider * me, const char *)
+{
+     me->list_dicts=CountingListDictionaries;
+     me->list_dict_dirs=ListDictionaryDirs;
+     me->dictionary_exists=DictionaryExists;
+}
+
+struct EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture : EnchantBrokerListDictionaries_TestFixtureBase
+{
+    //Setup
+    EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture():
+            EnchantBrokerListDictionaries_TestFixtureBase(List_Dictionaries_ProviderConfigurationWithDirs)
+    {
+        listDictionariesCount = 0;
+        dictionaryExistsCalled = false;
+        dictionaryDir = AddToPath(GetTempUserEnchantDir(), "mock");
+    }
+};
+
 /**
  * enchant_broker_list_dicts
  * @broker: A non-null #EnchantBroker
@@ -225,3 +268,50 @@ TEST_FIXTURE(EnchantBrokerListDictionaries_ProviderReturnsInvalidTag_TestFixture
     enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
     CHECK_EQUAL((unsigned int)1, _dictionaryList.size());
 }
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Inventory
+TEST_FIXTURE(EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture,
+             EnchantBrokerListDictionaries_ListedTwice_ProviderListsOnce)
+{
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    CHECK_EQUAL(1, listDictionariesCount);
+    CHECK_EQUAL((unsigned int)2, _dictionaryList.size());
+    if(_dictionaryList.size()==2){
+        CHECK_EQUAL(std::string("en_GB"), _dictionaryList[1].LanguageTag);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture,
+             EnchantBrokerListDictionaries_DirectoryChanged_ProviderListsAgain)
+{
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    CreateDirectory(dictionaryDir);
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    CHECK_EQUAL(2, listDictionariesCount);
+}
+
+TEST_FIXTURE(EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture,
+             EnchantBrokerListDictionaries_NewBroker_SavedInventoryUsed)
+{
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    enchant_broker_free(_broker);
+    InitializeBroker();
+
+    _dictionaryList.clear();
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    CHECK_EQUAL(1, listDictionariesCount);
+    CHECK_EQUAL((unsigned int)1, _dictionaryList.size());
+    if(_dictionaryList.size()==1){
+        CHECK_EQUAL(std::string("en_GB"), _dictionaryList[0].LanguageTag);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerListDictionaries_ProviderListsDirs_TestFixture,
+             EnchantBrokerListDictionaries_DictExistsAfterListing_ProviderNotAsked)
+{
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeCallback, &_dictionaryList);
+    CHECK(enchant_broker_dict_exists(_broker, "en_GB"));
+    CHECK(!dictionaryExistsCalled);
+}
@@ -0,0 +1,168 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static gint requestDictionaryCount;
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    g_atomic_int_inc(&requestDictionaryCount);
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static gint disposeDictionaryCount;
+static void DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    g_atomic_int_inc(&disposeDictionaryCount);
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Preload_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+static gint preloadedCount;
+static gint foundCount;
+static void Preloaded (const char * const, int found, void *)
+{
+    if (found)
+        g_atomic_int_inc(&foundCount);
+    g_atomic_int_inc(&preloadedCount);
+}
+
+struct EnchantBrokerPreload_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerPreload_TestFixture():
+            EnchantBrokerTestFixture(Preload_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        preloadedCount = 0;
+        foundCount = 0;
+    }
+
+    void Preload(const char * tag1, const char * tag2 = NULL)
+    {
+        const char * tags[] = { tag1, tag2 };
+        size_t n = tag2 ? 2 : 1;
+        enchant_broker_preload(_broker, tags, n, Preloaded, NULL);
+        for (int i = 0; i < 1000 && g_atomic_int_get(&preloadedCount) < (gint)n; i++)
+            g_usleep(10000);
+    }
+};
+
+/**
+ * enchant_broker_preload
+ * @broker: A non-null #EnchantBroker
+ * @tags: The language tags to load dictionaries for, as enchant_broker_request_dict takes them
+ * @n_tags: The number of tags in @tags
+ * @fn: Optional, an #EnchantPreloadFn
+ * @user_data: Optional user-data
+ *
+ * Loads the dictionaries for @tags on background threads, so that
+ * requesting them later takes no time; a request for one still being
+ * loaded waits for it rather than loading it again.  @broker keeps
+ * each dictionary loaded until its first request takes it over, and
+ * freeing @broker waits for the loads still going.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_ThenRequested_ProviderAskedOnce)
+{
+    Preload("en_GB");
+    EnchantDict* dict = RequestDictionary("en_GB");
+    CHECK(dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_CallbackToldWhetherFound)
+{
+    Preload("en_GB", "zz");
+    CHECK_EQUAL(2, preloadedCount);
+    CHECK_EQUAL(1, foundCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_RequestedAndFreed_Disposed)
+{
+    Preload("en_GB");
+    FreeDictionary(RequestDictionary("en_GB"));
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_PreloadedTwice_DisposedOnceFreed)
+{
+    Preload("en_GB");
+    Preload("en_GB");
+    FreeDictionary(RequestDictionary("en_GB"));
+    CHECK_EQUAL(1, disposeDictionaryCount);
+    CHECK_EQUAL(1, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_NeverRequested_DisposedWithBroker)
+{
+    Preload("en_GB");
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_BrokerFreedRightAway_PreloadFinishes)
+{
+    const char * tags[] = { "en_GB", "qaa" };
+    enchant_broker_preload(_broker, tags, 2, Preloaded, NULL);
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(2, preloadedCount);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_NullBroker_DoNothing)
+{
+    const char * tags[] = { "en_GB" };
+    enchant_broker_preload(NULL, tags, 1, Preloaded, NULL);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerPreload_TestFixture,
+             EnchantBrokerPreload_NullTags_DoNothing)
+{
+    enchant_broker_preload(_broker, NULL, 1, Preloaded, NULL);
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
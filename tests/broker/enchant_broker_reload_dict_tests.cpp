@@ -0,0 +1,271 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int requestDictionaryCount;
+static int disposeDictionaryCount;
+static int dictCheckCount;
+static int addToSessionCount;
+static bool newWordInstalled;
+static bool failRequests;
+
+// "hello" is in every dictionary, "newword" in those loaded once it is
+// installed
+static int
+MockDictionaryCheck (EnchantDict * me, const char *const word, size_t len)
+{
+    dictCheckCount++;
+    std::string w(word, len);
+    if (w == "hello")
+        return 0;
+    if (w == "newword" && me->user_data != NULL)
+        return 0;
+    return 1;
+}
+
+static void
+MockDictionaryAddToSession (EnchantDict *, const char *const, size_t)
+{
+    addToSessionCount++;
+}
+
+// '#' is a word character in dictionaries loaded once the new word is
+// installed
+static int
+MockDictionaryIsWordCharacter (EnchantDict * me, uint32_t uc, size_t)
+{
+    if (uc == '#')
+        return me->user_data != NULL;
+    return g_unichar_isalnum(uc);
+}
+
+static EnchantDict *
+RequestDictionary (EnchantProvider * me, const char *tag)
+{
+    if (failRequests)
+        return NULL;
+    requestDictionaryCount++;
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->user_data = newWordInstalled ? GINT_TO_POINTER(1) : NULL;
+    dict->check = MockDictionaryCheck;
+    dict->add_to_session = MockDictionaryAddToSession;
+    dict->is_word_character = MockDictionaryIsWordCharacter;
+    return dict;
+}
+
+static void
+DisposeDictionary (EnchantProvider * me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void ReloadDict_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerReloadDict_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantBrokerReloadDict_TestFixture():
+            EnchantDictionaryTestFixture(ReloadDict_ProviderConfiguration)
+    {
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+        dictCheckCount = 0;
+        addToSessionCount = 0;
+    }
+
+    //Teardown
+    ~EnchantBrokerReloadDict_TestFixture()
+    {
+        newWordInstalled = false;
+        failRequests = false;
+    }
+};
+
+/**
+ * enchant_broker_reload_dict
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag of a dictionary loaded before
+ *
+ * Loads again, from its provider, the dictionary
+ * enchant_broker_request_dict would hand out for @tag, say once its
+ * files are updated, and puts it in place of the one the handles given
+ * out point to.
+ *
+ * Returns: 1 if it was reloaded, 0 if no dictionary for @tag is loaded
+ * from a provider, -1 on failure, with the old one kept
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_Loaded_HandleChecksWithNewDictionary)
+{
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "newword", -1));
+
+    newWordInstalled = true;
+    CHECK_EQUAL(1, enchant_broker_reload_dict(_broker, "qaa"));
+    CHECK_EQUAL(1, requestDictionaryCount);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "newword", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_Loaded_OldDictionaryDisposed)
+{
+    enchant_broker_reload_dict(_broker, "qaa");
+    CHECK_EQUAL(1, disposeDictionaryCount);
+
+    FreeDictionary(_dict);
+    _dict = NULL;
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_Loaded_RequestedAgainSameHandle)
+{
+    enchant_broker_reload_dict(_broker, "qaa");
+
+    EnchantDict* dict = RequestDictionary("qaa");
+    CHECK_EQUAL(_dict, dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_CheckCache_VerdictsWorkedOutAgain)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "newword", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(2, dictCheckCount);
+
+    newWordInstalled = true;
+    enchant_broker_reload_dict(_broker, "qaa");
+    CHECK_EQUAL(4, dictCheckCount);
+
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "newword", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(4, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_SessionWords_KeptAndPassedOn)
+{
+    enchant_dict_add_to_session(_dict, "sessionword", -1);
+    CHECK_EQUAL(1, addToSessionCount);
+
+    enchant_broker_reload_dict(_broker, "qaa");
+    CHECK_EQUAL(2, addToSessionCount);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "sessionword", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_PersonalWords_Kept)
+{
+    AddWordToDictionary("personalword");
+
+    enchant_broker_reload_dict(_broker, "qaa");
+    CHECK(IsWordInDictionary("personalword"));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_WordCharacters_WorkedOutAgain)
+{
+    CHECK_EQUAL(0, enchant_dict_is_word_character(_dict, '#', 1));
+
+    newWordInstalled = true;
+    enchant_broker_reload_dict(_broker, "qaa");
+    CHECK_EQUAL(1, enchant_dict_is_word_character(_dict, '#', 1));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_WordCharacterTable_OldOneKept)
+{
+    const uint8_t *old_table = enchant_dict_get_word_character_table(_dict);
+
+    newWordInstalled = true;
+    enchant_broker_reload_dict(_broker, "qaa");
+    const uint8_t *table = enchant_dict_get_word_character_table(_dict);
+    CHECK(table != old_table);
+    CHECK_EQUAL(0, old_table['#'] & 2);
+    CHECK_EQUAL(2, table['#'] & 2);
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_DifferentCaseTag_Reloaded)
+{
+    newWordInstalled = true;
+    CHECK_EQUAL(1, enchant_broker_reload_dict(_broker, "QAA"));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "newword", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_NotLoaded_Zero)
+{
+    CHECK_EQUAL(0, enchant_broker_reload_dict(_broker, "en_GB"));
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_ProviderFails_OldDictionaryKept)
+{
+    newWordInstalled = true;
+    failRequests = true;
+    CHECK_EQUAL(-1, enchant_broker_reload_dict(_broker, "qaa"));
+    CHECK(enchant_broker_get_error(_broker) != NULL);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "newword", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_InvalidTag_Error)
+{
+    CHECK_EQUAL(-1, enchant_broker_reload_dict(_broker, "en~US"));
+    CHECK(enchant_broker_get_error(_broker) != NULL);
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_NullTag_Error)
+{
+    CHECK_EQUAL(-1, enchant_broker_reload_dict(_broker, NULL));
+}
+
+TEST_FIXTURE(EnchantBrokerReloadDict_TestFixture,
+             EnchantBrokerReloadDict_EmptyTag_Error)
+{
+    CHECK_EQUAL(-1, enchant_broker_reload_dict(_broker, ""));
+}
+
+TEST(EnchantBrokerReloadDict_NullBroker_Error)
+{
+    CHECK_EQUAL(-1, enchant_broker_reload_dict(NULL, "qaa"));
+}
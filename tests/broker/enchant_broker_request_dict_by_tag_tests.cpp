@@ -0,0 +1,270 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount;
+static EnchantDict * RequestDictionaryByTag (EnchantProvider *me, const char *tag)
+{
+    requestDictionaryCount++;
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static int disposeDictionaryCount;
+static void DisposeDictionaryByTag (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void RequestDictByTag_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionaryByTag;
+     me->dispose_dict = DisposeDictionaryByTag;
+}
+
+struct EnchantBrokerRequestDictByTag_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestDictByTag_TestFixture():
+            EnchantBrokerTestFixture(RequestDictByTag_ProviderConfiguration)
+    { 
+        _dict = NULL;
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+    }
+
+    //Teardown
+    ~EnchantBrokerRequestDictByTag_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    EnchantDict* _dict;
+};
+
+/**
+ * enchant_broker_intern_tag
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request dictionaries for ("en_US", "de_DE", ...)
+ *
+ * Resolves @tag once, as enchant_broker_request_dict would, for
+ * requesting its dictionary again and again with
+ * enchant_broker_request_dict_by_tag.  Interning the same tag, or one
+ * written differently that names the same language ("en-us",
+ * "en_US.UTF-8"), returns the same #EnchantTag.
+ *
+ * Returns: An #EnchantTag, owned by @broker and valid until it is
+ * freed, or %null if @tag is not a valid language tag
+ *
+ * enchant_broker_request_dict_by_tag
+ * @broker: A non-null #EnchantBroker
+ * @tag: A non-null #EnchantTag interned by @broker
+ *
+ * Like enchant_broker_request_dict(), but while the dictionary last
+ * returned for @tag is loaded, it is returned again without the tag
+ * being normalized or looked up, nor anything allocated.  A tag for
+ * which only the dictionary of its language alone was found keeps
+ * getting that one while it is loaded, until enchant_broker_rescan is
+ * called.
+ *
+ * Returns: An #EnchantDict, or %null if no suitable dictionary could be found. This dictionary is reference counted.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_SameTagTwice_SameHandle)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    CHECK(tag);
+    CHECK_EQUAL(tag, enchant_broker_intern_tag(_broker, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_WrittenDifferently_SameHandle)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    CHECK_EQUAL(tag, enchant_broker_intern_tag(_broker, "en-gb"));
+    CHECK_EQUAL(tag, enchant_broker_intern_tag(_broker, "en_GB.UTF-8"));
+    CHECK(tag != enchant_broker_intern_tag(_broker, "en"));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_NothingLoaded)
+{
+    CHECK(enchant_broker_intern_tag(_broker, "en_GB"));
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_ProviderHas_SameAsRequestDict)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK(_dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK_EQUAL(_dict, dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_CalledTwice_CallsProviderOnceReturnsSame)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    EnchantDict* dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK_EQUAL(_dict, dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+
+    // each request holds its own reference
+    FreeDictionary(dict);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_RequestedByNameFirst_ReturnsSame)
+{
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    EnchantDict* dict = enchant_broker_request_dict_by_tag(_broker, enchant_broker_intern_tag(_broker, "en_GB"));
+    CHECK_EQUAL(_dict, dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_OnlyLanguageHad_FallsBackToIt)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "qaa_CA");
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK(_dict);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK_EQUAL(_dict, dict);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_FreedAndRequestedAgain_LoadedAgain)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    FreeDictionary(enchant_broker_request_dict_by_tag(_broker, tag));
+    CHECK_EQUAL(1, disposeDictionaryCount);
+
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK(_dict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_Pooled_ReturnsSameWithoutLoading)
+{
+    enchant_broker_set_dict_pool(_broker, 1, -1);
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    EnchantDict* dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    FreeDictionary(dict);
+
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK_EQUAL(dict, _dict);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_PoolTrimmed_LoadedAgain)
+{
+    enchant_broker_set_dict_pool(_broker, 1, -1);
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    FreeDictionary(enchant_broker_request_dict_by_tag(_broker, tag));
+    enchant_broker_set_dict_pool(_broker, 0, -1);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK(_dict);
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_Rescanned_LooksAgain)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "qaa_CA");
+    _dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    int count = requestDictionaryCount;
+
+    EnchantDict* dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK_EQUAL(count, requestDictionaryCount);
+    FreeDictionary(dict);
+
+    enchant_broker_rescan(_broker);
+    dict = enchant_broker_request_dict_by_tag(_broker, tag);
+    CHECK_EQUAL(_dict, dict);
+    CHECK(requestDictionaryCount > count);
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_InvalidTag_NullAndErrorSet)
+{
+    CHECK_EQUAL((EnchantTag*)NULL, enchant_broker_intern_tag(_broker, "en~GB"));
+    CHECK(enchant_broker_get_error(_broker));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_NullBroker_Null)
+{
+    CHECK_EQUAL((EnchantTag*)NULL, enchant_broker_intern_tag(NULL, "en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerInternTag_NullOrEmptyTag_Null)
+{
+    CHECK_EQUAL((EnchantTag*)NULL, enchant_broker_intern_tag(_broker, NULL));
+    CHECK_EQUAL((EnchantTag*)NULL, enchant_broker_intern_tag(_broker, ""));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_ProviderDoesNotHave_Null)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "de_DE");
+    CHECK_EQUAL((EnchantDict*)NULL, enchant_broker_request_dict_by_tag(_broker, tag));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_NullBroker_Null)
+{
+    EnchantTag* tag = enchant_broker_intern_tag(_broker, "en_GB");
+    CHECK_EQUAL((EnchantDict*)NULL, enchant_broker_request_dict_by_tag(NULL, tag));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictByTag_TestFixture,
+             EnchantBrokerRequestDictByTag_NullTag_Null)
+{
+    CHECK_EQUAL((EnchantDict*)NULL, enchant_broker_request_dict_by_tag(_broker, NULL));
+}
@@ -24,14 +24,18 @@
 #include "EnchantBrokerTestFixture.h"
 
 static bool requestDictionaryCalled;
+static gint requestDictionaryCount;
 static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
 {
     requestDictionaryCalled = true;
+    g_atomic_int_inc(&requestDictionaryCount);
     return MockEnGbAndQaaProviderRequestDictionary(me, tag);
 }
 
+static int providerConfiguredCount;
 static void Request_Dictionary_ProviderConfiguration (EnchantProvider * me, const char *)
 {
+     providerConfiguredCount++;
      me->request_dict = RequestDictionary;
      me->dispose_dict = MockProviderDisposeDictionary;
 }
@@ -44,6 +48,7 @@ struct EnchantBrokerRequestDictionary_TestFixture : EnchantBrokerTestFixture
     { 
         _dict = NULL;
         requestDictionaryCalled = false;
+        requestDictionaryCount = 0;
     }
 
     //Teardown
@@ -55,6 +60,34 @@ struct EnchantBrokerRequestDictionary_TestFixture : EnchantBrokerTestFixture
     EnchantDict* _dict;
 };
 
+static std::string dictionaryDir;
+static char** ListDictionaryDirs (EnchantProvider *, size_t * out_n_dirs)
+{
+    *out_n_dirs = 1;
+    char** out_list = g_new0 (char *, *out_n_dirs + 1);
+    out_list[0] = g_strdup (dictionaryDir.c_str());
+
+    return out_list;
+}
+
+static void Request_Dictionary_ProviderConfigurationWithDirs (EnchantProvider * me, const char * dir_name)
+{
+     Request_Dictionary_ProviderConfiguration(me, dir_name);
+     me->list_dict_dirs = ListDictionaryDirs;
+}
+
+struct EnchantBrokerRequestDictionary_ProviderListsDirs_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestDictionary_ProviderListsDirs_TestFixture():
+            EnchantBrokerTestFixture(Request_Dictionary_ProviderConfigurationWithDirs)
+    { 
+        requestDictionaryCount = 0;
+        dictionaryDir = AddToPath(GetTempUserEnchantDir(), "mock");
+        GetMockProvider();
+    }
+};
+
 /**
  * enchant_broker_request_dict
  * @broker: A non-null #EnchantBroker
@@ -76,6 +109,23 @@ TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture,
     CHECK(requestDictionaryCalled);
 }
 
+TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
+             EnchantBrokerRequestDictionary_ProviderLoadedOnFirstRequestOnly)
+{
+    enchant_broker_free(_broker);
+    providerConfiguredCount = 0;
+    InitializeBroker();
+    CHECK_EQUAL(0, providerConfiguredCount);
+
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(_dict);
+    CHECK_EQUAL(1, providerConfiguredCount);
+
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "qaa");
+    CHECK_EQUAL(1, providerConfiguredCount);
+    FreeDictionary(dict);
+}
+
 TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
              EnchantBrokerRequestDictionary_CalledTwice_CallsProviderOnceReturnsSame)
 {
@@ -87,6 +137,29 @@ TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture,
     CHECK_EQUAL(_dict, dict);
 }
 
+static gpointer RequestEnGbOnOtherThread(gpointer broker)
+{
+    return enchant_broker_request_dict((EnchantBroker*)broker, "en_GB");
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
+             EnchantBrokerRequestDictionary_CalledFromSeveralThreads_CallsProviderOnceReturnsSame)
+{
+    GThread* threads[8];
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        threads[i] = g_thread_new("request", RequestEnGbOnOtherThread, _broker);
+
+    _dict = (EnchantDict*)g_thread_join(threads[0]);
+    CHECK(_dict);
+    for (size_t i = 1; i < G_N_ELEMENTS(threads); i++)
+        {
+            EnchantDict* dict = (EnchantDict*)g_thread_join(threads[i]);
+            CHECK_EQUAL(_dict, dict);
+            enchant_broker_free_dict(_broker, dict);
+        }
+    CHECK_EQUAL(1, requestDictionaryCount);
+}
+
 TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
              EnchantBrokerRequestDictionary_ProviderDoesNotHave_CallsProvider)
 {
@@ -174,6 +247,68 @@ TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture,
   CHECK_EQUAL((void*)NULL, (void*)enchant_broker_get_error(_broker));
 }
 
+TEST_FIXTURE(EnchantBrokerRequestDictionary_ProviderListsDirs_TestFixture, 
+             EnchantBrokerRequestDictionary_ProviderDoesNotHaveTwice_CallsProviderOnce)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_dict(_broker, "en_US"));
+    CHECK_EQUAL(2, requestDictionaryCount); // en_US, then en
+
+    requestDictionaryCount = 0;
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_dict(_broker, "en_US"));
+    CHECK_EQUAL(0, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionary_ProviderListsDirs_TestFixture, 
+             EnchantBrokerRequestDictionary_ProviderDoesNotHaveThenDirectoryChanges_CallsProviderAgain)
+{
+    enchant_broker_request_dict(_broker, "en_US");
+    CreateDirectory(dictionaryDir);
+
+    requestDictionaryCount = 0;
+    enchant_broker_request_dict(_broker, "en_US");
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
+             EnchantBrokerRequestDictionary_ProviderDoesNotHaveTwiceAndListsNoDirs_CallsProviderTwice)
+{
+    GetMockProvider();
+    enchant_broker_request_dict(_broker, "en_US");
+    enchant_broker_request_dict(_broker, "en_US");
+    CHECK_EQUAL(4, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
+             EnchantBrokerRequestDictionary_WordListsNotCreatedUntilWordAdded)
+{
+    std::string personal = AddToPath(GetTempUserEnchantDir(), "en_GB.dic");
+    std::string exclude = AddToPath(GetTempUserEnchantDir(), "en_GB.exc");
+
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(_dict);
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK(!FileExists(personal));
+    CHECK(!FileExists(exclude));
+
+    enchant_dict_add(_dict, "hello", -1);
+    CHECK(FileExists(personal));
+    CHECK(!FileExists(exclude));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestDictionary_TestFixture, 
+             EnchantBrokerRequestDictionary_NoConfigDir_CreatedWhenWordAdded)
+{
+    DeleteDirAndFiles(GetTempUserEnchantDir());
+
+    _dict = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK(_dict);
+    CHECK(!FileExists(GetTempUserEnchantDir()));
+
+    enchant_dict_add(_dict, "hello", -1);
+    CHECK(FileExists(AddToPath(GetTempUserEnchantDir(), "en_GB.dic")));
+}
+
 // ordering of providers for request is tested by enchant_broker_set_ordering tests
 
 /////////////////////////////////////////////////////////////////////////////
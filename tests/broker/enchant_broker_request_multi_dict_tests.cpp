@@ -0,0 +1,293 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <vector>
+
+static int checkCount;
+static int MockDictionaryCheck (EnchantDict * me, const char *const word, size_t len)
+{
+    checkCount++;
+    std::string accepted = strcmp((const char *) me->user_data, "en_GB") == 0 ? "hello" : "qaaword";
+    return std::string(word, len) == accepted ? 0 : 1;
+}
+
+static char ** MockDictionarySuggest (EnchantDict * me, const char *const, size_t, size_t * out_n_suggs)
+{
+    char **suggs;
+    if (strcmp((const char *) me->user_data, "en_GB") == 0)
+        {
+            *out_n_suggs = 1;
+            suggs = g_new0 (char *, 2);
+            suggs[0] = g_strdup ("hello");
+        }
+    else
+        {
+            *out_n_suggs = 2;
+            suggs = g_new0 (char *, 3);
+            suggs[0] = g_strdup ("qaaword");
+            suggs[1] = g_strdup ("hello");
+        }
+    return suggs;
+}
+
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        {
+            dict->user_data = (void *) (strcmp(tag, "en_GB") == 0 ? "en_GB" : "qaa");
+            dict->check = MockDictionaryCheck;
+            dict->suggest = MockDictionarySuggest;
+        }
+    return dict;
+}
+
+static int disposeDictionaryCount;
+static void DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Multi_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+static GMutex asyncLock;
+static GCond asyncCond;
+static bool asyncCalled;
+static std::vector<std::string> asyncSuggs;
+
+static void AsyncSuggestCallback (EnchantDict * dict, char **suggs, size_t n_suggs, void *)
+{
+    g_mutex_lock(&asyncLock);
+    asyncSuggs.assign(suggs, suggs + (suggs ? n_suggs : 0));
+    asyncCalled = true;
+    g_cond_broadcast(&asyncCond);
+    g_mutex_unlock(&asyncLock);
+    enchant_dict_free_string_list(dict, suggs);
+}
+
+struct EnchantBrokerRequestMultiDictionary_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestMultiDictionary_TestFixture():
+            EnchantBrokerTestFixture(Multi_ProviderConfiguration)
+    { 
+        _dict = NULL;
+        checkCount = 0;
+        disposeDictionaryCount = 0;
+    }
+
+    //Teardown
+    ~EnchantBrokerRequestMultiDictionary_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    std::vector<std::string> Suggest(const std::string & word)
+    {
+        size_t n_suggs;
+        char ** suggs = enchant_dict_suggest(_dict, word.c_str(), word.size(), &n_suggs);
+        std::vector<std::string> result(suggs, suggs + n_suggs);
+        enchant_dict_free_string_list(_dict, suggs);
+        return result;
+    }
+
+    EnchantDict* _dict;
+};
+
+/**
+ * enchant_broker_request_multi_dict
+ * @broker: A non-null #EnchantBroker
+ * @tags: A non-null, comma-separated list of language tags ("en_US,de_DE", ...)
+ *
+ * Requests a dictionary made of the dictionaries for each of @tags, for text
+ * in more than one language.  It accepts a word any of them accepts, asking
+ * them in the order given, and suggests what all of them suggest, their best
+ * suggestions first.
+ *
+ * Returns: A new #EnchantDict on every call, or %null if there is no dictionary
+ * for one of @tags.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_AnyMemberAccepts_Accepted)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    CHECK(_dict);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "qaaword", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_FirstMemberAccepts_OthersNotAsked)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(1, checkCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_CheckBatch_AnyMemberAccepts)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    const char *words[] = { "hello", "qaaword", "helo" };
+    int results[3];
+    enchant_dict_check_batch(_dict, words, NULL, 3, results);
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(0, results[1]);
+    CHECK_EQUAL(1, results[2]);
+    // en_GB is asked about all three words, qaa about the two it did not accept
+    CHECK_EQUAL(5, checkCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_Suggest_MembersMergedBestFirst)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    std::vector<std::string> suggs = Suggest("helo");
+    CHECK_EQUAL(2, suggs.size());
+    CHECK_EQUAL("hello", suggs[0]);
+    CHECK_EQUAL("qaaword", suggs[1]);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_SuggestBatch_MembersMergedBestFirst)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    const char *words[] = { "helo", "qaawrd" };
+    size_t n_suggs[2];
+    char ***suggs_list = enchant_dict_suggest_batch(_dict, words, NULL, 2, n_suggs);
+    CHECK(suggs_list);
+    for (size_t i = 0; suggs_list && i < 2; i++) {
+        CHECK_EQUAL(2, n_suggs[i]);
+        CHECK_EQUAL("hello", std::string(suggs_list[i][0]));
+        CHECK_EQUAL("qaaword", std::string(suggs_list[i][1]));
+    }
+    if (suggs_list)
+        enchant_dict_free_suggest_batch(_dict, suggs_list);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_SuggestAsync_MembersMergedBestFirst)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    asyncCalled = false;
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, -1,
+                                                                AsyncSuggestCallback, NULL);
+    CHECK(request);
+
+    g_mutex_lock(&asyncLock);
+    while (request && !asyncCalled)
+        g_cond_wait(&asyncCond, &asyncLock);
+    g_mutex_unlock(&asyncLock);
+    if (request)
+        enchant_dict_free_suggest_request(_dict, request);
+
+    CHECK_EQUAL(2, asyncSuggs.size());
+    if (asyncSuggs.size() == 2) {
+        CHECK_EQUAL("hello", asyncSuggs[0]);
+        CHECK_EQUAL("qaaword", asyncSuggs[1]);
+    }
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_SpacesAndEmptyTags_Ignored)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, " en_GB ,, qaa,");
+    CHECK(_dict);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "qaaword", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_WordAdded_OwnPersonalList)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    enchant_dict_add(_dict, "helo", -1);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "helo", -1));
+    CHECK(FileExists(AddToPath(GetTempUserEnchantDir(), "en_GB,qaa.dic")));
+
+    EnchantDict* dict = RequestDictionary("en_GB");
+    CHECK_EQUAL(1, enchant_dict_check(dict, "helo", -1));
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_Freed_MembersDisposed)
+{
+    EnchantDict* dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    FreeDictionary(dict);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_Describe_TagsListed)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,qaa");
+    std::string lang;
+    enchant_dict_describe(_dict, [](const char * const lang_tag, const char * const,
+                                    const char * const, const char * const, void * user_data)
+                                 {
+                                     *static_cast<std::string*>(user_data) = lang_tag;
+                                 }, &lang);
+    CHECK_EQUAL("en_GB,qaa", lang);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_OneMemberMissing_NULLOthersFreed)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, "en_GB,en_US");
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK(enchant_broker_get_error(_broker));
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_OnlyCommas_NULL)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, ",,");
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_NullBroker_NULL)
+{
+    _dict = enchant_broker_request_multi_dict(NULL, "en_GB,qaa");
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestMultiDictionary_TestFixture,
+             EnchantBrokerRequestMultiDictionary_NullTags_NULL)
+{
+    _dict = enchant_broker_request_multi_dict(_broker, NULL);
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
@@ -0,0 +1,209 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount;
+static int checkCount;
+static int MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    checkCount++;
+    return std::string(word, len) == "hello" ? 0 : 1;
+}
+
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    requestDictionaryCount++;
+    EnchantDict * dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static int disposeDictionaryCount;
+static void DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void Overlay_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerRequestOverlayDictionary_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestOverlayDictionary_TestFixture():
+            EnchantBrokerTestFixture(Overlay_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        checkCount = 0;
+        disposeDictionaryCount = 0;
+        _userDir1 = AddToPath(GetTempUserEnchantDir(), "user1");
+        _userDir2 = AddToPath(GetTempUserEnchantDir(), "user2");
+    }
+
+    std::string _userDir1;
+    std::string _userDir2;
+};
+
+/**
+ * enchant_broker_request_overlay_dict
+ * @broker: A non-null #EnchantBroker
+ * @tag: The non-null language tag you wish to request a dictionary for ("en_US", "de_DE", ...)
+ * @user_dir: A non-null directory holding the personal and exclude word lists to use
+ *
+ * Requests a dictionary that shares the one enchant_broker_request_dict would
+ * return for @tag, but with its own personal and exclude word lists and its
+ * own session.
+ *
+ * Returns: A new #EnchantDict on every call, or %null if no suitable dictionary
+ * could be found.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_TwoUsers_ProviderDictionaryLoadedOnce)
+{
+    EnchantDict* dict1 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    EnchantDict* dict2 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir2.c_str());
+    CHECK(dict1);
+    CHECK(dict2);
+    CHECK(dict1 != dict2);
+    CHECK_EQUAL(1, requestDictionaryCount);
+
+    FreeDictionary(dict1);
+    FreeDictionary(dict2);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_Check_ProviderAsked)
+{
+    EnchantDict* dict = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    CHECK_EQUAL(0, enchant_dict_check(dict, "hello", -1));
+    CHECK_EQUAL(1, enchant_dict_check(dict, "helo", -1));
+    CHECK_EQUAL(2, checkCount);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_WordAdded_OnlyThatUserHasIt)
+{
+    EnchantDict* dict1 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    EnchantDict* dict2 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir2.c_str());
+    EnchantDict* dict = RequestDictionary("en_GB");
+
+    enchant_dict_add(dict1, "helo", -1);
+    enchant_dict_add_to_session(dict1, "hallo", -1);
+
+    CHECK_EQUAL(0, enchant_dict_check(dict1, "helo", -1));
+    CHECK_EQUAL(0, enchant_dict_check(dict1, "hallo", -1));
+    CHECK_EQUAL(1, enchant_dict_check(dict2, "helo", -1));
+    CHECK_EQUAL(1, enchant_dict_check(dict2, "hallo", -1));
+    CHECK_EQUAL(1, enchant_dict_check(dict, "helo", -1));
+    CHECK(FileExists(AddToPath(_userDir1, "en_GB.dic")));
+    CHECK(!FileExists(AddToPath(_userDir2, "en_GB.dic")));
+
+    FreeDictionary(dict1);
+    FreeDictionary(dict2);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_WordExcluded_OnlyThatUserLosesIt)
+{
+    EnchantDict* dict1 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    EnchantDict* dict2 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir2.c_str());
+
+    enchant_dict_remove(dict1, "hello", -1);
+
+    CHECK_EQUAL(1, enchant_dict_check(dict1, "hello", -1));
+    CHECK_EQUAL(0, enchant_dict_check(dict2, "hello", -1));
+
+    FreeDictionary(dict1);
+    FreeDictionary(dict2);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_LastOverlayFreed_ProviderDictionaryDisposed)
+{
+    EnchantDict* dict1 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    EnchantDict* dict2 = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir2.c_str());
+
+    FreeDictionary(dict1);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+    FreeDictionary(dict2);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_Describe_ProviderDescribed)
+{
+    EnchantDict* dict = enchant_broker_request_overlay_dict(_broker, "en_GB", _userDir1.c_str());
+    std::string lang;
+    enchant_dict_describe(dict, [](const char * const lang_tag, const char * const,
+                                   const char * const, const char * const, void * user_data)
+                                {
+                                    *static_cast<std::string*>(user_data) = lang_tag;
+                                }, &lang);
+    CHECK_EQUAL("en_GB", lang);
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_ProviderDoesNotHave_NULL)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_overlay_dict(_broker, "en_US", _userDir1.c_str()));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_NullBroker_NULL)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_overlay_dict(NULL, "en_GB", _userDir1.c_str()));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_NullTag_NULL)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_overlay_dict(_broker, NULL, _userDir1.c_str()));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_NullUserDir_NULL)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_overlay_dict(_broker, "en_GB", NULL));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestOverlayDictionary_TestFixture,
+             EnchantBrokerRequestOverlayDictionary_EmptyUserDir_NULL)
+{
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_request_overlay_dict(_broker, "en_GB", ""));
+}
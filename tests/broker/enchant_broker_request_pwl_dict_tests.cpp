@@ -79,6 +79,23 @@ TEST_FIXTURE(EnchantBrokerRequestPwlDictionary_TestFixture,
     CHECK_EQUAL(_dict, dict);
 }
 
+TEST_FIXTURE(EnchantBrokerRequestPwlDictionary_TestFixture, 
+             EnchantBrokerRequestPwlDictionary_OtherBroker_SharesWordsBeforeTheyAreWritten)
+{
+    enchant_broker_set_write_behind(_broker, 1);
+    _dict = enchant_broker_request_pwl_dict(_broker, _pwlFile.c_str());
+
+    EnchantBroker* broker = enchant_broker_init();
+    EnchantDict* dict = enchant_broker_request_pwl_dict(broker, _pwlFile.c_str());
+    enchant_dict_add(_dict, "hello", -1);
+
+    CHECK(_dict != dict);
+    CHECK_EQUAL(0, enchant_dict_check(dict, "hello", -1));
+
+    enchant_broker_free_dict(broker, dict);
+    enchant_broker_free(broker);
+}
+
 TEST_FIXTURE(EnchantBrokerRequestPwlDictionary_TestFixture, 
              EnchantBrokerRequestPwlDictionary_HasPreviousError_ErrorCleared)
 {
@@ -0,0 +1,172 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <glib.h>
+#include <string>
+
+struct EnchantBrokerRequestReadonlyPwlDictionary_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRequestReadonlyPwlDictionary_TestFixture()
+    { 
+        _dict = NULL;
+        _pwlFile = GetTemporaryFilename("epwl");
+    }
+
+    //Teardown
+    ~EnchantBrokerRequestReadonlyPwlDictionary_TestFixture()
+    {
+        FreeDictionary(_dict);
+        DeleteFile(_pwlFile + ".idx");
+        DeleteFile(_pwlFile);
+    }
+
+    void WriteWordList(const std::string& contents)
+    {
+        CHECK(g_file_set_contents(_pwlFile.c_str(), contents.c_str(), contents.size(), NULL));
+    }
+
+    std::string ReadWordList()
+    {
+        gchar *contents = NULL;
+        g_file_get_contents(_pwlFile.c_str(), &contents, NULL, NULL);
+        std::string result(contents ? contents : "");
+        g_free(contents);
+        return result;
+    }
+
+    EnchantDict* _dict;
+    std::string _pwlFile;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_FileExists_ChecksItsWords)
+{
+    WriteWordList("hello\nworld\n");
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    CHECK(_dict);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_FileDoesNotExist_NullWithoutCreatingIt)
+{
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+    CHECK(enchant_broker_get_error(_broker));
+    CHECK(!FileExists(_pwlFile));
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_CalledTwice_ReturnsSame)
+{
+    WriteWordList("hello\n");
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    EnchantDict* dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    CHECK_EQUAL(_dict, dict);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_AddAndRemove_RefusedFileUntouched)
+{
+    WriteWordList("hello\n");
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+
+    enchant_dict_add(_dict, "world", -1);
+    CHECK(enchant_dict_get_error(_dict));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "world", -1));
+
+    const char *words[] = { "world" };
+    enchant_dict_add_many(_dict, words, 1);
+    CHECK(enchant_dict_get_error(_dict));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "world", -1));
+
+    enchant_dict_remove(_dict, "hello", -1);
+    CHECK(enchant_dict_get_error(_dict));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+
+    CHECK_EQUAL(std::string("hello\n"), ReadWordList());
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_AddToSession_Accepted)
+{
+    WriteWordList("hello\n");
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+
+    enchant_dict_add_to_session(_dict, "world", -1);
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_get_error(_dict));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    CHECK_EQUAL(std::string("hello\n"), ReadWordList());
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_WritableOneOfSameFile_SeesItsWords)
+{
+    WriteWordList("hello\n");
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    EnchantDict* writable = enchant_broker_request_pwl_dict(_broker, _pwlFile.c_str());
+    CHECK(writable != _dict);
+
+    enchant_dict_add(writable, "world", -1);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    FreeDictionary(writable);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture, 
+             EnchantBrokerRequestReadonlyPwlDictionary_LargeWordList_WritesNoIndex)
+{
+    std::string contents;
+    for (int i = 0; i < 2000; i++)
+        contents += "word" + std::to_string(i) + "\n";
+    WriteWordList(contents);
+
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, _pwlFile.c_str());
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "word1999", -1));
+    CHECK(!FileExists(_pwlFile + ".idx"));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture,
+             EnchantBrokerRequestReadonlyPwlDictionary_NullBroker_NULL)
+{
+    _dict = enchant_broker_request_readonly_pwl_dict(NULL, _pwlFile.c_str());
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRequestReadonlyPwlDictionary_TestFixture,
+             EnchantBrokerRequestReadonlyPwlDictionary_NullFilename_NULL)
+{
+    _dict = enchant_broker_request_readonly_pwl_dict(_broker, NULL);
+
+    CHECK_EQUAL((void*)NULL, (void*)_dict);
+}
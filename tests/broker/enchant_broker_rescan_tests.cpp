@@ -0,0 +1,143 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount;
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    requestDictionaryCount++;
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static int listDictionariesCount;
+static char** ListDictionaries (EnchantProvider * me, size_t * out_n_dicts)
+{
+    listDictionariesCount++;
+    return MockEnGbAndQaaProviderListDictionaries(me, out_n_dicts);
+}
+
+static std::string dictionaryDir;
+static char** ListDictionaryDirs (EnchantProvider *, size_t * out_n_dirs)
+{
+    *out_n_dirs = 1;
+    char** out_list = g_new0 (char *, *out_n_dirs + 1);
+    out_list[0] = g_strdup (dictionaryDir.c_str());
+
+    return out_list;
+}
+
+static void Rescan_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->list_dicts = ListDictionaries;
+     me->list_dict_dirs = ListDictionaryDirs;
+}
+
+static void EnchantDictionaryDescribeIgnoreCallback (const char * const,
+                                                     const char * const,
+                                                     const char * const,
+                                                     const char * const,
+                                                     void *)
+{
+}
+
+struct EnchantBrokerRescan_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerRescan_TestFixture():
+            EnchantBrokerTestFixture(Rescan_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        listDictionariesCount = 0;
+        dictionaryDir = AddToPath(GetTempUserEnchantDir(), "mock");
+        GetMockProvider();
+    }
+};
+
+/**
+ * enchant_broker_rescan
+ * @broker: A non-null #EnchantBroker
+ *
+ * Forgets which dictionaries @broker found missing and which ones the
+ * providers listed, so that they are asked again.  The broker notices
+ * dictionaries installed in the directories providers report on its
+ * own; this is for those it cannot tell about.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerRescan_TestFixture,
+             EnchantBrokerRescan_MissingDictionary_ProviderAskedAgain)
+{
+    enchant_broker_request_dict(_broker, "qaz");
+    enchant_broker_request_dict(_broker, "qaz");
+    CHECK_EQUAL(1, requestDictionaryCount);
+
+    enchant_broker_rescan(_broker);
+    enchant_broker_request_dict(_broker, "qaz");
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRescan_TestFixture,
+             EnchantBrokerRescan_ListedDictionaries_ProviderListsAgain)
+{
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeIgnoreCallback, NULL);
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeIgnoreCallback, NULL);
+    CHECK_EQUAL(1, listDictionariesCount);
+
+    enchant_broker_rescan(_broker);
+    enchant_broker_list_dicts(_broker, EnchantDictionaryDescribeIgnoreCallback, NULL);
+    CHECK_EQUAL(2, listDictionariesCount);
+}
+
+TEST_FIXTURE(EnchantBrokerRescan_TestFixture,
+             EnchantBrokerRescan_LoadedDictionary_StillLoaded)
+{
+    EnchantDict* dict = enchant_broker_request_dict(_broker, "en_GB");
+    enchant_broker_rescan(_broker);
+    EnchantDict* dict2 = enchant_broker_request_dict(_broker, "en_GB");
+    CHECK_EQUAL(dict, dict2);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict2);
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerRescan_TestFixture,
+             EnchantBrokerRescan_HasPreviousError_ErrorCleared)
+{
+    SetErrorOnMockProvider("something bad happened");
+
+    enchant_broker_rescan(_broker);
+
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_get_error(_broker));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerRescan_TestFixture,
+             EnchantBrokerRescan_NullBroker_DoNothing)
+{
+    enchant_broker_rescan(NULL);
+}
@@ -0,0 +1,158 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+
+static int requestDictionaryCount;
+static EnchantDict * RequestDictionary (EnchantProvider *me, const char *tag)
+{
+    requestDictionaryCount++;
+    return MockEnGbAndQaaProviderRequestDictionary(me, tag);
+}
+
+static int disposeDictionaryCount;
+static void DisposeDictionary (EnchantProvider *me, EnchantDict * dict)
+{
+    disposeDictionaryCount++;
+    MockProviderDisposeDictionary(me, dict);
+}
+
+static void DictPool_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary;
+     me->dispose_dict = DisposeDictionary;
+}
+
+struct EnchantBrokerSetDictPool_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerSetDictPool_TestFixture():
+            EnchantBrokerTestFixture(DictPool_ProviderConfiguration)
+    { 
+        requestDictionaryCount = 0;
+        disposeDictionaryCount = 0;
+    }
+};
+
+/**
+ * enchant_broker_set_dict_pool
+ * @broker: A non-null #EnchantBroker
+ * @max_dicts: How many freed dictionaries to keep loaded, 0 for none
+ * @idle_timeout_ms: How long to keep each of them, or -1 for as long as there is room
+ *
+ * Keeps up to @max_dicts dictionaries loaded after they are released
+ * with enchant_broker_free_dict, so that requesting one again does not
+ * load it again.  The least recently released are let go first, and
+ * those kept longer than @idle_timeout_ms are let go the next time
+ * @broker frees or requests a dictionary.  A dictionary requested
+ * again comes back as it was left, words added to its session
+ * included.  By default no dictionaries are kept.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_Default_FreedDictionaryDisposed)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    FreeDictionary(dict);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_FreedThenRequested_SameDictionaryNotLoadedAgain)
+{
+    enchant_broker_set_dict_pool(_broker, 2, -1);
+    EnchantDict* dict = RequestDictionary("en_GB");
+    FreeDictionary(dict);
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    EnchantDict* dict2 = RequestDictionary("en_GB");
+    CHECK_EQUAL(dict, dict2);
+    CHECK_EQUAL(1, requestDictionaryCount);
+    FreeDictionary(dict2);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_TooManyFreed_LeastRecentlyFreedDisposed)
+{
+    enchant_broker_set_dict_pool(_broker, 1, -1);
+    EnchantDict* enGb = RequestDictionary("en_GB");
+    EnchantDict* qaa = RequestDictionary("qaa");
+    FreeDictionary(enGb);
+    FreeDictionary(qaa);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+
+    FreeDictionary(RequestDictionary("qaa"));
+    CHECK_EQUAL(2, requestDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_IdleTimeoutPassed_FreedDictionaryDisposed)
+{
+    enchant_broker_set_dict_pool(_broker, 2, 0);
+    EnchantDict* dict = RequestDictionary("en_GB");
+    FreeDictionary(dict);
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_TurnedOff_KeptDictionariesDisposed)
+{
+    enchant_broker_set_dict_pool(_broker, 2, -1);
+    FreeDictionary(RequestDictionary("en_GB"));
+    FreeDictionary(RequestDictionary("qaa"));
+    CHECK_EQUAL(0, disposeDictionaryCount);
+
+    enchant_broker_set_dict_pool(_broker, 0, -1);
+    CHECK_EQUAL(2, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_BrokerFreed_KeptDictionariesDisposed)
+{
+    enchant_broker_set_dict_pool(_broker, 2, -1);
+    FreeDictionary(RequestDictionary("en_GB"));
+
+    enchant_broker_free(_broker);
+    _broker = NULL;
+    CHECK_EQUAL(1, disposeDictionaryCount);
+}
+
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_HasPreviousError_ErrorCleared)
+{
+    SetErrorOnMockProvider("something bad happened");
+
+    enchant_broker_set_dict_pool(_broker, 2, -1);
+
+    CHECK_EQUAL((void*)NULL, (void*)enchant_broker_get_error(_broker));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerSetDictPool_TestFixture,
+             EnchantBrokerSetDictPool_NullBroker_DoNothing)
+{
+    enchant_broker_set_dict_pool(NULL, 2, -1);
+}
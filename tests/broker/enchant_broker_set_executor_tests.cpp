@@ -0,0 +1,248 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <utility>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static EnchantDict* MockProviderRequestSuggestMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = MockDictionarySuggest;
+    return dict;
+}
+
+static void SetExecutor_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->flags = ENCHANT_PROVIDER_THREAD_SAFE;
+}
+
+// keeps the tasks until they are run with RunTasks
+struct DeferringExecutor
+{
+    GMutex lock;
+    std::vector<std::pair<EnchantTaskFn, void *> > tasks;
+    size_t n_handed;
+
+    DeferringExecutor() : n_handed(0) { g_mutex_init(&lock); }
+    ~DeferringExecutor() { g_mutex_clear(&lock); }
+
+    static void Execute(EnchantTaskFn run, void * task, void * user_data)
+    {
+        DeferringExecutor *executor = static_cast<DeferringExecutor *>(user_data);
+        g_mutex_lock(&executor->lock);
+        executor->tasks.push_back(std::make_pair(run, task));
+        executor->n_handed++;
+        g_mutex_unlock(&executor->lock);
+    }
+
+    void RunTasks()
+    {
+        g_mutex_lock(&lock);
+        std::vector<std::pair<EnchantTaskFn, void *> > taken;
+        taken.swap(tasks);
+        g_mutex_unlock(&lock);
+        for (size_t i = 0; i < taken.size(); i++)
+            taken[i].first(taken[i].second);
+    }
+};
+
+static void
+RunAtOnce (EnchantTaskFn run, void * task, void * user_data)
+{
+    g_atomic_int_inc(static_cast<gint *>(user_data));
+    run(task);
+}
+
+static bool preloadCalled;
+
+static void
+PreloadCallback (const char * const, int, void *)
+{
+    preloadCalled = true;
+}
+
+static bool suggestCalled;
+
+static void
+SuggestCallback (EnchantDict * dict, char **suggs, size_t, void *)
+{
+    suggestCalled = true;
+    enchant_dict_free_string_list(dict, suggs);
+}
+
+struct EnchantBrokerSetExecutor_TestFixture : EnchantDictionaryTestFixture
+{
+    DeferringExecutor _executor;
+
+    //Setup
+    EnchantBrokerSetExecutor_TestFixture():
+            EnchantDictionaryTestFixture(SetExecutor_ProviderConfiguration)
+    {
+        preloadCalled = false;
+        suggestCalled = false;
+    }
+
+    //Teardown
+    ~EnchantBrokerSetExecutor_TestFixture()
+    {
+        // the broker waits for every task handed out
+        _executor.RunTasks();
+    }
+
+    char*** SuggestBatch(size_t * n_suggs)
+    {
+        const char *words[] = { "helo", "wrld", "tset" };
+        return enchant_dict_suggest_batch(_dict, words, NULL, 3, n_suggs);
+    }
+};
+
+/**
+ * enchant_broker_set_executor
+ * @broker: A non-null #EnchantBroker
+ * @fn: Optional, an #EnchantExecutorFn
+ * @user_data: Optional user-data
+ *
+ * Hands the work @broker does in the background to @fn instead of the
+ * threads of its own pool: preloading, asynchronous and batch
+ * suggestions, asking the other providers of
+ * enchant_dict_set_suggest_fanout and the members of a composite
+ * dictionary at once, and listing dictionaries.  A call that waits for
+ * its background work does the part of it not started yet itself, so
+ * @fn may run the tasks as late, and as few at a time, as suits the
+ * application.  Every task must be run in the end, and
+ * enchant_broker_free() waits for them.  %null goes back to @broker's
+ * own threads.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetExecutor_SuggestBatch_HandedToExecutor)
+{
+    gint n_run = 0;
+    enchant_broker_set_executor(_broker, RunAtOnce, &n_run);
+
+    size_t n_suggs[3];
+    char ***suggs = SuggestBatch(n_suggs);
+    CHECK(suggs);
+    CHECK_EQUAL(3, g_atomic_int_get(&n_run));
+    for (size_t i = 0; i < 3; i++)
+        CHECK_EQUAL(4, n_suggs[i]);
+    enchant_dict_free_suggest_batch(_dict, suggs);
+}
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetExecutor_ExecutorNeverRuns_SuggestBatchDoneByCaller)
+{
+    enchant_broker_set_executor(_broker, DeferringExecutor::Execute, &_executor);
+
+    size_t n_suggs[3];
+    char ***suggs = SuggestBatch(n_suggs);
+    CHECK(suggs);
+    CHECK_EQUAL(3, _executor.n_handed);
+    for (size_t i = 0; i < 3; i++)
+        CHECK_EQUAL(4, n_suggs[i]);
+    enchant_dict_free_suggest_batch(_dict, suggs);
+}
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetExecutor_SuggestAsync_RunWhenExecutorRunsIt)
+{
+    enchant_broker_set_executor(_broker, DeferringExecutor::Execute, &_executor);
+
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, -1, SuggestCallback, NULL);
+    CHECK(!suggestCalled);
+
+    _executor.RunTasks();
+    CHECK(suggestCalled);
+    enchant_dict_free_suggest_request(_dict, request);
+}
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetExecutor_Preload_RunWhenExecutorRunsIt)
+{
+    enchant_broker_set_executor(_broker, DeferringExecutor::Execute, &_executor);
+
+    const char *tags[] = { "qaa" };
+    enchant_broker_preload(_broker, tags, 1, PreloadCallback, NULL);
+    CHECK(!preloadCalled);
+
+    _executor.RunTasks();
+    CHECK(preloadCalled);
+}
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetExecutor_Null_OwnThreadsAgain)
+{
+    enchant_broker_set_executor(_broker, DeferringExecutor::Execute, &_executor);
+    enchant_broker_set_executor(_broker, NULL, NULL);
+
+    size_t n_suggs[3];
+    char ***suggs = SuggestBatch(n_suggs);
+    CHECK(suggs);
+    CHECK_EQUAL(0, _executor.n_handed);
+    enchant_dict_free_suggest_batch(_dict, suggs);
+}
+
+/**
+ * enchant_broker_set_worker_threads
+ * @broker: A non-null #EnchantBroker
+ * @n_threads: The most threads to use, or 0 for one per processor
+ *
+ * Sets how many threads @broker's own pool has for the background work
+ * enchant_broker_set_executor lists, all of which it shares.  By
+ * default there is one per processor.  Tying the threads to processors
+ * is up to an executor of the application's.
+ */
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetWorkerThreads_One_SuggestBatchDone)
+{
+    enchant_broker_set_worker_threads(_broker, 1);
+
+    size_t n_suggs[3];
+    char ***suggs = SuggestBatch(n_suggs);
+    CHECK(suggs);
+    for (size_t i = 0; i < 3; i++)
+        CHECK_EQUAL(4, n_suggs[i]);
+    enchant_dict_free_suggest_batch(_dict, suggs);
+}
+
+TEST_FIXTURE(EnchantBrokerSetExecutor_TestFixture,
+             EnchantBrokerSetWorkerThreads_ChangedAfterUse_SuggestBatchDone)
+{
+    size_t n_suggs[3];
+    enchant_dict_free_suggest_batch(_dict, SuggestBatch(n_suggs));
+
+    enchant_broker_set_worker_threads(_broker, 2);
+    char ***suggs = SuggestBatch(n_suggs);
+    CHECK(suggs);
+    CHECK_EQUAL(4, n_suggs[2]);
+    enchant_dict_free_suggest_batch(_dict, suggs);
+
+    enchant_broker_set_worker_threads(_broker, 0);
+}
@@ -0,0 +1,223 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include "EnchantBrokerTestFixture.h"
+
+static int slowMock;
+static bool mock1HasNoDictionary;
+static bool mock1Requested;
+static std::string lastRequested;
+
+static int
+CheckWord (int mock)
+{
+    if (mock == slowMock)
+        g_usleep (2000);
+    return 0;
+}
+
+static int Check1 (EnchantDict *, const char *const, size_t) { return CheckWord (1); }
+static int Check2 (EnchantDict *, const char *const, size_t) { return CheckWord (2); }
+
+static EnchantDict *
+RequestDictionary1 (EnchantProvider *me, const char *tag)
+{
+    mock1Requested = true;
+    lastRequested = "mock1";
+    if (mock1HasNoDictionary)
+        return NULL;
+    EnchantDict *dict = MockEnGbAndQaaProviderRequestDictionary (me, tag);
+    if (dict)
+        dict->check = Check1;
+    return dict;
+}
+
+static EnchantDict *
+RequestDictionary2 (EnchantProvider *me, const char *tag)
+{
+    lastRequested = "mock2";
+    EnchantDict *dict = MockEnGbAndQaaProviderRequestDictionary (me, tag);
+    if (dict)
+        dict->check = Check2;
+    return dict;
+}
+
+static const char *
+MockProvider1Identify (EnchantProvider *)
+{
+    return "mock1";
+}
+
+static const char *
+MockProvider2Identify (EnchantProvider *)
+{
+    return "mock2";
+}
+
+static void GroupedOrdering_ProviderConfiguration1 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary1;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->identify = MockProvider1Identify;
+}
+
+static void GroupedOrdering_ProviderConfiguration2 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary2;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->identify = MockProvider2Identify;
+}
+
+struct EnchantBrokerSetOrderingGrouped_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerSetOrderingGrouped_TestFixture():
+            EnchantBrokerTestFixture(GroupedOrdering_ProviderConfiguration1, GroupedOrdering_ProviderConfiguration2)
+    {
+        slowMock = 0;
+        mock1HasNoDictionary = false;
+        mock1Requested = false;
+    }
+
+    // the provider that gave the dictionary, after checking a few words with it
+    std::string RequestAndCheck(const std::string& tag)
+    {
+        lastRequested.clear();
+        EnchantDict* dict = RequestDictionary(tag);
+        if (dict == NULL)
+            return "";
+
+        for (int i = 0; i < 5; i++)
+            {
+                std::string word = "word" + std::to_string(i);
+                enchant_dict_check(dict, word.c_str(), -1);
+            }
+        FreeDictionary(dict);
+
+        return lastRequested;
+    }
+};
+
+/**
+ * enchant_broker_set_ordering
+ * @broker: A non-null #EnchantBroker
+ * @tag: A non-null language tag (en_US)
+ * @ordering: A non-null ordering (nuspell,aspell,hunspell,hspell)
+ *
+ * Providers joined with '|' (hunspell|nuspell,aspell) are taken to be
+ * as good as one another: the one found to be the fastest for the
+ * language is tried first, going by how long each took to open its
+ * dictionary and to check and suggest in earlier sessions.  Each is
+ * tried first once, to be measured.  What is measured is kept in the
+ * user's config directory when @broker is freed.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_FirstSlow_SecondPreferredOnceMeasured)
+{
+    slowMock = 1;
+    enchant_broker_set_ordering(_broker, "qaa", "mock1|mock2");
+
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_SecondSlow_FirstPreferredOnceMeasured)
+{
+    slowMock = 2;
+    enchant_broker_set_ordering(_broker, "qaa", "mock1|mock2");
+
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_AsteriskForLanguage_Grouped)
+{
+    slowMock = 1;
+    enchant_broker_set_ordering(_broker, "*", "mock1 | mock2");
+
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+
+    // measured for each language on its own
+    CHECK_EQUAL("mock1", RequestAndCheck("en_GB"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_NotGrouped_OrderKept)
+{
+    slowMock = 1;
+    enchant_broker_set_ordering(_broker, "qaa", "mock1,mock2");
+
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_MeasuredAgainByNewBroker_KeptAcrossRuns)
+{
+    slowMock = 1;
+    enchant_broker_set_ordering(_broker, "qaa", "mock1|mock2");
+    CHECK_EQUAL("mock1", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+
+    enchant_broker_free(_broker);
+    InitializeBroker();
+    enchant_broker_set_ordering(_broker, "qaa", "mock1|mock2");
+
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_ProviderWithoutDictionary_TriedLast)
+{
+    mock1HasNoDictionary = true;
+    enchant_broker_set_ordering(_broker, "qaa", "mock1|mock2");
+
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK(mock1Requested);
+
+    mock1Requested = false;
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK(!mock1Requested);
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrderingGrouped_TestFixture,
+             EnchantBrokerSetOrderingGrouped_GroupBeforeOthers_KeepsItsPlace)
+{
+    slowMock = 1;
+    enchant_broker_set_ordering(_broker, "qaa", "mock2|aspell,mock1");
+
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+    CHECK_EQUAL("mock2", RequestAndCheck("qaa"));
+}
@@ -288,6 +288,23 @@ TEST_FIXTURE(EnchantBrokerSetOrdering_TestFixture,
   CHECK_EQUAL((void*)NULL, (void*)enchant_broker_get_error(_broker));
 }
 
+TEST_FIXTURE(EnchantBrokerSetOrdering_TestFixture,
+			 EnchantBrokerSetOrdering_SpecificLanguageAfterDefaultUsed_OverridesDefault)
+{
+	enchant_broker_set_ordering(_broker, "*", "mock1,mock2");
+	CHECK_EQUAL(Mock1ThenMock2, GetProviderOrder("qaa"));
+
+	enchant_broker_set_ordering(_broker, "qaa", "mock2,mock1");
+	CHECK_EQUAL(Mock2ThenMock1, GetProviderOrder("qaa"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetOrdering_TestFixture,
+			 EnchantBrokerSetOrdering_EmptyProviderName_Ignored)
+{
+	enchant_broker_set_ordering(_broker, "qaa", "mock2, ,,mock1");
+	CHECK_EQUAL(Mock2ThenMock1, GetProviderOrder("qaa"));
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Test Error Conditions
 TEST_FIXTURE(EnchantBrokerSetOrdering_TestFixture,
@@ -0,0 +1,105 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+struct EnchantBrokerSetWriteBehind_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantBrokerSetWriteBehind_TestFixture():
+            EnchantDictionaryTestFixture(EmptyDictionary_ProviderConfiguration)
+    { 
+        enchant_broker_set_write_behind(_broker, 1);
+    }
+};
+
+/**
+ * enchant_broker_set_write_behind
+ * @broker: A non-null #EnchantBroker
+ * @enabled: Non-zero to write personal dictionary changes in the background
+ *
+ * When enabled, words added to or removed from the personal and exclude
+ * dictionaries of @broker's dictionaries take effect at once, but are
+ * written to disk by a background thread a few at a time.  Disabling it,
+ * freeing a dictionary or freeing @broker writes out any pending changes.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerSetWriteBehind_TestFixture,
+             EnchantBrokerSetWriteBehind_WordAdded_InDictionaryAtOnce)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetWriteBehind_TestFixture,
+             EnchantBrokerSetWriteBehind_Disabled_PendingWordsWritten)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    enchant_broker_set_write_behind(_broker, 0);
+    CHECK(PersonalWordListFileHasContents());
+
+    ReloadTestDictionary();
+    CHECK(IsWordInDictionary("hello"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetWriteBehind_TestFixture,
+             EnchantBrokerSetWriteBehind_DictionaryFreed_PendingWordsWritten)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    enchant_dict_add(_dict, "world", -1);
+    enchant_dict_remove(_dict, "hello", -1);
+
+    ReloadTestDictionary();
+    CHECK(!IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantBrokerSetWriteBehind_TestFixture,
+             EnchantBrokerSetWriteBehind_DictionaryRequestedAfterwards_WordAddedInDictionaryAtOnce)
+{
+    ReloadTestDictionary();
+    enchant_dict_add(_dict, "hello", -1);
+    CHECK(IsWordInDictionary("hello"));
+
+    enchant_broker_set_write_behind(_broker, 0);
+    CHECK(PersonalWordListFileHasContents());
+}
+
+TEST_FIXTURE(EnchantBrokerSetWriteBehind_TestFixture,
+             EnchantBrokerSetWriteBehind_FileChangedExternally_PendingWordsKept)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    ExternalAddWordToDictionary("world");
+
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST(EnchantBrokerSetWriteBehind_NullBroker_DoNothing)
+{
+    enchant_broker_set_write_behind(NULL, 1);
+}
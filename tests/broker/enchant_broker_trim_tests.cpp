@@ -0,0 +1,180 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <map>
+#include <string>
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const, size_t)
+{
+    return 1; // bad word
+}
+
+static EnchantDict*
+MockProviderRequestCheckingDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void Trim_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckingDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectMemory (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *usage = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*usage)[name] = value;
+}
+
+struct EnchantBrokerTrim_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantBrokerTrim_TestFixture():
+            EnchantBrokerTestFixture(Trim_ProviderConfiguration)
+    { }
+
+    std::map<std::string, uint64_t> GetMemoryUsage(EnchantDict* dict)
+    {
+        std::map<std::string, uint64_t> usage;
+        enchant_dict_get_memory_usage(dict, CollectMemory, &usage);
+        return usage;
+    }
+};
+
+/**
+ * enchant_broker_trim
+ * @broker: A non-null #EnchantBroker
+ * @level: How much to release, from 0 to 2
+ *
+ * Releases memory @broker's dictionaries can do without, for a process
+ * short of memory.
+ *
+ * Returns: 0 on success, -1 if @level is unknown
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_PooledDictionary_Disposed)
+{
+    enchant_broker_set_dict_pool(_broker, 4, -1);
+    FreeDictionary(RequestDictionary("en_GB"));
+    CHECK(enchant_broker_get_memory_usage(_broker, NULL, NULL) > 0);
+
+    CHECK_EQUAL(0, enchant_broker_trim(_broker, 0));
+    CHECK_EQUAL(0, enchant_broker_get_memory_usage(_broker, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_DictionaryInUse_Kept)
+{
+    enchant_broker_set_dict_pool(_broker, 4, -1);
+    EnchantDict* dict = RequestDictionary("en_GB");
+
+    CHECK_EQUAL(0, enchant_broker_trim(_broker, 2));
+    CHECK_EQUAL(1, enchant_dict_check(dict, "hello", -1));
+    CHECK(enchant_broker_get_memory_usage(_broker, NULL, NULL) > 0);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_Level0_CachesKept)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_dict_set_check_cache_size(dict, 16);
+    enchant_dict_check(dict, "hello", -1);
+    uint64_t cached = GetMemoryUsage(dict)["check_cache"];
+
+    CHECK_EQUAL(0, enchant_broker_trim(_broker, 0));
+    CHECK_EQUAL(cached, GetMemoryUsage(dict)["check_cache"]);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_Level1_CachesEmptied)
+{
+    EnchantDict* dict = RequestDictionary("en_GB");
+    enchant_dict_set_check_cache_size(dict, 16);
+    uint64_t empty = GetMemoryUsage(dict)["check_cache"];
+    enchant_dict_check(dict, "hello", -1);
+    enchant_dict_check(dict, "world", -1);
+    CHECK(GetMemoryUsage(dict)["check_cache"] > empty);
+
+    CHECK_EQUAL(0, enchant_broker_trim(_broker, 1));
+    CHECK_EQUAL(empty, GetMemoryUsage(dict)["check_cache"]);
+
+    // still caching
+    enchant_dict_check(dict, "hello", -1);
+    CHECK(GetMemoryUsage(dict)["check_cache"] > empty);
+
+    FreeDictionary(dict);
+}
+
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_Level2_WordListShrinksAndStillWorks)
+{
+    EnchantDict* dict = RequestPersonalDictionary();
+    for (int i = 0; i < 500; i++)
+        enchant_dict_add(dict, ("word" + std::to_string(i)).c_str(), -1);
+    for (int i = 0; i < 250; i++)
+        enchant_dict_remove(dict, ("word" + std::to_string(i)).c_str(), -1);
+    enchant_dict_free_string_list(dict, enchant_dict_suggest(dict, "wrd300", -1, NULL));
+    uint64_t before = GetMemoryUsage(dict)["personal"];
+
+    CHECK_EQUAL(0, enchant_broker_trim(_broker, 2));
+    CHECK(GetMemoryUsage(dict)["personal"] < before);
+
+    CHECK_EQUAL(0, enchant_dict_check(dict, "word300", -1));
+    CHECK_EQUAL(1, enchant_dict_check(dict, "word100", -1));
+    size_t n_suggs;
+    char** suggs = enchant_dict_suggest(dict, "wrd300", -1, &n_suggs);
+    CHECK(n_suggs > 0);
+    enchant_dict_free_string_list(dict, suggs);
+
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_UnknownLevel_ErrorSet)
+{
+    CHECK_EQUAL(-1, enchant_broker_trim(_broker, 3));
+    CHECK(enchant_broker_get_error(_broker) != NULL);
+    CHECK_EQUAL(-1, enchant_broker_trim(_broker, -1));
+}
+
+TEST_FIXTURE(EnchantBrokerTrim_TestFixture,
+             EnchantBrokerTrim_NullBroker_Minus1)
+{
+    CHECK_EQUAL(-1, enchant_broker_trim(NULL, 0));
+}
@@ -0,0 +1,243 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <stdio.h>
+#include <set>
+#include <string>
+#include <string.h>
+#include <vector>
+
+// Many threads at once on one broker, its dictionaries and a personal
+// word list that is appended to behind the broker's back.  Run under
+// ThreadSanitizer (see HACKING), these also catch the data races that
+// happen not to break them.
+
+struct EnchantBrokerConcurrency_TestFixture : MockLatencyEnvironment, EnchantBrokerTestFixture
+{
+    EnchantDict *_dict;
+    EnchantDict *_pwl;
+    std::string _pwlFileName;
+
+    //Setup
+    EnchantBrokerConcurrency_TestFixture(const char *checkLatency = "0"):
+            MockLatencyEnvironment(checkLatency, "0", "4", "0", false),
+            EnchantBrokerTestFixture()
+    {
+        _dict = RequestDictionary("qaa");
+        _pwl = RequestPersonalDictionary();
+        _pwlFileName = GetLastPersonalDictionaryFileName();
+    }
+
+    //Teardown
+    ~EnchantBrokerConcurrency_TestFixture()
+    {
+        FreeDictionary(_pwl);
+        FreeDictionary(_dict);
+    }
+};
+
+struct Worker
+{
+    EnchantBrokerConcurrency_TestFixture *fixture;
+    int id;
+    int iterations;
+    gint *failures;
+};
+
+static void
+Fail(Worker *worker, const char *what)
+{
+    fprintf(stderr, "worker %d: %s\n", worker->id, what);
+    g_atomic_int_inc(worker->failures);
+}
+
+// The mock's words are misspelled if they have a 'z' in them, so
+// adding and removing these words is seen in how they check
+static gpointer
+Hammer(gpointer data)
+{
+    Worker *worker = static_cast<Worker *>(data);
+    EnchantBroker *broker = worker->fixture->_broker;
+    EnchantDict *dict = worker->fixture->_dict;
+    GRand *rand = g_rand_new_with_seed(worker->id);
+
+    for (int i = 0; i < worker->iterations; i++) {
+        char word[32];
+        g_snprintf(word, sizeof word, "zt%dw%d", worker->id, i);
+
+        switch (g_rand_int_range(rand, 0, 5)) {
+        case 0: {
+            EnchantDict *own = enchant_broker_request_dict(broker, "qaa");
+            if (own == NULL)
+                Fail(worker, "request_dict");
+            else {
+                if (enchant_dict_check(own, "hello", -1) != 0)
+                    Fail(worker, "check through own request");
+                enchant_broker_free_dict(broker, own);
+            }
+            break;
+        }
+        case 1:
+            if (enchant_dict_check(dict, "hello", -1) != 0 || enchant_dict_check(dict, word, -1) != 1)
+                Fail(worker, "check");
+            break;
+        case 2: {
+            size_t n_suggs = 0;
+            char **suggs = enchant_dict_suggest(dict, word, -1, &n_suggs);
+            if (suggs == NULL || n_suggs == 0)
+                Fail(worker, "suggest");
+            enchant_dict_free_string_list(dict, suggs);
+            break;
+        }
+        case 3:
+            enchant_dict_add(dict, word, -1);
+            if (enchant_dict_check(dict, word, -1) != 0)
+                Fail(worker, "check after add");
+            enchant_dict_remove(dict, word, -1);
+            if (enchant_dict_check(dict, word, -1) != 1)
+                Fail(worker, "check after remove");
+            break;
+        case 4:
+            if (enchant_dict_check(worker->fixture->_pwl, "zext0", -1) < 0)
+                Fail(worker, "check in appended-to word list");
+            break;
+        }
+    }
+
+    g_rand_free(rand);
+    return NULL;
+}
+
+struct Appender
+{
+    std::string filename;
+    int n_words;
+};
+
+// Appends to the personal word list as another process would, through
+// a file of its own
+static gpointer
+Append(gpointer data)
+{
+    Appender *appender = static_cast<Appender *>(data);
+    for (int i = 0; i < appender->n_words; i++) {
+        FILE *file = fopen(appender->filename.c_str(), "a");
+        if (file) {
+            fprintf(file, "zext%d\n", i);
+            fclose(file);
+        }
+        g_usleep(500);
+    }
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantBrokerConcurrency_TestFixture,
+             EnchantBrokerConcurrency_MixedCallsFromManyThreads_NoFailures)
+{
+    gint failures = 0;
+    Worker workers[8];
+    GThread *threads[G_N_ELEMENTS(workers)];
+    for (size_t i = 0; i < G_N_ELEMENTS(workers); i++) {
+        workers[i].fixture = this;
+        workers[i].id = (int) i;
+        workers[i].iterations = 500;
+        workers[i].failures = &failures;
+        threads[i] = g_thread_new("hammer", Hammer, &workers[i]);
+    }
+
+    Appender appender = { _pwlFileName, 200 };
+    GThread *appending = g_thread_new("append", Append, &appender);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        g_thread_join(threads[i]);
+    g_thread_join(appending);
+
+    CHECK_EQUAL(0, failures);
+    CHECK_EQUAL(0, enchant_dict_check(_pwl, "zext0", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_pwl, "zext199", -1));
+    for (size_t i = 0; i < G_N_ELEMENTS(workers); i++) {
+        char word[32];
+        g_snprintf(word, sizeof word, "zt%dw%d", (int) i, 0);
+        CHECK(!enchant_dict_is_added(_dict, word, -1));
+    }
+}
+
+struct Adder
+{
+    EnchantDict *dict;
+    int id;
+};
+
+// Adds words of its own, removing every other one again
+static gpointer
+AddAndRemove(gpointer data)
+{
+    Adder *adder = static_cast<Adder *>(data);
+    for (int i = 0; i < 200; i++) {
+        char word[32];
+        g_snprintf(word, sizeof word, "za%dw%d", adder->id, i);
+        enchant_dict_add(adder->dict, word, -1);
+        if (i % 2)
+            enchant_dict_remove(adder->dict, word, -1);
+    }
+    return NULL;
+}
+
+TEST_FIXTURE(EnchantBrokerConcurrency_TestFixture,
+             EnchantBrokerConcurrency_AddsAndRemovesFromManyThreads_AllRecorded)
+{
+    Adder adders[8];
+    GThread *threads[G_N_ELEMENTS(adders)];
+    for (size_t i = 0; i < G_N_ELEMENTS(adders); i++) {
+        adders[i].dict = _pwl;
+        adders[i].id = (int) i;
+        threads[i] = g_thread_new("add", AddAndRemove, &adders[i]);
+    }
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        g_thread_join(threads[i]);
+
+    // what the file says once its removal lines are played back
+    gchar *contents = NULL;
+    CHECK(g_file_get_contents(_pwlFileName.c_str(), &contents, NULL, NULL));
+    std::set<std::string> written;
+    gchar **lines = g_strsplit(contents ? contents : "", "\n", -1);
+    for (gchar **line = lines; *line; line++) {
+        if (g_str_has_prefix(*line, "#!remove "))
+            written.erase(*line + strlen("#!remove "));
+        else if (**line)
+            written.insert(*line);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+
+    for (size_t i = 0; i < G_N_ELEMENTS(adders); i++)
+        for (int j = 0; j < 200; j++) {
+            char word[32];
+            g_snprintf(word, sizeof word, "za%dw%d", (int) i, j);
+            CHECK_EQUAL(j % 2, enchant_dict_check(_pwl, word, -1));
+            CHECK_EQUAL(j % 2 == 0, written.count(word) == 1);
+        }
+}
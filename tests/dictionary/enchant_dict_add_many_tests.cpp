@@ -0,0 +1,149 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int addToPersonalCalls;
+
+static void
+MockDictionaryAddToPersonal (EnchantDict * dict, const char *const word, size_t len)
+{
+    dict;
+    word;
+    len;
+    addToPersonalCalls++;
+}
+
+static EnchantDict* MockProviderRequestAddToPersonalMockDictionary(EnchantProvider * me, const char *tag)
+{
+    
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->add_to_personal = MockDictionaryAddToPersonal;
+    return dict;
+}
+
+static void DictionaryAddToPersonal_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestAddToPersonalMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryAddMany_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryAddMany_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryAddToPersonal_ProviderConfiguration)
+    { 
+        addToPersonalCalls = 0;
+    }
+};
+
+/**
+ * enchant_dict_add_many
+ * @dict: A non-null #EnchantDict
+ * @words: The words you wish to add to your personal dictionary, as NUL-terminated UTF-8 strings
+ * @n_words: The number of @words
+ *
+ * Adds each word as enchant_dict_add() would, but writes them to the personal
+ * dictionary file all at once.  Null, empty and invalid words are skipped.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_WordsExistInDictionary)
+{
+    const char *words[] = { "hello", "world", "wörld" };
+    enchant_dict_add_many(_dict, words, 3);
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+    CHECK(IsWordInDictionary("wörld"));
+    CHECK(IsWordInSession("world"));
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_IsPermanent)
+{
+    const char *words[] = { "hello", "world" };
+    enchant_dict_add_many(_dict, words, 2);
+
+    ReloadTestDictionary();
+
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_PassedOnToProvider)
+{
+    const char *words[] = { "hello", "world" };
+    enchant_dict_add_many(_dict, words, 2);
+    CHECK_EQUAL(2, addToPersonalCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_WordExistsInExclude_RemovedFromExcludeAddedToPersonal)
+{
+    enchant_dict_remove(_dict, "personal", -1);
+    CHECK(ExcludeFileHasContents());
+
+    const char *words[] = { "personal" };
+    enchant_dict_add_many(_dict, words, 1);
+    CHECK(!ExcludeFileHasContents());
+    CHECK(IsWordInDictionary("personal"));
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_InvalidWords_Skipped)
+{
+    const char *words[] = { "hello", NULL, "", "\xa5\xf1\x08", "world" };
+    enchant_dict_add_many(_dict, words, 5);
+    CHECK_EQUAL(2, addToPersonalCalls);
+    CHECK(IsWordInDictionary("hello"));
+    CHECK(IsWordInDictionary("world"));
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_NoWords_NothingAdded)
+{
+    enchant_dict_add_many(_dict, NULL, 0);
+    CHECK_EQUAL(0, addToPersonalCalls);
+    CHECK(!PersonalWordListFileHasContents());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_NullDictionary_NotAdded)
+{
+    const char *words[] = { "hello" };
+    enchant_dict_add_many(NULL, words, 1);
+    CHECK_EQUAL(0, addToPersonalCalls);
+}
+
+TEST_FIXTURE(EnchantDictionaryAddMany_TestFixture,
+             EnchantDictionaryAddMany_NullWords_NotAdded)
+{
+    enchant_dict_add_many(_dict, NULL, 1);
+    CHECK_EQUAL(0, addToPersonalCalls);
+}
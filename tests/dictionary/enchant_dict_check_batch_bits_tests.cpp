@@ -0,0 +1,150 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static EnchantDict* MockProviderRequestCheckMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionaryCheckBatchBits_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryCheckBatchBits_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryCheckBatchBits_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryCheckBatchBits_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_check_batch_bits
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @misspelled: Where to put (@n_words + 7) / 8 bytes of bits, one per word
+ *
+ * Returns: the number of bits set, or -1 if any of those pre-conditions are not met
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_MisspelledWordsSet)
+{
+    const char *words[] = { "hello", "helo", "hello" };
+    uint8_t bits = 0xff;
+
+    CHECK_EQUAL(1, enchant_dict_check_batch_bits(_dict, words, NULL, 3, &bits));
+    CHECK_EQUAL(0x02, bits);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_ManyWords_SameAsCheckBatch)
+{
+    std::vector<const char *> words;
+    for (int i = 0; i < 21; i++)
+        words.push_back(i % 3 == 0 ? "helo" : "hello");
+    std::vector<int> results(words.size());
+    enchant_dict_check_batch(_dict, &words[0], NULL, words.size(), &results[0]);
+
+    uint8_t bits[3] = { 0xff, 0xff, 0xff };
+    CHECK_EQUAL(7, enchant_dict_check_batch_bits(_dict, &words[0], NULL, words.size(), bits));
+    for (size_t i = 0; i < words.size(); i++)
+        CHECK_EQUAL(results[i] != 0, (bits[i / 8] >> (i % 8)) & 1);
+    // the bits past the words are cleared
+    CHECK_EQUAL(0, bits[2] >> 5);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_Lengths_Used)
+{
+    const char *words[] = { "hellodisregard me", "hello" };
+    ssize_t lens[] = { 5, -1 };
+    uint8_t bits;
+
+    CHECK_EQUAL(0, enchant_dict_check_batch_bits(_dict, words, lens, 2, &bits));
+    CHECK_EQUAL(0, bits);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_WordAddedToPersonal_NotSet)
+{
+    enchant_dict_add(_dict, "helo", -1);
+    const char *words[] = { "hello", "helo" };
+    uint8_t bits;
+
+    CHECK_EQUAL(0, enchant_dict_check_batch_bits(_dict, words, NULL, 2, &bits));
+    CHECK_EQUAL(0, bits);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_NoWords_Zero)
+{
+    CHECK_EQUAL(0, enchant_dict_check_batch_bits(_dict, NULL, NULL, 0, NULL));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_InvalidWords_Set)
+{
+    const char *words[] = { NULL, "", "\xa5\xf1\x08", "hello" };
+    uint8_t bits;
+
+    CHECK_EQUAL(3, enchant_dict_check_batch_bits(_dict, words, NULL, 4, &bits));
+    CHECK_EQUAL(0x07, bits);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_NullDictionary_Minus1)
+{
+    const char *words[] = { "hello" };
+    uint8_t bits;
+    CHECK_EQUAL(-1, enchant_dict_check_batch_bits(NULL, words, NULL, 1, &bits));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchBits_TestFixture,
+             EnchantDictionaryCheckBatchBits_NullBits_Minus1)
+{
+    const char *words[] = { "hello" };
+    CHECK_EQUAL(-1, enchant_dict_check_batch_bits(_dict, words, NULL, 1, NULL));
+}
@@ -0,0 +1,240 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictCheckCount;
+static int dictCheckBatchCount;
+static size_t dictCheckBatchWords;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    dictCheckCount++;
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static void
+MockDictionaryCheckBatch (EnchantDict * dict, const char *const *words, const size_t *lens,
+                          size_t n, int *results)
+{
+    dictCheckBatchCount++;
+    dictCheckBatchWords += n;
+    for (size_t i = 0; i < n; i++)
+        results[i] = MockDictionaryCheck(dict, words[i], lens[i]);
+}
+
+static EnchantDict* MockProviderRequestCheckMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static EnchantDict* MockProviderRequestCheckBatchMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestCheckMockDictionary(me, tag);
+    dict->check_batch = MockDictionaryCheckBatch;
+    return dict;
+}
+
+static void DictionaryCheck_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void DictionaryCheckBatch_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckBatchMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryCheckBatch_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryCheckBatch_TestFixture(ConfigureHook userConfiguration = DictionaryCheckBatch_ProviderConfiguration):
+            EnchantDictionaryTestFixture(userConfiguration)
+    { 
+        dictCheckCount = 0;
+        dictCheckBatchCount = 0;
+        dictCheckBatchWords = 0;
+    }
+};
+
+struct EnchantDictionaryCheckBatchFallback_TestFixture : EnchantDictionaryCheckBatch_TestFixture
+{
+    //Setup
+    EnchantDictionaryCheckBatchFallback_TestFixture():
+            EnchantDictionaryCheckBatch_TestFixture(DictionaryCheck_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_check_batch
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to check, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @results: Where to put what enchant_dict_check would return for each word
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_ProviderHasCheckBatch_CalledOnce)
+{
+    const char *words[] = { "hello", "helo", "hello" };
+    int results[3];
+    enchant_dict_check_batch(_dict, words, NULL, 3, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(1, results[1]);
+    CHECK_EQUAL(0, results[2]);
+    CHECK_EQUAL(1, dictCheckBatchCount);
+    CHECK_EQUAL(3, dictCheckBatchWords);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatchFallback_TestFixture,
+             EnchantDictionaryCheckBatch_ProviderLacksCheckBatch_CheckCalledForEach)
+{
+    const char *words[] = { "hello", "helo" };
+    int results[2];
+    enchant_dict_check_batch(_dict, words, NULL, 2, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(1, results[1]);
+    CHECK_EQUAL(2, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_Lengths_Used)
+{
+    const char *words[] = { "hello world", "hello", "helloo" };
+    ssize_t lens[] = { 5, -1, 5 };
+    int results[3];
+    enchant_dict_check_batch(_dict, words, lens, 3, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(0, results[1]);
+    CHECK_EQUAL(0, results[2]);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_SessionAndPwlWords_NotPassedToProvider)
+{
+    enchant_dict_add_to_session(_dict, "session", -1);
+    enchant_dict_add(_dict, "personal", -1);
+    enchant_dict_remove(_dict, "hello", -1);
+
+    const char *words[] = { "session", "personal", "hello", "helo" };
+    int results[4];
+    enchant_dict_check_batch(_dict, words, NULL, 4, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(0, results[1]);
+    CHECK_EQUAL(1, results[2]);
+    CHECK_EQUAL(1, results[3]);
+    CHECK_EQUAL(1, dictCheckBatchWords);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_SameAsCheck)
+{
+    enchant_dict_add(_dict, "personal", -1);
+    const char *words[] = { "personal", "Personal", "PERSONAL", "hello", "Hello", "helo" };
+    int results[6];
+    enchant_dict_check_batch(_dict, words, NULL, 6, results);
+
+    for (size_t i = 0; i < 6; i++)
+        CHECK_EQUAL(enchant_dict_check(_dict, words[i], -1), results[i]);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_AllDecidedBySession_ProviderNotCalled)
+{
+    enchant_dict_add_to_session(_dict, "session", -1);
+    const char *words[] = { "session" };
+    int results[1];
+    enchant_dict_check_batch(_dict, words, NULL, 1, results);
+
+    CHECK_EQUAL(0, results[0]);
+    CHECK_EQUAL(0, dictCheckBatchCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_NoWords_DoNothing)
+{
+    enchant_dict_check_batch(_dict, NULL, NULL, 0, NULL);
+    CHECK_EQUAL(0, dictCheckBatchCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_InvalidWords_Negative)
+{
+    const char *words[] = { NULL, "", "\xa5\xf1\x08", "hello" };
+    int results[4];
+    enchant_dict_check_batch(_dict, words, NULL, 4, results);
+
+    CHECK(results[0] < 0);
+    CHECK(results[1] < 0);
+    CHECK(results[2] < 0);
+    CHECK_EQUAL(0, results[3]);
+    CHECK_EQUAL(1, dictCheckBatchWords);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_InvalidAfterLongAsciiRun_Negative)
+{
+    const char *words[] = { "helloworldhello\xff", "hello\0worldhello", "helloworldhell\xc3\xa9" };
+    ssize_t lens[] = { -1, 16, -1 };
+    int results[3];
+    enchant_dict_check_batch(_dict, words, lens, 3, results);
+
+    CHECK(results[0] < 0);
+    CHECK(results[1] < 0);
+    CHECK_EQUAL(1, results[2]);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_NullDictionary_DoNothing)
+{
+    const char *words[] = { "hello" };
+    int results[1] = { 42 };
+    enchant_dict_check_batch(NULL, words, NULL, 1, results);
+    CHECK_EQUAL(42, results[0]);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckBatch_TestFixture,
+             EnchantDictionaryCheckBatch_NullResults_DoNothing)
+{
+    const char *words[] = { "hello" };
+    enchant_dict_check_batch(_dict, words, NULL, 1, NULL);
+    CHECK_EQUAL(0, dictCheckBatchCount);
+}
@@ -0,0 +1,234 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include <vector>
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictCheckBatchCount;
+static int dictCheckBatchError;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static void
+MockDictionaryCheckBatch (EnchantDict * dict, const char *const *words, const size_t *lens,
+                          size_t n, int *results)
+{
+    dictCheckBatchCount++;
+    for (size_t i = 0; i < n; i++)
+        results[i] = dictCheckBatchError ? -1 : MockDictionaryCheck(dict, words[i], lens[i]);
+}
+
+static EnchantDict* MockProviderRequestCheckTextMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    dict->check_batch = MockDictionaryCheckBatch;
+    return dict;
+}
+
+static void DictionaryCheckText_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckTextMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct Misspelling
+{
+    std::string word;
+    size_t offset;
+    size_t charOffset;
+    size_t charLength;
+};
+
+static void
+CollectMisspelling (EnchantDict *, const char *const word, size_t len,
+                    size_t offset, size_t char_offset, size_t char_len, void *user_data)
+{
+    std::vector<Misspelling> *misspellings = static_cast<std::vector<Misspelling> *>(user_data);
+    Misspelling misspelling = { std::string(word, len), offset, char_offset, char_len };
+    misspellings->push_back(misspelling);
+}
+
+struct EnchantDictionaryCheckText_TestFixture : EnchantDictionaryTestFixture
+{
+    std::vector<Misspelling> misspellings;
+
+    //Setup
+    EnchantDictionaryCheckText_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryCheckText_ProviderConfiguration)
+    { 
+        dictCheckBatchCount = 0;
+        dictCheckBatchError = 0;
+    }
+
+    int CheckText(const char *text, ssize_t len = -1)
+    {
+        return enchant_dict_check_text(_dict, text, len, CollectMisspelling, &misspellings);
+    }
+};
+
+/**
+ * enchant_dict_check_text
+ * @dict: A non-null #EnchantDict
+ * @text: The non-null text you wish to check, in UTF-8 encoding
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ * @fn: A #EnchantMisspellingFn, or %null if you only want the count
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Returns: The number of misspelled words, or -1 on error
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_ReportsMisspelledWordsInOrder)
+{
+    CHECK_EQUAL(2, CheckText("hello helo, hello wrld!"));
+
+    CHECK_EQUAL(2, misspellings.size());
+    CHECK_EQUAL("helo", misspellings[0].word);
+    CHECK_EQUAL(6, misspellings[0].offset);
+    CHECK_EQUAL(6, misspellings[0].charOffset);
+    CHECK_EQUAL(4, misspellings[0].charLength);
+    CHECK_EQUAL("wrld", misspellings[1].word);
+    CHECK_EQUAL(18, misspellings[1].offset);
+    CHECK_EQUAL(18, misspellings[1].charOffset);
+    CHECK_EQUAL(4, misspellings[1].charLength);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_ProviderCalledOnce)
+{
+    CheckText("one two three four five six seven");
+    CHECK_EQUAL(1, dictCheckBatchCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_MultiByte_ByteAndCharOffsetsDiffer)
+{
+    // "hélo" is 5 bytes but 4 characters
+    CHECK_EQUAL(2, CheckText("\xc3\xa9t\xc3\xa9 h\xc3\xa9lo"));
+
+    CHECK_EQUAL(2, misspellings.size());
+    CHECK_EQUAL(0, misspellings[0].offset);
+    CHECK_EQUAL(3, misspellings[0].charLength);
+    CHECK_EQUAL("h\xc3\xa9lo", misspellings[1].word);
+    CHECK_EQUAL(6, misspellings[1].offset);
+    CHECK_EQUAL(4, misspellings[1].charOffset);
+    CHECK_EQUAL(4, misspellings[1].charLength);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_TrailingQuoteAndInnerHyphen)
+{
+    CHECK_EQUAL(3, CheckText("'tis well-known' -x"));
+
+    CHECK_EQUAL(3, misspellings.size());
+    CHECK_EQUAL("'tis", misspellings[0].word);
+    CHECK_EQUAL("well-known", misspellings[1].word);
+    CHECK_EQUAL("x", misspellings[2].word);
+    CHECK_EQUAL(18, misspellings[2].offset);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_SameWordsAsIsWordCharacter)
+{
+    const char *text = "x-ray's, (co-op) don't—it's";
+    CheckText(text);
+
+    for (size_t i = 0; i < misspellings.size(); i++)
+    {
+        const char *word = text + misspellings[i].offset;
+        const char *last = g_utf8_prev_char(word + misspellings[i].word.size());
+        CHECK(enchant_dict_is_word_character(_dict, g_utf8_get_char(word), 0));
+        CHECK(enchant_dict_is_word_character(_dict, g_utf8_get_char(last), 2));
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_SessionWords_NotReported)
+{
+    enchant_dict_add_to_session(_dict, "helo", -1);
+    CHECK_EQUAL(1, CheckText("helo wrld"));
+    CHECK_EQUAL(1, misspellings.size());
+    CHECK_EQUAL("wrld", misspellings[0].word);
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_Length_Used)
+{
+    CHECK_EQUAL(0, CheckText("hello wrld", 5));
+    CHECK_EQUAL(0, misspellings.size());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_NullCallback_CountsOnly)
+{
+    CHECK_EQUAL(2, enchant_dict_check_text(_dict, "helo wrld", -1, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_NoWords_ProviderNotCalled)
+{
+    CHECK_EQUAL(0, CheckText(" ... -- !? "));
+    CHECK_EQUAL(0, CheckText(""));
+    CHECK_EQUAL(0, dictCheckBatchCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_ProviderFails_NothingReported)
+{
+    dictCheckBatchError = 1;
+    CHECK_EQUAL(-1, CheckText("helo wrld"));
+    CHECK_EQUAL(0, misspellings.size());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_InvalidUtf8_Error)
+{
+    CHECK_EQUAL(-1, CheckText("helo \xa5\xf1\x08"));
+    CHECK_EQUAL(0, misspellings.size());
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_NullDictionary_Error)
+{
+    CHECK_EQUAL(-1, enchant_dict_check_text(NULL, "helo", -1, CollectMisspelling, &misspellings));
+}
+
+TEST_FIXTURE(EnchantDictionaryCheckText_TestFixture,
+             EnchantDictionaryCheckText_NullText_Error)
+{
+    CHECK_EQUAL(-1, CheckText(NULL));
+}
@@ -0,0 +1,196 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+struct EnchantDictionaryComplete_TestFixture : EnchantDictionaryTestFixture
+{
+    std::vector<std::string> Complete(const std::string& prefix, size_t max_words = 0)
+    {
+        std::vector<std::string> result;
+        size_t cWords = 0;
+        char **words = enchant_dict_complete(_dict, prefix.c_str(), prefix.size(), max_words, &cWords);
+        if (words)
+            result.assign(words, words + cWords);
+        FreeStringList(words);
+        return result;
+    }
+};
+
+/**
+ * enchant_dict_complete
+ * @dict: A non-null #EnchantDict
+ * @prefix: The non-null start of a word, in UTF-8 encoding
+ * @len: The byte length of @prefix, or -1 for strlen (@prefix)
+ * @max_words: The most words wanted, or 0 for no limit
+ * @out_n_words: The location to store the # of words returned, or %null
+ *
+ * Finds the words of the personal dictionary that start with @prefix.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_WordsWithPrefix_InOrder)
+{
+    std::vector<std::string> words;
+    words.push_back("helpful");
+    words.push_back("hello");
+    words.push_back("world");
+    words.push_back("help");
+    AddWordsToDictionary(words);
+
+    std::vector<std::string> completions = Complete("hel");
+    CHECK_EQUAL(3, completions.size());
+    if (completions.size() == 3)
+    {
+        CHECK_EQUAL("hello", completions[0]);
+        CHECK_EQUAL("help", completions[1]);
+        CHECK_EQUAL("helpful", completions[2]);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_WholeWord_WordItselfFirst)
+{
+    AddWordToDictionary("helpful");
+    AddWordToDictionary("help");
+
+    std::vector<std::string> completions = Complete("help");
+    CHECK_EQUAL(2, completions.size());
+    if (completions.size() == 2)
+        CHECK_EQUAL("help", completions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_SingleWord_Found)
+{
+    AddWordToDictionary("hello");
+
+    std::vector<std::string> completions = Complete("he");
+    CHECK_EQUAL(1, completions.size());
+    CHECK_EQUAL(0, Complete("hex").size());
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_MaxWords_Bounded)
+{
+    std::vector<std::string> words;
+    words.push_back("aa");
+    words.push_back("ab");
+    words.push_back("ac");
+    words.push_back("ad");
+    AddWordsToDictionary(words);
+
+    std::vector<std::string> completions = Complete("a", 2);
+    CHECK_EQUAL(2, completions.size());
+    if (completions.size() == 2)
+    {
+        CHECK_EQUAL("aa", completions[0]);
+        CHECK_EQUAL("ab", completions[1]);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_LowercasePrefix_AnyCase)
+{
+    AddWordToDictionary("Hello");
+    AddWordToDictionary("hello");
+
+    std::vector<std::string> completions = Complete("hel");
+    CHECK_EQUAL(2, completions.size());
+    if (completions.size() == 2)
+    {
+        CHECK_EQUAL("Hello", completions[0]);
+        CHECK_EQUAL("hello", completions[1]);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_CapitalizedPrefix_ExactCase)
+{
+    AddWordToDictionary("Hello");
+    AddWordToDictionary("help");
+
+    std::vector<std::string> completions = Complete("Hel");
+    CHECK_EQUAL(1, completions.size());
+    if (completions.size() == 1)
+        CHECK_EQUAL("Hello", completions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_Composed_OriginalSpelling)
+{
+    AddWordToDictionary("caf\xc3\xa9");
+
+    std::vector<std::string> completions = Complete("caf");
+    CHECK_EQUAL(1, completions.size());
+    if (completions.size() == 1)
+        CHECK_EQUAL("caf\xc3\xa9", completions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_Excluded_LeftOut)
+{
+    AddWordToDictionary("hello");
+    AddWordToDictionary("help");
+    RemoveWordFromDictionary("hello");
+
+    std::vector<std::string> completions = Complete("hel");
+    CHECK_EQUAL(1, completions.size());
+    if (completions.size() == 1)
+        CHECK_EQUAL("help", completions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_NothingFound_Null)
+{
+    size_t cWords = 1;
+    CHECK(enchant_dict_complete(_dict, "hel", -1, 0, &cWords) == NULL);
+    CHECK_EQUAL(0, cWords);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_NullDictionary_Null)
+{
+    CHECK(enchant_dict_complete(NULL, "hel", -1, 0, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_NullPrefix_Null)
+{
+    AddWordToDictionary("hello");
+    CHECK(enchant_dict_complete(_dict, NULL, -1, 0, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionaryComplete_TestFixture,
+             EnchantDictionaryComplete_InvalidUtf8_Null)
+{
+    AddWordToDictionary("hello");
+    CHECK(enchant_dict_complete(_dict, "\xa5\xf1\x08", -1, 0, NULL) == NULL);
+}
@@ -56,6 +56,22 @@ TEST_FIXTURE(EnchantDictionaryTestFixture,
     CHECK_EQUAL(errorMessage.c_str(), enchant_dict_get_error(_pwl));
 }
 
+static gpointer SetErrorOnOtherThread(gpointer dict)
+{
+    enchant_dict_set_error((EnchantDict*) dict, "something bad happened");
+    const char* error = enchant_dict_get_error((EnchantDict*) dict);
+    return GINT_TO_POINTER(error != NULL && strcmp(error, "something bad happened") == 0);
+}
+
+TEST_FIXTURE(EnchantDictionaryTestFixture, 
+             EnchantDictionaryGetError_ErrorOnOtherThread_Null)
+{
+    GThread* thread = g_thread_new("error", SetErrorOnOtherThread, _dict);
+    CHECK(GPOINTER_TO_INT(g_thread_join(thread)));
+
+    CHECK_EQUAL((void*)NULL, (void*)enchant_dict_get_error(_dict));
+}
+
 TEST_FIXTURE(EnchantDictionaryTestFixture, 
              EnchantDictionaryGetError_NoPreviousError_Null)
 {
@@ -0,0 +1,159 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+#include <map>
+
+static size_t
+MockDictionaryGetMemoryUsage (EnchantDict *)
+{
+    return 12345;
+}
+
+static EnchantDict* MockProviderRequestMemoryMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->get_memory_usage = MockDictionaryGetMemoryUsage;
+    return dict;
+}
+
+static void DictionaryMemory_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestMemoryMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectMemory (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *usage = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*usage)[name] = value;
+}
+
+struct EnchantDictionaryGetMemoryUsage_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryGetMemoryUsage_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryMemory_ProviderConfiguration)
+    { }
+
+    std::map<std::string, uint64_t> GetMemoryUsage()
+    {
+        std::map<std::string, uint64_t> usage;
+        enchant_dict_get_memory_usage(_dict, CollectMemory, &usage);
+        return usage;
+    }
+};
+
+/**
+ * enchant_dict_get_memory_usage
+ * @dict: A non-null #EnchantDict
+ * @fn: An optional #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Estimates the memory @dict takes up, reporting it to @fn if given one
+ * figure at a time, in bytes.
+ *
+ * Returns: the sum of the figures
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_ReturnsSumOfFigures)
+{
+    std::map<std::string, uint64_t> usage;
+    uint64_t total = enchant_dict_get_memory_usage(_dict, CollectMemory, &usage);
+
+    uint64_t sum = 0;
+    for (std::map<std::string, uint64_t>::const_iterator i = usage.begin(); i != usage.end(); ++i)
+        sum += i->second;
+    CHECK_EQUAL(sum, total);
+    CHECK(usage.count("personal"));
+    CHECK(usage.count("exclude"));
+    CHECK(usage.count("mapped"));
+    CHECK(usage.count("session_words"));
+    CHECK(usage.count("check_cache"));
+    CHECK(usage.count("suggest_cache"));
+    CHECK(usage["other"] > 0);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_ProviderEstimate_Reported)
+{
+    CHECK_EQUAL(12345, GetMemoryUsage()["provider"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_WordsAdded_PersonalGrows)
+{
+    enchant_dict_check(_dict, "hello", -1);
+    uint64_t before = GetMemoryUsage()["personal"];
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 1000; i++)
+        words.push_back("word" + std::to_string(i));
+    AddWordsToDictionary(words);
+
+    CHECK(GetMemoryUsage()["personal"] > before);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_SessionWords_Counted)
+{
+    uint64_t before = GetMemoryUsage()["session_words"];
+    enchant_dict_add_to_session(_dict, "session", -1);
+    CHECK(GetMemoryUsage()["session_words"] > before);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_Caches_Counted)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    uint64_t checkBefore = GetMemoryUsage()["check_cache"];
+    uint64_t suggestBefore = GetMemoryUsage()["suggest_cache"];
+
+    enchant_dict_check(_dict, "hello", -1);
+    FreeStringList(enchant_dict_suggest(_dict, "helo", -1, NULL));
+
+    std::map<std::string, uint64_t> usage = GetMemoryUsage();
+    CHECK(usage["check_cache"] > checkBefore);
+    CHECK(usage["suggest_cache"] > suggestBefore);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_NullFn_ReturnsTotal)
+{
+    CHECK(enchant_dict_get_memory_usage(_dict, NULL, NULL) > 12345);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryGetMemoryUsage_TestFixture,
+             EnchantDictionaryGetMemoryUsage_NullDictionary_0)
+{
+    std::map<std::string, uint64_t> usage;
+    CHECK_EQUAL(0, enchant_dict_get_memory_usage(NULL, CollectMemory, &usage));
+    CHECK(usage.empty());
+}
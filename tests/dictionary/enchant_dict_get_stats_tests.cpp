@@ -0,0 +1,224 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+#include <map>
+
+extern "C" ENCHANT_MODULE_EXPORT
+void enchant_dict_get_work_stats(EnchantDict * dict, EnchantStatsFn fn, void * user_data);
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static EnchantDict* MockProviderRequestStatsMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionaryStats_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestStatsMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectStats (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *stats = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*stats)[name] = value;
+}
+
+struct EnchantDictionaryGetStats_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryGetStats_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryStats_ProviderConfiguration)
+    { }
+
+    std::map<std::string, uint64_t> GetStats()
+    {
+        std::map<std::string, uint64_t> stats;
+        enchant_dict_get_stats(_dict, CollectStats, &stats);
+        return stats;
+    }
+
+    std::map<std::string, uint64_t> GetWorkStats()
+    {
+        std::map<std::string, uint64_t> stats;
+        enchant_dict_get_work_stats(_dict, CollectStats, &stats);
+        return stats;
+    }
+};
+
+/**
+ * enchant_dict_get_stats
+ * @dict: A non-null #EnchantDict
+ * @fn: A non-null #EnchantStatsFn
+ * @user_data: Optional user-data
+ *
+ * Reports what @dict has done since it was loaded, one counter at a time.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_NothingDone_AllZero)
+{
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK(!stats.empty());
+    CHECK_EQUAL(0, stats["checks"]);
+    CHECK_EQUAL(0, stats["suggests"]);
+    CHECK_EQUAL(0, stats["provider_checks"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_Checks_CountedByWhatDecided)
+{
+    enchant_dict_add_to_session(_dict, "session", -1);
+    AddWordToDictionary("personal");
+    RemoveWordFromDictionary("hello");
+
+    enchant_dict_check(_dict, "session", -1);
+    enchant_dict_check(_dict, "personal", -1);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "world", -1);
+    enchant_dict_check(_dict, "again", -1);
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(5, stats["checks"]);
+    CHECK_EQUAL(1, stats["checks_session"]);
+    CHECK_EQUAL(1, stats["checks_personal"]);
+    CHECK_EQUAL(1, stats["checks_exclude"]);
+    CHECK_EQUAL(2, stats["checks_provider"]);
+    CHECK_EQUAL(2, stats["provider_checks"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_CheckBatch_EachWordCounted)
+{
+    const char *words[] = { "hello", "world", "again" };
+    int results[3];
+    enchant_dict_check_batch(_dict, words, NULL, 3, results);
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(3, stats["checks"]);
+    CHECK_EQUAL(3, stats["checks_provider"]);
+    CHECK_EQUAL(1, stats["provider_checks"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_CheckCache_HitsCounted)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(2, stats["checks_provider"]);
+    CHECK_EQUAL(1, stats["check_cache_hits"]);
+    CHECK_EQUAL(1, stats["check_cache_misses"]);
+    CHECK_EQUAL(1, stats["provider_checks"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_Suggest_Counted)
+{
+    FreeStringList(enchant_dict_suggest(_dict, "helo", -1, NULL));
+    FreeStringList(enchant_dict_suggest(_dict, "wrld", -1, NULL));
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK_EQUAL(2, stats["suggests"]);
+    CHECK_EQUAL(2, stats["provider_suggests"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_ProviderLatency_BucketsCumulative)
+{
+    for (int i = 0; i < 10; i++)
+        enchant_dict_check(_dict, "world", -1);
+
+    std::map<std::string, uint64_t> stats = GetStats();
+    CHECK(stats["provider_checks_within_10us"] <= stats["provider_checks_within_100us"]);
+    CHECK(stats["provider_checks_within_100ms"] <= stats["provider_checks_within_1s"]);
+    CHECK_EQUAL(10, stats["provider_checks_within_1s"]);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_PwlChanged_ReloadCounted)
+{
+    enchant_dict_check(_dict, "world", -1);
+    uint64_t reloads = GetStats()["pwl_reloads"];
+
+    ExternalAddWordToDictionary("world");
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    CHECK(GetStats()["pwl_reloads"] > reloads);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_PwlChanged_FilePollCounted)
+{
+    enchant_dict_check(_dict, "world", -1);
+    uint64_t polls = GetWorkStats()["pwl_file_polls"];
+
+    ExternalAddWordToDictionary("world");
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    CHECK(GetWorkStats()["pwl_file_polls"] > polls);
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_PwlSuggest_NodesCounted)
+{
+    AddWordToDictionary("hello");
+    AddWordToDictionary("help");
+    CHECK_EQUAL(0, GetWorkStats()["pwl_suggest_nodes"]);
+
+    size_t n_suggs;
+    char **suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    enchant_dict_free_string_list(_dict, suggs);
+    CHECK(GetWorkStats()["pwl_suggest_nodes"] > 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_NullDictionary_DoNothing)
+{
+    std::map<std::string, uint64_t> stats;
+    enchant_dict_get_stats(NULL, CollectStats, &stats);
+    CHECK(stats.empty());
+}
+
+TEST_FIXTURE(EnchantDictionaryGetStats_TestFixture,
+             EnchantDictionaryGetStats_NullFn_DoNothing)
+{
+    enchant_dict_get_stats(_dict, NULL, NULL);
+}
@@ -0,0 +1,144 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <enchant-provider.h>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static gint dictSuggestCount;
+
+/* cuts its search short whenever it has a time budget */
+static char **
+PartialMockDictionarySuggestBounded (EnchantDict * dict, const char *const word, size_t len,
+                                     size_t, int, int timeout_ms, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&dictSuggestCount);
+    if (timeout_ms >= 0)
+        enchant_dict_set_suggest_partial(dict);
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&dictSuggestCount);
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestPartialMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = CountingMockDictionarySuggest;
+    dict->suggest_bounded = PartialMockDictionarySuggestBounded;
+    return dict;
+}
+
+static void DictionarySuggestPartial_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestPartialMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryGetSuggestPartial_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryGetSuggestPartial_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestPartial_ProviderConfiguration)
+    {
+        dictSuggestCount = 0;
+    }
+
+    void SuggestBounded(int timeout_ms)
+    {
+        size_t cSuggestions;
+        char **suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 0, -1, timeout_ms, &cSuggestions);
+        if (suggestions)
+            enchant_dict_free_string_list(_dict, suggestions);
+    }
+
+    void Suggest()
+    {
+        size_t cSuggestions;
+        char **suggestions = enchant_dict_suggest(_dict, "helo", -1, &cSuggestions);
+        if (suggestions)
+            enchant_dict_free_string_list(_dict, suggestions);
+    }
+};
+
+/**
+ * enchant_dict_get_suggest_partial
+ * @dict: A non-null #EnchantDict
+ *
+ * Tells whether the suggestions enchant_dict_suggest or
+ * enchant_dict_suggest_bounded last found for @dict on the calling
+ * thread are short of what could have been found: because the time
+ * ran out, a provider asked at the same time was left behind, or the
+ * spelling backend took a cheaper way to stay within the limits.
+ *
+ * Returns: 1 if they are, 0 if not
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryGetSuggestPartial_TestFixture,
+             EnchantDictionaryGetSuggestPartial_FullSearch_0)
+{
+    Suggest();
+    CHECK_EQUAL(0, enchant_dict_get_suggest_partial(_dict));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetSuggestPartial_TestFixture,
+             EnchantDictionaryGetSuggestPartial_ProviderCutShort_1)
+{
+    SuggestBounded(10000);
+    CHECK_EQUAL(1, enchant_dict_get_suggest_partial(_dict));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetSuggestPartial_TestFixture,
+             EnchantDictionaryGetSuggestPartial_FullSearchAfterPartial_0)
+{
+    SuggestBounded(10000);
+    Suggest();
+    CHECK_EQUAL(0, enchant_dict_get_suggest_partial(_dict));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetSuggestPartial_TestFixture,
+             EnchantDictionaryGetSuggestPartial_OtherDictionary_0)
+{
+    SuggestBounded(10000);
+    CHECK_EQUAL(0, enchant_dict_get_suggest_partial(_pwl));
+}
+
+TEST_FIXTURE(EnchantDictionaryGetSuggestPartial_TestFixture,
+             EnchantDictionaryGetSuggestPartial_TimeRunOut_1)
+{
+    SuggestBounded(0);
+    CHECK_EQUAL(1, enchant_dict_get_suggest_partial(_dict));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST(EnchantDictionaryGetSuggestPartial_NullDictionary_0)
+{
+    CHECK_EQUAL(0, enchant_dict_get_suggest_partial(NULL));
+}
@@ -0,0 +1,110 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static int
+MyMockDictionaryIsWordCharacter (EnchantDict *, uint32_t uc, size_t n)
+{
+    return uc == 'x' && n == 1;
+}
+
+static EnchantDict* MockProviderRequestIsWordCharacterMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->is_word_character = MyMockDictionaryIsWordCharacter;
+    return dict;
+}
+
+static void DictionaryWordCharacterTable_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestIsWordCharacterMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryWordCharacterTable_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryWordCharacterTable_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryWordCharacterTable_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_get_word_character_table
+ */
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionaryWordCharacterTable_TestFixture,
+             EnchantDictionaryGetWordCharacterTable_AgreesWithIsWordCharacter)
+{
+    const uint8_t *table = enchant_dict_get_word_character_table(_dict);
+    CHECK(table != NULL);
+
+    const uint32_t chars[] = { 'a', 'x', '-', '\'', 0xe0, 0x4e00 };
+    for (size_t i = 0; i < sizeof(chars) / sizeof(chars[0]); i++)
+        for (size_t n = 0; n <= 2; n++)
+            CHECK_EQUAL(enchant_dict_is_word_character(_dict, chars[i], n),
+                        (table[chars[i]] >> n) & 1);
+}
+
+TEST_FIXTURE(EnchantDictionaryWordCharacterTable_TestFixture,
+             EnchantDictionaryGetWordCharacterTable_SuppliedMethodAnswers)
+{
+    const uint8_t *table = enchant_dict_get_word_character_table(_dict);
+    CHECK_EQUAL(2, table['x']);
+    CHECK_EQUAL(0, table['a']);
+}
+
+TEST_FIXTURE(EnchantDictionaryWordCharacterTable_TestFixture,
+             EnchantDictionaryGetWordCharacterTable_SameTableEachTime)
+{
+    CHECK_EQUAL(enchant_dict_get_word_character_table(_dict),
+                enchant_dict_get_word_character_table(_dict));
+}
+
+TEST_FIXTURE(EnchantDictionaryWordCharacterTable_TestFixture,
+             EnchantDictionaryGetWordCharacterTable_NullDict_BuiltInTable)
+{
+    const uint8_t *table = enchant_dict_get_word_character_table(NULL);
+    CHECK(table != NULL);
+    CHECK_EQUAL(7, table['a']);
+    CHECK_EQUAL(2, table['-']);
+    CHECK_EQUAL(3, table['\'']);
+    CHECK_EQUAL(0, table[' ']);
+}
+
+/**
+ * enchant_get_lowercase_table
+ */
+TEST(EnchantGetLowercaseTable_LowersLetters)
+{
+    const uint16_t *table = enchant_get_lowercase_table();
+    CHECK(table != NULL);
+    CHECK_EQUAL('a', table['A']);
+    CHECK_EQUAL('a', table['a']);
+    CHECK_EQUAL('1', table['1']);
+    CHECK_EQUAL(0xe0, table[0xc0]);
+    CHECK_EQUAL(0x3c3, table[0x3a3]);
+}
@@ -27,6 +27,7 @@
 #include "EnchantDictionaryTestFixture.h"
 
 static bool dictIsWordCharacterCalled;
+static int dictIsWordCharacterCount;
 
 struct EnchantDictionaryIsWordCharacterTestFixtureBase : EnchantDictionaryTestFixture
 {
@@ -35,6 +36,7 @@ struct EnchantDictionaryIsWordCharacterTestFixtureBase : EnchantDictionaryTestFi
             EnchantDictionaryTestFixture(userConfiguration)
     { 
         dictIsWordCharacterCalled = false;
+        dictIsWordCharacterCount = 0;
     }
 };
 
@@ -42,7 +44,8 @@ static int
 MyMockDictionaryIsWordCharacter (EnchantDict * dict, uint32_t uc, size_t n)
 {
     dictIsWordCharacterCalled = true;
-    return 0;
+    dictIsWordCharacterCount++;
+    return uc == 'x' && n == 1;
 }
 
 static EnchantDict* MockProviderRequestIsWordCharacterMockDictionary(EnchantProvider * me, const char *tag)
@@ -108,6 +111,36 @@ TEST_FIXTURE(EnchantDictionaryIsWordCharacter_TestFixture,
     CHECK(dictIsWordCharacterCalled);
 }
 
+TEST_FIXTURE(EnchantDictionaryIsWordCharacter_TestFixture,
+             EnchantDictionaryIsWordCharacter_SuppliedMethodAnswersPerPosition)
+{
+    CHECK(!enchant_dict_is_word_character(_dict, 'x', 0));
+    CHECK(enchant_dict_is_word_character(_dict, 'x', 1));
+    CHECK(!enchant_dict_is_word_character(_dict, 'x', 2));
+    CHECK(!enchant_dict_is_word_character(_dict, 'a', 1));
+}
+
+TEST_FIXTURE(EnchantDictionaryIsWordCharacter_TestFixture,
+             EnchantDictionaryIsWordCharacter_SuppliedMethodAnswersRemembered)
+{
+    enchant_dict_is_word_character(_dict, 'a', 0);
+    int count = dictIsWordCharacterCount;
+
+    enchant_dict_is_word_character(_dict, 'b', 1);
+    enchant_dict_is_word_character(_dict, 0x4e00, 2);
+    CHECK_EQUAL(count, dictIsWordCharacterCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryIsWordCharacter_TestFixture,
+             EnchantDictionaryIsWordCharacter_BeyondBasicPlane_SuppliedMethodIsCalled)
+{
+    enchant_dict_is_word_character(_dict, 'a', 0);
+    int count = dictIsWordCharacterCount;
+
+    enchant_dict_is_word_character(_dict, 0x1d400, 0);
+    CHECK_EQUAL(count + 1, dictIsWordCharacterCount);
+}
+
 TEST_FIXTURE(EnchantDictionaryIsWordCharacterNotImplemented_TestFixture,
              EnchantDictionaryIsWordCharacter_NoSuppliedMethod)
 {
@@ -0,0 +1,156 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <string>
+#include <vector>
+
+struct EnchantDictMockLatency_TestFixture : MockLatencyEnvironment, EnchantBrokerTestFixture
+{
+    EnchantDict *_dict;
+
+    //Setup
+    EnchantDictMockLatency_TestFixture(const char *suggestLatency = "0", bool nonReentrant = true):
+            MockLatencyEnvironment("200", suggestLatency, "7", "10", nonReentrant),
+            EnchantBrokerTestFixture()
+    {
+        _dict = RequestDictionary("qaa");
+    }
+
+    //Teardown
+    ~EnchantDictMockLatency_TestFixture()
+    {
+        FreeDictionary(_dict);
+    }
+
+    unsigned int GetOverlaps()
+    {
+        unsigned int (*get_overlaps)(void);
+        if (!g_module_symbol(hModule, "mock_provider_get_overlaps", (gpointer *) &get_overlaps))
+            return (unsigned int) -1;
+        return get_overlaps();
+    }
+
+    unsigned int GetTimeouts()
+    {
+        unsigned int (*get_timeouts)(void);
+        if (!g_module_symbol(hModule, "mock_provider_get_timeouts", (gpointer *) &get_timeouts))
+            return (unsigned int) -1;
+        return get_timeouts();
+    }
+};
+
+struct EnchantDictMockLatencySlowSuggest_TestFixture : EnchantDictMockLatency_TestFixture
+{
+    //Setup
+    EnchantDictMockLatencySlowSuggest_TestFixture():
+            EnchantDictMockLatency_TestFixture("2000", false)
+    { }
+};
+
+static GMutex callbackLock;
+static GCond callbackCond;
+static bool callbackCalled;
+static size_t callbackNSuggs;
+
+static void
+SuggestCallback (EnchantDict * dict, char **suggs, size_t n_suggs, void *)
+{
+    g_mutex_lock(&callbackLock);
+    callbackNSuggs = suggs ? n_suggs : 0;
+    callbackCalled = true;
+    g_cond_broadcast(&callbackCond);
+    g_mutex_unlock(&callbackLock);
+    enchant_dict_free_string_list(dict, suggs);
+}
+
+static gpointer
+CheckWords (gpointer data)
+{
+    EnchantDict *dict = static_cast<EnchantDict *>(data);
+    gint failures = 0;
+    for (int i = 0; i < 50; i++) {
+        std::string word = std::string("word") + (char) ('a' + i % 26);
+        if (enchant_dict_check(dict, word.c_str(), word.size()) != 0)
+            failures++;
+        if (enchant_dict_check(dict, "wordz", -1) != 1)
+            failures++;
+    }
+    return GINT_TO_POINTER(failures);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictMockLatency_TestFixture,
+             EnchantDictMockLatency_Check_Answers)
+{
+    CHECK(_dict);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hellz", -1));
+}
+
+TEST_FIXTURE(EnchantDictMockLatency_TestFixture,
+             EnchantDictMockLatency_Suggest_CountAndLengthAsConfigured)
+{
+    size_t n_suggs;
+    char **suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    CHECK(suggs);
+    CHECK_EQUAL(7, n_suggs);
+    for (size_t i = 0; suggs && i < n_suggs; i++)
+        CHECK_EQUAL(10, strlen(suggs[i]));
+    enchant_dict_free_string_list(_dict, suggs);
+}
+
+TEST_FIXTURE(EnchantDictMockLatency_TestFixture,
+             EnchantDictMockLatency_NotThreadSafe_CallsTakeTurns)
+{
+    GThread *threads[4];
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        threads[i] = g_thread_new("check", CheckWords, _dict);
+
+    gint failures = 0;
+    for (size_t i = 0; i < G_N_ELEMENTS(threads); i++)
+        failures += GPOINTER_TO_INT(g_thread_join(threads[i]));
+
+    CHECK_EQUAL(0, failures);
+    CHECK_EQUAL(0, GetOverlaps());
+}
+
+TEST_FIXTURE(EnchantDictMockLatencySlowSuggest_TestFixture,
+             EnchantDictMockLatency_SuggestAsync_TimeoutCutsSlowSuggestShort)
+{
+    callbackCalled = false;
+    unsigned int timeouts = GetTimeouts();
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, 20, SuggestCallback, NULL);
+    CHECK(request);
+
+    g_mutex_lock(&callbackLock);
+    while (!callbackCalled)
+        g_cond_wait(&callbackCond, &callbackLock);
+    g_mutex_unlock(&callbackLock);
+    enchant_dict_free_suggest_request(_dict, request);
+
+    // the provider gave up at the timeout rather than finishing
+    CHECK_EQUAL(timeouts + 1, GetTimeouts());
+    CHECK_EQUAL(0, callbackNSuggs);
+}
@@ -0,0 +1,166 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictCheckCount;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    dictCheckCount++;
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static EnchantDict* MockProviderRequestCheckMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionaryCheckCache_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCheckMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionarySetCheckCacheSize_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetCheckCacheSize_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryCheckCache_ProviderConfiguration)
+    { 
+        dictCheckCount = 0;
+    }
+};
+
+/**
+ * enchant_dict_set_check_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0 to disable the cache
+ *
+ * Makes enchant_dict_check remember the spelling backend's verdicts on
+ * the @n_words words most recently checked in @dict.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_Default_ProviderCalledEachTime)
+{
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(2, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_Enabled_ProviderCalledOncePerWord)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    for (int i = 0; i < 3; i++)
+      {
+        CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+        CHECK_EQUAL(1, enchant_dict_check(_dict, "helo", -1));
+      }
+    CHECK_EQUAL(2, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_LengthGiven_CachedByLength)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", 4));
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", 4));
+    CHECK_EQUAL(2, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_Full_LeastRecentlyCheckedDropped)
+{
+    enchant_dict_set_check_cache_size(_dict, 2);
+    enchant_dict_check(_dict, "one", -1);
+    enchant_dict_check(_dict, "two", -1);
+    enchant_dict_check(_dict, "one", -1);
+    enchant_dict_check(_dict, "three", -1);
+    CHECK_EQUAL(3, dictCheckCount);
+
+    enchant_dict_check(_dict, "one", -1);
+    CHECK_EQUAL(3, dictCheckCount);
+    enchant_dict_check(_dict, "two", -1);
+    CHECK_EQUAL(4, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_Zero_Disabled)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_set_check_cache_size(_dict, 0);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(3, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_WordRemoved_NoLongerGood)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "hello", -1));
+    enchant_dict_remove(_dict, "hello", -1);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "hello", -1));
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_WordAdded_Good)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "world", -1));
+    enchant_dict_add_to_session(_dict, "world", -1);
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+}
+
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_WordAddedToPwlFile_Good)
+{
+    enchant_dict_set_check_cache_size(_dict, 16);
+    CHECK_EQUAL(1, enchant_dict_check(_dict, "world", -1));
+    ExternalAddWordToDictionary("world");
+    CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetCheckCacheSize_TestFixture,
+             EnchantDictionarySetCheckCacheSize_NullDictionary_DoNothing)
+{
+    enchant_dict_set_check_cache_size(NULL, 16);
+    enchant_dict_check(_dict, "hello", -1);
+    enchant_dict_check(_dict, "hello", -1);
+    CHECK_EQUAL(2, dictCheckCount);
+}
@@ -0,0 +1,204 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+#include <algorithm>
+#include <functional>
+
+struct EnchantDictionarySetPwlFrequencies_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetPwlFrequencies_TestFixture():
+            EnchantDictionaryTestFixture(EmptyDictionary_ProviderConfiguration)
+    { 
+        std::vector<std::string> sWords;
+        sWords.push_back("bat");
+        sWords.push_back("cat");
+        sWords.push_back("hat");
+        sWords.push_back("mat");
+        sWords.push_back("rat");
+        AddWordsToDictionary(sWords);
+    }
+
+    std::string GetFrequenciesFileName(){
+        return AddToPath(GetTempUserEnchantDir(), "qaa.freq");
+    }
+
+    int SetFrequencies(const std::string& contents)
+    {
+        g_file_set_contents(GetFrequenciesFileName().c_str(), contents.c_str(), contents.size(), NULL);
+        return enchant_dict_set_pwl_frequencies(_dict, GetFrequenciesFileName().c_str());
+    }
+};
+
+/**
+ * enchant_dict_set_pwl_frequencies
+ * @dict: A non-null #EnchantDict
+ * @filename: A file in the GLib file name encoding (UTF-8 on Windows)
+ *            listing a word and how often it is used on each line, or
+ *            %null to forget the frequencies
+ *
+ * Ranks the suggestions from @dict's personal word list that are as
+ * close to the misspelling as each other by how often they are used,
+ * most often first, regardless of case.  The counts are whole numbers
+ * separated from the words by white space; lines starting with '#'
+ * are skipped.  Knowing which words are common also lets the search
+ * leave out parts of a large word list that could not improve on the
+ * suggestions it has found.  The frequencies apply to all dictionaries
+ * using the same word list, including words added to it later.
+ *
+ * Returns: 0 on success, -1 if @filename could not be read
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_Default_TiesInListOrder)
+{
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("zat");
+    CHECK_EQUAL(5, suggestions.size());
+    CHECK_EQUAL("bat", suggestions[0]);
+    CHECK_EQUAL("rat", suggestions[4]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_TiesMostFrequentFirst)
+{
+    CHECK_EQUAL(0, SetFrequencies("rat 100\nmat 50\n"));
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("zat");
+    CHECK_EQUAL(5, suggestions.size());
+    CHECK_EQUAL("rat", suggestions[0]);
+    CHECK_EQUAL("mat", suggestions[1]);
+    CHECK_EQUAL("bat", suggestions[2]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_FewerErrorsStillFirst)
+{
+    SetFrequencies("rat 100\n");
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("caat");
+    CHECK_EQUAL(1, suggestions.size());
+    CHECK_EQUAL("cat", suggestions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_CaseIgnored)
+{
+    SetFrequencies("RAT 100\n");
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("Zat");
+    CHECK_EQUAL(5, suggestions.size());
+    CHECK_EQUAL("Rat", suggestions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_CommentsAndJunkSkipped)
+{
+    CHECK_EQUAL(0, SetFrequencies("# hat 1000\njunk\n  mat\t\t7  \r\n42\n"));
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("zat");
+    CHECK_EQUAL("mat", suggestions[0]);
+    CHECK_EQUAL("bat", suggestions[1]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_WordAddedLater_Ranked)
+{
+    GetSuggestionsFromWord("zat");
+    SetFrequencies("pat 500\nrat 100\n");
+    AddWordToDictionary("pat");
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("zat");
+    CHECK_EQUAL(6, suggestions.size());
+    CHECK_EQUAL("pat", suggestions[0]);
+    CHECK_EQUAL("rat", suggestions[1]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_SetToNull_BackToListOrder)
+{
+    SetFrequencies("rat 100\n");
+    CHECK_EQUAL("rat", GetSuggestionsFromWord("zat")[0]);
+
+    CHECK_EQUAL(0, enchant_dict_set_pwl_frequencies(_dict, NULL));
+    CHECK_EQUAL("bat", GetSuggestionsFromWord("zat")[0]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_LargeList_MostFrequentOfTheClosest)
+{
+    std::vector<std::string> sWords;
+    std::string frequencies;
+    for (int i = 1000; i < 3000; i++)
+      {
+        sWords.push_back("xat" + std::to_string(i));
+        frequencies += "xat" + std::to_string(i) + " " + std::to_string(i) + "\n";
+      }
+    AddWordsToDictionary(sWords);
+    SetFrequencies(frequencies);
+
+    // the words one insertion away from "xat255", most frequent first
+    std::vector<int> closest;
+    for (int i = 1000; i < 3000; i++)
+      {
+        std::string digits = std::to_string(i);
+        for (size_t j = 0; j < digits.size(); j++)
+            if (std::string(digits).erase(j, 1) == "255")
+              {
+                closest.push_back(i);
+                break;
+              }
+      }
+    std::sort(closest.begin(), closest.end(), std::greater<int>());
+    CHECK(closest.size() > 15);
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("xat255");
+    CHECK_EQUAL(15, suggestions.size());
+    for (size_t i = 0; i < suggestions.size() && i < closest.size(); i++)
+        CHECK_EQUAL("xat" + std::to_string(closest[i]), suggestions[i]);
+
+    CHECK_EQUAL(0, enchant_dict_set_pwl_suggest_engine(_dict, "parallel"));
+    CHECK(suggestions == GetSuggestionsFromWord("xat255"));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_MissingFile_ErrorSet)
+{
+    SetFrequencies("rat 100\n");
+    CHECK_EQUAL(-1, enchant_dict_set_pwl_frequencies(_dict, AddToPath(GetTempUserEnchantDir(), "none.freq").c_str()));
+    CHECK(enchant_dict_get_error(_dict) != NULL);
+
+    // the frequencies set before are kept
+    CHECK_EQUAL("rat", GetSuggestionsFromWord("zat")[0]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlFrequencies_TestFixture,
+             EnchantDictionarySetPwlFrequencies_NullDictionary_NotSet)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_pwl_frequencies(NULL, GetFrequenciesFileName().c_str()));
+}
@@ -0,0 +1,150 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+#include <algorithm>
+
+struct EnchantDictionarySetPwlSuggestEngine_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetPwlSuggestEngine_TestFixture():
+            EnchantDictionaryTestFixture(EmptyDictionary_ProviderConfiguration)
+    { 
+        std::vector<std::string> sWords;
+        sWords.push_back("cat");
+        sWords.push_back("hat");
+        sWords.push_back("that");
+        sWords.push_back("bat");
+        sWords.push_back("tot");
+        sWords.push_back("Tater");
+        sWords.push_back("abbreviation");
+        sWords.push_back("abbreviations");
+        sWords.push_back("abrasion");
+        AddWordsToDictionary(sWords);
+    }
+};
+
+/**
+ * enchant_dict_set_pwl_suggest_engine
+ * @dict: A non-null #EnchantDict
+ * @engine: The non-null name of the engine, "trie", "deletions" or "parallel"
+ *
+ * Chooses how suggestions are looked up in @dict's personal word list.
+ *
+ * Returns: 0 on success, -1 if @engine is unknown
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_Deletions_SameSuggestionsAsTrie)
+{
+    const char *words[] = { "at", "tat", "Cta", "HAT", "tatter", "abreviatoin", "abbrasions", "zzz" };
+    for (size_t i = 0; i < sizeof (words) / sizeof (words[0]); i++)
+      {
+        std::vector<std::string> expected = GetSuggestionsFromWord(words[i]);
+        CHECK_EQUAL(0, enchant_dict_set_pwl_suggest_engine(_dict, "deletions"));
+        std::vector<std::string> suggestions = GetSuggestionsFromWord(words[i]);
+        CHECK_EQUAL(0, enchant_dict_set_pwl_suggest_engine(_dict, "trie"));
+
+        CHECK_EQUAL(expected.size(), suggestions.size());
+        CHECK(expected == suggestions);
+      }
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_Deletions_WordsChangedAfterFirstSuggestion)
+{
+    enchant_dict_set_pwl_suggest_engine(_dict, "deletions");
+    CHECK_EQUAL(0, GetSuggestionsFromWord("elephnat").size());
+
+    AddWordToDictionary("elephant");
+    RemoveWordFromDictionary("abrasion");
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("elephnat");
+    CHECK_EQUAL(1, suggestions.size());
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "elephant") != suggestions.end());
+
+    suggestions = GetSuggestionsFromWord("abrasoin");
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "abrasion") == suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_DeletionsOnLargeList_IndexSavedAndReused)
+{
+    std::vector<std::string> sWords;
+    for (int i = 0; i < 1000; i++)
+        sWords.push_back("word" + std::to_string(i));
+    AddWordsToDictionary(sWords);
+
+    enchant_dict_set_pwl_suggest_engine(_dict, "deletions");
+    std::vector<std::string> expected = GetSuggestionsFromWord("wrod42");
+    CHECK(FileExists(GetPersonalDictFileName() + ".del"));
+
+    ReloadTestDictionary();
+    enchant_dict_set_pwl_suggest_engine(_dict, "deletions");
+    CHECK(expected == GetSuggestionsFromWord("wrod42"));
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_ParallelOnLargeList_SameSuggestionsAsTrie)
+{
+    std::vector<std::string> sWords;
+    for (int i = 0; i < 2000; i++)
+        sWords.push_back(std::string(1, (char) ('a' + i % 26)) + "at" + std::to_string(i));
+    AddWordsToDictionary(sWords);
+
+    const char *words[] = { "at", "tat", "Cta", "HAT", "tatter", "abreviatoin", "abbrasions", "zzz", "bat17", "qat1000" };
+    for (size_t i = 0; i < sizeof (words) / sizeof (words[0]); i++)
+      {
+        std::vector<std::string> expected = GetSuggestionsFromWord(words[i]);
+        CHECK_EQUAL(0, enchant_dict_set_pwl_suggest_engine(_dict, "parallel"));
+        std::vector<std::string> suggestions = GetSuggestionsFromWord(words[i]);
+        CHECK_EQUAL(0, enchant_dict_set_pwl_suggest_engine(_dict, "trie"));
+
+        CHECK_EQUAL(expected.size(), suggestions.size());
+        CHECK(expected == suggestions);
+      }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_UnknownEngine_ErrorSet)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_pwl_suggest_engine(_dict, "guess"));
+    CHECK(enchant_dict_get_error(_dict) != NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_NullDictionary_Fails)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_pwl_suggest_engine(NULL, "trie"));
+}
+
+TEST_FIXTURE(EnchantDictionarySetPwlSuggestEngine_TestFixture,
+             EnchantDictionarySetPwlSuggestEngine_NullEngine_Fails)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_pwl_suggest_engine(_dict, NULL));
+}
@@ -0,0 +1,211 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+#include <algorithm>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictSuggestCount;
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    dictSuggestCount++;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestSuggestMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = CountingMockDictionarySuggest;
+    return dict;
+}
+
+static void DictionarySuggestCache_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionarySetSuggestCacheSize_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetSuggestCacheSize_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestCache_ProviderConfiguration)
+    { 
+        dictSuggestCount = 0;
+    }
+
+    size_t GetHits()
+    {
+        size_t n_hits = 0;
+        enchant_dict_get_suggest_cache_stats(_dict, &n_hits, NULL);
+        return n_hits;
+    }
+
+    size_t GetMisses()
+    {
+        size_t n_misses = 0;
+        enchant_dict_get_suggest_cache_stats(_dict, NULL, &n_misses);
+        return n_misses;
+    }
+};
+
+/**
+ * enchant_dict_set_suggest_cache_size
+ * @dict: A non-null #EnchantDict
+ * @n_words: The number of words to remember, or 0 to disable the cache
+ *
+ * Makes enchant_dict_suggest remember the suggestions it made for the
+ * @n_words words most recently looked up in @dict.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_Default_ProviderCalledEachTime)
+{
+    GetSuggestionsFromWord("helo");
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+    CHECK_EQUAL(0, GetHits());
+    CHECK_EQUAL(0, GetMisses());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_Enabled_SameSuggestionsProviderCalledOnce)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    std::vector<std::string> expected = GetSuggestionsFromWord("helo");
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(4, expected.size());
+    CHECK(expected == suggestions);
+    CHECK_EQUAL(1, dictSuggestCount);
+    CHECK_EQUAL(1, GetHits());
+    CHECK_EQUAL(1, GetMisses());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_Hit_ReturnsCopy)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    size_t n_suggs;
+    char** suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    g_free(suggs[0]);
+    suggs[0] = g_strdup("changed");
+    enchant_dict_free_string_list(_dict, suggs);
+
+    suggs = enchant_dict_suggest(_dict, "helo", -1, &n_suggs);
+    CHECK_EQUAL(4, n_suggs);
+    CHECK_EQUAL("aelo", suggs[0]);
+    enchant_dict_free_string_list(_dict, suggs);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_WordAddedToSession_Recomputed)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_add_to_session(_dict, "hello", -1);
+    GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_WordAdded_Suggested)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_add(_dict, "hello", -1);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(2, dictSuggestCount);
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "hello") != suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_WordRemoved_NotSuggested)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "aelo") != suggestions.end());
+
+    enchant_dict_remove(_dict, "aelo", -1);
+    suggestions = GetSuggestionsFromWord("helo");
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "aelo") == suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_WordAddedToPwlFile_Suggested)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    ExternalAddWordToDictionary("hello");
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "hello") != suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_ReplacementStored_Recomputed)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_store_replacement(_dict, "helo", -1, "hello", -1);
+    GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_Zero_Disabled)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_set_suggest_cache_size(_dict, 0);
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionarySetSuggestCacheSize_NullDictionary_DoNothing)
+{
+    enchant_dict_set_suggest_cache_size(NULL, 16);
+    GetSuggestionsFromWord("helo");
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestCacheSize_TestFixture,
+             EnchantDictionaryGetSuggestCacheStats_NullDictionary_DoNothing)
+{
+    size_t n_hits = 7, n_misses = 7;
+    enchant_dict_get_suggest_cache_stats(NULL, &n_hits, &n_misses);
+    CHECK_EQUAL(7, n_hits);
+    CHECK_EQUAL(7, n_misses);
+}
@@ -0,0 +1,262 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantBrokerTestFixture.h"
+#include <utility>
+#include <vector>
+
+static gint slowProviderDelay;	// in microseconds
+static gint mock2SuggestCount;
+
+// while held, the second provider's suggest waits for the test to let go
+static GMutex slowProviderLock;
+static GCond slowProviderReleased;
+static bool slowProviderHeld;
+
+static void HoldSlowProvider (bool held)
+{
+    g_mutex_lock(&slowProviderLock);
+    slowProviderHeld = held;
+    g_cond_broadcast(&slowProviderReleased);
+    g_mutex_unlock(&slowProviderLock);
+}
+
+// an executor that leaves the tasks it is handed for the fixture to run
+static std::vector<std::pair<EnchantTaskFn, void *> > deferredTasks;
+
+static void DeferTask (EnchantTaskFn run, void * task, void *)
+{
+    deferredTasks.push_back(std::make_pair(run, task));
+}
+
+static char ** SuggestList (const std::vector<std::string> & words, size_t * out_n_suggs)
+{
+    *out_n_suggs = words.size();
+    char **suggs = g_new0 (char *, words.size() + 1);
+    for (size_t i = 0; i < words.size(); i++)
+        suggs[i] = g_strdup (words[i].c_str());
+    return suggs;
+}
+
+static char ** MockProvider1Suggest (EnchantDict *, const char *const, size_t, size_t * out_n_suggs)
+{
+    return SuggestList({ "hello", "hallo" }, out_n_suggs);
+}
+
+static char ** MockProvider2Suggest (EnchantDict *, const char *const, size_t, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&mock2SuggestCount);
+    if (g_atomic_int_get(&slowProviderDelay))
+        g_usleep(g_atomic_int_get(&slowProviderDelay));
+    g_mutex_lock(&slowProviderLock);
+    while (slowProviderHeld)
+        g_cond_wait(&slowProviderReleased, &slowProviderLock);
+    g_mutex_unlock(&slowProviderLock);
+    return SuggestList({ "help", "hello" }, out_n_suggs);
+}
+
+static EnchantDict * RequestDictionary1 (EnchantProvider *me, const char *tag)
+{
+    EnchantDict *dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        dict->suggest = MockProvider1Suggest;
+    return dict;
+}
+
+static EnchantDict * RequestDictionary2 (EnchantProvider *me, const char *tag)
+{
+    EnchantDict *dict = MockEnGbAndQaaProviderRequestDictionary(me, tag);
+    if (dict)
+        dict->suggest = MockProvider2Suggest;
+    return dict;
+}
+
+static const char * MockProvider1Identify (EnchantProvider *)
+{
+    return "mock1";
+}
+
+static const char * MockProvider2Identify (EnchantProvider *)
+{
+    return "mock2";
+}
+
+static void Fanout_ProviderConfiguration1 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary1;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->identify = MockProvider1Identify;
+}
+
+static void Fanout_ProviderConfiguration2 (EnchantProvider * me, const char *)
+{
+     me->request_dict = RequestDictionary2;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->identify = MockProvider2Identify;
+}
+
+struct EnchantDictionarySetSuggestFanout_TestFixture : EnchantBrokerTestFixture
+{
+    //Setup
+    EnchantDictionarySetSuggestFanout_TestFixture():
+            EnchantBrokerTestFixture(Fanout_ProviderConfiguration1, Fanout_ProviderConfiguration2)
+    { 
+        slowProviderDelay = 0;
+        mock2SuggestCount = 0;
+        enchant_broker_set_ordering(_broker, "*", "mock1,mock2");
+        _dict = RequestDictionary("en_GB");
+    }
+
+    //Teardown
+    ~EnchantDictionarySetSuggestFanout_TestFixture()
+    {
+        HoldSlowProvider(false);
+        FreeDictionary(_dict);
+
+        // the broker waits for every task handed out
+        for (size_t i = 0; i < deferredTasks.size(); i++)
+            deferredTasks[i].first(deferredTasks[i].second);
+        deferredTasks.clear();
+    }
+
+    std::vector<std::string> Suggest(const std::string & word)
+    {
+        size_t n_suggs;
+        char ** suggs = enchant_dict_suggest(_dict, word.c_str(), word.size(), &n_suggs);
+        std::vector<std::string> result;
+        if (suggs)
+            result.assign(suggs, suggs + n_suggs);
+        enchant_dict_free_string_list(_dict, suggs);
+        return result;
+    }
+
+    EnchantDict* _dict;
+};
+
+/**
+ * enchant_dict_set_suggest_fanout
+ * @dict: A non-null #EnchantDict
+ * @max_providers: The most providers to ask, 1 or 0 for only @dict's own
+ * @timeout_ms: How long to wait for the other providers, or -1 for as long as they take
+ *
+ * Makes enchant_dict_suggest ask up to @max_providers - 1 other providers
+ * that have a dictionary for @dict's language as well, all at the same
+ * time as @dict's own, merging their suggestions by rank.
+ *
+ * Returns: The number of providers @dict's suggestions come from, or 0 if it
+ * has none
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_Default_OwnProviderOnly)
+{
+    std::vector<std::string> suggs = Suggest("helo");
+    CHECK_EQUAL(2, suggs.size());
+    CHECK_EQUAL(0, mock2SuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_TwoProviders_MergedByRank)
+{
+    CHECK_EQUAL(2, enchant_dict_set_suggest_fanout(_dict, 2, -1));
+
+    std::vector<std::string> suggs = Suggest("helo");
+    CHECK_EQUAL(3, suggs.size());
+    CHECK_EQUAL("hello", suggs[0]);
+    CHECK_EQUAL("help", suggs[1]);
+    CHECK_EQUAL("hallo", suggs[2]);
+    CHECK_EQUAL(1, mock2SuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_ExecutorNeverRuns_AskedByCaller)
+{
+    enchant_broker_set_executor(_broker, DeferTask, NULL);
+    enchant_dict_set_suggest_fanout(_dict, 2, -1);
+
+    std::vector<std::string> suggs = Suggest("helo");
+    CHECK_EQUAL(3, suggs.size());
+    CHECK_EQUAL("help", suggs[1]);
+    CHECK_EQUAL(1, mock2SuggestCount);
+    CHECK_EQUAL(1, deferredTasks.size());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_MoreThanThereAre_AllAsked)
+{
+    CHECK_EQUAL(2, enchant_dict_set_suggest_fanout(_dict, 5, -1));
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_SlowProvider_LeftOut)
+{
+    enchant_dict_set_suggest_fanout(_dict, 2, 10);
+    HoldSlowProvider(true);
+
+    // returns while the second provider is still held up
+    std::vector<std::string> suggs = Suggest("helo");
+    HoldSlowProvider(false);
+
+    CHECK_EQUAL(2, suggs.size());
+    CHECK_EQUAL("hello", suggs[0]);
+    CHECK_EQUAL("hallo", suggs[1]);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_SlowProviderLeftOut_DictionaryFreedSafely)
+{
+    enchant_dict_set_suggest_fanout(_dict, 2, 0);
+    slowProviderDelay = 100 * 1000;
+
+    Suggest("helo");
+    FreeDictionary(_dict);
+    _dict = NULL;
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_TurnedOff_OwnProviderOnly)
+{
+    enchant_dict_set_suggest_fanout(_dict, 2, -1);
+    CHECK_EQUAL(1, enchant_dict_set_suggest_fanout(_dict, 1, -1));
+
+    Suggest("helo");
+    CHECK_EQUAL(0, mock2SuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_PersonalWordList_NoProviders)
+{
+    EnchantDict* dict = RequestPersonalDictionary();
+    CHECK_EQUAL(0, enchant_dict_set_suggest_fanout(dict, 2, -1));
+    FreeDictionary(dict);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetSuggestFanout_TestFixture,
+             EnchantDictionarySetSuggestFanout_NullDictionary_Fails)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_fanout(NULL, 2, -1));
+}
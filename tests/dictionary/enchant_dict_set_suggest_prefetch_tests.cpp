@@ -0,0 +1,264 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <utility>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictSuggestCount;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    return !(len == strlen("hello") && strncmp("hello", word, len) == 0);
+}
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&dictSuggestCount);
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestPrefetchMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    dict->suggest = CountingMockDictionarySuggest;
+    return dict;
+}
+
+static void DictionarySuggestPrefetch_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestPrefetchMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->flags = ENCHANT_PROVIDER_THREAD_SAFE;
+}
+
+// keeps the tasks until they are run with RunTasks
+struct PrefetchExecutor
+{
+    GMutex lock;
+    std::vector<std::pair<EnchantTaskFn, void *> > tasks;
+    size_t n_handed;
+
+    PrefetchExecutor() : n_handed(0) { g_mutex_init(&lock); }
+    ~PrefetchExecutor() { g_mutex_clear(&lock); }
+
+    static void Execute(EnchantTaskFn run, void * task, void * user_data)
+    {
+        PrefetchExecutor *executor = static_cast<PrefetchExecutor *>(user_data);
+        g_mutex_lock(&executor->lock);
+        executor->tasks.push_back(std::make_pair(run, task));
+        executor->n_handed++;
+        g_mutex_unlock(&executor->lock);
+    }
+
+    void RunTasks()
+    {
+        g_mutex_lock(&lock);
+        std::vector<std::pair<EnchantTaskFn, void *> > taken;
+        taken.swap(tasks);
+        g_mutex_unlock(&lock);
+        for (size_t i = 0; i < taken.size(); i++)
+            taken[i].first(taken[i].second);
+    }
+};
+
+struct EnchantDictionarySetSuggestPrefetch_TestFixture : EnchantDictionaryTestFixture
+{
+    PrefetchExecutor _executor;
+
+    //Setup
+    EnchantDictionarySetSuggestPrefetch_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestPrefetch_ProviderConfiguration)
+    {
+        dictSuggestCount = 0;
+        enchant_broker_set_executor(_broker, PrefetchExecutor::Execute, &_executor);
+        enchant_dict_set_suggest_cache_size(_dict, 16);
+    }
+
+    //Teardown
+    ~EnchantDictionarySetSuggestPrefetch_TestFixture()
+    {
+        // the broker waits for every task handed out
+        _executor.RunTasks();
+    }
+
+    int CheckText(const char *text)
+    {
+        return enchant_dict_check_text(_dict, text, -1, NULL, NULL);
+    }
+
+    size_t GetHits()
+    {
+        size_t n_hits = 0;
+        enchant_dict_get_suggest_cache_stats(_dict, &n_hits, NULL);
+        return n_hits;
+    }
+};
+
+/**
+ * enchant_dict_set_suggest_prefetch
+ * @dict: A non-null #EnchantDict
+ * @max_pending: The most words to work out suggestions for at a time, or 0 not to
+ *
+ * Makes enchant_dict_check_text and enchant_text_checker_check work out
+ * the suggestions for the misspellings they find in the background.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_Default_NothingPrefetched)
+{
+    CHECK_EQUAL(2, CheckText("helo hello wrld"));
+    CHECK_EQUAL(0, _executor.n_handed);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_Enabled_SuggestionsCachedAhead)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    CHECK_EQUAL(2, CheckText("helo hello wrld"));
+    CHECK_EQUAL(2, _executor.n_handed);
+    CHECK_EQUAL(0, dictSuggestCount);
+
+    _executor.RunTasks();
+    CHECK_EQUAL(2, dictSuggestCount);
+
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("wrld");
+    CHECK_EQUAL(4, suggestions.size());
+    CHECK_EQUAL(2, dictSuggestCount);
+    CHECK_EQUAL(1, GetHits());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_SameWordTwice_PrefetchedOnce)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    CheckText("helo helo");
+    CHECK_EQUAL(1, _executor.n_handed);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_AlreadyCached_NotWorkedOutAgain)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    GetSuggestionsFromWord("helo");
+    CheckText("helo");
+    _executor.RunTasks();
+    CHECK_EQUAL(1, dictSuggestCount);
+    CHECK_EQUAL(0, GetHits());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_TooManyPending_RestLeftAlone)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 1);
+    CheckText("helo wrld tset");
+    CHECK_EQUAL(1, _executor.n_handed);
+
+    _executor.RunTasks();
+    CheckText("helo wrld tset");
+    CHECK_EQUAL(2, _executor.n_handed);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_AnotherTextChecked_EarlierGivenUp)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    CheckText("helo");
+    CheckText("wrld");
+    _executor.RunTasks();
+
+    CHECK_EQUAL(1, dictSuggestCount);
+    GetSuggestionsFromWord("wrld");
+    CHECK_EQUAL(1, GetHits());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_TextChecker_SuggestionsCachedAhead)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    EnchantTextChecker *checker = enchant_text_checker_new(_dict, "helo wrld", -1);
+    CHECK_EQUAL(2, enchant_text_checker_check(checker, NULL, NULL));
+    _executor.RunTasks();
+    enchant_text_checker_free(checker);
+
+    CHECK_EQUAL(2, dictSuggestCount);
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(1, GetHits());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_TextCheckerEdited_GivenUp)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    EnchantTextChecker *checker = enchant_text_checker_new(_dict, "helo wrld", -1);
+    enchant_text_checker_check(checker, NULL, NULL);
+    CHECK_EQUAL(0, enchant_text_checker_edit(checker, 0, 0, "x", -1));
+    _executor.RunTasks();
+    enchant_text_checker_free(checker);
+
+    CHECK_EQUAL(0, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_DictionaryFreed_GivenUp)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    CheckText("helo wrld");
+    ReloadTestDictionary();
+
+    CHECK_EQUAL(0, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_CacheDisabled_NothingPrefetched)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 0);
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    CheckText("helo wrld");
+    CHECK_EQUAL(0, _executor.n_handed);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_SetToZero_NothingPrefetched)
+{
+    enchant_dict_set_suggest_prefetch(_dict, 4);
+    enchant_dict_set_suggest_prefetch(_dict, 0);
+    CheckText("helo wrld");
+    CHECK_EQUAL(0, _executor.n_handed);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetSuggestPrefetch_TestFixture,
+             EnchantDictionarySetSuggestPrefetch_NullDictionary_DoNothing)
+{
+    enchant_dict_set_suggest_prefetch(NULL, 4);
+    CheckText("helo wrld");
+    CHECK_EQUAL(0, _executor.n_handed);
+}
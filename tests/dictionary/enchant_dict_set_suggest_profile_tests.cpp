@@ -0,0 +1,163 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static std::string dictProfile;
+static int setProfileCount;
+static int dictSuggestCount;
+
+static int
+MockDictionarySetSuggestProfile (EnchantDict *, const char *const profile)
+{
+    setProfileCount++;
+    if (strcmp(profile, "thorough") == 0)
+        return -1;
+    dictProfile = profile;
+    return 0;
+}
+
+static char **
+MockDictionaryCountedSuggest (EnchantDict * me, const char *const word,
+                              size_t len, size_t * out_n_suggs)
+{
+    dictSuggestCount++;
+    return MockDictionarySuggest(me, word, len, out_n_suggs);
+}
+
+static EnchantDict*
+MockProviderRequestProfileMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = MockDictionaryCountedSuggest;
+    dict->set_suggest_profile = MockDictionarySetSuggestProfile;
+    return dict;
+}
+
+static void DictionarySuggestProfile_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestProfileMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionarySetSuggestProfile_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetSuggestProfile_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestProfile_ProviderConfiguration)
+    {
+        dictProfile = "";
+        setProfileCount = 0;
+        dictSuggestCount = 0;
+    }
+};
+
+/**
+ * enchant_dict_set_suggest_profile
+ * @dict: A non-null #EnchantDict
+ * @profile: The non-null name of the profile, "fast", "balanced" or "thorough"
+ *
+ * Trades the quality of the suggestions @dict's spelling backend makes
+ * for the time it takes, for @dict alone.
+ *
+ * Returns: 0 on success, -1 if @profile is unknown
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Default_ProviderNotTold)
+{
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(0, setProfileCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Fast_ProviderTold)
+{
+    CHECK_EQUAL(0, enchant_dict_set_suggest_profile(_dict, "fast"));
+    CHECK_EQUAL("fast", dictProfile);
+    CHECK(enchant_dict_get_error(_dict) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Changed_CachedSuggestionsFoundAgain)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(1, dictSuggestCount);
+
+    enchant_dict_set_suggest_profile(_dict, "fast");
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Reloaded_ProviderToldAgain)
+{
+    enchant_dict_set_suggest_profile(_dict, "balanced");
+    dictProfile = "";
+
+    CHECK_EQUAL(1, enchant_broker_reload_dict(_broker, "qaa"));
+    CHECK_EQUAL("balanced", dictProfile);
+    CHECK_EQUAL(2, setProfileCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Pwl_NoProviderToTell)
+{
+    CHECK_EQUAL(0, enchant_dict_set_suggest_profile(_pwl, "fast"));
+    CHECK_EQUAL(0, setProfileCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_Unknown_Error)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_profile(_dict, "slow"));
+    CHECK(enchant_dict_get_error(_dict) != NULL);
+    CHECK_EQUAL(0, setProfileCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_ProviderRefuses_Error)
+{
+    enchant_dict_set_suggest_profile(_dict, "fast");
+
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_profile(_dict, "thorough"));
+    CHECK(enchant_dict_get_error(_dict) != NULL);
+    CHECK_EQUAL("fast", dictProfile);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestProfile_TestFixture,
+             EnchantDictionarySetSuggestProfile_NullProfile_Error)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_profile(_dict, NULL));
+}
+
+TEST(EnchantDictionarySetSuggestProfile_NullDict_Error)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_profile(NULL, "fast"));
+}
@@ -0,0 +1,237 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictSuggestCount;
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    dictSuggestCount++;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestSuggestMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = CountingMockDictionarySuggest;
+    return dict;
+}
+
+static std::string dictionaryDir;
+static char** ListDictionaryDirs (EnchantProvider *, size_t * out_n_dirs)
+{
+    *out_n_dirs = 1;
+    char** out_list = g_new0 (char *, *out_n_dirs + 1);
+    out_list[0] = g_strdup (dictionaryDir.c_str());
+
+    return out_list;
+}
+
+static void DictionarySuggestStore_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->list_dict_dirs = ListDictionaryDirs;
+}
+
+static void DictionaryNoDirs_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+CollectStats (const char * const name, uint64_t value, void * user_data)
+{
+    std::map<std::string, uint64_t> *stats = static_cast<std::map<std::string, uint64_t> *>(user_data);
+    (*stats)[name] = value;
+}
+
+struct EnchantDictionarySetSuggestStore_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetSuggestStore_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestStore_ProviderConfiguration)
+    { 
+        dictSuggestCount = 0;
+        dictionaryDir = AddToPath(GetTempUserEnchantDir(), "mock");
+        CreateDirectory(dictionaryDir);
+    }
+
+    uint64_t GetStoredCount()
+    {
+        std::map<std::string, uint64_t> stats;
+        enchant_dict_get_stats(_dict, CollectStats, &stats);
+        return stats["suggests_stored"];
+    }
+};
+
+struct EnchantDictionarySetSuggestStoreNoDirs_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySetSuggestStoreNoDirs_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryNoDirs_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_set_suggest_store
+ * @dict: A non-null #EnchantDict
+ * @max_words: The most words to keep suggestions for, or 0 to stop using the store
+ *
+ * Makes enchant_dict_suggest keep the spelling backend's suggestions for
+ * up to @max_words words in a file under the user's config directory.
+ *
+ * Returns: 0 on success, -1 if @dict's provider does not tell where its
+ * dictionaries are, or its dictionaries learn words themselves
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_Default_ProviderCalledEachTime)
+{
+    GetSuggestionsFromWord("helo");
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_Enabled_SameSuggestionsProviderCalledOnce)
+{
+    CHECK_EQUAL(0, enchant_dict_set_suggest_store(_dict, 16));
+    std::vector<std::string> expected = GetSuggestionsFromWord("helo");
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(4, expected.size());
+    CHECK(expected == suggestions);
+    CHECK_EQUAL(1, dictSuggestCount);
+    CHECK_EQUAL(1, GetStoredCount());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_DictionaryReloaded_SuggestionsKept)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    std::vector<std::string> expected = GetSuggestionsFromWord("helo");
+
+    ReloadTestDictionary();
+    enchant_dict_set_suggest_store(_dict, 16);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK(expected == suggestions);
+    CHECK_EQUAL(1, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_DictionaryDirChanged_Recomputed)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    GetSuggestionsFromWord("helo");
+
+    ReloadTestDictionary();
+    dictionaryDir = AddToPath(GetTempUserEnchantDir(), "other");
+    CreateDirectory(dictionaryDir);
+    enchant_dict_set_suggest_store(_dict, 16);
+    GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_WordAdded_Suggested)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_add(_dict, "hello", -1);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(1, dictSuggestCount);
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "hello") != suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_WordRemoved_NotSuggested)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    enchant_dict_remove(_dict, "aelo", -1);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "aelo") == suggestions.end());
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_Full_ProviderCalledForNewWords)
+{
+    enchant_dict_set_suggest_store(_dict, 1);
+    GetSuggestionsFromWord("helo");
+    GetSuggestionsFromWord("wrld");
+    GetSuggestionsFromWord("wrld");
+    GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(3, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_Bounded_NotStored)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    size_t n_suggs;
+    char** suggs = enchant_dict_suggest_bounded(_dict, "helo", -1, 2, -1, -1, &n_suggs);
+    FreeStringList(suggs);
+    GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_Zero_Disabled)
+{
+    enchant_dict_set_suggest_store(_dict, 16);
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(0, enchant_dict_set_suggest_store(_dict, 0));
+    GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(2, dictSuggestCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySetSuggestStore_TestFixture,
+             EnchantDictionarySetSuggestStore_NullDictionary_NegativeOne)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_store(NULL, 16));
+}
+
+TEST_FIXTURE(EnchantDictionarySetSuggestStoreNoDirs_TestFixture,
+             EnchantDictionarySetSuggestStore_ProviderWithoutDictDirs_NegativeOne)
+{
+    CHECK_EQUAL(-1, enchant_dict_set_suggest_store(_dict, 16));
+    CHECK(enchant_dict_get_error(_dict) != NULL);
+}
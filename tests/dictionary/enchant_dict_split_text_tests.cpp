@@ -0,0 +1,187 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include <vector>
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictCheckCount;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const, size_t)
+{
+    dictCheckCount++;
+    return 1;
+}
+
+static EnchantDict* MockProviderRequestSplitTextMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void DictionarySplitText_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSplitTextMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct TextWord
+{
+    std::string word;
+    size_t offset;
+    size_t charOffset;
+    size_t charLength;
+};
+
+static void
+CollectWord (EnchantDict *, const char *const word, size_t len,
+             size_t offset, size_t char_offset, size_t char_len, void *user_data)
+{
+    std::vector<TextWord> *words = static_cast<std::vector<TextWord> *>(user_data);
+    TextWord textWord = { std::string(word, len), offset, char_offset, char_len };
+    words->push_back(textWord);
+}
+
+struct EnchantDictionarySplitText_TestFixture : EnchantDictionaryTestFixture
+{
+    std::vector<TextWord> words;
+
+    //Setup
+    EnchantDictionarySplitText_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySplitText_ProviderConfiguration)
+    { 
+        dictCheckCount = 0;
+    }
+
+    int SplitText(const char *text, ssize_t len = -1)
+    {
+        return enchant_dict_split_text(_dict, text, len, CollectWord, &words);
+    }
+};
+
+/**
+ * enchant_dict_split_text
+ * @dict: A non-null #EnchantDict
+ * @text: The non-null text you wish to split, in UTF-8 encoding
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ * @fn: A #EnchantTextWordFn, or %null if you only want the count
+ * @user_data: Supplied user data, or %null if you don't care
+ *
+ * Returns: The number of words, or -1 if @text is not valid UTF-8
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_ReportsWordsInOrder)
+{
+    CHECK_EQUAL(3, SplitText("hello, h\xc3\xa9lo wrld!"));
+
+    CHECK_EQUAL(3, words.size());
+    CHECK_EQUAL("hello", words[0].word);
+    CHECK_EQUAL(0, words[0].offset);
+    CHECK_EQUAL("h\xc3\xa9lo", words[1].word);
+    CHECK_EQUAL(7, words[1].offset);
+    CHECK_EQUAL(7, words[1].charOffset);
+    CHECK_EQUAL(4, words[1].charLength);
+    CHECK_EQUAL("wrld", words[2].word);
+    CHECK_EQUAL(13, words[2].offset);
+    CHECK_EQUAL(12, words[2].charOffset);
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_SameWordsAsCheckText)
+{
+    const char *text = "'tis well-known' -x";
+    SplitText(text);
+
+    std::vector<TextWord> misspellings;
+    CHECK_EQUAL(3, enchant_dict_check_text(_dict, text, -1, CollectWord, &misspellings));
+
+    CHECK_EQUAL(misspellings.size(), words.size());
+    for (size_t i = 0; i < words.size() && i < misspellings.size(); i++)
+    {
+        CHECK_EQUAL(misspellings[i].word, words[i].word);
+        CHECK_EQUAL(misspellings[i].offset, words[i].offset);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_WordsNotChecked)
+{
+    SplitText("helo wrld");
+    CHECK_EQUAL(0, dictCheckCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_LongLine_AllWordsFound)
+{
+    std::string text;
+    for (int i = 0; i < 20000; i++)
+        text += "w\xc3\xb6rd ";
+
+    CHECK_EQUAL(20000, SplitText(text.c_str()));
+    CHECK_EQUAL(19999 * 5, words.back().charOffset);
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_Length_Used)
+{
+    CHECK_EQUAL(1, SplitText("hello wrld", 5));
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_NullCallback_CountsOnly)
+{
+    CHECK_EQUAL(2, enchant_dict_split_text(_dict, "helo wrld", -1, NULL, NULL));
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_NoWords_Zero)
+{
+    CHECK_EQUAL(0, SplitText(" ... -- !? "));
+    CHECK_EQUAL(0, SplitText(""));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_InvalidUtf8_Error)
+{
+    CHECK_EQUAL(-1, SplitText("helo \xa5\xf1\x08"));
+    CHECK_EQUAL(0, words.size());
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_NullDictionary_Error)
+{
+    CHECK_EQUAL(-1, enchant_dict_split_text(NULL, "helo", -1, CollectWord, &words));
+}
+
+TEST_FIXTURE(EnchantDictionarySplitText_TestFixture,
+             EnchantDictionarySplitText_NullText_Error)
+{
+    CHECK_EQUAL(-1, SplitText(NULL));
+}
@@ -22,6 +22,8 @@
 #include <UnitTest++/UnitTest++.h>
 #include <enchant.h>
 #include "EnchantDictionaryTestFixture.h"
+#include <algorithm>
+#include <vector>
 
 struct EnchantDictionaryStoreReplacement_TestFixture : EnchantDictionaryTestFixture
 {
@@ -76,6 +78,44 @@ struct EnchantDictionaryLacksStoreReplacement_TestFixture : EnchantDictionaryTes
     { }
 };
 
+static int learnedSuggestCount;
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    learnedSuggestCount++;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestCountingMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = CountingMockDictionarySuggest;
+    return dict;
+}
+
+static void DictionaryLearnedReplacement_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCountingMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionaryLearnedReplacement_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionaryLearnedReplacement_TestFixture():
+            EnchantDictionaryTestFixture(DictionaryLearnedReplacement_ProviderConfiguration)
+    {
+        learnedSuggestCount = 0;
+    }
+
+    void StoreReplacement(const std::string& mis, const std::string& cor, int times)
+    {
+        for (int i = 0; i < times; i++)
+            enchant_dict_store_replacement(_dict, mis.c_str(), mis.size(), cor.c_str(), cor.size());
+    }
+};
+
 
 
 
@@ -225,3 +265,73 @@ TEST_FIXTURE(EnchantDictionaryStoreReplacement_TestFixture,
     CHECK_EQUAL(EnchantDictionaryStoreReplacement_TestFixture::misspelling, misspelling);
     CHECK_EQUAL(EnchantDictionaryStoreReplacement_TestFixture::correction, correction);
 }
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Learned Replacements
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_Once_CorrectionSuggestedFirst)
+{
+    StoreReplacement("helo", "hello", 1);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(5, suggestions.size());
+    CHECK_EQUAL("hello", suggestions[0]);
+    CHECK_EQUAL(1, learnedSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_OftenChosen_ProviderNotAsked)
+{
+    StoreReplacement("helo", "hello", 3);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(1, suggestions.size());
+    CHECK_EQUAL("hello", suggestions[0]);
+    CHECK_EQUAL(0, learnedSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_TwoCorrectionsChosen_BestFirstAndProviderAsked)
+{
+    StoreReplacement("helo", "help", 1);
+    StoreReplacement("helo", "hello", 3);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK(suggestions.size() >= 2);
+    CHECK_EQUAL("hello", suggestions[0]);
+    CHECK_EQUAL("help", suggestions[1]);
+    CHECK_EQUAL(1, learnedSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_DictionaryReloaded_CorrectionRemembered)
+{
+    StoreReplacement("helo", "hello", 3);
+    ReloadTestDictionary();
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK_EQUAL(1, suggestions.size());
+    CHECK_EQUAL("hello", suggestions[0]);
+    CHECK_EQUAL(0, learnedSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_CorrectionExcluded_NotSuggested)
+{
+    StoreReplacement("helo", "hello", 3);
+    RemoveWordFromDictionary("hello");
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+
+    CHECK(std::find(suggestions.begin(), suggestions.end(), "hello") == suggestions.end());
+    CHECK_EQUAL(1, learnedSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionaryLearnedReplacement_TestFixture,
+             EnchantDictStoreReplacement_OtherWord_NotAffected)
+{
+    StoreReplacement("helo", "hello", 3);
+    std::vector<std::string> suggestions = GetSuggestionsFromWord("wrld");
+
+    CHECK_EQUAL(4, suggestions.size());
+    CHECK_EQUAL(1, learnedSuggestCount);
+}
@@ -0,0 +1,210 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static GMutex asyncLock;
+static GCond asyncCond;
+static bool providerReleased;
+static bool callbackCalled;
+static gint dictSuggestCount;
+static std::vector<std::string> callbackSuggestions;
+static bool callbackGotNull;
+
+static char **
+GatedMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&dictSuggestCount);
+    g_mutex_lock(&asyncLock);
+    while (!providerReleased)
+        g_cond_wait(&asyncCond, &asyncLock);
+    g_mutex_unlock(&asyncLock);
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestGatedMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = GatedMockDictionarySuggest;
+    return dict;
+}
+
+static void DictionarySuggestAsync_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestGatedMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void
+SuggestCallback (EnchantDict * dict, char **suggs, size_t n_suggs, void *)
+{
+    g_mutex_lock(&asyncLock);
+    callbackSuggestions.clear();
+    if (suggs)
+        callbackSuggestions.insert(callbackSuggestions.begin(), suggs, suggs + n_suggs);
+    callbackGotNull = (suggs == NULL);
+    callbackCalled = true;
+    g_cond_broadcast(&asyncCond);
+    g_mutex_unlock(&asyncLock);
+    enchant_dict_free_string_list(dict, suggs);
+}
+
+struct EnchantDictionarySuggestAsync_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestAsync_TestFixture():
+            EnchantDictionaryTestFixture(DictionarySuggestAsync_ProviderConfiguration)
+    { 
+        providerReleased = true;
+        callbackCalled = false;
+        callbackGotNull = false;
+        callbackSuggestions.clear();
+        dictSuggestCount = 0;
+    }
+
+    void ReleaseProvider()
+    {
+        g_mutex_lock(&asyncLock);
+        providerReleased = true;
+        g_cond_broadcast(&asyncCond);
+        g_mutex_unlock(&asyncLock);
+    }
+
+    void WaitForCallback()
+    {
+        g_mutex_lock(&asyncLock);
+        while (!callbackCalled)
+            g_cond_wait(&asyncCond, &asyncLock);
+        g_mutex_unlock(&asyncLock);
+    }
+};
+
+/**
+ * enchant_dict_suggest_async
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @timeout_ms: How many milliseconds to spend at most, or -1 for no limit
+ * @fn: A non-null #EnchantSuggestFn
+ * @user_data: Optional user-data
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_CallbackGetsSuggestions)
+{
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, -1, SuggestCallback, NULL);
+    CHECK(request);
+    WaitForCallback();
+    enchant_dict_free_suggest_request(_dict, request);
+
+    CHECK_EQUAL(1, dictSuggestCount);
+    CHECK_EQUAL(4, callbackSuggestions.size());
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), callbackSuggestions, std::min((size_t)4, callbackSuggestions.size()));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_LenSpecified)
+{
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helodisregard me", 4, -1, SuggestCallback, NULL);
+    CHECK(request);
+    WaitForCallback();
+    enchant_dict_free_suggest_request(_dict, request);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), callbackSuggestions, std::min((size_t)4, callbackSuggestions.size()));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_HandleFreedFirst_CallbackStillCalled)
+{
+    providerReleased = false;
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, -1, SuggestCallback, NULL);
+    CHECK(request);
+    enchant_dict_free_suggest_request(_dict, request);
+    ReleaseProvider();
+    WaitForCallback();
+
+    CHECK_EQUAL(4, callbackSuggestions.size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_Cancelled_CallbackGetsNothing)
+{
+    providerReleased = false;
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, -1, SuggestCallback, NULL);
+    CHECK(request);
+    enchant_dict_cancel_suggest(_dict, request);
+    ReleaseProvider();
+    WaitForCallback();
+    enchant_dict_free_suggest_request(_dict, request);
+
+    CHECK(callbackGotNull);
+    CHECK_EQUAL(0, callbackSuggestions.size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_DeadlinePassed_ProviderNotCalled)
+{
+    EnchantSuggestRequest *request = enchant_dict_suggest_async(_dict, "helo", -1, 0, SuggestCallback, NULL);
+    CHECK(request);
+    WaitForCallback();
+    enchant_dict_free_suggest_request(_dict, request);
+
+    CHECK_EQUAL(0, dictSuggestCount);
+    CHECK(callbackGotNull);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NullDictionary_NullRequest)
+{
+    CHECK(enchant_dict_suggest_async(NULL, "helo", -1, -1, SuggestCallback, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NullWord_NullRequest)
+{
+    CHECK(enchant_dict_suggest_async(_dict, NULL, -1, -1, SuggestCallback, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_EmptyWord_NullRequest)
+{
+    CHECK(enchant_dict_suggest_async(_dict, "", -1, -1, SuggestCallback, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_InvalidUtf8_NullRequest)
+{
+    CHECK(enchant_dict_suggest_async(_dict, "\xa5\xf1\x08", -1, -1, SuggestCallback, NULL) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestAsync_TestFixture,
+             EnchantDictionarySuggestAsync_NullCallback_NullRequest)
+{
+    CHECK(enchant_dict_suggest_async(_dict, "helo", -1, -1, NULL, NULL) == NULL);
+}
@@ -0,0 +1,212 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static gint dictSuggestCount;
+
+static char **
+CountingMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    g_atomic_int_inc(&dictSuggestCount);
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestCountingMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = CountingMockDictionarySuggest;
+    return dict;
+}
+
+static void DictionarySuggestBatch_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestCountingMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void DictionarySuggestBatchThreadSafe_ProviderConfiguration (EnchantProvider * me, const char * dir)
+{
+     DictionarySuggestBatch_ProviderConfiguration(me, dir);
+     me->flags = ENCHANT_PROVIDER_THREAD_SAFE;
+}
+
+struct EnchantDictionarySuggestBatch_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestBatch_TestFixture(ConfigureHook userConfiguration = DictionarySuggestBatch_ProviderConfiguration):
+            EnchantDictionaryTestFixture(userConfiguration)
+    { 
+        dictSuggestCount = 0;
+        _suggestions = NULL;
+    }
+    //Teardown
+    ~EnchantDictionarySuggestBatch_TestFixture()
+    {
+        if (_suggestions)
+            enchant_dict_free_suggest_batch(_dict, _suggestions);
+    }
+
+    std::vector<std::string> Suggestions(size_t i, size_t n)
+    {
+        std::vector<std::string> suggestions;
+        if (_suggestions && _suggestions[i])
+            suggestions.insert(suggestions.begin(), _suggestions[i], _suggestions[i] + n);
+        return suggestions;
+    }
+
+    char*** _suggestions;
+};
+
+struct EnchantDictionarySuggestBatchThreadSafe_TestFixture : EnchantDictionarySuggestBatch_TestFixture
+{
+    //Setup
+    EnchantDictionarySuggestBatchThreadSafe_TestFixture():
+            EnchantDictionarySuggestBatch_TestFixture(DictionarySuggestBatchThreadSafe_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_suggest_batch
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to find suggestions for, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ * @out_n_suggs: Where to put the # of suggestions for each word, or %null
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_SuggestionsForEachWord)
+{
+    const char *words[] = { "helo", "wrld" };
+    size_t cSuggestions[2];
+    _suggestions = enchant_dict_suggest_batch(_dict, words, NULL, 2, cSuggestions);
+    CHECK(_suggestions);
+    CHECK_EQUAL(2, dictSuggestCount);
+    CHECK_EQUAL(4, cSuggestions[0]);
+    CHECK_EQUAL(4, cSuggestions[1]);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(0, cSuggestions[0]), 4);
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("wrld"), Suggestions(1, cSuggestions[1]), 4);
+    CHECK(_suggestions[0][4] == NULL);
+    CHECK(_suggestions[1][4] == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_Lengths_Used)
+{
+    const char *words[] = { "helodisregard me", "wrld" };
+    ssize_t lens[] = { 4, -1 };
+    size_t cSuggestions[2];
+    _suggestions = enchant_dict_suggest_batch(_dict, words, lens, 2, cSuggestions);
+    CHECK(_suggestions);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(0, cSuggestions[0]), 4);
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("wrld"), Suggestions(1, cSuggestions[1]), 4);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatchThreadSafe_TestFixture,
+             EnchantDictionarySuggestBatch_ThreadSafeProvider_SameAsSuggest)
+{
+    enchant_dict_add(_dict, "hello", -1);
+
+    std::vector<std::string> wordList;
+    for (int i = 0; i < 64; i++)
+        wordList.push_back(std::string("hel") + (char)('a' + i % 26) + "o");
+    std::vector<const char *> words;
+    for (size_t i = 0; i < wordList.size(); i++)
+        words.push_back(wordList[i].c_str());
+
+    std::vector<size_t> cSuggestions(words.size());
+    _suggestions = enchant_dict_suggest_batch(_dict, &words[0], NULL, words.size(), &cSuggestions[0]);
+    CHECK(_suggestions);
+    CHECK_EQUAL(64, dictSuggestCount);
+
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        size_t cExpected;
+        char **expected = enchant_dict_suggest(_dict, words[i], -1, &cExpected);
+        CHECK_EQUAL(cExpected, cSuggestions[i]);
+        std::vector<std::string> expectedSuggestions;
+        if (expected)
+            expectedSuggestions.insert(expectedSuggestions.begin(), expected, expected + cExpected);
+        CHECK_ARRAY_EQUAL(expectedSuggestions, Suggestions(i, cSuggestions[i]), cExpected);
+        enchant_dict_free_string_list(_dict, expected);
+    }
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_NullOutNSuggs_Ok)
+{
+    const char *words[] = { "helo" };
+    _suggestions = enchant_dict_suggest_batch(_dict, words, NULL, 1, NULL);
+    CHECK(_suggestions);
+    CHECK(_suggestions[0]);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_NoWords_Null)
+{
+    _suggestions = enchant_dict_suggest_batch(_dict, NULL, NULL, 0, NULL);
+    CHECK(_suggestions == NULL);
+    CHECK_EQUAL(0, dictSuggestCount);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_InvalidWords_NoSuggestions)
+{
+    const char *words[] = { NULL, "", "\xa5\xf1\x08", "helo" };
+    size_t cSuggestions[4];
+    _suggestions = enchant_dict_suggest_batch(_dict, words, NULL, 4, cSuggestions);
+    CHECK(_suggestions);
+
+    CHECK(_suggestions[0] == NULL);
+    CHECK(_suggestions[1] == NULL);
+    CHECK(_suggestions[2] == NULL);
+    CHECK_EQUAL(0, cSuggestions[0]);
+    CHECK_EQUAL(0, cSuggestions[1]);
+    CHECK_EQUAL(0, cSuggestions[2]);
+    CHECK_EQUAL(4, cSuggestions[3]);
+    CHECK_EQUAL(1, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_NullDictionary_Null)
+{
+    const char *words[] = { "helo" };
+    CHECK(enchant_dict_suggest_batch(NULL, words, NULL, 1, NULL) == NULL);
+    CHECK_EQUAL(0, dictSuggestCount);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBatch_TestFixture,
+             EnchantDictionarySuggestBatch_NullWords_Null)
+{
+    CHECK(enchant_dict_suggest_batch(_dict, NULL, NULL, 1, NULL) == NULL);
+    CHECK_EQUAL(0, dictSuggestCount);
+}
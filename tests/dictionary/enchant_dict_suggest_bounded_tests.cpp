@@ -0,0 +1,245 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+#include <algorithm>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static bool dictSuggestCalled;
+static bool dictSuggestBoundedCalled;
+static size_t hintedMaxSuggs;
+static int hintedMaxDistance;
+static int hintedTimeout;
+
+static char **
+MyMockDictionarySuggest (EnchantDict * dict, const char *const word, size_t len, size_t * out_n_suggs)
+{
+    dictSuggestCalled = true;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static char **
+MyMockDictionarySuggestBounded (EnchantDict * dict, const char *const word, size_t len,
+                                size_t max_suggs, int max_distance, int timeout_ms,
+                                size_t * out_n_suggs)
+{
+    dictSuggestBoundedCalled = true;
+    hintedMaxSuggs = max_suggs;
+    hintedMaxDistance = max_distance;
+    hintedTimeout = timeout_ms;
+    return MockDictionarySuggest(dict, word, len, out_n_suggs);
+}
+
+static EnchantDict* MockProviderRequestSuggestMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->suggest = MyMockDictionarySuggest;
+    return dict;
+}
+
+static EnchantDict* MockProviderRequestSuggestBoundedMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestSuggestMockDictionary(me, tag);
+    dict->suggest_bounded = MyMockDictionarySuggestBounded;
+    return dict;
+}
+
+static void DictionarySuggest_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+static void DictionarySuggestBounded_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestSuggestBoundedMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct EnchantDictionarySuggestBounded_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestBounded_TestFixture(ConfigureHook userConfiguration = DictionarySuggest_ProviderConfiguration):
+            EnchantDictionaryTestFixture(userConfiguration)
+    { 
+        dictSuggestCalled = false;
+        dictSuggestBoundedCalled = false;
+        hintedMaxSuggs = 0;
+        hintedMaxDistance = 0;
+        hintedTimeout = 0;
+        _suggestions = NULL;
+    }
+    //Teardown
+    ~EnchantDictionarySuggestBounded_TestFixture()
+    {
+        FreeStringList(_suggestions);
+    }
+
+    std::vector<std::string> Suggestions(size_t n)
+    {
+        std::vector<std::string> suggestions;
+        if (_suggestions)
+            suggestions.insert(suggestions.begin(), _suggestions, _suggestions + n);
+        return suggestions;
+    }
+
+    char** _suggestions;
+};
+
+struct EnchantDictionarySuggestBoundedHinted_TestFixture : EnchantDictionarySuggestBounded_TestFixture
+{
+    //Setup
+    EnchantDictionarySuggestBoundedHinted_TestFixture():
+            EnchantDictionarySuggestBounded_TestFixture(DictionarySuggestBounded_ProviderConfiguration)
+    { }
+};
+
+/**
+ * enchant_dict_suggest_bounded
+ * @dict: A non-null #EnchantDict
+ * @word: The non-null word you wish to find suggestions for, in UTF-8 encoding
+ * @len: The byte length of @word, or -1 for strlen (@word)
+ * @max_suggs: The most suggestions wanted, or 0 for no limit
+ * @max_distance: The greatest edit distance of the personal dictionary's suggestions, or -1 for the default
+ * @timeout_ms: How many milliseconds to spend at most, or -1 for no limit
+ * @out_n_suggs: The location to store the # of suggestions returned, or %null
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_NoLimits_SameAsSuggest)
+{
+    size_t cSuggestions;
+    enchant_dict_add(_dict, "hello", -1);
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 0, -1, -1, &cSuggestions);
+    CHECK_EQUAL(5, cSuggestions);
+
+    size_t cExpected;
+    char **expected = enchant_dict_suggest(_dict, "helo", -1, &cExpected);
+    std::vector<std::string> expectedSuggestions(expected, expected + cExpected);
+    enchant_dict_free_string_list(_dict, expected);
+
+    CHECK_ARRAY_EQUAL(expectedSuggestions, Suggestions(cSuggestions), std::min(cExpected, cSuggestions));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_MaxSuggs_FirstKept)
+{
+    size_t cSuggestions;
+    enchant_dict_add(_dict, "hello", -1);
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 2, -1, -1, &cSuggestions);
+    CHECK(_suggestions);
+    CHECK_EQUAL(2, cSuggestions);
+    CHECK(_suggestions[2] == NULL);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(cSuggestions), std::min((size_t)2, cSuggestions));
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_MaxSuggs_RoomLeftForPersonal)
+{
+    size_t cSuggestions;
+    enchant_dict_add(_dict, "hello", -1);
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 5, -1, -1, &cSuggestions);
+    CHECK_EQUAL(5, cSuggestions);
+    CHECK_EQUAL(std::string("hello"), Suggestions(cSuggestions)[4]);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_MaxDistance_LimitsPersonal)
+{
+    size_t cSuggestions;
+    enchant_dict_add(_pwl, "hello", -1);
+    _suggestions = enchant_dict_suggest_bounded(_pwl, "helo", -1, 0, 0, -1, &cSuggestions);
+    CHECK(!_suggestions);
+
+    _suggestions = enchant_dict_suggest_bounded(_pwl, "helo", -1, 0, 1, -1, &cSuggestions);
+    CHECK_EQUAL(1, cSuggestions);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_TimeoutPassed_NullSuggestions)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 0, -1, 0, NULL);
+    CHECK(!_suggestions);
+    CHECK(!dictSuggestCalled);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBoundedHinted_TestFixture,
+             EnchantDictionarySuggestBounded_ProviderGivenHints)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 3, 2, 10000, NULL);
+    CHECK(dictSuggestBoundedCalled);
+    CHECK(!dictSuggestCalled);
+    CHECK_EQUAL(3, hintedMaxSuggs);
+    CHECK_EQUAL(2, hintedMaxDistance);
+    CHECK(hintedTimeout > 0 && hintedTimeout <= 10000);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBoundedHinted_TestFixture,
+             EnchantDictionarySuggestBounded_NoLimits_ProviderNotHinted)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, "helo", -1, 0, -1, -1, NULL);
+    CHECK(!dictSuggestBoundedCalled);
+    CHECK(dictSuggestCalled);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_NullDictionary_NullSuggestions)
+{
+    _suggestions = enchant_dict_suggest_bounded(NULL, "helo", -1, 3, -1, -1, NULL);
+
+    CHECK(!_suggestions);
+    CHECK(!dictSuggestCalled);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_NullWord_NullSuggestions)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, NULL, -1, 3, -1, -1, NULL);
+
+    CHECK(!_suggestions);
+    CHECK(!dictSuggestCalled);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_EmptyWord_NullSuggestions)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, "", -1, 3, -1, -1, NULL);
+
+    CHECK(!_suggestions);
+    CHECK(!dictSuggestCalled);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestBounded_TestFixture,
+             EnchantDictionarySuggestBounded_InvalidUtf8_NullSuggestions)
+{
+    _suggestions = enchant_dict_suggest_bounded(_dict, "\xa5\xf1\x08", -1, 3, -1, -1, NULL);
+
+    CHECK(!_suggestions);
+    CHECK(!dictSuggestCalled);
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+struct EnchantDictionarySuggestPacked_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantDictionarySuggestPacked_TestFixture()
+    { 
+        _packed = NULL;
+    }
+    //Teardown
+    ~EnchantDictionarySuggestPacked_TestFixture()
+    {
+        if (_packed)
+            enchant_dict_free_packed_words(_dict, _packed);
+    }
+
+    std::vector<std::string> Suggestions(size_t i)
+    {
+        std::vector<std::string> suggestions;
+        for (uint32_t j = _packed->list_starts[i]; j < _packed->list_starts[i + 1]; j++)
+            suggestions.push_back(std::string(_packed->bytes + _packed->offsets[j],
+                                              _packed->offsets[j + 1] - _packed->offsets[j] - 1));
+        return suggestions;
+    }
+
+    EnchantPackedWords* _packed;
+};
+
+/**
+ * enchant_dict_suggest_packed
+ * @dict: A non-null #EnchantDict
+ * @words: The @n_words words you wish to find suggestions for, in UTF-8 encoding
+ * @lens: The byte lengths of @words, -1 for strlen, or %null if all are NUL-terminated
+ * @n_words: The number of words
+ *
+ * Returns: the suggestions, to be released with
+ * enchant_dict_free_packed_words, or %null if any of those
+ * pre-conditions are not met
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_OneWord)
+{
+    const char *words[] = { "helo" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 1);
+    CHECK(_packed);
+    CHECK_EQUAL(1, _packed->n_lists);
+    CHECK_EQUAL(4, _packed->n_words);
+    CHECK_EQUAL(0, _packed->list_starts[0]);
+    CHECK_EQUAL(4, _packed->list_starts[1]);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(0), 4);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_SuggestionsForEachWord)
+{
+    const char *words[] = { "helo", "wrld" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 2);
+    CHECK(_packed);
+    CHECK_EQUAL(2, _packed->n_lists);
+    CHECK_EQUAL(8, _packed->n_words);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(0), 4);
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("wrld"), Suggestions(1), 4);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_WordsNulTerminatedAndPacked)
+{
+    const char *words[] = { "helo", "wrld" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 2);
+    CHECK(_packed);
+
+    CHECK_EQUAL(0, _packed->offsets[0]);
+    for (size_t j = 0; j < _packed->n_words; j++)
+    {
+        const char *word = _packed->bytes + _packed->offsets[j];
+        CHECK_EQUAL(_packed->offsets[j + 1] - _packed->offsets[j], strlen(word) + 1);
+    }
+    CHECK_EQUAL(8 * 5, _packed->offsets[_packed->n_words]);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_Lengths_Used)
+{
+    const char *words[] = { "helodisregard me", "wrld" };
+    ssize_t lens[] = { 4, -1 };
+    _packed = enchant_dict_suggest_packed(_dict, words, lens, 2);
+    CHECK(_packed);
+
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(0), 4);
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("wrld"), Suggestions(1), 4);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_SameAsSuggest)
+{
+    enchant_dict_add(_dict, "hello", -1);
+    const char *words[] = { "helo" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 1);
+    CHECK(_packed);
+
+    std::vector<std::string> expected = GetSuggestionsFromWord("helo");
+    CHECK_EQUAL(expected.size(), _packed->n_words);
+    CHECK_ARRAY_EQUAL(expected, Suggestions(0), expected.size());
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_NoWords_Empty)
+{
+    _packed = enchant_dict_suggest_packed(_dict, NULL, NULL, 0);
+    CHECK(_packed);
+    CHECK_EQUAL(0, _packed->n_lists);
+    CHECK_EQUAL(0, _packed->n_words);
+    CHECK_EQUAL(0, _packed->list_starts[0]);
+    CHECK_EQUAL(0, _packed->offsets[0]);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_InvalidWords_EmptyLists)
+{
+    const char *words[] = { NULL, "", "\xa5\xf1\x08", "helo" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 4);
+    CHECK(_packed);
+    CHECK_EQUAL(4, _packed->n_lists);
+
+    CHECK(Suggestions(0).empty());
+    CHECK(Suggestions(1).empty());
+    CHECK(Suggestions(2).empty());
+    CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), Suggestions(3), 4);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_NullDictionary_Null)
+{
+    const char *words[] = { "helo" };
+    CHECK(enchant_dict_suggest_packed(NULL, words, NULL, 1) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionarySuggestPacked_NullWords_Null)
+{
+    CHECK(enchant_dict_suggest_packed(_dict, NULL, NULL, 1) == NULL);
+}
+
+TEST_FIXTURE(EnchantDictionarySuggestPacked_TestFixture,
+             EnchantDictionaryFreePackedWords_NullDictionary_DoNothing)
+{
+    const char *words[] = { "helo" };
+    _packed = enchant_dict_suggest_packed(_dict, words, NULL, 1);
+    enchant_dict_free_packed_words(NULL, _packed);
+}
@@ -190,6 +190,23 @@ TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
     CHECK_ARRAY_EQUAL(GetExpectedSuggestions("helo"), suggestions, std::min((size_t)4,cSuggestions));
 }
 
+TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
+             EnchantDictionarySuggest_SuggestionsFollowList)
+{
+    size_t cSuggestions;
+    enchant_dict_add(_dict, "hello", -1);
+    _suggestions = enchant_dict_suggest(_dict, "helo", -1, &cSuggestions);
+    CHECK_EQUAL(5, cSuggestions);
+
+    // the list and its strings are held in one block
+    const char *text = (const char *)(_suggestions + cSuggestions + 1);
+    for (size_t i = 0; i < cSuggestions; i++)
+    {
+        CHECK_EQUAL(text, _suggestions[i]);
+        text += strlen(text) + 1;
+    }
+}
+
 TEST_FIXTURE(EnchantDictionarySuggest_TestFixture,
              EnchantDictionarySuggest_StringListFreed)
 {
@@ -0,0 +1,139 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <cstdlib>
+#include <set>
+
+#include "EnchantDictionaryTestFixture.h"
+
+struct CountingAllocator
+{
+    size_t n_allocs;
+    size_t n_frees;
+    std::set<void *> outstanding;
+};
+
+static void *
+CountingMalloc (size_t size, void * user_data)
+{
+    CountingAllocator *allocator = static_cast<CountingAllocator *>(user_data);
+    void *block = malloc(size);
+    allocator->n_allocs++;
+    allocator->outstanding.insert(block);
+    return block;
+}
+
+static void
+CountingFree (void * ptr, void * user_data)
+{
+    CountingAllocator *allocator = static_cast<CountingAllocator *>(user_data);
+    allocator->n_frees++;
+    allocator->outstanding.erase(ptr);
+    free(ptr);
+}
+
+struct EnchantSetAllocator_TestFixture : EnchantDictionaryTestFixture
+{
+    CountingAllocator allocator;
+
+    //Setup
+    EnchantSetAllocator_TestFixture()
+    {
+        allocator.n_allocs = 0;
+        allocator.n_frees = 0;
+        enchant_set_allocator(CountingMalloc, CountingFree, &allocator);
+    }
+
+    //Teardown
+    ~EnchantSetAllocator_TestFixture()
+    {
+        enchant_set_allocator(NULL, NULL, NULL);
+    }
+
+    bool IsOwned(void * ptr)
+    {
+        return allocator.outstanding.count(ptr) != 0;
+    }
+};
+
+/**
+ * enchant_set_allocator
+ * @malloc_fn: An #EnchantMallocFn, or %null to go back to the default
+ * @free_fn: An #EnchantFreeFn, %null if and only if @malloc_fn is
+ * @user_data: Optional user-data
+ *
+ * Has the suggestion lists Enchant returns allocated with @malloc_fn,
+ * and released with @free_fn.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantSetAllocator_TestFixture,
+             EnchantSetAllocator_Suggest_ListFromAllocator)
+{
+    size_t cSuggestions;
+    char **suggestions = enchant_dict_suggest(_dict, "helo", -1, &cSuggestions);
+    CHECK(suggestions);
+    CHECK(IsOwned(suggestions));
+    CHECK_EQUAL(1, allocator.n_allocs);
+
+    FreeStringList(suggestions);
+    CHECK_EQUAL(1, allocator.n_frees);
+    CHECK(allocator.outstanding.empty());
+}
+
+TEST_FIXTURE(EnchantSetAllocator_TestFixture,
+             EnchantSetAllocator_SuggestTwice_CachedListFromAllocator)
+{
+    enchant_dict_set_suggest_cache_size(_dict, 16);
+    FreeStringList(enchant_dict_suggest(_dict, "helo", -1, NULL));
+
+    char **suggestions = enchant_dict_suggest(_dict, "helo", -1, NULL);
+    CHECK(IsOwned(suggestions));
+    FreeStringList(suggestions);
+    CHECK(allocator.outstanding.empty());
+}
+
+TEST_FIXTURE(EnchantSetAllocator_TestFixture,
+             EnchantSetAllocator_SuggestBatch_OneBlockFromAllocator)
+{
+    const char *words[] = { "helo", "wrld" };
+    size_t cSuggestions[2];
+    char ***suggestions = enchant_dict_suggest_batch(_dict, words, NULL, 2, cSuggestions);
+    CHECK(IsOwned(suggestions));
+    CHECK_EQUAL(1, allocator.outstanding.size());
+
+    enchant_dict_free_suggest_batch(_dict, suggestions);
+    CHECK_EQUAL(allocator.n_allocs, allocator.n_frees);
+    CHECK(allocator.outstanding.empty());
+}
+
+TEST_FIXTURE(EnchantSetAllocator_TestFixture,
+             EnchantSetAllocator_Null_BackToDefault)
+{
+    enchant_set_allocator(NULL, NULL, NULL);
+    FreeStringList(enchant_dict_suggest(_dict, "helo", -1, NULL));
+
+    CHECK_EQUAL(0, allocator.n_allocs);
+    CHECK_EQUAL(0, allocator.n_frees);
+}
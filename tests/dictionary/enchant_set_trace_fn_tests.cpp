@@ -0,0 +1,145 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include "EnchantDictionaryTestFixture.h"
+#include <string>
+#include <vector>
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const, size_t)
+{
+    return 1; // bad word
+}
+
+static EnchantDict* MockProviderRequestTraceMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void Trace_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestTraceMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct TraceRecord
+{
+    std::string event;
+    std::string provider;
+    size_t len;
+    int64_t elapsed_us;
+};
+
+static void
+RecordTrace (const char * const event, const char * const,
+             const char * const provider_name, size_t len, int64_t elapsed_us,
+             void * user_data)
+{
+    std::vector<TraceRecord> *records = static_cast<std::vector<TraceRecord> *>(user_data);
+    TraceRecord record = { event, provider_name ? provider_name : "", len, elapsed_us };
+    records->push_back(record);
+}
+
+struct EnchantSetTraceFn_TestFixture : EnchantDictionaryTestFixture
+{
+    std::vector<TraceRecord> records;
+
+    //Setup
+    EnchantSetTraceFn_TestFixture():
+            EnchantDictionaryTestFixture(Trace_ProviderConfiguration)
+    { }
+
+    //Teardown
+    ~EnchantSetTraceFn_TestFixture()
+    {
+        enchant_set_trace_fn(NULL, NULL);
+    }
+
+    size_t CountEvents(const std::string& event, bool entered)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < records.size(); i++)
+            if (records[i].event == event && (records[i].elapsed_us < 0) == entered)
+                n++;
+        return n;
+    }
+};
+
+/**
+ * enchant_set_trace_fn
+ * @fn: An #EnchantTraceFn, or %null to stop tracing
+ * @user_data: Optional user-data
+ *
+ * Has @fn called at the start and at the end of the calls traced.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantSetTraceFn_TestFixture,
+             EnchantSetTraceFn_Check_EnteredAndLeft)
+{
+    enchant_set_trace_fn(RecordTrace, &records);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK_EQUAL(1, CountEvents("check", true));
+    CHECK_EQUAL(1, CountEvents("check", false));
+    CHECK_EQUAL(1, CountEvents("provider_check", true));
+    CHECK_EQUAL(1, CountEvents("provider_check", false));
+    CHECK_EQUAL("check", records.front().event);
+    CHECK_EQUAL("check", records.back().event);
+    CHECK_EQUAL(5, records.front().len);
+    CHECK_EQUAL("mock", records.front().provider);
+    CHECK(records.back().elapsed_us >= 0);
+}
+
+TEST_FIXTURE(EnchantSetTraceFn_TestFixture,
+             EnchantSetTraceFn_Suggest_ProviderCallTraced)
+{
+    enchant_set_trace_fn(RecordTrace, &records);
+    FreeStringList(enchant_dict_suggest(_dict, "helo", -1, NULL));
+
+    CHECK_EQUAL(1, CountEvents("suggest", false));
+    CHECK_EQUAL(1, CountEvents("provider_suggest", false));
+}
+
+TEST_FIXTURE(EnchantSetTraceFn_TestFixture,
+             EnchantSetTraceFn_RequestDict_Traced)
+{
+    enchant_set_trace_fn(RecordTrace, &records);
+    ReloadTestDictionary();
+
+    CHECK_EQUAL(1, CountEvents("request_dict", true));
+    CHECK_EQUAL(1, CountEvents("request_dict", false));
+}
+
+TEST_FIXTURE(EnchantSetTraceFn_TestFixture,
+             EnchantSetTraceFn_Null_NoLongerCalled)
+{
+    enchant_set_trace_fn(RecordTrace, &records);
+    enchant_set_trace_fn(NULL, NULL);
+    enchant_dict_check(_dict, "hello", -1);
+
+    CHECK(records.empty());
+}
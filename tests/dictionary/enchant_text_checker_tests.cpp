@@ -0,0 +1,277 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant.h>
+#include <string>
+#include <vector>
+
+#include "EnchantDictionaryTestFixture.h"
+
+static int dictWordsChecked;
+
+static int
+MockDictionaryCheck (EnchantDict *, const char *const word, size_t len)
+{
+    dictWordsChecked++;
+    if(len == strlen("hello") && strncmp("hello", word, len)==0)
+    {
+        return 0; //good word
+    }
+    return 1; // bad word
+}
+
+static EnchantDict* MockProviderRequestTextCheckerMockDictionary(EnchantProvider * me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestEmptyMockDictionary(me, tag);
+    dict->check = MockDictionaryCheck;
+    return dict;
+}
+
+static void TextChecker_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestTextCheckerMockDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+}
+
+struct Misspelling
+{
+    std::string word;
+    size_t offset;
+    size_t charOffset;
+    size_t charLength;
+
+    bool operator==(const Misspelling& other) const
+    {
+        return word == other.word && offset == other.offset &&
+            charOffset == other.charOffset && charLength == other.charLength;
+    }
+};
+
+static void
+CollectMisspelling (EnchantDict *, const char *const word, size_t len,
+                    size_t offset, size_t char_offset, size_t char_len, void *user_data)
+{
+    std::vector<Misspelling> *misspellings = static_cast<std::vector<Misspelling> *>(user_data);
+    Misspelling misspelling = { std::string(word, len), offset, char_offset, char_len };
+    misspellings->push_back(misspelling);
+}
+
+struct EnchantTextChecker_TestFixture : EnchantDictionaryTestFixture
+{
+    EnchantTextChecker *_checker;
+
+    //Setup
+    EnchantTextChecker_TestFixture():
+            EnchantDictionaryTestFixture(TextChecker_ProviderConfiguration),
+            _checker(NULL)
+    {
+        dictWordsChecked = 0;
+    }
+
+    //Teardown
+    ~EnchantTextChecker_TestFixture()
+    {
+        if (_checker)
+            enchant_text_checker_free(_checker);
+    }
+
+    void NewChecker(const std::string& text)
+    {
+        _checker = enchant_text_checker_new(_dict, text.c_str(), text.size());
+    }
+
+    std::vector<Misspelling> Check()
+    {
+        std::vector<Misspelling> misspellings;
+        enchant_text_checker_check(_checker, CollectMisspelling, &misspellings);
+        return misspellings;
+    }
+
+    std::vector<Misspelling> CheckText(const std::string& text)
+    {
+        std::vector<Misspelling> misspellings;
+        enchant_dict_check_text(_dict, text.c_str(), text.size(), CollectMisspelling, &misspellings);
+        return misspellings;
+    }
+
+    std::string GetText()
+    {
+        size_t len;
+        const char *text = enchant_text_checker_get_text(_checker, &len);
+        return std::string(text, len);
+    }
+};
+
+/**
+ * enchant_text_checker_new
+ * @dict: A non-null #EnchantDict, to be kept until the checker is freed
+ * @text: The text you wish to check, in UTF-8 encoding; %null if @len is 0
+ * @len: The byte length of @text, or -1 for strlen (@text)
+ *
+ * Keeps a copy of @text, split into words, for checking it again and
+ * again as it is edited.
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_Check_SameAsCheckText)
+{
+    NewChecker("hello wrld, hello helo");
+
+    std::vector<Misspelling> misspellings = Check();
+    CHECK_EQUAL(2, misspellings.size());
+    CHECK(misspellings == CheckText("hello wrld, hello helo"));
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_CheckedTwice_WordsCheckedOnce)
+{
+    NewChecker("hello wrld, hello helo");
+    Check();
+    int checked = dictWordsChecked;
+
+    CHECK_EQUAL(2, Check().size());
+    CHECK_EQUAL(checked, dictWordsChecked);
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_Edit_OnlyTouchedWordsChecked)
+{
+    NewChecker("hello wrld, hello helo");
+    Check();
+    dictWordsChecked = 0;
+
+    // "wrld" becomes "world"
+    CHECK_EQUAL(0, enchant_text_checker_edit(_checker, 7, 0, "o", -1));
+    std::vector<Misspelling> misspellings = Check();
+
+    CHECK_EQUAL("hello world, hello helo", GetText());
+    CHECK(misspellings == CheckText("hello world, hello helo"));
+    CHECK(dictWordsChecked <= 2);
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_EditJoiningWords_SplitAgain)
+{
+    NewChecker("hel lo world");
+
+    CHECK_EQUAL(0, enchant_text_checker_edit(_checker, 3, 1, NULL, 0));
+    std::vector<Misspelling> misspellings = Check();
+
+    CHECK_EQUAL(1, misspellings.size());
+    CHECK(misspellings == CheckText("hello world"));
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_EditBeforeWords_OffsetsMoved)
+{
+    NewChecker("wrld helo");
+    Check();
+
+    CHECK_EQUAL(0, enchant_text_checker_edit(_checker, 0, 0, "caf\xc3\xa9 ", -1));
+    std::vector<Misspelling> misspellings = Check();
+
+    CHECK_EQUAL(3, misspellings.size());
+    CHECK(misspellings == CheckText("caf\xc3\xa9 wrld helo"));
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_WordAdded_CheckedAgain)
+{
+    NewChecker("hello wrld");
+    CHECK_EQUAL(1, Check().size());
+
+    AddWordToDictionary("wrld");
+    CHECK_EQUAL(0, Check().size());
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_RandomEdits_SameAsCheckText)
+{
+    const char *pieces[] = { "hello", " ", "wrld", "'", "caf\xc3\xa9", ".", "x", "" };
+    const size_t nPieces = sizeof(pieces) / sizeof(pieces[0]);
+    std::string text = "hello wrld";
+    NewChecker(text);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < 500; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        std::vector<size_t> boundaries;
+        for (size_t j = 0; j <= text.size(); j++)
+            if (j == text.size() || (text[j] & 0xc0) != 0x80)
+                boundaries.push_back(j);
+
+        size_t start = boundaries[(seed >> 8) % boundaries.size()];
+        seed = seed * 1103515245 + 12345;
+        size_t end = boundaries[(seed >> 8) % boundaries.size()];
+        if (end < start || (seed >> 20) % 2)
+            end = start;
+        seed = seed * 1103515245 + 12345;
+        const char *inserted = pieces[(seed >> 8) % nPieces];
+
+        CHECK_EQUAL(0, enchant_text_checker_edit(_checker, start, end - start, inserted, -1));
+        text.replace(start, end - start, inserted);
+
+        if (i % 10 == 0)
+            CHECK(Check() == CheckText(text));
+    }
+    CHECK_EQUAL(text, GetText());
+    CHECK(Check() == CheckText(text));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_EditOutOfBounds_Fails)
+{
+    NewChecker("hello");
+
+    CHECK_EQUAL(-1, enchant_text_checker_edit(_checker, 6, 0, "x", -1));
+    CHECK_EQUAL(-1, enchant_text_checker_edit(_checker, 3, 3, "x", -1));
+    CHECK_EQUAL("hello", GetText());
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_EditInsideCharacter_Fails)
+{
+    NewChecker("caf\xc3\xa9");
+
+    CHECK_EQUAL(-1, enchant_text_checker_edit(_checker, 4, 0, "x", -1));
+    CHECK_EQUAL(-1, enchant_text_checker_edit(_checker, 3, 1, "x", -1));
+    CHECK_EQUAL("caf\xc3\xa9", GetText());
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_InvalidUtf8_Null)
+{
+    CHECK(enchant_text_checker_new(_dict, "\xa5\xf1\x08", -1) == NULL);
+    NewChecker("hello");
+    CHECK_EQUAL(-1, enchant_text_checker_edit(_checker, 0, 0, "\xa5\xf1\x08", -1));
+}
+
+TEST_FIXTURE(EnchantTextChecker_TestFixture,
+             EnchantTextChecker_NullDictionary_Null)
+{
+    CHECK(enchant_text_checker_new(NULL, "hello", -1) == NULL);
+}
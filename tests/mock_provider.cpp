@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string>
 #include <stdio.h>
@@ -55,6 +56,216 @@ mock_provider_list_dicts (EnchantProvider *me, size_t *out_n_dicts)
     return NULL;
 }
 
+/* With any of these variables set when the provider is loaded, it has
+ * dictionaries for every tag, which take as long as they are told to:
+ *
+ *   ENCHANT_MOCK_CHECK_LATENCY, ENCHANT_MOCK_SUGGEST_LATENCY
+ *       MEAN_US[:JITTER_US[:SLOW_PERCENT:SLOW_US]]; a call takes MEAN_US
+ *       give or take up to JITTER_US, except that SLOW_PERCENT per cent
+ *       of them take SLOW_US instead
+ *   ENCHANT_MOCK_N_SUGGS
+ *       how many suggestions to make, 4 by default
+ *   ENCHANT_MOCK_SUGG_LEN
+ *       how many bytes long they are, by default as long as the word
+ *   ENCHANT_MOCK_NON_REENTRANT
+ *       when 1, the provider is not thread-safe, and the calls into a
+ *       dictionary that overlap one another are counted, see
+ *       mock_provider_get_overlaps
+ *
+ * Suggest calls whose timeout runs out before they would be done return
+ * nothing once it has, and are counted, see mock_provider_get_timeouts.
+ *
+ * A word is misspelled if it has a 'z' in it.  A set hook can still
+ * override all this. */
+
+struct MockLatency
+{
+    unsigned int mean_us;
+    unsigned int jitter_us;
+    unsigned int slow_percent;
+    unsigned int slow_us;
+};
+
+static struct
+{
+    MockLatency check;
+    MockLatency suggest;
+    size_t n_suggs;
+    size_t sugg_len;
+    bool non_reentrant;
+} mock_config;
+
+static gint mock_overlaps;
+static gint mock_timeouts;
+
+static bool
+mock_read_latency(const char *name, MockLatency *latency)
+{
+    memset(latency, 0, sizeof *latency);
+    const char *value = g_getenv(name);
+    if (value == NULL)
+        return false;
+    sscanf(value, "%u:%u:%u:%u", &latency->mean_us, &latency->jitter_us,
+           &latency->slow_percent, &latency->slow_us);
+    return true;
+}
+
+// returns whether any of the variables is set
+static bool
+mock_read_config()
+{
+    bool found = mock_read_latency("ENCHANT_MOCK_CHECK_LATENCY", &mock_config.check);
+    found = mock_read_latency("ENCHANT_MOCK_SUGGEST_LATENCY", &mock_config.suggest) || found;
+
+    const char *value = g_getenv("ENCHANT_MOCK_N_SUGGS");
+    mock_config.n_suggs = value ? strtoul(value, NULL, 10) : 4;
+    found = found || value;
+
+    value = g_getenv("ENCHANT_MOCK_SUGG_LEN");
+    mock_config.sugg_len = value ? strtoul(value, NULL, 10) : 0;
+    found = found || value;
+
+    value = g_getenv("ENCHANT_MOCK_NON_REENTRANT");
+    mock_config.non_reentrant = value && strcmp(value, "1") == 0;
+    return found || value;
+}
+
+static guint32
+mock_random()
+{
+    static thread_local guint32 state;
+    if (state == 0)
+        state = (guint32) g_get_monotonic_time() ^ GPOINTER_TO_UINT(&state) ^ 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// how long the next call is to take
+static gint64
+mock_draw_latency(const MockLatency *latency)
+{
+    if (latency->slow_percent && mock_random() % 100 < latency->slow_percent)
+        return latency->slow_us;
+    gint64 us = latency->mean_us;
+    if (latency->jitter_us)
+        us += (gint64) (mock_random() % (2 * latency->jitter_us + 1)) - latency->jitter_us;
+    return us;
+}
+
+static void
+mock_wait(gint64 us)
+{
+    if (us <= 0)
+        return;
+    if (us >= 1000) {
+        g_usleep(us);
+        return;
+    }
+    // too short to sleep for with any accuracy
+    gint64 end = g_get_monotonic_time() + us;
+    while (g_get_monotonic_time() < end)
+        ;
+}
+
+static void
+mock_enter(EnchantDict *me)
+{
+    if (mock_config.non_reentrant && g_atomic_int_add((gint *) me->user_data, 1) != 0)
+        g_atomic_int_inc(&mock_overlaps);
+}
+
+static void
+mock_leave(EnchantDict *me)
+{
+    if (mock_config.non_reentrant)
+        g_atomic_int_add((gint *) me->user_data, -1);
+}
+
+static int
+mock_latency_check(EnchantDict *me, const char *const word, size_t len)
+{
+    mock_enter(me);
+    mock_wait(mock_draw_latency(&mock_config.check));
+    int result = memchr(word, 'z', len) != NULL;
+    mock_leave(me);
+    return result;
+}
+
+// max_suggs of the configured suggestions, all ASCII
+static char **
+mock_make_suggestions(const char *const word, size_t len, size_t max_suggs, size_t *out_n_suggs)
+{
+    size_t n_suggs = mock_config.n_suggs;
+    if (max_suggs && max_suggs < n_suggs)
+        n_suggs = max_suggs;
+    size_t sugg_len = mock_config.sugg_len ? mock_config.sugg_len : len;
+
+    char **suggs = g_new0(char *, n_suggs + 1);
+    for (size_t i = 0; i < n_suggs; i++) {
+        suggs[i] = g_new(char, sugg_len + 1);
+        for (size_t j = 0; j < sugg_len; j++)
+            suggs[i][j] = j < len && !(word[j] & 0x80) ? word[j] : 'x';
+        suggs[i][sugg_len] = '\0';
+        if (sugg_len > 0)
+            suggs[i][0] = 'a' + (char) (i % 26);
+        if (sugg_len > 1)
+            suggs[i][1] = 'a' + (char) (i / 26 % 26);
+    }
+    *out_n_suggs = n_suggs;
+    return suggs;
+}
+
+static char **
+mock_latency_suggest_bounded(EnchantDict *me, const char *const word, size_t len,
+                             size_t max_suggs, int, int timeout_ms, size_t *out_n_suggs)
+{
+    mock_enter(me);
+    gint64 us = mock_draw_latency(&mock_config.suggest);
+    char **suggs = NULL;
+    *out_n_suggs = 0;
+    if (timeout_ms >= 0 && us > (gint64) timeout_ms * 1000) {
+        mock_wait((gint64) timeout_ms * 1000); // out of time, with nothing found
+        g_atomic_int_inc(&mock_timeouts);
+    } else {
+        mock_wait(us);
+        suggs = mock_make_suggestions(word, len, max_suggs, out_n_suggs);
+    }
+    mock_leave(me);
+    return suggs;
+}
+
+static char **
+mock_latency_suggest(EnchantDict *me, const char *const word, size_t len, size_t *out_n_suggs)
+{
+    return mock_latency_suggest_bounded(me, word, len, 0, -1, -1, out_n_suggs);
+}
+
+static EnchantDict *
+mock_latency_request_dict(EnchantProvider *, const char *const)
+{
+    EnchantDict *dict = g_new0(EnchantDict, 1);
+    dict->user_data = g_new0(gint, 1);
+    dict->check = mock_latency_check;
+    dict->suggest = mock_latency_suggest;
+    dict->suggest_bounded = mock_latency_suggest_bounded;
+    return dict;
+}
+
+static void
+mock_latency_dispose_dict(EnchantProvider *, EnchantDict *dict)
+{
+    g_free(dict->user_data);
+    g_free(dict);
+}
+
+static int
+mock_latency_dictionary_exists(EnchantProvider *, const char *const)
+{
+    return 1;
+}
+
 static ConfigureHook _hook;
 
 
@@ -65,6 +276,24 @@ set_configure(ConfigureHook hook){
     _hook = hook;
 }
 
+unsigned int
+mock_provider_get_overlaps(void)
+{
+    return g_atomic_int_get(&mock_overlaps);
+}
+
+unsigned int
+mock_provider_get_timeouts(void)
+{
+    return g_atomic_int_get(&mock_timeouts);
+}
+
+
+unsigned int
+enchant_provider_abi_version(void)
+{
+    return ENCHANT_PROVIDER_ABI_VERSION;
+}
 
 EnchantProvider * 
 init_enchant_provider(void)
@@ -95,6 +324,14 @@ init_enchant_provider(void)
     provider->list_dicts = mock_provider_list_dicts;
     provider->dictionary_exists = NULL;
 
+    if (mock_read_config()) {
+        provider->request_dict = mock_latency_request_dict;
+        provider->dispose_dict = mock_latency_dispose_dict;
+        provider->dictionary_exists = mock_latency_dictionary_exists;
+        if (!mock_config.non_reentrant)
+            provider->flags |= ENCHANT_PROVIDER_THREAD_SAFE;
+    }
+
     return provider;
 }
 
@@ -10,6 +10,8 @@ extern "C" {
 #endif
 
 void set_configure(ConfigureHook hook);
+unsigned int mock_provider_get_overlaps(void);
+unsigned int enchant_provider_abi_version(void);
 EnchantProvider * init_enchant_provider(void);
 void configure_enchant_provider(EnchantProvider * me, const char *dir_name);
 
@@ -0,0 +1,175 @@
+/* Copyright (c) 2007 Eric Scott Albright
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <enchant-provider.h>
+#include "EnchantDictionaryTestFixture.h"
+
+static gint clonesMade;
+static gint checkingWithOriginal;
+static gint checkedWithClone;
+
+#define CLONE_MARK GINT_TO_POINTER(1)
+
+/* the original waits for a while for a clone to check a word meanwhile */
+static int
+MockDictionaryCheckWithClone (EnchantDict * me, const char *const, size_t)
+{
+    if (me->user_data == CLONE_MARK)
+        {
+            g_atomic_int_set(&checkedWithClone, 1);
+            return 0;
+        }
+
+    g_atomic_int_set(&checkingWithOriginal, 1);
+    for (int i = 0; i < 100 && !g_atomic_int_get(&checkedWithClone); i++)
+        g_usleep(10 * 1000);
+    return 0;
+}
+
+static EnchantDict*
+MockProviderRequestClonableDictionary(EnchantProvider *me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestBasicMockDictionary(me, tag);
+    dict->check = MockDictionaryCheckWithClone;
+    return dict;
+}
+
+static EnchantDict*
+MockProviderCloneDictionary(EnchantProvider *me, EnchantDict *dict)
+{
+    g_atomic_int_inc(&clonesMade);
+    EnchantDict* clone = MockProviderRequestEmptyMockDictionary(me, NULL);
+    clone->check = dict->check;
+    clone->suggest = dict->suggest;
+    clone->user_data = CLONE_MARK;
+    return clone;
+}
+
+static void
+MockDictionaryAddToSession (EnchantDict *, const char *const, size_t)
+{
+}
+
+static EnchantDict*
+MockProviderRequestAddingDictionary(EnchantProvider *me, const char *tag)
+{
+    EnchantDict* dict = MockProviderRequestClonableDictionary(me, tag);
+    dict->add_to_session = MockDictionaryAddToSession;
+    return dict;
+}
+
+static void ClonableDictionary_ProviderConfiguration (EnchantProvider * me, const char *)
+{
+     me->request_dict = MockProviderRequestClonableDictionary;
+     me->dispose_dict = MockProviderDisposeDictionary;
+     me->clone_dict = MockProviderCloneDictionary;
+}
+
+static void AddingDictionary_ProviderConfiguration (EnchantProvider * me, const char * dir)
+{
+     ClonableDictionary_ProviderConfiguration(me, dir);
+     me->request_dict = MockProviderRequestAddingDictionary;
+}
+
+static gpointer
+CheckOnOtherThread (gpointer data)
+{
+    return GINT_TO_POINTER(enchant_dict_check((EnchantDict*)data, "hello", -1));
+}
+
+struct EnchantProviderCloneDict_TestFixture : EnchantDictionaryTestFixture
+{
+    //Setup
+    EnchantProviderCloneDict_TestFixture(ConfigureHook userConfiguration = ClonableDictionary_ProviderConfiguration):
+            EnchantDictionaryTestFixture(userConfiguration)
+    {
+        clonesMade = 0;
+        checkingWithOriginal = 0;
+        checkedWithClone = 0;
+    }
+
+    /* checks a word while another thread is checking with _dict */
+    void CheckWhileOriginalBusy()
+    {
+        GThread* thread = g_thread_new("check", CheckOnOtherThread, _dict);
+        while (!g_atomic_int_get(&checkingWithOriginal))
+            g_usleep(1000);
+        CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+        CHECK_EQUAL(0, GPOINTER_TO_INT(g_thread_join(thread)));
+    }
+};
+
+struct EnchantProviderCloneDictAdding_TestFixture : EnchantProviderCloneDict_TestFixture
+{
+    //Setup
+    EnchantProviderCloneDictAdding_TestFixture():
+            EnchantProviderCloneDict_TestFixture(AddingDictionary_ProviderConfiguration)
+    { }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Normal Operation
+TEST_FIXTURE(EnchantProviderCloneDict_TestFixture,
+             EnchantProviderCloneDict_NoOtherThread_NotCloned)
+{
+    for (int i = 0; i < 3; i++)
+        CHECK_EQUAL(0, enchant_dict_check(_dict, "world", -1));
+    CHECK_EQUAL(0, clonesMade);
+}
+
+TEST_FIXTURE(EnchantProviderCloneDict_TestFixture,
+             EnchantProviderCloneDict_OriginalBusy_CloneChecks)
+{
+    if (g_get_num_processors() < 2)
+        return;
+
+    CheckWhileOriginalBusy();
+
+    CHECK_EQUAL(1, clonesMade);
+    CHECK_EQUAL(1, checkedWithClone);
+}
+
+TEST_FIXTURE(EnchantProviderCloneDict_TestFixture,
+             EnchantProviderCloneDict_IdleClone_UsedAgain)
+{
+    if (g_get_num_processors() < 2)
+        return;
+
+    CheckWhileOriginalBusy();
+    checkingWithOriginal = 0;
+    checkedWithClone = 0;
+    CheckWhileOriginalBusy();
+
+    CHECK_EQUAL(1, clonesMade);
+    CHECK_EQUAL(1, checkedWithClone);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Test Error Conditions
+TEST_FIXTURE(EnchantProviderCloneDictAdding_TestFixture,
+             EnchantProviderCloneDict_DictionaryTakesWords_NotCloned)
+{
+    CheckWhileOriginalBusy();
+
+    CHECK_EQUAL(0, clonesMade);
+    CHECK_EQUAL(0, checkedWithClone);
+}
@@ -58,3 +58,30 @@ TEST_FIXTURE(EnchantTestFixture,
   g_free(user_config_dir);
   g_free(expected2);
 }
+
+TEST_FIXTURE(EnchantTestFixture,
+             GetUserConfigDir_CalledTwice_CopiesOfTheSame)
+{
+  char *user_config_dir = enchant_get_user_config_dir();
+  char *user_config_dir2 = enchant_get_user_config_dir();
+
+  CHECK(user_config_dir != user_config_dir2);
+  CHECK(strcmp(user_config_dir, user_config_dir2) == 0);
+
+  g_free(user_config_dir);
+  g_free(user_config_dir2);
+}
+
+TEST_FIXTURE(EnchantTestFixture,
+             GetUserConfigDir_EnvironmentChanged_Followed)
+{
+  std::string saved = getenv("ENCHANT_CONFIG_DIR");
+  g_free(enchant_get_user_config_dir());
+
+  g_setenv("ENCHANT_CONFIG_DIR", "elsewhere", TRUE);
+  char *user_config_dir = enchant_get_user_config_dir();
+  CHECK(strcmp("elsewhere", user_config_dir) == 0);
+
+  g_setenv("ENCHANT_CONFIG_DIR", saved.c_str(), TRUE);
+  g_free(user_config_dir);
+}
@@ -100,6 +100,24 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK_ARRAY_EQUAL(sWords, suggestions, std::min(sWords.size(), suggestions.size()));
 }
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             GetSuggestionsFromWord_ManyEquallyClose_ReturnsFirstFifteen)
+{
+  std::vector<std::string> sWords;
+  for(char c = 'a'; c <= 'z'; ++c){
+    sWords.push_back(std::string(1, c) + "at");
+  }
+  AddWordToDictionary("spat");
+  AddWordsToDictionary(sWords);
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("at");
+  CHECK_EQUAL(15, suggestions.size());
+  CHECK(std::find(suggestions.begin(), suggestions.end(), "spat") == suggestions.end());
+
+  std::sort(suggestions.begin(), suggestions.end());
+  CHECK(std::unique(suggestions.begin(), suggestions.end()) == suggestions.end());
+}
+
 TEST_FIXTURE(EnchantPwlWithDictSuggs_TestFixture,
              GetSuggestionsFromWord_MultipleSuggestions_ReturnsOnlyAsCloseAsDict)
 {
@@ -186,6 +204,169 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
 }
 
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_DictionaryRewrittenExternally_OldWordsGone)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+
+  ExternalAddWordsToDictionary(sWords);
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("hat") );
+
+  sleep(1); // c runtime library's time_t has a 1 second resolution
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), "bat\n", -1, NULL) );
+
+  CHECK( !IsWordInDictionary("cat") );
+  CHECK( !IsWordInDictionary("hat") );
+  CHECK( IsWordInDictionary("bat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_DictionaryChangedTwiceInOneSecond_SeesBothChanges)
+{
+  AddWordToDictionary("cat");
+  CHECK( IsWordInDictionary("cat") );
+
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), "cat\nhat\n", -1, NULL) );
+  CHECK( IsWordInDictionary("hat") );
+
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), "bat\nrat\n", -1, NULL) );
+  CHECK( !IsWordInDictionary("cat") );
+  CHECK( !IsWordInDictionary("hat") );
+  CHECK( IsWordInDictionary("bat") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_LastWordContinuedExternally_ReadsWholeWord)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("hat");
+  sWords.push_back("cat"); // no newline at the end
+
+  ExternalAddWordsToDictionary(sWords);
+  CHECK( IsWordInDictionary("cat") );
+
+  sleep(1); // c runtime library's time_t has a 1 second resolution
+  FILE * f = g_fopen(GetPersonalDictFileName().c_str(), "a");
+  if(f)
+  {
+      fputs("s\nbat", f);
+      fclose(f);
+  }
+
+  CHECK( IsWordInDictionary("hat") );
+  CHECK( IsWordInDictionary("cats") );
+  CHECK( !IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("bat") );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Compiled index of large word lists
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_LargeDictionaryReopened_Successful)
+{
+  std::vector<std::string> sWords;
+  for(int i = 0; i < 2000; ++i){
+    sWords.push_back("word" + std::to_string(i));
+  }
+
+  ExternalAddWordsToDictionary(sWords);
+  CHECK( IsWordInDictionary("word1999") );
+  CHECK( g_file_test((GetPersonalDictFileName() + ".idx").c_str(), G_FILE_TEST_EXISTS) );
+
+  ReloadTestDictionary();
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+  CHECK( !IsWordInDictionary("word2000") );
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("wrd1999");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "word1999") != suggestions.end() );
+
+  AddWordToDictionary("hello");
+  CHECK( IsWordInDictionary("hello") );
+  CHECK( IsWordInDictionary("word5") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             GetSuggestions_LargeDictionaryWithComposedWordsReopened_OriginalSpellingSuggested)
+{
+  std::vector<std::string> sWords;
+  for(int i = 0; i < 2000; ++i){
+    sWords.push_back((i % 2 ? "caf\xc3\xa9" : "word") + std::to_string(i));
+  }
+
+  ExternalAddWordsToDictionary(sWords);
+  CHECK( IsWordInDictionary("caf\xc3\xa9" "1999") );
+  CHECK( g_file_test((GetPersonalDictFileName() + ".idx").c_str(), G_FILE_TEST_EXISTS) );
+
+  ReloadTestDictionary();
+
+  CHECK( IsWordInDictionary("caf\xc3\xa9" "1999") );
+  CHECK( IsWordInDictionary("cafe\xcc\x81" "1999") );
+  CHECK( IsWordInDictionary("word1998") );
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("cafe1999");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "caf\xc3\xa9" "1999") != suggestions.end() );
+  suggestions = GetSuggestionsFromWord("wrd1998");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "word1998") != suggestions.end() );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_LargeDictionaryAppendedToAndReopened_AllFound)
+{
+  std::vector<std::string> sWords;
+  for(int i = 0; i < 2000; ++i){
+    sWords.push_back("word" + std::to_string(i));
+  }
+
+  ExternalAddWordsToDictionary(sWords);
+  CHECK( IsWordInDictionary("word1999") );
+  CHECK( g_file_test((GetPersonalDictFileName() + ".idx").c_str(), G_FILE_TEST_EXISTS) );
+
+  // the index no longer matches the whole file, only what it started with
+  ExternalAddWordToDictionary("hello");
+  ExternalAddWordToDictionary("world");
+  ReloadTestDictionary();
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+  CHECK( IsWordInDictionary("hello") );
+  CHECK( IsWordInDictionary("world") );
+  CHECK( !IsWordInDictionary("word2000") );
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("helo");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "hello") != suggestions.end() );
+
+  // as are removals appended to it
+  RemoveWordFromDictionary("word0");
+  ReloadTestDictionary();
+  CHECK( !IsWordInDictionary("word0") );
+  CHECK( IsWordInDictionary("world") );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_ManyWordsAddedAfterCheck_AllFound)
+{
+  CHECK( !IsWordInDictionary("word0") );
+
+  std::vector<std::string> sWords;
+  for(int i = 0; i < 500; ++i){
+    sWords.push_back("word" + std::to_string(i));
+    AddWordToDictionary(sWords.back());
+    CHECK( IsWordInDictionary(sWords.back()) );
+  }
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+  CHECK( !IsWordInDictionary("word500") );
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // DictionaryBeginsWithBOM
 TEST_FIXTURE(EnchantPwl_TestFixture, 
@@ -512,6 +693,17 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK(!IsWordInSession("cIa") );
 }
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_AddedLowerCaseNonAscii_TitleAndAllCapsSuccessful)
+{
+  AddWordToDictionary("\xc3\xa9" "cole"); // école
+
+  CHECK( IsWordInDictionary("\xc3\x89" "cole") );     // École
+  CHECK( IsWordInDictionary("\xc3\x89" "COLE") );     // ÉCOLE
+  CHECK(!IsWordInDictionary("\xc3\xa9" "COLE") );     // éCOLE
+  CHECK(!IsWordInDictionary("\xc3\x89" "coLE") );     // ÉcoLE
+}
+
 TEST_FIXTURE(EnchantPwl_TestFixture, 
              IsWordInDictionary_AddedTitle_lowerCaseAndMixedCaseNotSuccessful)
 {
@@ -717,6 +909,37 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK_ARRAY_EQUAL(expected, suggestions, expected.size());
 }
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             GetSuggestions_TitleCaseRemovedAfterSuggesting_SuggestionLowerCase)
+{
+  AddWordToDictionary("Rice");
+  CHECK_EQUAL(1, GetSuggestionsFromWord("ric").size());
+
+  AddWordToDictionary("rice");
+  RemoveWordFromDictionary("Rice");
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("ric");
+
+  std::vector<std::string> expected;
+  expected.push_back("rice");
+  CHECK_EQUAL(expected.size(), suggestions.size());
+  CHECK_ARRAY_EQUAL(expected, suggestions, std::min(expected.size(), suggestions.size()));
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             GetSuggestions_AddedLowerCaseAndTitleCase_WordTitleCase_SuggestionOnlyOnce)
+{
+  AddWordToDictionary("rice");
+  AddWordToDictionary("Rice");
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("Ric");
+
+  std::vector<std::string> expected;
+  expected.push_back("Rice");
+  CHECK_EQUAL(expected.size(), suggestions.size());
+  CHECK_ARRAY_EQUAL(expected, suggestions, expected.size());
+}
+
 TEST_FIXTURE(EnchantPwl_TestFixture, 
              GetSuggestions_AddedLowerCase_WordLowerCase_SuggestionLowerCase)
 {
@@ -1242,8 +1465,68 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK(!IsWordInDictionary(*removed) );
 }
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             PwlRemove_ItemAddedAgain_ItemInFile)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+  sWords.push_back("hello");
+  AddWordsToDictionary(sWords);
+
+  RemoveWordFromDictionary("hello");
+  AddWordToDictionary("hello");
+
+  ReloadTestDictionary(); // to see what actually persisted
+
+  for(std::vector<std::string>::const_iterator itWord = sWords.begin(); itWord != sWords.end(); ++itWord){
+    CHECK( IsWordInDictionary(*itWord) );
+  }
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             PwlRemove_MostItemsRemoved_FileCompacted)
+{
+  std::vector<std::string> sWords;
+  sWords.push_back("cat");
+  sWords.push_back("hat");
+  sWords.push_back("that");
+  sWords.push_back("bat");
+  sWords.push_back("tot");
+  AddWordsToDictionary(sWords);
+
+  RemoveWordFromDictionary("hat");
+  RemoveWordFromDictionary("that");
+  RemoveWordFromDictionary("tot");
+
+  gchar* contents = NULL;
+  CHECK( g_file_get_contents(GetPersonalDictFileName().c_str(), &contents, NULL, NULL) );
+  CHECK_EQUAL("cat\nbat\n", contents);
+  g_free(contents);
+
+  ReloadTestDictionary(); // to see what actually persisted
+
+  CHECK( IsWordInDictionary("cat") );
+  CHECK( IsWordInDictionary("bat") );
+  CHECK(!IsWordInDictionary("hat") );
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Pwl Edit distance
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             PwlSuggest_SharedPrefixWithCloserWord_FindsFarMatch)
+{
+  AddWordToDictionary("foio");
+  AddWordToDictionary("forfin"); //3
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("aofrian");
+
+  std::vector<std::string> expected;
+  expected.push_back("forfin");
+  CHECK_EQUAL(expected.size(), suggestions.size());
+  CHECK_ARRAY_EQUAL(expected, suggestions, std::min(expected.size(), suggestions.size()));
+}
+
 TEST_FIXTURE(EnchantPwl_TestFixture, 
              PwlSuggest_HasProperSubset_SubstituteFirstChar)
 {
@@ -1577,3 +1860,99 @@ TEST_FIXTURE(EnchantPwl_TestFixture,
   CHECK_ARRAY_EQUAL(sWords, suggestions, std::min(sWords.size(), suggestions.size()));
 }
 
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_LongAsciiWord_AddedAndRemoved)
+{
+  std::string sWord(100, 'a');
+  AddWordToDictionary(sWord);
+  CHECK( IsWordInDictionary(sWord) );
+  CHECK( !IsWordInDictionary(std::string(99, 'a')) );
+
+  RemoveWordFromDictionary(sWord);
+  CHECK( !IsWordInDictionary(sWord) );
+}
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_AsciiAndNonAsciiWords_Successful)
+{
+  AddWordToDictionary("cafe");
+  AddWordToDictionary("cafe\xcc\x81s"); // decomposed
+  CHECK( IsWordInDictionary("cafe") );
+  CHECK( IsWordInDictionary("caf\xc3\xa9s") ); // precomposed
+  CHECK( !IsWordInDictionary("caf\xc3\xa9") );
+
+  RemoveWordFromDictionary("caf\xc3\xa9s");
+  CHECK( !IsWordInDictionary("cafe\xcc\x81s") );
+  CHECK( IsWordInDictionary("cafe") );
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Parallel loading of very large word lists
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_LargeDictionaryRewritten_ReadsEveryLine)
+{
+  AddWordToDictionary("zebra");
+  CHECK( IsWordInDictionary("zebra") );
+
+  // well over the size read on several threads
+  std::string contents("\xef\xbb\xbf# personal word list\n");
+  contents += "removed\n";
+  contents += "#!remove readded\n";
+  for (int i = 0; i < 150000; i++)
+    {
+      char word[16];
+      sprintf(word, "w%07d\n", i);
+      contents += word;
+      if (i == 100000)
+        contents += "#!remove removed\nreadded\ncafe\xcc\x81s\n";
+    }
+  contents += "last";
+
+  sleep(1); // c runtime library's time_t has a 1 second resolution
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), contents.c_str(), contents.size(), NULL) );
+
+  CHECK( !IsWordInDictionary("zebra") );
+  CHECK( IsWordInDictionary("w0000000") );
+  CHECK( IsWordInDictionary("w0074999") );
+  CHECK( IsWordInDictionary("w0149999") );
+  CHECK( IsWordInDictionary("last") );
+  CHECK( !IsWordInDictionary("removed") );
+  CHECK( IsWordInDictionary("readded") );
+  CHECK( IsWordInDictionary("caf\xc3\xa9s") ); // precomposed
+  CHECK( !IsWordInDictionary("# personal word list") );
+
+  std::vector<std::string> suggestions = GetSuggestionsFromWord("w01234567");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "w0123456") != suggestions.end() );
+  suggestions = GetSuggestionsFromWord("redaded");
+  CHECK( std::find(suggestions.begin(), suggestions.end(), "readded") != suggestions.end() );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Reloading in the background
+
+TEST_FIXTURE(EnchantPwl_TestFixture, 
+             IsWordInDictionary_DictionaryRewrittenWithBackgroundReload_SeesChangeOnceReloaded)
+{
+  g_setenv("ENCHANT_PWL_BACKGROUND_RELOAD", "1", TRUE);
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), "cat\nhat\n", -1, NULL) );
+  CHECK( IsWordInDictionary("cat") );
+  g_unsetenv("ENCHANT_PWL_BACKGROUND_RELOAD");
+
+  sleep(1); // c runtime library's time_t has a 1 second resolution
+  CHECK( g_file_set_contents(GetPersonalDictFileName().c_str(), "bat\nrat\n", -1, NULL) );
+
+  // the words read before stay in use until the reloader is done
+  bool reloaded = false;
+  for (int i = 0; i < 500 && !reloaded; i++)
+    {
+      reloaded = IsWordInDictionary("bat");
+      if (!reloaded)
+        g_usleep(10000);
+    }
+  CHECK( reloaded );
+  CHECK( IsWordInDictionary("rat") );
+  CHECK( !IsWordInDictionary("cat") );
+  CHECK( !IsWordInDictionary("hat") );
+}